@@ -0,0 +1,258 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Basic Usage Environment: for a simple, non-scripted, console application
+// A task scheduler that uses Linux's "epoll()" interface
+// Implementation
+
+#include "BasicUsageEnvironment.hh"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+
+// The maximum number of events that we get from each "epoll_wait()" call:
+#define MAX_NUM_READY_EVENTS 256
+
+class EpollHandlerDescriptor {
+public:
+  int conditionSet; // 0 if there's no handler for this socket
+  Boolean isAlwaysReady; // True iff "epoll()" couldn't handle this socket (e.g., because it's a regular file)
+  TaskScheduler::BackgroundHandlerProc* handlerProc;
+  void* clientData;
+};
+
+////////// EpollTaskScheduler //////////
+
+EpollTaskScheduler* EpollTaskScheduler::createNew(unsigned maxSchedulerGranularity) {
+  int epollFd = epoll_create1(EPOLL_CLOEXEC);
+  if (epollFd < 0) return NULL;
+
+  return new EpollTaskScheduler(epollFd, maxSchedulerGranularity);
+}
+
+EpollTaskScheduler::EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity)
+  : fMaxSchedulerGranularity(maxSchedulerGranularity), fEpollFd(epollFd),
+    fHandlerDescriptors(NULL), fNumHandlerDescriptors(0),
+    fNumReadyEvents(0), fNextReadyEventIndex(0),
+    fAlwaysReadySockets(NULL), fNumAlwaysReadySockets(0) {
+  fReadyEvents = new struct epoll_event[MAX_NUM_READY_EVENTS];
+
+  if (maxSchedulerGranularity > 0) schedulerTickTask(); // ensures that we handle events frequently
+}
+
+EpollTaskScheduler::~EpollTaskScheduler() {
+  close(fEpollFd);
+  delete[] fHandlerDescriptors;
+  delete[] fReadyEvents;
+  delete[] fAlwaysReadySockets;
+}
+
+void EpollTaskScheduler::schedulerTickTask(void* clientData) {
+  ((EpollTaskScheduler*)clientData)->schedulerTickTask();
+}
+
+void EpollTaskScheduler::schedulerTickTask() {
+  scheduleDelayedTask(fMaxSchedulerGranularity, schedulerTickTask, this);
+}
+
+#ifndef MILLION
+#define MILLION 1000000
+#endif
+
+void EpollTaskScheduler::SingleStep(unsigned maxDelayTime) {
+  if (fNextReadyEventIndex >= fNumReadyEvents) {
+    // We've handled all of the events from our previous "epoll_wait()" call, so call it again.
+    // Begin by figuring out how long (in milliseconds) it may wait:
+    int timeoutInMs = 0;
+    if (fNumAlwaysReadySockets == 0) {
+      DelayInterval const& timeToDelay = fDelayQueue.timeToNextAlarm();
+      int64_t uSecondsToDelay = (int64_t)timeToDelay.seconds()*MILLION + timeToDelay.useconds();
+      if (maxDelayTime > 0 && uSecondsToDelay > (int64_t)maxDelayTime) uSecondsToDelay = maxDelayTime;
+
+      // Round up, so that we don't return (and then have to wait again) just before the next delayed task is due.
+      // Don't wait any longer than 1 million seconds (11.5 days):
+      int64_t const maxTimeoutInMs = (int64_t)MILLION*1000;
+      int64_t t = (uSecondsToDelay + 999)/1000;
+      timeoutInMs = t > maxTimeoutInMs ? (int)maxTimeoutInMs : (int)t;
+    }
+
+    int maxNumEvents = MAX_NUM_READY_EVENTS - fNumAlwaysReadySockets; // leave room for the 'always ready' sockets
+    if (maxNumEvents < 1) maxNumEvents = 1;
+    int numEvents = epoll_wait(fEpollFd, fReadyEvents, maxNumEvents, timeoutInMs);
+    if (numEvents < 0) {
+      if (errno != EINTR && errno != EAGAIN) {
+	// Unexpected error - treat this as fatal:
+	perror("EpollTaskScheduler::SingleStep(): epoll_wait() fails");
+	internalError();
+      }
+      numEvents = 0;
+    }
+
+    // Also add an event for each 'always ready' socket:
+    for (int i = 0; i < fNumAlwaysReadySockets && numEvents < MAX_NUM_READY_EVENTS; ++i) {
+      fReadyEvents[numEvents].events = EPOLLIN|EPOLLOUT;
+      fReadyEvents[numEvents].data.fd = fAlwaysReadySockets[i];
+      ++numEvents;
+    }
+
+    fNumReadyEvents = numEvents;
+    fNextReadyEventIndex = 0;
+  }
+
+  // Call the handler function for one ready socket.  (Note that a handler that we called previously might have changed
+  // - or removed - the handler for a socket in our list, so we check each one again before calling it.)
+  while (fNextReadyEventIndex < fNumReadyEvents) {
+    struct epoll_event const& event = fReadyEvents[fNextReadyEventIndex++];
+        // Note: we move past this event before calling its handler, in case the handler calls "doEventLoop()" reentrantly.
+    int sock = event.data.fd;
+    if (sock < 0 || sock >= fNumHandlerDescriptors) continue;
+    EpollHandlerDescriptor& handler = fHandlerDescriptors[sock]; // alias
+
+    // Like "select()", we treat an error or hangup as making the socket both readable and writable:
+    int resultConditionSet = 0;
+    if ((event.events&(EPOLLIN|EPOLLERR|EPOLLHUP)) != 0) resultConditionSet |= SOCKET_READABLE;
+    if ((event.events&(EPOLLOUT|EPOLLERR|EPOLLHUP)) != 0) resultConditionSet |= SOCKET_WRITABLE;
+    if ((event.events&EPOLLPRI) != 0) resultConditionSet |= SOCKET_EXCEPTION;
+    resultConditionSet &= handler.conditionSet;
+
+    if (resultConditionSet != 0 && handler.handlerProc != NULL) {
+      fLastHandledSocketNum = sock;
+      (*handler.handlerProc)(handler.clientData, resultConditionSet);
+      break;
+    }
+  }
+
+  // Also handle any newly-triggered event (Note that we do this *after* calling a socket handler,
+  // in case the triggered event handler modifies The set of readable sockets.)
+  handleAnyTriggeredEvent();
+
+  // Also handle any delayed event that may have come due.
+  fDelayQueue.handleAlarm();
+}
+
+void EpollTaskScheduler
+  ::setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData) {
+  if (socketNum < 0) return;
+
+  if (socketNum >= fNumHandlerDescriptors) {
+    if (conditionSet == 0) return; // we have no handler for this socket anyway
+
+    // Enlarge our array of handler descriptors:
+    int newNumHandlerDescriptors = 2*fNumHandlerDescriptors;
+    if (newNumHandlerDescriptors < 64) newNumHandlerDescriptors = 64;
+    if (newNumHandlerDescriptors <= socketNum) newNumHandlerDescriptors = socketNum+1;
+
+    EpollHandlerDescriptor* newHandlerDescriptors = new EpollHandlerDescriptor[newNumHandlerDescriptors];
+    for (int i = 0; i < newNumHandlerDescriptors; ++i) {
+      if (i < fNumHandlerDescriptors) {
+	newHandlerDescriptors[i] = fHandlerDescriptors[i];
+      } else {
+	newHandlerDescriptors[i].conditionSet = 0;
+	newHandlerDescriptors[i].isAlwaysReady = False;
+	newHandlerDescriptors[i].handlerProc = NULL;
+	newHandlerDescriptors[i].clientData = NULL;
+      }
+    }
+    delete[] fHandlerDescriptors;
+    fHandlerDescriptors = newHandlerDescriptors;
+    fNumHandlerDescriptors = newNumHandlerDescriptors;
+  }
+
+  EpollHandlerDescriptor& handler = fHandlerDescriptors[socketNum]; // alias
+  Boolean wasRegistered = handler.conditionSet != 0;
+
+  if (conditionSet == 0) {
+    if (handler.isAlwaysReady) {
+      removeAlwaysReadySocket(socketNum);
+    } else if (wasRegistered) {
+      struct epoll_event event; // ignored, but older kernels require it to be non-NULL
+      epoll_ctl(fEpollFd, EPOLL_CTL_DEL, socketNum, &event); // this fails (harmlessly) if the socket was already closed
+    }
+    handler.conditionSet = 0;
+    handler.isAlwaysReady = False;
+    handler.handlerProc = NULL;
+    handler.clientData = NULL;
+    discardPendingEvents(socketNum);
+    return;
+  }
+
+  handler.conditionSet = conditionSet;
+  handler.handlerProc = handlerProc;
+  handler.clientData = clientData;
+  if (handler.isAlwaysReady) return;
+
+  struct epoll_event event;
+  event.events = 0;
+  if (conditionSet&SOCKET_READABLE) event.events |= EPOLLIN;
+  if (conditionSet&SOCKET_WRITABLE) event.events |= EPOLLOUT;
+  if (conditionSet&SOCKET_EXCEPTION) event.events |= EPOLLPRI;
+  event.data.u64 = 0; // to keep memory checkers happy
+  event.data.fd = socketNum;
+
+  // Note: If the socket was closed (and its number then reused) without first removing its handler, then "epoll()" will
+  // already have forgotten it.  So, if our "EPOLL_CTL_MOD" or "EPOLL_CTL_ADD" fails, we try the other one:
+  int result;
+  if (wasRegistered) {
+    result = epoll_ctl(fEpollFd, EPOLL_CTL_MOD, socketNum, &event);
+    if (result < 0 && errno == ENOENT) result = epoll_ctl(fEpollFd, EPOLL_CTL_ADD, socketNum, &event);
+  } else {
+    result = epoll_ctl(fEpollFd, EPOLL_CTL_ADD, socketNum, &event);
+    if (result < 0 && errno == EEXIST) result = epoll_ctl(fEpollFd, EPOLL_CTL_MOD, socketNum, &event);
+  }
+  if (result < 0 && errno == EPERM) {
+    // "epoll()" doesn't support this kind of descriptor (e.g., a regular file).  "select()" would always report it as
+    // ready, so we do the same:
+    handler.isAlwaysReady = True;
+    addAlwaysReadySocket(socketNum);
+  }
+}
+
+void EpollTaskScheduler::moveSocketHandling(int oldSocketNum, int newSocketNum) {
+  if (oldSocketNum < 0 || newSocketNum < 0) return; // sanity check
+  if (oldSocketNum >= fNumHandlerDescriptors || fHandlerDescriptors[oldSocketNum].conditionSet == 0) return; // no handler
+
+  EpollHandlerDescriptor handler = fHandlerDescriptors[oldSocketNum]; // a copy
+  setBackgroundHandling(oldSocketNum, 0, NULL, NULL);
+  setBackgroundHandling(newSocketNum, handler.conditionSet, handler.handlerProc, handler.clientData);
+}
+
+void EpollTaskScheduler::discardPendingEvents(int socketNum) {
+  for (int i = fNextReadyEventIndex; i < fNumReadyEvents; ++i) {
+    if (fReadyEvents[i].data.fd == socketNum) fReadyEvents[i].data.fd = -1; // "SingleStep()" skips these
+  }
+}
+
+void EpollTaskScheduler::addAlwaysReadySocket(int socketNum) {
+  int* newAlwaysReadySockets = new int[fNumAlwaysReadySockets+1];
+  for (int i = 0; i < fNumAlwaysReadySockets; ++i) newAlwaysReadySockets[i] = fAlwaysReadySockets[i];
+  newAlwaysReadySockets[fNumAlwaysReadySockets++] = socketNum;
+
+  delete[] fAlwaysReadySockets;
+  fAlwaysReadySockets = newAlwaysReadySockets;
+}
+
+void EpollTaskScheduler::removeAlwaysReadySocket(int socketNum) {
+  for (int i = 0; i < fNumAlwaysReadySockets; ++i) {
+    if (fAlwaysReadySockets[i] == socketNum) {
+      fAlwaysReadySockets[i] = fAlwaysReadySockets[--fNumAlwaysReadySockets];
+      return;
+    }
+  }
+}
+#endif
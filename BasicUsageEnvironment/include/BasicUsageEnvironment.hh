@@ -83,4 +83,55 @@ private:
 #endif
 };
 
+#ifdef __linux__
+class EpollTaskScheduler: public BasicTaskScheduler0 {
+  // A task scheduler that uses Linux's "epoll()" interface, rather than "select()".  Unlike "BasicTaskScheduler", it can
+  // handle socket numbers >= FD_SETSIZE (usually 1024), and its cost per event doesn't grow with the number of sockets
+  // being handled.  Use this instead of "BasicTaskScheduler" if you have many (e.g., thousands of) concurrent streams.
+public:
+  static EpollTaskScheduler* createNew(unsigned maxSchedulerGranularity = 10000/*microseconds*/);
+    // "maxSchedulerGranularity" is as described for "BasicTaskScheduler::createNew()".
+    // Returns NULL if "epoll()" is not available.
+  virtual ~EpollTaskScheduler();
+
+protected:
+  EpollTaskScheduler(int epollFd, unsigned maxSchedulerGranularity);
+      // called only by "createNew()"
+
+  static void schedulerTickTask(void* clientData);
+  void schedulerTickTask();
+
+protected:
+  // Redefined virtual functions:
+  virtual void SingleStep(unsigned maxDelayTime);
+
+  virtual void setBackgroundHandling(int socketNum, int conditionSet, BackgroundHandlerProc* handlerProc, void* clientData);
+  virtual void moveSocketHandling(int oldSocketNum, int newSocketNum);
+
+private:
+  void addAlwaysReadySocket(int socketNum);
+  void removeAlwaysReadySocket(int socketNum);
+  void discardPendingEvents(int socketNum);
+      // Removes any of "socketNum"'s events that we got from "epoll_wait()", but haven't yet handled - so that they
+      // don't get delivered to a new handler (e.g., for a different socket that gets the same number)
+
+private:
+  unsigned fMaxSchedulerGranularity;
+  int fEpollFd;
+
+  // Each socket's handler, indexed by socket number:
+  class EpollHandlerDescriptor* fHandlerDescriptors;
+  int fNumHandlerDescriptors;
+
+  // The events returned by the most recent "epoll_wait()" call (which we handle one at a time, in successive calls
+  // to "SingleStep()"):
+  struct epoll_event* fReadyEvents;
+  int fNumReadyEvents, fNextReadyEventIndex;
+
+  // Descriptors (e.g., of regular files) that "epoll()" can't handle.  Like "select()", we treat these as always ready:
+  int* fAlwaysReadySockets;
+  int fNumAlwaysReadySockets;
+};
+#endif
+
 #endif
@@ -95,6 +95,8 @@ public:
 protected:
   BasicTaskScheduler0();
 
+  void handleAnyTriggeredEvent(); // called by "SingleStep()" implementations
+
 protected:
   // To implement delayed operations:
   DelayQueue fDelayQueue;
@@ -226,9 +226,9 @@ static long* end_ptr = &randtbl[DEG_3 + 1];
  * introduced by the L.C.R.N.G.  Note that the initialization of randtbl[]
  * for default usage relies on values produced by this routine.
  */
-long our_random(void); /*forward*/
-void
-our_srandom(unsigned int x)
+static long our_random_unlocked(void); /*forward*/
+static void
+our_srandom_unlocked(unsigned int x)
 {
 	register int i;
 
@@ -241,7 +241,7 @@ our_srandom(unsigned int x)
 		fptr = &state[rand_sep];
 		rptr = &state[0];
 		for (i = 0; i < 10 * rand_deg; i++)
-			(void)our_random();
+			(void)our_random_unlocked();
 	}
 }
 
@@ -306,7 +306,7 @@ our_initstate(seed, arg_state, n)
 	}
 	state = &(((long *)arg_state)[1]);	/* first location */
 	end_ptr = &state[rand_deg];	/* must set end_ptr before srandom */
-	our_srandom(seed);
+	our_srandom_unlocked(seed);
 	if (rand_type == TYPE_0)
 		state[-1] = rand_type;
 	else
@@ -385,7 +385,7 @@ our_setstate(arg_state)
  *
  * Returns a 31-bit random number.
  */
-long our_random() {
+static long our_random_unlocked(void) {
   long i;
 
   if (rand_type == TYPE_0) {
@@ -418,6 +418,38 @@ long our_random() {
 
   return i;
 }
+
+/*
+ * Because a program may run several event loops - each with its own "UsageEnvironment" - in separate threads (e.g.,
+ * the proxy server's worker threads), we serialize access to the random number state.  (Define NO_RANDOM_LOCK to
+ * avoid this, on platforms that don't have "pthreads".)  Note that "our_initstate()" and "our_setstate()" are not
+ * serialized; they should be called only before any other threads are started.
+ */
+#if !defined(__WIN32__) && !defined(_WIN32) && !defined(VXWORKS) && !defined(NO_RANDOM_LOCK)
+#include <pthread.h>
+static pthread_mutex_t randomLock = PTHREAD_MUTEX_INITIALIZER;
+#define LOCK_RANDOM() pthread_mutex_lock(&randomLock)
+#define UNLOCK_RANDOM() pthread_mutex_unlock(&randomLock)
+#else
+#define LOCK_RANDOM()
+#define UNLOCK_RANDOM()
+#endif
+
+void our_srandom(unsigned int x) {
+  LOCK_RANDOM();
+  our_srandom_unlocked(x);
+  UNLOCK_RANDOM();
+}
+
+long our_random() {
+  long result;
+
+  LOCK_RANDOM();
+  result = our_random_unlocked();
+  UNLOCK_RANDOM();
+
+  return result;
+}
 #endif
 
 u_int32_t our_random32() {
@@ -19,22 +19,44 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // implementation
 
 #include "Base64.hh"
-#include <strDup.hh>
 #include <string.h>
 
-static char base64DecodeTable[256];
+// To decode a group of 4 Base-64 characters at once, we use 4 tables that map each character to its 6-bit value, already
+// shifted into its position within the resulting 24 bits.  Each table maps every other character - including '=' - to
+// BAD_BASE64_CHAR, so that a group of 4 valid characters can be detected (and decoded) with a single test:
+#define BAD_BASE64_CHAR 0x01000000
+static unsigned base64DecodeTable[4][256];
+static Boolean haveInitializedBase64DecodeTables = False;
+
+static void initBase64DecodeTables() {
+  unsigned i, k;
+  for (i = 0; i < 256; ++i) {
+    for (k = 0; k < 4; ++k) base64DecodeTable[k][i] = BAD_BASE64_CHAR; // default value: invalid
+  }
+
+  unsigned char value[256];
+  for (i = 'A'; i <= 'Z'; ++i) value[i] = 0 + (i - 'A');
+  for (i = 'a'; i <= 'z'; ++i) value[i] = 26 + (i - 'a');
+  for (i = '0'; i <= '9'; ++i) value[i] = 52 + (i - '0');
+  value[(unsigned char)'+'] = 62;
+  value[(unsigned char)'/'] = 63;
+
+  char const* validChars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  for (char const* p = validChars; *p != '\0'; ++p) {
+    unsigned char c = (unsigned char)*p;
+    base64DecodeTable[0][c] = value[c]<<18;
+    base64DecodeTable[1][c] = value[c]<<12;
+    base64DecodeTable[2][c] = value[c]<<6;
+    base64DecodeTable[3][c] = value[c];
+  }
 
-static void initBase64DecodeTable() {
-  int i;
-  for (i = 0; i < 256; ++i) base64DecodeTable[i] = (char)0x80;
-      // default value: invalid
+  haveInitializedBase64DecodeTables = True;
+}
 
-  for (i = 'A'; i <= 'Z'; ++i) base64DecodeTable[i] = 0 + (i - 'A');
-  for (i = 'a'; i <= 'z'; ++i) base64DecodeTable[i] = 26 + (i - 'a');
-  for (i = '0'; i <= '9'; ++i) base64DecodeTable[i] = 52 + (i - '0');
-  base64DecodeTable[(unsigned char)'+'] = 62;
-  base64DecodeTable[(unsigned char)'/'] = 63;
-  base64DecodeTable[(unsigned char)'='] = 0;
+static inline unsigned decodeBase64Group(char const* in) {
+  // Returns the 24 bits represented by the 4 characters "in[0..3]"; or'd with BAD_BASE64_CHAR if any character isn't valid:
+  return base64DecodeTable[0][(unsigned char)in[0]] | base64DecodeTable[1][(unsigned char)in[1]]
+    | base64DecodeTable[2][(unsigned char)in[2]] | base64DecodeTable[3][(unsigned char)in[3]];
 }
 
 unsigned char* base64Decode(char const* in, unsigned& resultSize,
@@ -46,77 +68,126 @@ unsigned char* base64Decode(char const* in, unsigned& resultSize,
 unsigned char* base64Decode(char const* in, unsigned inSize,
 			    unsigned& resultSize,
 			    Boolean trimTrailingZeros) {
-  static Boolean haveInitializedBase64DecodeTable = False;
-  if (!haveInitializedBase64DecodeTable) {
-    initBase64DecodeTable();
-    haveInitializedBase64DecodeTable = True;
-  }
+  unsigned char* result = new unsigned char[3*(inSize/4)];
+  resultSize = base64DecodeInto(in, inSize, result, trimTrailingZeros);
 
-  unsigned char* out = (unsigned char*)strDupSize(in); // ensures we have enough space
-  int k = 0;
+  return result;
+}
+
+unsigned base64DecodeInto(char const* in, unsigned inSize, unsigned char* out,
+			  Boolean trimTrailingZeros) {
+  if (!haveInitializedBase64DecodeTables) initBase64DecodeTables();
+
+  unsigned k = 0;
   int paddingCount = 0;
-  int const jMax = inSize - 3;
-     // in case "inSize" is not a multiple of 4 (although it should be)
-  for (int j = 0; j < jMax; j += 4) {
-    char inTmp[4], outTmp[4];
-    for (int i = 0; i < 4; ++i) {
-      inTmp[i] = in[i+j];
-      if (inTmp[i] == '=') ++paddingCount;
-      outTmp[i] = base64DecodeTable[(unsigned char)inTmp[i]];
-      if ((outTmp[i]&0x80) != 0) outTmp[i] = 0; // this happens only if there was an invalid character; pretend that it was 'A'
+  unsigned const numGroups = inSize/4; // in case "inSize" is not a multiple of 4 (although it should be)
+  for (unsigned j = 0; j < numGroups; ++j, in += 4) {
+    unsigned bits = decodeBase64Group(in);
+    if ((bits&BAD_BASE64_CHAR) != 0) {
+      // The group contains padding, or an invalid character (in which case we pretend that it was 'A').  Decode it
+      // a character at a time:
+      bits = 0;
+      for (int i = 0; i < 4; ++i) {
+	if (in[i] == '=') ++paddingCount;
+	unsigned value = base64DecodeTable[3][(unsigned char)in[i]];
+	if ((value&BAD_BASE64_CHAR) != 0) value = 0;
+	bits = (bits<<6) | value;
+      }
     }
 
-    out[k++] = (outTmp[0]<<2) | (outTmp[1]>>4);
-    out[k++] = (outTmp[1]<<4) | (outTmp[2]>>2);
-    out[k++] = (outTmp[2]<<6) | outTmp[3];
+    // Note: Because we write 3 bytes for every 4 that we've read, this works even if "out" == "in":
+    out[k++] = (unsigned char)(bits>>16);
+    out[k++] = (unsigned char)(bits>>8);
+    out[k++] = (unsigned char)bits;
   }
 
   if (trimTrailingZeros) {
     while (paddingCount > 0 && k > 0 && out[k-1] == '\0') { --k; --paddingCount; }
   }
-  resultSize = k;
-  unsigned char* result = new unsigned char[resultSize];
-  memmove(result, out, resultSize);
-  delete[] out;
+  return k;
+}
 
-  return result;
+unsigned Base64StreamDecoder::decode(char const* in, unsigned inSize, unsigned char* out) {
+  if (!haveInitializedBase64DecodeTables) initBase64DecodeTables();
+
+  unsigned bits = fBits, numBits = fNumBits;
+  unsigned i = 0, k = 0;
+  while (i < inSize) {
+    if (numBits == 0) {
+      // We're at the start of a group of 4 characters, so decode as many complete groups as we can at once:
+      while (i + 4 <= inSize) {
+	unsigned groupBits = decodeBase64Group(&in[i]);
+	if ((groupBits&BAD_BASE64_CHAR) != 0) break; // handle this group a character at a time
+	out[k++] = (unsigned char)(groupBits>>16);
+	out[k++] = (unsigned char)(groupBits>>8);
+	out[k++] = (unsigned char)groupBits;
+	i += 4;
+      }
+      if (i == inSize) break;
+    }
+
+    char c = in[i++];
+    if (c == '=') {
+      // Padding: Any leftover bits are unused:
+      bits = numBits = 0;
+      continue;
+    }
+    unsigned value = base64DecodeTable[3][(unsigned char)c];
+    if ((value&BAD_BASE64_CHAR) != 0) continue; // ignore whitespace, etc.
+
+    bits = (bits<<6) | value;
+    numBits += 6;
+    if (numBits >= 8) {
+      numBits -= 8;
+      out[k++] = (unsigned char)(bits>>numBits);
+      bits &= (1<<numBits) - 1;
+    }
+  }
+
+  fBits = bits; fNumBits = numBits;
+  return k;
 }
 
 static const char base64Char[] =
 "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
 
-char* base64Encode(char const* origSigned, unsigned origLength) {
-  unsigned char const* orig = (unsigned char const*)origSigned; // in case any input bytes have the MSB set
+char* base64Encode(char const* orig, unsigned origLength) {
   if (orig == NULL) return NULL;
 
-  unsigned const numOrig24BitValues = origLength/3;
-  Boolean havePadding = origLength > numOrig24BitValues*3;
-  Boolean havePadding2 = origLength == numOrig24BitValues*3 + 2;
-  unsigned const numResultBytes = 4*(numOrig24BitValues + havePadding);
-  char* result = new char[numResultBytes+1]; // allow for trailing '\0'
+  char* result = new char[base64EncodedLength(origLength)+1]; // allow for trailing '\0'
+  base64EncodeInto(orig, origLength, result);
+  return result;
+}
+
+unsigned base64EncodeInto(char const* origSigned, unsigned origLength, char* out) {
+  unsigned char const* orig = (unsigned char const*)origSigned; // in case any input bytes have the MSB set
+  char* result = out;
 
   // Map each full group of 3 input bytes into 4 output base-64 characters:
-  unsigned i;
-  for (i = 0; i < numOrig24BitValues; ++i) {
-    result[4*i+0] = base64Char[(orig[3*i]>>2)&0x3F];
-    result[4*i+1] = base64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
-    result[4*i+2] = base64Char[((orig[3*i+1]<<2) | (orig[3*i+2]>>6))&0x3F];
-    result[4*i+3] = base64Char[orig[3*i+2]&0x3F];
+  unsigned const numOrig24BitValues = origLength/3;
+  for (unsigned i = 0; i < numOrig24BitValues; ++i, orig += 3, out += 4) {
+    unsigned bits = (orig[0]<<16) | (orig[1]<<8) | orig[2];
+    out[0] = base64Char[bits>>18];
+    out[1] = base64Char[(bits>>12)&0x3F];
+    out[2] = base64Char[(bits>>6)&0x3F];
+    out[3] = base64Char[bits&0x3F];
   }
 
-  // Now, take padding into account.  (Note: i == numOrig24BitValues)
-  if (havePadding) {
-    result[4*i+0] = base64Char[(orig[3*i]>>2)&0x3F];
-    if (havePadding2) {
-      result[4*i+1] = base64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
-      result[4*i+2] = base64Char[(orig[3*i+1]<<2)&0x3F];
+  // Now, take padding into account:
+  unsigned const numRemainingBytes = origLength - 3*numOrig24BitValues;
+  if (numRemainingBytes > 0) {
+    out[0] = base64Char[orig[0]>>2];
+    if (numRemainingBytes == 2) {
+      out[1] = base64Char[((orig[0]&0x3)<<4) | (orig[1]>>4)];
+      out[2] = base64Char[(orig[1]<<2)&0x3F];
     } else {
-      result[4*i+1] = base64Char[((orig[3*i]&0x3)<<4)&0x3F];
-      result[4*i+2] = '=';
+      out[1] = base64Char[(orig[0]&0x3)<<4];
+      out[2] = '=';
     }
-    result[4*i+3] = '=';
+    out[3] = '=';
+    out += 4;
   }
 
-  result[numResultBytes] = '\0';
-  return result;
+  *out = '\0';
+  return out - result;
 }
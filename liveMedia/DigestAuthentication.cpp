@@ -20,27 +20,32 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "DigestAuthentication.hh"
 #include "ourMD5.hh"
+#include "ourSHA256.hh"
 #include <strDup.hh>
 #include <GroupsockHelper.hh> // for gettimeofday()
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
-Authenticator::Authenticator() {
+Authenticator::Authenticator()
+  : fUsesSHA256(False) {
   assign(NULL, NULL, NULL, NULL, False);
 }
 
-Authenticator::Authenticator(char const* username, char const* password, Boolean passwordIsMD5) {
+Authenticator::Authenticator(char const* username, char const* password, Boolean passwordIsMD5)
+  : fUsesSHA256(False) {
   assign(NULL, NULL, username, password, passwordIsMD5);
 }
 
-Authenticator::Authenticator(const Authenticator& orig) {
+Authenticator::Authenticator(const Authenticator& orig)
+  : fUsesSHA256(orig.fUsesSHA256) {
   assign(orig.realm(), orig.nonce(), orig.username(), orig.password(), orig.fPasswordIsMD5);
 }
 
 Authenticator& Authenticator::operator=(const Authenticator& rightSide) {
   if (&rightSide != this) {
     reset();
+    fUsesSHA256 = rightSide.fUsesSHA256;
     assign(rightSide.realm(), rightSide.nonce(),
 	   rightSide.username(), rightSide.password(), rightSide.fPasswordIsMD5);
   }
@@ -68,77 +73,129 @@ Authenticator::~Authenticator() {
 void Authenticator::reset() {
   resetRealmAndNonce();
   resetUsernameAndPassword();
+  fUsesSHA256 = False;
+  fHA1[0] = '\0';
+}
+
+static Boolean stringsAreEqual(char const* str1, char const* str2) {
+  if (str1 == NULL || str2 == NULL) return str1 == str2;
+  return strcmp(str1, str2) == 0;
 }
 
 void Authenticator::setRealmAndNonce(char const* realm, char const* nonce) {
+  if (stringsAreEqual(realm, fRealm)) {
+    // Only the nonce is changing, so we can keep our (cached) "fHA1":
+    delete[] fNonce; fNonce = strDup(nonce);
+    return;
+  }
+
   resetRealmAndNonce();
   assignRealmAndNonce(realm, nonce);
+  updateHA1();
 }
 
 void Authenticator::setRealmAndRandomNonce(char const* realm) {
-  resetRealmAndNonce();
-
-  // Construct data to seed the random nonce:
-  struct {
-    struct timeval timestamp;
-    unsigned counter;
-  } seedData;
-  gettimeofday(&seedData.timestamp, NULL);
-  static unsigned counter = 0;
-  seedData.counter = ++counter;
-
-  // Use MD5 to compute a 'random' nonce from this seed data:
   char nonceBuf[33];
-  our_MD5Data((unsigned char*)(&seedData), sizeof seedData, nonceBuf);
+  createRandomNonce(nonceBuf);
 
-  assignRealmAndNonce(realm, nonceBuf);
+  setRealmAndNonce(realm, nonceBuf);
 }
 
 void Authenticator::setUsernameAndPassword(char const* username,
 					   char const* password,
 					   Boolean passwordIsMD5) {
+  if (username == NULL) username = "";
+  if (password == NULL) password = "";
+  if (stringsAreEqual(username, fUsername) && stringsAreEqual(password, fPassword)
+      && passwordIsMD5 == fPasswordIsMD5) {
+    return; // nothing has changed (which is common for servers, which set these for each request)
+  }
+
   resetUsernameAndPassword();
   assignUsernameAndPassword(username, password, passwordIsMD5);
+  updateHA1();
+}
+
+void Authenticator::setUsesSHA256(Boolean usesSHA256) {
+  if (usesSHA256 == fUsesSHA256) return;
+
+  fUsesSHA256 = usesSHA256;
+  updateHA1();
+}
+
+// Computes the digest (MD5 or SHA-256) of "<field0>:<field1>:...", as a hex string, without first copying the fields
+// into a single buffer:
+static void computeDigestOfFields(Boolean usesSHA256, unsigned numFields,
+				  char const* const* fields, unsigned const* fieldSizes, char* resultBuf) {
+  if (usesSHA256) {
+    SHA256Context ctx;
+    for (unsigned i = 0; i < numFields; ++i) {
+      if (i > 0) ctx.addData((unsigned char const*)":", 1);
+      ctx.addData((unsigned char const*)fields[i], fieldSizes[i]);
+    }
+    ctx.end(resultBuf);
+  } else {
+    MD5Context ctx;
+    for (unsigned i = 0; i < numFields; ++i) {
+      if (i > 0) ctx.addData((unsigned char const*)":", 1);
+      ctx.addData((unsigned char const*)fields[i], fieldSizes[i]);
+    }
+    ctx.end(resultBuf);
+  }
 }
 
 char const* Authenticator::computeDigestResponse(char const* cmd,
 						 char const* url) const {
+  char* result = new char[DIGEST_RESPONSE_MAX_SIZE];
+  char const* ourNonce = nonce() == NULL ? "" : nonce();
+  computeDigestResponse(cmd, url, strlen(url), ourNonce, strlen(ourNonce), result);
+
+  return result;
+}
+
+void Authenticator::reclaimDigestResponse(char const* responseStr) const {
+  delete[](char*)responseStr;
+}
+
+void Authenticator::computeDigestResponse(char const* cmd, char const* url, unsigned urlSize,
+					  char const* nonce, unsigned nonceSize, char* resultBuf) const {
   // The "response" field is computed as:
   //    md5(md5(<username>:<realm>:<password>):<nonce>:md5(<cmd>:<url>))
   // or, if "fPasswordIsMD5" is True:
   //    md5(<password>:<nonce>:md5(<cmd>:<url>))
-  char ha1Buf[33];
-  if (fPasswordIsMD5) {
-    strncpy(ha1Buf, password(), 32);
-    ha1Buf[32] = '\0'; // just in case
-  } else {
-    unsigned const ha1DataLen = strlen(username()) + 1
-      + strlen(realm()) + 1 + strlen(password());
-    unsigned char* ha1Data = new unsigned char[ha1DataLen+1];
-    sprintf((char*)ha1Data, "%s:%s:%s", username(), realm(), password());
-    our_MD5Data(ha1Data, ha1DataLen, ha1Buf);
-    delete[] ha1Data;
-  }
+  // (or similarly, using sha256() instead of md5(), if we use SHA-256).
+  // The first of the inner digests has already been computed (as "fHA1").
+  char const* ha2Fields[2] = { cmd, url };
+  unsigned const ha2FieldSizes[2] = { (unsigned)strlen(cmd), urlSize };
+  char ha2Buf[DIGEST_RESPONSE_MAX_SIZE];
+  computeDigestOfFields(fUsesSHA256, 2, ha2Fields, ha2FieldSizes, ha2Buf);
 
-  unsigned const ha2DataLen = strlen(cmd) + 1 + strlen(url);
-  unsigned char* ha2Data = new unsigned char[ha2DataLen+1];
-  sprintf((char*)ha2Data, "%s:%s", cmd, url);
-  char ha2Buf[33];
-  our_MD5Data(ha2Data, ha2DataLen, ha2Buf);
-  delete[] ha2Data;
-
-  unsigned const digestDataLen
-    = 32 + 1 + strlen(nonce()) + 1 + 32;
-  unsigned char* digestData = new unsigned char[digestDataLen+1];
-  sprintf((char*)digestData, "%s:%s:%s",
-          ha1Buf, nonce(), ha2Buf);
-  char const* result = our_MD5Data(digestData, digestDataLen, NULL);
-  delete[] digestData;
-  return result;
+  char const* digestFields[3] = { fHA1, nonce, ha2Buf };
+  unsigned const digestFieldSizes[3] = { (unsigned)strlen(fHA1), nonceSize, (unsigned)strlen(ha2Buf) };
+  computeDigestOfFields(fUsesSHA256, 3, digestFields, digestFieldSizes, resultBuf);
 }
 
-void Authenticator::reclaimDigestResponse(char const* responseStr) const {
-  delete[](char*)responseStr;
+void Authenticator::computeHA1(char const* username, char const* realm, char const* password, Boolean usesSHA256,
+			       char* resultBuf) {
+  char const* fields[3] = { username, realm, password };
+  unsigned const fieldSizes[3] = { (unsigned)strlen(username), (unsigned)strlen(realm), (unsigned)strlen(password) };
+  computeDigestOfFields(usesSHA256, 3, fields, fieldSizes, resultBuf);
+}
+
+void Authenticator::createRandomNonce(char* resultBuf) {
+  // Construct data to seed the random nonce:
+  struct {
+    struct timeval timestamp;
+    unsigned counter;
+    u_int32_t random;
+  } seedData;
+  gettimeofday(&seedData.timestamp, NULL);
+  static unsigned counter = 0;
+  seedData.counter = ++counter;
+  seedData.random = our_random32(); // in case "counter" is being updated concurrently (by another thread)
+
+  // Use MD5 to compute a 'random' nonce from this seed data:
+  our_MD5Data((unsigned char*)(&seedData), sizeof seedData, resultBuf);
 }
 
 void Authenticator::resetRealmAndNonce() {
@@ -170,4 +227,18 @@ void Authenticator::assign(char const* realm, char const* nonce,
 			   char const* username, char const* password, Boolean passwordIsMD5) {
   assignRealmAndNonce(realm, nonce);
   assignUsernameAndPassword(username, password, passwordIsMD5);
+  updateHA1();
+}
+
+void Authenticator::updateHA1() {
+  if (fPasswordIsMD5) {
+    // Our 'password' is already the digest that we want:
+    unsigned const digestSize = fUsesSHA256 ? 64 : 32;
+    strncpy(fHA1, password(), digestSize);
+    fHA1[digestSize] = '\0'; // just in case
+  } else if (fRealm != NULL && fUsername != NULL && fPassword != NULL) {
+    computeHA1(fUsername, fRealm, fPassword, fUsesSHA256, fHA1);
+  } else {
+    fHA1[0] = '\0'; // we can't compute it yet
+  }
 }
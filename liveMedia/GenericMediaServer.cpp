@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "GenericMediaServer.hh"
+#include "DigestAuthentication.hh"
 #include <GroupsockHelper.hh>
 #if defined(__WIN32__) || defined(_WIN32) || defined(_QNX4)
 #define snprintf _snprintf
@@ -87,6 +88,40 @@ void GenericMediaServer::deleteServerMediaSession(char const* streamName) {
   deleteServerMediaSession((ServerMediaSession*)(fServerMediaSessions->Lookup(streamName)));
 }
 
+void GenericMediaServer::setConnectionLimits(unsigned maxConnections, unsigned maxConnectionsPerClientAddress) {
+  fMaxConnections = maxConnections;
+  fMaxConnectionsPerClientAddress = maxConnectionsPerClientAddress;
+
+  if (fMaxConnectionsPerClientAddress > 0 && fNumConnectionsPerClientAddress == NULL) {
+    // Begin counting connections per client address - including those that we already have:
+    fNumConnectionsPerClientAddress = HashTable::create(ONE_WORD_HASH_KEYS);
+
+    HashTable::Iterator* iter = HashTable::Iterator::create(*fClientConnections);
+    GenericMediaServer::ClientConnection* connection;
+    char const* key; // dummy
+    while ((connection = (GenericMediaServer::ClientConnection*)(iter->next(key))) != NULL) {
+      changeNumConnectionsPerClientAddress(connection->fClientAddr, 1);
+    }
+    delete iter;
+  }
+}
+
+void GenericMediaServer::setRequestTimeouts(unsigned requestCompletionSeconds, unsigned idleConnectionSeconds) {
+  // Note: These apply to requests that begin (and connections that become idle) after this call.
+  fRequestCompletionSeconds = requestCompletionSeconds;
+  fIdleConnectionSeconds = idleConnectionSeconds;
+}
+
+void GenericMediaServer::setRequestRateLimit(unsigned maxRequestsPerSecond, unsigned maxRequestBurstSize) {
+  fMaxRequestsPerSecond = maxRequestsPerSecond;
+  fMaxRequestBurstSize = maxRequestBurstSize == 0 ? 1 : maxRequestBurstSize;
+}
+
+void GenericMediaServer::getConnectionStatistics(ConnectionStatistics& stats) const {
+  stats = fConnectionStatistics;
+  stats.numCurrentConnections = fNumConnections;
+}
+
 GenericMediaServer
 ::GenericMediaServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 		     unsigned reclamationSeconds)
@@ -94,7 +129,11 @@ GenericMediaServer
     fServerSocket(ourSocket), fServerPort(ourPort), fReclamationSeconds(reclamationSeconds),
     fServerMediaSessions(HashTable::create(STRING_HASH_KEYS)),
     fClientConnections(HashTable::create(ONE_WORD_HASH_KEYS)),
-    fClientSessions(HashTable::create(STRING_HASH_KEYS)) {
+    fClientSessions(HashTable::create(STRING_HASH_KEYS)),
+    fNumConnections(0), fMaxConnections(0), fMaxConnectionsPerClientAddress(0), fNumConnectionsPerClientAddress(NULL),
+    fRequestCompletionSeconds(0), fIdleConnectionSeconds(0),
+    fMaxRequestsPerSecond(0), fMaxRequestBurstSize(1) {
+  memset(&fConnectionStatistics, 0, sizeof fConnectionStatistics);
   ignoreSigPipeOnSocket(fServerSocket); // so that clients on the same host that are killed don't also kill us
   
   // Arrange to handle connections from others:
@@ -105,6 +144,8 @@ GenericMediaServer::~GenericMediaServer() {
   // Turn off background read handling:
   envir().taskScheduler().turnOffBackgroundReadHandling(fServerSocket);
   ::closeSocket(fServerSocket);
+
+  delete fNumConnectionsPerClientAddress; // (by now, all of our "ClientConnection"s - which use this - have been deleted)
 }
 
 void GenericMediaServer::cleanup() {
@@ -136,7 +177,9 @@ void GenericMediaServer::cleanup() {
   delete fServerMediaSessions;
 }
 
+#ifndef LISTEN_BACKLOG_SIZE
 #define LISTEN_BACKLOG_SIZE 20
+#endif
 
 int GenericMediaServer::setUpOurSocket(UsageEnvironment& env, Port& ourPort) {
   int ourSocket = -1;
@@ -182,26 +225,75 @@ void GenericMediaServer::incomingConnectionHandler() {
 }
 
 void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
-  struct sockaddr_in clientAddr;
-  SOCKLEN_T clientAddrLen = sizeof clientAddr;
-  int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
-  if (clientSocket < 0) {
-    int err = envir().getErrno();
-    if (err != EWOULDBLOCK) {
-      envir().setResultErrMsg("accept() failed: ");
+  // Accept each of the connections that are now pending (but no more than a backlog's worth, so that a flood of
+  // new connections can't starve our existing ones):
+  for (unsigned i = 0; i < LISTEN_BACKLOG_SIZE; ++i) {
+    struct sockaddr_in clientAddr;
+    SOCKLEN_T clientAddrLen = sizeof clientAddr;
+    int clientSocket = accept(serverSocket, (struct sockaddr*)&clientAddr, &clientAddrLen);
+    if (clientSocket < 0) {
+      int err = envir().getErrno();
+      if (err != EWOULDBLOCK) {
+	envir().setResultErrMsg("accept() failed: ");
+      }
+      return;
     }
-    return;
-  }
-  ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
-  makeSocketNonBlocking(clientSocket);
-  increaseSendBufferTo(envir(), clientSocket, 50*1024);
-  
+    ++fConnectionStatistics.numAccepted;
+    
 #ifdef DEBUG
-  envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
+    envir() << "accept()ed connection from " << AddressString(clientAddr).val() << "\n";
 #endif
-  
-  // Create a new object for handling this connection:
-  (void)createNewClientConnection(clientSocket, clientAddr);
+    if (!acceptingConnectionFrom(clientAddr)) {
+      // We're overloaded, or this client already has too many connections.  Close this connection now, rather than
+      // let it use any of our resources:
+#ifdef DEBUG
+      envir() << "\t...but closed it again, because of our connection limits\n";
+#endif
+      ::closeSocket(clientSocket);
+      continue;
+    }
+    ignoreSigPipeOnSocket(clientSocket); // so that clients on the same host that are killed don't also kill us
+    makeSocketNonBlocking(clientSocket);
+    increaseSendBufferTo(envir(), clientSocket, 50*1024);
+    
+    // Create a new object for handling this connection:
+    (void)createNewClientConnection(clientSocket, clientAddr);
+  }
+}
+
+Boolean GenericMediaServer::acceptingConnectionFrom(struct sockaddr_in const& clientAddr) {
+  if (fMaxConnections > 0 && fNumConnections >= fMaxConnections) {
+    ++fConnectionStatistics.numRejectedForOverload;
+    return False;
+  }
+
+  if (fMaxConnectionsPerClientAddress > 0 && fNumConnectionsPerClientAddress != NULL) {
+    unsigned numConnections
+      = (unsigned)(uintptr_t)(fNumConnectionsPerClientAddress->Lookup((char const*)(uintptr_t)clientAddr.sin_addr.s_addr));
+    if (numConnections >= fMaxConnectionsPerClientAddress) {
+      ++fConnectionStatistics.numRejectedForClientAddressLimit;
+      return False;
+    }
+  }
+
+  return True;
+}
+
+void GenericMediaServer::changeNumConnectionsFrom(struct sockaddr_in const& clientAddr, int delta) {
+  fNumConnections += delta;
+  changeNumConnectionsPerClientAddress(clientAddr, delta);
+}
+
+void GenericMediaServer::changeNumConnectionsPerClientAddress(struct sockaddr_in const& clientAddr, int delta) {
+  if (fNumConnectionsPerClientAddress == NULL) return; // we're not counting these
+
+  char const* key = (char const*)(uintptr_t)clientAddr.sin_addr.s_addr;
+  int numConnections = (int)(uintptr_t)(fNumConnectionsPerClientAddress->Lookup(key)) + delta;
+  if (numConnections > 0) {
+    fNumConnectionsPerClientAddress->Add(key, (void*)(uintptr_t)numConnections);
+  } else {
+    fNumConnectionsPerClientAddress->Remove(key);
+  }
 }
 
 
@@ -209,9 +301,14 @@ void GenericMediaServer::incomingConnectionHandlerOnSocket(int serverSocket) {
 
 GenericMediaServer::ClientConnection
 ::ClientConnection(GenericMediaServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
-  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr) {
+  : fOurServer(ourServer), fOurSocket(clientSocket), fClientAddr(clientAddr),
+    fRequestTimerTask(NULL), fRequestTimerIsForIncompleteRequest(False), fIsUsedByClientSession(False),
+    fRequestTokens(ourServer.fMaxRequestBurstSize) {
+  gettimeofday(&fRequestTokensTime, NULL);
+
   // Add ourself to our 'client connections' table:
   fOurServer.fClientConnections->Add((char const*)this, this);
+  fOurServer.changeNumConnectionsFrom(fClientAddr, 1);
   
   // Arrange to handle incoming requests:
   resetRequestBuffer();
@@ -222,6 +319,8 @@ GenericMediaServer::ClientConnection
 GenericMediaServer::ClientConnection::~ClientConnection() {
   // Remove ourself from the server's 'client connections' hash table before we go:
   fOurServer.fClientConnections->Remove((char const*)this);
+  fOurServer.changeNumConnectionsFrom(fClientAddr, -1);
+  stopRequestTimer();
   
   closeSockets();
 }
@@ -243,12 +342,77 @@ void GenericMediaServer::ClientConnection::incomingRequestHandler() {
   struct sockaddr_in dummy; // 'from' address, meaningless in this case
   
   int bytesRead = readSocket(envir(), fOurSocket, &fRequestBuffer[fRequestBytesAlreadySeen], fRequestBufferBytesLeft, dummy);
+  if (bytesRead > 0 && fOurServer.fRequestCompletionSeconds > 0
+      && !(fRequestTimerTask != NULL && fRequestTimerIsForIncompleteRequest)) {
+    // This is the start of a new request.  The client must complete it in time (or else we'll close the connection):
+    envir().taskScheduler().rescheduleDelayedTask(fRequestTimerTask, fOurServer.fRequestCompletionSeconds*1000000,
+						  requestTimeoutHandler, this);
+    fRequestTimerIsForIncompleteRequest = True;
+  }
   handleRequestBytes(bytesRead);
 }
 
 void GenericMediaServer::ClientConnection::resetRequestBuffer() {
   fRequestBytesAlreadySeen = 0;
   fRequestBufferBytesLeft = sizeof fRequestBuffer;
+
+  // We're now waiting for a new request.  Unless this connection is being used by a client session, close it if the
+  // client waits too long before sending one:
+  stopRequestTimer();
+  if (fOurServer.fIdleConnectionSeconds > 0 && !fIsUsedByClientSession) {
+    fRequestTimerTask = envir().taskScheduler().scheduleDelayedTask(fOurServer.fIdleConnectionSeconds*1000000,
+								     requestTimeoutHandler, this);
+    fRequestTimerIsForIncompleteRequest = False;
+  }
+}
+
+Boolean GenericMediaServer::ClientConnection::requestIsWithinRateLimit() {
+  unsigned const maxRequestsPerSecond = fOurServer.fMaxRequestsPerSecond;
+  if (maxRequestsPerSecond == 0) return True; // there's no limit
+
+  // Add the tokens that have accrued since we last did this, then use one (if we can) for this request:
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  double elapsed = (timeNow.tv_sec - fRequestTokensTime.tv_sec) + (timeNow.tv_usec - fRequestTokensTime.tv_usec)/1000000.0;
+  fRequestTokensTime = timeNow;
+
+  fRequestTokens += elapsed*maxRequestsPerSecond;
+  if (fRequestTokens > fOurServer.fMaxRequestBurstSize) fRequestTokens = fOurServer.fMaxRequestBurstSize;
+  if (fRequestTokens < 1.0) {
+    ++fOurServer.fConnectionStatistics.numClosedForRequestRate;
+    return False;
+  }
+
+  fRequestTokens -= 1.0;
+  return True;
+}
+
+void GenericMediaServer::ClientConnection::noteUsedByClientSession() {
+  fIsUsedByClientSession = True;
+  if (!fRequestTimerIsForIncompleteRequest) stopRequestTimer();
+}
+
+void GenericMediaServer::ClientConnection::stopRequestTimer() {
+  envir().taskScheduler().unscheduleDelayedTask(fRequestTimerTask);
+  fRequestTimerIsForIncompleteRequest = False;
+}
+
+void GenericMediaServer::ClientConnection::requestTimeoutHandler(void* clientData) {
+  ClientConnection* connection = (ClientConnection*)clientData;
+  connection->fRequestTimerTask = NULL;
+
+  if (connection->fRequestTimerIsForIncompleteRequest) {
+    ++connection->fOurServer.fConnectionStatistics.numClosedForSlowRequest;
+  } else {
+    ++connection->fOurServer.fConnectionStatistics.numClosedForIdleness;
+  }
+#ifdef DEBUG
+  fprintf(stderr, "ClientConnection[%p]: %s; closing the connection\n", connection,
+	  connection->fRequestTimerIsForIncompleteRequest ? "request not completed in time" : "idle for too long");
+#endif
+
+  // Treat this as if the client had closed the connection (which causes the connection object to get deleted):
+  connection->handleRequestBytes(-1);
 }
 
 
@@ -362,13 +526,42 @@ ServerMediaSession* GenericMediaServer::ServerMediaSessionIterator::next() {
 }
 
 
+////////// ClientSessionIterator implementation //////////
+
+GenericMediaServer::ClientSessionIterator
+::ClientSessionIterator(GenericMediaServer& server)
+  : fOurIterator((server.fClientSessions == NULL)
+		 ? NULL : HashTable::Iterator::create(*server.fClientSessions)) {
+}
+
+GenericMediaServer::ClientSessionIterator::~ClientSessionIterator() {
+  delete fOurIterator;
+}
+
+GenericMediaServer::ClientSession* GenericMediaServer::ClientSessionIterator::next() {
+  if (fOurIterator == NULL) return NULL;
+
+  char const* key; // dummy
+  return (ClientSession*)(fOurIterator->next(key));
+}
+
+
 ////////// UserAuthenticationDatabase implementation //////////
 
+// The digests that we precompute for each user (in "fHA1Table"), so that authenticating a request needs no
+// 'md5(<username>:<realm>:<password>)' computation:
+class UserHA1Record {
+public:
+  char fHA1MD5[DIGEST_RESPONSE_MAX_SIZE];
+  char fHA1SHA256[DIGEST_RESPONSE_MAX_SIZE]; // "" if we don't support SHA-256
+};
+
 UserAuthenticationDatabase::UserAuthenticationDatabase(char const* realm,
-						       Boolean passwordsAreMD5)
+						       Boolean passwordsAreMD5, Boolean supportsSHA256)
   : fTable(HashTable::create(STRING_HASH_KEYS)),
     fRealm(strDup(realm == NULL ? "LIVE555 Streaming Media" : realm)),
-    fPasswordsAreMD5(passwordsAreMD5) {
+    fPasswordsAreMD5(passwordsAreMD5), fSupportsSHA256(supportsSHA256 && !passwordsAreMD5),
+    fHA1Table(HashTable::create(STRING_HASH_KEYS)) {
 }
 
 UserAuthenticationDatabase::~UserAuthenticationDatabase() {
@@ -380,19 +573,50 @@ UserAuthenticationDatabase::~UserAuthenticationDatabase() {
     delete[] password;
   }
   delete fTable;
+
+  // Do the same for our precomputed digests:
+  UserHA1Record* ha1Record;
+  while ((ha1Record = (UserHA1Record*)fHA1Table->RemoveNext()) != NULL) {
+    delete ha1Record;
+  }
+  delete fHA1Table;
 }
 
 void UserAuthenticationDatabase::addUserRecord(char const* username,
 					       char const* password) {
-  fTable->Add(username, (void*)(strDup(password)));
+  delete[] (char*)(fTable->Add(username, (void*)(strDup(password))));
+
+  if (!fPasswordsAreMD5 && password != NULL) {
+    // Precompute the digest(s) that will be needed to authenticate this user:
+    UserHA1Record* ha1Record = new UserHA1Record;
+    Authenticator::computeHA1(username, fRealm, password, False, ha1Record->fHA1MD5);
+    if (fSupportsSHA256) {
+      Authenticator::computeHA1(username, fRealm, password, True, ha1Record->fHA1SHA256);
+    } else {
+      ha1Record->fHA1SHA256[0] = '\0';
+    }
+    delete (UserHA1Record*)(fHA1Table->Add(username, ha1Record));
+  }
 }
 
 void UserAuthenticationDatabase::removeUserRecord(char const* username) {
   char* password = (char*)(fTable->Lookup(username));
   fTable->Remove(username);
   delete[] password;
+
+  UserHA1Record* ha1Record = (UserHA1Record*)(fHA1Table->Lookup(username));
+  fHA1Table->Remove(username);
+  delete ha1Record;
 }
 
 char const* UserAuthenticationDatabase::lookupPassword(char const* username) {
   return (char const*)(fTable->Lookup(username));
 }
+
+char const* UserAuthenticationDatabase::lookupHA1(char const* username, Boolean forSHA256) {
+  UserHA1Record* ha1Record = (UserHA1Record*)(fHA1Table->Lookup(username));
+  if (ha1Record == NULL) return NULL;
+
+  char const* ha1 = forSHA256 ? ha1Record->fHA1SHA256 : ha1Record->fHA1MD5;
+  return ha1[0] == '\0' ? NULL : ha1;
+}
@@ -34,11 +34,13 @@ H264VideoFileServerMediaSubsession::createNew(UsageEnvironment& env,
 H264VideoFileServerMediaSubsession::H264VideoFileServerMediaSubsession(UsageEnvironment& env,
 								       char const* fileName, Boolean reuseFirstSource)
   : FileServerMediaSubsession(env, fileName, reuseFirstSource),
-    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL) {
+    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL), fHaveReadParameterSets(False),
+    fSPS(NULL), fSPSSize(0), fPPS(NULL), fPPSSize(0) {
 }
 
 H264VideoFileServerMediaSubsession::~H264VideoFileServerMediaSubsession() {
   delete[] fAuxSDPLine;
+  delete[] fSPS; delete[] fPPS;
 }
 
 static void afterPlayingDummy(void* clientData) {
@@ -82,6 +84,13 @@ void H264VideoFileServerMediaSubsession::checkForAuxSDPLine1() {
 char const* H264VideoFileServerMediaSubsession::getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
   if (fAuxSDPLine != NULL) return fAuxSDPLine; // it's already been set up (for a previous client)
 
+  // If "createNewRTPSink()" was able to read our parameter sets directly from the file, then "rtpSink" already knows them:
+  char const* asl = rtpSink->auxSDPLine();
+  if (asl != NULL) {
+    fAuxSDPLine = strDup(asl);
+    return fAuxSDPLine;
+  }
+
   if (fDummyRTPSink == NULL) { // we're not already setting it up for another, concurrent stream
     // Note: For H264 video files, the 'config' information ("profile-level-id" and "sprop-parameter-sets") isn't known
     // until we start reading the file.  This means that "rtpSink"s "auxSDPLine()" will be NULL initially,
@@ -116,5 +125,18 @@ RTPSink* H264VideoFileServerMediaSubsession
 ::createNewRTPSink(Groupsock* rtpGroupsock,
 		   unsigned char rtpPayloadTypeIfDynamic,
 		   FramedSource* /*inputSource*/) {
+  if (!fHaveReadParameterSets) {
+    // Try to read our SPS and PPS NAL units directly from (near the start of) the file.  If we can do this, then the
+    // "RTPSink" can generate our 'config' information immediately - without our having to play the file through it:
+    u_int8_t* vpsDummy; unsigned vpsDummySize;
+    readH264or5ParameterSetsFromFile(envir(), 264, fFileName, vpsDummy, vpsDummySize,
+				     fSPS, fSPSSize, fPPS, fPPSSize);
+    fHaveReadParameterSets = True;
+  }
+
+  if (fSPS != NULL && fPPS != NULL) {
+    return H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+				       fSPS, fSPSSize, fPPS, fPPSSize);
+  }
   return H264VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
 }
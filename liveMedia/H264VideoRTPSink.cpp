@@ -106,25 +106,24 @@ char const* H264VideoRTPSink::auxSDPLine() {
   u_int32_t profileLevelId = (spsWEB[1]<<16) | (spsWEB[2]<<8) | spsWEB[3];
   delete[] spsWEB;
 
-  char* sps_base64 = base64Encode((char*)sps, spsSize);
-  char* pps_base64 = base64Encode((char*)pps, ppsSize);
-
+  // Base-64 encode the SPS and PPS directly into the line (rather than into separately-allocated strings):
   char const* fmtpFmt =
     "a=fmtp:%d packetization-mode=1"
     ";profile-level-id=%06X"
-    ";sprop-parameter-sets=%s,%s\r\n";
-  unsigned fmtpFmtSize = strlen(fmtpFmt)
+    ";sprop-parameter-sets=";
+  unsigned fmtpSize = strlen(fmtpFmt)
     + 3 /* max char len */
     + 6 /* 3 bytes in hex */
-    + strlen(sps_base64) + strlen(pps_base64);
-  char* fmtp = new char[fmtpFmtSize];
-  sprintf(fmtp, fmtpFmt,
-          rtpPayloadType(),
-	  profileLevelId,
-          sps_base64, pps_base64);
-
-  delete[] sps_base64;
-  delete[] pps_base64;
+    + base64EncodedLength(spsSize) + 1/*','*/ + base64EncodedLength(ppsSize) + 2/*"\r\n"*/ + 1/*'\0'*/;
+  char* fmtp = new char[fmtpSize];
+  char* s = fmtp;
+  s += sprintf(s, fmtpFmt,
+	       rtpPayloadType(),
+	       profileLevelId);
+  s += base64EncodeInto((char*)sps, spsSize, s);
+  *s++ = ',';
+  s += base64EncodeInto((char*)pps, ppsSize, s);
+  strcpy(s, "\r\n");
 
   delete[] fFmtpSDPLine; fFmtpSDPLine = fmtp;
   return fFmtpSDPLine;
@@ -37,6 +37,8 @@ public:
   virtual ~H264or5Fragmenter();
 
   Boolean lastFragmentCompletedNALUnit() const { return fLastFragmentCompletedNALUnit; }
+  void setDropLevel(unsigned level) { fDropLevel = level; }
+  unsigned numNALUnitsDropped() const { return fNumNALUnitsDropped; }
 
 private: // redefined virtual functions:
   virtual void doGetNextFrame();
@@ -52,6 +54,8 @@ private:
                           struct timeval presentationTime,
                           unsigned durationInMicroseconds);
   void reset();
+  Boolean shouldDropNALUnit(u_int8_t const* nalUnit, unsigned nalUnitSize, struct timeval const& presentationTime);
+  static void getNextNALUnit(void* clientData);
 
 private:
   int fHNumber;
@@ -62,6 +66,10 @@ private:
   unsigned fCurDataOffset;
   unsigned fSaveNumTruncatedBytes;
   Boolean fLastFragmentCompletedNALUnit;
+  unsigned fDropLevel; // see "H264or5VideoRTPSink::setFrameDropLevel()"
+  Boolean fWaitingForKeyFrame, fDroppingRASLPictures;
+  struct timeval fWaitingForKeyFrameSince; // the presentation time of the reference picture that we dropped
+  unsigned fNumNALUnitsDropped;
 };
 
 
@@ -74,7 +82,7 @@ H264or5VideoRTPSink
 		      u_int8_t const* sps, unsigned spsSize,
 		      u_int8_t const* pps, unsigned ppsSize)
   : VideoRTPSink(env, RTPgs, rtpPayloadFormat, 90000, hNumber == 264 ? "H264" : "H265"),
-    fHNumber(hNumber), fOurFragmenter(NULL), fFmtpSDPLine(NULL) {
+    fHNumber(hNumber), fOurFragmenter(NULL), fFrameDropLevel(0), fFmtpSDPLine(NULL) {
   if (vps != NULL) {
     fVPSSize = vpsSize;
     fVPS = new u_int8_t[fVPSSize];
@@ -112,12 +120,24 @@ H264or5VideoRTPSink::~H264or5VideoRTPSink() {
   fSource = NULL; // for the base class destructor, which gets called next
 }
 
+Boolean H264or5VideoRTPSink::setFrameDropLevel(unsigned level) {
+  fFrameDropLevel = level;
+  if (fOurFragmenter != NULL) ((H264or5Fragmenter*)fOurFragmenter)->setDropLevel(level);
+
+  return True;
+}
+
+unsigned H264or5VideoRTPSink::numNALUnitsDropped() const {
+  return fOurFragmenter == NULL ? 0 : ((H264or5Fragmenter*)fOurFragmenter)->numNALUnitsDropped();
+}
+
 Boolean H264or5VideoRTPSink::continuePlaying() {
   // First, check whether we have a 'fragmenter' class set up yet.
   // If not, create it now:
   if (fOurFragmenter == NULL) {
     fOurFragmenter = new H264or5Fragmenter(fHNumber, envir(), fSource, OutPacketBuffer::maxSize,
 					   ourMaxPacketSize() - 12/*RTP hdr size*/);
+    ((H264or5Fragmenter*)fOurFragmenter)->setDropLevel(fFrameDropLevel);
   } else {
     fOurFragmenter->reassignInputSource(fSource);
   }
@@ -163,7 +183,9 @@ H264or5Fragmenter::H264or5Fragmenter(int hNumber,
 				     unsigned inputBufferMax, unsigned maxOutputPacketSize)
   : FramedFilter(env, inputSource),
     fHNumber(hNumber),
-    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize) {
+    fInputBufferSize(inputBufferMax+1), fMaxOutputPacketSize(maxOutputPacketSize),
+    fDropLevel(0), fWaitingForKeyFrame(False), fDroppingRASLPictures(False), fNumNALUnitsDropped(0) {
+  fWaitingForKeyFrameSince.tv_sec = fWaitingForKeyFrameSince.tv_usec = 0;
   fInputBuffer = new unsigned char[fInputBufferSize];
   reset();
 }
@@ -283,6 +305,18 @@ void H264or5Fragmenter::afterGettingFrame1(unsigned frameSize,
 					   unsigned numTruncatedBytes,
 					   struct timeval presentationTime,
 					   unsigned durationInMicroseconds) {
+  if (frameSize > 0 && shouldDropNALUnit(&fInputBuffer[1], frameSize, presentationTime)) {
+    ++fNumNALUnitsDropped;
+
+    // Don't let the 'end of picture' of a dropped NAL unit set the RTP 'M' bit on the next NAL unit that we deliver:
+    ((H264or5VideoStreamFramer*)fInputSource)->pictureEndMarker() = False;
+
+    // Read another NAL unit instead.  (We do this via the event loop, to avoid unbounded recursion if our input source
+    // delivers many - dropped - NAL units without blocking.)
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, getNextNALUnit, this);
+    return;
+  }
+
   fNumValidDataBytes += frameSize;
   fSaveNumTruncatedBytes = numTruncatedBytes;
   fPresentationTime = presentationTime;
@@ -292,6 +326,98 @@ void H264or5Fragmenter::afterGettingFrame1(unsigned frameSize,
   doGetNextFrame();
 }
 
+// If we've dropped a reference picture, but haven't seen a key picture for this long (in presentation time), then we
+// resume sending anyway (at the start of the next picture), rather than freeze the stream for a long GOP:
+#define MAX_WAIT_FOR_KEY_FRAME_SECONDS 2
+
+static Boolean hasRecoveryPointSEI(int hNumber, u_int8_t const* nalUnit, unsigned nalUnitSize) {
+  // Checks whether a SEI NAL unit contains a 'recovery point' message - i.e., whether the following picture is one that
+  // a decoder can (gradually) start decoding from, even though it's not a key picture:
+  u_int8_t sei[1000];
+  unsigned seiSize = removeH264or5EmulationBytes(sei, sizeof sei, nalUnit, nalUnitSize);
+
+  unsigned j = hNumber == 264 ? 1 : 2; // skip the NAL unit header
+  while (j < seiSize) {
+    unsigned payloadType = 0;
+    do {
+      payloadType += sei[j];
+    } while (sei[j++] == 255 && j < seiSize);
+    if (j >= seiSize) break;
+
+    unsigned payloadSize = 0;
+    do {
+      payloadSize += sei[j];
+    } while (sei[j++] == 255 && j < seiSize);
+
+    if (payloadType == 6/*recovery_point*/) return True;
+    j += payloadSize;
+  }
+
+  return False;
+}
+
+Boolean H264or5Fragmenter
+::shouldDropNALUnit(u_int8_t const* nalUnit, unsigned nalUnitSize, struct timeval const& presentationTime) {
+  Boolean isVCL, isKeyFrame, isReference, isRASL = False, isSEI, startsPicture;
+  if (fHNumber == 264) {
+    u_int8_t nal_unit_type = nalUnit[0]&0x1F;
+    isVCL = nal_unit_type >= 1 && nal_unit_type <= 5;
+    isKeyFrame = nal_unit_type == 5; // IDR
+    isReference = (nalUnit[0]&0x60) != 0; // nal_ref_idc
+    isSEI = nal_unit_type == 6;
+    startsPicture = nalUnitSize > 1 && (nalUnit[1]&0x80) != 0; // first_mb_in_slice == 0
+  } else { // 265
+    u_int8_t nal_unit_type = (nalUnit[0]&0x7E)>>1;
+    isVCL = nal_unit_type <= 31;
+    isKeyFrame = nal_unit_type >= 16 && nal_unit_type <= 23; // IRAP
+    isReference = !(nal_unit_type <= 14 && nal_unit_type%2 == 0); // not a 'sub-layer non-reference' picture
+    isRASL = nal_unit_type == 8 || nal_unit_type == 9;
+    isSEI = nal_unit_type == 39; // prefix SEI
+    startsPicture = nalUnitSize > 2 && (nalUnit[2]&0x80) != 0; // first_slice_segment_in_pic_flag
+  }
+
+  if (!isVCL) {
+    if (isSEI && fWaitingForKeyFrame && hasRecoveryPointSEI(fHNumber, nalUnit, nalUnitSize)) {
+      // We can resume sending at the next picture (a 'recovery point'), without waiting for a key picture:
+      fWaitingForKeyFrame = False;
+    }
+    return False;
+  }
+  if (isKeyFrame) {
+    // If we start again at a (H.265) CRA picture, then its RASL pictures would refer to pictures that we've dropped:
+    fDroppingRASLPictures = fWaitingForKeyFrame;
+    fWaitingForKeyFrame = False;
+    return False;
+  }
+  if (isRASL && fDroppingRASLPictures) return True;
+  fDroppingRASLPictures = False;
+
+  if (fWaitingForKeyFrame) {
+    // Keep waiting for a key picture - unless we've already waited too long, and we'd otherwise be sending this picture:
+    long secondsWaited = presentationTime.tv_sec - fWaitingForKeyFrameSince.tv_sec;
+    if (presentationTime.tv_usec < fWaitingForKeyFrameSince.tv_usec) --secondsWaited;
+    if (fDropLevel >= 2 || !startsPicture || secondsWaited < MAX_WAIT_FOR_KEY_FRAME_SECONDS) return True;
+    fWaitingForKeyFrame = False;
+  }
+  if (fDropLevel >= 2 || (fDropLevel == 1 && !isReference)) {
+    // If we drop a reference picture, then we can't resume sending (non-key) pictures until the next key picture
+    // (or a 'recovery point'):
+    if (isReference) {
+      fWaitingForKeyFrame = True;
+      fWaitingForKeyFrameSince = presentationTime;
+    }
+    return True;
+  }
+
+  return False;
+}
+
+void H264or5Fragmenter::getNextNALUnit(void* clientData) {
+  H264or5Fragmenter* fragmenter = (H264or5Fragmenter*)clientData;
+  fragmenter->nextTask() = NULL;
+  fragmenter->doGetNextFrame();
+}
+
 void H264or5Fragmenter::reset() {
   fNumValidDataBytes = fCurDataOffset = 1;
   fSaveNumTruncatedBytes = 0;
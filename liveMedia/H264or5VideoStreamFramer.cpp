@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "H264or5VideoStreamFramer.hh"
 #include "MPEGVideoStreamParser.hh"
 #include "BitVector.hh"
+#include "InputFile.hh"
 
 ////////// H264or5VideoStreamParser definition //////////
 
@@ -1178,3 +1179,114 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 
   return toSize;
 }
+
+static void saveFirstParameterSet(u_int8_t*& to, unsigned& toSize, u_int8_t const* from, unsigned fromSize) {
+  if (to != NULL || fromSize == 0) return; // we've already seen one of these
+
+  to = new u_int8_t[fromSize];
+  memmove(to, from, fromSize);
+  toSize = fromSize;
+}
+
+static Boolean noteParameterSet(int hNumber, u_int8_t const* nal, unsigned nalSize,
+				u_int8_t*& vps, unsigned& vpsSize,
+				u_int8_t*& sps, unsigned& spsSize,
+				u_int8_t*& pps, unsigned& ppsSize) {
+  // Saves "nal" if it's a parameter set that we haven't already seen.
+  // Returns True iff we've now seen all of the parameter sets that we need.
+  if (nalSize > 0) {
+    if (hNumber == 264) {
+      u_int8_t nal_unit_type = nal[0]&0x1F;
+      if (nal_unit_type == 7) saveFirstParameterSet(sps, spsSize, nal, nalSize);
+      else if (nal_unit_type == 8) saveFirstParameterSet(pps, ppsSize, nal, nalSize);
+    } else {
+      u_int8_t nal_unit_type = (nal[0]&0x7E)>>1;
+      if (nal_unit_type == 32) saveFirstParameterSet(vps, vpsSize, nal, nalSize);
+      else if (nal_unit_type == 33) saveFirstParameterSet(sps, spsSize, nal, nalSize);
+      else if (nal_unit_type == 34) saveFirstParameterSet(pps, ppsSize, nal, nalSize);
+    }
+  }
+
+  return (hNumber == 264 || vps != NULL) && sps != NULL && pps != NULL;
+}
+
+Boolean readH264or5ParameterSetsFromFile(UsageEnvironment& env, int hNumber, char const* fileName,
+					 u_int8_t*& vps, unsigned& vpsSize,
+					 u_int8_t*& sps, unsigned& spsSize,
+					 u_int8_t*& pps, unsigned& ppsSize,
+					 unsigned maxBytesToRead) {
+  vps = sps = pps = NULL;
+  vpsSize = spsSize = ppsSize = 0;
+
+  FILE* fid = OpenInputFile(env, fileName);
+  if (fid == NULL) return False;
+
+  // Read the file in small chunks, stopping as soon as we've seen all of the NAL units that we need.
+  // (A NAL unit ends at the next start code (or at the end of the file), so we scan each chunk for start codes
+  //  as it arrives, and examine each NAL unit once we've found the start code that follows it.)
+  // The parameter sets are usually in the first chunk, so we grow our buffer (up to "maxBytesToRead") only as needed:
+  unsigned const chunkSize = 4096;
+  unsigned bufMaxSize = chunkSize < maxBytesToRead ? chunkSize : maxBytesToRead;
+  u_int8_t* buf = new u_int8_t[bufMaxSize];
+  unsigned bufSize = 0;
+  unsigned scanPos = 0; // the next position in "buf" to check for a start code
+  unsigned nalStart = 0; // the start of the current NAL unit (valid iff "haveNAL")
+  Boolean haveNAL = False;
+  Boolean haveAll = False;
+  Boolean atEOF = False;
+
+  while (!haveAll && !atEOF && bufSize < maxBytesToRead) {
+    if (bufSize == bufMaxSize) {
+      // Double the size of our buffer (but not beyond "maxBytesToRead"):
+      unsigned newBufMaxSize = 2*bufMaxSize < maxBytesToRead ? 2*bufMaxSize : maxBytesToRead;
+      u_int8_t* newBuf = new u_int8_t[newBufMaxSize];
+      memmove(newBuf, buf, bufSize);
+      delete[] buf;
+      buf = newBuf; bufMaxSize = newBufMaxSize;
+    }
+
+    unsigned numBytesToRead = bufMaxSize - bufSize;
+    if (numBytesToRead > chunkSize) numBytesToRead = chunkSize;
+    unsigned numBytesRead = fread(&buf[bufSize], 1, numBytesToRead, fid);
+    if (numBytesRead == 0) atEOF = True;
+    bufSize += numBytesRead;
+
+    while (!haveAll) {
+      if (scanPos + 3 > bufSize) {
+	// We need more data - unless we're at the end of the file, which ends the current NAL unit:
+	if (atEOF && haveNAL) {
+	  haveAll = noteParameterSet(hNumber, &buf[nalStart], bufSize - nalStart,
+				     vps, vpsSize, sps, spsSize, pps, ppsSize);
+	  haveNAL = False;
+	}
+	break;
+      }
+
+      if (!(buf[scanPos] == 0 && buf[scanPos+1] == 0 && buf[scanPos+2] == 1)) {
+	++scanPos;
+	continue;
+      }
+
+      // We found a start code.  It ends the current NAL unit (if any), minus any zero bytes that precede it:
+      if (haveNAL) {
+	unsigned nalEnd = scanPos;
+	while (nalEnd > nalStart && buf[nalEnd-1] == 0) --nalEnd;
+	haveAll = noteParameterSet(hNumber, &buf[nalStart], nalEnd - nalStart,
+				   vps, vpsSize, sps, spsSize, pps, ppsSize);
+      }
+      scanPos += 3;
+      nalStart = scanPos;
+      haveNAL = True;
+    }
+  }
+
+  delete[] buf;
+  CloseInputFile(fid);
+
+  if (!haveAll) {
+    delete[] vps; delete[] sps; delete[] pps;
+    vps = sps = pps = NULL;
+    vpsSize = spsSize = ppsSize = 0;
+  }
+  return haveAll;
+}
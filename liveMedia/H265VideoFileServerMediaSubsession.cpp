@@ -34,11 +34,13 @@ H265VideoFileServerMediaSubsession::createNew(UsageEnvironment& env,
 H265VideoFileServerMediaSubsession::H265VideoFileServerMediaSubsession(UsageEnvironment& env,
 								       char const* fileName, Boolean reuseFirstSource)
   : FileServerMediaSubsession(env, fileName, reuseFirstSource),
-    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL) {
+    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL), fHaveReadParameterSets(False),
+    fVPS(NULL), fVPSSize(0), fSPS(NULL), fSPSSize(0), fPPS(NULL), fPPSSize(0) {
 }
 
 H265VideoFileServerMediaSubsession::~H265VideoFileServerMediaSubsession() {
   delete[] fAuxSDPLine;
+  delete[] fVPS; delete[] fSPS; delete[] fPPS;
 }
 
 static void afterPlayingDummy(void* clientData) {
@@ -82,6 +84,13 @@ void H265VideoFileServerMediaSubsession::checkForAuxSDPLine1() {
 char const* H265VideoFileServerMediaSubsession::getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
   if (fAuxSDPLine != NULL) return fAuxSDPLine; // it's already been set up (for a previous client)
 
+  // If "createNewRTPSink()" was able to read our parameter sets directly from the file, then "rtpSink" already knows them:
+  char const* asl = rtpSink->auxSDPLine();
+  if (asl != NULL) {
+    fAuxSDPLine = strDup(asl);
+    return fAuxSDPLine;
+  }
+
   if (fDummyRTPSink == NULL) { // we're not already setting it up for another, concurrent stream
     // Note: For H265 video files, the 'config' information (used for several payload-format
     // specific parameters in the SDP description) isn't known until we start reading the file.
@@ -117,5 +126,17 @@ RTPSink* H265VideoFileServerMediaSubsession
 ::createNewRTPSink(Groupsock* rtpGroupsock,
 		   unsigned char rtpPayloadTypeIfDynamic,
 		   FramedSource* /*inputSource*/) {
+  if (!fHaveReadParameterSets) {
+    // Try to read our VPS, SPS and PPS NAL units directly from (near the start of) the file.  If we can do this, then the
+    // "RTPSink" can generate our 'config' information immediately - without our having to play the file through it:
+    readH264or5ParameterSetsFromFile(envir(), 265, fFileName, fVPS, fVPSSize,
+				     fSPS, fSPSSize, fPPS, fPPSSize);
+    fHaveReadParameterSets = True;
+  }
+
+  if (fVPS != NULL && fSPS != NULL && fPPS != NULL) {
+    return H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic,
+				       fVPS, fVPSSize, fSPS, fSPSSize, fPPS, fPPSSize);
+  }
   return H265VideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic);
 }
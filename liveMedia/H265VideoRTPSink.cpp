@@ -140,42 +140,35 @@ char const* H265VideoRTPSink::auxSDPLine() {
 	  interop_constraints[3], interop_constraints[4], interop_constraints[5]);
   delete[] vpsWEB;
 
-  char* sprop_vps = base64Encode((char*)vps, vpsSize);
-  char* sprop_sps = base64Encode((char*)sps, spsSize);
-  char* sprop_pps = base64Encode((char*)pps, ppsSize);
-
+  // Base-64 encode the VPS, SPS and PPS directly into the line (rather than into separately-allocated strings):
   char const* fmtpFmt =
     "a=fmtp:%d profile-space=%u"
     ";profile-id=%u"
     ";tier-flag=%u"
     ";level-id=%u"
-    ";interop-constraints=%s"
-    ";sprop-vps=%s"
-    ";sprop-sps=%s"
-    ";sprop-pps=%s\r\n";
-  unsigned fmtpFmtSize = strlen(fmtpFmt)
+    ";interop-constraints=%s";
+  unsigned fmtpSize = strlen(fmtpFmt)
     + 3 /* max num chars: rtpPayloadType */ + 20 /* max num chars: profile_space */
     + 20 /* max num chars: profile_id */
     + 20 /* max num chars: tier_flag */
     + 20 /* max num chars: level_id */
     + strlen(interopConstraintsStr)
-    + strlen(sprop_vps)
-    + strlen(sprop_sps)
-    + strlen(sprop_pps);
-  char* fmtp = new char[fmtpFmtSize];
-  sprintf(fmtp, fmtpFmt,
-          rtpPayloadType(), profileSpace,
-	  profileId,
-	  tierFlag,
-	  levelId,
-	  interopConstraintsStr,
-	  sprop_vps,
-	  sprop_sps,
-	  sprop_pps);
-
-  delete[] sprop_vps;
-  delete[] sprop_sps;
-  delete[] sprop_pps;
+    + strlen(";sprop-vps=") + base64EncodedLength(vpsSize)
+    + strlen(";sprop-sps=") + base64EncodedLength(spsSize)
+    + strlen(";sprop-pps=") + base64EncodedLength(ppsSize)
+    + 2/*"\r\n"*/ + 1/*'\0'*/;
+  char* fmtp = new char[fmtpSize];
+  char* s = fmtp;
+  s += sprintf(s, fmtpFmt,
+	       rtpPayloadType(), profileSpace,
+	       profileId,
+	       tierFlag,
+	       levelId,
+	       interopConstraintsStr);
+  s += sprintf(s, ";sprop-vps="); s += base64EncodeInto((char*)vps, vpsSize, s);
+  s += sprintf(s, ";sprop-sps="); s += base64EncodeInto((char*)sps, spsSize, s);
+  s += sprintf(s, ";sprop-pps="); s += base64EncodeInto((char*)pps, ppsSize, s);
+  strcpy(s, "\r\n");
 
   delete[] fFmtpSDPLine; fFmtpSDPLine = fmtp;
   return fFmtpSDPLine;
@@ -0,0 +1,939 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A sink that packages a live "ServerMediaSession" as a sliding window of HLS segments (and partial segments)
+// Implementation
+
+#include "HLSLiveSegmenter.hh"
+#include "MediaSession.hh"
+#include "MPEG2TransportStreamFromESSource.hh"
+#include "H264VideoRTPSource.hh" // for "parseSPropParameterSets()"
+#include "MPEG4LATMAudioRTPSource.hh" // for "parseGeneralConfigStr()"
+#include "GroupsockHelper.hh" // for "our_random32()", "increaseReceiveBufferTo()" and "gettimeofday()"
+
+#define TRANSPORT_PACKET_SIZE 188
+#define PTS_FREQUENCY 90000
+#define PTS_MASK 0x1FFFFFFFFULL // PTSs are 33 bits
+
+#ifndef HLS_LIVE_MAX_UNSTARTED_DATA_SIZE
+#define HLS_LIVE_MAX_UNSTARTED_DATA_SIZE 4000000
+#endif
+    // The maximum number of bytes that we hold while waiting for the first key frame.  (This can be exceeded only if the
+    // stream's video never starts.)
+
+////////// Internal classes //////////
+
+// A complete partial segment:
+class HLSLivePart {
+public:
+  HLSLivePart(HLSCachedSegment* data, double duration, Boolean isIndependent)
+    : fData(data), fDuration(duration), fIsIndependent(isIndependent), fNext(NULL) {
+  }
+
+  HLSCachedSegment* fData;
+  double fDuration;
+  Boolean fIsIndependent; // True iff the part begins with a key frame
+  HLSLivePart* fNext;
+};
+
+// A complete segment:
+class HLSLiveSegment {
+public:
+  HLSLiveSegment(unsigned mediaSequenceNumber, double duration, HLSCachedSegment* data,
+		 HLSLivePart* parts, unsigned numParts)
+    : fMediaSequenceNumber(mediaSequenceNumber), fDuration(duration), fData(data),
+      fParts(parts), fNumParts(numParts), fNext(NULL) {
+  }
+
+  unsigned fMediaSequenceNumber;
+  double fDuration;
+  HLSCachedSegment* fData;
+  HLSLivePart* fParts; // NULL if we no longer hold (or never generated) partial segments for this segment
+  unsigned fNumParts;
+  HLSLiveSegment* fNext;
+};
+
+class HLSLiveWaiter {
+public:
+  HLSLiveWaiter(HLSLiveSegmenter::afterPlaylistChangeFunc* func, void* clientData, HLSLiveWaiter* next)
+    : fFunc(func), fClientData(clientData), fNext(next) {
+  }
+
+  HLSLiveSegmenter::afterPlaylistChangeFunc* fFunc;
+  void* fClientData;
+  HLSLiveWaiter* fNext;
+};
+
+// A filter that prepares the H.264 or H.265 NAL units from a "RTPSource" for our Transport Stream multiplexor: It adds a
+// 'start code' to each NAL unit, and inserts the parameter sets (from the SDP description) before each key frame that's not
+// already preceded by them - so that each segment can be decoded on its own.  NAL units are dropped until the source's
+// presentation times have been synchronized using RTCP (because until then, they may jump).
+
+class HLSLiveVideoFramer: public FramedFilter {
+public:
+  HLSLiveVideoFramer(UsageEnvironment& env, RTPSource* inputSource, Boolean isH265, MediaSubsession& subsession);
+
+private:
+  virtual ~HLSLiveVideoFramer();
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+                                unsigned numTruncatedBytes,
+                                struct timeval presentationTime,
+                                unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes, struct timeval presentationTime);
+
+  void addParameterSets(char const* sPropStr);
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  Boolean fIsH265;
+  u_int8_t* fParameterSets; // each preceded by a 'start code'
+  unsigned fParameterSetsSize;
+  Boolean fSawParameterSets; // since the most recent access unit
+  struct timeval fLastVCLPresentationTime;
+};
+
+// A filter that adds an ADTS header - constructed from the SDP description's "config" parameter - to each AAC frame from a
+// "RTPSource".  (As above, frames are dropped until the source has been synchronized using RTCP.)
+
+class HLSLiveADTSFramer: public FramedFilter {
+public:
+  static HLSLiveADTSFramer* createNew(UsageEnvironment& env, RTPSource* inputSource, char const* configStr);
+      // returns NULL if "configStr" is not a (simple) AAC 'AudioSpecificConfig'
+
+private:
+  HLSLiveADTSFramer(UsageEnvironment& env, RTPSource* inputSource,
+		    u_int8_t profile, u_int8_t samplingFrequencyIndex, u_int8_t channelConfiguration);
+  virtual ~HLSLiveADTSFramer();
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+                                unsigned numTruncatedBytes,
+                                struct timeval presentationTime,
+                                unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes, struct timeval presentationTime);
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  u_int8_t fProfile, fSamplingFrequencyIndex, fChannelConfiguration;
+};
+
+#define ADTS_HEADER_SIZE 7
+
+
+////////// HLSLiveSegmenter implementation //////////
+
+HLSLiveSegmenter* HLSLiveSegmenter::createNew(UsageEnvironment& env, ServerMediaSession& session,
+					      unsigned targetDuration, unsigned partTargetDurationInMs,
+					      unsigned numSegmentsInPlaylist) {
+  HLSLiveSegmenter* segmenter
+    = new HLSLiveSegmenter(env, session, targetDuration, partTargetDurationInMs, numSegmentsInPlaylist);
+  if (!segmenter->setUpInputs()) {
+    Medium::close(segmenter);
+    return NULL;
+  }
+
+  return segmenter;
+}
+
+HLSLiveSegmenter::HLSLiveSegmenter(UsageEnvironment& env, ServerMediaSession& session,
+				   unsigned targetDuration, unsigned partTargetDurationInMs, unsigned numSegmentsInPlaylist)
+  : MediaSink(env),
+    fSession(session), fTargetDuration(targetDuration == 0 ? 1 : targetDuration),
+    fNumSegmentsInPlaylist(numSegmentsInPlaylist < 3 ? 3 : numSegmentsInPlaylist),
+    fPartTargetDuration(partTargetDurationInMs/1000.0), fMaxSeenDuration(0), fIsClosing(False),
+    fClientSessionId(0), fMediaSession(NULL), fMultiplexor(NULL), fNumInputs(0),
+    fServerSubsessions(NULL), fStreamTokens(NULL), fInputFilters(NULL),
+    fPATContinuityCounter(0), fPMTContinuityCounter(0),
+    fHavePAT(False), fHavePMT(False), fPMT_PID(0), fVideoPID(0), fAudioPID(0), fVideoIsH265(False),
+    fHaveLastVideoPTS(False), fLastVideoPTS(0),
+    fAUPTS(0), fAUStartOffset(0), fAUIsKey(False), fLastAccessUnitInterval(0),
+    fHaveStarted(False), fSegmentStartPTS(0), fPartStartPTS(0), fCurrentMediaSequenceNumber(0),
+    fSegments(NULL), fLastSegment(NULL), fNumSegments(0),
+    fCurrentParts(NULL), fLastCurrentPart(NULL), fNumCurrentParts(0), fCurrentPartIsIndependent(False),
+    fPartBuffer(NULL), fPartBufferSize(0), fPartBufferMaxSize(0), fWaiters(NULL) {
+  gettimeofday(&fLastActivityTime, NULL);
+}
+
+HLSLiveSegmenter::~HLSLiveSegmenter() {
+  // Tell anyone who's waiting for our playlist to change that we're going away:
+  fIsClosing = True;
+  notifyWaiters();
+
+  stopPlaying();
+
+  // Stop our session's server from sending to us:
+  for (unsigned i = 0; i < fNumInputs; ++i) {
+    fServerSubsessions[i]->deleteStream(fClientSessionId, fStreamTokens[i]);
+  }
+
+  // Close our multiplexor (and our input filters), but not the "RTPSource"s that they read from; these belong to
+  // "fMediaSession":
+  for (unsigned i = 0; i < fNumInputs; ++i) fInputFilters[i]->detachInputSource();
+  Medium::close(fMultiplexor);
+  Medium::close(fMediaSession);
+
+  delete[] fServerSubsessions; delete[] fStreamTokens; delete[] fInputFilters;
+
+  while (fSegments != NULL) {
+    HLSLiveSegment* segment = fSegments;
+    fSegments = segment->fNext;
+    deleteSegment(segment);
+  }
+  deleteParts(fCurrentParts);
+  delete[] fPartBuffer;
+}
+
+Boolean HLSLiveSegmenter::setUpInputs() {
+  // Create RTP receivers for our session's subsessions, from its SDP description (just as a RTSP client would):
+  char* sdpDescription = fSession.generateSDPDescription();
+  if (sdpDescription == NULL) return False;
+  fMediaSession = MediaSession::createNew(envir(), sdpDescription);
+  delete[] sdpDescription;
+  if (fMediaSession == NULL) return False;
+
+  unsigned numSubsessions = 0;
+  ServerMediaSubsessionIterator serverIter(fSession);
+  while (serverIter.next() != NULL) ++numSubsessions;
+  fServerSubsessions = new ServerMediaSubsession*[numSubsessions];
+  fStreamTokens = new void*[numSubsessions];
+  fInputFilters = new FramedFilter*[numSubsessions];
+
+  fMultiplexor = MPEG2TransportStreamFromESSource::createNew(envir());
+  fMultiplexor->setOneFramePerPESPacket(); // so that we can split the stream at any frame
+
+  do { fClientSessionId = our_random32(); } while (fClientSessionId == 0);
+  netAddressBits const loopbackAddress = htonl(0x7F000001);
+  Boolean haveVideo = False, haveAudio = False;
+
+  // The subsessions in the SDP description are in the same order as our session's subsessions:
+  MediaSubsessionIterator iter(*fMediaSession);
+  MediaSubsession* subsession;
+  serverIter.reset();
+  ServerMediaSubsession* serverSubsession;
+  while ((subsession = iter.next()) != NULL && (serverSubsession = serverIter.next()) != NULL) {
+    // We can segment (one) H.264 or H.265 video, and (one) AAC audio, subsession:
+    Boolean isVideo = False, isH265 = False;
+    if (strcmp(subsession->mediumName(), "video") == 0) {
+      if (haveVideo) continue;
+      if (strcmp(subsession->codecName(), "H264") == 0) {
+	isVideo = True;
+      } else if (strcmp(subsession->codecName(), "H265") == 0) {
+	isVideo = isH265 = True;
+      } else {
+	continue;
+      }
+    } else if (strcmp(subsession->mediumName(), "audio") == 0) {
+      if (haveAudio) continue;
+      char const* mode = subsession->attrVal_str("mode");
+      if (strcmp(subsession->codecName(), "MPEG4-GENERIC") != 0 || strncmp(mode, "AAC", 3) != 0
+	  || subsession->fmtp_config() == NULL) continue;
+    } else {
+      continue;
+    }
+
+    if (!subsession->initiate()) continue;
+
+    // Have our session's server send this subsession's RTP (and RTCP) packets to our receivers:
+    Port clientRTPPort(subsession->clientPortNum()), clientRTCPPort(subsession->clientPortNum()+1);
+    Port serverRTPPort(0), serverRTCPPort(0);
+    netAddressBits destinationAddress = 0;
+    u_int8_t destinationTTL = 255;
+    Boolean isMulticast = False;
+    void* streamToken = NULL;
+    serverSubsession->getStreamParameters(fClientSessionId, loopbackAddress, clientRTPPort, clientRTCPPort, -1, 0, 0,
+					  destinationAddress, destinationTTL, isMulticast,
+					  serverRTPPort, serverRTCPPort, streamToken);
+    if (streamToken == NULL || isMulticast) {
+      // We can't receive this subsession (e.g., because it's multicast):
+      if (streamToken != NULL) serverSubsession->deleteStream(fClientSessionId, streamToken);
+      subsession->deInitiate();
+      continue;
+    }
+    subsession->serverPortNum = ntohs(serverRTPPort.num());
+    subsession->setDestinations(loopbackAddress); // for our RTCP "RR"s
+
+    FramedFilter* inputFilter;
+    if (isVideo) {
+      increaseReceiveBufferTo(envir(), subsession->rtpSource()->RTPgs()->socketNum(), 2000000);
+      inputFilter = new HLSLiveVideoFramer(envir(), subsession->rtpSource(), isH265, *subsession);
+      fMultiplexor->addNewVideoSource(inputFilter, isH265 ? 6 : 5);
+      haveVideo = True;
+    } else {
+      inputFilter = HLSLiveADTSFramer::createNew(envir(), subsession->rtpSource(), subsession->fmtp_config());
+      if (inputFilter == NULL) {
+	serverSubsession->deleteStream(fClientSessionId, streamToken);
+	subsession->deInitiate();
+	continue;
+      }
+      fMultiplexor->addNewAudioSource(inputFilter, 4);
+      haveAudio = True;
+    }
+
+    fServerSubsessions[fNumInputs] = serverSubsession;
+    fStreamTokens[fNumInputs] = streamToken;
+    fInputFilters[fNumInputs] = inputFilter;
+    ++fNumInputs;
+  }
+  if (fNumInputs == 0) return False;
+
+  // Start the streams, and start reading from our multiplexor:
+  for (unsigned i = 0; i < fNumInputs; ++i) {
+    unsigned short rtpSeqNum; unsigned rtpTimestamp;
+    fServerSubsessions[i]->startStream(fClientSessionId, fStreamTokens[i], NULL, NULL, rtpSeqNum, rtpTimestamp,
+				       NULL, NULL);
+  }
+
+  return startPlaying(*fMultiplexor, NULL, NULL);
+}
+
+char* HLSLiveSegmenter::generatePlaylist(char const* streamName) {
+  if (fNumSegments == 0) return NULL;
+
+  // Figure out which segments to list (the most recent "fNumSegmentsInPlaylist"), and how big the playlist can be:
+  HLSLiveSegment* firstSegment = fSegments;
+  for (unsigned i = fNumSegments; i > fNumSegmentsInPlaylist; --i) firstSegment = firstSegment->fNext;
+  unsigned numLines = 10 + fNumCurrentParts;
+  for (HLSLiveSegment* segment = firstSegment; segment != NULL; segment = segment->fNext) {
+    numLines += 2 + (segment->fParts == NULL ? 0 : segment->fNumParts);
+  }
+  unsigned const maxLineLength = 100 + strlen(streamName);
+  char* playlist = new char[numLines*maxLineLength];
+  char* s = playlist;
+
+  unsigned targetDuration = fMaxSeenDuration > fTargetDuration ? fMaxSeenDuration : fTargetDuration;
+  sprintf(s,
+	  "#EXTM3U\r\n"
+	  "#EXT-X-VERSION:6\r\n"
+	  "#EXT-X-TARGETDURATION:%u\r\n",
+	  targetDuration);
+  s += strlen(s);
+  if (fPartTargetDuration > 0.0) {
+    sprintf(s,
+	    "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\r\n"
+	    "#EXT-X-PART-INF:PART-TARGET=%.3f\r\n",
+	    3*fPartTargetDuration, fPartTargetDuration);
+  } else {
+    sprintf(s, "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES\r\n");
+  }
+  s += strlen(s);
+  sprintf(s, "#EXT-X-MEDIA-SEQUENCE:%u\r\n", firstSegment->fMediaSequenceNumber);
+  s += strlen(s);
+
+  for (HLSLiveSegment* segment = firstSegment; segment != NULL; segment = segment->fNext) {
+    unsigned partNumber = 0;
+    for (HLSLivePart* part = segment->fParts; part != NULL; part = part->fNext) {
+      sprintf(s, "#EXT-X-PART:DURATION=%.3f,URI=\"%s?seq=%u.%u\"%s\r\n",
+	      part->fDuration, streamName, segment->fMediaSequenceNumber, partNumber++,
+	      part->fIsIndependent ? ",INDEPENDENT=YES" : "");
+      s += strlen(s);
+    }
+    sprintf(s, "#EXTINF:%.3f,\r\n%s?seq=%u\r\n", segment->fDuration, streamName, segment->fMediaSequenceNumber);
+    s += strlen(s);
+  }
+  unsigned partNumber = 0;
+  for (HLSLivePart* part = fCurrentParts; part != NULL; part = part->fNext) {
+    sprintf(s, "#EXT-X-PART:DURATION=%.3f,URI=\"%s?seq=%u.%u\"%s\r\n",
+	    part->fDuration, streamName, fCurrentMediaSequenceNumber, partNumber++,
+	    part->fIsIndependent ? ",INDEPENDENT=YES" : "");
+    s += strlen(s);
+  }
+
+  return playlist;
+}
+
+HLSCachedSegment* HLSLiveSegmenter::lookupSegment(unsigned mediaSequenceNumber, int partNumber) {
+  HLSCachedSegment* result = NULL;
+
+  if (mediaSequenceNumber == fCurrentMediaSequenceNumber) {
+    // Only (complete) partial segments of the current segment are available:
+    if (partNumber >= 0) {
+      HLSLivePart* part = fCurrentParts;
+      for (int i = 0; part != NULL && i < partNumber; ++i) part = part->fNext;
+      if (part != NULL) result = part->fData;
+    }
+  } else {
+    for (HLSLiveSegment* segment = fSegments; segment != NULL; segment = segment->fNext) {
+      if (segment->fMediaSequenceNumber != mediaSequenceNumber) continue;
+
+      if (partNumber < 0) {
+	result = segment->fData;
+      } else {
+	HLSLivePart* part = segment->fParts;
+	for (int i = 0; part != NULL && i < partNumber; ++i) part = part->fNext;
+	if (part != NULL) result = part->fData;
+      }
+      break;
+    }
+  }
+
+  if (result != NULL) result->ref();
+  return result;
+}
+
+Boolean HLSLiveSegmenter::isInPlaylist(unsigned mediaSequenceNumber, int partNumber) const {
+  if (mediaSequenceNumber < fCurrentMediaSequenceNumber) return fNumSegments > 0; // the segment is complete
+  return mediaSequenceNumber == fCurrentMediaSequenceNumber && partNumber >= 0 && (unsigned)partNumber < fNumCurrentParts;
+}
+
+Boolean HLSLiveSegmenter::isTooFarAhead(unsigned mediaSequenceNumber) const {
+  // The most recent segment in the playlist is "fCurrentMediaSequenceNumber"-1:
+  return mediaSequenceNumber > fCurrentMediaSequenceNumber + 1;
+}
+
+void HLSLiveSegmenter::addWaiter(afterPlaylistChangeFunc* func, void* clientData) {
+  if (fIsClosing) return;
+  fWaiters = new HLSLiveWaiter(func, clientData, fWaiters);
+}
+
+void HLSLiveSegmenter::removeWaiter(void* clientData) {
+  HLSLiveWaiter** waiterPtr = &fWaiters;
+  while (*waiterPtr != NULL) {
+    HLSLiveWaiter* waiter = *waiterPtr;
+    if (waiter->fClientData == clientData) {
+      *waiterPtr = waiter->fNext;
+      delete waiter;
+    } else {
+      waiterPtr = &waiter->fNext;
+    }
+  }
+}
+
+void HLSLiveSegmenter::noteActivity() {
+  gettimeofday(&fLastActivityTime, NULL);
+}
+
+Boolean HLSLiveSegmenter::isIdle(unsigned maxIdleSeconds) const {
+  if (fWaiters != NULL) return False;
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (unsigned)(timeNow.tv_sec - fLastActivityTime.tv_sec) >= maxIdleSeconds;
+}
+
+void HLSLiveSegmenter::afterGettingFrame(void* clientData, unsigned frameSize,
+					 unsigned /*numTruncatedBytes*/,
+					 struct timeval /*presentationTime*/,
+					 unsigned /*durationInMicroseconds*/) {
+  HLSLiveSegmenter* segmenter = (HLSLiveSegmenter*)clientData;
+  segmenter->afterGettingFrame(frameSize);
+}
+
+void HLSLiveSegmenter::afterGettingFrame(unsigned frameSize) {
+  if (frameSize == TRANSPORT_PACKET_SIZE) handleTSPacket(fTSPacket);
+
+  continuePlaying();
+}
+
+void HLSLiveSegmenter::onSourceClosure(void* clientData) {
+  // Our input filters never close (even if our session's source does), so this shouldn't happen.  But if it does, we just
+  // stop generating segments:
+  HLSLiveSegmenter* segmenter = (HLSLiveSegmenter*)clientData;
+  segmenter->envir() << "HLSLiveSegmenter: input unexpectedly closed\n";
+}
+
+Boolean HLSLiveSegmenter::continuePlaying() {
+  if (fSource == NULL) return False;
+
+  fSource->getNextFrame(fTSPacket, sizeof fTSPacket, afterGettingFrame, this, onSourceClosure, this);
+  return True;
+}
+
+static int64_t ptsDifference(u_int64_t pts1, u_int64_t pts2) {
+  // Returns "pts1" - "pts2" (in the range [-2^32, 2^32)), allowing for wrap-around:
+  int64_t diff = (int64_t)((pts1 - pts2)&PTS_MASK);
+  if (diff >= 0x100000000LL) diff -= 0x200000000LL;
+  return diff;
+}
+
+void HLSLiveSegmenter::handleTSPacket(u_int8_t const* pkt) {
+  if (pkt[0] != 0x47) return; // sanity check: bad 'sync byte'
+
+  u_int16_t PID = ((pkt[1]&0x1F)<<8)|pkt[2];
+  Boolean payloadUnitStart = (pkt[1]&0x40) != 0;
+  u_int8_t adaptationFieldControl = (pkt[3]&0x30)>>4;
+  unsigned payloadOffset = 4;
+  if (adaptationFieldControl&0x2) payloadOffset += 1 + pkt[4];
+  Boolean hasPayload = (adaptationFieldControl&0x1) != 0 && payloadOffset < TRANSPORT_PACKET_SIZE;
+
+  if (payloadUnitStart && hasPayload) {
+    if (PID == 0) {
+      parsePAT(pkt, payloadOffset);
+    } else if (PID == fPMT_PID) {
+      parsePMT(pkt, payloadOffset);
+    } else if ((PID == fVideoPID || PID == fAudioPID) && payloadOffset + 14 <= TRANSPORT_PACKET_SIZE) {
+      // This packet begins a PES packet.  Get its PTS:
+      u_int8_t const* pes = &pkt[payloadOffset];
+      if (pes[0] == 0 && pes[1] == 0 && pes[2] == 1 && (pes[7]&0x80) != 0) {
+	u_int64_t pts = ((u_int64_t)(pes[9]&0x0E)<<29) | (pes[10]<<22) | ((pes[11]&0xFE)<<14) | (pes[12]<<7) | (pes[13]>>1);
+
+	if (PID == fVideoPID) {
+	  // The PES packet holds one NAL unit (beginning with a 'start code').  Each new PTS begins a new access unit:
+	  if (!fHaveLastVideoPTS || pts != fLastVideoPTS) handleAccessUnitStart(pts);
+	  fHaveLastVideoPTS = True;
+	  fLastVideoPTS = pts;
+
+	  // If the NAL unit is a parameter set or 'IRAP' (key frame) slice, then the access unit is a key frame:
+	  unsigned nalOffset = payloadOffset + 9 + pes[8];
+	  if (nalOffset + 5 <= TRANSPORT_PACKET_SIZE) {
+	    u_int8_t const* nal = &pkt[nalOffset];
+	    u_int8_t nalHeaderByte = nal[2] == 1 ? nal[3] : nal[4]; // allow for a 3- or 4-byte 'start code'
+	    Boolean isKeyNALUnit;
+	    if (fVideoIsH265) {
+	      u_int8_t nal_unit_type = (nalHeaderByte&0x7E)>>1;
+	      isKeyNALUnit = (nal_unit_type >= 16 && nal_unit_type <= 21) || (nal_unit_type >= 32 && nal_unit_type <= 34);
+	    } else {
+	      u_int8_t nal_unit_type = nalHeaderByte&0x1F;
+	      isKeyNALUnit = nal_unit_type == 5 || nal_unit_type == 7 || nal_unit_type == 8;
+	    }
+	    if (isKeyNALUnit) handleKeyFrame();
+	  }
+	} else if (fVideoPID == 0) {
+	  // We have only audio, so each audio frame can begin a segment:
+	  handleAccessUnitStart(pts);
+	  handleKeyFrame();
+	}
+      }
+    }
+  }
+
+  if (!fHaveStarted && fPartBufferSize > HLS_LIVE_MAX_UNSTARTED_DATA_SIZE) fPartBufferSize = 0;
+  appendToPart(pkt, TRANSPORT_PACKET_SIZE);
+}
+
+void HLSLiveSegmenter::parsePAT(u_int8_t const* pkt, unsigned payloadOffset) {
+  memcpy(fPATPacket, pkt, TRANSPORT_PACKET_SIZE);
+  fHavePAT = True;
+
+  // Use the first program's PMT PID:
+  unsigned pos = payloadOffset + 1 + pkt[payloadOffset]; // skip over the 'pointer_field'
+  if (pos + 3 > TRANSPORT_PACKET_SIZE) return;
+  unsigned sectionEnd = pos + 3 + (((pkt[pos+1]&0x0F)<<8)|pkt[pos+2]) - 4/*CRC*/;
+  if (sectionEnd > TRANSPORT_PACKET_SIZE) sectionEnd = TRANSPORT_PACKET_SIZE;
+  for (pos += 8; pos + 4 <= sectionEnd; pos += 4) {
+    u_int16_t program_number = (pkt[pos]<<8)|pkt[pos+1];
+    if (program_number != 0) {
+      fPMT_PID = ((pkt[pos+2]&0x1F)<<8)|pkt[pos+3];
+      break;
+    }
+  }
+}
+
+void HLSLiveSegmenter::parsePMT(u_int8_t const* pkt, unsigned payloadOffset) {
+  memcpy(fPMTPacket, pkt, TRANSPORT_PACKET_SIZE);
+  fHavePMT = True;
+
+  // Find our video and audio PIDs (from their 'stream_type's):
+  unsigned pos = payloadOffset + 1 + pkt[payloadOffset]; // skip over the 'pointer_field'
+  if (pos + 12 > TRANSPORT_PACKET_SIZE) return;
+  unsigned sectionEnd = pos + 3 + (((pkt[pos+1]&0x0F)<<8)|pkt[pos+2]) - 4/*CRC*/;
+  if (sectionEnd > TRANSPORT_PACKET_SIZE) sectionEnd = TRANSPORT_PACKET_SIZE;
+  unsigned program_info_length = ((pkt[pos+10]&0x0F)<<8)|pkt[pos+11];
+  for (pos += 12 + program_info_length; pos + 5 <= sectionEnd; ) {
+    u_int8_t stream_type = pkt[pos];
+    u_int16_t elementary_PID = ((pkt[pos+1]&0x1F)<<8)|pkt[pos+2];
+    unsigned ES_info_length = ((pkt[pos+3]&0x0F)<<8)|pkt[pos+4];
+    if (stream_type == 0x1B || stream_type == 0x24) {
+      fVideoPID = elementary_PID;
+      fVideoIsH265 = stream_type == 0x24;
+    } else if (stream_type == 0x0F) {
+      fAudioPID = elementary_PID;
+    }
+    pos += 5 + ES_info_length;
+  }
+}
+
+void HLSLiveSegmenter::handleAccessUnitStart(u_int64_t pts) {
+  if (!fHaveStarted) {
+    // Until we've seen a key frame, we keep only the data from the start of the most recent access unit:
+    fPartBufferSize = 0;
+  } else {
+    int64_t interval = ptsDifference(pts, fAUPTS);
+    if (interval > 0 && interval < PTS_FREQUENCY) fLastAccessUnitInterval = interval;
+
+    if (ptsDifference(pts, fSegmentStartPTS) >= 3*fTargetDuration*PTS_FREQUENCY) {
+      // We haven't seen a key frame for much too long.  End the segment anyway:
+      cutSegment(fPartBufferSize, pts, False);
+    } else if (fPartTargetDuration > 0.0 && fPartBufferSize > 0
+	       && ptsDifference(pts, fPartStartPTS) + fLastAccessUnitInterval > fPartTargetDuration*PTS_FREQUENCY) {
+      // Including this access unit would make the current partial segment too long, so end it now:
+      completeCurrentPart(pts);
+    }
+  }
+
+  fAUPTS = pts;
+  fAUStartOffset = fPartBufferSize;
+  fAUIsKey = False;
+}
+
+void HLSLiveSegmenter::handleKeyFrame() {
+  if (fAUIsKey) return; // we already know that the current access unit is a key frame
+  fAUIsKey = True;
+
+  if (!fHaveStarted) {
+    // Begin our first segment with this access unit:
+    if (!fHavePAT || !fHavePMT) return;
+    insertSegmentStartTables();
+    fHaveStarted = True;
+    fSegmentStartPTS = fPartStartPTS = fAUPTS;
+    fCurrentPartIsIndependent = True;
+  } else if (ptsDifference(fAUPTS, fSegmentStartPTS) + fLastAccessUnitInterval/2 >= fTargetDuration*PTS_FREQUENCY) {
+    // The current segment is long enough (allowing for jitter in presentation times), so begin a new one with this access unit:
+    cutSegment(fAUStartOffset, fAUPTS, True);
+  } else if (fAUStartOffset == 0) {
+    fCurrentPartIsIndependent = True; // the current partial segment begins with this access unit
+  }
+}
+
+void HLSLiveSegmenter::cutSegment(unsigned offset, u_int64_t pts, Boolean nextSegmentBeginsWithKeyFrame) {
+  // The data before "offset" (in "fPartBuffer") ends the current segment; the data after it begins the next one:
+  double duration = ptsDifference(pts, fSegmentStartPTS)/(double)PTS_FREQUENCY;
+  HLSCachedSegment* segmentData = NULL;
+  if (fPartTargetDuration > 0.0) {
+    if (offset > 0) addCurrentPart(takeFromPartBuffer(offset), ptsDifference(pts, fPartStartPTS)/(double)PTS_FREQUENCY);
+
+    // The segment's data is the concatenation of its partial segments:
+    unsigned size = 0;
+    HLSLivePart* part;
+    for (part = fCurrentParts; part != NULL; part = part->fNext) size += part->fData->size();
+    u_int8_t* data = new u_int8_t[size];
+    size = 0;
+    for (part = fCurrentParts; part != NULL; part = part->fNext) {
+      memmove(&data[size], part->fData->data(), part->fData->size());
+      size += part->fData->size();
+    }
+    segmentData = new HLSCachedSegment(data, size);
+  } else {
+    segmentData = takeFromPartBuffer(offset);
+  }
+
+  HLSLiveSegment* segment
+    = new HLSLiveSegment(fCurrentMediaSequenceNumber++, duration, segmentData, fCurrentParts, fNumCurrentParts);
+  fCurrentParts = fLastCurrentPart = NULL; fNumCurrentParts = 0;
+  if (fLastSegment == NULL) fSegments = segment; else fLastSegment->fNext = segment;
+  fLastSegment = segment;
+  ++fNumSegments;
+  unsigned roundedDuration = (unsigned)(duration + 0.5);
+  if (roundedDuration > fMaxSeenDuration) fMaxSeenDuration = roundedDuration;
+
+  // Keep a couple of segments beyond those in the playlist (for clients that fetched the playlist a little while ago),
+  // but partial segments for only the two most recent segments:
+  while (fNumSegments > fNumSegmentsInPlaylist + 2) {
+    HLSLiveSegment* oldestSegment = fSegments;
+    fSegments = oldestSegment->fNext;
+    deleteSegment(oldestSegment);
+    --fNumSegments;
+  }
+  unsigned i = 0;
+  for (HLSLiveSegment* s = fSegments; s != NULL && i + 2 < fNumSegments; s = s->fNext, ++i) deleteParts(s->fParts);
+
+  // Begin the next segment:
+  insertSegmentStartTables();
+  fSegmentStartPTS = fPartStartPTS = pts;
+  fCurrentPartIsIndependent = nextSegmentBeginsWithKeyFrame;
+
+  notifyWaiters();
+}
+
+void HLSLiveSegmenter::completeCurrentPart(u_int64_t pts) {
+  addCurrentPart(takeFromPartBuffer(fPartBufferSize), ptsDifference(pts, fPartStartPTS)/(double)PTS_FREQUENCY);
+  fPartStartPTS = pts;
+  fCurrentPartIsIndependent = False; // unless we later find that it begins with a key frame
+
+  notifyWaiters();
+}
+
+void HLSLiveSegmenter::addCurrentPart(HLSCachedSegment* data, double duration) {
+  HLSLivePart* part = new HLSLivePart(data, duration, fCurrentPartIsIndependent);
+  if (fLastCurrentPart == NULL) fCurrentParts = part; else fLastCurrentPart->fNext = part;
+  fLastCurrentPart = part;
+  ++fNumCurrentParts;
+}
+
+HLSCachedSegment* HLSLiveSegmenter::takeFromPartBuffer(unsigned numBytes) {
+  // Copy the first "numBytes" bytes of "fPartBuffer" into a new segment, and remove them from "fPartBuffer":
+  u_int8_t* data = new u_int8_t[numBytes];
+  memmove(data, fPartBuffer, numBytes);
+  memmove(fPartBuffer, &fPartBuffer[numBytes], fPartBufferSize - numBytes);
+
+  // These packets' place in our output is now fixed, so give the PAT and PMT packets among them - including the copies
+  // that we inserted - consecutive 'continuity_counter's:
+  for (unsigned i = 0; i + TRANSPORT_PACKET_SIZE <= numBytes; i += TRANSPORT_PACKET_SIZE) {
+    u_int8_t* pkt = &data[i];
+    u_int16_t PID = ((pkt[1]&0x1F)<<8)|pkt[2];
+    u_int8_t* counter = PID == 0 ? &fPATContinuityCounter : PID == fPMT_PID ? &fPMTContinuityCounter : NULL;
+    if (counter == NULL || (pkt[3]&0x10) == 0) continue; // not a PAT or PMT packet (with a payload)
+    pkt[3] = (pkt[3]&0xF0)|*counter;
+    *counter = (*counter + 1)&0x0F;
+  }
+  fPartBufferSize -= numBytes;
+  fAUStartOffset = fAUStartOffset > numBytes ? fAUStartOffset - numBytes : 0;
+
+  return new HLSCachedSegment(data, numBytes);
+}
+
+void HLSLiveSegmenter::insertSegmentStartTables() {
+  // Begin the data with (copies of) the most recent PAT and PMT, so that each segment can be decoded on its own:
+  appendToPart(fPATPacket, TRANSPORT_PACKET_SIZE); appendToPart(fPMTPacket, TRANSPORT_PACKET_SIZE); // ensures space
+  memmove(&fPartBuffer[2*TRANSPORT_PACKET_SIZE], fPartBuffer, fPartBufferSize - 2*TRANSPORT_PACKET_SIZE);
+  memmove(fPartBuffer, fPATPacket, TRANSPORT_PACKET_SIZE);
+  memmove(&fPartBuffer[TRANSPORT_PACKET_SIZE], fPMTPacket, TRANSPORT_PACKET_SIZE);
+  fAUStartOffset += 2*TRANSPORT_PACKET_SIZE;
+}
+
+void HLSLiveSegmenter::appendToPart(u_int8_t const* data, unsigned size) {
+  if (fPartBufferSize + size > fPartBufferMaxSize) {
+    // Grow our buffer:
+    unsigned newMaxSize = fPartBufferMaxSize == 0 ? 100*TRANSPORT_PACKET_SIZE : 2*fPartBufferMaxSize;
+    while (newMaxSize < fPartBufferSize + size) newMaxSize *= 2;
+    u_int8_t* newBuffer = new u_int8_t[newMaxSize];
+    memmove(newBuffer, fPartBuffer, fPartBufferSize);
+    delete[] fPartBuffer;
+    fPartBuffer = newBuffer;
+    fPartBufferMaxSize = newMaxSize;
+  }
+
+  memmove(&fPartBuffer[fPartBufferSize], data, size);
+  fPartBufferSize += size;
+}
+
+void HLSLiveSegmenter::notifyWaiters() {
+  // Take the current list of waiters (because the called functions may add new ones):
+  HLSLiveWaiter* waiters = fWaiters;
+  fWaiters = NULL;
+
+  while (waiters != NULL) {
+    HLSLiveWaiter* waiter = waiters;
+    waiters = waiter->fNext;
+    (*waiter->fFunc)(waiter->fClientData);
+    delete waiter;
+  }
+}
+
+void HLSLiveSegmenter::releaseData(HLSCachedSegment* data) {
+  // We no longer hold this data, but its current users might:
+  data->fIsHeld = False;
+  if (data->fRefCount == 0) delete data;
+}
+
+void HLSLiveSegmenter::deleteParts(HLSLivePart*& parts) {
+  while (parts != NULL) {
+    HLSLivePart* part = parts;
+    parts = part->fNext;
+    releaseData(part->fData);
+    delete part;
+  }
+}
+
+void HLSLiveSegmenter::deleteSegment(HLSLiveSegment* segment) {
+  releaseData(segment->fData);
+  deleteParts(segment->fParts);
+  delete segment;
+}
+
+
+////////// HLSLiveVideoFramer implementation //////////
+
+HLSLiveVideoFramer::HLSLiveVideoFramer(UsageEnvironment& env, RTPSource* inputSource, Boolean isH265,
+				       MediaSubsession& subsession)
+  : FramedFilter(env, inputSource),
+    fIsH265(isH265), fParameterSets(NULL), fParameterSetsSize(0), fSawParameterSets(False) {
+  fLastVCLPresentationTime.tv_sec = fLastVCLPresentationTime.tv_usec = 0;
+
+  if (isH265) {
+    addParameterSets(subsession.fmtp_spropvps());
+    addParameterSets(subsession.fmtp_spropsps());
+    addParameterSets(subsession.fmtp_sproppps());
+  } else {
+    addParameterSets(subsession.fmtp_spropparametersets());
+  }
+}
+
+HLSLiveVideoFramer::~HLSLiveVideoFramer() {
+  delete[] fParameterSets;
+}
+
+void HLSLiveVideoFramer::addParameterSets(char const* sPropStr) {
+  unsigned numSPropRecords;
+  SPropRecord* sPropRecords = parseSPropParameterSets(sPropStr, numSPropRecords);
+
+  unsigned newSize = fParameterSetsSize;
+  unsigned i;
+  for (i = 0; i < numSPropRecords; ++i) newSize += 4 + sPropRecords[i].sPropLength;
+  u_int8_t* newParameterSets = new u_int8_t[newSize];
+  memmove(newParameterSets, fParameterSets, fParameterSetsSize);
+  for (i = 0; i < numSPropRecords; ++i) {
+    u_int8_t* to = &newParameterSets[fParameterSetsSize];
+    to[0] = to[1] = to[2] = 0; to[3] = 1;
+    memmove(&to[4], sPropRecords[i].sPropBytes, sPropRecords[i].sPropLength);
+    fParameterSetsSize += 4 + sPropRecords[i].sPropLength;
+  }
+  delete[] fParameterSets;
+  fParameterSets = newParameterSets;
+
+  delete[] sPropRecords;
+}
+
+void HLSLiveVideoFramer::doGetNextFrame() {
+  // Leave room for a 'start code' before the NAL unit:
+  if (fMaxSize < 4) {
+    fFrameSize = 0;
+    fNumTruncatedBytes = fMaxSize;
+    afterGetting(this);
+    return;
+  }
+
+  fInputSource->getNextFrame(&fTo[4], fMaxSize - 4, afterGettingFrame, this, FramedSource::handleClosure, this);
+}
+
+void HLSLiveVideoFramer::afterGettingFrame(void* clientData, unsigned frameSize,
+					   unsigned numTruncatedBytes,
+					   struct timeval presentationTime,
+					   unsigned /*durationInMicroseconds*/) {
+  HLSLiveVideoFramer* framer = (HLSLiveVideoFramer*)clientData;
+  framer->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime);
+}
+
+void HLSLiveVideoFramer::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+					   struct timeval presentationTime) {
+  if (frameSize == 0 || !((RTPSource*)fInputSource)->hasBeenSynchronizedUsingRTCP()) {
+    // Drop this NAL unit:
+    doGetNextFrame();
+    return;
+  }
+
+  u_int8_t* nal = &fTo[4];
+  Boolean isParameterSet, isVCL, isIRAP;
+  if (fIsH265) {
+    u_int8_t nal_unit_type = (nal[0]&0x7E)>>1;
+    isParameterSet = nal_unit_type >= 32 && nal_unit_type <= 34;
+    isVCL = nal_unit_type <= 31;
+    isIRAP = nal_unit_type >= 16 && nal_unit_type <= 21;
+  } else {
+    u_int8_t nal_unit_type = nal[0]&0x1F;
+    isParameterSet = nal_unit_type == 7 || nal_unit_type == 8;
+    isVCL = nal_unit_type >= 1 && nal_unit_type <= 5;
+    isIRAP = nal_unit_type == 5;
+  }
+
+  unsigned prefixSize = 0;
+  if (isParameterSet) {
+    fSawParameterSets = True;
+  } else if (isVCL && (presentationTime.tv_sec != fLastVCLPresentationTime.tv_sec
+		       || presentationTime.tv_usec != fLastVCLPresentationTime.tv_usec)) {
+    // This is the first slice of a new access unit.  If it's a key frame that's not preceded by parameter sets, then
+    // insert them (if there's room):
+    if (isIRAP && !fSawParameterSets && fParameterSetsSize > 0 && fParameterSetsSize + 4 + frameSize <= fMaxSize) {
+      memmove(&fTo[fParameterSetsSize + 4], nal, frameSize);
+      memmove(fTo, fParameterSets, fParameterSetsSize);
+      prefixSize = fParameterSetsSize;
+    }
+    fSawParameterSets = False;
+    fLastVCLPresentationTime = presentationTime;
+  }
+
+  u_int8_t* startCode = &fTo[prefixSize];
+  startCode[0] = startCode[1] = startCode[2] = 0; startCode[3] = 1;
+
+  fFrameSize = prefixSize + 4 + frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = 0;
+  afterGetting(this);
+}
+
+
+////////// HLSLiveADTSFramer implementation //////////
+
+HLSLiveADTSFramer* HLSLiveADTSFramer::createNew(UsageEnvironment& env, RTPSource* inputSource, char const* configStr) {
+  unsigned configSize;
+  u_int8_t* config = parseGeneralConfigStr(configStr, configSize);
+  if (config == NULL) return NULL;
+
+  // Parse the start of the 'AudioSpecificConfig':
+  HLSLiveADTSFramer* result = NULL;
+  if (configSize >= 2) {
+    u_int8_t audioObjectType = config[0]>>3;
+    u_int8_t samplingFrequencyIndex = ((config[0]&0x07)<<1)|(config[1]>>7);
+    u_int8_t channelConfiguration = (config[1]&0x78)>>3;
+    // ADTS can signal only the first four audio object types, and only the (13) standard sampling frequencies:
+    if (audioObjectType >= 1 && audioObjectType <= 4 && samplingFrequencyIndex < 13) {
+      result = new HLSLiveADTSFramer(env, inputSource, audioObjectType - 1, samplingFrequencyIndex, channelConfiguration);
+    }
+  }
+
+  delete[] config;
+  return result;
+}
+
+HLSLiveADTSFramer::HLSLiveADTSFramer(UsageEnvironment& env, RTPSource* inputSource,
+				     u_int8_t profile, u_int8_t samplingFrequencyIndex, u_int8_t channelConfiguration)
+  : FramedFilter(env, inputSource),
+    fProfile(profile), fSamplingFrequencyIndex(samplingFrequencyIndex), fChannelConfiguration(channelConfiguration) {
+}
+
+HLSLiveADTSFramer::~HLSLiveADTSFramer() {
+}
+
+void HLSLiveADTSFramer::doGetNextFrame() {
+  // Leave room for the ADTS header before the frame:
+  if (fMaxSize < ADTS_HEADER_SIZE) {
+    fFrameSize = 0;
+    fNumTruncatedBytes = fMaxSize;
+    afterGetting(this);
+    return;
+  }
+
+  fInputSource->getNextFrame(&fTo[ADTS_HEADER_SIZE], fMaxSize - ADTS_HEADER_SIZE, afterGettingFrame, this,
+			     FramedSource::handleClosure, this);
+}
+
+void HLSLiveADTSFramer::afterGettingFrame(void* clientData, unsigned frameSize,
+					  unsigned numTruncatedBytes,
+					  struct timeval presentationTime,
+					  unsigned /*durationInMicroseconds*/) {
+  HLSLiveADTSFramer* framer = (HLSLiveADTSFramer*)clientData;
+  framer->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime);
+}
+
+void HLSLiveADTSFramer::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+					  struct timeval presentationTime) {
+  unsigned adtsFrameLength = ADTS_HEADER_SIZE + frameSize;
+  if (frameSize == 0 || adtsFrameLength > 0x1FFF || !((RTPSource*)fInputSource)->hasBeenSynchronizedUsingRTCP()) {
+    // Drop this frame:
+    doGetNextFrame();
+    return;
+  }
+
+  // Fill in the ADTS header (with no CRC):
+  fTo[0] = 0xFF;
+  fTo[1] = 0xF1; // MPEG-4; layer 0; 'protection_absent'
+  fTo[2] = (fProfile<<6)|(fSamplingFrequencyIndex<<2)|(fChannelConfiguration>>2);
+  fTo[3] = ((fChannelConfiguration&0x03)<<6)|(adtsFrameLength>>11);
+  fTo[4] = adtsFrameLength>>3;
+  fTo[5] = ((adtsFrameLength&0x07)<<5)|0x1F;
+  fTo[6] = 0xFC;
+
+  fFrameSize = adtsFrameLength;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = 0;
+  afterGetting(this);
+}
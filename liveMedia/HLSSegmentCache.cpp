@@ -0,0 +1,332 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A cache of HTTP Live Streaming (HLS) segments, shared by all clients of a "RTSPServerSupportingHTTPStreaming".
+// Implementation
+
+#include "HLSSegmentCache.hh"
+#include "OutputFile.hh"
+#include "GroupsockHelper.hh" // for "our_random32()"
+#ifndef _WIN32_WCE
+#include <sys/stat.h>
+#endif
+
+////////// HLSCachedSegment implementation //////////
+
+HLSCachedSegment::HLSCachedSegment(u_int8_t* data, unsigned size)
+  : fData(data), fSize(size), fRefCount(0), fIsHeld(True) {
+}
+
+HLSCachedSegment::~HLSCachedSegment() {
+  delete[] fData;
+}
+
+void HLSCachedSegment::unref() {
+  if (fRefCount > 0) --fRefCount;
+  if (fRefCount == 0 && !fIsHeld) delete this;
+}
+
+////////// HLSCacheEntry definition and implementation //////////
+
+// An entry in the cache.  Its segment is in memory (iff "fSegment" != NULL), on disk (iff "fDiskFileName" != NULL),
+// or both.  The entry is in the memory LRU list iff it's in memory, and in the disk LRU list iff it's on disk.
+class HLSCacheEntry {
+public:
+  HLSCacheEntry(char const* key);
+  virtual ~HLSCacheEntry();
+
+  void moveToFrontOfMemoryList(HLSCacheEntry* head);
+  void removeFromMemoryList();
+  void moveToFrontOfDiskList(HLSCacheEntry* head);
+  void removeFromDiskList();
+
+public:
+  char* fKey;
+  unsigned fSize;
+  HLSCachedSegment* fSegment; // NULL if not in memory
+  char* fDiskFileName; // NULL if not on disk
+  HLSCacheEntry* fMemoryNext; HLSCacheEntry* fMemoryPrev;
+  HLSCacheEntry* fDiskNext; HLSCacheEntry* fDiskPrev;
+};
+
+HLSCacheEntry::HLSCacheEntry(char const* key)
+  : fKey(strDup(key)), fSize(0), fSegment(NULL), fDiskFileName(NULL) {
+  fMemoryNext = fMemoryPrev = fDiskNext = fDiskPrev = this;
+}
+
+HLSCacheEntry::~HLSCacheEntry() {
+  delete[] fDiskFileName;
+  delete[] fKey;
+}
+
+void HLSCacheEntry::moveToFrontOfMemoryList(HLSCacheEntry* head) {
+  removeFromMemoryList();
+  fMemoryPrev = head; fMemoryNext = head->fMemoryNext;
+  head->fMemoryNext->fMemoryPrev = this; head->fMemoryNext = this;
+}
+
+void HLSCacheEntry::removeFromMemoryList() {
+  fMemoryPrev->fMemoryNext = fMemoryNext; fMemoryNext->fMemoryPrev = fMemoryPrev;
+  fMemoryNext = fMemoryPrev = this;
+}
+
+void HLSCacheEntry::moveToFrontOfDiskList(HLSCacheEntry* head) {
+  removeFromDiskList();
+  fDiskPrev = head; fDiskNext = head->fDiskNext;
+  head->fDiskNext->fDiskPrev = this; head->fDiskNext = this;
+}
+
+void HLSCacheEntry::removeFromDiskList() {
+  fDiskPrev->fDiskNext = fDiskNext; fDiskNext->fDiskPrev = fDiskPrev;
+  fDiskNext = fDiskPrev = this;
+}
+
+////////// HLSSegmentCache implementation //////////
+
+HLSSegmentCache::HLSSegmentCache(UsageEnvironment& env, unsigned maxMemorySize,
+				 char const* diskCacheDirectoryName, u_int64_t maxDiskSize)
+  : fEnv(env), fMaxMemorySize(maxMemorySize), fMemorySize(0),
+    fDiskCacheDirectoryName(strDup(diskCacheDirectoryName)), fMaxDiskSize(maxDiskSize), fDiskSize(0),
+    fDiskFileNamePrefix(our_random32()), fDiskFileCounter(0), fEntries(HashTable::create(STRING_HASH_KEYS)),
+    fMemoryLRUHead(new HLSCacheEntry("")), fDiskLRUHead(new HLSCacheEntry("")),
+    fNumHits(0), fNumMisses(0) {
+}
+
+HLSSegmentCache::~HLSSegmentCache() {
+  HLSCacheEntry* entry;
+  while ((entry = (HLSCacheEntry*)fEntries->getFirst()) != NULL) {
+    if (entry->fSegment != NULL) removeFromMemory(entry);
+    if (entry->fDiskFileName != NULL) removeFromDisk(entry);
+    deleteEntryIfUnused(entry);
+  }
+  delete fEntries;
+
+  delete fMemoryLRUHead; delete fDiskLRUHead;
+  delete[] fDiskCacheDirectoryName;
+}
+
+Boolean HLSSegmentCache::getModificationTime(char const* streamName, time_t& modificationTime) {
+  modificationTime = 0;
+#ifndef _WIN32_WCE
+  struct stat sb;
+  if (stat(streamName, &sb) != 0) return False;
+  modificationTime = sb.st_mtime;
+#endif
+  return True;
+}
+
+HLSCachedSegment* HLSSegmentCache::lookup(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+					  time_t modificationTime, char const*& diskFileName, unsigned& diskFileSize) {
+  diskFileName = NULL;
+  diskFileSize = 0;
+
+  HLSCacheEntry* entry = lookupEntry(streamName, offsetInSeconds, durationInSeconds, modificationTime, False);
+  if (entry == NULL) {
+    ++fNumMisses;
+    return NULL;
+  }
+  ++fNumHits;
+
+  if (entry->fSegment != NULL) {
+    entry->moveToFrontOfMemoryList(fMemoryLRUHead);
+    entry->fSegment->ref();
+    return entry->fSegment;
+  }
+
+  // The segment is only on disk.  We don't read it back into memory (which would block), but let the caller send it
+  // directly from its file:
+  entry->moveToFrontOfDiskList(fDiskLRUHead);
+  diskFileName = entry->fDiskFileName;
+  diskFileSize = entry->fSize;
+  return NULL;
+}
+
+void HLSSegmentCache::add(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+			  time_t modificationTime, u_int8_t* data, unsigned size) {
+  if (size == 0 || size > fMaxMemorySize) {
+    // The segment can never fit in memory:
+    delete[] data;
+    return;
+  }
+
+  HLSCacheEntry* entry = lookupEntry(streamName, offsetInSeconds, durationInSeconds, modificationTime, True);
+  if (entry->fSegment != NULL) {
+    // Another client has already added this segment (e.g., because both clients missed it at the same time):
+    delete[] data;
+    return;
+  }
+
+  addToMemory(entry, new HLSCachedSegment(data, size));
+}
+
+HLSCacheEntry* HLSSegmentCache::lookupEntry(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+					    time_t modificationTime, Boolean createIfNotPresent) {
+  unsigned const keySize = strlen(streamName) + 50;
+  char* key = new char[keySize];
+  snprintf(key, keySize, "%s?%u,%u@%lu", streamName, offsetInSeconds, durationInSeconds, (unsigned long)modificationTime);
+
+  HLSCacheEntry* entry = (HLSCacheEntry*)(fEntries->Lookup(key));
+  if (entry == NULL && createIfNotPresent) {
+    entry = new HLSCacheEntry(key);
+    fEntries->Add(entry->fKey, entry);
+  }
+
+  delete[] key;
+  return entry;
+}
+
+void HLSSegmentCache::addToMemory(HLSCacheEntry* entry, HLSCachedSegment* segment) {
+  entry->fSegment = segment;
+  entry->fSize = segment->size();
+  entry->moveToFrontOfMemoryList(fMemoryLRUHead);
+  fMemorySize += segment->size();
+
+  // Make room for the segment, by removing the least recently used (other) segments from memory:
+  while (fMemorySize > fMaxMemorySize && fMemoryLRUHead->fMemoryPrev != entry) {
+    HLSCacheEntry* lru = fMemoryLRUHead->fMemoryPrev;
+    if (lru->fDiskFileName == NULL) saveToDisk(lru);
+    removeFromMemory(lru);
+    deleteEntryIfUnused(lru);
+  }
+}
+
+void HLSSegmentCache::removeFromMemory(HLSCacheEntry* entry) {
+  HLSCachedSegment* segment = entry->fSegment;
+  entry->fSegment = NULL;
+  entry->removeFromMemoryList();
+  fMemorySize -= segment->size();
+
+  // The segment may still be being sent to some clients; if so, it'll get deleted when the last of them "unref()"s it:
+  segment->fIsHeld = False;
+  if (segment->fRefCount == 0) delete segment;
+}
+
+Boolean HLSSegmentCache::saveToDisk(HLSCacheEntry* entry) {
+  if (fDiskCacheDirectoryName == NULL || entry->fSize > fMaxDiskSize) return False;
+
+  // Make room for the segment, by removing the least recently used segments from disk:
+  while (fDiskSize + entry->fSize > fMaxDiskSize && fDiskLRUHead->fDiskPrev != fDiskLRUHead) {
+    HLSCacheEntry* lru = fDiskLRUHead->fDiskPrev;
+    removeFromDisk(lru);
+    deleteEntryIfUnused(lru);
+  }
+
+  char* fileName = new char[strlen(fDiskCacheDirectoryName) + 40];
+  sprintf(fileName, "%s/live555-hls-%08x-%u.ts", fDiskCacheDirectoryName, fDiskFileNamePrefix, ++fDiskFileCounter);
+  FILE* fid = OpenOutputFile(fEnv, fileName);
+  if (fid == NULL) {
+    delete[] fileName;
+    return False;
+  }
+  Boolean success = fwrite(entry->fSegment->data(), 1, entry->fSize, fid) == entry->fSize;
+  CloseOutputFile(fid);
+  if (!success) {
+    remove(fileName);
+    delete[] fileName;
+    return False;
+  }
+
+  entry->fDiskFileName = fileName;
+  entry->moveToFrontOfDiskList(fDiskLRUHead);
+  fDiskSize += entry->fSize;
+  return True;
+}
+
+void HLSSegmentCache::removeFromDisk(HLSCacheEntry* entry) {
+  // (If the file is still being sent to a client, then the client's open file is unaffected.)
+  remove(entry->fDiskFileName);
+  delete[] entry->fDiskFileName; entry->fDiskFileName = NULL;
+  entry->removeFromDiskList();
+  fDiskSize -= entry->fSize;
+}
+
+void HLSSegmentCache::deleteEntryIfUnused(HLSCacheEntry* entry) {
+  if (entry->fSegment != NULL || entry->fDiskFileName != NULL) return;
+
+  fEntries->Remove(entry->fKey);
+  delete entry;
+}
+
+////////// HLSSegmentCacheFiller implementation //////////
+
+HLSSegmentCacheFiller* HLSSegmentCacheFiller
+::createNew(UsageEnvironment& env, FramedSource* inputSource, HLSSegmentCache& cache,
+	    char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+	    time_t modificationTime, unsigned segmentSize) {
+  return new HLSSegmentCacheFiller(env, inputSource, cache, streamName, offsetInSeconds, durationInSeconds,
+				   modificationTime, segmentSize);
+}
+
+HLSSegmentCacheFiller
+::HLSSegmentCacheFiller(UsageEnvironment& env, FramedSource* inputSource, HLSSegmentCache& cache,
+			char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+			time_t modificationTime, unsigned segmentSize)
+  : FramedFilter(env, inputSource),
+    fCache(cache), fStreamName(strDup(streamName)),
+    fOffsetInSeconds(offsetInSeconds), fDurationInSeconds(durationInSeconds), fModificationTime(modificationTime),
+    fSegmentData(new u_int8_t[segmentSize]), fSegmentSize(segmentSize), fNumBytesCopied(0) {
+}
+
+HLSSegmentCacheFiller::~HLSSegmentCacheFiller() {
+  delete[] fSegmentData;
+  delete[] fStreamName;
+}
+
+void HLSSegmentCacheFiller::doGetNextFrame() {
+  fInputSource->getNextFrame(fTo, fMaxSize, afterGettingFrame, this, onInputClosure, this);
+}
+
+void HLSSegmentCacheFiller::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+					      struct timeval presentationTime, unsigned durationInMicroseconds) {
+  HLSSegmentCacheFiller* filler = (HLSSegmentCacheFiller*)clientData;
+  filler->afterGettingFrame(frameSize, numTruncatedBytes, presentationTime, durationInMicroseconds);
+}
+
+void HLSSegmentCacheFiller::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+					      struct timeval presentationTime, unsigned durationInMicroseconds) {
+  if (fSegmentData != NULL) {
+    if (numTruncatedBytes > 0 || fNumBytesCopied + frameSize > fSegmentSize) {
+      // The data is not what we expected, so don't cache it:
+      delete[] fSegmentData; fSegmentData = NULL;
+    } else {
+      memmove(&fSegmentData[fNumBytesCopied], fTo, frameSize);
+      fNumBytesCopied += frameSize;
+      if (fNumBytesCopied == fSegmentSize) {
+	// We have the complete segment.  Give it to the cache (which takes ownership of it):
+	fCache.add(fStreamName, fOffsetInSeconds, fDurationInSeconds, fModificationTime, fSegmentData, fSegmentSize);
+	fSegmentData = NULL;
+      }
+    }
+  }
+
+  fFrameSize = frameSize;
+  fNumTruncatedBytes = numTruncatedBytes;
+  fPresentationTime = presentationTime;
+  fDurationInMicroseconds = durationInMicroseconds;
+  afterGetting(this);
+}
+
+void HLSSegmentCacheFiller::onInputClosure(void* clientData) {
+  HLSSegmentCacheFiller* filler = (HLSSegmentCacheFiller*)clientData;
+  filler->onInputClosure();
+}
+
+void HLSSegmentCacheFiller::onInputClosure() {
+  // If we get here before we've seen the whole segment, then what we have is incomplete, so don't cache it:
+  delete[] fSegmentData; fSegmentData = NULL;
+  handleClosure();
+}
@@ -57,6 +57,7 @@ public:
   unsigned long transportPacketNumber() const { return fTransportPacketNumber; }
 
   IndexRecord* next() const { return fNext; }
+  IndexRecord* prev() const { return fPrev; }
   void addAfter(IndexRecord* prev);
   void unlink();
 
@@ -122,50 +123,116 @@ MPEG2IFrameIndexFromTransportStream::createNew(UsageEnvironment& env,
 // The PID used for the PAT (as defined in the MPEG Transport Stream standard):
 #define PAT_PID 0
 
+#define TRANSPORT_SYNC_BYTE 0x47
+
+// The number of Transport Stream packets that we try to read from our source at a time:
+#define INPUT_BUFFER_NUM_PACKETS 1000
+#define INPUT_BUFFER_SIZE (INPUT_BUFFER_NUM_PACKETS*TRANSPORT_PACKET_SIZE)
+
 MPEG2IFrameIndexFromTransportStream
 ::MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource)
   : FramedFilter(env, inputSource),
     fIsH264(False), fIsH265(False),
-    fInputTransportPacketCounter((unsigned)-1), fClosureNumber(0), fLastContinuityCounter(~0),
-    fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False),
+    fInputTransportPacketCounter((unsigned long)-1), fClosureNumber(0), fLastContinuityCounter(~0), fFirstPacketStartOffset(0),
+    fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False), fPCRHandler(NULL), fPCRHandlerClientData(NULL),
     fPMT_PID(0x10), fVideo_PID(0xE0), // default values
+    fInputBufferPacketStart(0), fInputBufferDataEnd(0),
     fParseBufferSize(PARSE_BUFFER_SIZE),
     fParseBufferFrameStart(0), fParseBufferParseEnd(4), fParseBufferDataEnd(0),
     fHeadIndexRecord(NULL), fTailIndexRecord(NULL) {
+  fInputBuffer = new unsigned char[INPUT_BUFFER_SIZE];
   fParseBuffer = new unsigned char[fParseBufferSize];
 }
 
 MPEG2IFrameIndexFromTransportStream::~MPEG2IFrameIndexFromTransportStream() {
   delete fHeadIndexRecord;
   delete[] fParseBuffer;
+  delete[] fInputBuffer;
 }
 
-void MPEG2IFrameIndexFromTransportStream::doGetNextFrame() {
-  // Begin by trying to deliver an index record (for an already-parsed frame)
-  // to the client:
-  if (deliverIndexRecord()) return;
+void MPEG2IFrameIndexFromTransportStream
+::setResumptionPoint(unsigned long firstTransportPacketNumber, u_int8_t startOffsetInFirstPacket,
+		     float pcrAtResumptionPoint,
+		     unsigned char const* streamStart, unsigned streamStartSize,
+		     unsigned char const* packetsBeforeResumptionPoint, unsigned packetsBeforeResumptionPointSize) {
+  // Get the PIDs, and the first PCR, from the start of the stream:
+  unsigned char pkt[TRANSPORT_PACKET_SIZE];
+  unsigned i;
+  for (i = 0; i + TRANSPORT_PACKET_SIZE <= streamStartSize; i += TRANSPORT_PACKET_SIZE) {
+    memmove(pkt, &streamStart[i], TRANSPORT_PACKET_SIZE);
+    if (pkt[0] != TRANSPORT_SYNC_BYTE) break;
+    analyzeTransportPacket(pkt, True);
+  }
+  float const firstPCR = fFirstPCR;
+  Boolean const haveSeenFirstPCR = fHaveSeenFirstPCR;
+
+  // Then get the PCR that was current at the resumption point (and any later PIDs) from the packets before it.
+  // (We treat the first PCR that we see here as a new 'first' PCR, so that we don't report a spurious decrease in the PCR.)
+  fHaveSeenFirstPCR = False;
+  if (packetsBeforeResumptionPoint != NULL) {
+    for (i = 0; i + TRANSPORT_PACKET_SIZE <= packetsBeforeResumptionPointSize; i += TRANSPORT_PACKET_SIZE) {
+      memmove(pkt, &packetsBeforeResumptionPoint[i], TRANSPORT_PACKET_SIZE);
+      if (pkt[0] != TRANSPORT_SYNC_BYTE) break;
+      analyzeTransportPacket(pkt, True);
+    }
+  }
 
-  // No more index records are left to deliver, so try to parse a new frame:
-  if (parseFrame()) { // success - try again
-    doGetNextFrame();
-    return;
+  // Then continue as if we'd just indexed the packet before the resumption point:
+  fInputTransportPacketCounter = firstTransportPacketNumber - 1;
+  if (fHaveSeenFirstPCR) {
+    // Offset "fFirstPCR" so that our PCRs continue on from "pcrAtResumptionPoint".  (This is the stream's first PCR only
+    // if the PCR has never decreased; otherwise, it includes the compensation for these decreases.)
+    fFirstPCR = fLastPCR - pcrAtResumptionPoint;
+  } else {
+    fFirstPCR = firstPCR;
+    fHaveSeenFirstPCR = haveSeenFirstPCR;
+    fLastPCR = fFirstPCR + pcrAtResumptionPoint;
   }
+  fFirstPacketStartOffset = startOffsetInFirstPacket;
+}
+
+void MPEG2IFrameIndexFromTransportStream::setPCRHandler(pcrHandlerFunc* handler, void* clientData) {
+  fPCRHandler = handler;
+  fPCRHandlerClientData = clientData;
+}
+
+void MPEG2IFrameIndexFromTransportStream::doGetNextFrame() {
+  // Parse as many frames as we can from the Transport Stream packets that we've already read.
+  // (We do this before delivering any index records, so that we can deliver many records at once.)
+  while (1) {
+    if (parseFrame()) continue; // success - try again
 
-  // We need to read some more Transport Stream packets.  Check whether we have room:
-  if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-    // There's no room left.  Compact the buffer, and check again:
-    compactParseBuffer();
+    // We need to use another Transport Stream packet.  Check whether we have room:
     if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
-      envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
-      // Treat this as if the input source ended:
-      handleInputClosure1();
-      return;
+      // There's no room left.  Compact the buffer, and check again:
+      compactParseBuffer();
+      if (fParseBufferSize - fParseBufferDataEnd < TRANSPORT_PACKET_SIZE) {
+	envir() << "ERROR: parse buffer full; increase MAX_FRAME_SIZE\n";
+	// Treat this as if the input source ended:
+	handleInputClosure1();
+	return;
+      }
     }
+
+    if (fInputBufferDataEnd - fInputBufferPacketStart < TRANSPORT_PACKET_SIZE) break; // we need to read more packets
+
+    unsigned char* pkt = &fInputBuffer[fInputBufferPacketStart];
+    fInputBufferPacketStart += TRANSPORT_PACKET_SIZE;
+    if (!analyzeTransportPacket(pkt)) return; // the packet was bad, and we've already handled it
   }
 
-  // Arrange to read a new Transport Stream packet:
-  fInputSource->getNextFrame(fInputBuffer, sizeof fInputBuffer,
+  // Next, try to deliver index records (for already-parsed frames) to the client:
+  if (deliverIndexRecords()) return;
+
+  // We need to read some more Transport Stream packets.  First, move any remaining (partial) packet to the front of our buffer:
+  unsigned numRemainingBytes = fInputBufferDataEnd - fInputBufferPacketStart;
+  memmove(&fInputBuffer[0], &fInputBuffer[fInputBufferPacketStart], numRemainingBytes);
+  fInputBufferPacketStart = 0;
+  fInputBufferDataEnd = numRemainingBytes;
+
+  // Then arrange to read more data:
+  fInputSource->getNextFrame(&fInputBuffer[fInputBufferDataEnd], INPUT_BUFFER_SIZE - fInputBufferDataEnd,
 			     afterGettingFrame, this,
 			     handleInputClosure, this);
 }
@@ -181,44 +248,47 @@ void MPEG2IFrameIndexFromTransportStream
 			     presentationTime, durationInMicroseconds);
 }
 
-#define TRANSPORT_SYNC_BYTE 0x47
-
 void MPEG2IFrameIndexFromTransportStream
 ::afterGettingFrame1(unsigned frameSize,
-		     unsigned numTruncatedBytes,
-		     struct timeval presentationTime,
-		     unsigned durationInMicroseconds) {
-  if (frameSize < TRANSPORT_PACKET_SIZE || fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
-    if (fInputBuffer[0] != TRANSPORT_SYNC_BYTE) {
-      envir() << "Bad TS sync byte: 0x" << fInputBuffer[0] << "\n";
-    }
+		     unsigned /*numTruncatedBytes*/,
+		     struct timeval /*presentationTime*/,
+		     unsigned /*durationInMicroseconds*/) {
+  fInputBufferDataEnd += frameSize;
+
+  // Process the new data:
+  doGetNextFrame();
+}
+
+Boolean MPEG2IFrameIndexFromTransportStream
+::analyzeTransportPacket(unsigned char* pkt, Boolean tablesAndPCROnly) {
+  if (pkt[0] != TRANSPORT_SYNC_BYTE) {
+    envir() << "Bad TS sync byte: 0x" << pkt[0] << "\n";
     // Handle this as if the source ended:
     handleInputClosure1();
-    return;
+    return False;
   }
 
-  ++fInputTransportPacketCounter;
+  if (!tablesAndPCROnly) ++fInputTransportPacketCounter;
 
   // Figure out how much of this Transport Packet contains PES data:
-  u_int8_t adaptation_field_control = (fInputBuffer[3]&0x30)>>4;
+  u_int8_t adaptation_field_control = (pkt[3]&0x30)>>4;
   u_int8_t totalHeaderSize
-    = adaptation_field_control <= 1 ? 4 : 5 + fInputBuffer[4];
+    = adaptation_field_control <= 1 ? 4 : 5 + pkt[4];
   if ((adaptation_field_control == 2 && totalHeaderSize != TRANSPORT_PACKET_SIZE) ||
       (adaptation_field_control == 3 && totalHeaderSize >= TRANSPORT_PACKET_SIZE)) {
-    envir() << "Bad \"adaptation_field_length\": " << fInputBuffer[4] << "\n";
-    doGetNextFrame();
-    return;
+    envir() << "Bad \"adaptation_field_length\": " << pkt[4] << "\n";
+    return True;
   }
 
   // Check for a PCR:
-  if (totalHeaderSize > 5 && (fInputBuffer[5]&0x10) != 0) {
+  if (totalHeaderSize > 5 && (pkt[5]&0x10) != 0) {
     // There's a PCR:
     u_int32_t pcrBaseHigh
-      = (fInputBuffer[6]<<24)|(fInputBuffer[7]<<16)
-      |(fInputBuffer[8]<<8)|fInputBuffer[9];
+      = (pkt[6]<<24)|(pkt[7]<<16)
+      |(pkt[8]<<8)|pkt[9];
     float pcr = pcrBaseHigh/45000.0f;
-    if ((fInputBuffer[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
-    unsigned short pcrExt = ((fInputBuffer[10]&0x01)<<8) | fInputBuffer[11];
+    if ((pkt[10]&0x80) != 0) pcr += 1/90000.0f; // add in low-bit (if set)
+    unsigned short pcrExt = ((pkt[10]&0x01)<<8) | pkt[11];
     pcr += pcrExt/27000000.0f;
 
     if (!fHaveSeenFirstPCR) {
@@ -227,59 +297,68 @@ void MPEG2IFrameIndexFromTransportStream
     } else if (pcr < fLastPCR) {
       // The PCR timestamp has gone backwards.  Display a warning about this
       // (because it indicates buggy Transport Stream data), and compensate for it.
-      envir() << "\nWarning: At about " << fLastPCR-fFirstPCR
-	      << " seconds into the file, the PCR timestamp decreased - from "
-	      << fLastPCR << " to " << pcr << "\n";
+      if (fPCRHandler == NULL) {
+	envir() << "\nWarning: At about " << fLastPCR-fFirstPCR
+		<< " seconds into the file, the PCR timestamp decreased - from "
+		<< fLastPCR << " to " << pcr << "\n";
+      }
       fFirstPCR -= (fLastPCR - pcr);
     }
     fLastPCR = pcr;
+    if (fPCRHandler != NULL && !tablesAndPCROnly) (*fPCRHandler)(fPCRHandlerClientData, fInputTransportPacketCounter, pcr);
   }
 
   // Get the PID from the packet, and check for special tables: the PAT and PMT:
-  u_int16_t PID = ((fInputBuffer[1]&0x1F)<<8) | fInputBuffer[2];
+  u_int16_t PID = ((pkt[1]&0x1F)<<8) | pkt[2];
   if (PID == PAT_PID) {
-    analyzePAT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    analyzePAT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
   } else if (PID == fPMT_PID) {
-    analyzePMT(&fInputBuffer[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
+    analyzePMT(&pkt[totalHeaderSize], TRANSPORT_PACKET_SIZE-totalHeaderSize);
   }
+  if (tablesAndPCROnly) return True;
 
   // Ignore transport packets for non-video programs,
   // or packets with no data, or packets that duplicate the previous packet:
-  u_int8_t continuity_counter = fInputBuffer[3]&0x0F;
+  u_int8_t continuity_counter = pkt[3]&0x0F;
   if ((PID != fVideo_PID) ||
       !(adaptation_field_control == 1 || adaptation_field_control == 3) ||
       continuity_counter == fLastContinuityCounter) {
-    doGetNextFrame();
-    return;
+    return True;
   }
   fLastContinuityCounter = continuity_counter;
 
   // Also, if this is the start of a PES packet, then skip over the PES header:
-  Boolean payload_unit_start_indicator = (fInputBuffer[1]&0x40) != 0;
+  Boolean payload_unit_start_indicator = (pkt[1]&0x40) != 0;
   if (payload_unit_start_indicator && totalHeaderSize < TRANSPORT_PACKET_SIZE - 8 
-      && fInputBuffer[totalHeaderSize] == 0x00 && fInputBuffer[totalHeaderSize+1] == 0x00
-      && fInputBuffer[totalHeaderSize+2] == 0x01) {
-    u_int8_t PES_header_data_length = fInputBuffer[totalHeaderSize+8];
+      && pkt[totalHeaderSize] == 0x00 && pkt[totalHeaderSize+1] == 0x00
+      && pkt[totalHeaderSize+2] == 0x01) {
+    u_int8_t PES_header_data_length = pkt[totalHeaderSize+8];
     totalHeaderSize += 9 + PES_header_data_length;
     if (totalHeaderSize >= TRANSPORT_PACKET_SIZE) {
       envir() << "Unexpectedly large PES header size: " << PES_header_data_length << "\n";
       // Handle this as if the source ended:
       handleInputClosure1();
-      return;
+      return False;
+    }
+  }
+
+  // If we're resuming indexing, then skip over any data (in the first packet) that has already been indexed:
+  if (fFirstPacketStartOffset > 0) {
+    if (fFirstPacketStartOffset > totalHeaderSize && fFirstPacketStartOffset < TRANSPORT_PACKET_SIZE) {
+      totalHeaderSize = fFirstPacketStartOffset;
     }
+    fFirstPacketStartOffset = 0;
   }
 
   // The remaining data is Video Elementary Stream data.  Add it to our parse buffer:
   unsigned vesSize = TRANSPORT_PACKET_SIZE - totalHeaderSize;
-  memmove(&fParseBuffer[fParseBufferDataEnd], &fInputBuffer[totalHeaderSize], vesSize);
+  memmove(&fParseBuffer[fParseBufferDataEnd], &pkt[totalHeaderSize], vesSize);
   fParseBufferDataEnd += vesSize;
 
   // And add a new index record noting where it came from:
   addToTail(new IndexRecord(totalHeaderSize, vesSize, fInputTransportPacketCounter,
 			    fLastPCR - fFirstPCR));
-
-  // Try again:
-  doGetNextFrame();
+  return True;
 }
 
 void MPEG2IFrameIndexFromTransportStream::handleInputClosure(void* clientData) {
@@ -362,58 +441,62 @@ void MPEG2IFrameIndexFromTransportStream
   }
 }
 
-Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecord() {
-  IndexRecord* head = fHeadIndexRecord;
-  if (head == NULL) return False;
-
-  // Check whether the head record has been parsed yet:
-  if (head->recordType() == RECORD_UNPARSED) return False;
-
-  // Remove the head record (the one whose data we'll be delivering):
-  IndexRecord* next = head->next();
-  head->unlink();
-  if (next == head) {
-    fHeadIndexRecord = fTailIndexRecord = NULL;
-  } else {
-    fHeadIndexRecord = next;
-  }
-
-  if (head->recordType() == RECORD_JUNK) {
-    // Don't actually deliver the data to the client:
-    delete head;
-    // Try to deliver the next record instead:
-    return deliverIndexRecord();
-  }
+Boolean MPEG2IFrameIndexFromTransportStream::deliverIndexRecords() {
+  // Deliver as many (already-parsed) index records as will fit in the client's buffer:
+  Boolean haveDeliveredRecords = False;
+  fFrameSize = 0;
+  while (1) {
+    IndexRecord* head = fHeadIndexRecord;
+    if (head == NULL) break;
+
+    // Check whether the head record has been parsed yet:
+    if (head->recordType() == RECORD_UNPARSED) break;
+
+    // Check whether there's room for this record (unless it's the first, or is junk):
+    if (head->recordType() != RECORD_JUNK && haveDeliveredRecords && fFrameSize + 11 > fMaxSize) break;
+
+    // Remove the head record (the one whose data we'll be delivering):
+    IndexRecord* next = head->next();
+    head->unlink();
+    if (next == head) {
+      fHeadIndexRecord = fTailIndexRecord = NULL;
+    } else {
+      fHeadIndexRecord = next;
+    }
 
-  // Deliver data from the head record:
+    if (head->recordType() != RECORD_JUNK) { // Don't actually deliver junk data to the client
+      // Deliver data from the head record:
 #ifdef DEBUG
-  envir() << "delivering: " << *head << "\n";
+      envir() << "delivering: " << *head << "\n";
 #endif
-  if (fMaxSize < 11) {
-    fFrameSize = 0;
-  } else {
-    fTo[0] = (u_int8_t)(head->recordType());
-    fTo[1] = head->startOffset();
-    fTo[2] = head->size();
-    // Deliver the PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part)
-    float pcr = head->pcr();
-    unsigned pcr_int = (unsigned)pcr;
-    u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
-    fTo[3] = (unsigned char)(pcr_int);
-    fTo[4] = (unsigned char)(pcr_int>>8);
-    fTo[5] = (unsigned char)(pcr_int>>16);
-    fTo[6] = (unsigned char)(pcr_frac);
-    // Deliver the transport packet number (in little-endian order):
-    unsigned long tpn = head->transportPacketNumber();
-    fTo[7] = (unsigned char)(tpn);
-    fTo[8] = (unsigned char)(tpn>>8);
-    fTo[9] = (unsigned char)(tpn>>16);
-    fTo[10] = (unsigned char)(tpn>>24);
-    fFrameSize = 11;
-  }
+      if (fMaxSize >= 11) {
+	u_int8_t* to = &fTo[fFrameSize];
+	to[0] = (u_int8_t)(head->recordType());
+	to[1] = head->startOffset();
+	to[2] = head->size();
+	// Deliver the PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part)
+	float pcr = head->pcr();
+	unsigned pcr_int = (unsigned)pcr;
+	u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
+	to[3] = (unsigned char)(pcr_int);
+	to[4] = (unsigned char)(pcr_int>>8);
+	to[5] = (unsigned char)(pcr_int>>16);
+	to[6] = (unsigned char)(pcr_frac);
+	// Deliver the transport packet number (in little-endian order):
+	unsigned long tpn = head->transportPacketNumber();
+	to[7] = (unsigned char)(tpn);
+	to[8] = (unsigned char)(tpn>>8);
+	to[9] = (unsigned char)(tpn>>16);
+	to[10] = (unsigned char)(tpn>>24);
+	fFrameSize += 11;
+      }
+      haveDeliveredRecords = True;
+    }
 
-  // Free the (former) head record (as we're now done with it):
-  delete head;
+    // Free the (former) head record (as we're now done with it):
+    delete head;
+  }
+  if (!haveDeliveredRecords) return False;
 
   // Complete delivery to the client:
   afterGetting(this);
@@ -559,14 +642,20 @@ Boolean MPEG2IFrameIndexFromTransportStream::parseFrame() {
   envir() << "parsed " << recordTypeStr[curRecordType] << "; length "
 	  << frameSize << "\n";
 #endif
-  for (IndexRecord* r = fHeadIndexRecord; ; r = r->next()) {
+  // The frame's index records are the unparsed records at the end of our queue.  (Any records before these are for
+  // earlier frames that we haven't yet delivered.)
+  IndexRecord* firstRecord = fTailIndexRecord;
+  while (firstRecord != fHeadIndexRecord && firstRecord->prev()->recordType() == RECORD_UNPARSED) {
+    firstRecord = firstRecord->prev();
+  }
+  for (IndexRecord* r = firstRecord; ; r = r->next()) {
     if (numInitialBadBytes >= r->size()) {
       r->recordType() = RECORD_JUNK;
       numInitialBadBytes -= r->size();
     } else {
       r->recordType() = curRecordType;
     }
-    if (r == fHeadIndexRecord) r->setFirstFlag();
+    if (r == firstRecord) r->setFirstFlag();
     // indicates that this is the first record for this frame
 
     if (r->size() > frameSize) {
@@ -214,6 +214,30 @@ float MPEG2TransportFileServerMediaSubsession::duration() const {
   return fDuration;
 }
 
+char const* MPEG2TransportFileServerMediaSubsession
+::getFileByteRange(double seekNPT, double streamDuration, u_int64_t& startByte, u_int64_t& numBytes) {
+  startByte = numBytes = 0;
+  if (fIndexFile == NULL || streamDuration <= 0.0) return NULL;
+
+  // Use the index file to find the range of Transport Packets that "ClientTrickPlayState::updateStateFromNPT()"
+  // would have us stream (from the original file) for the same request:
+  float npt = (float)seekNPT;
+  unsigned long tsRecordNum, ixRecordNum;
+  fIndexFile->lookupTSPacketNumFromNPT(npt, tsRecordNum, ixRecordNum);
+
+  streamDuration += seekNPT - (double)npt;
+  if (streamDuration <= 0.0) return NULL;
+
+  float toNPT = (float)(npt + streamDuration);
+  unsigned long toTSRecordNum, toIxRecordNum;
+  fIndexFile->lookupTSPacketNumFromNPT(toNPT, toTSRecordNum, toIxRecordNum);
+  if (toTSRecordNum <= tsRecordNum) return NULL;
+
+  startByte = (u_int64_t)tsRecordNum*TRANSPORT_PACKET_SIZE;
+  numBytes = (u_int64_t)(toTSRecordNum - tsRecordNum)*TRANSPORT_PACKET_SIZE;
+  return fFileName;
+}
+
 ClientTrickPlayState* MPEG2TransportFileServerMediaSubsession
 ::lookupClient(unsigned clientSessionId) {
   return (ClientTrickPlayState*)(fClientSessionHashTable->Lookup((char const*)clientSessionId));
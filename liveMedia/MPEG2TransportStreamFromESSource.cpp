@@ -23,7 +23,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define SIMPLE_PES_HEADER_SIZE 14
 #define INPUT_BUFFER_SIZE (SIMPLE_PES_HEADER_SIZE + 2*MPEG2TransportStreamFromESSource::maxInputESFrameSize)
-#define LOW_WATER_MARK 1000 // <= MPEG2TransportStreamFromESSource::maxInputESFrameSize
+#define DEFAULT_LOW_WATER_MARK 1000 // <= MPEG2TransportStreamFromESSource::maxInputESFrameSize
 
 ////////// InputESSourceRecord definition //////////
 
@@ -97,10 +97,15 @@ MPEG2TransportStreamFromESSource
 ::MPEG2TransportStreamFromESSource(UsageEnvironment& env)
   : MPEG2TransportStreamMultiplexor(env),
     fInputSources(NULL), fVideoSourceCounter(0), fAudioSourceCounter(0),
-    fAwaitingBackgroundDelivery(False) {
+    fAwaitingBackgroundDelivery(False), fLowWaterMark(DEFAULT_LOW_WATER_MARK) {
   fHaveVideoStreams = False; // unless we add a video source
 }
 
+void MPEG2TransportStreamFromESSource::setOneFramePerPESPacket(Boolean oneFramePerPESPacket) {
+  // A PES packet that contains (at least) one byte of frame data is big enough to deliver:
+  fLowWaterMark = oneFramePerPESPacket ? SIMPLE_PES_HEADER_SIZE+1 : DEFAULT_LOW_WATER_MARK;
+}
+
 MPEG2TransportStreamFromESSource::~MPEG2TransportStreamFromESSource() {
   doStopGettingFrames();
   delete fInputSources;
@@ -187,7 +192,7 @@ void InputESSourceRecord::askForNewData() {
     // fInputBuffer[9..13] will be the PTS; fill this in later
     fInputBufferBytesAvailable = SIMPLE_PES_HEADER_SIZE;
   }
-  if (fInputBufferBytesAvailable < LOW_WATER_MARK &&
+  if (fInputBufferBytesAvailable < fParent.fLowWaterMark &&
       !fInputSource->isCurrentlyAwaitingData()) {
     // We don't yet have enough data in our buffer.  Arrange to read more:
     fInputSource->getNextFrame(&fInputBuffer[fInputBufferBytesAvailable],
@@ -198,7 +203,7 @@ void InputESSourceRecord::askForNewData() {
 }
 
 Boolean InputESSourceRecord::deliverBufferToClient() {
-  if (fInputBufferInUse || fInputBufferBytesAvailable < LOW_WATER_MARK) return False;
+  if (fInputBufferInUse || fInputBufferBytesAvailable < fParent.fLowWaterMark) return False;
 
   // Fill in the PES_packet_length field that we left unset before:
   unsigned PES_packet_length = fInputBufferBytesAvailable - 6;
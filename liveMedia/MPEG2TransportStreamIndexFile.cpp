@@ -23,14 +23,143 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MPEG2TransportStreamIndexFile.hh"
 #include "InputFile.hh"
+#include <sys/stat.h>
+#include <string.h>
+
+////////// IndexFileData //////////
+
+// The contents of an index file, read into memory.  These are shared (and reference-counted) by all
+// "MPEG2TransportStreamIndexFile" objects (within the same "UsageEnvironment") that use the same file.
+// We also remember the file's size and modification time, so that if the file later changes (e.g., because
+// it is being appended to), then subsequently-created "MPEG2TransportStreamIndexFile"s will reread it.
+
+class IndexFileData {
+public:
+  static IndexFileData* lookup(UsageEnvironment& env, char const* indexFileName);
+      // returns NULL if the file doesn't exist, or is too large to be cached
+  void release();
+
+  unsigned char const* data() const { return fData; }
+  u_int64_t size() const { return fSize; }
+
+private:
+  IndexFileData(UsageEnvironment& env, char const* indexFileName,
+		time_t modificationTime, u_int64_t size);
+  virtual ~IndexFileData();
+
+  Boolean isCurrent(time_t modificationTime, u_int64_t size) const {
+    return fModificationTime == modificationTime && fSize == size;
+  }
+
+private:
+  UsageEnvironment& fEnv;
+  char* fFileName;
+  time_t fModificationTime;
+  u_int64_t fSize;
+  unsigned char* fData;
+  unsigned fReferenceCount;
+  Boolean fIsInTable;
+};
+
+static HashTable* indexFileTable(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->tsIndexFileTable == NULL) {
+    // Create a new index file name -> "IndexFileData" mapping table:
+    ourTables->tsIndexFileTable = HashTable::create(STRING_HASH_KEYS);
+  }
+  return (HashTable*)(ourTables->tsIndexFileTable);
+}
+
+static void reclaimIndexFileTableIfPossible(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  if (ourTables == NULL) return;
+
+  HashTable* table = (HashTable*)(ourTables->tsIndexFileTable);
+  if (table != NULL && table->IsEmpty()) {
+    // We can also delete the table (to reclaim space):
+    delete table;
+    ourTables->tsIndexFileTable = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
+IndexFileData* IndexFileData::lookup(UsageEnvironment& env, char const* indexFileName) {
+  struct stat sb;
+  if (stat(indexFileName, &sb) != 0 || (sb.st_mode&S_IFMT) != S_IFREG) return NULL;
+  u_int64_t size = (u_int64_t)sb.st_size;
+  if (size == 0 || size > MAX_CACHED_INDEX_FILE_SIZE) return NULL;
+
+  HashTable* table = indexFileTable(env);
+  IndexFileData* data = (IndexFileData*)(table->Lookup(indexFileName));
+  if (data != NULL && !data->isCurrent(sb.st_mtime, size)) {
+    // The file has changed since we read it.  Forget about our old copy (it'll get
+    // deleted once it's no longer being used), and read the file again:
+    table->Remove(indexFileName);
+    data->fIsInTable = False;
+    if (data->fReferenceCount == 0) delete data;
+    data = NULL;
+  }
+
+  if (data == NULL) {
+    data = new IndexFileData(env, indexFileName, sb.st_mtime, size);
+    if (data->fData == NULL) { // we couldn't read the file
+      delete data;
+      reclaimIndexFileTableIfPossible(env);
+      return NULL;
+    }
+    table->Add(indexFileName, data);
+    data->fIsInTable = True;
+  }
+
+  ++data->fReferenceCount;
+  return data;
+}
+
+void IndexFileData::release() {
+  if (fReferenceCount > 0) --fReferenceCount;
+  if (fReferenceCount > 0) return;
+
+  UsageEnvironment& env = fEnv;
+  if (fIsInTable) {
+    HashTable* table = indexFileTable(env);
+    table->Remove(fFileName);
+  }
+  delete this;
+  reclaimIndexFileTableIfPossible(env);
+}
+
+IndexFileData::IndexFileData(UsageEnvironment& env, char const* indexFileName,
+			     time_t modificationTime, u_int64_t size)
+  : fEnv(env), fFileName(strDup(indexFileName)), fModificationTime(modificationTime), fSize(size),
+    fData(NULL), fReferenceCount(0), fIsInTable(False) {
+  FILE* fid = OpenInputFile(env, indexFileName);
+  if (fid == NULL) return;
+
+  fData = new unsigned char[(size_t)size];
+  if (fread(fData, 1, (size_t)size, fid) != (size_t)size) {
+    delete[] fData; fData = NULL;
+  }
+  CloseInputFile(fid);
+}
+
+IndexFileData::~IndexFileData() {
+  delete[] fData;
+  delete[] fFileName;
+}
+
+
+////////// MPEG2TransportStreamIndexFile //////////
 
 MPEG2TransportStreamIndexFile
 ::MPEG2TransportStreamIndexFile(UsageEnvironment& env, char const* indexFileName)
   : Medium(env),
-    fFileName(strDup(indexFileName)), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
+    fFileName(strDup(indexFileName)), fData(NULL), fFid(NULL), fMPEGVersion(0), fCurrentIndexRecordNum(0),
     fCachedPCR(0.0f), fCachedTSPacketNumber(0), fNumIndexRecords(0) {
+  // If possible, use an in-memory copy of the file's contents (shared with others who use the same file):
+  fData = IndexFileData::lookup(env, indexFileName);
+
   // Get the file size, to determine how many index records it contains:
-  u_int64_t indexFileSize = GetFileSize(indexFileName, NULL);
+  u_int64_t indexFileSize = fData != NULL ? fData->size() : GetFileSize(indexFileName, NULL);
   if (indexFileSize % INDEX_RECORD_SIZE != 0) {
     env << "Warning: Size of the index file \"" << indexFileName
  	<< "\" (" << (unsigned)indexFileSize
@@ -57,6 +186,7 @@ MPEG2TransportStreamIndexFile* MPEG2TransportStreamIndexFile
 
 MPEG2TransportStreamIndexFile::~MPEG2TransportStreamIndexFile() {
   closeFid();
+  if (fData != NULL) fData->release();
   delete[] fFileName;
 }
 
@@ -246,6 +376,13 @@ Boolean MPEG2TransportStreamIndexFile::seekToIndexRecord(unsigned long indexReco
 }
 
 Boolean MPEG2TransportStreamIndexFile::readIndexRecord(unsigned long indexRecordNum) {
+  if (fData != NULL) {
+    // Copy the record from memory:
+    if (indexRecordNum >= fNumIndexRecords) return False;
+    memmove(fBuf, &fData->data()[indexRecordNum*INDEX_RECORD_SIZE], INDEX_RECORD_SIZE);
+    return True;
+  }
+
   do {
     if (!seekToIndexRecord(indexRecordNum)) break;
     if (fread(fBuf, INDEX_RECORD_SIZE, 1, fFid) != 1) break;
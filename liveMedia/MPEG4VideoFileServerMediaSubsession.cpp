@@ -35,11 +35,13 @@ MPEG4VideoFileServerMediaSubsession
 ::MPEG4VideoFileServerMediaSubsession(UsageEnvironment& env,
                                       char const* fileName, Boolean reuseFirstSource)
   : FileServerMediaSubsession(env, fileName, reuseFirstSource),
-    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL) {
+    fAuxSDPLine(NULL), fDoneFlag(0), fDummyRTPSink(NULL), fHaveReadConfig(False),
+    fProfileAndLevelIndication(0), fConfigStr(NULL) {
 }
 
 MPEG4VideoFileServerMediaSubsession::~MPEG4VideoFileServerMediaSubsession() {
   delete[] fAuxSDPLine;
+  delete[] fConfigStr;
 }
 
 static void afterPlayingDummy(void* clientData) {
@@ -85,6 +87,13 @@ void MPEG4VideoFileServerMediaSubsession::checkForAuxSDPLine1() {
 char const* MPEG4VideoFileServerMediaSubsession::getAuxSDPLine(RTPSink* rtpSink, FramedSource* inputSource) {
   if (fAuxSDPLine != NULL) return fAuxSDPLine; // it's already been set up (for a previous client)
 
+  // If "createNewRTPSink()" was able to read our 'config' information directly from the file, then "rtpSink" already knows it:
+  char const* asl = rtpSink->auxSDPLine();
+  if (asl != NULL) {
+    fAuxSDPLine = strDup(asl);
+    return fAuxSDPLine;
+  }
+
   if (fDummyRTPSink == NULL) { // we're not already setting it up for another, concurrent stream
     // Note: For MPEG-4 video files, the 'config' information isn't known
     // until we start reading the file.  This means that "rtpSink"s
@@ -121,6 +130,23 @@ RTPSink* MPEG4VideoFileServerMediaSubsession
 ::createNewRTPSink(Groupsock* rtpGroupsock,
 		   unsigned char rtpPayloadTypeIfDynamic,
 		   FramedSource* /*inputSource*/) {
+  if (!fHaveReadConfig) {
+    // Try to read our 'config' information (the VOS, VO and VOL headers) directly from the start of the file.  If we can
+    // do this, then the "RTPSink" can generate our "a=fmtp:" line immediately - without our having to play the file through it:
+    unsigned char* configBytes; unsigned numConfigBytes;
+    if (readMPEG4VideoConfigFromFile(envir(), fFileName, fProfileAndLevelIndication, configBytes, numConfigBytes)) {
+      fConfigStr = new char[2*numConfigBytes + 1];
+      for (unsigned i = 0; i < numConfigBytes; ++i) sprintf(&fConfigStr[2*i], "%02X", configBytes[i]);
+      fConfigStr[2*numConfigBytes] = '\0';
+      delete[] configBytes;
+    }
+    fHaveReadConfig = True;
+  }
+
+  if (fConfigStr != NULL) {
+    return MPEG4ESVideoRTPSink::createNew(envir(), rtpGroupsock, rtpPayloadTypeIfDynamic, 90000,
+					  fProfileAndLevelIndication, fConfigStr);
+  }
   return MPEG4ESVideoRTPSink::createNew(envir(), rtpGroupsock,
 					rtpPayloadTypeIfDynamic);
 }
@@ -26,6 +26,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MPEG4VideoStreamFramer.hh"
 #include "MPEGVideoStreamParser.hh"
 #include "MPEG4LATMAudioRTPSource.hh" // for "parseGeneralConfigStr()"
+#include "InputFile.hh"
 #include <string.h>
 
 ////////// MPEG4VideoStreamParser definition //////////
@@ -679,3 +680,81 @@ unsigned MPEG4VideoStreamParser::parseVisualObjectSequenceEndCode() {
 
   return curFrameSize();
 }
+
+////////// readMPEG4VideoConfigFromFile() implementation //////////
+
+Boolean readMPEG4VideoConfigFromFile(UsageEnvironment& env, char const* fileName,
+				     u_int8_t& profileAndLevelIndication,
+				     unsigned char*& configBytes, unsigned& numConfigBytes,
+				     unsigned maxBytesToRead) {
+  profileAndLevelIndication = 0;
+  configBytes = NULL;
+  numConfigBytes = 0;
+
+  FILE* fid = OpenInputFile(env, fileName);
+  if (fid == NULL) return False;
+
+  // Read the file in small chunks, scanning for start codes as they arrive.  As in "MPEG4VideoStreamParser", the
+  // 'configuration' information begins with a VISUAL_OBJECT_SEQUENCE_START_CODE, and ends at the first
+  // GROUP_VOP_START_CODE or VOP_START_CODE that follows it:
+  unsigned const chunkSize = 4096;
+  unsigned bufMaxSize = chunkSize < maxBytesToRead ? chunkSize : maxBytesToRead;
+  unsigned char* buf = new unsigned char[bufMaxSize];
+  unsigned bufSize = 0;
+  unsigned scanPos = 0; // the next position in "buf" to check for a start code
+  unsigned configStart = 0; // valid iff "haveStart"
+  Boolean haveStart = False;
+  Boolean haveAll = False;
+  Boolean atEOF = False;
+
+  while (!haveAll && !atEOF && bufSize < maxBytesToRead) {
+    if (bufSize == bufMaxSize) {
+      // Double the size of our buffer (but not beyond "maxBytesToRead"):
+      unsigned newBufMaxSize = 2*bufMaxSize < maxBytesToRead ? 2*bufMaxSize : maxBytesToRead;
+      unsigned char* newBuf = new unsigned char[newBufMaxSize];
+      memmove(newBuf, buf, bufSize);
+      delete[] buf;
+      buf = newBuf; bufMaxSize = newBufMaxSize;
+    }
+
+    unsigned numBytesToRead = bufMaxSize - bufSize;
+    if (numBytesToRead > chunkSize) numBytesToRead = chunkSize;
+    unsigned numBytesRead = fread(&buf[bufSize], 1, numBytesToRead, fid);
+    if (numBytesRead == 0) atEOF = True;
+    bufSize += numBytesRead;
+
+    while (scanPos + 5 <= bufSize) { // a start code, plus the "profile_and_level_indication" byte that may follow it
+      if (!(buf[scanPos] == 0 && buf[scanPos+1] == 0 && buf[scanPos+2] == 1)) {
+	++scanPos;
+	continue;
+      }
+
+      u_int32_t startCode = 0x00000100|buf[scanPos+3];
+      if (!haveStart) {
+	if (startCode == VISUAL_OBJECT_SEQUENCE_START_CODE) {
+	  configStart = scanPos;
+	  profileAndLevelIndication = buf[scanPos+4];
+	  haveStart = True;
+	}
+      } else if (startCode == GROUP_VOP_START_CODE || startCode == VOP_START_CODE) {
+	numConfigBytes = scanPos - configStart;
+	configBytes = new unsigned char[numConfigBytes];
+	memmove(configBytes, &buf[configStart], numConfigBytes);
+	haveAll = True;
+	break;
+      }
+      scanPos += 4;
+    }
+  }
+
+  delete[] buf;
+  CloseInputFile(fid);
+
+  if (!haveAll || profileAndLevelIndication == 0) {
+    delete[] configBytes; configBytes = NULL;
+    numConfigBytes = 0;
+    profileAndLevelIndication = 0;
+    return False;
+  }
+  return True;
+}
@@ -25,6 +25,10 @@ void MatroskaDemuxedTrack::seekToTime(double& seekNPT) {
   fOurSourceDemux.seekToTime(seekNPT);
 }
 
+void MatroskaDemuxedTrack::setScale(float scale) {
+  fOurSourceDemux.setScale(scale);
+}
+
 MatroskaDemuxedTrack::MatroskaDemuxedTrack(UsageEnvironment& env, unsigned trackNumber, MatroskaDemux& sourceDemux)
   : FramedSource(env),
     fOurTrackNumber(trackNumber), fOurSourceDemux(sourceDemux), fDurationImbalance(0),
@@ -30,6 +30,8 @@ class MatroskaDemux; // forward
 class MatroskaDemuxedTrack: public FramedSource {
 public:
   void seekToTime(double& seekNPT);
+  void setScale(float scale);
+    // If "scale" != 1, and our file supports it, then deliver (on our file's video track) only 'key frames'
 
 private: // We are created only by a MatroskaDemux (a friend)
   friend class MatroskaDemux;
@@ -48,6 +48,8 @@ public:
     // (Note that this is a static member function because - as a result of tree rotation - "root" might change.)
 
   Boolean lookup(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
+  Boolean lookupNext(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
+    // Looks up the first cue point whose time is > "cueTime".  Returns False (leaving the parameters unchanged) if none exists.
 
   static void fprintf(FILE* fid, CuePoint* cuePoint); // used for debugging; it's static to allow for "cuePoint == NULL"
 
@@ -244,6 +246,15 @@ float MatroskaFile::fileDuration() {
   return segmentDuration()*(timecodeScale()/1000000000.0f);
 }
 
+Boolean MatroskaFile::supportsTrickPlay() {
+  if (fCuePoints == NULL) return False;
+
+  MatroskaTrack* track = lookup(fChosenVideoTrackNumber);
+  if (track == NULL) return False;
+
+  return strcmp(track->mimeType, "video/H264") == 0 || strcmp(track->mimeType, "video/H265") == 0;
+}
+
 FramedSource* MatroskaFile
 ::createSourceForStreaming(FramedSource* baseSource, unsigned trackNumber,
 			   unsigned& estBitrate, unsigned& numFiltersInFrontOfTrack) {
@@ -611,6 +622,12 @@ Boolean MatroskaFile::lookupCuePoint(double& cueTime, u_int64_t& resultClusterOf
   return True;
 }
 
+Boolean MatroskaFile::lookupNextCuePoint(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster) {
+  if (fCuePoints == NULL) return False;
+
+  return fCuePoints->lookupNext(cueTime, resultClusterOffsetInFile, resultBlockNumWithinCluster);
+}
+
 void MatroskaFile::printCuePoints(FILE* fid) {
   CuePoint::fprintf(fid, fCuePoints);
 }
@@ -749,6 +766,10 @@ void MatroskaDemux::seekToTime(double& seekNPT) {
   if (fOurParser != NULL) fOurParser->seekToTime(seekNPT);
 }
 
+void MatroskaDemux::setScale(float scale) {
+  if (fOurParser != NULL) fOurParser->setScale(scale);
+}
+
 void MatroskaDemux::handleEndOfFile(void* clientData) {
   ((MatroskaDemux*)clientData)->handleEndOfFile();
 }
@@ -866,6 +887,20 @@ Boolean CuePoint::lookup(double& cueTime, u_int64_t& resultClusterOffsetInFile,
   }
 }
 
+Boolean CuePoint::lookupNext(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster) {
+  if (cueTime < fCueTime) {
+    if (left() == NULL || !left()->lookupNext(cueTime, resultClusterOffsetInFile, resultBlockNumWithinCluster)) {
+      // Use this record:
+      cueTime = fCueTime;
+      resultClusterOffsetInFile = fClusterOffsetInFile;
+      resultBlockNumWithinCluster = fBlockNumWithinCluster;
+    }
+    return True;
+  } else {
+    return right() != NULL && right()->lookupNext(cueTime, resultClusterOffsetInFile, resultBlockNumWithinCluster);
+  }
+}
+
 void CuePoint::fprintf(FILE* fid, CuePoint* cuePoint) {
   if (cuePoint != NULL) {
     ::fprintf(fid, "[");
@@ -31,9 +31,11 @@ MatroskaFileParser::MatroskaFileParser(MatroskaFile& ourFile, FramedSource* inpu
     fOnEndFunc(onEndFunc), fOnEndClientData(onEndClientData),
     fOurDemux(ourDemux),
     fCurOffsetInFile(0), fSavedCurOffsetInFile(0), fLimitOffsetInFile(0),
-    fNumHeaderBytesToSkip(0), fClusterTimecode(0), fBlockTimecode(0),
+    fNumHeaderBytesToSkip(0), fClusterTimecode(0), fBlockIsSimpleBlock(False), fBlockTimecode(0),
     fFrameSizesWithinBlock(NULL),
-    fPresentationTimeOffset(0.0) {
+    fPresentationTimeOffset(0.0),
+    fScale(1.0f), fTrickPlayNPT(0.0), fTrickPlayPresentationTime(0.0), fTrickPlayFrameDuration(0),
+    fHaveNextTrickPlayKeyFrame(False), fNextTrickPlayNPT(0.0), fNextTrickPlayClusterOffsetInFile(0) {
   if (ourDemux == NULL) {
     // Initialization
     fCurrentParseState = PARSING_START_OF_FILE;
@@ -82,6 +84,30 @@ void MatroskaFileParser::seekToTime(double& seekNPT) {
     fCurrentParseState = LOOKING_FOR_BLOCK;
     // LATER handle "blockNumWithinCluster"; for now, we assume that it's 0 #####
   }
+  fTrickPlayNPT = seekNPT;
+}
+
+void MatroskaFileParser::setScale(float scale) {
+  if (fOurDemux == NULL) return;
+
+  // 'Trick play' is possible only if our file supports it, and we're delivering its (chosen) video track:
+  if (scale != 1.0f
+      && (!fOurFile.supportsTrickPlay() || fOurDemux->lookupDemuxedTrack(fOurFile.chosenVideoTrackNumber()) == NULL)) {
+    scale = 1.0f;
+  }
+  if (scale == fScale) return;
+
+  double curNPT = fScale != 1.0f ? fTrickPlayNPT
+    : (fClusterTimecode+fBlockTimecode)*(fOurFile.fTimecodeScale/1000000000.0);
+#ifdef DEBUG
+  fprintf(stderr, "setScale(%f) (from %f), at NPT %f\n", scale, fScale, curNPT);
+#endif
+  fScale = scale;
+
+  // Re-align subsequent presentation times with 'wall clock' time, and resume (in the new mode) from the current NPT:
+  fPresentationTimeOffset = 0.0;
+  fTrickPlayPresentationTime = 0.0;
+  seekToTime(curNPT);
 }
 
 void MatroskaFileParser
@@ -701,6 +727,7 @@ void MatroskaFileParser::lookForNextBlock() {
       case MATROSKA_ID_SIMPLEBLOCK:
       case MATROSKA_ID_BLOCK: { // 'SimpleBlock' or 'Block' header: enter this (and we're done)
 	fBlockSize = (unsigned)size.val();
+	fBlockIsSimpleBlock = id == MATROSKA_ID_SIMPLEBLOCK;
 	fCurrentParseState = PARSING_BLOCK;
 	break;
       }
@@ -875,15 +902,16 @@ void MatroskaFileParser::parseBlock() {
 
     // If this track is not being read, then skip the rest of this block, and look for another one:
     if (fOurDemux->lookupDemuxedTrack(fBlockTrackNumber) == NULL) {
-      unsigned headerBytesSeen = curOffset() - blockStartPos;
-      if (headerBytesSeen < fBlockSize) {
-	skipBytes(fBlockSize - headerBytesSeen);
-      }
 #ifdef DEBUG
       fprintf(stderr, "\tSkipped block for unused track number %d\n", fBlockTrackNumber);
 #endif
-      fCurrentParseState = LOOKING_FOR_BLOCK;
-      setParseState();
+      skipRestOfBlock(blockStartPos);
+      return;
+    }
+
+    // Similarly, during 'trick play', skip blocks from tracks other than the video track:
+    if (fScale != 1.0f && fBlockTrackNumber != fOurFile.chosenVideoTrackNumber()) {
+      skipRestOfBlock(blockStartPos);
       return;
     }
 
@@ -893,8 +921,22 @@ void MatroskaFileParser::parseBlock() {
     // The next two bytes are the block's timecode (relative to the cluster timecode)
     fBlockTimecode = (get1Byte()<<8)|get1Byte();
 
-    // The next byte indicates the type of 'lacing' used:
+    // The next byte indicates the type of 'lacing' used (and, for a 'SimpleBlock', whether it's a key frame):
     u_int8_t c = get1Byte();
+
+    if (fScale != 1.0f) {
+      // During 'trick play', we deliver only key frames.  (A 'Block' (within a 'Block Group') doesn't tell us
+      // whether it's a key frame, but we assume that it is, because we reached it by seeking to a cue point.)
+      if (fBlockIsSimpleBlock && (c&0x80) == 0) {
+#ifdef DEBUG
+	fprintf(stderr, "\tSkipped non-key frame during trick play\n");
+#endif
+	skipRestOfBlock(blockStartPos);
+	return;
+      }
+      prepareForNextTrickPlayKeyFrame((fClusterTimecode+fBlockTimecode)*(fOurFile.fTimecodeScale/1000000000.0));
+    }
+
     c &= 0x6; // we're interested in bits 5-6 only
     MatroskaLacingType lacingType = (c==0x0)?NoLacing : (c==0x02)?XiphLacing : (c==0x04)?FixedSizeLacing : EBMLLacing;
 #ifdef DEBUG
@@ -995,6 +1037,49 @@ void MatroskaFileParser::parseBlock() {
   fCurrentParseState = LOOKING_FOR_BLOCK;
 }
 
+void MatroskaFileParser::skipRestOfBlock(unsigned blockStartPos) {
+  unsigned headerBytesSeen = curOffset() - blockStartPos;
+  if (headerBytesSeen < fBlockSize) {
+    skipBytes(fBlockSize - headerBytesSeen);
+  }
+  fCurrentParseState = LOOKING_FOR_BLOCK;
+  setParseState();
+}
+
+void MatroskaFileParser::prepareForNextTrickPlayKeyFrame(double keyFrameNPT) {
+  // Each key frame that we deliver represents (roughly) this much 'output' time; this determines how far ahead (or behind)
+  // the next key frame is:
+  double const targetOutputTimePerKeyFrame = 0.25; // seconds
+
+  fTrickPlayNPT = keyFrameNPT;
+
+  double nextNPT = keyFrameNPT + fScale*targetOutputTimePerKeyFrame;
+  unsigned blockNumWithinCluster; // not used
+  if (fScale > 0.0f) {
+    fHaveNextTrickPlayKeyFrame
+      = fOurFile.lookupCuePoint(nextNPT, fNextTrickPlayClusterOffsetInFile, blockNumWithinCluster);
+    if (!fHaveNextTrickPlayKeyFrame || nextNPT <= keyFrameNPT) {
+      // There's no cue point in this interval, so use the first one after the current key frame:
+      nextNPT = keyFrameNPT;
+      fHaveNextTrickPlayKeyFrame
+	= fOurFile.lookupNextCuePoint(nextNPT, fNextTrickPlayClusterOffsetInFile, blockNumWithinCluster);
+    }
+  } else {
+    fHaveNextTrickPlayKeyFrame
+      = nextNPT >= 0.0 && fOurFile.lookupCuePoint(nextNPT, fNextTrickPlayClusterOffsetInFile, blockNumWithinCluster);
+  }
+
+  // Give this key frame a duration that reflects the NPT interval to the next key frame, divided by the scale:
+  double frameDuration = fHaveNextTrickPlayKeyFrame
+    ? (nextNPT - keyFrameNPT)/fScale : targetOutputTimePerKeyFrame;
+  if (frameDuration < 0.0) frameDuration = 0.0;
+  fTrickPlayFrameDuration = (unsigned)(frameDuration*1000000);
+  fNextTrickPlayNPT = nextNPT;
+#ifdef DEBUG
+  fprintf(stderr, "\ttrick play key frame at NPT %f; next at NPT %f (%s); duration %u us\n", keyFrameNPT, nextNPT, fHaveNextTrickPlayKeyFrame ? "found" : "none", fTrickPlayFrameDuration);
+#endif
+}
+
 Boolean MatroskaFileParser::deliverFrameWithinBlock() {
 #ifdef DEBUG
   fprintf(stderr, "delivering frame within SimpleBlock or Block\n");
@@ -1057,21 +1142,34 @@ Boolean MatroskaFileParser::deliverFrameWithinBlock() {
     // Compute the presentation time of this frame (from the cluster timecode, the block timecode, and the default duration):
     double pt = (fClusterTimecode+fBlockTimecode)*(fOurFile.fTimecodeScale/1000000000.0)
       + fNextFrameNumberToDeliver*(track->defaultDuration/1000000000.0);
-    if (fPresentationTimeOffset == 0.0) {
-      // This is the first time we've computed a presentation time.  Compute an offset to make the presentation times aligned
-      // with 'wall clock' time:
-      struct timeval timeNow;
-      gettimeofday(&timeNow, NULL);
-      double ptNow = timeNow.tv_sec + timeNow.tv_usec/1000000.0;
-      fPresentationTimeOffset = ptNow - pt;
+    if (fScale != 1.0f) {
+      // During 'trick play', presentation times advance in 'output' time (set from the key frames' durations):
+      if (fTrickPlayPresentationTime == 0.0) {
+	struct timeval timeNow;
+	gettimeofday(&timeNow, NULL);
+	fTrickPlayPresentationTime = timeNow.tv_sec + timeNow.tv_usec/1000000.0;
+      }
+      pt = fTrickPlayPresentationTime;
+    } else {
+      if (fPresentationTimeOffset == 0.0) {
+	// This is the first time we've computed a presentation time.  Compute an offset to make the presentation times aligned
+	// with 'wall clock' time:
+	struct timeval timeNow;
+	gettimeofday(&timeNow, NULL);
+	double ptNow = timeNow.tv_sec + timeNow.tv_usec/1000000.0;
+	fPresentationTimeOffset = ptNow - pt;
+      }
+      pt += fPresentationTimeOffset;
     }
-    pt += fPresentationTimeOffset;
     struct timeval presentationTime;
     presentationTime.tv_sec = (unsigned)pt;
     presentationTime.tv_usec = (unsigned)((pt - presentationTime.tv_sec)*1000000);
     unsigned durationInMicroseconds;
     if (specialFrameSource != NULL) {
       durationInMicroseconds = 0;
+    } else if (fScale != 1.0f) {
+      // During 'trick play', only the last frame of the (key frame) block gets a duration:
+      durationInMicroseconds = fNextFrameNumberToDeliver == fNumFramesInBlock-1 ? fTrickPlayFrameDuration : 0;
     } else { // normal case
       durationInMicroseconds = track->defaultDuration/1000;
       if (track->haveSubframes()) {
@@ -1083,7 +1181,7 @@ Boolean MatroskaFileParser::deliverFrameWithinBlock() {
       }
     }
 
-    if (track->defaultDuration == 0) {
+    if (track->defaultDuration == 0 && fScale == 1.0f) {
       // Adjust the frame duration to keep the sum of frame durations aligned with presentation times.
       if (demuxedTrack->prevPresentationTime().tv_sec != 0) { // not the first time for this track
 	demuxedTrack->durationImbalance()
@@ -1186,6 +1284,17 @@ void MatroskaFileParser::deliverFrameBytes() {
     if (fNextFrameNumberToDeliver == fNumFramesInBlock) {
       // We've delivered all of the frames from this block.  Look for another block next:
       fCurrentParseState = LOOKING_FOR_BLOCK;
+
+      if (fScale != 1.0f) {
+	// During 'trick play', the next block that we want is the key frame at the next chosen cue point (if any):
+	fTrickPlayPresentationTime += fTrickPlayFrameDuration/1000000.0;
+	if (fHaveNextTrickPlayKeyFrame) {
+	  seekToFilePosition(fNextTrickPlayClusterOffsetInFile);
+	  fTrickPlayNPT = fNextTrickPlayNPT;
+	} else {
+	  seekToEndOfFile();
+	}
+      }
     } else {
       fCurrentParseState = DELIVERING_FRAME_WITHIN_BLOCK;
     }
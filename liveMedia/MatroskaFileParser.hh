@@ -51,6 +51,7 @@ public:
   virtual ~MatroskaFileParser();
 
   void seekToTime(double& seekNPT);
+  void setScale(float scale);
 
   // StreamParser 'client continue' function:
   static void continueParsing(void* clientData, unsigned char* ptr, unsigned size, struct timeval presentationTime);
@@ -68,6 +69,8 @@ private:
 
   void lookForNextBlock();
   void parseBlock();
+  void skipRestOfBlock(unsigned blockStartPos);
+  void prepareForNextTrickPlayKeyFrame(double keyFrameNPT);
   Boolean deliverFrameWithinBlock();
   void deliverFrameBytes();
 
@@ -115,6 +118,7 @@ private:
 
   // Parameters of the most recently-parsed 'Block':
   unsigned fBlockSize;
+  Boolean fBlockIsSimpleBlock;
   unsigned fBlockTrackNumber;
   short fBlockTimecode;
   unsigned fNumFramesInBlock;
@@ -129,6 +133,15 @@ private:
   u_int8_t* fCurFrameTo;
   unsigned fCurFrameNumBytesToGet;
   unsigned fCurFrameNumBytesToSkip;
+
+  // 'Trick play' state (used only if fScale != 1):
+  float fScale;
+  double fTrickPlayNPT; // the NPT of the most recent key frame (or seek)
+  double fTrickPlayPresentationTime; // the presentation time to give the next key frame (0.0 => not yet set)
+  unsigned fTrickPlayFrameDuration; // in microseconds
+  Boolean fHaveNextTrickPlayKeyFrame;
+  double fNextTrickPlayNPT;
+  u_int64_t fNextTrickPlayClusterOffsetInFile;
 };
 
 #endif
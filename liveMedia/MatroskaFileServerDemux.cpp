@@ -101,7 +101,7 @@ MatroskaFileServerDemux
 			  char const* preferredLanguage)
   : Medium(env),
     fFileName(fileName), fOnCreation(onCreation), fOnCreationClientData(onCreationClientData),
-    fNextTrackTypeToCheck(0x1), fLastClientSessionId(0), fLastCreatedDemux(NULL) {
+    fNextTrackTypeToCheck(0x1), fLastClientSessionId(0), fLastCreatedDemux(NULL), fVideoSubsession(NULL) {
   MatroskaFile::createNew(env, fileName, onMatroskaFileCreation, this, preferredLanguage);
 }
 
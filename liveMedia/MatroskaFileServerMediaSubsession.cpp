@@ -32,9 +32,11 @@ MatroskaFileServerMediaSubsession
 ::MatroskaFileServerMediaSubsession(MatroskaFileServerDemux& demux, MatroskaTrack* track)
   : FileServerMediaSubsession(demux.envir(), demux.fileName(), False),
     fOurDemux(demux), fTrack(track), fNumFiltersInFrontOfTrack(0) {
+  if (track->trackNumber == demux.ourMatroskaFile()->chosenVideoTrackNumber()) fOurDemux.videoSubsession() = this;
 }
 
 MatroskaFileServerMediaSubsession::~MatroskaFileServerMediaSubsession() {
+  if (fOurDemux.videoSubsession() == this) fOurDemux.videoSubsession() = NULL;
 }
 
 float MatroskaFileServerMediaSubsession::duration() const { return fOurDemux.fileDuration(); }
@@ -48,6 +50,48 @@ void MatroskaFileServerMediaSubsession
   ((MatroskaDemuxedTrack*)inputSource)->seekToTime(seekNPT);
 }
 
+void MatroskaFileServerMediaSubsession
+::setStreamSourceScale(FramedSource* inputSource, float scale) {
+  for (unsigned i = 0; i < fNumFiltersInFrontOfTrack; ++i) {
+    // "inputSource" is a filter.  Go back to *its* source:
+    inputSource = ((FramedFilter*)inputSource)->inputSource();
+  }
+  ((MatroskaDemuxedTrack*)inputSource)->setScale(scale);
+}
+
+void MatroskaFileServerMediaSubsession::testScaleFactor(float& scale) {
+  if (isVideoTrack()) {
+    testTrickPlayScaleFactor(scale);
+  } else {
+    scale = 1.0f; // see below
+  }
+}
+
+void MatroskaFileServerMediaSubsession::testScaleFactorForClientSession(unsigned clientSessionId, float& scale) {
+  // During trick play, only video 'key frames' are delivered, and other tracks are paused.  So, for a non-video track,
+  // we support a scale other than 1 only if the client session is also streaming our file's video track:
+  MatroskaFileServerMediaSubsession* videoSubsession = fOurDemux.videoSubsession();
+  if (videoSubsession != NULL
+      && (videoSubsession == this
+	  || videoSubsession->fDestinationsHashTable->Lookup((char const*)(uintptr_t)clientSessionId) != NULL)) {
+    testTrickPlayScaleFactor(scale);
+  } else {
+    scale = 1.0f;
+  }
+}
+
+void MatroskaFileServerMediaSubsession::testTrickPlayScaleFactor(float& scale) {
+  if (fOurDemux.ourMatroskaFile()->supportsTrickPlay()) {
+    // We support any integral scale, other than 0.  (If scale != 1, then only video 'key frames' are delivered;
+    // other tracks - e.g., audio - are paused until the scale is set back to 1.)
+    int iScale = scale < 0.0 ? (int)(scale - 0.5f) : (int)(scale + 0.5f); // round
+    if (iScale == 0) iScale = 1;
+    scale = (float)iScale;
+  } else {
+    scale = 1.0f;
+  }
+}
+
 FramedSource* MatroskaFileServerMediaSubsession
 ::createNewStreamSource(unsigned clientSessionId, unsigned& estBitrate) {
   FramedSource* baseSource = fOurDemux.newDemuxedTrack(clientSessionId, fTrack->trackNumber);
@@ -42,10 +42,17 @@ protected:
 protected: // redefined virtual functions
   virtual float duration() const;
   virtual void seekStreamSource(FramedSource* inputSource, double& seekNPT, double streamDuration, u_int64_t& numBytes);
+  virtual void setStreamSourceScale(FramedSource* inputSource, float scale);
+  virtual void testScaleFactor(float& scale);
+  virtual void testScaleFactorForClientSession(unsigned clientSessionId, float& scale);
   virtual FramedSource* createNewStreamSource(unsigned clientSessionId,
 					      unsigned& estBitrate);
   virtual RTPSink* createNewRTPSink(Groupsock* rtpGroupsock, unsigned char rtpPayloadTypeIfDynamic, FramedSource* inputSource);
 
+private:
+  Boolean isVideoTrack() const { return fOurDemux.videoSubsession() == this; }
+  void testTrickPlayScaleFactor(float& scale);
+
 protected:
   MatroskaFileServerDemux& fOurDemux;
   MatroskaTrack* fTrack;
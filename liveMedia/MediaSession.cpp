@@ -20,10 +20,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "liveMedia.hh"
-#include "Locale.hh"
 #include "GroupsockHelper.hh"
 #include <ctype.h>
 
+// Case conversion of SDP tokens (codec and parameter names, etc.), as in the "POSIX" locale.  (We do this directly,
+// rather than by switching locales, because it's done for almost every attribute that we parse.)
+static char asciiToLower(char c) { return c >= 'A' && c <= 'Z' ? c + ('a'-'A') : c; }
+static char asciiToUpper(char c) { return c >= 'a' && c <= 'z' ? c - ('a'-'A') : c; }
+
 ////////// MediaSession //////////
 
 MediaSession* MediaSession::createNew(UsageEnvironment& env,
@@ -98,27 +102,114 @@ MediaSubsession* MediaSession::createNewMediaSubsession() {
   return new MediaSubsession(*this);
 }
 
+static Boolean sdpAttributeNameIs(char const* sdpLine, char const* attributeName, unsigned attributeNameLen) {
+  // Checks whether "sdpLine" (which we already know begins with "a=") is a "a=<attributeName>" or "a=<attributeName>:..." line
+  return strncmp(&sdpLine[2], attributeName, attributeNameLen) == 0
+    && (sdpLine[2+attributeNameLen] == ':' || sdpLine[2+attributeNameLen] == '\0');
+}
+#define SDP_ATTRIBUTE_NAME_IS(sdpLine, attributeName) sdpAttributeNameIs(sdpLine, attributeName, sizeof attributeName - 1)
+
+static Boolean parseSDPUnsigned(char const*& ptr, unsigned& result) {
+  // Parses (like "%u" in "sscanf()") an unsigned decimal number - after optional white space - advancing "ptr" past it:
+  while (isspace(*ptr)) ++ptr;
+  if (!isdigit(*ptr)) return False;
+
+  char* end;
+  result = (unsigned)strtoul(ptr, &end, 10);
+  ptr = end;
+  return True;
+}
+
+static char const* parseSDPToken(char const*& ptr, unsigned& tokenLen) {
+  // Parses (like "%s" in "sscanf()") a token - after optional white space - advancing "ptr" past it:
+  while (isspace(*ptr)) ++ptr;
+  char const* token = ptr;
+  while (*ptr != '\0' && !isspace(*ptr)) ++ptr;
+
+  tokenLen = ptr - token;
+  return token;
+}
+
+static Boolean sdpTokenIs(char const* token, unsigned tokenLen, char const* str) {
+  return strlen(str) == tokenLen && strncmp(token, str, tokenLen) == 0;
+}
+
+static Boolean parseMediaLine(char const* sdpLine, char*& mediumName, unsigned short& portNum,
+			      char const*& protocolName, Boolean& usesAVPF, unsigned& payloadFormat) {
+  // Parses a "m=<medium_name> <client_portNum> <proto> <fmt>" or "m=<medium_name> <client_portNum>/<num_ports> <proto> <fmt>"
+  // line, where <proto> is "RTP/AVP" or "RTP/AVPF", or (for a RAW UDP source) "UDP", "udp" or "RAW/RAW/UDP":
+  char const* ptr = &sdpLine[2];
+  unsigned mediumNameLen;
+  char const* mediumNameStart = parseSDPToken(ptr, mediumNameLen);
+  if (mediumNameLen == 0) return False;
+
+  unsigned portNumValue, numPorts;
+  if (!parseSDPUnsigned(ptr, portNumValue)) return False;
+  if (*ptr == '/') {
+    ++ptr;
+    if (!parseSDPUnsigned(ptr, numPorts)) return False;
+  }
+
+  unsigned protoLen;
+  char const* proto = parseSDPToken(ptr, protoLen);
+  usesAVPF = sdpTokenIs(proto, protoLen, "RTP/AVPF");
+  if (sdpTokenIs(proto, protoLen, "RTP/AVP") || usesAVPF) {
+    protocolName = "RTP";
+  } else if (sdpTokenIs(proto, protoLen, "UDP") || sdpTokenIs(proto, protoLen, "udp")
+	     || sdpTokenIs(proto, protoLen, "RAW/RAW/UDP")) {
+    protocolName = "UDP";
+  } else {
+    return False;
+  }
+
+  if (!parseSDPUnsigned(ptr, payloadFormat) || payloadFormat > 127) return False;
+  // (Should we be checking for >1 payload format number here?)#####
+
+  portNum = (unsigned short)portNumValue;
+  mediumName = new char[mediumNameLen+1];
+  memcpy(mediumName, mediumNameStart, mediumNameLen);
+  mediumName[mediumNameLen] = '\0';
+  return True;
+}
+
 Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
   if (sdpDescription == NULL) return False;
 
+  // We parse a (writable) copy of the SDP description, in which each line gets '\0'-terminated in place.  This lets us
+  // handle each line in a single pass - using only the parsing routine for its line type (or attribute name) - without
+  // rescanning (or copying) the rest of the description:
+  char* sdpLines = strDup(sdpDescription);
+  Boolean result = initializeWithSDPLines(sdpDescription, sdpLines);
+  delete[] sdpLines;
+
+  return result;
+}
+
+Boolean MediaSession::initializeWithSDPLines(char const* sdpDescription, char* sdpLines) {
   // Begin by processing all SDP lines until we see the first "m="
-  char const* sdpLine = sdpDescription;
-  char const* nextSDPLine;
+  char* sdpLine = sdpLines;
+  char* nextSDPLine;
   while (1) {
     if (!parseSDPLine(sdpLine, nextSDPLine)) return False;
     //##### We should really check for the correct SDP version (v=0)
     if (sdpLine[0] == 'm') break;
-    sdpLine = nextSDPLine;
-    if (sdpLine == NULL) break; // there are no m= lines at all
 
     // Check for various special SDP lines that we understand:
-    if (parseSDPLine_s(sdpLine)) continue;
-    if (parseSDPLine_i(sdpLine)) continue;
-    if (parseSDPLine_c(sdpLine)) continue;
-    if (parseSDPAttribute_control(sdpLine)) continue;
-    if (parseSDPAttribute_range(sdpLine)) continue;
-    if (parseSDPAttribute_type(sdpLine)) continue;
-    if (parseSDPAttribute_source_filter(sdpLine)) continue;
+    switch (sdpLine[0]) {
+      case 's': { parseSDPLine_s(sdpLine); break; }
+      case 'i': { parseSDPLine_i(sdpLine); break; }
+      case 'c': { parseSDPLine_c(sdpLine); break; }
+      case 'a': {
+	if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "control")) parseSDPAttribute_control(sdpLine);
+	else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "range")) parseSDPAttribute_range(sdpLine);
+	else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "type")) parseSDPAttribute_type(sdpLine);
+	else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "source-filter")) parseSDPAttribute_source_filter(sdpLine);
+	break;
+      }
+    }
+
+    sdpLine = nextSDPLine;
+    if (sdpLine == NULL) break; // there are no m= lines at all
   }
 
   while (sdpLine != NULL) {
@@ -131,38 +222,15 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
 
     // Parse the line as "m=<medium_name> <client_portNum> RTP/AVP <fmt>"
     // or "m=<medium_name> <client_portNum>/<num_ports> RTP/AVP <fmt>"
-    // (Should we be checking for >1 payload format number here?)#####
-    char* mediumName = strDupSize(sdpLine); // ensures we have enough space
-    char const* protocolName = NULL;
+    // (or with "RTP/AVPF" - for RTCP feedback - or, for a RAW UDP source, "UDP", instead of "RTP/AVP")
+    char* mediumName;
+    char const* protocolName;
     unsigned payloadFormat;
-    if ((sscanf(sdpLine, "m=%s %hu RTP/AVP %u",
-		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
-	 sscanf(sdpLine, "m=%s %hu/%*u RTP/AVP %u",
-		mediumName, &subsession->fClientPortNum, &payloadFormat) == 3)
-	&& payloadFormat <= 127) {
-      protocolName = "RTP";
-    } else if ((sscanf(sdpLine, "m=%s %hu UDP %u",
-		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
-		sscanf(sdpLine, "m=%s %hu udp %u",
-		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3 ||
-		sscanf(sdpLine, "m=%s %hu RAW/RAW/UDP %u",
-		       mediumName, &subsession->fClientPortNum, &payloadFormat) == 3)
-	       && payloadFormat <= 127) {
-      // This is a RAW UDP source
-      protocolName = "UDP";
-    } else {
+    if (!parseMediaLine(sdpLine, mediumName, subsession->fClientPortNum, protocolName, subsession->fUsesAVPF,
+			payloadFormat)) {
       // This "m=" line is bad; output an error message saying so:
-      char* sdpLineStr;
-      if (nextSDPLine == NULL) {
-	sdpLineStr = (char*)sdpLine;
-      } else {
-	sdpLineStr = strDup(sdpLine);
-	sdpLineStr[nextSDPLine-sdpLine] = '\0';
-      }
-      envir() << "Bad SDP \"m=\" line: " <<  sdpLineStr << "\n";
-      if (sdpLineStr != (char*)sdpLine) delete[] sdpLineStr;
+      envir() << "Bad SDP \"m=\" line: " <<  sdpLine << "\n";
 
-      delete[] mediumName;
       delete subsession;
 
       // Skip the following SDP lines, up until the next "m=":
@@ -187,10 +255,8 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
     subsession->serverPortNum = subsession->fClientPortNum; // by default
 
     char const* mStart = sdpLine;
-    subsession->fSavedSDPLines = strDup(mStart);
 
-    subsession->fMediumName = strDup(mediumName);
-    delete[] mediumName;
+    subsession->fMediumName = mediumName;
     subsession->fProtocolName = strDup(protocolName);
     subsession->fRTPPayloadFormat = payloadFormat;
 
@@ -203,20 +269,33 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
       if (sdpLine[0] == 'm') break; // we've reached the next subsession
 
       // Check for various special SDP lines that we understand:
-      if (subsession->parseSDPLine_c(sdpLine)) continue;
-      if (subsession->parseSDPLine_b(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_rtpmap(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_rtcpmux(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_control(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_range(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_fmtp(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_source_filter(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_x_dimensions(sdpLine)) continue;
-      if (subsession->parseSDPAttribute_framerate(sdpLine)) continue;
+      switch (sdpLine[0]) {
+	case 'c': { subsession->parseSDPLine_c(sdpLine); break; }
+	case 'b': { subsession->parseSDPLine_b(sdpLine); break; }
+	case 'a': {
+	  if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "rtpmap")) subsession->parseSDPAttribute_rtpmap(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "fmtp")) subsession->parseSDPAttribute_fmtp(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "control")) subsession->parseSDPAttribute_control(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "rtcp-mux")) subsession->parseSDPAttribute_rtcpmux(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "rtcp-fb")) subsession->parseSDPAttribute_rtcpfb(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "range")) subsession->parseSDPAttribute_range(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "source-filter")) subsession->parseSDPAttribute_source_filter(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "x-dimensions")) subsession->parseSDPAttribute_x_dimensions(sdpLine);
+	  else if (SDP_ATTRIBUTE_NAME_IS(sdpLine, "framerate")
+		   || SDP_ATTRIBUTE_NAME_IS(sdpLine, "x-framerate")) subsession->parseSDPAttribute_framerate(sdpLine);
+	  break;
+	}
+      }
 
       // (Later, check for malformed lines, and other valid SDP lines#####)
     }
-    if (sdpLine != NULL) subsession->fSavedSDPLines[sdpLine-mStart] = '\0';
+
+    // Save (the original text of) this subsession's SDP lines - up to the next "m=" line (if any):
+    char const* savedLinesStart = &sdpDescription[mStart - sdpLines];
+    size_t savedLinesLen = sdpLine != NULL ? (size_t)(sdpLine - mStart) : strlen(savedLinesStart);
+    subsession->fSavedSDPLines = new char[savedLinesLen+1];
+    memcpy(subsession->fSavedSDPLines, savedLinesStart, savedLinesLen);
+    subsession->fSavedSDPLines[savedLinesLen] = '\0';
 
     // If we don't yet know the codec name, try looking it up from the
     // list of static payload types:
@@ -248,26 +327,26 @@ Boolean MediaSession::initializeWithSDP(char const* sdpDescription) {
   return True;
 }
 
-Boolean MediaSession::parseSDPLine(char const* inputLine,
-				   char const*& nextLine){
-  // Begin by finding the start of the next line (if any):
+Boolean MediaSession::parseSDPLine(char* inputLine, char*& nextLine) {
+  // Begin by finding the end of this line, and the start of the next line (if any):
+  Boolean isBlankLine = inputLine[0] == '\r' || inputLine[0] == '\n';
+  char* ptr = inputLine;
+  while (*ptr != '\0' && *ptr != '\r' && *ptr != '\n') ++ptr;
+
   nextLine = NULL;
-  for (char const* ptr = inputLine; *ptr != '\0'; ++ptr) {
-    if (*ptr == '\r' || *ptr == '\n') {
-      // We found the end of the line
-      ++ptr;
-      while (*ptr == '\r' || *ptr == '\n') ++ptr;
-      nextLine = ptr;
-      if (nextLine[0] == '\0') nextLine = NULL; // special case for end
-      break;
-    }
+  if (*ptr != '\0') {
+    // We found the end of the line.  '\0'-terminate it (in place), after noting where the next line begins:
+    char* lineEnd = ptr;
+    ++ptr;
+    while (*ptr == '\r' || *ptr == '\n') ++ptr;
+    if (*ptr != '\0') nextLine = ptr; // (otherwise, this was the last line)
+    *lineEnd = '\0';
   }
 
   // Then, check that this line is a SDP line of the form <char>=<etc>
   // (However, we also accept blank lines in the input.)
-  if (inputLine[0] == '\r' || inputLine[0] == '\n') return True;
-  if (strlen(inputLine) < 2 || inputLine[1] != '='
-      || inputLine[0] < 'a' || inputLine[0] > 'z') {
+  if (isBlankLine) return True;
+  if (inputLine[0] < 'a' || inputLine[0] > 'z' || inputLine[1] != '=') {
     envir().setResultMsg("Invalid SDP line: ", inputLine);
     return False;
   }
@@ -276,43 +355,39 @@ Boolean MediaSession::parseSDPLine(char const* inputLine,
 }
 
 static char* parseCLine(char const* sdpLine) {
-  char* resultStr = NULL;
-  char* buffer = strDupSize(sdpLine); // ensures we have enough space
-  if (sscanf(sdpLine, "c=IN IP4 %[^/\r\n]", buffer) == 1) {
-    // Later, handle the optional /<ttl> and /<numAddresses> #####
-    resultStr = strDup(buffer);
-  }
-  delete[] buffer;
-
+  // Check for "c=IN IP4 <connection-endpoint>" (perhaps followed by "/...")
+  if (strncmp(sdpLine, "c=IN", 4) != 0) return NULL;
+  char const* ptr = &sdpLine[4];
+  while (isspace(*ptr)) ++ptr;
+  if (strncmp(ptr, "IP4", 3) != 0) return NULL;
+  ptr += 3;
+  while (isspace(*ptr)) ++ptr;
+
+  // Later, handle the optional /<ttl> and /<numAddresses> #####
+  char const* endpointEnd = ptr;
+  while (*endpointEnd != '\0' && *endpointEnd != '/') ++endpointEnd;
+  if (endpointEnd == ptr) return NULL;
+
+  char* resultStr = new char[endpointEnd-ptr+1];
+  memcpy(resultStr, ptr, endpointEnd-ptr);
+  resultStr[endpointEnd-ptr] = '\0';
   return resultStr;
 }
 
 Boolean MediaSession::parseSDPLine_s(char const* sdpLine) {
   // Check for "s=<session name>" line
-  char* buffer = strDupSize(sdpLine);
-  Boolean parseSuccess = False;
+  if (strncmp(sdpLine, "s=", 2) != 0 || sdpLine[2] == '\0') return False;
 
-  if (sscanf(sdpLine, "s=%[^\r\n]", buffer) == 1) {
-    delete[] fSessionName; fSessionName = strDup(buffer);
-    parseSuccess = True;
-  }
-  delete[] buffer;
-
-  return parseSuccess;
+  delete[] fSessionName; fSessionName = strDup(&sdpLine[2]);
+  return True;
 }
 
 Boolean MediaSession::parseSDPLine_i(char const* sdpLine) {
   // Check for "i=<session description>" line
-  char* buffer = strDupSize(sdpLine);
-  Boolean parseSuccess = False;
-
-  if (sscanf(sdpLine, "i=%[^\r\n]", buffer) == 1) {
-    delete[] fSessionDescription; fSessionDescription = strDup(buffer);
-    parseSuccess = True;
-  }
-  delete[] buffer;
+  if (strncmp(sdpLine, "i=", 2) != 0 || sdpLine[2] == '\0') return False;
 
-  return parseSuccess;
+  delete[] fSessionDescription; fSessionDescription = strDup(&sdpLine[2]);
+  return True;
 }
 
 Boolean MediaSession::parseSDPLine_c(char const* sdpLine) {
@@ -329,33 +404,40 @@ Boolean MediaSession::parseSDPLine_c(char const* sdpLine) {
   return False;
 }
 
+static char* parseAttributeToken(char const* sdpLine, char const* prefix, unsigned prefixLen,
+				 Boolean stopAtAnyWhiteSpace) {
+  // Checks for a "<prefix> <token>" line (with optional white space before <token>), returning a (new[]d) copy of <token>,
+  // or NULL if there's none.  <token> ends at the first space (or, if "stopAtAnyWhiteSpace", any white space character):
+  if (strncmp(sdpLine, prefix, prefixLen) != 0) return NULL;
+
+  char const* token = &sdpLine[prefixLen];
+  while (isspace(*token)) ++token;
+  char const* tokenEnd = token;
+  while (*tokenEnd != '\0' && *tokenEnd != ' ' && !(stopAtAnyWhiteSpace && isspace(*tokenEnd))) ++tokenEnd;
+  if (tokenEnd == token) return NULL;
+
+  char* result = new char[tokenEnd-token+1];
+  memcpy(result, token, tokenEnd-token);
+  result[tokenEnd-token] = '\0';
+  return result;
+}
+
 Boolean MediaSession::parseSDPAttribute_type(char const* sdpLine) {
   // Check for a "a=type:broadcast|meeting|moderated|test|H.332|recvonly" line:
-  Boolean parseSuccess = False;
+  char* type = parseAttributeToken(sdpLine, "a=type:", 7, False);
+  if (type == NULL) return False;
 
-  char* buffer = strDupSize(sdpLine);
-  if (sscanf(sdpLine, "a=type: %[^ ]", buffer) == 1) {
-    delete[] fMediaSessionType;
-    fMediaSessionType = strDup(buffer);
-    parseSuccess = True;
-  }
-  delete[] buffer;
-
-  return parseSuccess;
+  delete[] fMediaSessionType; fMediaSessionType = type;
+  return True;
 }
 
 Boolean MediaSession::parseSDPAttribute_control(char const* sdpLine) {
   // Check for a "a=control:<control-path>" line:
-  Boolean parseSuccess = False;
-
-  char* controlPath = strDupSize(sdpLine); // ensures we have enough space
-  if (sscanf(sdpLine, "a=control: %s", controlPath) == 1) {
-    parseSuccess = True;
-    delete[] fControlPath; fControlPath = strDup(controlPath);
-  }
-  delete[] controlPath;
+  char* controlPath = parseAttributeToken(sdpLine, "a=control:", 10, True);
+  if (controlPath == NULL) return False;
 
-  return parseSuccess;
+  delete[] fControlPath; fControlPath = controlPath;
+  return True;
 }
 
 static Boolean parseRangeAttribute(char const* sdpLine, double& startTime, double& endTime) {
@@ -579,15 +661,17 @@ public:
   virtual ~SDPAttribute();
 
   char const* strValue() const { return fStrValue; }
-  char const* strValueToLower() const { return fStrValueToLower; }
-  int intValue() const { return fIntValue; }
+  char const* strValueToLower();
+  int intValue();
   Boolean valueIsHexadecimal() const { return fValueIsHexadecimal; }
+      // Note: The 'tolower' and integer forms of the value are computed only when first asked for, because most attributes
+      // (e.g., a long "sprop-parameter-sets") are only ever used as strings, if at all.
 
 private:
   char* fStrValue;
   char* fStrValueToLower;
   int fIntValue;
-  Boolean fValueIsHexadecimal;
+  Boolean fValueIsHexadecimal, fHaveIntValue;
 };
 
 
@@ -598,8 +682,9 @@ MediaSubsession::MediaSubsession(MediaSession& parent)
     fParent(parent), fNext(NULL),
     fConnectionEndpointName(NULL),
     fClientPortNum(0), fRTPPayloadFormat(0xFF),
-    fSavedSDPLines(NULL), fMediumName(NULL), fCodecName(NULL), fProtocolName(NULL),
-    fRTPTimestampFrequency(0), fMultiplexRTCPWithRTP(False), fControlPath(NULL),
+    fSavedSDPLines(NULL), fMediumName(NULL), fCodecName(NULL), fProtocolName(NULL), fUsesAVPF(False),
+    fRTPTimestampFrequency(0), fMultiplexRTCPWithRTP(False),
+    fNACKsOffered(False), fRTXPayloadFormat(0), fFECPayloadFormat(0), fControlPath(NULL),
     fSourceFilterAddr(parent.sourceFilterAddr()), fBandwidth(0),
     fPlayStartTime(0.0), fPlayEndTime(0.0), fAbsStartTime(NULL), fAbsEndTime(NULL),
     fVideoWidth(0), fVideoHeight(0), fVideoFPS(0), fNumChannels(1), fScale(1.0f), fNPT_PTS_Offset(0.0f),
@@ -820,6 +905,9 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
       break;
     }
 
+    // If the server sends FEC packets, then use them to recover lost packets:
+    if (fRTPSource != NULL && fFECPayloadFormat != 0) fRTPSource->enableFEC(fFECPayloadFormat);
+
     // Finally, create our RTCP instance. (It starts running automatically)
     if (fRTPSource != NULL && fRTCPSocket != NULL) {
       // If bandwidth is specified, use it and add 5% for RTCP overhead.
@@ -836,6 +924,9 @@ Boolean MediaSubsession::initiate(int useSpecialRTPoffset) {
 	env().setResultMsg("Failed to create RTCP instance");
 	break;
       }
+
+      // If the server offered to retransmit lost packets, then ask it to:
+      if (fNACKsOffered) fRTPSource->enableNACKs(fRTXPayloadFormat);
     }
 
     return True;
@@ -1016,36 +1107,52 @@ Boolean MediaSubsession::parseSDPAttribute_rtpmap(char const* sdpLine) {
   // Check for a "a=rtpmap:<fmt> <codec>/<freq>" line:
   // (Also check without the "/<freq>"; RealNetworks omits this)
   // Also check for a trailing "/<numChannels>".
-  Boolean parseSuccess = False;
-
   unsigned rtpmapPayloadFormat;
-  char* codecName = strDupSize(sdpLine); // ensures we have enough space
+  char const* ptr = &sdpLine[9];
+  if (strncmp(sdpLine, "a=rtpmap:", 9) != 0 || !parseSDPUnsigned(ptr, rtpmapPayloadFormat)) return False;
+  while (isspace(*ptr)) ++ptr;
+
+  char const* codecNameStart = ptr;
+  char const* codecNameEnd = ptr;
+  while (*codecNameEnd != '\0' && *codecNameEnd != '/') ++codecNameEnd;
   unsigned rtpTimestampFrequency = 0;
   unsigned numChannels = 1;
-  if (sscanf(sdpLine, "a=rtpmap: %u %[^/]/%u/%u",
-	     &rtpmapPayloadFormat, codecName, &rtpTimestampFrequency,
-	     &numChannels) == 4
-      || sscanf(sdpLine, "a=rtpmap: %u %[^/]/%u",
-	     &rtpmapPayloadFormat, codecName, &rtpTimestampFrequency) == 3
-      || sscanf(sdpLine, "a=rtpmap: %u %s",
-		&rtpmapPayloadFormat, codecName) == 2) {
-    parseSuccess = True;
-    if (rtpmapPayloadFormat == fRTPPayloadFormat) {
-      // This "rtpmap" matches our payload format, so set our
-      // codec name and timestamp frequency:
-      // (First, make sure the codec name is upper case)
-      {
-	Locale l("POSIX");
-	for (char* p = codecName; *p != '\0'; ++p) *p = toupper(*p);
-      }
-      delete[] fCodecName; fCodecName = strDup(codecName);
-      fRTPTimestampFrequency = rtpTimestampFrequency;
-      fNumChannels = numChannels;
-    }
+  ptr = codecNameEnd;
+  if (codecNameEnd > codecNameStart && *ptr == '/' && parseSDPUnsigned(++ptr, rtpTimestampFrequency)) {
+    // "<codec>/<freq>", perhaps followed by "/<numChannels>":
+    if (*ptr == '/') parseSDPUnsigned(++ptr, numChannels);
+  } else {
+    // There's no "/<freq>"; the codec name is just the next token:
+    unsigned codecNameLen;
+    ptr = codecNameStart;
+    codecNameStart = parseSDPToken(ptr, codecNameLen);
+    if (codecNameLen == 0) return False;
+    codecNameEnd = ptr;
+  }
+
+  // Make a copy of the codec name - making sure that it's upper case:
+  char* codecName = new char[codecNameEnd-codecNameStart+1];
+  char* c = codecName;
+  while (codecNameStart < codecNameEnd) *c++ = asciiToUpper(*codecNameStart++);
+  *c = '\0';
+
+  if (rtpmapPayloadFormat == fRTPPayloadFormat) {
+    // This "rtpmap" matches our payload format, so set our
+    // codec name and timestamp frequency:
+    delete[] fCodecName; fCodecName = codecName;
+    fRTPTimestampFrequency = rtpTimestampFrequency;
+    fNumChannels = numChannels;
+    return True;
+  } else if (strcmp(codecName, "RTX") == 0) {
+    // Retransmissions of our packets (RFC 4588) will use this payload format:
+    fRTXPayloadFormat = (unsigned char)rtpmapPayloadFormat;
+  } else if (strcmp(codecName, "ULPFEC") == 0) {
+    // FEC packets (RFC 5109) for our packets will use this payload format:
+    fFECPayloadFormat = (unsigned char)rtpmapPayloadFormat;
   }
   delete[] codecName;
 
-  return parseSuccess;
+  return True;
 }
 
 Boolean MediaSubsession::parseSDPAttribute_rtcpmux(char const* sdpLine) {
@@ -1057,18 +1164,36 @@ Boolean MediaSubsession::parseSDPAttribute_rtcpmux(char const* sdpLine) {
   return False;
 }
 
-Boolean MediaSubsession::parseSDPAttribute_control(char const* sdpLine) {
-  // Check for a "a=control:<control-path>" line:
-  Boolean parseSuccess = False;
+Boolean MediaSubsession::parseSDPAttribute_rtcpfb(char const* sdpLine) {
+  // Check for a "a=rtcp-fb:<fmt> <feedback-type>" line.  (The only kind of feedback that we support is a generic "nack".)
+  if (strncmp(sdpLine, "a=rtcp-fb:", 10) != 0) return False;
+  sdpLine += 10;
 
-  char* controlPath = strDupSize(sdpLine); // ensures we have enough space
-  if (sscanf(sdpLine, "a=control: %s", controlPath) == 1) {
-    parseSuccess = True;
-    delete[] fControlPath; fControlPath = strDup(controlPath);
+  unsigned fbPayloadFormat;
+  if (sdpLine[0] == '*') {
+    fbPayloadFormat = fRTPPayloadFormat;
+    ++sdpLine;
+  } else if (sscanf(sdpLine, "%u", &fbPayloadFormat) == 1) {
+    while (isdigit(*sdpLine)) ++sdpLine;
+  } else {
+    return False;
   }
-  delete[] controlPath;
+  while (*sdpLine == ' ') ++sdpLine;
 
-  return parseSuccess;
+  if (fbPayloadFormat == fRTPPayloadFormat && strncmp(sdpLine, "nack", 4) == 0
+      && (sdpLine[4] == '\r' || sdpLine[4] == '\n' || sdpLine[4] == '\0')) {
+    fNACKsOffered = True;
+  }
+  return True;
+}
+
+Boolean MediaSubsession::parseSDPAttribute_control(char const* sdpLine) {
+  // Check for a "a=control:<control-path>" line:
+  char* controlPath = parseAttributeToken(sdpLine, "a=control:", 10, True);
+  if (controlPath == NULL) return False;
+
+  delete[] fControlPath; fControlPath = controlPath;
+  return True;
 }
 
 Boolean MediaSubsession::parseSDPAttribute_range(char const* sdpLine) {
@@ -1104,26 +1229,40 @@ Boolean MediaSubsession::parseSDPAttribute_fmtp(char const* sdpLine) {
   // Later: Check that payload format number matches; #####
   do {
     if (strncmp(sdpLine, "a=fmtp:", 7) != 0) break; sdpLine += 7;
+    unsigned fmtpPayloadFormat;
+    if (fRTXPayloadFormat != 0 && sscanf(sdpLine, "%u", &fmtpPayloadFormat) == 1
+	&& fmtpPayloadFormat == fRTXPayloadFormat) {
+      return True; // these parameters (e.g., "apt=") describe our retransmissions, not our media; ignore them
+    }
     while (isdigit(*sdpLine)) ++sdpLine;
 
     // The remaining "sdpLine" should be a sequence of
     //     <name>=<value>;
     // or
     //     <name>;
-    // parameter assignments.  Look at each of these.
-    unsigned const sdpLineLen = strlen(sdpLine);
-    char* nameStr = new char[sdpLineLen+1];
-    char* valueStr = new char[sdpLineLen+1];
+    // parameter assignments.  Look at each of these - tokenizing them in a single pass, into one buffer that holds
+    // each (lower-case) <name>, and <value>.  (Any further interpretation of <value> is done only when it's asked for.)
+    char* buffer = new char[strlen(sdpLine)+2];
 
     while (*sdpLine != '\0' && *sdpLine != '\r' && *sdpLine != '\n') {
-      int sscanfResult = sscanf(sdpLine, " %[^=; \t\r\n] = %[^; \t\r\n]", nameStr, valueStr);
-      if (sscanfResult >= 1) {
-	// <name> or <name>=<value>
-	// Convert <name> to lower-case, to ease comparison:
-	Locale l("POSIX");
-	for (char* c = nameStr; *c != '\0'; ++c) *c = tolower(*c);
-	
-	if (sscanfResult == 1) {
+      // Copy <name> - converted to lower-case, to ease comparison - into our buffer:
+      while (isspace(*sdpLine)) ++sdpLine;
+      char* nameStr = buffer;
+      char* c = nameStr;
+      while (*sdpLine != '\0' && strchr("=; \t\r\n", *sdpLine) == NULL) *c++ = asciiToLower(*sdpLine++);
+      *c++ = '\0';
+
+      if (nameStr[0] != '\0') {
+	char* valueStr = c;
+	while (isspace(*sdpLine)) ++sdpLine;
+	if (*sdpLine == '=') {
+	  ++sdpLine;
+	  while (isspace(*sdpLine)) ++sdpLine;
+	  while (*sdpLine != '\0' && strchr("; \t\r\n", *sdpLine) == NULL) *c++ = *sdpLine++;
+	}
+	*c = '\0';
+
+	if (valueStr[0] == '\0') {
 	  // <name>
 	  setAttribute(nameStr);
 	} else {
@@ -1136,7 +1275,7 @@ Boolean MediaSubsession::parseSDPAttribute_fmtp(char const* sdpLine) {
       while (*sdpLine != '\0' && *sdpLine != '\r' && *sdpLine != '\n' && *sdpLine != ';') ++sdpLine;
       while (*sdpLine == ';') ++sdpLine;
     }
-    delete[] nameStr; delete[] valueStr;
+    delete[] buffer;
     return True;
   } while (0);
 
@@ -1424,27 +1563,42 @@ Boolean MediaSubsession::createSourceObjects(int useSpecialRTPoffset) {
 ////////// SDPAttribute implementation //////////
 
 SDPAttribute::SDPAttribute(char const* strValue, Boolean valueIsHexadecimal)
-  : fStrValue(strDup(strValue)), fStrValueToLower(NULL), fValueIsHexadecimal(valueIsHexadecimal) {
-  if (fStrValue == NULL) {
-    // No value was given for this attribute, so consider it to be a Boolean, with value True:
-    fIntValue = 1;
-  } else {
-    // Create a 'tolower' version of "fStrValue", in case it's needed:
-    Locale l("POSIX");
+  : fStrValue(strDup(strValue)), fStrValueToLower(NULL), fIntValue(0),
+    fValueIsHexadecimal(valueIsHexadecimal), fHaveIntValue(False) {
+}
+
+SDPAttribute::~SDPAttribute() {
+  delete[] fStrValue;
+  delete[] fStrValueToLower;
+}
+
+char const* SDPAttribute::strValueToLower() {
+  if (fStrValueToLower == NULL && fStrValue != NULL) {
+    // Create a 'tolower' version of "fStrValue":
     size_t strSize;
 
     fStrValueToLower = strDupSize(fStrValue, strSize);
-    for (unsigned i = 0; i < strSize-1; ++i) fStrValueToLower[i] = tolower(fStrValue[i]);
+    for (unsigned i = 0; i < strSize-1; ++i) fStrValueToLower[i] = asciiToLower(fStrValue[i]);
     fStrValueToLower[strSize-1] = '\0';
-    
-    // Try to parse "fStrValueToLower" as an integer.  If we can't, assume an integer value of 0:
-    if (sscanf(fStrValueToLower, valueIsHexadecimal ? "%x" : "%d", &fIntValue) != 1) {
-      fIntValue = 0;
-    }
   }
+
+  return fStrValueToLower;
 }
 
-SDPAttribute::~SDPAttribute() {
-  delete[] fStrValue;
-  delete[] fStrValueToLower;
+int SDPAttribute::intValue() {
+  if (!fHaveIntValue) {
+    if (fStrValue == NULL) {
+      // No value was given for this attribute, so consider it to be a Boolean, with value True:
+      fIntValue = 1;
+    } else {
+      // Try to parse "fStrValue" as an integer.  If we can't, assume an integer value of 0:
+      // (Note that "%x" accepts upper-case hexadecimal digits also, so we don't need the 'tolower' version here.)
+      if (sscanf(fStrValue, fValueIsHexadecimal ? "%x" : "%d", &fIntValue) != 1) {
+	fIntValue = 0;
+      }
+    }
+    fHaveIntValue = True;
+  }
+
+  return fIntValue;
 }
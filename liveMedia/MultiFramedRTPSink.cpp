@@ -20,7 +20,52 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "MultiFramedRTPSink.hh"
+#include "ULPFEC.hh"
 #include "GroupsockHelper.hh"
+#include <string.h>
+
+////////// SentRTPPacket //////////
+
+// A copy of a recently-sent RTP packet, kept in case it needs to be retransmitted:
+
+class SentRTPPacket {
+public:
+  SentRTPPacket() : fData(NULL), fSize(0), fBufferSize(0) {}
+  virtual ~SentRTPPacket() { delete[] fData; }
+
+  void save(unsigned char const* packet, unsigned packetSize) {
+    if (packetSize > fBufferSize) {
+      delete[] fData;
+      fData = new unsigned char[packetSize];
+      fBufferSize = packetSize;
+    }
+    memmove(fData, packet, packetSize);
+    fSize = packetSize;
+  }
+
+  Boolean hasSeqNum(u_int16_t seqNum) const {
+    return fSize >= 12 && ((fData[2]<<8)|fData[3]) == seqNum;
+  }
+
+  unsigned headerSize() const {
+    // The size of the packet's RTP header, including any CSRC identifiers and header extension (or 0 if it's malformed):
+    if (fSize < 12) return 0;
+    unsigned size = 12 + 4*(fData[0]&0x0F);
+    if (fData[0]&0x10) {
+      if (fSize < size + 4) return 0;
+      size += 4 + 4*((fData[size+2]<<8)|fData[size+3]);
+    }
+    return size <= fSize ? size : 0;
+  }
+
+  unsigned char const* data() const { return fData; }
+  unsigned size() const { return fSize; }
+
+private:
+  unsigned char* fData;
+  unsigned fSize, fBufferSize;
+};
+
 
 ////////// MultiFramedRTPSink //////////
 
@@ -32,6 +77,12 @@ void MultiFramedRTPSink::setPacketSizes(unsigned preferredPacketSize,
   delete fOutBuf;
   fOutBuf = new OutPacketBuffer(preferredPacketSize, maxPacketSize);
   fOurMaxPacketSize = maxPacketSize; // save value, in case subclasses need it
+
+  if (fFECEncoder != NULL) {
+    // Our FEC packets need to be able to hold our new maximum packet size:
+    delete fFECEncoder;
+    fFECEncoder = new ULPFECEncoder(fFECRowSize, fFECNumRows, fFECPayloadType, maxPacketSize);
+  }
 }
 
 #ifndef RTP_PAYLOAD_MAX_SIZE
@@ -52,11 +103,18 @@ MultiFramedRTPSink::MultiFramedRTPSink(UsageEnvironment& env,
   : RTPSink(env, rtpGS, rtpPayloadType, rtpTimestampFrequency,
 	    rtpPayloadFormatName, numChannels),
     fOutBuf(NULL), fCurFragmentationOffset(0), fPreviousFrameEndedFragmentation(False),
-    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL) {
+    fOnSendErrorFunc(NULL), fOnSendErrorData(NULL),
+    fSentPacketHistory(NULL), fSentPacketHistorySize(0),
+    fFECEncoder(NULL), fFECRowSize(0), fFECNumRows(0),
+    fPacingMaxBitrate(0), fPacingMaxBurstSize(0), fUseKernelPacing(False),
+    fInputWindowNumBytes(0), fInputBitrate(0) {
+  fInputWindowStart.tv_sec = fInputWindowStart.tv_usec = 0;
   setPacketSizes((RTP_PAYLOAD_PREFERRED_SIZE), (RTP_PAYLOAD_MAX_SIZE));
 }
 
 MultiFramedRTPSink::~MultiFramedRTPSink() {
+  delete fFECEncoder;
+  delete[] fSentPacketHistory;
   delete fOutBuf;
 }
 
@@ -153,6 +211,161 @@ void MultiFramedRTPSink::setFramePadding(unsigned numPaddingBytes) {
   }
 }
 
+Boolean MultiFramedRTPSink::enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType) {
+  if (historySize == 0) return False;
+
+  delete[] fSentPacketHistory;
+  fSentPacketHistory = new SentRTPPacket[historySize];
+  fSentPacketHistorySize = historySize;
+
+  fRetransmissionsEnabled = True;
+  fRTXPayloadType = rtxPayloadType;
+  fRTXSeqNo = (u_int16_t)our_random();
+  fRTXSSRC = our_random32();
+
+  return True;
+}
+
+void MultiFramedRTPSink::retransmitPacket(u_int16_t seqNum) {
+  if (fSentPacketHistory == NULL || !fSentPacketHistory[seqNum%fSentPacketHistorySize].hasSeqNum(seqNum)) {
+    // We don't have this packet (any more):
+    ++fNumUnsatisfiedRetransmissionRequests;
+    return;
+  }
+  SentRTPPacket const& packet = fSentPacketHistory[seqNum%fSentPacketHistorySize];
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  if (fRTXPayloadType == 0) {
+    // Send the packet again, unchanged:
+    fRTPInterface.sendPacket((unsigned char*)packet.data(), packet.size());
+    noteOutgoingPacket(packet.size(), timeNow.tv_sec);
+    if (fPacingEnabled) {
+      (void)pacingDelay(packet.size(), timeNow); // retransmissions aren't delayed, but they do use up our rate
+    }
+  } else {
+    // Send a RFC 4588 'retransmission packet': The same RTP header (including any CSRC identifiers and header
+    // extension) - but with our RTX payload type, sequence number and SSRC - followed by the original sequence number,
+    // followed by the original payload:
+    unsigned const headerSize = packet.headerSize();
+    if (headerSize == 0) {
+      ++fNumUnsatisfiedRetransmissionRequests;
+      return;
+    }
+    unsigned const rtxPacketSize = packet.size() + 2;
+    unsigned char* rtxPacket = new unsigned char[rtxPacketSize];
+    unsigned char const* origPacket = packet.data();
+
+    memmove(rtxPacket, origPacket, headerSize);
+    rtxPacket[1] = (origPacket[1]&0x80)|fRTXPayloadType; // M, PT
+    rtxPacket[2] = fRTXSeqNo>>8; rtxPacket[3] = (unsigned char)fRTXSeqNo;
+    rtxPacket[8] = fRTXSSRC>>24; rtxPacket[9] = fRTXSSRC>>16; rtxPacket[10] = fRTXSSRC>>8; rtxPacket[11] = fRTXSSRC;
+    rtxPacket[headerSize] = origPacket[2]; rtxPacket[headerSize+1] = origPacket[3]; // original sequence number
+    memmove(&rtxPacket[headerSize+2], &origPacket[headerSize], packet.size() - headerSize);
+
+    fRTPInterface.sendPacket(rtxPacket, rtxPacketSize);
+    noteOutgoingPacket(rtxPacketSize, timeNow.tv_sec);
+    if (fPacingEnabled) {
+      (void)pacingDelay(rtxPacketSize, timeNow); // retransmissions aren't delayed, but they do use up our rate
+    }
+    delete[] rtxPacket;
+    ++fRTXSeqNo;
+  }
+  ++fNumPacketsRetransmitted;
+}
+
+Boolean MultiFramedRTPSink::enableFEC(unsigned rowSize, unsigned numRows, unsigned char fecPayloadType) {
+  if (!ULPFECEncoder::parametersAreValid(rowSize, numRows) || fecPayloadType == 0) return False;
+
+  delete fFECEncoder;
+  fFECEncoder = new ULPFECEncoder(rowSize, numRows, fecPayloadType, fOurMaxPacketSize);
+  fFECRowSize = rowSize; fFECNumRows = numRows;
+  fFECPayloadType = fecPayloadType;
+
+  return True;
+}
+
+// When pacing at an 'automatic' rate, we allow this multiple of our input's bitrate.  (This is measured over
+// presentation time - not the time at which we actually send - so that our pacing doesn't itself reduce it.
+// It needs to be large enough to send large frames - e.g., video key frames - without delaying them by much more
+// than their duration.)
+#define PACING_BITRATE_HEADROOM 2
+#define DEFAULT_PACING_BURST_PACKETS 4
+
+Boolean MultiFramedRTPSink::enablePacing(unsigned maxBitrate, unsigned maxBurstSize, Boolean useKernelPacing) {
+  fPacingEnabled = True;
+  fPacingMaxBitrate = maxBitrate;
+  fPacingMaxBurstSize = maxBurstSize == 0 ? DEFAULT_PACING_BURST_PACKETS*fOurMaxPacketSize : maxBurstSize;
+  fUseKernelPacing = False;
+
+  Boolean result = True;
+  if (useKernelPacing) {
+#ifdef SO_MAX_PACING_RATE
+    fUseKernelPacing = True;
+#else
+    result = False;
+#endif
+  }
+
+  updatePacingRate();
+  return result;
+}
+
+void MultiFramedRTPSink::noteInputFrame(unsigned frameSize, struct timeval const& presentationTime) {
+  if (fInputWindowStart.tv_sec == 0 && fInputWindowStart.tv_usec == 0) {
+    fInputWindowStart = presentationTime;
+  }
+  fInputWindowNumBytes += frameSize;
+
+  double windowDuration = (presentationTime.tv_sec - fInputWindowStart.tv_sec)
+    + (presentationTime.tv_usec - fInputWindowStart.tv_usec)/1000000.0;
+  if (windowDuration < 0.0 || windowDuration > 10.0) {
+    // The presentation times jumped (e.g., because of seeking), so start a new window:
+    fInputWindowStart = presentationTime;
+    fInputWindowNumBytes = frameSize;
+  } else if (windowDuration >= 1.0) {
+    // Note: This window's bytes include those of the frame that ended it.  That's OK, because of our smoothing.
+    unsigned windowBitrate = (unsigned)((8.0*fInputWindowNumBytes)/windowDuration);
+    fInputBitrate = fInputBitrate == 0 ? windowBitrate : (3*fInputBitrate + windowBitrate)/4;
+
+    fInputWindowStart = presentationTime;
+    fInputWindowNumBytes = 0;
+    if (fPacingMaxBitrate == 0) updatePacingRate();
+  }
+}
+
+unsigned MultiFramedRTPSink::pacingDelay(unsigned numBytesSent, struct timeval const& timeNow) {
+  unsigned delay = fPacingBucket.consume(numBytesSent, timeNow);
+
+  RTPPacer* aggregatePacer = RTPPacer::ourPacer(envir());
+  if (aggregatePacer != NULL) {
+    unsigned aggregateDelay = aggregatePacer->consume(numBytesSent, timeNow);
+    if (aggregateDelay > delay) delay = aggregateDelay;
+  }
+
+  return delay;
+}
+
+void MultiFramedRTPSink::updatePacingRate() {
+  unsigned bitrate = fPacingMaxBitrate;
+  if (bitrate == 0) {
+    // Use a multiple of our input's bitrate - or, if we don't know that yet, of our estimated bitrate (if any):
+    bitrate = fInputBitrate;
+    if (bitrate == 0) bitrate = 1000*estimatedBitrate();
+    bitrate *= PACING_BITRATE_HEADROOM;
+  }
+
+  fPacingBucket.setRate(bitrate, fPacingMaxBurstSize); // Note: 0 means 'unlimited' (until we know our bitrate)
+
+#ifdef SO_MAX_PACING_RATE
+  if (fUseKernelPacing && fRTPInterface.gs() != NULL) {
+    unsigned bytesPerSecond = bitrate == 0 ? ~0U : bitrate/8;
+    setsockopt(fRTPInterface.gs()->socketNum(), SOL_SOCKET, SO_MAX_PACING_RATE,
+	       (const char*)&bytesPerSecond, sizeof bytesPerSecond);
+  }
+#endif
+}
+
 Boolean MultiFramedRTPSink::continuePlaying() {
   // Send the first packet.
   // (This will also schedule any future sends.)
@@ -231,6 +444,7 @@ void MultiFramedRTPSink
 		    struct timeval presentationTime,
 		    unsigned durationInMicroseconds) {
   MultiFramedRTPSink* sink = (MultiFramedRTPSink*)clientData;
+  if (sink->fPacingEnabled) sink->noteInputFrame(numBytesRead, presentationTime);
   sink->afterGettingFrame1(numBytesRead, numTruncatedBytes,
 			   presentationTime, durationInMicroseconds);
 }
@@ -363,6 +577,10 @@ Boolean MultiFramedRTPSink::isTooBigForAPacket(unsigned numBytes) const {
 }
 
 void MultiFramedRTPSink::sendPacketIfNecessary() {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  unsigned numBytesSent = 0; // including any FEC packets
+
   if (fNumFramesUsedSoFar > 0) {
     // Send the packet:
 #ifdef TEST_LOSS
@@ -372,7 +590,28 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
 	// if failure handler has been specified, call it
 	if (fOnSendErrorFunc != NULL) (*fOnSendErrorFunc)(fOnSendErrorData);
       }
+    if (fSentPacketHistory != NULL) {
+      // Save a copy of the packet, in case we're later asked to retransmit it:
+      fSentPacketHistory[fSeqNo%fSentPacketHistorySize].save(fOutBuf->packet(), fOutBuf->curPacketSize());
+    }
+    if (fFECEncoder != NULL) {
+      // Send any FEC packets that this packet completes:
+      fFECEncoder->addMediaPacket(fOutBuf->packet(), fOutBuf->curPacketSize());
+      unsigned char const* fecPacket;
+      unsigned fecPacketSize;
+      while ((fecPacket = fFECEncoder->nextFECPacket(fecPacketSize)) != NULL) {
+#ifdef TEST_LOSS
+	if ((our_random()%10) == 0) continue; // simulate 10% packet loss #####
+#endif
+	fRTPInterface.sendPacket((unsigned char*)fecPacket, fecPacketSize);
+	noteOutgoingPacket(fecPacketSize, timeNow.tv_sec);
+	++fNumFECPacketsSent;
+	numBytesSent += fecPacketSize;
+      }
+    }
     ++fPacketCount;
+    numBytesSent += fOutBuf->curPacketSize();
+    noteOutgoingPacket(fOutBuf->curPacketSize(), timeNow.tv_sec);
     fTotalOctetCount += fOutBuf->curPacketSize();
     fOctetCount += fOutBuf->curPacketSize()
       - rtpHeaderSize - fSpecialHeaderSize - fTotalFrameSpecificHeaderSizes;
@@ -403,14 +642,18 @@ void MultiFramedRTPSink::sendPacketIfNecessary() {
     // We have more frames left to send.  Figure out when the next frame
     // is due to start playing, then make sure that we wait this long before
     // sending the next packet.
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
     int secsDiff = fNextSendTime.tv_sec - timeNow.tv_sec;
     int64_t uSecondsToGo = secsDiff*1000000 + (fNextSendTime.tv_usec - timeNow.tv_usec);
     if (uSecondsToGo < 0 || secsDiff < 0) { // sanity check: Make sure that the time-to-delay is non-negative:
       uSecondsToGo = 0;
     }
 
+    if (fPacingEnabled) {
+      // Also make sure that we don't send faster than our pacing rate:
+      unsigned pacingUSecondsToGo = pacingDelay(numBytesSent, timeNow);
+      if (pacingUSecondsToGo > uSecondsToGo) uSecondsToGo = pacingUSecondsToGo;
+    }
+
     // Delay this amount of time:
     nextTask() = envir().taskScheduler().scheduleDelayedTask(uSecondsToGo, (TaskFunc*)sendNext, this);
   }
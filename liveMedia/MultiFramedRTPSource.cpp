@@ -21,6 +21,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "MultiFramedRTPSource.hh"
 #include "RTCP.hh"
+#include "ULPFEC.hh"
 #include "GroupsockHelper.hh"
 #include <string.h>
 
@@ -46,6 +47,7 @@ public:
   Boolean isEmpty() const { return fHeadPacket == NULL; }
 
   void setThresholdTime(unsigned uSeconds) { fThresholdTime = uSeconds; }
+  unsigned thresholdTime() const { return fThresholdTime; }
   void resetHaveSeenFirstPacket() { fHaveSeenFirstPacket = False; }
 
 private:
@@ -61,6 +63,52 @@ private:
 };
 
 
+////////// NACKGenerator definition //////////
+
+#define MAX_NUM_MISSING_PACKETS 128
+#define MAX_MISSING_PACKET_GAP 64 // we don't try to recover from larger bursts of packet loss
+#define MAX_NACKS_PER_PACKET 3
+
+class NACKGenerator {
+  // Keeps track of recently-missing packets, so that we can (repeatedly) ask for them to be retransmitted:
+public:
+  NACKGenerator();
+  void reset();
+
+  Boolean noteIncomingPacket(u_int16_t seqNo, struct timeval const& timeNow, unsigned& recoveryTime);
+      // Returns True iff this packet was one that we had been waiting for (in which case "recoveryTime" is set to the
+      // time (in microseconds) since we first noticed that it was missing)
+  unsigned getSeqNumsToNACK(u_int16_t* seqNums, struct timeval const& timeNow,
+			    unsigned retryInterval, unsigned maxWaitTime,
+			    unsigned& numNewlyNACKed, unsigned& numGivenUp);
+      // Fills in "seqNums" (which must have room for MAX_NUM_MISSING_PACKETS entries) with the sequence numbers of
+      // missing packets that we should (re)request now.  Packets that we've been waiting for more than "maxWaitTime"
+      // (microseconds) - or that we've already requested MAX_NACKS_PER_PACKET times - are given up on.
+  Boolean isEmpty() const { return fNumMissing == 0; }
+  Boolean haveNewlyMissingPackets() const { // i.e., ones that we haven't yet asked for
+    return fNumMissing > 0 && fMissing[fNumMissing-1].numNACKs == 0;
+  }
+
+private:
+  void removeEntry(unsigned index);
+
+private:
+  Boolean fHaveSeenFirstPacket;
+  u_int16_t fHighestSeqNo;
+  unsigned fNumMissing;
+  struct {
+    u_int16_t seqNo;
+    unsigned numNACKs;
+    struct timeval timeDetected, timeLastNACKed;
+  } fMissing[MAX_NUM_MISSING_PACKETS]; // in order of detection
+};
+
+static unsigned uSecsBetween(struct timeval const& from, struct timeval const& to) {
+  int uSecs = (to.tv_sec - from.tv_sec)*1000000 + (to.tv_usec - from.tv_usec);
+  return uSecs < 0 ? 0 : (unsigned)uSecs;
+}
+
+
 ////////// MultiFramedRTPSource implementation //////////
 
 MultiFramedRTPSource
@@ -71,6 +119,9 @@ MultiFramedRTPSource
   : RTPSource(env, RTPgs, rtpPayloadFormat, rtpTimestampFrequency) {
   reset();
   fReorderingBuffer = new ReorderingPacketBuffer(packetFactory);
+  fNACKGenerator = NULL;
+  fNACKRetryTask = NULL;
+  fFECDecoder = NULL;
 
   // Try to use a big receive buffer for RTP:
   increaseReceiveBufferTo(env, RTPgs->socketNum(), 50*1024);
@@ -86,9 +137,29 @@ void MultiFramedRTPSource::reset() {
 }
 
 MultiFramedRTPSource::~MultiFramedRTPSource() {
+  envir().taskScheduler().unscheduleDelayedTask(fNACKRetryTask);
+  delete fNACKGenerator;
+  delete fFECDecoder;
   delete fReorderingBuffer;
 }
 
+Boolean MultiFramedRTPSource::enableNACKs(unsigned char rtxPayloadType) {
+  if (fRTCPInstance == NULL) return False; // we need this to send NACKs
+
+  if (fNACKGenerator == NULL) fNACKGenerator = new NACKGenerator;
+  fNACKsEnabled = True;
+  fRTXPayloadFormat = rtxPayloadType;
+  return True;
+}
+
+Boolean MultiFramedRTPSource::enableFEC(unsigned char fecPayloadType) {
+  if (fecPayloadType == 0) return False;
+
+  if (fFECDecoder == NULL) fFECDecoder = new ULPFECDecoder;
+  fFECPayloadFormat = fecPayloadType;
+  return True;
+}
+
 Boolean MultiFramedRTPSource
 ::processSpecialHeader(BufferedPacket* /*packet*/,
 		       unsigned& resultSpecialHeaderSize) {
@@ -112,6 +183,11 @@ void MultiFramedRTPSource::doStopGettingFrames() {
   envir().taskScheduler().unscheduleDelayedTask(nextTask());
   fRTPInterface.stopNetworkReading();
   fReorderingBuffer->reset();
+  if (fNACKGenerator != NULL) {
+    envir().taskScheduler().unscheduleDelayedTask(fNACKRetryTask);
+    fNACKGenerator->reset();
+  }
+  if (fFECDecoder != NULL) fFECDecoder->reset();
   reset();
 }
 
@@ -258,8 +334,38 @@ void MultiFramedRTPSource::networkReadHandler1() {
     if ((our_random()%10) == 0) break; // simulate 10% packet loss
 #endif
 
+    readSuccess = processIncomingPacket(bPacket, fromAddress, False);
+  } while (0);
+  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
+
+  if (fFECDecoder != NULL) {
+    // Check whether any FEC packets that we've received now let us recover any missing packets:
+    unsigned char const* recoveredPacket;
+    unsigned recoveredPacketSize;
+    while ((recoveredPacket = fFECDecoder->nextRecoveredPacket(recoveredPacketSize)) != NULL) {
+      bPacket = fReorderingBuffer->getFreePacket(this);
+      struct sockaddr_in dummyAddress; memset(&dummyAddress, 0, sizeof dummyAddress);
+      if (bPacket->fillInData(recoveredPacket, recoveredPacketSize)
+	  && processIncomingPacket(bPacket, dummyAddress, True)) {
+	++fNumPacketsRecoveredUsingFEC;
+      } else {
+	fReorderingBuffer->freePacket(bPacket);
+      }
+    }
+  }
+
+  doGetNextFrame1();
+  // If we didn't get proper data this time, we'll get another chance
+}
+
+Boolean MultiFramedRTPSource
+::processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in const& fromAddress, Boolean wasRecovered) {
+  // Perform sanity checks on the RTP header, then store the packet:
+  do {
     // Check for the 12-byte RTP header:
     if (bPacket->dataSize() < 12) break;
+    unsigned char* const packetStart = bPacket->data();
+    unsigned const packetSize = bPacket->dataSize();
     unsigned rtpHdr = ntohl(*(u_int32_t*)(bPacket->data())); ADVANCE(4);
     Boolean rtpMarkerBit = (rtpHdr&0x00800000) != 0;
     unsigned rtpTimestamp = ntohl(*(u_int32_t*)(bPacket->data()));ADVANCE(4);
@@ -270,7 +376,16 @@ void MultiFramedRTPSource::networkReadHandler1() {
 
     // Check the Payload Type.
     unsigned char rtpPayloadType = (unsigned char)((rtpHdr&0x007F0000)>>16);
-    if (rtpPayloadType != rtpPayloadFormat()) {
+    Boolean isRetransmission
+      = fNACKGenerator != NULL && fRTXPayloadFormat != 0 && rtpPayloadType == fRTXPayloadFormat;
+        // an RFC 4588 retransmission of one of our packets
+    if (fFECDecoder != NULL && rtpPayloadType == fFECPayloadFormat) {
+      // A FEC packet.  Keep it, in case we later need it to recover a missing packet:
+      fFECDecoder->addFECPacket(packetStart, packetSize);
+      ++fNumFECPacketsReceived;
+      break;
+    }
+    if (rtpPayloadType != rtpPayloadFormat() && !isRetransmission) {
       if (fRTCPInstanceForMultiplexedRTCPPackets != NULL
 	  && rtpPayloadType >= 64 && rtpPayloadType <= 95) {
 	// This is a multiplexed RTCP packet, and we've been asked to deliver such packets.
@@ -304,39 +419,92 @@ void MultiFramedRTPSource::networkReadHandler1() {
       bPacket->removePadding(numPaddingBytes);
     }
 
+    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+    if (isRetransmission) {
+      // The payload begins with the original packet's sequence number.  (The RTX stream has its own SSRC, but
+      // we treat the packet as if it came from the original stream.)
+      if (bPacket->dataSize() <= 2 || fLastReceivedSSRC == 0) break;
+      rtpSeqNo = (bPacket->data()[0]<<8)|bPacket->data()[1]; ADVANCE(2);
+      rtpSSRC = fLastReceivedSSRC;
+    }
+
     // The rest of the packet is the usable data.  Record and save it:
     if (rtpSSRC != fLastReceivedSSRC) {
       // The SSRC of incoming packets has changed.  Unfortunately we don't yet handle streams that contain multiple SSRCs,
       // but we can handle a single-SSRC stream where the SSRC changes occasionally:
       fLastReceivedSSRC = rtpSSRC;
       fReorderingBuffer->resetHaveSeenFirstPacket();
+      if (fNACKGenerator != NULL) fNACKGenerator->reset();
+      if (fFECDecoder != NULL) fFECDecoder->reset();
     }
-    unsigned short rtpSeqNo = (unsigned short)(rtpHdr&0xFFFF);
+    if (fFECDecoder != NULL && !isRetransmission) fFECDecoder->addMediaPacket(packetStart, packetSize);
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
     Boolean usableInJitterCalculation
       = packetIsUsableInJitterCalculation((bPacket->data()),
 						  bPacket->dataSize());
+    if (fNACKGenerator != NULL) {
+      unsigned recoveryTime;
+      if (fNACKGenerator->noteIncomingPacket(rtpSeqNo, timeNow, recoveryTime) && !wasRecovered) {
+	// This is a packet that we had asked to be retransmitted:
+	if (fNumPacketsRecovered == 0 || recoveryTime < fMinRecoveryTime) fMinRecoveryTime = recoveryTime;
+	if (recoveryTime > fMaxRecoveryTime) fMaxRecoveryTime = recoveryTime;
+	fTotRecoveryTime += recoveryTime;
+	++fNumPacketsRecovered;
+	usableInJitterCalculation = False; // because it's late
+      }
+      if (fNACKGenerator->haveNewlyMissingPackets()) sendNACKs(); // also schedules any retries
+    }
+    if (isRetransmission || wasRecovered) usableInJitterCalculation = False;
     struct timeval presentationTime; // computed by:
     Boolean hasBeenSyncedUsingRTCP; // computed by:
     receptionStatsDB()
       .noteIncomingPacket(rtpSSRC, rtpSeqNo, rtpTimestamp,
 			  timestampFrequency(),
 			  usableInJitterCalculation, presentationTime,
-			  hasBeenSyncedUsingRTCP, bPacket->dataSize());
+			  hasBeenSyncedUsingRTCP, bPacket->dataSize(), wasRecovered);
 
     // Fill in the rest of the packet descriptor, and store it:
-    struct timeval timeNow;
-    gettimeofday(&timeNow, NULL);
     bPacket->assignMiscParams(rtpSeqNo, rtpTimestamp, presentationTime,
 			      hasBeenSyncedUsingRTCP, rtpMarkerBit,
 			      timeNow);
     if (!fReorderingBuffer->storePacket(bPacket)) break;
 
-    readSuccess = True;
+    return True;
   } while (0);
-  if (!readSuccess) fReorderingBuffer->freePacket(bPacket);
 
-  doGetNextFrame1();
-  // If we didn't get proper data this time, we'll get another chance
+  return False;
+}
+
+void MultiFramedRTPSource::sendNACKs(void* source) {
+  MultiFramedRTPSource* ourSource = (MultiFramedRTPSource*)source;
+  ourSource->fNACKRetryTask = NULL;
+  ourSource->sendNACKs();
+}
+
+void MultiFramedRTPSource::sendNACKs() {
+  if (fRTCPInstance == NULL) return;
+
+  // Space our (up to MAX_NACKS_PER_PACKET) requests for each missing packet over the time that the reordering buffer
+  // will wait for it:
+  unsigned const maxWaitTime = fReorderingBuffer->thresholdTime();
+  unsigned retryInterval = maxWaitTime/(MAX_NACKS_PER_PACKET+1);
+  if (retryInterval < 10000) retryInterval = 10000; // 10 ms
+
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  u_int16_t seqNums[MAX_NUM_MISSING_PACKETS];
+  unsigned numNewlyNACKed, numGivenUp;
+  unsigned numSeqNums
+    = fNACKGenerator->getSeqNumsToNACK(seqNums, timeNow, retryInterval, maxWaitTime, numNewlyNACKed, numGivenUp);
+  fNumPacketsNACKed += numNewlyNACKed;
+  fNumPacketsNotRecovered += numGivenUp;
+  if (numSeqNums > 0) fRTCPInstance->sendNACK(fLastReceivedSSRC, seqNums, numSeqNums);
+
+  envir().taskScheduler().unscheduleDelayedTask(fNACKRetryTask);
+  if (!fNACKGenerator->isEmpty()) {
+    fNACKRetryTask = envir().taskScheduler().scheduleDelayedTask(retryInterval, (TaskFunc*)sendNACKs, this);
+  }
 }
 
 
@@ -405,6 +573,15 @@ Boolean BufferedPacket::fillInData(RTPInterface& rtpInterface, struct sockaddr_i
   return True;
 }
 
+Boolean BufferedPacket::fillInData(unsigned char const* data, unsigned dataSize) {
+  reset();
+  if (dataSize > fPacketSize) return False;
+
+  memmove(fBuf, data, dataSize);
+  fTail = dataSize;
+  return True;
+}
+
 void BufferedPacket
 ::assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 		   struct timeval presentationTime,
@@ -629,3 +806,90 @@ BufferedPacket* ReorderingPacketBuffer
   // Otherwise, keep waiting for our desired packet to arrive:
   return NULL;
 }
+
+
+////////// NACKGenerator implementation //////////
+
+NACKGenerator::NACKGenerator() {
+  reset();
+}
+
+void NACKGenerator::reset() {
+  fHaveSeenFirstPacket = False;
+  fHighestSeqNo = 0;
+  fNumMissing = 0;
+}
+
+Boolean NACKGenerator
+::noteIncomingPacket(u_int16_t seqNo, struct timeval const& timeNow, unsigned& recoveryTime) {
+  if (!fHaveSeenFirstPacket) {
+    fHighestSeqNo = seqNo;
+    fHaveSeenFirstPacket = True;
+    return False;
+  }
+
+  if (seqNumLT(fHighestSeqNo, seqNo)) {
+    // The usual case: A new packet.  Note any packets that were skipped over:
+    u_int16_t gap = (u_int16_t)(seqNo - fHighestSeqNo - 1);
+    if (gap <= MAX_MISSING_PACKET_GAP) {
+      for (u_int16_t missingSeqNo = fHighestSeqNo+1; missingSeqNo != seqNo; ++missingSeqNo) {
+	if (fNumMissing == MAX_NUM_MISSING_PACKETS) break;
+	fMissing[fNumMissing].seqNo = missingSeqNo;
+	fMissing[fNumMissing].numNACKs = 0;
+	fMissing[fNumMissing].timeDetected = timeNow;
+	++fNumMissing;
+      }
+    }
+    fHighestSeqNo = seqNo;
+    return False;
+  }
+
+  // This packet is late (or a duplicate).  Check whether it's one that we've been waiting for:
+  for (unsigned i = 0; i < fNumMissing; ++i) {
+    if (fMissing[i].seqNo == seqNo) {
+      recoveryTime = uSecsBetween(fMissing[i].timeDetected, timeNow);
+      removeEntry(i);
+      return True;
+    }
+  }
+  return False;
+}
+
+unsigned NACKGenerator
+::getSeqNumsToNACK(u_int16_t* seqNums, struct timeval const& timeNow,
+		   unsigned retryInterval, unsigned maxWaitTime,
+		   unsigned& numNewlyNACKed, unsigned& numGivenUp) {
+  unsigned numSeqNums = 0;
+  numNewlyNACKed = numGivenUp = 0;
+
+  for (unsigned i = 0; i < fNumMissing; ) {
+    if (fMissing[i].numNACKs == 0) {
+      // We haven't asked for this packet yet:
+      ++numNewlyNACKed;
+    } else if (uSecsBetween(fMissing[i].timeDetected, timeNow) > maxWaitTime
+	       || (fMissing[i].numNACKs == MAX_NACKS_PER_PACKET
+		   && uSecsBetween(fMissing[i].timeLastNACKed, timeNow) >= retryInterval)) {
+      // Give up on this packet:
+      ++numGivenUp;
+      removeEntry(i);
+      continue;
+    } else if (fMissing[i].numNACKs == MAX_NACKS_PER_PACKET
+	       || uSecsBetween(fMissing[i].timeLastNACKed, timeNow) < retryInterval) {
+      // Not yet time to ask for this packet again:
+      ++i;
+      continue;
+    }
+
+    seqNums[numSeqNums++] = fMissing[i].seqNo;
+    ++fMissing[i].numNACKs;
+    fMissing[i].timeLastNACKed = timeNow;
+    ++i;
+  }
+
+  return numSeqNums;
+}
+
+void NACKGenerator::removeEntry(unsigned index) {
+  --fNumMissing;
+  for (unsigned i = index; i < fNumMissing; ++i) fMissing[i] = fMissing[i+1];
+}
@@ -29,8 +29,11 @@ OnDemandServerMediaSubsession
 				Boolean multiplexRTCPWithRTP)
   : ServerMediaSubsession(env),
     fSDPLines(NULL), fReuseFirstSource(reuseFirstSource),
-    fMultiplexRTCPWithRTP(multiplexRTCPWithRTP), fLastStreamToken(NULL),
-    fAppHandlerTask(NULL), fAppHandlerClientData(NULL) {
+    fMultiplexRTCPWithRTP(multiplexRTCPWithRTP),
+    fRetransmissionHistorySize(0), fUseRTX(False), fFECRowSize(0), fFECNumRows(0),
+    fPacingEnabled(False), fPacingMaxBitrate(0), fPacingMaxBurstSize(0), fUseKernelPacing(False), fLastStreamToken(NULL),
+    fAppHandlerTask(NULL), fAppHandlerClientData(NULL),
+    fCongestionFeedbackHandler(NULL), fCongestionFeedbackHandlerClientData(NULL), fDropFramesUnderCongestion(False) {
   fDestinationsHashTable = HashTable::create(ONE_WORD_HASH_KEYS);
   if (fMultiplexRTCPWithRTP) {
     fInitialPortNum = initialPortNum;
@@ -71,6 +74,7 @@ OnDemandServerMediaSubsession::sdpLines() {
     Groupsock* dummyGroupsock = createGroupsock(dummyAddr, 0);
     unsigned char rtpPayloadType = 96 + trackNumber()-1; // if dynamic
     RTPSink* dummyRTPSink = createNewRTPSink(dummyGroupsock, rtpPayloadType, inputSource);
+    enableLossRecoveryFor(dummyRTPSink);
     if (dummyRTPSink != NULL && dummyRTPSink->estimatedBitrate() > 0) estBitrate = dummyRTPSink->estimatedBitrate();
 
     setSDPLinesFromRTPSink(dummyRTPSink, inputSource, estBitrate);
@@ -169,6 +173,10 @@ void OnDemandServerMediaSubsession
 
 	unsigned char rtpPayloadType = 96 + trackNumber()-1; // if dynamic
 	rtpSink = createNewRTPSink(rtpGroupsock, rtpPayloadType, mediaSource);
+	enableLossRecoveryFor(rtpSink);
+	if (rtpSink != NULL && fPacingEnabled) {
+	  rtpSink->enablePacing(fPacingMaxBitrate, fPacingMaxBurstSize, fUseKernelPacing);
+	}
 	if (rtpSink != NULL && rtpSink->estimatedBitrate() > 0) streamBitrate = rtpSink->estimatedBitrate();
       }
 
@@ -331,6 +339,21 @@ void OnDemandServerMediaSubsession
   rtcp = streamState->rtcpInstance();
 }
 
+Boolean OnDemandServerMediaSubsession
+::getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc) {
+  StreamState* streamState = (StreamState*)streamToken;
+  Destinations* dests
+    = (Destinations*)(fDestinationsHashTable->Lookup((char const*)(uintptr_t)clientSessionId));
+  if (streamState == NULL || streamState->rtcpInstance() == NULL || dests == NULL) return False;
+
+  // The client's "RR"s are identified in the same way as in "StreamState::startPlaying()":
+  if (dests->isTCP) {
+    return streamState->rtcpInstance()->lookupReceiverSSRC(dests->tcpSocketNum, dests->rtcpChannelId, ssrc);
+  } else {
+    return streamState->rtcpInstance()->lookupReceiverSSRC(dests->addr.s_addr, dests->rtcpPort, ssrc);
+  }
+}
+
 void OnDemandServerMediaSubsession::deleteStream(unsigned clientSessionId,
 						 void*& streamToken) {
   StreamState* streamState = (StreamState*)streamToken;
@@ -411,6 +434,22 @@ void OnDemandServerMediaSubsession
   fAppHandlerClientData = clientData;
 }
 
+void OnDemandServerMediaSubsession
+::setCongestionFeedbackHandler(CongestionFeedbackHandlerFunc* handler, void* clientData) {
+  fCongestionFeedbackHandler = handler;
+  fCongestionFeedbackHandlerClientData = clientData;
+}
+
+void OnDemandServerMediaSubsession::enableFrameDroppingUnderCongestion(Boolean enable) {
+  fDropFramesUnderCongestion = enable;
+}
+
+void OnDemandServerMediaSubsession::setSDPLines(char const* sdpLines) {
+  delete[] fSDPLines;
+  fSDPLines = strDup(sdpLines);
+  noteSDPLinesChange();
+}
+
 void OnDemandServerMediaSubsession
 ::sendRTCPAppPacket(u_int8_t subtype, char const* name,
 		    u_int8_t* appDependentData, unsigned appDependentDataSize) {
@@ -420,6 +459,41 @@ void OnDemandServerMediaSubsession
   }
 }
 
+void OnDemandServerMediaSubsession::enableRetransmissions(unsigned historySize, Boolean useRTX) {
+  fRetransmissionHistorySize = historySize;
+  fUseRTX = useRTX;
+}
+
+void OnDemandServerMediaSubsession::enableFEC(unsigned rowSize, unsigned numRows) {
+  fFECRowSize = rowSize;
+  fFECNumRows = numRows;
+}
+
+void OnDemandServerMediaSubsession
+::enablePacing(unsigned maxBitrate, unsigned maxBurstSize, Boolean useKernelPacing) {
+  fPacingEnabled = True;
+  fPacingMaxBitrate = maxBitrate;
+  fPacingMaxBurstSize = maxBurstSize;
+  fUseKernelPacing = useKernelPacing;
+}
+
+void OnDemandServerMediaSubsession::enableLossRecoveryFor(RTPSink* rtpSink) {
+  if (rtpSink == NULL) return;
+
+  // Any extra payload types that we need use the next dynamic payload types after the sink's own
+  // (or the first ones, if the sink's is static):
+  unsigned char nextPayloadType = rtpSink->rtpPayloadType() >= 96 ? rtpSink->rtpPayloadType()+1 : 96;
+
+  if (fRetransmissionHistorySize > 0) {
+    unsigned char rtxPayloadType = 0;
+    if (fUseRTX && nextPayloadType <= 127) rtxPayloadType = nextPayloadType++;
+    rtpSink->enableRetransmissions(fRetransmissionHistorySize, rtxPayloadType);
+  }
+  if (fFECRowSize > 0 && nextPayloadType <= 127) {
+    rtpSink->enableFEC(fFECRowSize, fFECNumRows, nextPayloadType++);
+  }
+}
+
 void OnDemandServerMediaSubsession
 ::setSDPLinesFromRTPSink(RTPSink* rtpSink, FramedSource* inputSource, unsigned estBitrate) {
   if (rtpSink == NULL) return;
@@ -429,24 +503,29 @@ void OnDemandServerMediaSubsession
   AddressString ipAddressStr(fServerAddressForSDP);
   char* rtpmapLine = rtpSink->rtpmapLine();
   char const* rtcpmuxLine = fMultiplexRTCPWithRTP ? "a=rtcp-mux\r\n" : "";
+  char* lossRecoveryFmts = rtpSink->lossRecoveryPayloadFormats();
+  char* lossRecoveryLines = rtpSink->lossRecoverySDPLines();
   char const* rangeLine = rangeSDPLine();
   char const* auxSDPLine = getAuxSDPLine(rtpSink, inputSource);
   if (auxSDPLine == NULL) auxSDPLine = "";
 
   char const* const sdpFmt =
-    "m=%s %u RTP/AVP %d\r\n"
+    "m=%s %u %s %d%s\r\n"
     "c=IN IP4 %s\r\n"
     "b=AS:%u\r\n"
     "%s"
     "%s"
     "%s"
     "%s"
+    "%s"
     "a=control:%s\r\n";
   unsigned sdpFmtSize = strlen(sdpFmt)
-    + strlen(mediaType) + 5 /* max short len */ + 3 /* max char len */
+    + strlen(mediaType) + 5 /* max short len */ + 8 /* max proto len */ + 3 /* max char len */
     + strlen(ipAddressStr.val())
     + 20 /* max int len */
+    + strlen(lossRecoveryFmts)
     + strlen(rtpmapLine)
+    + strlen(lossRecoveryLines)
     + strlen(rtcpmuxLine)
     + strlen(rangeLine)
     + strlen(auxSDPLine)
@@ -455,15 +534,18 @@ void OnDemandServerMediaSubsession
   sprintf(sdpLines, sdpFmt,
 	  mediaType, // m= <media>
 	  fPortNumForSDP, // m= <port>
-	  rtpPayloadType, // m= <fmt list>
+	  rtpSink->sdpTransportProtocol(), // m= <proto>
+	  rtpPayloadType, lossRecoveryFmts, // m= <fmt list>
 	  ipAddressStr.val(), // c= address
 	  estBitrate, // b=AS:<bandwidth>
 	  rtpmapLine, // a=rtpmap:... (if present)
+	  lossRecoveryLines, // a=rtcp-fb:..., a=rtpmap:... (for retransmissions and FEC, if present)
 	  rtcpmuxLine, // a=rtcp-mux:... (if present)
 	  rangeLine, // a=range:... (if present)
 	  auxSDPLine, // optional extra SDP line
 	  trackId()); // a=control:<track-id>
   delete[] (char*)rangeLine; delete[] rtpmapLine;
+  delete[] lossRecoveryFmts; delete[] lossRecoveryLines;
 
   fSDPLines = strDup(sdpLines);
   delete[] sdpLines;
@@ -486,6 +568,32 @@ static void afterPlayingStreamState(void* clientData) {
   // (This can be done only on streams that have a known duration.)
 }
 
+// The congestion estimate for a single client of a "StreamState".  We interpose this between our "RTCPInstance" and the
+// client's original "RR" handler:
+
+class ClientCongestionState {
+public:
+  ClientCongestionState(StreamState& ourStream, RTPSink& rtpSink, unsigned clientSessionId)
+    : fOurStream(ourStream), fClientSessionId(clientSessionId),
+      fRTCPRRHandler(NULL), fRTCPRRHandlerClientData(NULL), fEstimator(rtpSink) {
+  }
+
+  static void rtcpRRHandler(void* clientData) {
+    ClientCongestionState* clientState = (ClientCongestionState*)clientData;
+
+    // Call the client's original "RR" handler (if any), then update our estimate:
+    if (clientState->fRTCPRRHandler != NULL) (*clientState->fRTCPRRHandler)(clientState->fRTCPRRHandlerClientData);
+    clientState->fOurStream.noteIncomingRR(*clientState);
+  }
+
+public:
+  StreamState& fOurStream;
+  unsigned fClientSessionId;
+  TaskFunc* fRTCPRRHandler;
+  void* fRTCPRRHandlerClientData;
+  RTPCongestionEstimator fEstimator;
+};
+
 StreamState::StreamState(OnDemandServerMediaSubsession& master,
                          Port const& serverRTPPort, Port const& serverRTCPPort,
 			 RTPSink* rtpSink, BasicUDPSink* udpSink,
@@ -495,7 +603,8 @@ StreamState::StreamState(OnDemandServerMediaSubsession& master,
     fServerRTPPort(serverRTPPort), fServerRTCPPort(serverRTCPPort),
     fRTPSink(rtpSink), fUDPSink(udpSink), fStreamDuration(master.duration()),
     fTotalBW(totalBW), fRTCPInstance(NULL) /* created later */,
-    fMediaSource(mediaSource), fStartNPT(0.0), fRTPgs(rtpGS), fRTCPgs(rtcpGS) {
+    fMediaSource(mediaSource), fStartNPT(0.0), fRTPgs(rtpGS), fRTCPgs(rtcpGS),
+    fClientCongestionStates(NULL) {
 }
 
 StreamState::~StreamState() {
@@ -516,6 +625,22 @@ void StreamState
     fRTCPInstance->setAppHandler(fMaster.fAppHandlerTask, fMaster.fAppHandlerClientData);
   }
 
+  if (fRTPSink != NULL && (fMaster.fCongestionFeedbackHandler != NULL || fMaster.fDropFramesUnderCongestion)) {
+    // Estimate the network congestion to this client, by interposing our own handler for its "RR"s:
+    if (fClientCongestionStates == NULL) fClientCongestionStates = HashTable::create(ONE_WORD_HASH_KEYS);
+    ClientCongestionState* clientState
+      = (ClientCongestionState*)(fClientCongestionStates->Lookup((char const*)(uintptr_t)clientSessionId));
+    if (clientState == NULL) {
+      clientState = new ClientCongestionState(*this, *fRTPSink, clientSessionId);
+      fClientCongestionStates->Add((char const*)(uintptr_t)clientSessionId, clientState);
+    }
+    clientState->fRTCPRRHandler = rtcpRRHandler;
+    clientState->fRTCPRRHandlerClientData = rtcpRRHandlerClientData;
+
+    rtcpRRHandler = ClientCongestionState::rtcpRRHandler;
+    rtcpRRHandlerClientData = clientState;
+  }
+
   if (dests->isTCP) {
     // Change RTP and RTCP to use the TCP socket instead of UDP:
     if (fRTPSink != NULL) {
@@ -596,6 +721,16 @@ void StreamState::endPlaying(Destinations* dests, unsigned clientSessionId) {
       fRTCPInstance->unsetSpecificRRHandler(dests->addr.s_addr, dests->rtcpPort);
     }
   }
+
+  if (fClientCongestionStates != NULL) {
+    ClientCongestionState* clientState
+      = (ClientCongestionState*)(fClientCongestionStates->Lookup((char const*)(uintptr_t)clientSessionId));
+    if (clientState != NULL) {
+      fClientCongestionStates->Remove((char const*)(uintptr_t)clientSessionId);
+      delete clientState;
+      if (fMaster.fDropFramesUnderCongestion) updateFrameDropLevel(); // in case this client was the most congested
+    }
+  }
 }
 
 void StreamState::sendRTCPAppPacket(u_int8_t subtype, char const* name,
@@ -605,9 +740,44 @@ void StreamState::sendRTCPAppPacket(u_int8_t subtype, char const* name,
   }
 }
 
+void StreamState::noteIncomingRR(ClientCongestionState& clientState) {
+  if (fRTCPInstance == NULL) return; // sanity check
+
+  clientState.fEstimator.noteIncomingRR(fRTCPInstance->lastRRSenderSSRC());
+
+  if (fMaster.fCongestionFeedbackHandler != NULL) {
+    (*fMaster.fCongestionFeedbackHandler)(fMaster.fCongestionFeedbackHandlerClientData,
+					  clientState.fClientSessionId, clientState.fEstimator);
+  }
+  if (fMaster.fDropFramesUnderCongestion) updateFrameDropLevel();
+}
+
+void StreamState::updateFrameDropLevel() {
+  if (fRTPSink == NULL || fClientCongestionStates == NULL) return;
+
+  // Use the congestion level of our most congested client:
+  unsigned level = CONGESTION_NONE;
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fClientCongestionStates);
+  ClientCongestionState* clientState;
+  char const* key; // dummy
+  while ((clientState = (ClientCongestionState*)(iter->next(key))) != NULL) {
+    if (clientState->fEstimator.congestionLevel() > level) level = clientState->fEstimator.congestionLevel();
+  }
+  delete iter;
+
+  fRTPSink->setFrameDropLevel(level);
+}
+
 void StreamState::reclaim() {
   // Delete allocated media objects
   Medium::close(fRTCPInstance) /* will send a RTCP BYE */; fRTCPInstance = NULL;
+  if (fClientCongestionStates != NULL) {
+    ClientCongestionState* clientState;
+    while ((clientState = (ClientCongestionState*)(fClientCongestionStates->RemoveNext())) != NULL) {
+      delete clientState;
+    }
+    delete fClientCongestionStates; fClientCongestionStates = NULL;
+  }
   Medium::close(fRTPSink); fRTPSink = NULL;
   Medium::close(fUDPSink); fUDPSink = NULL;
 
@@ -81,25 +81,30 @@ PassiveServerMediaSubsession::sdpLines() {
     unsigned estBitrate
       = fRTCPInstance == NULL ? 50 : fRTCPInstance->totSessionBW();
     char* rtpmapLine = fRTPSink.rtpmapLine();
+    char* lossRecoveryFmts = fRTPSink.lossRecoveryPayloadFormats();
+    char* lossRecoveryLines = fRTPSink.lossRecoverySDPLines();
     char const* rtcpmuxLine = rtcpIsMuxed() ? "a=rtcp-mux\r\n" : "";
     char const* rangeLine = rangeSDPLine();
     char const* auxSDPLine = fRTPSink.auxSDPLine();
     if (auxSDPLine == NULL) auxSDPLine = "";
 
     char const* const sdpFmt =
-      "m=%s %d RTP/AVP %d\r\n"
+      "m=%s %d %s %d%s\r\n"
       "c=IN IP4 %s/%d\r\n"
       "b=AS:%u\r\n"
       "%s"
       "%s"
       "%s"
       "%s"
+      "%s"
       "a=control:%s\r\n";
     unsigned sdpFmtSize = strlen(sdpFmt)
-      + strlen(mediaType) + 5 /* max short len */ + 3 /* max char len */
+      + strlen(mediaType) + 5 /* max short len */ + 8 /* max proto len */ + 3 /* max char len */
       + strlen(groupAddressStr.val()) + 3 /* max char len */
       + 20 /* max int len */
+      + strlen(lossRecoveryFmts)
       + strlen(rtpmapLine)
+      + strlen(lossRecoveryLines)
       + strlen(rtcpmuxLine)
       + strlen(rangeLine)
       + strlen(auxSDPLine)
@@ -108,16 +113,19 @@ PassiveServerMediaSubsession::sdpLines() {
     sprintf(sdpLines, sdpFmt,
 	    mediaType, // m= <media>
 	    portNum, // m= <port>
-	    rtpPayloadType, // m= <fmt list>
+	    fRTPSink.sdpTransportProtocol(), // m= <proto>
+	    rtpPayloadType, lossRecoveryFmts, // m= <fmt list>
 	    groupAddressStr.val(), // c= <connection address>
 	    ttl, // c= TTL
 	    estBitrate, // b=AS:<bandwidth>
 	    rtpmapLine, // a=rtpmap:... (if present)
+	    lossRecoveryLines, // a=rtcp-fb:..., a=rtpmap:... (for retransmissions and FEC, if present)
 	    rtcpmuxLine, // a=rtcp-mux:... (if present)
 	    rangeLine, // a=range:... (if present)
 	    auxSDPLine, // optional extra SDP line
 	    trackId()); // a=control:<track-id>
     delete[] (char*)rangeLine; delete[] rtpmapLine;
+    delete[] lossRecoveryFmts; delete[] lossRecoveryLines;
 
     fSDPLines = strDup(sdpLines);
     delete[] sdpLines;
@@ -214,6 +222,16 @@ void PassiveServerMediaSubsession
   rtcp = fRTCPInstance;
 }
 
+Boolean PassiveServerMediaSubsession
+::getReceiverSSRC(unsigned clientSessionId, void* /*streamToken*/, u_int32_t& ssrc) {
+  if (fRTCPInstance == NULL) return False;
+
+  RTCPSourceRecord* source = (RTCPSourceRecord*)(fClientRTCPSourceRecords->Lookup((char const*)(uintptr_t)clientSessionId));
+  if (source == NULL) return False;
+
+  return fRTCPInstance->lookupReceiverSSRC(source->addr, source->port, ssrc);
+}
+
 void PassiveServerMediaSubsession::deleteStream(unsigned clientSessionId, void*& /*streamToken*/) {
   // Lookup and remove the 'RTCPSourceRecord' for this client.  Also turn off RTCP "RR" handling:
   RTCPSourceRecord* source = (RTCPSourceRecord*)(fClientRTCPSourceRecords->Lookup((char const*)clientSessionId));
@@ -27,12 +27,110 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #define MILLION 1000000
 #endif
 
+// Classes used to implement the optional 'GOP cache' for H.264 and H.265 video tracks.  A "ProxyGOPCache" continually reads
+// (NAL unit) frames from the subsession's shared source, and keeps those from the start of the most recent 'GOP' (i.e., key
+// frame, preceded by parameter sets).  It also acts as a 'replicator': Each front-end client reads from its own
+// "ProxyGOPCacheReader", which delivers the cached frames first, then each new frame as it arrives.
+
+#ifndef GOP_CACHE_MAX_SIZE
+#define GOP_CACHE_MAX_SIZE 4000000
+#endif
+    // The maximum number of bytes of frame data that a "ProxyGOPCache" will hold.  If a GOP is longer than this, it is not
+    // cached.  (Clients that fall this far behind are moved forward to the start of the current GOP.)
+
+#ifndef GOP_CACHE_MAX_REPLAY_DURATION
+#define GOP_CACHE_MAX_REPLAY_DURATION 500000
+#endif
+    // The maximum time (in microseconds) over which a cached GOP is replayed to a new client.  If the GOP spans a longer
+    // time than this, then it's replayed faster than real time, so that the client soon catches up with the live stream.
+
+class ProxyGOPCachedFrame; // forward
+class ProxyGOPCacheReader; // forward
+
+class ProxyGOPCache {
+public:
+  ProxyGOPCache(UsageEnvironment& env, FramedSource* inputSource, RTPSource* rtpSource, Boolean isH265);
+  virtual ~ProxyGOPCache();
+
+  void reset(); // discards the cached GOP; e.g., when the back-end stream has been "PAUSE"d
+
+  RTPSource* rtpSource() const { return fRTPSource; }
+
+private:
+  friend class ProxyGOPCacheReader;
+  void addReader(ProxyGOPCacheReader* reader);
+  void removeReader(ProxyGOPCacheReader* reader);
+
+  void readNextFrame();
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+                                unsigned numTruncatedBytes,
+                                struct timeval presentationTime,
+                                unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, struct timeval presentationTime);
+  static void onSourceClosure(void* clientData);
+  void onSourceClosure();
+
+  ProxyGOPCachedFrame* appendFrame(unsigned char const* data, unsigned size, struct timeval presentationTime);
+  void trim();
+
+private:
+  UsageEnvironment& fEnv;
+  FramedSource* fInputSource;
+  RTPSource* fRTPSource;
+  Boolean fIsH265, fSourceHasClosed, fWasSynchronized;
+  unsigned char* fBuffer; // into which we read each frame
+  ProxyGOPCachedFrame *fHead, *fTail;
+  unsigned long fNextFrameNumber;
+  unsigned fTotalSize; // of all frames from "fHead" through "fTail"
+  ProxyGOPCachedFrame* fGOPStart; // NULL if we don't currently have a GOP cached
+  unsigned fGOPSize; // of all frames from "fGOPStart" through "fTail"
+  struct timeval fKeyFramePresentationTime; // of the key frame that began the current GOP
+  ProxyGOPCachedFrame* fNonVCLRunStart; // the first of the consecutive non-VCL NAL units (if any) at the end of the cache
+  unsigned fParameterSetsInNonVCLRun; // bitmask, indexed by parameter set type
+  ProxyGOPCachedFrame* fParameterSets[3]; // copies of the most recent VPS (H.265 only), SPS, PPS; not in the cache itself
+  ProxyGOPCacheReader* fReaders;
+};
+
+class ProxyGOPCacheReader: public FramedSource {
+public:
+  ProxyGOPCacheReader(ProxyGOPCache& cache, unsigned clientSessionId);
+
+  unsigned clientSessionId() const { return fClientSessionId; }
+  void setRTPSink(RTPSink* rtpSink) { fRTPSink = rtpSink; }
+
+private:
+  virtual ~ProxyGOPCacheReader();
+
+  void deliverFrame(Boolean completeDeliveryNow);
+  static void completeDelivery(void* clientData);
+  struct timeval replayPresentationTime(struct timeval const& presentationTime) const;
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+  virtual void doStopGettingFrames();
+
+private:
+  friend class ProxyGOPCache;
+  ProxyGOPCache* fCache; // NULL if the cache has gone away
+  unsigned fClientSessionId;
+  RTPSink* fRTPSink;
+  Boolean fHasStarted, fDeliveryIsPending;
+  ProxyGOPCachedFrame* fNextFrame; // NULL if we've already delivered the most recent frame
+  ProxyGOPCacheReader* fNext;
+
+  // The cached frames that we replay (i.e., those up to and including the most recent one when we started), and how:
+  Boolean fIsReplaying;
+  unsigned long fReplayEndFrameNumber;
+  struct timeval fReplayEndPresentationTime;
+  double fReplayTimeScale; // <= 1.0
+};
+
 // A "OnDemandServerMediaSubsession" subclass, used to implement a unicast RTSP server that's proxying another RTSP stream:
 
 class ProxyServerMediaSubsession: public OnDemandServerMediaSubsession {
 public:
   ProxyServerMediaSubsession(MediaSubsession& mediaSubsession,
-			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP);
+			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP, Boolean cacheGOPs);
   virtual ~ProxyServerMediaSubsession();
 
   char const* codecName() const { return fCodecName; }
@@ -50,6 +148,19 @@ private: // redefined virtual functions
 				   unsigned char const* cname, RTPSink* sink);
 
 private:
+  friend class ProxyServerMediaSession;
+  void initiateSourceIfNecessary();
+  void startBackEndStream(); // sends "SETUP" (then "PLAY"), or "PLAY", to the back-end server, if necessary
+  void warmUp(); // called when the back-end stream is being kept 'warm', with or without clients
+  PresentationTimeSubsessionNormalizer* subsessionNormalizerFor(FramedSource* inputSource);
+
+  // When the back-end stream is being kept 'warm', but we have no clients, we read (and discard) incoming frames:
+  void startDraining();
+  void stopDraining();
+  static void afterDraining(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+			    struct timeval presentationTime, unsigned durationInMicroseconds);
+  static void onDrainingClosure(void* clientData);
+
   static void subsessionByeHandler(void* clientData);
   void subsessionByeHandler();
 
@@ -61,6 +172,35 @@ private:
   char const* fCodecName;  // copied from "fClientMediaSubsession" once it's been set up
   ProxyServerMediaSubsession* fNext; // used when we're part of a queue
   Boolean fHaveSetupStream;
+  Boolean fCacheGOPs;
+  ProxyGOPCache* fGOPCache; // non-NULL iff "fCacheGOPs", once our data source has been created
+  unsigned fNumClients; // the number of front-end clients currently using our data source (if we're caching GOPs: reading from "fGOPCache")
+  Boolean fIsDraining;
+  unsigned char* fDrainBuffer;
+};
+
+
+// A "ProxyKeepWarmTimer" calls "checkKeepWarm()" (about once per second) for each of a server's "ProxyServerMediaSession"s
+// that have a 'keep warm' policy.  There's one of these per server (rather than a periodic task for each session):
+
+#define KEEP_WARM_CHECK_INTERVAL_SECONDS 1
+
+class ProxyKeepWarmTimer {
+public:
+  static void addSession(ProxyServerMediaSession& session, GenericMediaServer* server);
+  static void removeSession(ProxyServerMediaSession& session, GenericMediaServer* server);
+
+private:
+  ProxyKeepWarmTimer(UsageEnvironment& env);
+  virtual ~ProxyKeepWarmTimer();
+
+  static void checkSessions(void* clientData);
+  void checkSessions();
+
+private:
+  UsageEnvironment& fEnv;
+  HashTable* fSessions; // the set of sessions that we check
+  TaskToken fCheckTask;
 };
 
 
@@ -80,15 +220,18 @@ defaultCreateNewProxyRTSPClientFunc(ProxyServerMediaSession& ourServerMediaSessi
 			     tunnelOverHTTPPortNum, verbosityLevel, socketNumToServer);
 }
 
+Boolean ProxyServerMediaSession::shareBackEndConnections = False; // default value; you can reassign this in your application
+
 ProxyServerMediaSession* ProxyServerMediaSession
 ::createNew(UsageEnvironment& env, GenericMediaServer* ourMediaServer,
 	    char const* inputStreamURL, char const* streamName,
 	    char const* username, char const* password,
 	    portNumBits tunnelOverHTTPPortNum, int verbosityLevel, int socketNumToServer,
-	    MediaTranscodingTable* transcodingTable) {
+	    MediaTranscodingTable* transcodingTable, Boolean cacheGOPs) {
   return new ProxyServerMediaSession(env, ourMediaServer, inputStreamURL, streamName, username, password,
 				     tunnelOverHTTPPortNum, verbosityLevel, socketNumToServer,
-				     transcodingTable);
+				     transcodingTable, defaultCreateNewProxyRTSPClientFunc,
+				     6970, False, cacheGOPs);
 }
 
 
@@ -100,14 +243,15 @@ ProxyServerMediaSession
 			  int socketNumToServer,
 			  MediaTranscodingTable* transcodingTable,
 			  createNewProxyRTSPClientFunc* ourCreateNewProxyRTSPClientFunc,
-			  portNumBits initialPortNum, Boolean multiplexRTCPWithRTP)
+			  portNumBits initialPortNum, Boolean multiplexRTCPWithRTP, Boolean cacheGOPs)
   : ServerMediaSession(env, streamName, NULL, NULL, False, NULL),
     describeCompletedFlag(0), fOurMediaServer(ourMediaServer), fClientMediaSession(NULL),
     fVerbosityLevel(verbosityLevel),
     fPresentationTimeSessionNormalizer(new PresentationTimeSessionNormalizer(envir())),
     fCreateNewProxyRTSPClientFunc(ourCreateNewProxyRTSPClientFunc),
     fTranscodingTable(transcodingTable),
-    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP) {
+    fInitialPortNum(initialPortNum), fMultiplexRTCPWithRTP(multiplexRTCPWithRTP), fCacheGOPs(cacheGOPs),
+    fKeepWarmIdleTimeout(0), fHaveHadClients(False) {
   // Open a RTSP connection to the input stream, and send a "DESCRIBE" command.
   // We'll use the SDP description in the response to set ourselves up.
   fProxyRTSPClient
@@ -115,6 +259,7 @@ ProxyServerMediaSession
 				       tunnelOverHTTPPortNum,
 				       verbosityLevel > 0 ? verbosityLevel-1 : verbosityLevel,
 				       socketNumToServer);
+  if (shareBackEndConnections) fProxyRTSPClient->allowConnectionSharing();
   ProxyRTSPClient::sendDESCRIBE(fProxyRTSPClient);
 }
 
@@ -128,7 +273,11 @@ ProxyServerMediaSession::~ProxyServerMediaSession() {
     fProxyRTSPClient->sendTeardownCommand(*fClientMediaSession, NULL, fProxyRTSPClient->auth());
   }
 
-  // Then delete our state:
+  if (fKeepWarmIdleTimeout != 0) ProxyKeepWarmTimer::removeSession(*this, fOurMediaServer);
+
+  // Then delete our state.  (Delete our "ProxyServerMediaSubsession"s first, because they might still be reading from
+  // "fClientMediaSession"s sources.)
+  deleteAllSubsessions();
   Medium::close(fClientMediaSession);
   Medium::close(fProxyRTSPClient);
   Medium::close(fPresentationTimeSessionNormalizer);
@@ -155,6 +304,68 @@ Boolean ProxyServerMediaSession::allowProxyingForSubsession(MediaSubsession cons
   return True;
 }
 
+void ProxyServerMediaSession::setKeepWarmPolicy(int idleTimeoutSeconds) {
+  if (fKeepWarmIdleTimeout != 0) ProxyKeepWarmTimer::removeSession(*this, fOurMediaServer);
+  fKeepWarmIdleTimeout = idleTimeoutSeconds;
+  if (fKeepWarmIdleTimeout != 0) {
+    ProxyKeepWarmTimer::addSession(*this, fOurMediaServer);
+    checkKeepWarm();
+  }
+}
+
+Boolean ProxyServerMediaSession::keepBackEndWarm(unsigned secondsWithoutClients) {
+  // Default implementation
+  return fKeepWarmIdleTimeout < 0 || secondsWithoutClients < (unsigned)fKeepWarmIdleTimeout;
+}
+
+void ProxyServerMediaSession::checkKeepWarm() {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  if (referenceCount() > 0) {
+    // We currently have client(s), so the back-end stream is already playing:
+    fHaveHadClients = True;
+    fTimeLastHadClients = timeNow;
+  } else if (fClientMediaSession != NULL // the back-end "DESCRIBE" has completed
+	     && fProxyRTSPClient->fSetupQueueHead == NULL) { // and we're not in the middle of "SETUP"ing the back-end stream
+    unsigned secondsWithoutClients = fHaveHadClients ? timeNow.tv_sec - fTimeLastHadClients.tv_sec : ~0;
+    Boolean const isPlaying = fProxyRTSPClient->fLastCommandWasPLAY;
+
+    if (keepBackEndWarm(secondsWithoutClients)) {
+      if (!isPlaying) warmUpBackEnd();
+    } else {
+      if (isPlaying) pauseBackEnd();
+    }
+  }
+}
+
+void ProxyServerMediaSession::warmUpBackEnd() {
+  if (fVerbosityLevel > 0) {
+    envir() << *this << ": keeping the back-end stream warm\n";
+  }
+
+  ServerMediaSubsessionIterator iter(*this);
+  ProxyServerMediaSubsession* psms;
+  while ((psms = (ProxyServerMediaSubsession*)(iter.next())) != NULL) psms->warmUp();
+}
+
+void ProxyServerMediaSession::pauseBackEnd() {
+  if (fVerbosityLevel > 0) {
+    envir() << *this << ": pausing the idle back-end stream\n";
+  }
+
+  fProxyRTSPClient->sendPauseCommand(*fClientMediaSession, NULL, fProxyRTSPClient->auth());
+  fProxyRTSPClient->fLastCommandWasPLAY = False;
+
+  ServerMediaSubsessionIterator iter(*this);
+  ProxyServerMediaSubsession* psms;
+  while ((psms = (ProxyServerMediaSubsession*)(iter.next())) != NULL) {
+    psms->stopDraining();
+    // Any GOP that we've cached will be stale by the time that the stream gets resumed, so discard it:
+    if (psms->fGOPCache != NULL) psms->fGOPCache->reset();
+  }
+}
+
 void ProxyServerMediaSession::continueAfterDESCRIBE(char const* sdpDescription) {
   describeCompletedFlag = 1;
 
@@ -168,8 +379,13 @@ void ProxyServerMediaSession::continueAfterDESCRIBE(char const* sdpDescription)
     for (MediaSubsession* mss = iter.next(); mss != NULL; mss = iter.next()) {
       if (!allowProxyingForSubsession(*mss)) continue;
 
+      // We cache GOPs only for H.264 and H.265 video tracks (and only if they're not being transcoded):
+      Boolean cacheGOPs = fCacheGOPs
+	&& (strcmp(mss->codecName(), "H264") == 0 || strcmp(mss->codecName(), "H265") == 0)
+	&& (fTranscodingTable == NULL || !fTranscodingTable->weWillTranscode(mss->mediumName(), mss->codecName()));
+
       ServerMediaSubsession* smss
-	= new ProxyServerMediaSubsession(*mss, fInitialPortNum, fMultiplexRTCPWithRTP);
+	= new ProxyServerMediaSubsession(*mss, fInitialPortNum, fMultiplexRTCPWithRTP, cacheGOPs);
       addSubsession(smss);
       if (fVerbosityLevel > 0) {
 	envir() << *this << " added new \"ProxyServerMediaSubsession\" for "
@@ -177,6 +393,9 @@ void ProxyServerMediaSession::continueAfterDESCRIBE(char const* sdpDescription)
       }
     }
   } while (0);
+
+  // If we're keeping the back-end stream 'warm', then check now (rather than waiting) whether it should be started:
+  if (fKeepWarmIdleTimeout != 0) checkKeepWarm();
 }
 
 void ProxyServerMediaSession::resetDESCRIBEState() {
@@ -235,6 +454,73 @@ static void continueAfterGET_PARAMETER(RTSPClient* rtspClient, int resultCode, c
 #endif
 
 
+////////// ProxyKeepWarmTimer implementation //////////
+
+// Each "UsageEnvironment"'s "_Tables" has a table that maps each server to its "ProxyKeepWarmTimer" (if any).
+// (Sessions that don't belong to a server share the timer for the NULL server.)
+
+void ProxyKeepWarmTimer::addSession(ProxyServerMediaSession& session, GenericMediaServer* server) {
+  _Tables* ourTables = _Tables::getOurTables(session.envir());
+  if (ourTables->proxyKeepWarmTimers == NULL) ourTables->proxyKeepWarmTimers = HashTable::create(ONE_WORD_HASH_KEYS);
+  HashTable* timers = (HashTable*)(ourTables->proxyKeepWarmTimers);
+
+  ProxyKeepWarmTimer* timer = (ProxyKeepWarmTimer*)(timers->Lookup((char const*)server));
+  if (timer == NULL) {
+    timer = new ProxyKeepWarmTimer(session.envir());
+    timers->Add((char const*)server, timer);
+  }
+  timer->fSessions->Add((char const*)&session, &session);
+}
+
+void ProxyKeepWarmTimer::removeSession(ProxyServerMediaSession& session, GenericMediaServer* server) {
+  _Tables* ourTables = _Tables::getOurTables(session.envir(), False);
+  if (ourTables == NULL || ourTables->proxyKeepWarmTimers == NULL) return;
+  HashTable* timers = (HashTable*)(ourTables->proxyKeepWarmTimers);
+
+  ProxyKeepWarmTimer* timer = (ProxyKeepWarmTimer*)(timers->Lookup((char const*)server));
+  if (timer == NULL) return;
+  timer->fSessions->Remove((char const*)&session);
+  if (!timer->fSessions->IsEmpty()) return;
+
+  // That was the server's last 'keep warm' session, so we no longer need its timer:
+  timers->Remove((char const*)server);
+  delete timer;
+  if (timers->IsEmpty()) {
+    delete timers;
+    ourTables->proxyKeepWarmTimers = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
+ProxyKeepWarmTimer::ProxyKeepWarmTimer(UsageEnvironment& env)
+  : fEnv(env), fSessions(HashTable::create(ONE_WORD_HASH_KEYS)) {
+  fCheckTask = fEnv.taskScheduler().scheduleDelayedTask(KEEP_WARM_CHECK_INTERVAL_SECONDS*MILLION,
+							(TaskFunc*)checkSessions, this);
+}
+
+ProxyKeepWarmTimer::~ProxyKeepWarmTimer() {
+  fEnv.taskScheduler().unscheduleDelayedTask(fCheckTask);
+  delete fSessions;
+}
+
+void ProxyKeepWarmTimer::checkSessions(void* clientData) {
+  ((ProxyKeepWarmTimer*)clientData)->checkSessions();
+}
+
+void ProxyKeepWarmTimer::checkSessions() {
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fSessions);
+  ProxyServerMediaSession* session;
+  char const* key; // dummy
+  while ((session = (ProxyServerMediaSession*)(iter->next(key))) != NULL) {
+    session->checkKeepWarm();
+  }
+  delete iter;
+
+  fCheckTask = fEnv.taskScheduler().scheduleDelayedTask(KEEP_WARM_CHECK_INTERVAL_SECONDS*MILLION,
+							(TaskFunc*)checkSessions, this);
+}
+
+
 ////////// "ProxyRTSPClient" implementation /////////
 
 UsageEnvironment& operator<<(UsageEnvironment& env, const ProxyRTSPClient& proxyRTSPClient) { // used for debugging
@@ -469,11 +755,15 @@ void ProxyRTSPClient::handleSubsessionTimeout() {
 
 ProxyServerMediaSubsession
 ::ProxyServerMediaSubsession(MediaSubsession& mediaSubsession,
-			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP)
-  : OnDemandServerMediaSubsession(mediaSubsession.parentSession().envir(), True/*reuseFirstSource*/,
+			     portNumBits initialPortNum, Boolean multiplexRTCPWithRTP, Boolean cacheGOPs)
+  : OnDemandServerMediaSubsession(mediaSubsession.parentSession().envir(), !cacheGOPs/*reuseFirstSource*/,
 				  initialPortNum, multiplexRTCPWithRTP),
     fClientMediaSubsession(mediaSubsession), fCodecName(strDup(mediaSubsession.codecName())),
-    fNext(NULL), fHaveSetupStream(False) {
+    fNext(NULL), fHaveSetupStream(False),
+    fCacheGOPs(cacheGOPs), fGOPCache(NULL), fNumClients(0), fIsDraining(False), fDrainBuffer(NULL) {
+  // Note: If we're caching GOPs, then each client gets its own source (a "ProxyGOPCacheReader", followed by a 'framer')
+  // and "RTPSink" - because each client's stream begins with a replay of the cached GOP - so we don't 'reuse the first
+  // source'.  (This is described in "ProxyServerMediaSession.hh".)
 }
 
 UsageEnvironment& operator<<(UsageEnvironment& env, const ProxyServerMediaSubsession& psmss) { // used for debugging
@@ -485,17 +775,44 @@ ProxyServerMediaSubsession::~ProxyServerMediaSubsession() {
     envir() << *this << "::~ProxyServerMediaSubsession()\n";
   }
 
+  stopDraining();
+  delete[] fDrainBuffer;
+  delete fGOPCache;
   delete[] (char*)fCodecName;
 }
 
 FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientSessionId, unsigned& estBitrate) {
-  ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
-
   if (verbosityLevel() > 0) {
     envir() << *this << "::createNewStreamSource(session id " << clientSessionId << ")\n";
   }
 
+  stopDraining(); // because our data source is about to be read by a client
+
   // If we haven't yet created a data source from our 'media subsession' object, initiate() it to do so:
+  initiateSourceIfNecessary();
+
+  if (clientSessionId != 0) {
+    // We're being called as a result of implementing a RTSP "SETUP".
+    ++fNumClients;
+    startBackEndStream();
+  }
+
+  estBitrate = fClientMediaSubsession.bandwidth();
+  if (estBitrate == 0) estBitrate = 50; // kbps, estimate
+  if (fGOPCache == NULL) return fClientMediaSubsession.readSource();
+
+  // Give this client its own reader of our GOP cache (and 'framer'):
+  ProxyGOPCacheReader* reader = new ProxyGOPCacheReader(*fGOPCache, clientSessionId);
+  if (strcmp(fCodecName, "H265") == 0) {
+    return H265VideoStreamDiscreteFramer::createNew(envir(), reader);
+  } else {
+    return H264VideoStreamDiscreteFramer::createNew(envir(), reader);
+  }
+}
+
+void ProxyServerMediaSubsession::initiateSourceIfNecessary() {
+  ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
+
   if (fClientMediaSubsession.readSource() == NULL) {
     if (sms->fTranscodingTable == NULL || !sms->fTranscodingTable->weWillTranscode("audio", "MPA-ROBUST")) fClientMediaSubsession.receiveRawMP3ADUs(); // hack for proxying MPA-ROBUST streams
     if (sms->fTranscodingTable == NULL || !sms->fTranscodingTable->weWillTranscode("video", "JPEG")) fClientMediaSubsession.receiveRawJPEGFrames(); // hack for proxying JPEG/RTP streams.
@@ -524,9 +841,18 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
 							fCodecName);
       fClientMediaSubsession.addFilter(normalizerFilter);
 
+      if (fCacheGOPs) {
+	// Our (H.264 or H.265) data source is read only by a 'GOP cache'.  Each client reads from the cache, via its own
+	// 'framer' (which we create below):
+	fGOPCache = new ProxyGOPCache(envir(), fClientMediaSubsession.readSource(), fClientMediaSubsession.rtpSource(),
+				      strcmp(fCodecName, "H265") == 0);
+      }
+
       // Some data sources require a 'framer' object to be added, before they can be fed into
       // a "RTPSink".  Adjust for this now:
-      if (strcmp(fCodecName, "H264") == 0) {
+      if (fCacheGOPs) {
+	// (We'll add the 'framer' later, for each client)
+      } else if (strcmp(fCodecName, "H264") == 0) {
 	fClientMediaSubsession.addFilter(H264VideoStreamDiscreteFramer
 					 ::createNew(envir(), fClientMediaSubsession.readSource()));
       } else if (strcmp(fCodecName, "H265") == 0) {
@@ -551,65 +877,121 @@ FramedSource* ProxyServerMediaSubsession::createNewStreamSource(unsigned clientS
       fClientMediaSubsession.rtcpInstance()->setByeHandler(subsessionByeHandler, this);
     }
   }
+}
 
+void ProxyServerMediaSubsession::startBackEndStream() {
+  ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
   ProxyRTSPClient* const proxyRTSPClient = sms->fProxyRTSPClient;
-  if (clientSessionId != 0) {
-    // We're being called as a result of implementing a RTSP "SETUP".
-    if (!fHaveSetupStream) {
-      // This is our first "SETUP".  Send RTSP "SETUP" and later "PLAY" commands to the proxied server, to start streaming:
-      // (Before sending "SETUP", enqueue ourselves on the "RTSPClient"s 'SETUP queue', so we'll be able to get the correct
-      //  "ProxyServerMediaSubsession" to handle the response.  (Note that responses come back in the same order as requests.))
-      Boolean queueWasEmpty = proxyRTSPClient->fSetupQueueHead == NULL;
-      if (queueWasEmpty) {
-	proxyRTSPClient->fSetupQueueHead = this;
-	proxyRTSPClient->fSetupQueueTail = this;
-      } else {
-	// Add ourself to the "RTSPClient"s 'SETUP queue' (if we're not already on it):
-	ProxyServerMediaSubsession* psms;
-	for (psms = proxyRTSPClient->fSetupQueueHead; psms != NULL; psms = psms->fNext) {
-	  if (psms == this) break;
-	}
-	if (psms == NULL) {
-	    proxyRTSPClient->fSetupQueueTail->fNext = this;
-	    proxyRTSPClient->fSetupQueueTail = this;
-	}
-      }
 
-      // Hack: If there's already a pending "SETUP" request, don't send this track's "SETUP" right away, because
-      // the server might not properly handle 'pipelined' requests.  Instead, wait until after previous "SETUP" responses come back.
-      if (queueWasEmpty) {
-	proxyRTSPClient->sendSetupCommand(fClientMediaSubsession, ::continueAfterSETUP,
-					  False, proxyRTSPClient->fStreamRTPOverTCP, False, proxyRTSPClient->auth());
-	++proxyRTSPClient->fNumSetupsDone;
-	fHaveSetupStream = True;
-      }
+  if (!fHaveSetupStream) {
+    // This is our first "SETUP".  Send RTSP "SETUP" and later "PLAY" commands to the proxied server, to start streaming:
+    // (Before sending "SETUP", enqueue ourselves on the "RTSPClient"s 'SETUP queue', so we'll be able to get the correct
+    //  "ProxyServerMediaSubsession" to handle the response.  (Note that responses come back in the same order as requests.))
+    Boolean queueWasEmpty = proxyRTSPClient->fSetupQueueHead == NULL;
+    if (queueWasEmpty) {
+      proxyRTSPClient->fSetupQueueHead = this;
+      proxyRTSPClient->fSetupQueueTail = this;
     } else {
-      // This is a "SETUP" from a new client.  We know that there are no other currently active clients (otherwise we wouldn't
-      // have been called here), so we know that the substream was previously "PAUSE"d.  Send "PLAY" downstream once again,
-      // to resume the stream:
-      if (!proxyRTSPClient->fLastCommandWasPLAY) { // so that we send only one "PLAY"; not one for each subsession
-	proxyRTSPClient->sendPlayCommand(fClientMediaSubsession.parentSession(), ::continueAfterPLAY, -1.0f/*resume from previous point*/,
-					 -1.0f, 1.0f, proxyRTSPClient->auth());
-	proxyRTSPClient->fLastCommandWasPLAY = True;
+      // Add ourself to the "RTSPClient"s 'SETUP queue' (if we're not already on it):
+      ProxyServerMediaSubsession* psms;
+      for (psms = proxyRTSPClient->fSetupQueueHead; psms != NULL; psms = psms->fNext) {
+	if (psms == this) break;
       }
+      if (psms == NULL) {
+	  proxyRTSPClient->fSetupQueueTail->fNext = this;
+	  proxyRTSPClient->fSetupQueueTail = this;
+      }
+    }
+
+    // Hack: If there's already a pending "SETUP" request, don't send this track's "SETUP" right away, because
+    // the server might not properly handle 'pipelined' requests.  Instead, wait until after previous "SETUP" responses come back.
+    if (queueWasEmpty) {
+      proxyRTSPClient->sendSetupCommand(fClientMediaSubsession, ::continueAfterSETUP,
+					False, proxyRTSPClient->fStreamRTPOverTCP, False, proxyRTSPClient->auth());
+      ++proxyRTSPClient->fNumSetupsDone;
+      fHaveSetupStream = True;
+    }
+  } else {
+    // This is a "SETUP" from a new client (or we're 'warming up' the back-end stream).  The substream might
+    // have previously been "PAUSE"d.  Send "PLAY" downstream once again (if necessary), to resume the stream:
+    if (!proxyRTSPClient->fLastCommandWasPLAY) { // so that we send only one "PLAY"; not one for each subsession
+      proxyRTSPClient->sendPlayCommand(fClientMediaSubsession.parentSession(), ::continueAfterPLAY, -1.0f/*resume from previous point*/,
+				       -1.0f, 1.0f, proxyRTSPClient->auth());
+      proxyRTSPClient->fLastCommandWasPLAY = True;
     }
   }
+}
 
-  estBitrate = fClientMediaSubsession.bandwidth();
-  if (estBitrate == 0) estBitrate = 50; // kbps, estimate
-  return fClientMediaSubsession.readSource();
+void ProxyServerMediaSubsession::warmUp() {
+  initiateSourceIfNecessary();
+  startBackEndStream();
+  if (fNumClients == 0) startDraining();
+}
+
+void ProxyServerMediaSubsession::startDraining() {
+  if (fIsDraining || fGOPCache != NULL) return; // a GOP cache always reads from our source anyway
+  FramedSource* source = fClientMediaSubsession.readSource();
+  if (source == NULL) return;
+
+  if (fDrainBuffer == NULL) fDrainBuffer = new unsigned char[OutPacketBuffer::maxSize];
+  fIsDraining = True;
+  source->getNextFrame(fDrainBuffer, OutPacketBuffer::maxSize, afterDraining, this, onDrainingClosure, this);
+}
+
+void ProxyServerMediaSubsession::stopDraining() {
+  if (!fIsDraining) return;
+
+  fIsDraining = False;
+  FramedSource* source = fClientMediaSubsession.readSource();
+  if (source != NULL) source->stopGettingFrames();
+}
+
+void ProxyServerMediaSubsession::afterDraining(void* clientData, unsigned /*frameSize*/, unsigned /*numTruncatedBytes*/,
+					       struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  ProxyServerMediaSubsession* psms = (ProxyServerMediaSubsession*)clientData;
+  psms->fIsDraining = False;
+  psms->startDraining(); // read (and discard) the next frame
+}
+
+void ProxyServerMediaSubsession::onDrainingClosure(void* clientData) {
+  ((ProxyServerMediaSubsession*)clientData)->fIsDraining = False;
 }
 
 void ProxyServerMediaSubsession::closeStreamSource(FramedSource* inputSource) {
   if (verbosityLevel() > 0) {
     envir() << *this << "::closeStreamSource()\n";
   }
+  ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
+  Boolean wasForClient;
+  if (fGOPCache != NULL) {
+    // Each client has its own 'framer' and "ProxyGOPCacheReader", which we close now.  (But we keep the GOP cache.)
+    if (inputSource == NULL) return; // this client's source has already been closed
+    ProxyGOPCacheReader* reader = (ProxyGOPCacheReader*)(((FramedFilter*)inputSource)->inputSource());
+    wasForClient = reader->clientSessionId() != 0;
+    Medium::close(inputSource);
+  } else {
+    // (If we have no clients, then we're being called for the source that was used only to generate our SDP description.)
+    wasForClient = fNumClients > 0;
+
+    // The "RTPSink" that was fed from our source has already been closed, so make sure that our
+    // "PresentationTimeSubsessionNormalizer" no longer refers to it (because frames might still arrive):
+    if (inputSource != NULL) subsessionNormalizerFor(inputSource)->setRTPSink(NULL);
+  }
+  if (wasForClient && --fNumClients > 0) return; // there are other clients still using our source
+
+  if (sms->fKeepWarmIdleTimeout != 0) {
+    // We're keeping the back-end stream 'warm', so don't "PAUSE" it now.  (Our "ProxyServerMediaSession" will do so
+    // later, if it needs to.)  Until a new client arrives, read and discard its frames:
+    if (sms->fProxyRTSPClient->fLastCommandWasPLAY) startDraining();
+    return;
+  }
+  if (!wasForClient) return;
+
   // Because there's only one input source for this 'subsession' (regardless of how many downstream clients are proxying it),
   // we don't close the input source here.  (Instead, we wait until *this* object gets deleted.)
   // However, because (as evidenced by this function having been called) we no longer have any clients accessing the stream,
   // then we "PAUSE" the downstream proxied stream, until a new client arrives:
   if (fHaveSetupStream) {
-    ProxyServerMediaSession* const sms = (ProxyServerMediaSession*)fParentSession;
     ProxyRTSPClient* const proxyRTSPClient = sms->fProxyRTSPClient;
     if (proxyRTSPClient->fLastCommandWasPLAY) { // so that we send only one "PAUSE"; not one for each subsession
       if (fParentSession->referenceCount() > 1) {
@@ -623,6 +1005,9 @@ void ProxyServerMediaSubsession::closeStreamSource(FramedSource* inputSource) {
 	proxyRTSPClient->fLastCommandWasPLAY = False;
       }
     }
+
+    // Any GOP that we've cached will be stale by the time that the stream gets resumed, so discard it:
+    if (fGOPCache != NULL) fGOPCache->reset();
   }
 }
 
@@ -735,21 +1120,30 @@ RTPSink* ProxyServerMediaSubsession
   // we temporarily disable RTCP "SR" reports for this "RTPSink" object:
   newSink->enableRTCPReports() = False;
 
+  if (fGOPCache != NULL) {
+    // Our "PresentationTimeSubsessionNormalizer" is shared by all clients, so it's this client's "ProxyGOPCacheReader"
+    // (just behind the 'framer') that enables RTCP "SR" reports later:
+    ((ProxyGOPCacheReader*)(((FramedFilter*)inputSource)->inputSource()))->setRTPSink(newSink);
+    return newSink;
+  }
+
   // Also tell our "PresentationTimeSubsessionNormalizer" object about the "RTPSink", so it can enable RTCP "SR" reports later:
-  PresentationTimeSubsessionNormalizer* ssNormalizer;
+  subsessionNormalizerFor(inputSource)->setRTPSink(newSink);
+
+  return newSink;
+}
+
+PresentationTimeSubsessionNormalizer* ProxyServerMediaSubsession::subsessionNormalizerFor(FramedSource* inputSource) {
   if (strcmp(fCodecName, "H264") == 0 ||
       strcmp(fCodecName, "H265") == 0 ||
       strcmp(fCodecName, "MP4V-ES") == 0 ||
       strcmp(fCodecName, "MPV") == 0 ||
       strcmp(fCodecName, "DV") == 0) {
     // There was a separate 'framer' object in front of the "PresentationTimeSubsessionNormalizer", so go back one object to get it:
-    ssNormalizer = (PresentationTimeSubsessionNormalizer*)(((FramedFilter*)inputSource)->inputSource());
+    return (PresentationTimeSubsessionNormalizer*)(((FramedFilter*)inputSource)->inputSource());
   } else {
-    ssNormalizer = (PresentationTimeSubsessionNormalizer*)inputSource;
+    return (PresentationTimeSubsessionNormalizer*)inputSource;
   }
-  ssNormalizer->setRTPSink(newSink);
-
-  return newSink;
 }
 
 Groupsock* ProxyServerMediaSubsession::createGroupsock(struct in_addr const& addr, Port port) {
@@ -787,6 +1181,364 @@ void ProxyServerMediaSubsession::subsessionByeHandler() {
 }
 
 
+////////// ProxyGOPCache and ProxyGOPCacheReader implementations //////////
+
+class ProxyGOPCachedFrame {
+public:
+  ProxyGOPCachedFrame(unsigned char const* data, unsigned size, struct timeval presentationTime, unsigned long frameNumber)
+    : fData(new unsigned char[size]), fSize(size), fPresentationTime(presentationTime), fFrameNumber(frameNumber), fNext(NULL) {
+    memmove(fData, data, size);
+  }
+  virtual ~ProxyGOPCachedFrame() { delete[] fData; }
+
+public:
+  unsigned char* fData;
+  unsigned fSize;
+  struct timeval fPresentationTime;
+  unsigned long fFrameNumber; // increases by 1 for each frame added to the cache
+  ProxyGOPCachedFrame* fNext;
+};
+
+// ProxyGOPCache:
+
+ProxyGOPCache::ProxyGOPCache(UsageEnvironment& env, FramedSource* inputSource, RTPSource* rtpSource, Boolean isH265)
+  : fEnv(env), fInputSource(inputSource), fRTPSource(rtpSource), fIsH265(isH265), fSourceHasClosed(False),
+    fWasSynchronized(False), fBuffer(new unsigned char[OutPacketBuffer::maxSize]),
+    fHead(NULL), fTail(NULL), fNextFrameNumber(0), fTotalSize(0), fGOPStart(NULL), fGOPSize(0),
+    fNonVCLRunStart(NULL), fParameterSetsInNonVCLRun(0), fReaders(NULL) {
+  for (unsigned i = 0; i < 3; ++i) fParameterSets[i] = NULL;
+
+  readNextFrame();
+}
+
+ProxyGOPCache::~ProxyGOPCache() {
+  if (fInputSource != NULL) fInputSource->stopGettingFrames();
+
+  // Any remaining readers (there shouldn't be any) can no longer use us:
+  for (ProxyGOPCacheReader* reader = fReaders; reader != NULL; reader = reader->fNext) {
+    reader->fCache = NULL;
+    reader->fNextFrame = NULL;
+  }
+
+  reset();
+  for (unsigned i = 0; i < 3; ++i) delete fParameterSets[i];
+  delete[] fBuffer;
+}
+
+void ProxyGOPCache::reset() {
+  fGOPStart = NULL; fGOPSize = 0;
+  fNonVCLRunStart = NULL; fParameterSetsInNonVCLRun = 0;
+  trim();
+}
+
+void ProxyGOPCache::addReader(ProxyGOPCacheReader* reader) {
+  reader->fNext = fReaders;
+  fReaders = reader;
+}
+
+void ProxyGOPCache::removeReader(ProxyGOPCacheReader* reader) {
+  ProxyGOPCacheReader** readerPtr = &fReaders;
+  while (*readerPtr != NULL) {
+    if (*readerPtr == reader) {
+      *readerPtr = reader->fNext;
+      break;
+    }
+    readerPtr = &((*readerPtr)->fNext);
+  }
+  reader->fNextFrame = NULL;
+
+  trim(); // because the frames that this reader had yet to read might no longer be needed
+}
+
+void ProxyGOPCache::readNextFrame() {
+  fInputSource->getNextFrame(fBuffer, OutPacketBuffer::maxSize, afterGettingFrame, this, onSourceClosure, this);
+}
+
+void ProxyGOPCache::afterGettingFrame(void* clientData, unsigned frameSize,
+				      unsigned /*numTruncatedBytes*/,
+				      struct timeval presentationTime,
+				      unsigned /*durationInMicroseconds*/) {
+  ((ProxyGOPCache*)clientData)->afterGettingFrame(frameSize, presentationTime);
+}
+
+void ProxyGOPCache::afterGettingFrame(unsigned frameSize, struct timeval presentationTime) {
+  // Figure out the type of this NAL unit (skipping over any preceding 'start code'):
+  unsigned char const* nal = fBuffer;
+  unsigned nalSize = frameSize;
+  if (nalSize >= 4 && nal[0] == 0 && nal[1] == 0 && ((nal[2] == 0 && nal[3] == 1) || nal[2] == 1)) {
+    unsigned startCodeSize = nal[2] == 1 ? 3 : 4;
+    nal += startCodeSize; nalSize -= startCodeSize;
+  }
+  if (nalSize == 0) { // ignore this frame
+    readNextFrame();
+    return;
+  }
+
+  int parameterSetIndex = -1; // for a VPS (H.265 only), SPS, or PPS
+  Boolean isVCL, isKeyFrame;
+  if (fIsH265) {
+    u_int8_t const nal_unit_type = (nal[0]&0x7E)>>1;
+    isVCL = nal_unit_type <= 31;
+    isKeyFrame = nal_unit_type >= 16 && nal_unit_type <= 21; // IRAP
+    if (nal_unit_type >= 32 && nal_unit_type <= 34) parameterSetIndex = nal_unit_type - 32;
+  } else {
+    u_int8_t const nal_unit_type = nal[0]&0x1F;
+    isVCL = nal_unit_type >= 1 && nal_unit_type <= 5;
+    isKeyFrame = nal_unit_type == 5; // IDR
+    if (nal_unit_type == 7 || nal_unit_type == 8) parameterSetIndex = nal_unit_type - 6;
+  }
+
+  // Once our source starts getting RTCP-synchronized, its presentation times jump, so don't use a GOP from before then:
+  Boolean const isSynchronized = fRTPSource != NULL && fRTPSource->hasBeenSynchronizedUsingRTCP();
+  if (isSynchronized != fWasSynchronized) {
+    fWasSynchronized = isSynchronized;
+    fGOPStart = NULL; fGOPSize = 0;
+  }
+
+  if (isKeyFrame && (fGOPStart == NULL
+		     || presentationTime.tv_sec != fKeyFramePresentationTime.tv_sec
+		     || presentationTime.tv_usec != fKeyFramePresentationTime.tv_usec)) {
+    // This key frame begins a new GOP.  Make sure that it's preceded by the most recent parameter sets
+    // (because the back-end server might not send these with every key frame):
+    for (unsigned i = 0; i < 3; ++i) {
+      ProxyGOPCachedFrame const* ps = fParameterSets[i];
+      if (ps != NULL && (fParameterSetsInNonVCLRun&(1<<i)) == 0) {
+	ProxyGOPCachedFrame* frame = appendFrame(ps->fData, ps->fSize, presentationTime);
+	if (fNonVCLRunStart == NULL) fNonVCLRunStart = frame;
+      }
+    }
+
+    // The new GOP begins with the non-VCL NAL units (e.g., parameter sets) that immediately precede the key frame:
+    fGOPStart = fNonVCLRunStart;
+    fGOPSize = 0;
+    for (ProxyGOPCachedFrame* f = fGOPStart; f != NULL; f = f->fNext) fGOPSize += f->fSize;
+    fKeyFramePresentationTime = presentationTime;
+  }
+
+  if (parameterSetIndex >= 0) {
+    // Also keep a copy of the most recent parameter set of this type:
+    delete fParameterSets[parameterSetIndex];
+    fParameterSets[parameterSetIndex] = new ProxyGOPCachedFrame(fBuffer, frameSize, presentationTime, 0);
+  }
+
+  ProxyGOPCachedFrame* frame = appendFrame(fBuffer, frameSize, presentationTime);
+  if (isVCL) {
+    fNonVCLRunStart = NULL; fParameterSetsInNonVCLRun = 0;
+    if (fGOPStart == NULL && isKeyFrame) fGOPStart = frame; // there were no preceding non-VCL NAL units
+  } else {
+    if (fNonVCLRunStart == NULL) fNonVCLRunStart = frame;
+    if (parameterSetIndex >= 0) fParameterSetsInNonVCLRun |= 1<<parameterSetIndex;
+  }
+  if (fGOPStart == frame) fGOPSize = frame->fSize;
+
+  if (fGOPStart != NULL && fGOPSize > GOP_CACHE_MAX_SIZE) {
+    // This GOP is too long to cache.  Wait for the next one:
+    fGOPStart = NULL; fGOPSize = 0;
+  }
+
+  // Deliver the new frame to each reader that was waiting for it:
+  ProxyGOPCacheReader* nextReader;
+  for (ProxyGOPCacheReader* reader = fReaders; reader != NULL; reader = nextReader) {
+    nextReader = reader->fNext; // in case "reader" gets closed during delivery
+    if (reader->fHasStarted && reader->fNextFrame == NULL) {
+      reader->fNextFrame = frame;
+      if (reader->isCurrentlyAwaitingData() && !reader->fDeliveryIsPending) reader->deliverFrame(True);
+    }
+  }
+
+  trim();
+  readNextFrame();
+}
+
+void ProxyGOPCache::onSourceClosure(void* clientData) {
+  ((ProxyGOPCache*)clientData)->onSourceClosure();
+}
+
+void ProxyGOPCache::onSourceClosure() {
+  fSourceHasClosed = True;
+
+  // Signal the closure to each reader that is currently awaiting a frame:
+  ProxyGOPCacheReader* nextReader;
+  for (ProxyGOPCacheReader* reader = fReaders; reader != NULL; reader = nextReader) {
+    nextReader = reader->fNext;
+    if (reader->isCurrentlyAwaitingData() && reader->fNextFrame == NULL && !reader->fDeliveryIsPending) reader->handleClosure();
+  }
+}
+
+ProxyGOPCachedFrame* ProxyGOPCache
+::appendFrame(unsigned char const* data, unsigned size, struct timeval presentationTime) {
+  ProxyGOPCachedFrame* frame = new ProxyGOPCachedFrame(data, size, presentationTime, fNextFrameNumber++);
+  if (fTail == NULL) {
+    fHead = fTail = frame;
+  } else {
+    fTail->fNext = frame;
+    fTail = frame;
+  }
+  fTotalSize += size;
+  if (fGOPStart != NULL) fGOPSize += size;
+
+  return frame;
+}
+
+void ProxyGOPCache::trim() {
+  // We need to keep the frames from the start of the current GOP (and any non-VCL NAL units that might begin the next GOP),
+  // and all frames that have yet to be read by readers.  However, if this adds up to too much data, then move the readers
+  // that have fallen furthest behind forward, to the start of the current GOP (or else to the next frame):
+  ProxyGOPCacheReader* reader;
+  if (fTotalSize > GOP_CACHE_MAX_SIZE) {
+    ProxyGOPCachedFrame* newPosition = fGOPStart != NULL ? fGOPStart : fNonVCLRunStart;
+    unsigned long const newFrameNumber = newPosition != NULL ? newPosition->fFrameNumber : fNextFrameNumber;
+
+    for (reader = fReaders; reader != NULL; reader = reader->fNext) {
+      if (reader->fNextFrame != NULL && reader->fNextFrame->fFrameNumber < newFrameNumber) {
+	reader->fNextFrame = newPosition;
+      }
+    }
+  }
+
+  unsigned long firstNeededFrameNumber = fNextFrameNumber;
+  if (fGOPStart != NULL) firstNeededFrameNumber = fGOPStart->fFrameNumber;
+  if (fNonVCLRunStart != NULL && fNonVCLRunStart->fFrameNumber < firstNeededFrameNumber) {
+    firstNeededFrameNumber = fNonVCLRunStart->fFrameNumber;
+  }
+  for (reader = fReaders; reader != NULL; reader = reader->fNext) {
+    if (reader->fNextFrame != NULL && reader->fNextFrame->fFrameNumber < firstNeededFrameNumber) {
+      firstNeededFrameNumber = reader->fNextFrame->fFrameNumber;
+    }
+  }
+
+  while (fHead != NULL && fHead->fFrameNumber < firstNeededFrameNumber) {
+    ProxyGOPCachedFrame* frame = fHead;
+    fHead = frame->fNext;
+    if (fHead == NULL) fTail = NULL;
+    fTotalSize -= frame->fSize;
+    delete frame;
+  }
+}
+
+// ProxyGOPCacheReader:
+
+ProxyGOPCacheReader::ProxyGOPCacheReader(ProxyGOPCache& cache, unsigned clientSessionId)
+  : FramedSource(cache.fEnv),
+    fCache(&cache), fClientSessionId(clientSessionId), fRTPSink(NULL), fHasStarted(False), fDeliveryIsPending(False),
+    fNextFrame(NULL), fNext(NULL), fIsReplaying(False), fReplayEndFrameNumber(0), fReplayTimeScale(1.0) {
+  fCache->addReader(this);
+}
+
+ProxyGOPCacheReader::~ProxyGOPCacheReader() {
+  if (fCache != NULL) fCache->removeReader(this);
+}
+
+void ProxyGOPCacheReader::doGetNextFrame() {
+  if (fCache == NULL) {
+    handleClosure();
+    return;
+  }
+
+  if (!fHasStarted) {
+    // This is our first read.  Begin with the cached GOP (if any), which we replay - ending with the most recent frame -
+    // over at most GOP_CACHE_MAX_REPLAY_DURATION:
+    fHasStarted = True;
+    fNextFrame = fCache->fGOPStart;
+    if (fNextFrame != NULL) {
+      ProxyGOPCachedFrame const* lastFrame = fCache->fTail;
+      fIsReplaying = True;
+      fReplayEndFrameNumber = lastFrame->fFrameNumber;
+      fReplayEndPresentationTime = lastFrame->fPresentationTime;
+
+      double gopDuration // in microseconds
+	= (lastFrame->fPresentationTime.tv_sec - fNextFrame->fPresentationTime.tv_sec)*1000000.0
+	+ (lastFrame->fPresentationTime.tv_usec - fNextFrame->fPresentationTime.tv_usec);
+      fReplayTimeScale = gopDuration > GOP_CACHE_MAX_REPLAY_DURATION ? GOP_CACHE_MAX_REPLAY_DURATION/gopDuration : 1.0;
+    }
+  }
+
+  if (fNextFrame != NULL) {
+    // Deliver this (cached) frame, but not from within this call, because our downstream object might call us again:
+    deliverFrame(False);
+  } else if (fCache->fSourceHasClosed) {
+    handleClosure();
+  }
+  // Otherwise, we wait until the cache gets a new frame
+}
+
+void ProxyGOPCacheReader::doStopGettingFrames() {
+  envir().taskScheduler().unscheduleDelayedTask(nextTask());
+  fDeliveryIsPending = False;
+}
+
+void ProxyGOPCacheReader::deliverFrame(Boolean completeDeliveryNow) {
+  ProxyGOPCachedFrame* frame = fNextFrame;
+  fNextFrame = frame->fNext;
+
+  if (frame->fSize > fMaxSize) {
+    fFrameSize = fMaxSize;
+    fNumTruncatedBytes = frame->fSize - fMaxSize;
+  } else {
+    fFrameSize = frame->fSize;
+    fNumTruncatedBytes = 0;
+  }
+  memmove(fTo, frame->fData, fFrameSize);
+  fPresentationTime = frame->fPresentationTime;
+  fDurationInMicroseconds = 0;
+
+  if (fIsReplaying && frame->fFrameNumber > fReplayEndFrameNumber) fIsReplaying = False; // e.g., if we were moved forward
+  if (fIsReplaying) {
+    // This is a replayed (cached) frame.  Rebase its presentation time onto the live timeline - so that the replay ends at
+    // the presentation time of the most recent frame (from which the live frames continue) - and pace it, using the
+    // (rebased) time until the next replayed frame:
+    fPresentationTime = replayPresentationTime(frame->fPresentationTime);
+    if (frame->fFrameNumber == fReplayEndFrameNumber) {
+      fIsReplaying = False;
+    } else if (frame->fNext != NULL) {
+      struct timeval nextPresentationTime = replayPresentationTime(frame->fNext->fPresentationTime);
+      int duration = (nextPresentationTime.tv_sec - fPresentationTime.tv_sec)*1000000
+	+ (nextPresentationTime.tv_usec - fPresentationTime.tv_usec);
+      if (duration > 0) fDurationInMicroseconds = duration;
+    }
+  }
+
+  // Once our source has been RTCP-synchronized, our relayed presentation times are accurate, so enable RTCP "SR" reports:
+  if (fRTPSink != NULL && fCache->rtpSource() != NULL && fCache->rtpSource()->hasBeenSynchronizedUsingRTCP()) {
+    fRTPSink->enableRTCPReports() = True;
+  }
+
+  if (completeDeliveryNow) {
+    FramedSource::afterGetting(this);
+  } else {
+    fDeliveryIsPending = True;
+    nextTask() = envir().taskScheduler().scheduleDelayedTask(0, completeDelivery, this);
+  }
+}
+
+struct timeval ProxyGOPCacheReader::replayPresentationTime(struct timeval const& presentationTime) const {
+  // Scale this frame's offset from the end of the replay by "fReplayTimeScale":
+  double offset // in microseconds
+    = (fReplayEndPresentationTime.tv_sec - presentationTime.tv_sec)*1000000.0
+    + (fReplayEndPresentationTime.tv_usec - presentationTime.tv_usec);
+  int scaledOffset = (int)(offset*fReplayTimeScale);
+
+  struct timeval result = fReplayEndPresentationTime;
+  result.tv_sec -= scaledOffset/1000000;
+  result.tv_usec -= scaledOffset%1000000;
+  if (result.tv_usec < 0) {
+    result.tv_usec += 1000000;
+    --result.tv_sec;
+  } else if (result.tv_usec >= 1000000) {
+    result.tv_usec -= 1000000;
+    ++result.tv_sec;
+  }
+  return result;
+}
+
+void ProxyGOPCacheReader::completeDelivery(void* clientData) {
+  ProxyGOPCacheReader* reader = (ProxyGOPCacheReader*)clientData;
+  reader->nextTask() = NULL;
+  reader->fDeliveryIsPending = False;
+  FramedSource::afterGetting(reader);
+}
+
+
 ////////// PresentationTimeSessionNormalizer and PresentationTimeSubsessionNormalizer implementations //////////
 
 // PresentationTimeSessionNormalizer:
@@ -842,7 +1594,7 @@ void PresentationTimeSessionNormalizer
 
     // Because "ssNormalizer"s relayed presentation times are accurate from now on, enable RTCP "SR" reports for its "RTPSink":
     RTPSink* const rtpSink = ssNormalizer->fRTPSink;
-    if (rtpSink != NULL) { // sanity check; should always be true
+    if (rtpSink != NULL) { // (it won't be, if we're draining a 'warm' back-end stream that has no clients)
       rtpSink->enableRTCPReports() = True;
     }
   }
@@ -894,7 +1646,9 @@ void PresentationTimeSubsessionNormalizer::afterGettingFrame(unsigned frameSize,
 
   // Hack for JPEG/RTP proxying.  Because we're proxying JPEG by just copying the raw JPEG/RTP payloads, without interpreting them,
   // we need to also 'copy' the RTP 'M' (marker) bit from the "RTPSource" to the "RTPSink":
-  if (fRTPSource->curPacketMarkerBit() && strcmp(fCodecName, "JPEG") == 0) ((SimpleRTPSink*)fRTPSink)->setMBitOnNextPacket();
+  if (fRTPSource->curPacketMarkerBit() && strcmp(fCodecName, "JPEG") == 0 && fRTPSink != NULL) {
+    ((SimpleRTPSink*)fRTPSink)->setMBitOnNextPacket();
+  }
 
   // Complete delivery:
   FramedSource::afterGetting(this);
@@ -111,6 +111,15 @@ void RTCPMemberDatabase::reapOldMembers(unsigned threshold) {
 
 ////////// RTCPInstance //////////
 
+static u_int32_t ntpTimestampMiddleNow() {
+  // Returns the middle 32 bits of the current NTP timestamp (i.e., the current time in units of 1/65536 seconds):
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  u_int32_t NTPmsw = timeNow.tv_sec + 0x83AA7E80; // 1970 epoch -> 1900 epoch
+  u_int32_t NTPlsw = (u_int32_t)((timeNow.tv_usec/15625.0)*0x04000000 + 0.5); // 2^32/10^6
+  return ((NTPmsw&0xFFFF)<<16)|(NTPlsw>>16);
+}
+
 static double dTimeNow() {
     struct timeval timeNow;
     gettimeofday(&timeNow, NULL);
@@ -128,9 +137,10 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
 			   Boolean isSSMSource)
   : Medium(env), fRTCPInterface(this, RTCPgs), fTotSessionBW(totSessionBW),
     fSink(sink), fSource(source), fIsSSMSource(isSSMSource),
+    fSendXRReports(False), fIncludeXRVoIPMetrics(False),
     fCNAME(RTCP_SDES_CNAME, cname), fOutgoingReportCount(1),
     fAveRTCPSize(0), fIsInitial(1), fPrevNumMembers(0),
-    fLastSentSize(0), fLastReceivedSize(0), fLastReceivedSSRC(0),
+    fLastSentSize(0), fLastReceivedSize(0), fLastReceivedSSRC(0), fLastRRSenderSSRC(0),
     fTypeOfEvent(EVENT_UNKNOWN), fTypeOfPacket(PACKET_UNKNOWN_TYPE),
     fHaveJustSentPacket(False), fLastPacketSentSize(0),
     fByeHandlerTask(NULL), fByeHandlerClientData(NULL),
@@ -159,6 +169,11 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
   fOutBuf = new OutPacketBuffer(preferredRTCPPacketSize, maxRTCPPacketSize, maxRTCPPacketSize);
   if (fOutBuf == NULL) return;
 
+  if (fSource != NULL) {
+    // Let our source know about us, so that it can send RTCP feedback (e.g., "NACK"s) about its packets:
+    fSource->registerRTCPInstance(this);
+  }
+
   if (fSource != NULL && fSource->RTPgs() == RTCPgs) {
     // We're receiving RTCP reports that are multiplexed with RTP, so ask the RTP source
     // to give them to us:
@@ -178,6 +193,8 @@ RTCPInstance::RTCPInstance(UsageEnvironment& env, Groupsock* RTCPgs,
 struct RRHandlerRecord {
   TaskFunc* rrHandlerTask;
   void* rrHandlerClientData;
+  Boolean haveReceiverSSRC;
+  u_int32_t receiverSSRC; // the sender SSRC of the most recent "RR" from this source address and port
 };
 
 RTCPInstance::~RTCPInstance() {
@@ -189,6 +206,8 @@ RTCPInstance::~RTCPInstance() {
   fTypeOfEvent = EVENT_BYE; // not used, but...
   sendBYE();
 
+  if (fSource != NULL) fSource->registerRTCPInstance(NULL);
+
   if (fSource != NULL && fSource->RTPgs() == fRTCPInterface.gs()) {
     // We were receiving RTCP reports that were multiplexed with RTP, so tell the RTP source
     // to stop giving them to us:
@@ -233,6 +252,8 @@ void RTCPInstance::noteArrivingRR(struct sockaddr_in const& fromAddressAndPort,
     RRHandlerRecord* rrHandler
       = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddr, (~0), fromPort));
     if (rrHandler != NULL) {
+      rrHandler->haveReceiverSSRC = True;
+      rrHandler->receiverSSRC = fLastRRSenderSSRC;
       if (rrHandler->rrHandlerTask != NULL) {
 	(*(rrHandler->rrHandlerTask))(rrHandler->rrHandlerClientData);
       }
@@ -307,11 +328,18 @@ void RTCPInstance
   RRHandlerRecord* rrHandler = new RRHandlerRecord;
   rrHandler->rrHandlerTask = handlerTask;
   rrHandler->rrHandlerClientData = clientData;
+  rrHandler->haveReceiverSSRC = False;
+  rrHandler->receiverSSRC = 0;
   if (fSpecificRRHandlerTable == NULL) {
     fSpecificRRHandlerTable = new AddressPortLookupTable;
   }
   RRHandlerRecord* existingRecord = (RRHandlerRecord*)fSpecificRRHandlerTable->Add(fromAddress, (~0), fromPort, rrHandler);
-  delete existingRecord; // if any
+  if (existingRecord != NULL) {
+    // Keep the SSRC that this source has already reported from:
+    rrHandler->haveReceiverSSRC = existingRecord->haveReceiverSSRC;
+    rrHandler->receiverSSRC = existingRecord->receiverSSRC;
+    delete existingRecord;
+  }
 
 }
 
@@ -327,6 +355,18 @@ void RTCPInstance
   }
 }
 
+Boolean RTCPInstance
+::lookupReceiverSSRC(netAddressBits fromAddress, Port fromPort, u_int32_t& ssrc) const {
+  if (fSpecificRRHandlerTable == NULL) return False;
+
+  RRHandlerRecord* rrHandler
+    = (RRHandlerRecord*)(fSpecificRRHandlerTable->Lookup(fromAddress, (~0), fromPort));
+  if (rrHandler == NULL || !rrHandler->haveReceiverSSRC) return False;
+
+  ssrc = rrHandler->receiverSSRC;
+  return True;
+}
+
 void RTCPInstance::setAppHandler(RTCPAppHandlerFunc* handlerTask, void* clientData) {
   fAppHandlerTask = handlerTask;
   fAppHandlerClientData = clientData;
@@ -367,6 +407,22 @@ void RTCPInstance::sendAppPacket(u_int8_t subtype, char const* name,
   sendBuiltPacket();
 }
 
+void RTCPInstance::sendNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums) {
+  if (numSeqNums == 0) return;
+
+  // The packet must begin with a SR and/or RR report (and a SDES):
+  (void)addReport(True);
+  addSDES();
+
+  addNACK(mediaSSRC, seqNums, numSeqNums);
+  sendBuiltPacket();
+}
+
+void RTCPInstance::enableXRReports(Boolean includeVoIPMetrics) {
+  fSendXRReports = True;
+  fIncludeXRVoIPMetrics = includeVoIPMetrics;
+}
+
 void RTCPInstance::setStreamSocket(int sockNum,
 				   unsigned char streamChannelId) {
   // Turn off background read handling:
@@ -490,6 +546,7 @@ void RTCPInstance
 			int tcpSocketNum, unsigned char tcpStreamChannelId) {
   do {
     Boolean callByeHandler = False;
+    Boolean sawRR = False;
     unsigned char* pkt = fInBuf;
 
 #ifdef DEBUG
@@ -512,11 +569,13 @@ void RTCPInstance
     // Check the RTCP packet for validity:
     // It must at least contain a header (4 bytes), and this header
     // must be version=2, with no padding bit, and a payload type of
-    // SR (200), RR (201), or APP (204):
+    // SR (200), RR (201), APP (204), or - for 'reduced-size' feedback packets (RFC 5506) - RTPFB (205) or PSFB (206):
     if (packetSize < 4) break;
     unsigned rtcpHdr = ntohl(*(u_int32_t*)pkt);
     if ((rtcpHdr & 0xE0FE0000) != (0x80000000 | (RTCP_PT_SR<<16)) &&
-	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_APP<<16))) {
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_APP<<16)) &&
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_RTPFB<<16)) &&
+	(rtcpHdr & 0xE0FF0000) != (0x80000000 | (RTCP_PT_PSFB<<16))) {
 #ifdef DEBUG
       fprintf(stderr, "rejected bad RTCP packet: header 0x%08x\n", rtcpHdr);
 #endif
@@ -539,9 +598,9 @@ void RTCPInstance
       if (length < 4) break; length -= 4;
       reportSenderSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4);
 #ifdef HACK_FOR_CHROME_WEBRTC_BUG
-      if (reportSenderSSRC == 0x00000001 && pt == RTCP_PT_RR) {
+      if (reportSenderSSRC == 0x00000001 && (pt == RTCP_PT_RR || pt == RTCP_PT_PSFB)) {
 	// Chrome (and Opera) WebRTC receivers have a bug that causes them to always send
-	// SSRC 1 in their "RR"s.  To work around this (to help us distinguish between different
+	// SSRC 1 in their "RR"s (and feedback packets).  To work around this (to help us distinguish between different
 	// receivers), we use a fake SSRC in this case consisting of the IP address, XORed with
 	// the port number:
 	reportSenderSSRC = fromAddressAndPort.sin_addr.s_addr^fromAddressAndPort.sin_port;
@@ -606,7 +665,10 @@ void RTCPInstance
           }
 
 	  if (pt == RTCP_PT_RR) { // i.e., we didn't fall through from 'SR'
-	    noteArrivingRR(fromAddressAndPort, tcpSocketNum, tcpStreamChannelId);
+	    // Note the arrival of this "RR" after we've processed the rest of the (compound) packet - so that any "RR" handler
+	    // also sees feedback (e.g., "REMB") that was sent along with it:
+	    sawRR = True;
+	    fLastRRSenderSSRC = reportSenderSSRC;
 	  }
 
 	  subPacketOK = True;
@@ -716,35 +778,131 @@ void RTCPInstance
 	  break;
 	}
         case RTCP_PT_RTPFB: {
+	  u_int8_t& fmt = rc; // In feedback packets, the "rc" field gets used as "FMT"
 #ifdef DEBUG
-	  fprintf(stderr, "RTPFB(unhandled)\n");
+	  fprintf(stderr, "RTPFB (FMT %d)\n", fmt);
 #endif
+	  if (length < 4) break;
+	  u_int32_t mediaSSRC = ntohl(*(u_int32_t*)pkt); ADVANCE(4); length -= 4;
+
+	  if (fmt == RTCP_RTPFB_FMT_NACK && fSink != NULL && mediaSSRC == fSink->SSRC()) {
+	    // Each 'FCI' entry is a 16-bit packet id "PID", followed by a 16-bit bitmask "BLP" of following lost packets:
+	    while (length >= 4) {
+	      u_int16_t pid = (pkt[0]<<8)|pkt[1];
+	      u_int16_t blp = (pkt[2]<<8)|pkt[3];
+	      ADVANCE(4); length -= 4;
+
+	      fSink->retransmitPacket(pid);
+	      for (unsigned i = 0; i < 16; ++i) {
+		if ((blp&(1<<i)) != 0) fSink->retransmitPacket(pid+i+1);
+	      }
+	    }
+	  }
 	  subPacketOK = True;
 	  break;
 	}
         case RTCP_PT_PSFB: {
+	  u_int8_t& fmt = rc; // In feedback packets, the "rc" field gets used as "FMT"
 #ifdef DEBUG
-	  fprintf(stderr, "PSFB(unhandled)\n");
-	  // Temporary code to show "Receiver Estimated Maximum Bitrate" (REMB) feedback reports:
-	  //#####
-	  if (length >= 12 && pkt[4] == 'R' && pkt[5] == 'E' && pkt[6] == 'M' && pkt[7] == 'B') {
+	  fprintf(stderr, "PSFB (FMT %d)\n", fmt);
+#endif
+	  // Check for "Receiver Estimated Maximum Bitrate" (REMB) feedback reports
+	  // (after the 'media source' SSRC: "REMB", a SSRC count, then a 6-bit exponent and 18-bit mantissa):
+	  if (fmt == RTCP_PSFB_FMT_AFB && length >= 12
+	      && pkt[4] == 'R' && pkt[5] == 'E' && pkt[6] == 'M' && pkt[7] == 'B') {
 	    u_int8_t exp = pkt[9]>>2;
 	    u_int32_t mantissa = ((pkt[9]&0x03)<<16)|(pkt[10]<<8)|pkt[11];
 	    double remb = (double)mantissa;
 	    while (exp > 0) {
 	      remb *= 2.0;
-	      exp /= 2;
+	      --exp;
 	    }
+#ifdef DEBUG
 	    fprintf(stderr, "\tReceiver Estimated Max Bitrate (REMB): %g bps\n", remb);
-	  }
 #endif
+	    if (fSink != NULL) {
+	      fSink->transmissionStatsDB().noteIncomingREMB(reportSenderSSRC,
+							    remb < 4294967295.0 ? (unsigned)remb : 0xFFFFFFFF);
+	    }
+	  }
 	  subPacketOK = True;
 	  break;
 	}
         case RTCP_PT_XR: {
 #ifdef DEBUG
-	  fprintf(stderr, "XR(unhandled)\n");
+	  fprintf(stderr, "XR\n");
+#endif
+	  // Process each 'report block' (RFC 3611, section 3) that we know about:
+	  Boolean blocksOK = True;
+	  while (length >= 4) {
+	    u_int8_t bt = pkt[0];
+	    u_int8_t typeSpecific = pkt[1];
+	    unsigned blockLength = 4*((pkt[2]<<8)|pkt[3]); // doesn't count the block header
+	    ADVANCE(4); length -= 4;
+	    if (blockLength > length) { blocksOK = False; break; }
+	    u_int8_t* block = pkt;
+	    ADVANCE(blockLength); length -= blockLength;
+#ifdef DEBUG
+	    fprintf(stderr, "\tblock type %d, length %d\n", bt, blockLength);
 #endif
+
+	    if (bt == RTCP_XR_BT_RRTR && blockLength >= 8) {
+	      // A receiver's 'reference time'.  Note it, so we can reply with a "DLRR" block in our next report:
+	      if (fSink != NULL) {
+		u_int32_t NTPmsw = ntohl(*(u_int32_t*)block);
+		u_int32_t NTPlsw = ntohl(*(u_int32_t*)(block+4));
+		fSink->transmissionStatsDB().noteIncomingRRTR(reportSenderSSRC, ((NTPmsw&0xFFFF)<<16)|(NTPlsw>>16));
+	      }
+	    } else if (bt == RTCP_XR_BT_DLRR) {
+	      // A sender's reply to (one of) our "RRTR"s.  Use this to compute the round-trip delay (as for "RR"/"SR"):
+	      for (unsigned i = 0; i+12 <= blockLength; i += 12) {
+		u_int32_t ssrc = ntohl(*(u_int32_t*)(block+i));
+		u_int32_t LRR = ntohl(*(u_int32_t*)(block+i+4));
+		u_int32_t DLRR = ntohl(*(u_int32_t*)(block+i+8));
+		if (fSource != NULL && ssrc == fSource->SSRC() && LRR != 0) {
+		  u_int32_t roundTripDelay = ntpTimestampMiddleNow() - LRR - DLRR;
+		  if ((int)roundTripDelay > 0) {
+		    fSource->receptionStatsDB().noteIncomingDLRR(reportSenderSSRC, roundTripDelay);
+		  }
+		}
+	      }
+	    } else if (bt == RTCP_XR_BT_STATS && blockLength >= 36) {
+	      if (fSink != NULL && ntohl(*(u_int32_t*)block) == fSink->SSRC()) {
+		RTCPXRStatisticsSummary summary;
+		summary.flags = typeSpecific;
+		summary.beginSeq = (block[4]<<8)|block[5];
+		summary.endSeq = (block[6]<<8)|block[7];
+		summary.lostPackets = ntohl(*(u_int32_t*)(block+8));
+		summary.dupPackets = ntohl(*(u_int32_t*)(block+12));
+		summary.minJitter = ntohl(*(u_int32_t*)(block+16));
+		summary.maxJitter = ntohl(*(u_int32_t*)(block+20));
+		summary.meanJitter = ntohl(*(u_int32_t*)(block+24));
+		summary.devJitter = ntohl(*(u_int32_t*)(block+28));
+		summary.minTTLOrHL = block[32]; summary.maxTTLOrHL = block[33];
+		summary.meanTTLOrHL = block[34]; summary.devTTLOrHL = block[35];
+		fSink->transmissionStatsDB().noteIncomingXRStatisticsSummary(reportSenderSSRC, summary);
+	      }
+	    } else if (bt == RTCP_XR_BT_VOIP && blockLength >= 32) {
+	      if (fSink != NULL && ntohl(*(u_int32_t*)block) == fSink->SSRC()) {
+		RTCPXRVoIPMetrics metrics;
+		metrics.lossRate = block[4]; metrics.discardRate = block[5];
+		metrics.burstDensity = block[6]; metrics.gapDensity = block[7];
+		metrics.burstDuration = (block[8]<<8)|block[9]; metrics.gapDuration = (block[10]<<8)|block[11];
+		metrics.roundTripDelay = (block[12]<<8)|block[13]; metrics.endSystemDelay = (block[14]<<8)|block[15];
+		metrics.signalLevel = block[16]; metrics.noiseLevel = block[17];
+		metrics.RERL = block[18]; metrics.Gmin = block[19];
+		metrics.RFactor = block[20]; metrics.extRFactor = block[21];
+		metrics.MOS_LQ = block[22]; metrics.MOS_CQ = block[23];
+		metrics.RXConfig = block[24];
+		metrics.JBNominal = (block[26]<<8)|block[27];
+		metrics.JBMaximum = (block[28]<<8)|block[29]; metrics.JBAbsMax = (block[30]<<8)|block[31];
+		fSink->transmissionStatsDB().noteIncomingXRVoIPMetrics(reportSenderSSRC, metrics);
+	      }
+	    }
+	    // Other block types are ignored
+	  }
+	  if (!blocksOK) break;
+
 	  subPacketOK = True;
 	  break;
 	}
@@ -814,6 +972,8 @@ void RTCPInstance
       }
     }
 
+    if (sawRR) noteArrivingRR(fromAddressAndPort, tcpSocketNum, tcpStreamChannelId);
+
     if (!packetOK) {
 #ifdef DEBUG
       fprintf(stderr, "rejected bad RTCP subpacket: header 0x%08x\n", rtcpHdr);
@@ -865,6 +1025,9 @@ void RTCPInstance::sendReport() {
   // Then, include a SDES:
   addSDES();
 
+  // Then, include a RTCP-XR, if we have anything to put in one:
+  addXR();
+
   // Send the report:
   sendBuiltPacket();
 
@@ -1136,6 +1299,164 @@ void RTCPInstance::addBYE() {
   }
 }
 
+void RTCPInstance::addNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums) {
+  // Begin by figuring out how many 'FCI' entries we'll need.  Each entry covers a sequence number "PID",
+  // plus (using the bitmask "BLP") up to 16 sequence numbers that follow it:
+  unsigned const maxNumEntries = (fOutBuf->totalBytesAvailable() - 12)/4;
+  unsigned numEntries = 0;
+  unsigned i = 0;
+  while (i < numSeqNums && numEntries < maxNumEntries) {
+    u_int16_t const pid = seqNums[i++];
+    while (i < numSeqNums && (u_int16_t)(seqNums[i] - pid - 1) < 16) ++i;
+    ++numEntries;
+  }
+
+  unsigned rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= (RTCP_RTPFB_FMT_NACK<<24);
+  rtcpHdr |= (RTCP_PT_RTPFB<<16);
+  rtcpHdr |= 2 + numEntries; // the 2 SSRCs, plus the 'FCI' entries
+  fOutBuf->enqueueWord(rtcpHdr);
+
+  fOutBuf->enqueueWord(fSource != NULL ? fSource->SSRC() : fSink != NULL ? fSink->SSRC() : 0); // SSRC of packet sender
+  fOutBuf->enqueueWord(mediaSSRC);
+
+  i = 0;
+  for (unsigned entry = 0; entry < numEntries; ++entry) {
+    u_int16_t const pid = seqNums[i++];
+    u_int16_t blp = 0;
+    while (i < numSeqNums) {
+      u_int16_t const offset = seqNums[i] - pid - 1;
+      if (offset >= 16) break;
+      blp |= (1<<offset);
+      ++i;
+    }
+    fOutBuf->enqueueWord((pid<<16)|blp);
+  }
+}
+
+void RTCPInstance::addXR() {
+  // Leave room at the end of the packet for a "BYE" (2 words):
+  unsigned const maxPacketSize = fOutBuf->curPacketSize() + fOutBuf->totalBytesAvailable() - 8;
+  unsigned const xrHeaderPosition = fOutBuf->curPacketSize();
+  if (xrHeaderPosition + 8 + 16 > maxPacketSize) return; // not enough room
+
+  // Begin by checking whether we have anything to report:
+  Boolean haveSomethingToReport = fSource != NULL && fSendXRReports;
+  if (!haveSomethingToReport && fSink != NULL) {
+    RTPTransmissionStatsDB::Iterator iterator(fSink->transmissionStatsDB());
+    RTPTransmissionStats* stats;
+    u_int32_t lastRRTR, delaySinceLastRRTR;
+    while ((stats = iterator.next()) != NULL) {
+      if (stats->getDLRR(lastRRTR, delaySinceLastRRTR)) {
+	haveSomethingToReport = True;
+	break;
+      }
+    }
+  }
+  if (!haveSomethingToReport) return;
+
+  fOutBuf->skipBytes(8); // for the XR header and SSRC, which we fill in later
+
+  if (fSource != NULL && fSendXRReports) {
+    // Add a "Receiver Reference Time" block:
+    fOutBuf->enqueueWord((RTCP_XR_BT_RRTR<<24) | 2);
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    fOutBuf->enqueueWord(timeNow.tv_sec + 0x83AA7E80);
+    double fractionalPart = (timeNow.tv_usec/15625.0)*0x04000000; // 2^32/10^6
+    fOutBuf->enqueueWord((unsigned)(fractionalPart+0.5));
+
+    // Then, for each sender that we've received packets from since our last report, add a "Statistics Summary" block
+    // (and, if requested, a "VoIP Metrics" block):
+    unsigned const perSenderSize = 40 + (fIncludeXRVoIPMetrics ? 36 : 0);
+    RTPReceptionStatsDB::Iterator iterator(fSource->receptionStatsDB());
+    RTPReceptionStats* stats;
+    while ((stats = iterator.next(True)) != NULL
+	   && fOutBuf->curPacketSize() + perSenderSize <= maxPacketSize) {
+      if (stats->xrIntervalNumPacketsReceived() == 0) continue;
+
+      enqueueXRStatisticsSummary(stats);
+      if (fIncludeXRVoIPMetrics) enqueueXRVoIPMetrics(stats);
+      stats->resetXRInterval();
+    }
+  }
+
+  if (fSink != NULL) {
+    // If any receivers have sent us a "Receiver Reference Time" block, then reply with a "DLRR" block:
+    unsigned const dlrrHeaderPosition = fOutBuf->curPacketSize();
+    unsigned numSubBlocks = 0;
+    RTPTransmissionStatsDB::Iterator iterator(fSink->transmissionStatsDB());
+    RTPTransmissionStats* stats;
+    while ((stats = iterator.next()) != NULL
+	   && fOutBuf->curPacketSize() + (numSubBlocks == 0 ? 4 : 0) + 12 <= maxPacketSize) {
+      u_int32_t lastRRTR, delaySinceLastRRTR;
+      if (!stats->getDLRR(lastRRTR, delaySinceLastRRTR)) continue;
+
+      if (numSubBlocks++ == 0) fOutBuf->skipBytes(4); // for the block header, which we fill in later
+      fOutBuf->enqueueWord(stats->SSRC());
+      fOutBuf->enqueueWord(lastRRTR);
+      fOutBuf->enqueueWord(delaySinceLastRRTR);
+    }
+    if (numSubBlocks > 0) {
+      fOutBuf->insertWord((RTCP_XR_BT_DLRR<<24) | (3*numSubBlocks), dlrrHeaderPosition);
+    }
+  }
+
+  // Fill in the XR header:
+  unsigned rtcpHdr = 0x80000000; // version 2, no padding
+  rtcpHdr |= (RTCP_PT_XR<<16);
+  rtcpHdr |= (fOutBuf->curPacketSize() - xrHeaderPosition)/4 - 1;
+  fOutBuf->insertWord(rtcpHdr, xrHeaderPosition);
+  fOutBuf->insertWord(fSource != NULL ? fSource->SSRC() : fSink->SSRC(), xrHeaderPosition + 4);
+}
+
+void RTCPInstance::enqueueXRStatisticsSummary(RTPReceptionStats* stats) {
+  // We report the number of lost packets, and jitter, but not duplicate packets, or TTL (or Hop Limit) values:
+  u_int8_t const flags = 0x80/*L*/|0x20/*J*/;
+  fOutBuf->enqueueWord((RTCP_XR_BT_STATS<<24) | (flags<<16) | 9);
+  fOutBuf->enqueueWord(stats->SSRC());
+
+  unsigned beginSeq = stats->xrIntervalBeginExtSeqNum();
+  unsigned endSeq = stats->highestExtSeqNumReceived() + 1; // exclusive
+  unsigned numExpected = endSeq > beginSeq ? endSeq - beginSeq : 0;
+  unsigned numReceived = stats->xrIntervalNumPacketsReceived();
+  fOutBuf->enqueueWord(((beginSeq&0xFFFF)<<16) | (endSeq&0xFFFF));
+  fOutBuf->enqueueWord(numExpected > numReceived ? numExpected - numReceived : 0); // lost packets
+  fOutBuf->enqueueWord(0); // duplicate packets (not reported)
+
+  unsigned minJitter, maxJitter, meanJitter, devJitter;
+  stats->getXRIntervalJitter(minJitter, maxJitter, meanJitter, devJitter);
+  fOutBuf->enqueueWord(minJitter);
+  fOutBuf->enqueueWord(maxJitter);
+  fOutBuf->enqueueWord(meanJitter);
+  fOutBuf->enqueueWord(devJitter);
+  fOutBuf->enqueueWord(0); // TTL or Hop Limit values (not reported)
+}
+
+void RTCPInstance::enqueueXRVoIPMetrics(RTPReceptionStats* stats) {
+  // We can measure only the loss rate and the round-trip delay.  Other metrics are reported as 0 (for rates,
+  // densities, durations, and delays), or 127 (for signal levels, R factors, and MOS scores) - meaning 'unavailable':
+  fOutBuf->enqueueWord((RTCP_XR_BT_VOIP<<24) | 8);
+  fOutBuf->enqueueWord(stats->SSRC());
+
+  unsigned beginSeq = stats->xrIntervalBeginExtSeqNum();
+  unsigned endSeq = stats->highestExtSeqNumReceived() + 1;
+  unsigned numExpected = endSeq > beginSeq ? endSeq - beginSeq : 0;
+  unsigned numReceived = stats->xrIntervalNumPacketsReceived();
+  unsigned lossRate = numExpected > numReceived ? ((numExpected - numReceived)<<8)/numExpected : 0;
+  if (lossRate > 255) lossRate = 255;
+  fOutBuf->enqueueWord(lossRate<<24); // loss rate, discard rate, burst density, gap density
+  fOutBuf->enqueueWord(0); // burst duration, gap duration
+
+  unsigned roundTripDelayMS = (unsigned)((stats->xrRoundTripDelay()*1000.0)/65536 + 0.5);
+  if (roundTripDelayMS > 0xFFFF) roundTripDelayMS = 0xFFFF;
+  fOutBuf->enqueueWord(roundTripDelayMS<<16); // round trip delay, end system delay
+  fOutBuf->enqueueWord((127<<24)|(127<<16)|(127<<8)|16); // signal level, noise level, RERL, Gmin
+  fOutBuf->enqueueWord((127<<24)|(127<<16)|(127<<8)|127); // R factor, ext. R factor, MOS-LQ, MOS-CQ
+  fOutBuf->enqueueWord(0); // RX config, reserved, JB nominal
+  fOutBuf->enqueueWord(0); // JB maximum, JB abs max
+}
+
 void RTCPInstance::schedule(double nextTime) {
   fNextReportTime = nextTime;
 
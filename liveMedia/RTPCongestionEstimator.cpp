@@ -0,0 +1,135 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An estimate of the network congestion between a "RTPSink" and one of its receivers, computed from the
+// receiver's RTCP "RR" (and "REMB") reports.
+// Implementation
+
+#include "RTPCongestionEstimator.hh"
+
+// Thresholds used to compute the congestion level.  (Each is the value above which the level becomes
+// "CONGESTION_MILD", then "CONGESTION_SEVERE".)
+#define MILD_LOSS_FRACTION 0.02
+#define SEVERE_LOSS_FRACTION 0.10
+#define MILD_QUEUEING_DELAY 0.15 /* seconds of round-trip time above the minimum seen */
+#define SEVERE_QUEUEING_DELAY 0.50
+// The number of consecutive "RR"s that must indicate a lower level of congestion before we lower our level.
+// (This keeps the level from oscillating when a sender's reaction to congestion - e.g., dropping frames - itself
+// makes the congestion go away.)
+#define NUM_REPORTS_BEFORE_LOWERING_LEVEL 2
+
+RTPCongestionEstimator::RTPCongestionEstimator(RTPSink& rtpSink)
+  : fOurRTPSink(rtpSink), fNumReportsReceived(0),
+    fCongestionLevel(CONGESTION_NONE), fNumReportsAtLowerLevel(0),
+    fFractionLost(0.0), fSmoothedFractionLost(0.0), fRoundTripTime(0.0), fMinRoundTripTime(0.0), fJitter(0.0),
+    fSendRate(0), fReceiveRate(0), fREMBBitrate(0),
+    fLastTotalOctetCount(0), fLastTotalPacketCount(0) {
+  fLastRRTime.tv_sec = fLastRRTime.tv_usec = 0;
+}
+
+RTPCongestionEstimator::~RTPCongestionEstimator() {
+}
+
+void RTPCongestionEstimator::noteIncomingRR(u_int32_t receiverSSRC) {
+  RTPTransmissionStats* stats = fOurRTPSink.transmissionStatsDB().lookup(receiverSSRC);
+  if (stats == NULL) return; // the "RR" didn't report on our stream
+
+  ++fNumReportsReceived;
+
+  // Packet loss:
+  fFractionLost = stats->packetLossRatio()/256.0;
+  if (fNumReportsReceived == 1) {
+    fSmoothedFractionLost = fFractionLost;
+  } else {
+    fSmoothedFractionLost = (fSmoothedFractionLost + fFractionLost)/2;
+  }
+
+  // Delay:
+  unsigned rtd = stats->roundTripDelay();
+  if (rtd != 0) {
+    fRoundTripTime = rtd/65536.0;
+    if (fMinRoundTripTime == 0.0 || fRoundTripTime < fMinRoundTripTime) fMinRoundTripTime = fRoundTripTime;
+  }
+  unsigned timestampFrequency = fOurRTPSink.rtpTimestampFrequency();
+  fJitter = timestampFrequency == 0 ? 0.0 : stats->jitter()/(double)timestampFrequency;
+
+  fREMBBitrate = stats->rembBitrate();
+
+  // Send and receive rates (since the previous "RR"):
+  u_int32_t hi, totalOctetCount, totalPacketCount;
+  stats->getTotalOctetCount(hi, totalOctetCount);
+  stats->getTotalPacketCount(hi, totalPacketCount);
+  struct timeval const& timeReceived = stats->lastTimeReceived();
+  if (fNumReportsReceived > 1) {
+    double interval = (timeReceived.tv_sec - fLastRRTime.tv_sec) + (timeReceived.tv_usec - fLastRRTime.tv_usec)/1000000.0;
+    if (interval > 0.0) {
+      u_int32_t numOctetsSent = totalOctetCount - fLastTotalOctetCount;
+      u_int32_t numPacketsSent = totalPacketCount - fLastTotalPacketCount;
+      fSendRate = (unsigned)((8.0*numOctetsSent)/interval);
+
+      int numPacketsReceived = (int)stats->packetsReceivedSinceLastRR() - stats->packetsLostBetweenRR();
+      if (numPacketsReceived < 0) numPacketsReceived = 0;
+      double avgPacketSize = numPacketsSent == 0 ? 0.0 : numOctetsSent/(double)numPacketsSent;
+      fReceiveRate = (unsigned)((8.0*numPacketsReceived*avgPacketSize)/interval);
+    }
+  }
+  fLastTotalOctetCount = totalOctetCount;
+  fLastTotalPacketCount = totalPacketCount;
+  fLastRRTime = timeReceived;
+
+  // Update the congestion level - raising it immediately, but lowering it only after several reports:
+  unsigned newLevel = levelFromCurrentStats();
+  if (newLevel >= fCongestionLevel) {
+    fCongestionLevel = newLevel;
+    fNumReportsAtLowerLevel = 0;
+  } else if (++fNumReportsAtLowerLevel >= NUM_REPORTS_BEFORE_LOWERING_LEVEL) {
+    fCongestionLevel = newLevel;
+    fNumReportsAtLowerLevel = 0;
+  }
+}
+
+unsigned RTPCongestionEstimator::availableBitrate() const {
+  unsigned result = fREMBBitrate; // if any
+
+  // If the receiver is losing packets, then it's not getting much more than what it reports having received:
+  if (fSmoothedFractionLost >= MILD_LOSS_FRACTION && fReceiveRate > 0
+      && (result == 0 || fReceiveRate < result)) {
+    result = fReceiveRate;
+  }
+
+  return result;
+}
+
+unsigned RTPCongestionEstimator::levelFromCurrentStats() const {
+  unsigned level = CONGESTION_NONE;
+
+  if (fSmoothedFractionLost >= SEVERE_LOSS_FRACTION) return CONGESTION_SEVERE;
+  if (fSmoothedFractionLost >= MILD_LOSS_FRACTION) level = CONGESTION_MILD;
+
+  if (fMinRoundTripTime > 0.0) {
+    double queueingDelay = fRoundTripTime - fMinRoundTripTime;
+    if (queueingDelay >= SEVERE_QUEUEING_DELAY) return CONGESTION_SEVERE;
+    if (queueingDelay >= MILD_QUEUEING_DELAY) level = CONGESTION_MILD;
+  }
+
+  if (fREMBBitrate > 0 && fSendRate > 0) {
+    if (fREMBBitrate < fSendRate/2) return CONGESTION_SEVERE;
+    if (fREMBBitrate < fSendRate) level = CONGESTION_MILD;
+  }
+
+  return level;
+}
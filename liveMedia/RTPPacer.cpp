@@ -0,0 +1,92 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Token buckets used to pace outgoing RTP packets - both for an individual "RTPSink", and (optionally) for all
+// (paced) "RTPSink"s that share the same event loop.
+// Implementation
+
+#include "RTPPacer.hh"
+#include "Media.hh"
+
+////////// PacingTokenBucket implementation //////////
+
+PacingTokenBucket::PacingTokenBucket()
+  : fBitrate(0), fBucketSize(0.0), fNumTokens(0.0) {
+  fLastUpdateTime.tv_sec = fLastUpdateTime.tv_usec = 0;
+}
+
+void PacingTokenBucket::setRate(unsigned bitrate, unsigned bucketSize) {
+  if (fBitrate == 0) {
+    // We're starting (or restarting) pacing, so begin with a full bucket:
+    fNumTokens = bucketSize;
+    fLastUpdateTime.tv_sec = fLastUpdateTime.tv_usec = 0;
+  }
+  fBitrate = bitrate;
+  fBucketSize = bucketSize;
+  if (fNumTokens > fBucketSize) fNumTokens = fBucketSize;
+}
+
+unsigned PacingTokenBucket::consume(unsigned numBytes, struct timeval const& timeNow) {
+  if (fBitrate == 0) return 0; // no limit
+
+  double const bytesPerSecond = fBitrate/8.0;
+  if (fLastUpdateTime.tv_sec != 0 || fLastUpdateTime.tv_usec != 0) {
+    double elapsed = (timeNow.tv_sec - fLastUpdateTime.tv_sec) + (timeNow.tv_usec - fLastUpdateTime.tv_usec)/1000000.0;
+    if (elapsed > 0.0) {
+      fNumTokens += elapsed*bytesPerSecond;
+      if (fNumTokens > fBucketSize) fNumTokens = fBucketSize;
+    }
+  }
+  fLastUpdateTime = timeNow;
+
+  fNumTokens -= numBytes;
+  if (fNumTokens >= 0.0) return 0;
+
+  return (unsigned)((-fNumTokens*1000000.0)/bytesPerSecond);
+}
+
+
+////////// RTPPacer implementation //////////
+
+void RTPPacer::setAggregateBitrate(UsageEnvironment& env, unsigned bitrate, unsigned maxBurstSize) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  RTPPacer* pacer = (RTPPacer*)(ourTables->rtpPacer);
+
+  if (bitrate == 0) {
+    // Remove any existing pacer:
+    delete pacer;
+    ourTables->rtpPacer = NULL;
+    ourTables->reclaimIfPossible();
+    return;
+  }
+
+  if (pacer == NULL) ourTables->rtpPacer = pacer = new RTPPacer;
+  if (maxBurstSize == 0) maxBurstSize = bitrate/8/200; // 5 ms worth of data
+  if (maxBurstSize < 1500) maxBurstSize = 1500; // at least one (typical) packet
+  pacer->fBucket.setRate(bitrate, maxBurstSize);
+}
+
+RTPPacer* RTPPacer::ourPacer(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  return ourTables == NULL ? NULL : (RTPPacer*)(ourTables->rtpPacer);
+}
+
+RTPPacer::RTPPacer() {
+}
+
+RTPPacer::~RTPPacer() {
+}
@@ -51,6 +51,10 @@ RTPSink::RTPSink(UsageEnvironment& env,
   : MediaSink(env), fRTPInterface(this, rtpGS),
     fRTPPayloadType(rtpPayloadType),
     fPacketCount(0), fOctetCount(0), fTotalOctetCount(0),
+    fRetransmissionsEnabled(False), fRTXPayloadType(0),
+    fNumPacketsRetransmitted(0), fNumUnsatisfiedRetransmissionRequests(0),
+    fFECPayloadType(0), fNumFECPacketsSent(0), fPacingEnabled(False),
+    fTotNumPacketsSent(0), fTotNumBytesSent(0), fMostRecentSendSecond(0),
     fTimestampFrequency(rtpTimestampFrequency), fNextTimestampHasBeenPreset(False), fEnableRTCPReports(True),
     fNumChannels(numChannels), fEstimatedBitrate(0) {
   fRTPPayloadFormatName
@@ -58,6 +62,7 @@ RTPSink::RTPSink(UsageEnvironment& env,
   gettimeofday(&fCreationTime, NULL);
   fTotalOctetCountStartTime = fCreationTime;
   resetPresentationTimes();
+  for (unsigned i = 0; i < QOS_BITRATE_HISTORY_SECONDS; ++i) fBytesSentPerSecond[i] = 0;
 
   fSeqNo = (u_int16_t)our_random();
   fSSRC = our_random32();
@@ -123,6 +128,62 @@ void RTPSink::getTotalBitrate(unsigned& outNumBytes, double& outElapsedTime) {
   fTotalOctetCountStartTime = timeNow;
 }
 
+void RTPSink::getQoSSnapshot(RTPQoSSnapshot& snapshot, RTPTransmissionStats const* receiverStats) const {
+  snapshot.clientSessionId = 0; snapshot.trackId = NULL;
+  gettimeofday(&snapshot.timeTaken, NULL);
+
+  snapshot.numPacketsSent = fTotNumPacketsSent;
+  snapshot.numBytesSent = fTotNumBytesSent;
+
+  // Compute bitrates over the most recent complete seconds.  (Seconds after the most recent one in which we sent
+  // anything are counted as zero; seconds before the start of our history are not counted.)
+  time_t const timeNowSecs = snapshot.timeTaken.tv_sec;
+  unsigned numBytes = 0;
+  for (unsigned i = 1; i <= QOS_BITRATE_HISTORY_SECONDS; ++i) {
+    time_t const second = timeNowSecs - i;
+    if (second <= fMostRecentSendSecond && fMostRecentSendSecond - second < QOS_BITRATE_HISTORY_SECONDS) {
+      numBytes += fBytesSentPerSecond[second%QOS_BITRATE_HISTORY_SECONDS];
+    }
+    if (i == 1) snapshot.bitrate1s = 8*numBytes;
+    else if (i == 10) snapshot.bitrate10s = (8*numBytes)/10;
+  }
+  snapshot.bitrate60s = (8*numBytes)/QOS_BITRATE_HISTORY_SECONDS;
+
+  if (receiverStats == NULL || receiverStats->numRRsReceived() == 0) {
+    snapshot.receiverSSRC = 0;
+    snapshot.numReportsReceived = snapshot.totNumPacketsLost = 0;
+    snapshot.lossFraction = snapshot.jitter = snapshot.roundTripTime = 0.0;
+    snapshot.avgLossFraction = snapshot.avgJitter = snapshot.avgRoundTripTime = 0.0;
+    return;
+  }
+
+  snapshot.receiverSSRC = receiverStats->SSRC();
+  snapshot.numReportsReceived = receiverStats->numRRsReceived();
+  unsigned totNumPacketsLost = receiverStats->totNumPacketsLost();
+  snapshot.totNumPacketsLost = (totNumPacketsLost&0x800000) != 0 ? 0 : totNumPacketsLost;
+      // (The reported count is a signed 24-bit number, which is negative if the receiver saw duplicate packets.)
+  snapshot.lossFraction = receiverStats->packetLossRatio()/256.0;
+  snapshot.jitter = fTimestampFrequency == 0 ? 0.0 : receiverStats->jitter()/(double)fTimestampFrequency;
+  snapshot.roundTripTime = receiverStats->roundTripDelay()/65536.0;
+  snapshot.avgLossFraction = receiverStats->avgLossFraction();
+  snapshot.avgJitter = receiverStats->avgJitter();
+  snapshot.avgRoundTripTime = receiverStats->avgRoundTripTime();
+}
+
+void RTPSink::noteOutgoingPacket(unsigned packetSize, time_t timeNowSecs) {
+  ++fTotNumPacketsSent;
+  fTotNumBytesSent += packetSize;
+
+  if (timeNowSecs != fMostRecentSendSecond) {
+    // Clear the counts for the seconds since the last time we were called:
+    time_t second = timeNowSecs - fMostRecentSendSecond > QOS_BITRATE_HISTORY_SECONDS || timeNowSecs < fMostRecentSendSecond
+      ? timeNowSecs - QOS_BITRATE_HISTORY_SECONDS : fMostRecentSendSecond;
+    while (second < timeNowSecs) fBytesSentPerSecond[(++second)%QOS_BITRATE_HISTORY_SECONDS] = 0;
+    fMostRecentSendSecond = timeNowSecs;
+  }
+  fBytesSentPerSecond[timeNowSecs%QOS_BITRATE_HISTORY_SECONDS] += packetSize;
+}
+
 void RTPSink::resetPresentationTimes() {
   fInitialPresentationTime.tv_sec = fMostRecentPresentationTime.tv_sec = 0;
   fInitialPresentationTime.tv_usec = fMostRecentPresentationTime.tv_usec = 0;
@@ -163,6 +224,59 @@ char const* RTPSink::auxSDPLine() {
   return NULL; // by default
 }
 
+char const* RTPSink::sdpTransportProtocol() const {
+  // Our "a=rtcp-fb:" line (for NACKs) is valid only with the RFC 4585 'AVPF' profile:
+  return fRetransmissionsEnabled ? "RTP/AVPF" : "RTP/AVP";
+}
+
+char* RTPSink::lossRecoveryPayloadFormats() const {
+  char* result = new char[2*4 + 1];
+  char* p = result;
+  if (fRetransmissionsEnabled && fRTXPayloadType != 0) p += sprintf(p, " %d", fRTXPayloadType);
+  if (fFECPayloadType != 0) p += sprintf(p, " %d", fFECPayloadType);
+  *p = '\0';
+
+  return result;
+}
+
+char* RTPSink::lossRecoverySDPLines() const {
+  char const* const nackFmt = "a=rtcp-fb:%d nack\r\n";
+  char const* const rtxFmt = "a=rtpmap:%d rtx/%u\r\na=fmtp:%d apt=%d\r\n";
+  char const* const fecFmt = "a=rtpmap:%d ulpfec/%u\r\n";
+  char* result = new char[strlen(nackFmt) + strlen(rtxFmt) + strlen(fecFmt) + 7*3 /* max char len */ + 2*20 /* max int len */];
+  char* p = result;
+  if (fRetransmissionsEnabled) {
+    p += sprintf(p, nackFmt, rtpPayloadType());
+    if (fRTXPayloadType != 0) {
+      p += sprintf(p, rtxFmt, fRTXPayloadType, rtpTimestampFrequency(), fRTXPayloadType, rtpPayloadType());
+    }
+  }
+  if (fFECPayloadType != 0) p += sprintf(p, fecFmt, fFECPayloadType, rtpTimestampFrequency());
+  *p = '\0';
+
+  return result;
+}
+
+Boolean RTPSink::enableRetransmissions(unsigned /*historySize*/, unsigned char /*rtxPayloadType*/) {
+  return False; // by default
+}
+
+Boolean RTPSink::enableFEC(unsigned /*rowSize*/, unsigned /*numRows*/, unsigned char /*fecPayloadType*/) {
+  return False; // by default
+}
+
+Boolean RTPSink::enablePacing(unsigned /*maxBitrate*/, unsigned /*maxBurstSize*/, Boolean /*useKernelPacing*/) {
+  return False; // by default
+}
+
+Boolean RTPSink::setFrameDropLevel(unsigned /*level*/) {
+  return False; // by default
+}
+
+void RTPSink::retransmitPacket(u_int16_t /*seqNum*/) {
+  ++fNumUnsatisfiedRetransmissionRequests; // by default, we can't retransmit anything
+}
+
 
 ////////// RTPTransmissionStatsDB //////////
 
@@ -204,6 +318,34 @@ void RTPTransmissionStatsDB
                         lastSRTime, diffSR_RRTime);
 }
 
+void RTPTransmissionStatsDB::noteIncomingREMB(u_int32_t SSRC, unsigned bitrate) {
+  // Note: We record "REMB"s only from receivers that we already know about (from their "RR"s):
+  RTPTransmissionStats* stats = lookup(SSRC);
+  if (stats != NULL) stats->noteIncomingREMB(bitrate);
+}
+
+void RTPTransmissionStatsDB::noteIncomingRRTR(u_int32_t SSRC, u_int32_t ntpTimestampMiddle) {
+  RTPTransmissionStats* stats = lookup(SSRC);
+  if (stats != NULL) stats->noteIncomingRRTR(ntpTimestampMiddle);
+}
+
+void RTPTransmissionStatsDB
+::noteIncomingXRStatisticsSummary(u_int32_t SSRC, RTCPXRStatisticsSummary const& summary) {
+  RTPTransmissionStats* stats = lookup(SSRC);
+  if (stats != NULL) {
+    stats->fXRStatisticsSummary = summary;
+    stats->fHaveXRStatisticsSummary = True;
+  }
+}
+
+void RTPTransmissionStatsDB::noteIncomingXRVoIPMetrics(u_int32_t SSRC, RTCPXRVoIPMetrics const& metrics) {
+  RTPTransmissionStats* stats = lookup(SSRC);
+  if (stats != NULL) {
+    stats->fXRVoIPMetrics = metrics;
+    stats->fHaveXRVoIPMetrics = True;
+  }
+}
+
 void RTPTransmissionStatsDB::removeRecord(u_int32_t SSRC) {
   RTPTransmissionStats* stats = lookup(SSRC);
   if (stats != NULL) {
@@ -249,7 +391,9 @@ RTPTransmissionStats::RTPTransmissionStats(RTPSink& rtpSink, u_int32_t SSRC)
     fPacketLossRatio(0), fTotNumPacketsLost(0), fJitter(0),
     fLastSRTime(0), fDiffSR_RRTime(0), fAtLeastTwoRRsHaveBeenReceived(False), fFirstPacket(True),
     fTotalOctetCount_hi(0), fTotalOctetCount_lo(0),
-    fTotalPacketCount_hi(0), fTotalPacketCount_lo(0) {
+    fTotalPacketCount_hi(0), fTotalPacketCount_lo(0),
+    fNumRRsReceived(0), fAvgLossFraction(0.0), fAvgJitter(0.0), fAvgRoundTripTime(0.0), fREMBBitrate(0),
+    fHaveXRStatisticsSummary(False), fHaveXRVoIPMetrics(False), fHaveRRTR(False), fLastRRTR(0) {
   gettimeofday(&fTimeCreated, NULL);
 
   fLastOctetCount = rtpSink.octetCount();
@@ -306,6 +450,44 @@ void RTPTransmissionStats
   if (fTotalPacketCount_lo < prevTotalPacketCount_lo) { // wrap around
     ++fTotalPacketCount_hi;
   }
+
+  // Update our moving averages:
+  double lossFraction = fPacketLossRatio/256.0;
+  unsigned timestampFrequency = fOurRTPSink.rtpTimestampFrequency();
+  double jitterInSeconds = timestampFrequency == 0 ? 0.0 : fJitter/(double)timestampFrequency;
+  unsigned rtd = roundTripDelay();
+  if (fNumRRsReceived++ == 0) {
+    fAvgLossFraction = lossFraction;
+    fAvgJitter = jitterInSeconds;
+    fAvgRoundTripTime = rtd/65536.0;
+  } else {
+    fAvgLossFraction += (lossFraction - fAvgLossFraction)/8;
+    fAvgJitter += (jitterInSeconds - fAvgJitter)/8;
+    if (fAvgRoundTripTime == 0.0) fAvgRoundTripTime = rtd/65536.0;
+    else if (rtd != 0) fAvgRoundTripTime += (rtd/65536.0 - fAvgRoundTripTime)/8;
+  }
+}
+
+void RTPTransmissionStats::noteIncomingRRTR(u_int32_t ntpTimestampMiddle) {
+  fLastRRTR = ntpTimestampMiddle;
+  gettimeofday(&fTimeRRTRReceived, NULL);
+  fHaveRRTR = True;
+}
+
+Boolean RTPTransmissionStats::getDLRR(u_int32_t& lastRRTR, u_int32_t& delaySinceLastRRTR) const {
+  if (!fHaveRRTR) return False;
+
+  // The delay is in units of 1/65536 seconds (as in the "DLSR" field of our "SR"s):
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  int secsDiff = timeNow.tv_sec - fTimeRRTRReceived.tv_sec;
+  int usecsDiff = timeNow.tv_usec - fTimeRRTRReceived.tv_usec;
+  if (usecsDiff < 0) { usecsDiff += 1000000; --secsDiff; }
+  if (secsDiff < 0) secsDiff = usecsDiff = 0; // clock went backwards
+
+  lastRRTR = fLastRRTR;
+  delaySinceLastRRTR = (secsDiff<<16) | ((((usecsDiff<<11)+15625)/31250) & 0xFFFF);
+  return True;
 }
 
 unsigned RTPTransmissionStats::roundTripDelay() const {
@@ -20,6 +20,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "RTPSource.hh"
 #include "GroupsockHelper.hh"
+#include <math.h>
 
 ////////// RTPSource //////////
 
@@ -54,7 +55,11 @@ RTPSource::RTPSource(UsageEnvironment& env, Groupsock* RTPgs,
   : FramedSource(env),
     fRTPInterface(this, RTPgs),
     fCurPacketHasBeenSynchronizedUsingRTCP(False), fLastReceivedSSRC(0),
-    fRTCPInstanceForMultiplexedRTCPPackets(NULL),
+    fRTCPInstanceForMultiplexedRTCPPackets(NULL), fRTCPInstance(NULL),
+    fNACKsEnabled(False), fRTXPayloadFormat(0),
+    fNumPacketsNACKed(0), fNumPacketsRecovered(0), fNumPacketsNotRecovered(0),
+    fMinRecoveryTime(0), fMaxRecoveryTime(0), fTotRecoveryTime(0.0),
+    fFECPayloadFormat(0), fNumFECPacketsReceived(0), fNumPacketsRecoveredUsingFEC(0),
     fRTPPayloadFormat(rtpPayloadFormat), fTimestampFrequency(rtpTimestampFrequency),
     fSSRC(our_random32()), fEnableRTCPReports(True) {
   fReceptionStatsDB = new RTPReceptionStatsDB();
@@ -64,6 +69,14 @@ RTPSource::~RTPSource() {
   delete fReceptionStatsDB;
 }
 
+Boolean RTPSource::enableNACKs(unsigned char /*rtxPayloadType*/) {
+  return False; // by default
+}
+
+Boolean RTPSource::enableFEC(unsigned char /*fecPayloadType*/) {
+  return False; // by default
+}
+
 void RTPSource::getAttributes() const {
   envir().setResultMsg(""); // Fix later to get attributes from  header #####
 }
@@ -103,25 +116,25 @@ void RTPReceptionStatsDB
 		     Boolean useForJitterCalculation,
 		     struct timeval& resultPresentationTime,
 		     Boolean& resultHasBeenSyncedUsingRTCP,
-		     unsigned packetSize) {
-  ++fTotNumPacketsReceived;
+		     unsigned packetSize, Boolean wasRecovered) {
+  if (!wasRecovered) ++fTotNumPacketsReceived;
   RTPReceptionStats* stats = lookup(SSRC);
   if (stats == NULL) {
     // This is the first time we've heard from this SSRC.
     // Create a new record for it:
-    stats = new RTPReceptionStats(SSRC, seqNum);
+    stats = wasRecovered ? new RTPReceptionStats(SSRC) : new RTPReceptionStats(SSRC, seqNum);
     if (stats == NULL) return;
     add(SSRC, stats);
   }
 
-  if (stats->numPacketsReceivedSinceLastReset() == 0) {
+  if (!wasRecovered && stats->numPacketsReceivedSinceLastReset() == 0) {
     ++fNumActiveSourcesSinceLastReset;
   }
 
   stats->noteIncomingPacket(seqNum, rtpTimestamp, timestampFrequency,
 			    useForJitterCalculation,
 			    resultPresentationTime,
-			    resultHasBeenSyncedUsingRTCP, packetSize);
+			    resultHasBeenSyncedUsingRTCP, packetSize, wasRecovered);
 }
 
 void RTPReceptionStatsDB
@@ -140,6 +153,11 @@ void RTPReceptionStatsDB
   stats->noteIncomingSR(ntpTimestampMSW, ntpTimestampLSW, rtpTimestamp);
 }
 
+void RTPReceptionStatsDB::noteIncomingDLRR(u_int32_t SSRC, unsigned roundTripDelay) {
+  RTPReceptionStats* stats = lookup(SSRC);
+  if (stats != NULL) stats->fXRRoundTripDelay = roundTripDelay;
+}
+
 void RTPReceptionStatsDB::removeRecord(u_int32_t SSRC) {
   RTPReceptionStats* stats = lookup(SSRC);
   if (stats != NULL) {
@@ -200,6 +218,7 @@ RTPReceptionStats::~RTPReceptionStats() {
 void RTPReceptionStats::init(u_int32_t SSRC) {
   fSSRC = SSRC;
   fTotNumPacketsReceived = 0;
+  fTotNumPacketsRecovered = 0;
   fTotBytesReceived_hi = fTotBytesReceived_lo = 0;
   fBaseExtSeqNumReceived = 0;
   fHighestExtSeqNumReceived = 0;
@@ -215,12 +234,17 @@ void RTPReceptionStats::init(u_int32_t SSRC) {
   fTotalInterPacketGaps.tv_sec = fTotalInterPacketGaps.tv_usec = 0;
   fHasBeenSynchronized = False;
   fSyncTime.tv_sec = fSyncTime.tv_usec = 0;
+  fXRRoundTripDelay = 0;
   reset();
+  resetXRInterval();
 }
 
 void RTPReceptionStats::initSeqNum(u_int16_t initialSeqNum) {
     fBaseExtSeqNumReceived = 0x10000 | initialSeqNum;
     fHighestExtSeqNumReceived = 0x10000 | initialSeqNum;
+    fLastResetExtSeqNumReceived = fHighestExtSeqNumReceived;
+        // so that our first "RR" doesn't report the packets before "initialSeqNum" as lost
+    fXRIntervalBeginExtSeqNum = fHighestExtSeqNumReceived;
     fHaveSeenInitialSequenceNumber = True;
 }
 
@@ -234,10 +258,23 @@ void RTPReceptionStats
 		     Boolean useForJitterCalculation,
 		     struct timeval& resultPresentationTime,
 		     Boolean& resultHasBeenSyncedUsingRTCP,
-		     unsigned packetSize) {
+		     unsigned packetSize, Boolean wasRecovered) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+
+  if (wasRecovered) {
+    // We didn't actually receive this packet, so it doesn't affect our other statistics.  But it still needs a
+    // presentation time:
+    ++fTotNumPacketsRecovered;
+    computePresentationTime(rtpTimestamp, timestampFrequency, timeNow,
+			    resultPresentationTime, resultHasBeenSyncedUsingRTCP);
+    return;
+  }
+
   if (!fHaveSeenInitialSequenceNumber) initSeqNum(seqNum);
 
   ++fNumPacketsReceivedSinceLastReset;
+  ++fXRIntervalNumPacketsReceived;
   ++fTotNumPacketsReceived;
   u_int32_t prevTotBytesReceived_lo = fTotBytesReceived_lo;
   fTotBytesReceived_lo += packetSize;
@@ -277,8 +314,6 @@ void RTPReceptionStats
   }
 
   // Record the inter-packet delay
-  struct timeval timeNow;
-  gettimeofday(&timeNow, NULL);
   if (fLastPacketReceptionTime.tv_sec != 0
       || fLastPacketReceptionTime.tv_usec != 0) {
     unsigned gap
@@ -316,8 +351,28 @@ void RTPReceptionStats
     fLastTransit = transit;
     if (d < 0) d = -d;
     fJitter += (1.0/16.0) * ((double)d - fJitter);
+
+    // Also record this 'relative transit time' for our next RTCP-XR "Statistics Summary":
+    if (fXRIntervalNumJitterSamples++ == 0) {
+      fXRIntervalMinJitter = fXRIntervalMaxJitter = d;
+    } else if ((unsigned)d < fXRIntervalMinJitter) {
+      fXRIntervalMinJitter = d;
+    } else if ((unsigned)d > fXRIntervalMaxJitter) {
+      fXRIntervalMaxJitter = d;
+    }
+    fXRIntervalJitterSum += d;
+    fXRIntervalJitterSumOfSquares += (double)d*d;
   }
 
+  computePresentationTime(rtpTimestamp, timestampFrequency, timeNow,
+			  resultPresentationTime, resultHasBeenSyncedUsingRTCP);
+
+  fPreviousPacketRTPTimestamp = rtpTimestamp;
+}
+
+void RTPReceptionStats
+::computePresentationTime(u_int32_t rtpTimestamp, unsigned timestampFrequency, struct timeval const& timeNow,
+			  struct timeval& resultPresentationTime, Boolean& resultHasBeenSyncedUsingRTCP) {
   // Return the 'presentation time' that corresponds to "rtpTimestamp":
   if (fSyncTime.tv_sec == 0 && fSyncTime.tv_usec == 0) {
     // This is the first timestamp that we've seen, so use the current
@@ -362,8 +417,6 @@ void RTPReceptionStats
   // Save these as the new synchronization timestamp & time:
   fSyncTimestamp = rtpTimestamp;
   fSyncTime = resultPresentationTime;
-
-  fPreviousPacketRTPTimestamp = rtpTimestamp;
 }
 
 void RTPReceptionStats::noteIncomingSR(u_int32_t ntpTimestampMSW,
@@ -396,6 +449,28 @@ void RTPReceptionStats::reset() {
   fLastResetExtSeqNumReceived = fHighestExtSeqNumReceived;
 }
 
+void RTPReceptionStats::getXRIntervalJitter(unsigned& minJitter, unsigned& maxJitter,
+					    unsigned& meanJitter, unsigned& devJitter) const {
+  if (fXRIntervalNumJitterSamples == 0) {
+    minJitter = maxJitter = meanJitter = devJitter = 0;
+    return;
+  }
+
+  minJitter = fXRIntervalMinJitter;
+  maxJitter = fXRIntervalMaxJitter;
+  double mean = fXRIntervalJitterSum/fXRIntervalNumJitterSamples;
+  double variance = fXRIntervalJitterSumOfSquares/fXRIntervalNumJitterSamples - mean*mean;
+  meanJitter = (unsigned)(mean + 0.5);
+  devJitter = variance <= 0.0 ? 0 : (unsigned)(sqrt(variance) + 0.5);
+}
+
+void RTPReceptionStats::resetXRInterval() {
+  fXRIntervalBeginExtSeqNum = fHighestExtSeqNumReceived + (fTotNumPacketsReceived > 0 ? 1 : 0);
+  fXRIntervalNumPacketsReceived = 0;
+  fXRIntervalNumJitterSamples = fXRIntervalMinJitter = fXRIntervalMaxJitter = 0;
+  fXRIntervalJitterSum = fXRIntervalJitterSumOfSquares = 0.0;
+}
+
 Boolean seqNumLT(u_int16_t s1, u_int16_t s2) {
   // a 'less-than' on 16-bit sequence numbers
   int diff = s2-s1;
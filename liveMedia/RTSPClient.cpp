@@ -96,6 +96,32 @@ unsigned RTSPClient::sendPlayCommand(MediaSubsession& subsession, responseHandle
   return sendRequest(new RequestRecord(++fCSeq, responseHandler, absStartTime, absEndTime, scale, NULL, &subsession));
 }
 
+unsigned RTSPClient::sendSetupAndPlayCommands(MediaSession& session,
+					      responseHandler* setupResponseHandler, responseHandler* playResponseHandler,
+					      Boolean streamUsingTCP, Boolean forceMulticastOnUnspecified,
+					      double start, double end, float scale,
+					      Authenticator* authenticator) {
+  if (fTunnelOverHTTPPortNum != 0) streamUsingTCP = True; // RTSP-over-HTTP tunneling uses TCP (by definition)
+  if (fCurrentAuthenticator < authenticator) fCurrentAuthenticator = *authenticator;
+
+  u_int32_t booleanFlags = 0;
+  if (streamUsingTCP) booleanFlags |= 0x1;
+  if (forceMulticastOnUnspecified) booleanFlags |= 0x4;
+
+  // Queue a "SETUP" for each initiated subsession, followed by the "PLAY".  (Their "CSeq"s get set when they're sent.)
+  // We mark each "SETUP" as being pipelined (0x8), so that we know to send the next waiting request when it's handled:
+  booleanFlags |= 0x8;
+  MediaSubsessionIterator iter(session);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    if (subsession->readSource() == NULL) continue; // this subsession wasn't initiated
+    fRequestsAwaitingSessionId.enqueue(new RequestRecord(0, "SETUP", setupResponseHandler, NULL, subsession, booleanFlags));
+  }
+  fRequestsAwaitingSessionId.enqueue(new RequestRecord(0, "PLAY", playResponseHandler, &session, NULL, 0, start, end, scale));
+
+  return sendRequestsAwaitingSessionId();
+}
+
 unsigned RTSPClient::sendPauseCommand(MediaSession& session, responseHandler* responseHandler, Authenticator* authenticator) {
   if (fCurrentAuthenticator < authenticator) fCurrentAuthenticator = *authenticator;
   return sendRequest(new RequestRecord(++fCSeq, "PAUSE", responseHandler, &session));
@@ -354,6 +380,252 @@ void RTSPClient::setUserAgentString(char const* userAgentName) {
 }
 
 unsigned RTSPClient::responseBufferSize = 20000; // default value; you can reassign this in your application if you need to
+Boolean RTSPClient::useSharedResponseBuffers = False; // default value; you can reassign this in your application if you need to
+
+// A pool of response buffers (each of size "RTSPClient::responseBufferSize"+1), shared by all of the "RTSPClient"s in
+// an environment that were created while "RTSPClient::useSharedResponseBuffers" was True.  A client holds a buffer only
+// while it's in the middle of receiving a response, so the pool needs to be no larger than the number of clients that
+// are doing this at the same time - which, in a single-threaded event loop, is usually very small.
+// If "RTSPClient::responseBufferSize" changes, then subsequently-allocated buffers have the new size, and buffers of the
+// old size are freed (rather than reused) as they're released.
+
+class ResponseBufferPool {
+public:
+  static ResponseBufferPool* ourPool(UsageEnvironment& env); // creates the pool if necessary
+
+  void addClient() { ++fNumClients; }
+  void removeClient(); // deletes the pool when the last client goes away
+
+  char* getBuffer(unsigned& bufferSize); // sets "bufferSize" to the size of the returned buffer (not counting its trailing '\0')
+  void releaseBuffer(char* buffer, unsigned bufferSize);
+
+private:
+  ResponseBufferPool(UsageEnvironment& env, unsigned bufferSize);
+  void deleteFreeBuffers();
+  virtual ~ResponseBufferPool();
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fBufferSize;
+  unsigned fNumClients;
+  char** fFreeBuffers;
+  unsigned fNumFreeBuffers, fMaxNumFreeBuffers;
+};
+
+ResponseBufferPool* ResponseBufferPool::ourPool(UsageEnvironment& env) {
+  _Tables* ourTables = _Tables::getOurTables(env);
+  if (ourTables->responseBufferPool == NULL) {
+    ourTables->responseBufferPool = new ResponseBufferPool(env, RTSPClient::responseBufferSize);
+  }
+  return (ResponseBufferPool*)(ourTables->responseBufferPool);
+}
+
+void ResponseBufferPool::removeClient() {
+  if (--fNumClients > 0) return;
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv);
+  ourTables->responseBufferPool = NULL;
+  ourTables->reclaimIfPossible();
+  delete this;
+}
+
+char* ResponseBufferPool::getBuffer(unsigned& bufferSize) {
+  if (RTSPClient::responseBufferSize != fBufferSize) {
+    // The application has changed the buffer size.  Our free buffers have the old size, so we can't use them:
+    deleteFreeBuffers();
+    fBufferSize = RTSPClient::responseBufferSize;
+  }
+
+  bufferSize = fBufferSize;
+  if (fNumFreeBuffers > 0) return fFreeBuffers[--fNumFreeBuffers];
+
+  return new char[fBufferSize+1];
+}
+
+void ResponseBufferPool::releaseBuffer(char* buffer, unsigned bufferSize) {
+  if (bufferSize != fBufferSize) {
+    // This buffer was allocated before the buffer size changed; don't reuse it:
+    delete[] buffer;
+    return;
+  }
+
+  if (fNumFreeBuffers == fMaxNumFreeBuffers) {
+    // Enlarge our array of free buffers:
+    unsigned newMaxNumFreeBuffers = fMaxNumFreeBuffers == 0 ? 4 : 2*fMaxNumFreeBuffers;
+    char** newFreeBuffers = new char*[newMaxNumFreeBuffers];
+    for (unsigned i = 0; i < fNumFreeBuffers; ++i) newFreeBuffers[i] = fFreeBuffers[i];
+    delete[] fFreeBuffers;
+    fFreeBuffers = newFreeBuffers;
+    fMaxNumFreeBuffers = newMaxNumFreeBuffers;
+  }
+  fFreeBuffers[fNumFreeBuffers++] = buffer;
+}
+
+ResponseBufferPool::ResponseBufferPool(UsageEnvironment& env, unsigned bufferSize)
+  : fEnv(env), fBufferSize(bufferSize), fNumClients(0),
+    fFreeBuffers(NULL), fNumFreeBuffers(0), fMaxNumFreeBuffers(0) {
+}
+
+ResponseBufferPool::~ResponseBufferPool() {
+  deleteFreeBuffers();
+  delete[] fFreeBuffers;
+}
+
+void ResponseBufferPool::deleteFreeBuffers() {
+  for (unsigned i = 0; i < fNumFreeBuffers; ++i) delete[] fFreeBuffers[i];
+  fNumFreeBuffers = 0;
+}
+
+// A TCP connection to a server that's shared by the "RTSPClient"s (in an environment) that have called
+// "allowConnectionSharing()", and that connect to the same server address and port.  Each client sends its own requests on
+// the connection, but only the first client on our list - our 'reader' - reads from it.  It passes on each response that's
+// not for one of its own requests to the client whose request it is.  (To tell these apart, each request on the connection
+// gets a distinct "CSeq", from our counter.)
+
+class RTSPClient::SharedConnection {
+public:
+  static SharedConnection* lookup(UsageEnvironment& env, netAddressBits serverAddress, portNumBits serverPortNum);
+  SharedConnection(UsageEnvironment& env, netAddressBits serverAddress, portNumBits serverPortNum,
+		   int socketNum, RTSPClient* firstClient);
+  virtual ~SharedConnection();
+
+  RTSPClient* reader() const { return fClients; }
+  void addClient(RTSPClient* client);
+  void removeClient(RTSPClient* client);
+  RTSPClient* clientAwaitingResponse(unsigned cseq) const; // returns NULL if none
+  unsigned watchClients(RTSPClient**& clients, LivenessToken**& tokens) const;
+      // returns the number of our clients, and sets "clients" and "tokens" to new arrays (which the caller must delete[]) of
+      // these clients, and a reference to each one's "LivenessToken" (which the caller must release)
+  void resumeRequestsAwaitingConnection(); // called when the connection to the server has completed
+
+  // Handlers for our socket.  Each calls the handler of our current reader (which changes if the reader leaves):
+  static void connectionHandler(void* instance, int mask);
+  static void incomingDataHandler(void* instance, int mask);
+  static void handleAlternativeRequestByte(void* instance, u_int8_t requestByte);
+
+public:
+  UsageEnvironment& fEnv;
+  char fKey[30]; // our key in the environment's table of shared connections
+  int fSocketNum;
+  Boolean fIsPending; // True until our connection to the server has completed
+  unsigned fCSeq;
+  unsigned char fTCPStreamIdCount; // used for (optional) RTP/TCP
+  RTSPClient* fClients; // linked by "fNextClientOnSharedConnection"
+};
+
+RTSPClient::SharedConnection* RTSPClient::SharedConnection
+::lookup(UsageEnvironment& env, netAddressBits serverAddress, portNumBits serverPortNum) {
+  _Tables* ourTables = _Tables::getOurTables(env, False);
+  if (ourTables == NULL || ourTables->sharedRTSPConnections == NULL) return NULL;
+
+  char key[30];
+  sprintf(key, "%08x:%u", serverAddress, serverPortNum);
+  return (SharedConnection*)(((HashTable*)(ourTables->sharedRTSPConnections))->Lookup(key));
+}
+
+RTSPClient::SharedConnection::SharedConnection(UsageEnvironment& env, netAddressBits serverAddress, portNumBits serverPortNum,
+					       int socketNum, RTSPClient* firstClient)
+  : fEnv(env), fSocketNum(socketNum), fIsPending(True), fCSeq(1), fTCPStreamIdCount(0), fClients(firstClient) {
+  firstClient->fNextClientOnSharedConnection = NULL;
+
+  sprintf(fKey, "%08x:%u", serverAddress, serverPortNum);
+  _Tables* ourTables = _Tables::getOurTables(fEnv);
+  if (ourTables->sharedRTSPConnections == NULL) ourTables->sharedRTSPConnections = HashTable::create(STRING_HASH_KEYS);
+  ((HashTable*)(ourTables->sharedRTSPConnections))->Add(fKey, this);
+}
+
+RTSPClient::SharedConnection::~SharedConnection() {
+  RTPInterface::clearServerRequestAlternativeByteHandler(fEnv, fSocketNum); // in case we were receiving RTP-over-TCP
+
+  _Tables* ourTables = _Tables::getOurTables(fEnv, False);
+  if (ourTables == NULL || ourTables->sharedRTSPConnections == NULL) return;
+  HashTable* connections = (HashTable*)(ourTables->sharedRTSPConnections);
+
+  connections->Remove(fKey);
+  if (connections->IsEmpty()) {
+    delete connections;
+    ourTables->sharedRTSPConnections = NULL;
+    ourTables->reclaimIfPossible();
+  }
+}
+
+void RTSPClient::SharedConnection::addClient(RTSPClient* client) {
+  // Add "client" to the end of our list, so that it doesn't become our reader:
+  RTSPClient** ptr = &fClients;
+  while (*ptr != NULL) ptr = &((*ptr)->fNextClientOnSharedConnection);
+  *ptr = client;
+  client->fNextClientOnSharedConnection = NULL;
+}
+
+void RTSPClient::SharedConnection::removeClient(RTSPClient* client) {
+  for (RTSPClient** ptr = &fClients; *ptr != NULL; ptr = &((*ptr)->fNextClientOnSharedConnection)) {
+    if (*ptr == client) {
+      *ptr = client->fNextClientOnSharedConnection;
+      break;
+    }
+  }
+  client->fNextClientOnSharedConnection = NULL;
+}
+
+RTSPClient* RTSPClient::SharedConnection::clientAwaitingResponse(unsigned cseq) const {
+  for (RTSPClient* client = fClients; client != NULL; client = client->fNextClientOnSharedConnection) {
+    if (client->fRequestsAwaitingResponse.findByCSeq(cseq) != NULL) return client;
+  }
+  return NULL;
+}
+
+unsigned RTSPClient::SharedConnection::watchClients(RTSPClient**& clients, LivenessToken**& tokens) const {
+  unsigned numClients = 0;
+  RTSPClient* client;
+  for (client = fClients; client != NULL; client = client->fNextClientOnSharedConnection) ++numClients;
+
+  clients = new RTSPClient*[numClients];
+  tokens = new LivenessToken*[numClients];
+  unsigned i = 0;
+  for (client = fClients; client != NULL; client = client->fNextClientOnSharedConnection) {
+    clients[i] = client;
+    tokens[i] = client->watchForDeletion();
+    ++i;
+  }
+  return numClients;
+}
+
+void RTSPClient::SharedConnection::resumeRequestsAwaitingConnection() {
+  fIsPending = False;
+
+  // Send each client's pending requests.  Because a request that fails might cause clients (or even us) to get deleted,
+  // we use the "LivenessToken"s of (a copy of) our client list, rather than our own state:
+  RTSPClient** clients;
+  LivenessToken** tokens;
+  unsigned numClients = watchClients(clients, tokens);
+  for (unsigned i = 0; i < numClients; ++i) {
+    if (tokens[i]->fClient != NULL) {
+      RequestQueue requestQueue(clients[i]->fRequestsAwaitingConnection);
+      RequestRecord* request;
+      while ((request = requestQueue.dequeue()) != NULL) {
+	if (tokens[i]->fClient != NULL) {
+	  clients[i]->sendRequest(request);
+	} else {
+	  delete request;
+	}
+      }
+    }
+    (void)stopWatchingForDeletion(tokens[i]);
+  }
+  delete[] tokens; delete[] clients;
+}
+
+void RTSPClient::SharedConnection::connectionHandler(void* instance, int /*mask*/) {
+  ((SharedConnection*)instance)->reader()->connectionHandler1();
+}
+
+void RTSPClient::SharedConnection::incomingDataHandler(void* instance, int /*mask*/) {
+  ((SharedConnection*)instance)->reader()->incomingDataHandler1();
+}
+
+void RTSPClient::SharedConnection::handleAlternativeRequestByte(void* instance, u_int8_t requestByte) {
+  ((SharedConnection*)instance)->reader()->handleAlternativeRequestByte1(requestByte);
+}
 
 RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
 		       int verbosityLevel, char const* applicationName,
@@ -364,10 +636,18 @@ RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
     fTunnelOverHTTPPortNum(tunnelOverHTTPPortNum),
     fUserAgentHeaderStr(NULL), fUserAgentHeaderStrLen(0),
     fInputSocketNum(-1), fOutputSocketNum(-1), fBaseURL(NULL), fTCPStreamIdCount(0),
-    fLastSessionId(NULL), fSessionTimeoutParameter(0), fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
+    fLastSessionId(NULL), fSessionTimeoutParameter(0),
+    fUsesSharedResponseBuffer(useSharedResponseBuffers), fResponseBuffer(NULL), fResponseBufferSize(responseBufferSize),
+    fLivenessToken(NULL), fAllowConnectionSharing(False), fSharedConnection(NULL), fNextClientOnSharedConnection(NULL),
+    fSessionCookieCounter(0), fHTTPTunnelingConnectionIsPending(False) {
   setBaseURL(rtspURL);
 
-  fResponseBuffer = new char[responseBufferSize+1];
+  if (fUsesSharedResponseBuffer) {
+    // We'll get a buffer from the pool only when we start receiving a response:
+    ResponseBufferPool::ourPool(envir())->addClient();
+  } else {
+    fResponseBuffer = new char[fResponseBufferSize+1];
+  }
   resetResponseBuffer();
 
   if (socketNumToServer >= 0) {
@@ -397,10 +677,18 @@ RTSPClient::RTSPClient(UsageEnvironment& env, char const* rtspURL,
 }
 
 RTSPClient::~RTSPClient() {
-  RTPInterface::clearServerRequestAlternativeByteHandler(envir(), fInputSocketNum); // in case we were receiving RTP-over-TCP
+  if (fLivenessToken != NULL) fLivenessToken->fClient = NULL; // tells its holders that we've been deleted
+  if (fSharedConnection == NULL) {
+    RTPInterface::clearServerRequestAlternativeByteHandler(envir(), fInputSocketNum); // in case we were receiving RTP-over-TCP
+  } // else the shared connection does this, if necessary, when its last client leaves
   reset();
 
-  delete[] fResponseBuffer;
+  if (fUsesSharedResponseBuffer) {
+    // Our buffer (if any) was returned to the pool by "reset()"
+    ResponseBufferPool::ourPool(envir())->removeClient();
+  } else {
+    delete[] fResponseBuffer;
+  }
   delete[] fUserAgentHeaderStr;
 }
 
@@ -410,6 +698,7 @@ void RTSPClient::reset() {
   fRequestsAwaitingConnection.reset();
   fRequestsAwaitingHTTPTunneling.reset();
   fRequestsAwaitingResponse.reset();
+  fRequestsAwaitingSessionId.reset();
   fServerAddress = 0;
 
   setBaseURL(NULL);
@@ -450,6 +739,9 @@ unsigned RTSPClient::sendRequest(RequestRecord* request) {
       return request->cseq();
     }
 
+    // If our connection is shared with other clients, then give the request a "CSeq" that's distinct from those of theirs:
+    if (fSharedConnection != NULL) request->cseq() = ++fSharedConnection->fCSeq;
+
     // If requested (and we're not already doing it, or have done it), set up the special protocol for tunneling RTSP-over-HTTP:
     if (fTunnelOverHTTPPortNum != 0 && strcmp(request->commandName(), "GET") != 0 && fOutputSocketNum == fInputSocketNum) {
       if (!setupHTTPTunneling1()) break;
@@ -667,7 +959,8 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
       suffix = "";
       transportFmt = "Transport: RAW/RAW/UDP%s%s%s=%d-%d\r\n";
     } else {
-      transportFmt = "Transport: RTP/AVP%s%s%s=%d-%d\r\n";
+      // Ask for the same RTP profile that the subsession's "m=" line used:
+      transportFmt = subsession.usesAVPF() ? "Transport: RTP/AVPF%s%s%s=%d-%d\r\n" : "Transport: RTP/AVP%s%s%s=%d-%d\r\n";
     }
     
     cmdURL = new char[strlen(prefix) + strlen(separator) + strlen(suffix) + 1];
@@ -683,8 +976,9 @@ Boolean RTSPClient::setRequestFields(RequestRecord* request,
     if (streamUsingTCP) { // streaming over the RTSP connection
       transportTypeStr = "/TCP;unicast";
       portTypeStr = ";interleaved";
-      rtpNumber = fTCPStreamIdCount++;
-      rtcpNumber = fTCPStreamIdCount++;
+      unsigned char& tcpStreamIdCount = fSharedConnection != NULL ? fSharedConnection->fTCPStreamIdCount : fTCPStreamIdCount;
+      rtpNumber = tcpStreamIdCount++;
+      rtcpNumber = tcpStreamIdCount++;
     } else { // normal RTP streaming
       unsigned connectionAddress = subsession.connectionEndpointAddress();
       Boolean requestMulticastStreaming
@@ -832,6 +1126,18 @@ Boolean RTSPClient::isRTSPClient() const {
 }
 
 void RTSPClient::resetTCPSockets() {
+  if (fSharedConnection != NULL) {
+    if (fSharedConnection->fClients->fNextClientOnSharedConnection != NULL) {
+      // Other clients are still using our connection, so leave it open for them:
+      leaveSharedConnection();
+      fInputSocketNum = fOutputSocketNum = -1;
+      return;
+    }
+
+    // We're the last client using our connection, so close it (below):
+    delete fSharedConnection; fSharedConnection = NULL;
+  }
+
   if (fInputSocketNum >= 0) {
     envir().taskScheduler().disableBackgroundHandling(fInputSocketNum);
     ::closeSocket(fInputSocketNum);
@@ -843,9 +1149,88 @@ void RTSPClient::resetTCPSockets() {
   fInputSocketNum = fOutputSocketNum = -1;
 }
 
+void RTSPClient::leaveSharedConnection() {
+  SharedConnection* connection = fSharedConnection;
+  fSharedConnection = NULL;
+  Boolean wereReader = connection->reader() == this;
+  connection->removeClient(this);
+
+  if (wereReader && fResponseBytesAlreadySeen > 0) {
+    // Hand the response data that we've read so far (which might be for other clients) to the connection's new reader:
+    RTSPClient* newReader = connection->reader();
+    newReader->getResponseBufferIfNeeded();
+    unsigned numBytes = fResponseBytesAlreadySeen;
+    if (numBytes > newReader->fResponseBufferBytesLeft) numBytes = newReader->fResponseBufferBytesLeft;
+    memmove(&newReader->fResponseBuffer[newReader->fResponseBytesAlreadySeen], fResponseBuffer, numBytes);
+    newReader->fResponseBytesAlreadySeen += numBytes;
+    newReader->fResponseBufferBytesLeft -= numBytes;
+    newReader->fResponseBuffer[newReader->fResponseBytesAlreadySeen] = '\0';
+    resetResponseBuffer();
+  }
+}
+
+void RTSPClient::handleSharedConnectionFailure() {
+  // The connection that we share with other clients has failed (or been closed by the server).  First, detach each of its
+  // clients from it, and close it.  Then, for each of the clients' pending requests, tell its handler about the error:
+  SharedConnection* connection = fSharedConnection;
+  RTSPClient** clients;
+  LivenessToken** tokens;
+  unsigned numClients = connection->watchClients(clients, tokens);
+  RequestQueue* requestQueues = new RequestQueue[numClients];
+  RequestRecord* request;
+  unsigned i;
+  for (i = 0; i < numClients; ++i) {
+    RTSPClient* client = clients[i];
+    while ((request = client->fRequestsAwaitingResponse.dequeue()) != NULL) requestQueues[i].enqueue(request);
+    while ((request = client->fRequestsAwaitingConnection.dequeue()) != NULL) requestQueues[i].enqueue(request);
+    client->resetResponseBuffer();
+    client->fSharedConnection = NULL;
+    client->fNextClientOnSharedConnection = NULL;
+    client->fInputSocketNum = client->fOutputSocketNum = -1;
+  }
+  int socketNum = connection->fSocketNum;
+  delete connection;
+  envir().taskScheduler().disableBackgroundHandling(socketNum);
+  ::closeSocket(socketNum);
+
+  // (Any of these handlers might delete clients - including us - so we check each client's "LivenessToken" first.)
+  for (i = 0; i < numClients; ++i) {
+    while ((request = requestQueues[i].dequeue()) != NULL) {
+      if (tokens[i]->fClient != NULL) clients[i]->handleRequestError(request);
+      delete request;
+    }
+    (void)stopWatchingForDeletion(tokens[i]);
+  }
+  delete[] requestQueues; delete[] tokens; delete[] clients;
+}
+
+void RTSPClient::arrangeToReadResponses() {
+  if (fSharedConnection != NULL) {
+    envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
+						  (TaskScheduler::BackgroundHandlerProc*)&SharedConnection::incomingDataHandler,
+						  fSharedConnection);
+  } else {
+    envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
+						  (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+  }
+}
+
 void RTSPClient::resetResponseBuffer() {
   fResponseBytesAlreadySeen = 0;
-  fResponseBufferBytesLeft = responseBufferSize;
+  fResponseBufferBytesLeft = fResponseBufferSize;
+
+  if (fUsesSharedResponseBuffer && fResponseBuffer != NULL) {
+    // We're not in the middle of a response, so we no longer need our buffer:
+    ResponseBufferPool::ourPool(envir())->releaseBuffer(fResponseBuffer, fResponseBufferSize);
+    fResponseBuffer = NULL;
+  }
+}
+
+void RTSPClient::getResponseBufferIfNeeded() {
+  if (fResponseBuffer == NULL) {
+    fResponseBuffer = ResponseBufferPool::ourPool(envir())->getBuffer(fResponseBufferSize);
+    fResponseBufferBytesLeft = fResponseBufferSize - fResponseBytesAlreadySeen;
+  }
 }
 
 int RTSPClient::openConnection() {
@@ -864,20 +1249,37 @@ int RTSPClient::openConnection() {
       delete[] username;
       delete[] password;
     }
+    fServerAddress = *(netAddressBits*)(destAddress.data());
+
+    Boolean const mayShareConnection = fAllowConnectionSharing && fTunnelOverHTTPPortNum == 0;
+    if (mayShareConnection) {
+      SharedConnection* connection = SharedConnection::lookup(envir(), fServerAddress, destPortNum);
+      if (connection != NULL) {
+	// Another client already has a connection to this server, so use it, rather than opening a new one:
+	if (fVerbosityLevel >= 1) envir() << "Sharing an existing connection to the server\n";
+	connection->addClient(this);
+	fSharedConnection = connection;
+	fInputSocketNum = fOutputSocketNum = connection->fSocketNum;
+	return connection->fIsPending ? 0 : 1;
+      }
+    }
     
     // We don't yet have a TCP socket (or we used to have one, but it got closed).  Set it up now.
     fInputSocketNum = fOutputSocketNum = setupStreamSocket(envir(), 0);
     if (fInputSocketNum < 0) break;
     ignoreSigPipeOnSocket(fInputSocketNum); // so that servers on the same host that get killed don't also kill us
+    if (mayShareConnection) {
+      // Let other clients (that connect to the same server) share this connection:
+      fSharedConnection = new SharedConnection(envir(), fServerAddress, destPortNum, fInputSocketNum, this);
+    }
       
     // Connect to the remote endpoint:
-    fServerAddress = *(netAddressBits*)(destAddress.data());
     int connectResult = connectToServer(fInputSocketNum, destPortNum);
     if (connectResult < 0) break;
     else if (connectResult > 0) {
       // The connection succeeded.  Arrange to handle responses to requests sent on it:
-      envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
-						    (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+      if (fSharedConnection != NULL) fSharedConnection->fIsPending = False;
+      arrangeToReadResponses();
     }
     return connectResult;
   } while (0);
@@ -895,8 +1297,14 @@ int RTSPClient::connectToServer(int socketNum, portNumBits remotePortNum) {
     int const err = envir().getErrno();
     if (err == EINPROGRESS || err == EWOULDBLOCK) {
       // The connection is pending; we'll need to handle it later.  Wait for our socket to be 'writable', or have an exception.
-      envir().taskScheduler().setBackgroundHandling(socketNum, SOCKET_WRITABLE|SOCKET_EXCEPTION,
-						    (TaskScheduler::BackgroundHandlerProc*)&connectionHandler, this);
+      if (fSharedConnection != NULL) {
+	envir().taskScheduler().setBackgroundHandling(socketNum, SOCKET_WRITABLE|SOCKET_EXCEPTION,
+						      (TaskScheduler::BackgroundHandlerProc*)&SharedConnection::connectionHandler,
+						      fSharedConnection);
+      } else {
+	envir().taskScheduler().setBackgroundHandling(socketNum, SOCKET_WRITABLE|SOCKET_EXCEPTION,
+						      (TaskScheduler::BackgroundHandlerProc*)&connectionHandler, this);
+      }
       return 0;
     }
     envir().setResultErrMsg("connect() failed: ");
@@ -916,16 +1324,17 @@ char* RTSPClient::createAuthenticatorString(char const* cmd, char const* url) {
     if (auth.nonce() != NULL) { // Digest authentication
       char const* const authFmt =
 	"Authorization: Digest username=\"%s\", realm=\"%s\", "
-	"nonce=\"%s\", uri=\"%s\", response=\"%s\"\r\n";
-      char const* response = auth.computeDigestResponse(cmd, url);
+	"nonce=\"%s\", uri=\"%s\", response=\"%s\"%s\r\n";
+      char const* algorithmStr = auth.usesSHA256() ? ", algorithm=SHA-256" : "";
+      char response[DIGEST_RESPONSE_MAX_SIZE];
+      auth.computeDigestResponse(cmd, url, strlen(url), auth.nonce(), strlen(auth.nonce()), response);
       unsigned authBufSize = strlen(authFmt)
 	+ strlen(auth.username()) + strlen(auth.realm())
-	+ strlen(auth.nonce()) + strlen(url) + strlen(response);
+	+ strlen(auth.nonce()) + strlen(url) + strlen(response) + strlen(algorithmStr);
       authenticatorStr = new char[authBufSize];
       sprintf(authenticatorStr, authFmt,
 	      auth.username(), auth.realm(),
-	      auth.nonce(), url, response);
-      auth.reclaimDigestResponse(response);
+	      auth.nonce(), url, response, algorithmStr);
     } else { // Basic authentication
       char const* const authFmt = "Authorization: Basic %s\r\n";
 
@@ -979,9 +1388,66 @@ void RTSPClient::handleRequestError(RequestRecord* request) {
     resultCode = -ENOTCONN;
 #endif
   }
+  if (strcmp(request->commandName(), "SETUP") == 0 && (request->booleanFlags()&0x8) != 0) {
+    // This was a pipelined "SETUP" (see "sendSetupAndPlayCommands()"), so the requests for the same session that were
+    // waiting for it can't be sent either.  Tell them about the error also (after this request).  Then send the next
+    // waiting request (for some other session), if any.  (Note that any of these handlers might delete "this".)
+    LivenessToken* liveness = watchForDeletion();
+
+    if (request->handler() != NULL) (*request->handler())(this, resultCode, strDup(envir().getResultMsg()));
+    if (liveness->fClient != NULL) failRequestsAwaitingSessionId(request->subsession()->parentSession(), resultCode);
+    if (liveness->fClient != NULL) (void)sendRequestsAwaitingSessionId();
+
+    (void)stopWatchingForDeletion(liveness);
+    return;
+  }
+
   if (request->handler() != NULL) (*request->handler())(this, resultCode, strDup(envir().getResultMsg()));
 }
 
+void RTSPClient::failRequestsAwaitingSessionId(MediaSession& session, int resultCode) {
+  // Separate the waiting requests for "session" from the others (which remain waiting):
+  RequestQueue failedRequests, remainingRequests;
+  RequestRecord* request;
+  while ((request = fRequestsAwaitingSessionId.dequeue()) != NULL) {
+    MediaSession* requestSession
+      = request->subsession() != NULL ? &request->subsession()->parentSession() : request->session();
+    if (requestSession == &session) {
+      failedRequests.enqueue(request);
+    } else {
+      remainingRequests.enqueue(request);
+    }
+  }
+  while ((request = remainingRequests.dequeue()) != NULL) fRequestsAwaitingSessionId.enqueue(request);
+
+  LivenessToken* liveness = watchForDeletion();
+  while ((request = failedRequests.dequeue()) != NULL) {
+    if (liveness->fClient != NULL && request->handler() != NULL) {
+      (*request->handler())(this, resultCode, strDup(envir().getResultMsg()));
+    }
+    delete request;
+  }
+  (void)stopWatchingForDeletion(liveness);
+}
+
+RTSPClient::LivenessToken* RTSPClient::watchForDeletion() {
+  if (fLivenessToken == NULL) {
+    fLivenessToken = new LivenessToken(this);
+  } else {
+    ++fLivenessToken->fRefCount;
+  }
+  return fLivenessToken;
+}
+
+Boolean RTSPClient::stopWatchingForDeletion(LivenessToken* token) {
+  RTSPClient* client = token->fClient;
+  if (--token->fRefCount == 0) {
+    if (client != NULL) client->fLivenessToken = NULL;
+    delete token;
+  }
+  return client == NULL;
+}
+
 Boolean RTSPClient
 ::parseResponseCode(char const* line, unsigned& responseCode, char const*& responseString) {
   if (sscanf(line, "RTSP/%*s%u", &responseCode) != 1 &&
@@ -1153,7 +1619,7 @@ Boolean RTSPClient::parseRTPInfoParams(char const*& paramsStr, u_int16_t& seqNum
 
 Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const* sessionParamsStr, char const* transportParamsStr,
                                         Boolean streamUsingTCP) {
-  char* sessionId = new char[responseBufferSize]; // ensures we have enough space
+  char* sessionId = new char[sessionParamsStr == NULL ? 1 : strlen(sessionParamsStr)+1]; // ensures we have enough space
   Boolean success = False;
   do {
     // Check for a session id:
@@ -1195,7 +1661,12 @@ Boolean RTSPClient::handleSETUPResponse(MediaSubsession& subsession, char const*
 	increaseReceiveBufferTo(envir(), fInputSocketNum, 50*1024);
       }
       if (subsession.rtcpInstance() != NULL) subsession.rtcpInstance()->setStreamSocket(fInputSocketNum, subsession.rtcpChannelId);
-      RTPInterface::setServerRequestAlternativeByteHandler(envir(), fInputSocketNum, handleAlternativeRequestByte, this);
+      if (fSharedConnection != NULL) {
+	RTPInterface::setServerRequestAlternativeByteHandler(envir(), fInputSocketNum,
+							     SharedConnection::handleAlternativeRequestByte, fSharedConnection);
+      } else {
+	RTPInterface::setServerRequestAlternativeByteHandler(envir(), fInputSocketNum, handleAlternativeRequestByte, this);
+      }
     } else {
       // Normal case.
       // Set the RTP and RTCP sockets' destination address and port from the information in the SETUP response (if present):
@@ -1329,6 +1800,47 @@ Boolean RTSPClient::handleGET_PARAMETERResponse(char const* parameterName, char*
   return False;
 }
 
+// Looks for the parameter "paramName" in the parameters "paramsStr" of a "WWW-Authenticate:" header.  If found, copies
+// its (unquoted) value into "resultStr" (which must be at least as large as "paramsStr"), and returns True.
+static Boolean getAuthenticateParam(char const* paramsStr, char const* paramName, char* resultStr) {
+  unsigned const paramNameLength = strlen(paramName);
+  Boolean isInQuotes = False;
+  for (char const* p = paramsStr; *p != '\0'; ++p) {
+    if (*p == '"') {
+      isInQuotes = !isInQuotes;
+    } else if (!isInQuotes && (p == paramsStr || p[-1] == ' ' || p[-1] == ',')
+	       && _strncasecmp(p, paramName, paramNameLength) == 0 && p[paramNameLength] == '=') {
+      p += paramNameLength + 1;
+      if (*p == '"') {
+	++p;
+	while (*p != '"' && *p != '\0') *resultStr++ = *p++;
+      } else {
+	while (*p != ',' && *p != ' ' && *p != '\0') *resultStr++ = *p++;
+      }
+      *resultStr = '\0';
+      return True;
+    }
+  }
+  return False;
+}
+
+static Boolean isSHA256DigestChallenge(char const* paramsStr) {
+  char* algorithm = strDupSize(paramsStr);
+  Boolean result = _strncasecmp(paramsStr, "Digest ", 7) == 0
+    && getAuthenticateParam(&paramsStr[7], "algorithm", algorithm)
+    && strlen(algorithm) == 7 && _strncasecmp(algorithm, "SHA-256", 7) == 0;
+  delete[] algorithm;
+  return result;
+}
+
+static unsigned authenticateChallengePreference(char const* paramsStr, Boolean passwordIsMD5) {
+  // Ranks a "WWW-Authenticate:" header (higher is better).  We prefer "Digest" to "Basic", and the "SHA-256" digest
+  // algorithm to "MD5" - unless our password is already a MD5 digest, in which case we can't use "SHA-256" at all:
+  if (_strncasecmp(paramsStr, "Digest", 6) != 0) return 1;
+  if (!isSHA256DigestChallenge(paramsStr)) return 2;
+  return passwordIsMD5 ? 0 : 3;
+}
+
 Boolean RTSPClient::handleAuthenticationFailure(char const* paramsStr) {
   if (paramsStr == NULL) return False; // There was no "WWW-Authenticate:" header; we can't proceed.
 
@@ -1339,13 +1851,16 @@ Boolean RTSPClient::handleAuthenticationFailure(char const* paramsStr) {
   char* nonce = strDupSize(paramsStr);
   char* stale = strDupSize(paramsStr);
   Boolean success = True;
-  if (sscanf(paramsStr, "Digest realm=\"%[^\"]\", nonce=\"%[^\"]\", stale=%[a-zA-Z]", realm, nonce, stale) == 3) {
-    realmHasChanged = fCurrentAuthenticator.realm() == NULL || strcmp(fCurrentAuthenticator.realm(), realm) != 0;
-    isStale = _strncasecmp(stale, "true", 4) == 0;
-    fCurrentAuthenticator.setRealmAndNonce(realm, nonce);
-  } else if (sscanf(paramsStr, "Digest realm=\"%[^\"]\", nonce=\"%[^\"]\"", realm, nonce) == 2) {
+  if (_strncasecmp(paramsStr, "Digest ", 7) == 0
+      && getAuthenticateParam(&paramsStr[7], "realm", realm) && getAuthenticateParam(&paramsStr[7], "nonce", nonce)) {
     realmHasChanged = fCurrentAuthenticator.realm() == NULL || strcmp(fCurrentAuthenticator.realm(), realm) != 0;
-    fCurrentAuthenticator.setRealmAndNonce(realm, nonce);
+    if (getAuthenticateParam(&paramsStr[7], "stale", stale)) isStale = _strncasecmp(stale, "true", 4) == 0;
+    if (isSHA256DigestChallenge(paramsStr) && fCurrentAuthenticator.passwordIsMD5()) {
+      success = False; // we can't compute a SHA-256 digest from a MD5 digest
+    } else {
+      fCurrentAuthenticator.setRealmAndNonce(realm, nonce);
+      fCurrentAuthenticator.setUsesSHA256(isSHA256DigestChallenge(paramsStr));
+    }
   } else if (sscanf(paramsStr, "Basic realm=\"%[^\"]\"", realm) == 1 && fAllowBasicAuthentication) {
     realmHasChanged = fCurrentAuthenticator.realm() == NULL || strcmp(fCurrentAuthenticator.realm(), realm) != 0;
     fCurrentAuthenticator.setRealmAndNonce(realm, NULL); // Basic authentication
@@ -1366,6 +1881,26 @@ Boolean RTSPClient::handleAuthenticationFailure(char const* paramsStr) {
   return success;
 }
 
+unsigned RTSPClient::sendRequestsAwaitingSessionId() {
+  // If we know our session id, then we can send all of the waiting requests now.  Otherwise, we send just the first one
+  // (a "SETUP"), and send the rest after we get its response (which should give us our session id):
+  unsigned firstCSeq = 0;
+  RequestRecord* request;
+  while ((request = fRequestsAwaitingSessionId.dequeue()) != NULL) {
+    Boolean haveSessionId = fLastSessionId != NULL;
+
+    request->cseq() = ++fCSeq;
+    if (strcmp(request->commandName(), "PLAY") == 0) sendDummyUDPPackets(*request->session()); // hack to improve NAT traversal
+    unsigned cseq = sendRequest(request);
+    if (cseq == 0) return 0; // the request couldn't be sent (and its handler - which might have deleted us - was called)
+    if (firstCSeq == 0) firstCSeq = cseq;
+
+    if (!haveSessionId) break;
+  }
+
+  return firstCSeq;
+}
+
 Boolean RTSPClient::resendCommand(RequestRecord* request) {
   if (fVerbosityLevel >= 1) envir() << "Resending...\n";
   if (request != NULL && strcmp(request->commandName(), "GET") != 0) request->cseq() = ++fCSeq;
@@ -1389,10 +1924,10 @@ void RTSPClient::handleAlternativeRequestByte1(u_int8_t requestByte) {
     handleResponseBytes(-1);
   } else if (requestByte == 0xFE) {
     // Another hack: The new handler of the input TCP socket no longer needs it, so take back control:
-    envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
-						  (TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+    arrangeToReadResponses();
   } else {
     // Normal case:
+    getResponseBufferIfNeeded();
     fResponseBuffer[fResponseBytesAlreadySeen] = requestByte;
     handleResponseBytes(1);
   }
@@ -1513,8 +2048,7 @@ void RTSPClient::connectionHandler(void* instance, int /*mask*/) {
 void RTSPClient::connectionHandler1() {
   // Restore normal handling on our sockets:
   envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
-  envir().taskScheduler().setBackgroundHandling(fInputSocketNum, SOCKET_READABLE|SOCKET_EXCEPTION,
-						(TaskScheduler::BackgroundHandlerProc*)&incomingDataHandler, this);
+  arrangeToReadResponses();
 
   // Move all requests awaiting connection into a new, temporary queue, to clear "fRequestsAwaitingConnection"
   // (so that "sendRequest()" doesn't get confused by "fRequestsAwaitingConnection" being nonempty, and enqueue them all over again).
@@ -1535,6 +2069,13 @@ void RTSPClient::connectionHandler1() {
     if (fVerbosityLevel >= 1) envir() << "...remote connection opened\n";
     if (fHTTPTunnelingConnectionIsPending && !setupHTTPTunneling2()) break;
 
+    if (fSharedConnection != NULL) {
+      // The other clients that share this connection might also have pending requests.  Resume sending these, with ours:
+      while ((request = tmpRequestQueue.dequeue()) != NULL) fRequestsAwaitingConnection.enqueue(request);
+      fSharedConnection->resumeRequestsAwaitingConnection();
+      return;
+    }
+
     // Resume sending all pending requests:
     while ((request = tmpRequestQueue.dequeue()) != NULL) {
       sendRequest(request);
@@ -1543,6 +2084,12 @@ void RTSPClient::connectionHandler1() {
   } while (0);
 
   // An error occurred.  Tell all pending requests about the error:
+  if (fSharedConnection != NULL) {
+    // The error affects all of the clients that share this connection:
+    while ((request = tmpRequestQueue.dequeue()) != NULL) fRequestsAwaitingConnection.enqueue(request);
+    handleSharedConnectionFailure();
+    return;
+  }
   resetTCPSockets(); // do this now, in case an error handler deletes "this"
   while ((request = tmpRequestQueue.dequeue()) != NULL) {
     handleRequestError(request);
@@ -1558,6 +2105,7 @@ void RTSPClient::incomingDataHandler(void* instance, int /*mask*/) {
 void RTSPClient::incomingDataHandler1() {
   struct sockaddr_in dummy; // 'from' address - not used
 
+  getResponseBufferIfNeeded();
   int bytesRead = readSocket(envir(), fInputSocketNum, (unsigned char*)&fResponseBuffer[fResponseBytesAlreadySeen], fResponseBufferBytesLeft, dummy);
   handleResponseBytes(bytesRead);
 }
@@ -1581,6 +2129,37 @@ static char* getLine(char* startOfLine) {
   return NULL;
 }
 
+static unsigned responseCSeq(char const* response) {
+  // Returns the value of the "CSeq:" header in the headers of "response", or 0 if there's none:
+  char* responseCopy = strDup(response);
+  unsigned cseq = 0;
+  char* lineStart;
+  char* nextLineStart = responseCopy;
+  do {
+    lineStart = nextLineStart;
+    nextLineStart = getLine(lineStart);
+  } while (lineStart[0] == '\0' && nextLineStart != NULL); // skip over any blank lines at the start, then the response code
+  while ((lineStart = nextLineStart) != NULL) {
+    nextLineStart = getLine(lineStart);
+    if (lineStart[0] == '\0') break; // this is a blank line, ending the headers
+    if (_strncasecmp(lineStart, "CSeq:", 5) == 0) {
+      if (sscanf(&lineStart[5], "%u", &cseq) != 1) cseq = 0;
+      break;
+    }
+  }
+
+  delete[] responseCopy;
+  return cseq;
+}
+
+void RTSPClient::handleForwardedResponse(char const* response, unsigned responseSize) {
+  // Handle the response as if we'd read it from our socket ourself:
+  getResponseBufferIfNeeded();
+  unsigned numBytesToCopy = responseSize < fResponseBufferBytesLeft ? responseSize : fResponseBufferBytesLeft;
+  memmove(&fResponseBuffer[fResponseBytesAlreadySeen], response, numBytesToCopy);
+  handleResponseBytes(responseSize);
+}
+
 void RTSPClient::handleResponseBytes(int newBytesRead) {
   do {
     if (newBytesRead >= 0 && (unsigned)newBytesRead < fResponseBufferBytesLeft) break; // data was read OK; process it below
@@ -1599,6 +2178,9 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	handleRequestError(request);
 	delete request;
       }
+    } else if (fSharedConnection != NULL) {
+      // The error affects all of the clients that share our connection:
+      handleSharedConnectionFailure();
     } else {
       RequestQueue requestQueue(fRequestsAwaitingResponse);
       resetTCPSockets(); // do this now, in case an error handler deletes "this"
@@ -1653,9 +2235,12 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
     char const* publicParamsStr = NULL;
     char* bodyStart = NULL;
     unsigned numBodyBytes = 0;
+    RTSPClient* responseRecipient = this; // changes if the response is for another client that shares our connection
+    char* forwardedResponse = NULL;
+    unsigned forwardedResponseSize = 0;
     responseSuccess = False;
     do {
-      headerDataCopy = new char[responseBufferSize];
+      headerDataCopy = new char[fResponseBytesAlreadySeen+1];
       strncpy(headerDataCopy, fResponseBuffer, fResponseBytesAlreadySeen);
       headerDataCopy[fResponseBytesAlreadySeen] = '\0';
       
@@ -1670,6 +2255,15 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	handleIncomingRequest();
 	break; // we're done with this data
       }
+
+      if (fSharedConnection != NULL) {
+	// Our connection is shared with other clients, so the response might be for one of their requests.  If so, we'll pass
+	// it on to that client (below), without handling its headers ourself (except for "Content-Length:"):
+	unsigned cseq = responseCSeq(fResponseBuffer);
+	if (cseq != 0 && fRequestsAwaitingResponse.findByCSeq(cseq) == NULL) {
+	  responseRecipient = fSharedConnection->clientAwaitingResponse(cseq); // NULL if none
+	}
+      }
       
       // Scan through the headers, handling the ones that we're interested in:
       Boolean reachedEndOfHeaders;
@@ -1686,6 +2280,7 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	reachedEndOfHeaders = False;
 	
 	char const* headerParamsStr; 
+	if (responseRecipient != this && !checkForHeader(lineStart, "Content-Length:", 15, headerParamsStr)) continue;
 	if (checkForHeader(lineStart, "CSeq:", 5, headerParamsStr)) {
 	  if (sscanf(headerParamsStr, "%u", &cseq) != 1 || cseq <= 0) {
 	    envir().setResultMsg("Bad \"CSeq:\" header: \"", lineStart, "\"");
@@ -1725,8 +2320,11 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	} else if (checkForHeader(lineStart, "RTP-Info:", 9, rtpInfoParamsStr)) {
 	} else if (checkForHeader(lineStart, "WWW-Authenticate:", 17, headerParamsStr)) {
 	  // If we've already seen a "WWW-Authenticate:" header, then we replace it with this new one only if
-	  // the new one specifies "Digest" authentication:
-	  if (wwwAuthenticateParamsStr == NULL || _strncasecmp(headerParamsStr, "Digest", 6) == 0) {
+	  // we prefer the new one:
+	  Boolean const passwordIsMD5 = fCurrentAuthenticator.passwordIsMD5();
+	  if (wwwAuthenticateParamsStr == NULL
+	      || authenticateChallengePreference(headerParamsStr, passwordIsMD5)
+	         > authenticateChallengePreference(wwwAuthenticateParamsStr, passwordIsMD5)) {
 	    wwwAuthenticateParamsStr = headerParamsStr;
 	  }
 	} else if (checkForHeader(lineStart, "Public:", 7, publicParamsStr)) {
@@ -1748,14 +2346,14 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	    delete[] newBaseURL;
 	  }
 	} else if (checkForHeader(lineStart, "Connection:", 11, headerParamsStr)) {
-	  if (_strncasecmp(headerParamsStr, "Close", 5) == 0) {
+	  if (_strncasecmp(headerParamsStr, "Close", 5) == 0 && fSharedConnection == NULL) {
 	    resetTCPSockets();
-	  }
+	  } // else the server will close our shared connection, and we'll then tell all of its clients
 	}
       }
       if (!reachedEndOfHeaders) break; // an error occurred
       
-      if (foundRequest == NULL) {
+      if (foundRequest == NULL && responseRecipient == this) {
 	// Hack: The response didn't have a "CSeq:" header; assume it's for our most recent request:
 	foundRequest = fRequestsAwaitingResponse.dequeue();
       }
@@ -1767,11 +2365,11 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
       if (contentLength > numBodyBytes) {
 	// We need to read more data.  First, make sure we have enough space for it:
 	unsigned numExtraBytesNeeded = contentLength - numBodyBytes;
-	unsigned remainingBufferSize = responseBufferSize - fResponseBytesAlreadySeen;
+	unsigned remainingBufferSize = fResponseBufferSize - fResponseBytesAlreadySeen;
 	if (numExtraBytesNeeded > remainingBufferSize) {
 	  char tmpBuf[200];
 	  sprintf(tmpBuf, "Response buffer size (%d) is too small for \"Content-Length:\" %d (need a buffer size of >= %d bytes\n",
-		  responseBufferSize, contentLength, fResponseBytesAlreadySeen + numExtraBytesNeeded);
+		  fResponseBufferSize, contentLength, fResponseBytesAlreadySeen + numExtraBytesNeeded);
 	  envir().setResultMsg(tmpBuf);
 	  break;
 	}
@@ -1790,6 +2388,15 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
       char* responseEnd = bodyStart + contentLength;
       numExtraBytesAfterResponse = &fResponseBuffer[fResponseBytesAlreadySeen] - responseEnd;
 
+      if (responseRecipient != this) {
+	// Copy the response, to pass on to the client whose request it's for (below):
+	forwardedResponseSize = responseEnd - fResponseBuffer;
+	forwardedResponse = new char[forwardedResponseSize];
+	memmove(forwardedResponse, fResponseBuffer, forwardedResponseSize);
+	responseSuccess = True;
+	break;
+      }
+
       if (fVerbosityLevel >= 1) {
 	char saved = *responseEnd;
 	*responseEnd = '\0';
@@ -1841,6 +2448,7 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
     
     // If we have a handler function for this response, call it.
     // But first, reset our response buffer, in case the handler goes to the event loop, and we end up getting called recursively:
+    Boolean bodyWasCopied = False;
     if (numExtraBytesAfterResponse > 0) {
       // An unusual case; usually due to having received pipelined responses.  Move the extra bytes to the front of the buffer:
       char* responseEnd = &fResponseBuffer[fResponseBytesAlreadySeen - numExtraBytesAfterResponse];
@@ -1852,15 +2460,31 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	*responseEnd = '\0';
 	bodyStart = strDup(bodyStart);
 	*responseEnd = saved;
+	bodyWasCopied = True;
       }
       
       memmove(fResponseBuffer, responseEnd, numExtraBytesAfterResponse);
       fResponseBytesAlreadySeen = numExtraBytesAfterResponse;
-      fResponseBufferBytesLeft = responseBufferSize - numExtraBytesAfterResponse;
+      fResponseBufferBytesLeft = fResponseBufferSize - numExtraBytesAfterResponse;
       fResponseBuffer[numExtraBytesAfterResponse] = '\0';
     } else {
+      if (fUsesSharedResponseBuffer && numBodyBytes > 0) {
+	// Our response buffer is about to go back to the shared pool, where it may be reused (by another client called
+	// from our handler), so save a copy of the response 'body' first:
+	bodyStart = strDup(bodyStart);
+	bodyWasCopied = True;
+      }
       resetResponseBuffer();
     }
+
+    // Call the response handler (if any) - and then, if this was a pipelined "SETUP" (see "sendSetupAndPlayCommands()"),
+    // send the requests that were waiting for it.  Because either of these might delete "this", we check for this
+    // before continuing:
+    LivenessToken* liveness = watchForDeletion();
+    if (forwardedResponse != NULL) {
+      if (responseRecipient != NULL) responseRecipient->handleForwardedResponse(forwardedResponse, forwardedResponseSize);
+      delete[] forwardedResponse;
+    }
     if (foundRequest != NULL && foundRequest->handler() != NULL) {
       int resultCode;
       char* resultString;
@@ -1880,9 +2504,16 @@ void RTSPClient::handleResponseBytes(int newBytesRead) {
 	handleRequestError(foundRequest);
       }
     }
+    if (liveness->fClient != NULL && responseSuccess && foundRequest != NULL && strcmp(foundRequest->commandName(), "SETUP") == 0
+	&& (foundRequest->booleanFlags()&0x8) != 0) {
+      (void)sendRequestsAwaitingSessionId();
+    }
+    Boolean weWereDeleted = stopWatchingForDeletion(liveness);
+
     delete foundRequest;
     delete[] headerDataCopy;
-    if (numExtraBytesAfterResponse > 0 && numBodyBytes > 0) delete[] bodyStart;
+    if (bodyWasCopied) delete[] bodyStart;
+    if (weWereDeleted) return;
   } while (numExtraBytesAfterResponse > 0 && responseSuccess);
 }
 
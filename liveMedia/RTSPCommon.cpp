@@ -335,10 +335,21 @@ Boolean RTSPOptionIsSupported(char const* commandName, char const* optionsRespon
 }
 
 char const* dateHeader() {
+#if defined(__GNUC__) && !defined(_WIN32)
+  // Use a separate buffer for each thread, so that servers running in different threads
+  // (each with its own "UsageEnvironment") don't overwrite each other's "Date:" headers:
+  static __thread char buf[200];
+#else
   static char buf[200];
+#endif
 #if !defined(_WIN32_WCE)
   time_t tt = time(NULL);
+#if !defined(_WIN32)
+  struct tm tmBuf;
+  strftime(buf, sizeof buf, "Date: %a, %b %d %Y %H:%M:%S GMT\r\n", gmtime_r(&tt, &tmBuf));
+#else
   strftime(buf, sizeof buf, "Date: %a, %b %d %Y %H:%M:%S GMT\r\n", gmtime(&tt));
+#endif
 #else
   // WinCE apparently doesn't have "time()", "strftime()", or "gmtime()",
   // so generate the "Date:" header a different, WinCE-specific way.
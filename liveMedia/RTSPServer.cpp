@@ -22,6 +22,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "RTSPCommon.hh"
 #include "RTSPRegisterSender.hh"
 #include "Base64.hh"
+#include "ourMD5.hh"
 #include <GroupsockHelper.hh>
 
 ////////// RTSPServer implementation //////////
@@ -113,6 +114,43 @@ portNumBits RTSPServer::httpServerPortNum() const {
   return ntohs(fHTTPServerPort.num());
 }
 
+unsigned RTSPServer::getQoSSnapshots(char const* streamName, RTPQoSSnapshot* snapshots, unsigned maxNumSnapshots) {
+  unsigned numSnapshots = 0;
+
+  ClientSessionIterator iter(*this);
+  RTSPClientSession* clientSession;
+  while (numSnapshots < maxNumSnapshots && (clientSession = (RTSPClientSession*)(iter.next())) != NULL) {
+    ServerMediaSession* sms = clientSession->fOurServerMediaSession;
+    if (sms == NULL) continue;
+    if (streamName != NULL && strcmp(sms->streamName(), streamName) != 0) continue;
+
+    for (unsigned i = 0; i < clientSession->fNumStreamStates && numSnapshots < maxNumSnapshots; ++i) {
+      ServerMediaSubsession* subsession = clientSession->fStreamStates[i].subsession;
+      void* streamToken = clientSession->fStreamStates[i].streamToken;
+      if (subsession == NULL || streamToken == NULL) continue; // this track hasn't been set up
+
+      RTPSink const* rtpSink = NULL;
+      RTCPInstance const* rtcpInstance = NULL;
+      subsession->getRTPSinkandRTCP(streamToken, rtpSink, rtcpInstance);
+      if (rtpSink == NULL) continue;
+
+      // Use the statistics from this client's own "RR"s (if it has sent any):
+      RTPTransmissionStats const* receiverStats = NULL;
+      u_int32_t receiverSSRC;
+      if (subsession->getReceiverSSRC(clientSession->fOurSessionId, streamToken, receiverSSRC)) {
+	receiverStats = rtpSink->transmissionStatsDB().lookup(receiverSSRC);
+      }
+
+      RTPQoSSnapshot& snapshot = snapshots[numSnapshots++];
+      rtpSink->getQoSSnapshot(snapshot, receiverStats);
+      snapshot.clientSessionId = clientSession->fOurSessionId;
+      snapshot.trackId = subsession->trackId();
+    }
+  }
+
+  return numSnapshots;
+}
+
 char const* RTSPServer::allowedCommandNames() {
   return "OPTIONS, DESCRIBE, SETUP, TEARDOWN, PLAY, PAUSE, GET_PARAMETER, SET_PARAMETER";
 }
@@ -143,7 +181,16 @@ RTSPServer::RTSPServer(UsageEnvironment& env,
     fClientConnectionsForHTTPTunneling(NULL), // will get created if needed
     fTCPStreamingDatabase(HashTable::create(ONE_WORD_HASH_KEYS)),
     fPendingRegisterOrDeregisterRequests(HashTable::create(ONE_WORD_HASH_KEYS)),
-    fRegisterOrDeregisterRequestCounter(0), fAuthDB(authDatabase), fAllowStreamingRTPOverTCP(True) {
+    fRegisterOrDeregisterRequestCounter(0), fAuthDB(authDatabase), fAllowStreamingRTPOverTCP(True),
+    fAuthenticationNonceLifetime(0) {
+  // Create the (unguessable) secret that's used in our authentication nonces:
+  struct {
+    char nonce[33];
+    u_int32_t random[4];
+  } seedData;
+  Authenticator::createRandomNonce(seedData.nonce);
+  for (unsigned i = 0; i < 4; ++i) seedData.random[i] = our_random32();
+  our_MD5Data((unsigned char*)(&seedData), sizeof seedData, fNonceSecret);
 }
 
 // A data structure that is used to implement "fTCPStreamingDatabase"
@@ -313,7 +360,7 @@ void RTSPServer::RTSPClientConnection
 void RTSPServer::RTSPClientConnection
 ::handleCmd_DESCRIBE(char const* urlPreSuffix, char const* urlSuffix, char const* fullRequestStr) {
   ServerMediaSession* session = NULL;
-  char* sdpDescription = NULL;
+  char const* sdpDescription = NULL;
   char* rtspURL = NULL;
   do {
     char urlTotalSuffix[2*RTSP_PARAM_STRING_MAX];
@@ -341,8 +388,8 @@ void RTSPServer::RTSPClientConnection
     // while we're using it:
     session->incrementReferenceCount();
 
-    // Then, assemble a SDP description for this session:
-    sdpDescription = session->generateSDPDescription();
+    // Then, get a SDP description for this session.  (This is normally the session's cached copy, so we don't free it.)
+    sdpDescription = session->sdpDescription();
     if (sdpDescription == NULL) {
       // This usually means that a file name that was specified for a
       // "ServerMediaSubsession" does not exist.
@@ -377,7 +424,6 @@ void RTSPServer::RTSPClientConnection
     }
   }
 
-  delete[] sdpDescription;
   delete[] rtspURL;
 }
 
@@ -562,11 +608,14 @@ void RTSPServer::RTSPClientConnection::handleHTTPCmd_StreamingGET(char const* /*
   handleHTTPCmd_notSupported();
 }
 
+Boolean RTSPServer::RTSPClientConnection::isReadyForNextRequest() {
+  return True;
+}
+
 void RTSPServer::RTSPClientConnection::resetRequestBuffer() {
   ClientConnection::resetRequestBuffer();
   
   fLastCRLF = &fRequestBuffer[-3]; // hack: Ensures that we don't think we have end-of-msg if the data starts with <CR><LF>
-  fBase64RemainderCount = 0;
 }
 
 void RTSPServer::RTSPClientConnection::closeSocketsRTSP() {
@@ -631,59 +680,28 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     
     if (fClientOutputSocket != fClientInputSocket && numBytesRemaining == 0) {
       // We're doing RTSP-over-HTTP tunneling, and input commands are assumed to have been Base64-encoded.
-      // We therefore Base64-decode as much of this new data as we can (i.e., up to a multiple of 4 bytes).
-      
-      // But first, we remove any whitespace that may be in the input data:
-      unsigned toIndex = 0;
-      for (int fromIndex = 0; fromIndex < newBytesRead; ++fromIndex) {
-	char c = ptr[fromIndex];
-	if (!(c == ' ' || c == '\t' || c == '\r' || c == '\n')) { // not 'whitespace': space,tab,CR,NL
-	  ptr[toIndex++] = c;
-	}
-      }
-      newBytesRead = toIndex;
-      
-      unsigned numBytesToDecode = fBase64RemainderCount + newBytesRead;
-      unsigned newBase64RemainderCount = numBytesToDecode%4;
-      numBytesToDecode -= newBase64RemainderCount;
-      if (numBytesToDecode > 0) {
-	ptr[newBytesRead] = '\0';
-	unsigned decodedSize;
-	unsigned char* decodedBytes = base64Decode((char const*)(ptr-fBase64RemainderCount), numBytesToDecode, decodedSize);
+      // We therefore Base64-decode this new data, in place.  (Our decoder skips whitespace, and keeps any bits that are left
+      // over from an incomplete group of 4 characters until the next read.)
+      newBytesRead = fBase64Decoder.decode((char const*)ptr, newBytesRead, ptr);
 #ifdef DEBUG
-	fprintf(stderr, "Base64-decoded %d input bytes into %d new bytes:", numBytesToDecode, decodedSize);
-	for (unsigned k = 0; k < decodedSize; ++k) fprintf(stderr, "%c", decodedBytes[k]);
-	fprintf(stderr, "\n");
+      fprintf(stderr, "Base64-decoded into %d new bytes:", newBytesRead);
+      for (int k = 0; k < newBytesRead; ++k) fprintf(stderr, "%c", ptr[k]);
+      fprintf(stderr, "\n");
 #endif
-	
-	// Copy the new decoded bytes in place of the old ones (we can do this because there are fewer decoded bytes than original):
-	unsigned char* to = ptr-fBase64RemainderCount;
-	for (unsigned i = 0; i < decodedSize; ++i) *to++ = decodedBytes[i];
-	
-	// Then copy any remaining (undecoded) bytes to the end:
-	for (unsigned j = 0; j < newBase64RemainderCount; ++j) *to++ = (ptr-fBase64RemainderCount+numBytesToDecode)[j];
-	
-	newBytesRead = decodedSize - fBase64RemainderCount + newBase64RemainderCount;
-	  // adjust to allow for the size of the new decoded data (+ remainder)
-	delete[] decodedBytes;
-      }
-      fBase64RemainderCount = newBase64RemainderCount;
     }
     
+    // Look for the end of the message: <CR><LF><CR><LF>
     unsigned char* tmpPtr = fLastCRLF + 2;
-    if (fBase64RemainderCount == 0) { // no more Base-64 bytes remain to be read/decoded
-      // Look for the end of the message: <CR><LF><CR><LF>
-      if (tmpPtr < fRequestBuffer) tmpPtr = fRequestBuffer;
-      while (tmpPtr < &ptr[newBytesRead-1]) {
-	if (*tmpPtr == '\r' && *(tmpPtr+1) == '\n') {
-	  if (tmpPtr - fLastCRLF == 2) { // This is it:
-	    endOfMsg = True;
-	    break;
-	  }
-	  fLastCRLF = tmpPtr;
+    if (tmpPtr < fRequestBuffer) tmpPtr = fRequestBuffer;
+    while (tmpPtr < &ptr[newBytesRead-1]) {
+      if (*tmpPtr == '\r' && *(tmpPtr+1) == '\n') {
+	if (tmpPtr - fLastCRLF == 2) { // This is it:
+	  endOfMsg = True;
+	  break;
 	}
-	++tmpPtr;
+	fLastCRLF = tmpPtr;
       }
+      ++tmpPtr;
     }
     
     fRequestBufferBytesLeft -= newBytesRead;
@@ -716,13 +734,22 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       // If there was a "Content-Length:" header, then make sure we've received all of the data that it specified:
       if (ptr + newBytesRead < tmpPtr + 2 + contentLength) break; // we still need more data; subsequent reads will give it to us 
       
+      if (!requestIsWithinRateLimit()) {
+	// The client is sending requests too quickly.  Close the connection (without responding):
+	fIsActive = False;
+	break;
+      }
+
       // If the request included a "Session:" id, and it refers to a client session that's
       // current ongoing, then use this command to indicate 'liveness' on that client session:
       Boolean const requestIncludedSessionId = sessionIdStr[0] != '\0';
       if (requestIncludedSessionId) {
 	clientSession
 	  = (RTSPServer::RTSPClientSession*)(fOurRTSPServer.lookupClientSession(sessionIdStr));
-	if (clientSession != NULL) clientSession->noteLiveness();
+	if (clientSession != NULL) {
+	  clientSession->noteLiveness();
+	  noteUsedByClientSession();
+	}
       }
     
       // We now have a complete RTSP request.
@@ -772,6 +799,7 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
 	  }
 	}
 	if (clientSession != NULL) {
+	  noteUsedByClientSession();
 	  clientSession->handleCmd_SETUP(this, urlPreSuffix, urlSuffix, (char const*)fRequestBuffer);
 	  playAfterSetup = clientSession->fStreamAfterSETUP;
 	} else if (areAuthenticated) {
@@ -812,6 +840,10 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
       fprintf(stderr, "parseRTSPRequestString() failed; checking now for HTTP commands (for RTSP-over-HTTP tunneling)...\n");
 #endif
       // The request was not (valid) RTSP, but check for a special case: HTTP commands (for setting up RTSP-over-HTTP tunneling):
+      if (!requestIsWithinRateLimit()) {
+	fIsActive = False;
+	break;
+      }
       char sessionCookie[RTSP_PARAM_STRING_MAX];
       char acceptStr[RTSP_PARAM_STRING_MAX];
       *fLastCRLF = '\0'; // temporarily, for parsing
@@ -878,10 +910,19 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
     unsigned requestSize = (fLastCRLF+4-fRequestBuffer) + contentLength;
     numBytesRemaining = fRequestBytesAlreadySeen - requestSize;
     resetRequestBuffer(); // to prepare for any subsequent request
+    if (!isReadyForNextRequest()) stopRequestTimer(); // because we're still responding to this request
     
     if (numBytesRemaining > 0) {
       memmove(fRequestBuffer, &fRequestBuffer[requestSize], numBytesRemaining);
       newBytesRead = numBytesRemaining;
+
+      if (!fIsActive) break;
+      if (!isReadyForNextRequest()) {
+	// Leave the following request in our buffer, to be handled later:
+	fRequestBytesAlreadySeen = numBytesRemaining;
+	fRequestBufferBytesLeft -= numBytesRemaining;
+	break;
+      }
     }
   } while (numBytesRemaining > 0);
   
@@ -894,13 +935,20 @@ void RTSPServer::RTSPClientConnection::handleRequestBytes(int newBytesRead) {
   }
 }
 
+// A parameter value in a "Authorization: Digest" header.  (This points into the request string; it's not '\0'-terminated.)
+struct AuthorizationParam {
+  char const* str;
+  unsigned size;
+};
+
 static Boolean parseAuthorizationHeader(char const* buf,
-					char const*& username,
-					char const*& realm,
-					char const*& nonce, char const*& uri,
-					char const*& response) {
+					AuthorizationParam& username,
+					AuthorizationParam& realm,
+					AuthorizationParam& nonce, AuthorizationParam& uri,
+					AuthorizationParam& response, AuthorizationParam& algorithm) {
   // Initialize the result parameters to default values:
-  username = realm = nonce = uri = response = NULL;
+  username.str = realm.str = nonce.str = uri.str = response.str = algorithm.str = NULL;
+  username.size = realm.size = nonce.size = uri.size = response.size = algorithm.size = 0;
   
   // First, find "Authorization:"
   while (1) {
@@ -909,35 +957,99 @@ static Boolean parseAuthorizationHeader(char const* buf,
     ++buf;
   }
   
-  // Then, run through each of the fields, looking for ones we handle:
+  // Then, run through each of the "<parameter>=<value>" (or "<parameter>="<value>"") fields, looking for ones we handle.
+  // (We do this in place, without copying anything.)
   char const* fields = buf + 22;
-  while (*fields == ' ') ++fields;
-  char* parameter = strDupSize(fields);
-  char* value = strDupSize(fields);
   while (1) {
-    value[0] = '\0';
-    if (sscanf(fields, "%[^=]=\"%[^\"]\"", parameter, value) != 2 &&
-	sscanf(fields, "%[^=]=\"\"", parameter) != 1) {
-      break;
-    }
-    if (strcmp(parameter, "username") == 0) {
-      username = strDup(value);
-    } else if (strcmp(parameter, "realm") == 0) {
-      realm = strDup(value);
-    } else if (strcmp(parameter, "nonce") == 0) {
-      nonce = strDup(value);
-    } else if (strcmp(parameter, "uri") == 0) {
-      uri = strDup(value);
-    } else if (strcmp(parameter, "response") == 0) {
-      response = strDup(value);
-    }
-    
-    fields += strlen(parameter) + 2 /*="*/ + strlen(value) + 1 /*"*/;
     while (*fields == ',' || *fields == ' ') ++fields;
         // skip over any separating ',' and ' ' chars
     if (*fields == '\0' || *fields == '\r' || *fields == '\n') break;
+
+    char const* parameter = fields;
+    while (*fields != '=' && *fields != '\0' && *fields != '\r' && *fields != '\n') ++fields;
+    if (*fields != '=') break; // bad field
+    unsigned const parameterSize = fields - parameter;
+    ++fields;
+
+    AuthorizationParam value;
+    if (*fields == '"') {
+      value.str = ++fields;
+      while (*fields != '"' && *fields != '\0' && *fields != '\r' && *fields != '\n') ++fields;
+      if (*fields != '"') break; // bad field
+      value.size = fields - value.str;
+      ++fields;
+    } else {
+      value.str = fields;
+      while (*fields != ',' && *fields != ' ' && *fields != '\0' && *fields != '\r' && *fields != '\n') ++fields;
+      value.size = fields - value.str;
+    }
+
+    if (parameterSize == 8 && strncmp(parameter, "username", 8) == 0) {
+      username = value;
+    } else if (parameterSize == 5 && strncmp(parameter, "realm", 5) == 0) {
+      realm = value;
+    } else if (parameterSize == 5 && strncmp(parameter, "nonce", 5) == 0) {
+      nonce = value;
+    } else if (parameterSize == 3 && strncmp(parameter, "uri", 3) == 0) {
+      uri = value;
+    } else if (parameterSize == 8 && strncmp(parameter, "response", 8) == 0) {
+      response = value;
+    } else if (parameterSize == 9 && strncmp(parameter, "algorithm", 9) == 0) {
+      algorithm = value;
+    }
+  }
+  return True;
+}
+
+static Boolean paramEquals(AuthorizationParam const& param, char const* str) {
+  return param.str != NULL && strlen(str) == param.size && strncmp(param.str, str, param.size) == 0;
+}
+
+// The size of a shared nonce (created by "RTSPServer::createAuthenticationNonce()").  (Once a connection has used a
+// nonce successfully, it can continue to use it.)
+#define AUTHENTICATION_NONCE_SIZE (8/*timestamp*/+32/*MD5 digest*/)
+
+void RTSPServer::createAuthenticationNonce(struct sockaddr_in const& clientAddr, char* resultBuf) {
+  // The nonce is "<timestamp><digest>", where <timestamp> is the current time (in seconds), as 8 hex digits, and
+  // <digest> is md5(<timestamp><client-address><secret>).  (This is the form suggested in RFC 2617, section 3.2.1.)
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  sprintf(resultBuf, "%08x", (unsigned)timeNow.tv_sec);
+
+  MD5Context ctx;
+  ctx.addData((unsigned char const*)resultBuf, 8);
+  ctx.addData((unsigned char const*)&clientAddr.sin_addr, sizeof clientAddr.sin_addr);
+  ctx.addData((unsigned char const*)fNonceSecret, 32);
+  ctx.end(&resultBuf[8]);
+}
+
+Boolean RTSPServer::isOurAuthenticationNonce(char const* nonce, unsigned nonceSize,
+					     struct sockaddr_in const& clientAddr, Boolean& isStale) {
+  isStale = False;
+  if (nonceSize != AUTHENTICATION_NONCE_SIZE) return False;
+
+  // Check the nonce's digest:
+  char digest[33];
+  MD5Context ctx;
+  ctx.addData((unsigned char const*)nonce, 8);
+  ctx.addData((unsigned char const*)&clientAddr.sin_addr, sizeof clientAddr.sin_addr);
+  ctx.addData((unsigned char const*)fNonceSecret, 32);
+  ctx.end(digest);
+  if (strncmp(&nonce[8], digest, 32) != 0) return False;
+
+  // The nonce is one of ours; check that it's not too old:
+  unsigned timestamp = 0;
+  for (unsigned i = 0; i < 8; ++i) {
+    char c = nonce[i];
+    timestamp = (timestamp<<4) | (c >= 'a' ? c - 'a' + 10 : c - '0');
   }
-  delete[] parameter; delete[] value;
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  if ((unsigned)timeNow.tv_sec - timestamp > fAuthenticationNonceLifetime) {
+    isStale = True;
+    return False;
+  }
+
   return True;
 }
 
@@ -952,71 +1064,122 @@ Boolean RTSPServer::RTSPClientConnection
   UserAuthenticationDatabase* authDB = fOurRTSPServer.getAuthenticationDatabaseForCommand(cmdName);
   if (authDB == NULL) return True;
   
-  char const* username = NULL; char const* realm = NULL; char const* nonce = NULL;
-  char const* uri = NULL; char const* response = NULL;
+  AuthorizationParam username, realm, nonce, uri, response, algorithm;
+  char usernameBuf[100]; // used for the '\0'-terminated username, unless it's too long
+  char* usernameStr = NULL;
   Boolean success = False;
+  Boolean nonceIsStale = False;
   
   do {
-    // To authenticate, we first need to have a nonce set up
-    // from a previous attempt:
-    if (fCurrentAuthenticator.nonce() == NULL) break;
-    
-    // Next, the request needs to contain an "Authorization:" header,
-    // containing a username, (our) realm, (our) nonce, uri,
+    // The request needs to contain an "Authorization:" header,
+    // containing a username, (our) realm, a nonce, uri,
     // and response string:
     if (!parseAuthorizationHeader(fullRequestStr,
-				  username, realm, nonce, uri, response)
-	|| username == NULL
-	|| realm == NULL || strcmp(realm, fCurrentAuthenticator.realm()) != 0
-	|| nonce == NULL || strcmp(nonce, fCurrentAuthenticator.nonce()) != 0
-	|| uri == NULL || response == NULL) {
+				  username, realm, nonce, uri, response, algorithm)
+	|| username.str == NULL
+	|| !paramEquals(realm, authDB->realm())
+	|| nonce.str == NULL || uri.str == NULL || response.str == NULL) {
       break;
     }
+
+    // The digest algorithm must be one that we support:
+    Boolean usesSHA256;
+    if (algorithm.str == NULL || paramEquals(algorithm, "MD5")) {
+      usesSHA256 = False;
+    } else if (paramEquals(algorithm, "SHA-256") && authDB->supportsSHA256()) {
+      usesSHA256 = True;
+    } else {
+      break;
+    }
+
+    usernameStr = username.size < sizeof usernameBuf ? usernameBuf : new char[username.size+1];
+    memcpy(usernameStr, username.str, username.size);
+    usernameStr[username.size] = '\0';
     
-    // Next, the username has to be known to us:
-    char const* password = authDB->lookupPassword(username);
+    // Next, the username has to be known to us.  We use the precomputed md5(<username>:<realm>:<password>)
+    // (or sha256(...)) for it, if we can:
+    fCurrentAuthenticator.setUsesSHA256(usesSHA256);
+    if (fCurrentAuthenticator.realm() == NULL || strcmp(fCurrentAuthenticator.realm(), authDB->realm()) != 0) {
+      fCurrentAuthenticator.setRealmAndNonce(authDB->realm(), NULL);
+    }
+    char const* ha1 = authDB->lookupHA1(usernameStr, usesSHA256);
+    if (ha1 != NULL) {
+      fCurrentAuthenticator.setUsernameAndPassword(usernameStr, ha1, True);
+    } else {
+      char const* password = authDB->lookupPassword(usernameStr);
 #ifdef DEBUG
-    fprintf(stderr, "lookupPassword(%s) returned password %s\n", username, password);
+      fprintf(stderr, "lookupPassword(%s) returned password %s\n", usernameStr, password);
 #endif
-    if (password == NULL) break;
-    fCurrentAuthenticator.setUsernameAndPassword(username, password, authDB->passwordsAreMD5());
+      if (password == NULL) break;
+      if (usesSHA256 && authDB->passwordsAreMD5()) break; // we can't compute a SHA-256 digest from a MD5 digest
+      fCurrentAuthenticator.setUsernameAndPassword(usernameStr, password, authDB->passwordsAreMD5());
+    }
     
-    // Finally, compute a digest response from the information that we have,
+    // Next, compute a digest response from the information that we have,
     // and compare it to the one that we were given:
-    char const* ourResponse
-      = fCurrentAuthenticator.computeDigestResponse(cmdName, uri);
-    success = (strcmp(ourResponse, response) == 0);
-    fCurrentAuthenticator.reclaimDigestResponse(ourResponse);
+    char ourResponse[DIGEST_RESPONSE_MAX_SIZE];
+    fCurrentAuthenticator.computeDigestResponse(cmdName, uri.str, uri.size, nonce.str, nonce.size, ourResponse);
+    if (response.size != strlen(ourResponse) || _strncasecmp(response.str, ourResponse, response.size) != 0) break;
+        // (Some clients send the response's hex digits in upper case.)
+
+    // Finally, the nonce has to be the one that this connection already uses, or else (if we share nonces between
+    // connections) one that we created recently for this client:
+    if (fCurrentAuthenticator.nonce() != NULL && paramEquals(nonce, fCurrentAuthenticator.nonce())) {
+      success = True;
+    } else if (fOurRTSPServer.fAuthenticationNonceLifetime > 0
+	       && fOurRTSPServer.isOurAuthenticationNonce(nonce.str, nonce.size, fClientAddr, nonceIsStale)) {
+      // Use this nonce from now on (so we won't need to check it again):
+      char nonceStr[AUTHENTICATION_NONCE_SIZE+1];
+      memcpy(nonceStr, nonce.str, AUTHENTICATION_NONCE_SIZE);
+      nonceStr[AUTHENTICATION_NONCE_SIZE] = '\0';
+      fCurrentAuthenticator.setRealmAndNonce(authDB->realm(), nonceStr);
+      success = True;
+    }
   } while (0);
   
-  delete[] (char*)realm; delete[] (char*)nonce;
-  delete[] (char*)uri; delete[] (char*)response;
-  
   if (success) {
     // The user has been authenticated.
     // Now allow subclasses a chance to validate the user against the IP address and/or URL suffix.
-    if (!fOurRTSPServer.specialClientUserAccessCheck(fClientInputSocket, fClientAddr, urlSuffix, username)) {
+    if (!fOurRTSPServer.specialClientUserAccessCheck(fClientInputSocket, fClientAddr, urlSuffix, usernameStr)) {
       // Note: We don't return a "WWW-Authenticate" header here, because the user is valid,
       // even though the server has decided that they should not have access.
       setRTSPResponse("401 Unauthorized");
-      delete[] (char*)username;
+      if (usernameStr != usernameBuf) delete[] usernameStr;
       return False;
     }
   }
-  delete[] (char*)username;
+  if (usernameStr != usernameBuf) delete[] usernameStr;
   if (success) return True;
   
   // If we get here, we failed to authenticate the user.
-  // Send back a "401 Unauthorized" response, with a new random nonce:
-  fCurrentAuthenticator.setRealmAndRandomNonce(authDB->realm());
-  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
-	   "RTSP/1.0 401 Unauthorized\r\n"
-	   "CSeq: %s\r\n"
-	   "%s"
-	   "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\"\r\n\r\n",
-	   fCurrentCSeq,
-	   dateHeader(),
-	   fCurrentAuthenticator.realm(), fCurrentAuthenticator.nonce());
+  // Send back a "401 Unauthorized" response, with a new nonce.  (If the request used a nonce that was correct
+  // except for being too old, then we also say that it was 'stale', so that the client can just try again.)
+  // If we support SHA-256, then we offer it first, and then MD5 (for older clients):
+  if (fOurRTSPServer.fAuthenticationNonceLifetime > 0) {
+    char nonceBuf[AUTHENTICATION_NONCE_SIZE+1];
+    fOurRTSPServer.createAuthenticationNonce(fClientAddr, nonceBuf);
+    fCurrentAuthenticator.setRealmAndNonce(authDB->realm(), nonceBuf);
+  } else {
+    fCurrentAuthenticator.setRealmAndRandomNonce(authDB->realm());
+  }
+  char const* staleStr = nonceIsStale ? ", stale=TRUE" : "";
+  char* const responseBuffer = (char*)fResponseBuffer; // alias, for brevity
+  unsigned responseSize = snprintf(responseBuffer, sizeof fResponseBuffer,
+				   "RTSP/1.0 401 Unauthorized\r\n"
+				   "CSeq: %s\r\n"
+				   "%s",
+				   fCurrentCSeq,
+				   dateHeader());
+  if (authDB->supportsSHA256() && responseSize < sizeof fResponseBuffer) {
+    responseSize += snprintf(&responseBuffer[responseSize], sizeof fResponseBuffer - responseSize,
+			     "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\", algorithm=SHA-256%s\r\n",
+			     fCurrentAuthenticator.realm(), fCurrentAuthenticator.nonce(), staleStr);
+  }
+  if (responseSize < sizeof fResponseBuffer) {
+    snprintf(&responseBuffer[responseSize], sizeof fResponseBuffer - responseSize,
+	     "WWW-Authenticate: Digest realm=\"%s\", nonce=\"%s\"%s\r\n\r\n",
+	     fCurrentAuthenticator.realm(), fCurrentAuthenticator.nonce(), staleStr);
+  }
   return False;
 }
 
@@ -1089,12 +1252,12 @@ void RTSPServer::RTSPClientConnection
   envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
 						incomingRequestHandler, this);
   
+  // Subsequent input (beginning with any extra data) is a new Base64-encoded stream:
+  fBase64Decoder.reset();
+
   // Also write any extra data to our buffer, and handle it:
   if (extraDataSize > 0 && extraDataSize <= fRequestBufferBytesLeft/*sanity check; should always be true*/) {
-    unsigned char* ptr = &fRequestBuffer[fRequestBytesAlreadySeen];
-    for (unsigned i = 0; i < extraDataSize; ++i) {
-      ptr[i] = extraData[i];
-    }
+    memmove(&fRequestBuffer[fRequestBytesAlreadySeen], extraData, extraDataSize);
     handleRequestBytes(extraDataSize);
   }
 }
@@ -1150,6 +1313,7 @@ typedef enum StreamingMode {
 
 static void parseTransportHeader(char const* buf,
 				 StreamingMode& streamingMode,
+				 char const*& rtpProfile, // "RTP/AVP" or "RTP/AVPF"; if RTP
 				 char*& streamingModeString,
 				 char*& destinationAddressStr,
 				 u_int8_t& destinationTTL,
@@ -1160,6 +1324,7 @@ static void parseTransportHeader(char const* buf,
 				 ) {
   // Initialize the result parameters to default values:
   streamingMode = RTP_UDP;
+  rtpProfile = "RTP/AVP";
   streamingModeString = NULL;
   destinationAddressStr = NULL;
   destinationTTL = 255;
@@ -1185,6 +1350,11 @@ static void parseTransportHeader(char const* buf,
   while (sscanf(fields, "%[^;\r\n]", field) == 1) {
     if (strcmp(field, "RTP/AVP/TCP") == 0) {
       streamingMode = RTP_TCP;
+    } else if (strcmp(field, "RTP/AVPF/TCP") == 0) {
+      streamingMode = RTP_TCP;
+      rtpProfile = "RTP/AVPF";
+    } else if (strcmp(field, "RTP/AVPF") == 0 || strcmp(field, "RTP/AVPF/UDP") == 0) {
+      rtpProfile = "RTP/AVPF"; // RTP (with RTCP feedback) over UDP
     } else if (strcmp(field, "RAW/RAW/UDP") == 0 ||
 	       strcmp(field, "MP2T/H2221/UDP") == 0) {
       streamingMode = RAW_UDP;
@@ -1325,12 +1495,13 @@ void RTSPServer::RTSPClientSession
 
     // Look for a "Transport:" header in the request string, to extract client parameters:
     StreamingMode streamingMode;
+    char const* rtpProfile; // echoed back in our response
     char* streamingModeString = NULL; // set when RAW_UDP streaming is specified
     char* clientsDestinationAddressStr;
     u_int8_t clientsDestinationTTL;
     portNumBits clientRTPPortNum, clientRTCPPortNum;
     unsigned char rtpChannelId, rtcpChannelId;
-    parseTransportHeader(fullRequestStr, streamingMode, streamingModeString,
+    parseTransportHeader(fullRequestStr, streamingMode, rtpProfile, streamingModeString,
 			 clientsDestinationAddressStr, clientsDestinationTTL,
 			 clientRTPPortNum, clientRTCPPortNum,
 			 rtpChannelId, rtcpChannelId);
@@ -1419,11 +1590,11 @@ void RTSPServer::RTSPClientSession
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
-		     "Transport: RTP/AVP;multicast;destination=%s;source=%s;port=%d-%d;ttl=%d\r\n"
+		     "Transport: %s;multicast;destination=%s;source=%s;port=%d-%d;ttl=%d\r\n"
 		     "Session: %08X%s\r\n\r\n",
 		     ourClientConnection->fCurrentCSeq,
 		     dateHeader(),
-		     destAddrStr.val(), sourceAddrStr.val(), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()), destinationTTL,
+		     rtpProfile, destAddrStr.val(), sourceAddrStr.val(), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()), destinationTTL,
 		     fOurSessionId, timeoutParameterString);
 	    break;
 	  }
@@ -1453,11 +1624,11 @@ void RTSPServer::RTSPClientSession
 		     "RTSP/1.0 200 OK\r\n"
 		     "CSeq: %s\r\n"
 		     "%s"
-		     "Transport: RTP/AVP;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d\r\n"
+		     "Transport: %s;unicast;destination=%s;source=%s;client_port=%d-%d;server_port=%d-%d\r\n"
 		     "Session: %08X%s\r\n\r\n",
 		     ourClientConnection->fCurrentCSeq,
 		     dateHeader(),
-		     destAddrStr.val(), sourceAddrStr.val(), ntohs(clientRTPPort.num()), ntohs(clientRTCPPort.num()), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()),
+		     rtpProfile, destAddrStr.val(), sourceAddrStr.val(), ntohs(clientRTPPort.num()), ntohs(clientRTCPPort.num()), ntohs(serverRTPPort.num()), ntohs(serverRTCPPort.num()),
 		     fOurSessionId, timeoutParameterString);
 	    break;
 	  }
@@ -1469,11 +1640,11 @@ void RTSPServer::RTSPClientSession
 		       "RTSP/1.0 200 OK\r\n"
 		       "CSeq: %s\r\n"
 		       "%s"
-		       "Transport: RTP/AVP/TCP;unicast;destination=%s;source=%s;interleaved=%d-%d\r\n"
+		       "Transport: %s/TCP;unicast;destination=%s;source=%s;interleaved=%d-%d\r\n"
 		       "Session: %08X%s\r\n\r\n",
 		       ourClientConnection->fCurrentCSeq,
 		       dateHeader(),
-		       destAddrStr.val(), sourceAddrStr.val(), rtpChannelId, rtcpChannelId,
+		       rtpProfile, destAddrStr.val(), sourceAddrStr.val(), rtpChannelId, rtcpChannelId,
 		       fOurSessionId, timeoutParameterString);
 	    }
 	    break;
@@ -1602,9 +1773,9 @@ void RTSPServer::RTSPClientSession
   
   // Try to set the stream's scale factor to this value:
   if (subsession == NULL /*aggregate op*/) {
-    fOurServerMediaSession->testScaleFactor(scale);
+    fOurServerMediaSession->testScaleFactorForClientSession(fOurSessionId, scale);
   } else {
-    subsession->testScaleFactor(scale);
+    subsession->testScaleFactorForClientSession(fOurSessionId, scale);
   }
   
   char buf[100];
@@ -26,6 +26,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 #include <time.h>
 
+#ifndef LIVE_HLS_IDLE_SECONDS
+#define LIVE_HLS_IDLE_SECONDS 30
+#endif
+    // A live session's segmenter is closed once it's been unused for this long
+
+#ifndef HTTP_KEEP_ALIVE_TIMEOUT_SECONDS
+#define HTTP_KEEP_ALIVE_TIMEOUT_SECONDS 30
+#endif
+    // A persistent HTTP connection is closed if no new request arrives on it within this time
+
 RTSPServerSupportingHTTPStreaming*
 RTSPServerSupportingHTTPStreaming::createNew(UsageEnvironment& env, Port rtspPort,
 					     UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds) {
@@ -38,10 +48,120 @@ RTSPServerSupportingHTTPStreaming::createNew(UsageEnvironment& env, Port rtspPor
 RTSPServerSupportingHTTPStreaming
 ::RTSPServerSupportingHTTPStreaming(UsageEnvironment& env, int ourSocket, Port rtspPort,
 				    UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds)
-  : RTSPServer(env, ourSocket, rtspPort, authDatabase, reclamationTestSeconds) {
+  : RTSPServer(env, ourSocket, rtspPort, authDatabase, reclamationTestSeconds),
+    fHLSSegmentCache(NULL), fLiveHLSIsEnabled(False),
+    fLiveHLSTargetDuration(0), fLiveHLSPartTargetDurationInMs(0), fLiveHLSNumSegmentsInPlaylist(0),
+    fLiveSegmenters(HashTable::create(STRING_HASH_KEYS)), fIdleLiveSegmenterCheckTask(NULL) {
 }
 
 RTSPServerSupportingHTTPStreaming::~RTSPServerSupportingHTTPStreaming() {
+  // Close our live segmenters now, because they use our "ServerMediaSession"s (which "RTSPServer"'s destructor deletes):
+  envir().taskScheduler().unscheduleDelayedTask(fIdleLiveSegmenterCheckTask);
+  HLSLiveSegmenter* segmenter;
+  while ((segmenter = (HLSLiveSegmenter*)fLiveSegmenters->RemoveNext()) != NULL) {
+    closeLiveSegmenter(segmenter);
+  }
+  delete fLiveSegmenters;
+
+  // Note that our client connections get deleted later (by "RTSPServer"'s destructor).  That's OK, because any cached
+  // segments that they're still using outlive the cache, and their "HLSSegmentCacheFiller"s don't use it when closed.
+  delete fHLSSegmentCache;
+}
+
+void RTSPServerSupportingHTTPStreaming
+::enableHLSSegmentCache(unsigned maxMemorySize, char const* diskCacheDirectoryName, u_int64_t maxDiskSize) {
+  if (fHLSSegmentCache != NULL) return; // already enabled
+
+  fHLSSegmentCache = new HLSSegmentCache(envir(), maxMemorySize, diskCacheDirectoryName, maxDiskSize);
+}
+
+void RTSPServerSupportingHTTPStreaming
+::enableLiveHLS(unsigned targetDuration, unsigned partTargetDurationInMs, unsigned numSegmentsInPlaylist) {
+  fLiveHLSIsEnabled = True;
+  fLiveHLSTargetDuration = targetDuration;
+  fLiveHLSPartTargetDurationInMs = partTargetDurationInMs;
+  fLiveHLSNumSegmentsInPlaylist = numSegmentsInPlaylist;
+}
+
+char* RTSPServerSupportingHTTPStreaming::listStreams(char const* /*prefix*/) const {
+  return NULL; // by default
+}
+
+HLSLiveSegmenter* RTSPServerSupportingHTTPStreaming::getLiveSegmenter(ServerMediaSession& session) {
+  if (!fLiveHLSIsEnabled) return NULL;
+
+  HLSLiveSegmenter* segmenter = (HLSLiveSegmenter*)(fLiveSegmenters->Lookup(session.streamName()));
+  if (segmenter != NULL) {
+    if (&segmenter->session() == &session) return segmenter;
+
+    // The stream name now refers to a different session, so replace the old session's segmenter:
+    closeLiveSegmenter(segmenter);
+  }
+
+  segmenter = HLSLiveSegmenter::createNew(envir(), session, fLiveHLSTargetDuration, fLiveHLSPartTargetDurationInMs,
+					  fLiveHLSNumSegmentsInPlaylist);
+  if (segmenter == NULL) return NULL;
+
+  // The segmenter is a client of the session, so the session mustn't get deleted while the segmenter exists:
+  session.incrementReferenceCount();
+  fLiveSegmenters->Add(session.streamName(), segmenter);
+
+  if (fIdleLiveSegmenterCheckTask == NULL) {
+    fIdleLiveSegmenterCheckTask
+      = envir().taskScheduler().scheduleDelayedTask(LIVE_HLS_IDLE_SECONDS*1000000, checkForIdleLiveSegmenters, this);
+  }
+  return segmenter;
+}
+
+void RTSPServerSupportingHTTPStreaming::closeAllClientSessionsForServerMediaSession(ServerMediaSession* serverMediaSession) {
+  if (serverMediaSession == NULL) return;
+
+  // The session's segmenter (if any) is one of its clients.  (It also uses the session's subsessions, which - e.g., for a
+  // "ProxyServerMediaSession" - might be about to get deleted.)
+  HLSLiveSegmenter* segmenter = (HLSLiveSegmenter*)(fLiveSegmenters->Lookup(serverMediaSession->streamName()));
+  if (segmenter != NULL && &segmenter->session() == serverMediaSession) closeLiveSegmenter(segmenter);
+
+  RTSPServer::closeAllClientSessionsForServerMediaSession(serverMediaSession);
+}
+
+void RTSPServerSupportingHTTPStreaming::closeLiveSegmenter(HLSLiveSegmenter* segmenter) {
+  ServerMediaSession& session = segmenter->session();
+  if (fLiveSegmenters->Lookup(session.streamName()) == segmenter) fLiveSegmenters->Remove(session.streamName());
+  Medium::close(segmenter);
+
+  session.decrementReferenceCount();
+  if (session.referenceCount() == 0 && session.deleteWhenUnreferenced()) {
+    removeServerMediaSession(&session);
+  }
+}
+
+void RTSPServerSupportingHTTPStreaming::checkForIdleLiveSegmenters(void* clientData) {
+  RTSPServerSupportingHTTPStreaming* server = (RTSPServerSupportingHTTPStreaming*)clientData;
+  server->checkForIdleLiveSegmenters();
+}
+
+void RTSPServerSupportingHTTPStreaming::checkForIdleLiveSegmenters() {
+  fIdleLiveSegmenterCheckTask = NULL;
+
+  // Close each segmenter that's no longer being used.  (We find these one at a time, because closing a segmenter changes
+  // the hash table.)
+  while (1) {
+    HashTable::Iterator* iter = HashTable::Iterator::create(*fLiveSegmenters);
+    HLSLiveSegmenter* segmenter;
+    char const* key; // dummy
+    while ((segmenter = (HLSLiveSegmenter*)(iter->next(key))) != NULL) {
+      if (segmenter->isIdle(LIVE_HLS_IDLE_SECONDS)) break;
+    }
+    delete iter;
+
+    if (segmenter == NULL) break;
+    closeLiveSegmenter(segmenter);
+  }
+
+  if (!fLiveSegmenters->IsEmpty()) {
+    fIdleLiveSegmenterCheckTask
+      = envir().taskScheduler().scheduleDelayedTask(LIVE_HLS_IDLE_SECONDS*1000000, checkForIdleLiveSegmenters, this);
+  }
 }
 
 GenericMediaServer::ClientConnection*
@@ -52,13 +172,130 @@ RTSPServerSupportingHTTPStreaming::createNewClientConnection(int clientSocket, s
 RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
 ::RTSPClientConnectionSupportingHTTPStreaming(RTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
   : RTSPClientConnection(ourServer, clientSocket, clientAddr),
-    fClientSessionId(0), fStreamSource(NULL), fPlaylistSource(NULL), fTCPSink(NULL) {
+    fClientSessionId(0), fStreamSource(NULL), fCachedSegment(NULL), fPlaylistSource(NULL), fTCPSink(NULL),
+    fFileSender(NULL), fIsSendingResponse(False), fKeepAlive(True), fNumBodyBytes(0), fIsSendingFromFile(False),
+    fHaveRange(False), fRangeFirstByte(0), fRangeLastByte(0), fRangeSuffixLength(0), fIdleTimeoutTask(NULL),
+    fLiveSegmenter(NULL), fLivePlaylistStreamName(NULL),
+    fLiveWaitMediaSequenceNumber(0), fLiveWaitPartNumber(-1), fLiveWaitTimeoutTask(NULL) {
 }
 
 RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::~RTSPClientConnectionSupportingHTTPStreaming() {
   Medium::close(fPlaylistSource);
   Medium::close(fStreamSource);
   Medium::close(fTCPSink);
+  Medium::close(fFileSender);
+  releaseCachedSegment();
+  stopWaitingForLivePlaylist();
+  delete[] fLivePlaylistStreamName;
+  envir().taskScheduler().unscheduleDelayedTask(fIdleTimeoutTask);
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::releaseCachedSegment() {
+  if (fCachedSegment != NULL) {
+    fCachedSegment->unref();
+    fCachedSegment = NULL;
+  }
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::handleRequestBytes(int newBytesRead) {
+  envir().taskScheduler().unscheduleDelayedTask(fIdleTimeoutTask); // the connection is no longer idle
+
+  if (fIsSendingResponse && newBytesRead >= 0 && (unsigned)newBytesRead < fRequestBufferBytesLeft) {
+    // We're still sending the response to an earlier request, so just queue these new bytes (a following, pipelined
+    // request) in our buffer.  We'll handle them once the response has been sent (in "afterStreaming()"):
+    stopRequestTimer(); // (we don't limit how long the client takes to send this request, because we're not waiting for it)
+    fRequestBytesAlreadySeen += newBytesRead;
+    fRequestBufferBytesLeft -= newBytesRead;
+    return;
+  }
+
+  RTSPClientConnection::handleRequestBytes(newBytesRead);
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::handleHTTPCmd_notSupported() {
+  setHTTPErrorResponse("405 Method Not Allowed");
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::handleHTTPCmd_notFound() {
+  setHTTPErrorResponse("404 Not Found");
+}
+
+Boolean RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::isReadyForNextRequest() {
+  return !fIsSendingResponse;
+}
+
+static char const* lookForHTTPHeader(char const* headerName, char const* fullRequestStr) {
+  // Returns the value of the named header, if it's present in the request (whose header lines end with an empty line):
+  unsigned const headerNameLen = strlen(headerName);
+  char const* line = strstr(fullRequestStr, "\r\n"); // skip over the request line
+  while (line != NULL && line[2] != '\r' && line[2] != '\0') {
+    line += 2;
+    if (_strncasecmp(line, headerName, headerNameLen) == 0 && line[headerNameLen] == ':') {
+      char const* value = &line[headerNameLen+1];
+      while (*value == ' ' || *value == '\t') ++value;
+      return value;
+    }
+    line = strstr(line, "\r\n");
+  }
+
+  return NULL;
+}
+
+static Boolean requestWantsPersistentConnection(char const* fullRequestStr) {
+  // HTTP/1.1 connections are persistent unless the client asks otherwise; HTTP/1.0 connections only if the client asks:
+  char const* connectionStr = lookForHTTPHeader("Connection", fullRequestStr);
+  if (connectionStr != NULL) {
+    if (_strncasecmp(connectionStr, "close", 5) == 0) return False;
+    if (_strncasecmp(connectionStr, "keep-alive", 10) == 0) return True;
+  }
+
+  char const* requestLineEnd = strstr(fullRequestStr, "\r\n");
+  char const* versionStr = strstr(fullRequestStr, "HTTP/1.0");
+  return versionStr == NULL || (requestLineEnd != NULL && versionStr > requestLineEnd);
+}
+
+static Boolean parseHTTPRangeHeader(char const* fullRequestStr,
+				    unsigned& firstByte, unsigned& lastByte, unsigned& suffixLength) {
+  char const* rangeStr = lookForHTTPHeader("Range", fullRequestStr);
+  if (rangeStr == NULL || _strncasecmp(rangeStr, "bytes=", 6) != 0) return False;
+  rangeStr += 6;
+
+  // We handle only a single range.  (If several are requested, we just send the whole segment instead.)
+  char const* rangeStrEnd = strstr(rangeStr, "\r\n");
+  char const* commaPos = strchr(rangeStr, ',');
+  if (commaPos != NULL && (rangeStrEnd == NULL || commaPos < rangeStrEnd)) return False;
+
+  if (rangeStr[0] == '-') { // "-<suffix-length>"
+    firstByte = ~0;
+    return sscanf(rangeStr, "-%u", &suffixLength) == 1;
+  }
+  int numValues = sscanf(rangeStr, "%u-%u", &firstByte, &lastByte);
+  if (numValues == 1) { // "<first>-"
+    lastByte = ~0;
+    return True;
+  }
+  return numValues == 2 && lastByte >= firstByte;
+}
+
+static char* urlPathFromRequest(char const* fullRequestStr) {
+  // Returns (in a "new[]"d string) the path of the URL in the request line "<cmd> <url> HTTP/...", without its leading '/'
+  // (and without any "http://<host>" prefix, or query string):
+  char const* p = fullRequestStr;
+  while (*p != '\0' && *p != ' ') ++p; // skip over the command name
+  while (*p == ' ') ++p;
+  if (_strncasecmp(p, "http://", 7) == 0) {
+    p += 7;
+    while (*p != '\0' && *p != '/' && *p != ' ') ++p; // skip over the host (and port)
+  }
+  if (*p == '/') ++p;
+
+  char const* end = p;
+  while (*end != '\0' && *end != ' ' && *end != '?' && *end != '\r' && *end != '\n') ++end;
+
+  char* result = new char[end - p + 1];
+  memmove(result, p, end - p);
+  result[end - p] = '\0';
+  return result;
 }
 
 static char const* lastModifiedHeader(char const* fileName) {
@@ -77,7 +314,28 @@ static char const* lastModifiedHeader(char const* fileName) {
 }
 
 void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
-::handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* /*fullRequestStr*/) {
+::handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr) {
+  // Note whether the connection should stay open after this request (so that the client can use it for subsequent
+  // requests), and whether only a byte range of a segment is being requested:
+  fKeepAlive = requestWantsPersistentConnection(fullRequestStr);
+  fHaveRange = parseHTTPRangeHeader(fullRequestStr, fRangeFirstByte, fRangeLastByte, fRangeSuffixLength);
+
+  // If the URL names a directory (i.e., ends with '/'), then send a list of the streams in it (if our server supports this):
+  if (urlSuffix[0] == '\0') {
+    char* directoryName = urlPathFromRequest(fullRequestStr);
+    char* listing = ((RTSPServerSupportingHTTPStreaming&)fOurServer).listStreams(directoryName);
+    delete[] directoryName;
+    if (listing == NULL) {
+      handleHTTPCmd_notFound();
+      return;
+    }
+
+    unsigned listingLen = strlen(listing);
+    sendOKResponseHeader("text/plain", listingLen, "");
+    streamPlaylist(listing, listingLen);
+    return;
+  }
+
   // If "urlSuffix" ends with "?segment=<offset-in-seconds>,<duration-in-seconds>", then strip this off, and send the
   // specified segment.  Otherwise, construct and send a playlist that consists of segments from the specified file.
   do {
@@ -106,21 +364,47 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
 	break;
       }
 
-      // Call "getStreamParameters()" to create the stream's source.  (Because we're not actually streaming via RTP/RTCP, most
-      // of the parameters to the call are dummy.)
-      ++fClientSessionId;
-      Port clientRTPPort(0), clientRTCPPort(0), serverRTPPort(0), serverRTCPPort(0);
-      netAddressBits destinationAddress = 0;
-      u_int8_t destinationTTL = 0;
-      Boolean isMulticast = False;
-      void* streamToken;
-      subsession->getStreamParameters(fClientSessionId, 0, clientRTPPort,clientRTCPPort, -1,0,0, destinationAddress,destinationTTL, isMulticast, serverRTPPort,serverRTCPPort, streamToken);
-      
-      // Seek the stream source to the desired place, with the desired duration, and (as a side effect) get the number of bytes:
-      double dOffsetInSeconds = (double)offsetInSeconds;
-      u_int64_t numBytes;
-      subsession->seekStream(fClientSessionId, streamToken, dOffsetInSeconds, (double)durationInSeconds, numBytes);
-      unsigned numTSBytesToStream = (unsigned)numBytes;
+      void* streamToken = NULL;
+      unsigned numTSBytesToStream;
+      u_int64_t startByte, numBytes;
+      HLSSegmentCache* cache = NULL;
+      time_t modificationTime = 0;
+      HLSCachedSegment* cachedSegment = NULL;
+      char const* fileName = subsession->getFileByteRange((double)offsetInSeconds, (double)durationInSeconds,
+							  startByte, numBytes);
+      if (fileName != NULL) {
+	// The segment is a range of bytes from a file, so we can send it directly from the file, without creating a source.
+	// (The OS's file cache keeps popular segments in memory.)
+	numTSBytesToStream = (unsigned)numBytes;
+      } else {
+	// If the segment is in our server's cache - either in memory, or in a file (which we send like any other file) -
+	// then we don't need to create (and seek) a source for it:
+	cache = ((RTSPServerSupportingHTTPStreaming&)fOurServer).hlsSegmentCache();
+	if (cache != NULL && !HLSSegmentCache::getModificationTime(streamName, modificationTime)) {
+	  cache = NULL; // the stream isn't a file, so we don't cache it
+	}
+	if (cache != NULL) {
+	  cachedSegment = cache->lookup(streamName, offsetInSeconds, durationInSeconds, modificationTime,
+					fileName, numTSBytesToStream);
+	  if (cachedSegment != NULL) numTSBytesToStream = cachedSegment->size();
+	  startByte = 0;
+	}
+      }
+      if (fileName == NULL && cachedSegment == NULL) {
+	// Call "getStreamParameters()" to create the stream's source.  (Because we're not actually streaming via RTP/RTCP, most
+	// of the parameters to the call are dummy.)
+	++fClientSessionId;
+	Port clientRTPPort(0), clientRTCPPort(0), serverRTPPort(0), serverRTCPPort(0);
+	netAddressBits destinationAddress = 0;
+	u_int8_t destinationTTL = 0;
+	Boolean isMulticast = False;
+	subsession->getStreamParameters(fClientSessionId, 0, clientRTPPort,clientRTCPPort, -1,0,0, destinationAddress,destinationTTL, isMulticast, serverRTPPort,serverRTCPPort, streamToken);
+
+	// Seek the stream source to the desired place, with the desired duration, and (as a side effect) get the number of bytes:
+	double dOffsetInSeconds = (double)offsetInSeconds;
+	subsession->seekStream(fClientSessionId, streamToken, dOffsetInSeconds, (double)durationInSeconds, numBytes);
+	numTSBytesToStream = (unsigned)numBytes;
+      }
       
       if (numTSBytesToStream == 0) {
 	// For some reason, we do not know the size of the requested range.  We can't handle this request:
@@ -128,32 +412,57 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
 	break;
       }
       
-      // Construct our response:
-      snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
-	       "HTTP/1.1 200 OK\r\n"
-	       "%s"
-	       "Server: LIVE555 Streaming Media v%s\r\n"
-	       "%s"
-	       "Content-Length: %d\r\n"
-	       "Content-Type: text/plain; charset=ISO-8859-1\r\n"
-	       "\r\n",
-	       dateHeader(),
-	       LIVEMEDIA_LIBRARY_VERSION_STRING,
-	       lastModifiedHeader(streamName),
-	       numTSBytesToStream);
-      // Send the response now, because we're about to add more data (from the source):
-      send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
-      fResponseBuffer[0] = '\0'; // We've already sent the response.  This tells the calling code not to send it again.
+      // Send our response header now, because we're about to add more data (from the source).  If the segment is
+      // a range of bytes from a file (or is cached), then we can also send just part of it, if that's requested:
+      char const* contentType = "text/plain; charset=ISO-8859-1";
+      unsigned startOffset = 0, numBytesToSend = numTSBytesToStream;
+      if (fileName != NULL || cachedSegment != NULL) {
+	if (!sendSegmentResponseHeader(contentType, numTSBytesToStream, lastModifiedHeader(streamName),
+				       startOffset, numBytesToSend)) {
+	  if (cachedSegment != NULL) cachedSegment->unref();
+	  break;
+	}
+      } else {
+	sendOKResponseHeader(contentType, numTSBytesToStream, lastModifiedHeader(streamName));
+      }
       
       // Ask the media source to deliver - to the TCP sink - the desired data:
       if (fStreamSource != NULL) { // sanity check
 	if (fTCPSink != NULL) fTCPSink->stopPlaying();
 	Medium::close(fStreamSource);
       }
-      fStreamSource = subsession->getStreamSource(streamToken);
+      releaseCachedSegment();
+      if (fFileSender != NULL) fFileSender->stopSending();
+      if (fileName != NULL) {
+	if (fFileSender == NULL) fFileSender = TCPFileRangeSender::createNew(envir(), fClientOutputSocket);
+	fIsSendingResponse = True;
+	fNumBodyBytes = numBytesToSend;
+	fIsSendingFromFile = True;
+	if (!fFileSender->startSending(fileName, startByte + startOffset, numBytesToSend, afterStreaming, this)) {
+	  // We've already sent the response header, so all we can do now is close the connection:
+	  fKeepAlive = False;
+	  afterStreaming(this);
+	}
+	break;
+      } else if (cachedSegment != NULL) {
+	fStreamSource = ByteStreamMemoryBufferSource::createNew(envir(), &cachedSegment->data()[startOffset], numBytesToSend,
+								False);
+	fCachedSegment = cachedSegment; // we'll "unref()" it when we've finished with it
+      } else {
+	fStreamSource = subsession->getStreamSource(streamToken);
+	if (fStreamSource != NULL && cache != NULL) {
+	  // Also copy the data that we send into the cache, for the next request for this segment:
+	  fStreamSource = HLSSegmentCacheFiller::createNew(envir(), fStreamSource, *cache, streamName,
+							   offsetInSeconds, durationInSeconds, modificationTime,
+							   numTSBytesToStream);
+	}
+      }
       if (fStreamSource != NULL) {
-	if (fTCPSink == NULL) fTCPSink = TCPStreamSink::createNew(envir(), fClientOutputSocket);
-	fTCPSink->startPlaying(*fStreamSource, afterStreaming, this);
+	streamFrom(fStreamSource, numBytesToSend);
+      } else {
+	// We've already sent the response header, so all we can do now is close the connection:
+	fKeepAlive = False;
+	fIsActive = False;
       }
     } while(0);
 
@@ -162,6 +471,25 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
   } while (0);
 
   // "urlSuffix" does not end with "?segment=<offset-in-seconds>,<duration-in-seconds>".
+
+  // If it names a live session (i.e., one with no known duration), and we support live HLS, then the session's segmenter
+  // provides the playlist (and the segments).  In this case, "urlSuffix" may also end with a query string:
+  {
+    char* streamName = strDup(urlSuffix);
+    char* query = strchr(streamName, '?');
+    if (query != NULL) *query++ = '\0';
+
+    HLSLiveSegmenter* segmenter = NULL;
+    ServerMediaSession* session = fOurServer.lookupServerMediaSession(streamName);
+    if (session != NULL && session->duration() <= 0.0) {
+      segmenter = ((RTSPServerSupportingHTTPStreaming&)fOurServer).getLiveSegmenter(*session);
+      if (segmenter != NULL) handleLiveHLSRequest(*segmenter, streamName, query);
+    }
+
+    delete[] streamName;
+    if (segmenter != NULL) return;
+  }
+
   // Construct and send a playlist that describes segments from the specified file.
 
   // First, make sure that the named file exists, and is streamable:
@@ -225,44 +553,306 @@ void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStream
   s += strlen(s);
   unsigned playlistLen = s - playlist;
 
-  // Construct our response:
+  // Send our response header now, because we're about to add more data (the playlist):
+  sendOKResponseHeader("application/vnd.apple.mpegurl", playlistLen, lastModifiedHeader(urlSuffix));
+  streamPlaylist(playlist, playlistLen);
+}
+
+static char const* connectionHeader(Boolean keepAlive) {
+  // (We don't need a "Connection:" header for a persistent connection, unless the client used HTTP/1.0 - but it's harmless.)
+  return keepAlive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::setHTTPErrorResponse(char const* status, char const* extraHeaders) {
   snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
-	   "HTTP/1.1 200 OK\r\n"
+	   "HTTP/1.1 %s\r\n"
+	   "%s"
+	   "%s"
+	   "%s"
+	   "Content-Length: 0\r\n"
+	   "\r\n",
+	   status,
+	   dateHeader(),
+	   connectionHeader(fKeepAlive),
+	   extraHeaders);
+
+  if (fKeepAlive) {
+    // Wait for the next request:
+    envir().taskScheduler().rescheduleDelayedTask(fIdleTimeoutTask, HTTP_KEEP_ALIVE_TIMEOUT_SECONDS*1000000,
+						  idleTimeoutHandler, this);
+  } else {
+    fIsActive = False; // causes the connection to get closed after the response has been sent
+  }
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::sendResponseHeader(char const* status, char const* contentType, unsigned contentLength, char const* extraHeaders) {
+  snprintf((char*)fResponseBuffer, sizeof fResponseBuffer,
+	   "HTTP/1.1 %s\r\n"
 	   "%s"
 	   "Server: LIVE555 Streaming Media v%s\r\n"
 	   "%s"
+	   "%s"
 	   "Content-Length: %d\r\n"
-	   "Content-Type: application/vnd.apple.mpegurl\r\n"
+	   "Content-Type: %s\r\n"
 	   "\r\n",
+	   status,
 	   dateHeader(),
 	   LIVEMEDIA_LIBRARY_VERSION_STRING,
-	   lastModifiedHeader(urlSuffix),
-	   playlistLen);
+	   connectionHeader(fKeepAlive),
+	   extraHeaders,
+	   contentLength,
+	   contentType);
 
-  // Send the response header now, because we're about to add more data (the playlist):
   send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
   fResponseBuffer[0] = '\0'; // We've already sent the response.  This tells the calling code not to send it again.
+}
+
+Boolean RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::sendSegmentResponseHeader(char const* contentType, unsigned segmentSize, char const* extraHeaders,
+			    unsigned& startOffset, unsigned& numBytes) {
+  char headers[300];
+
+  startOffset = 0;
+  numBytes = segmentSize;
+  if (!fHaveRange) {
+    snprintf(headers, sizeof headers, "Accept-Ranges: bytes\r\n%s", extraHeaders);
+    sendOKResponseHeader(contentType, segmentSize, headers);
+    return True;
+  }
+
+  // Figure out the requested range (clipped to the segment):
+  unsigned lastByte;
+  if (fRangeFirstByte == ~0U) { // "-<suffix-length>"
+    if (fRangeSuffixLength == 0) {
+      startOffset = segmentSize; // unsatisfiable
+    } else {
+      startOffset = fRangeSuffixLength < segmentSize ? segmentSize - fRangeSuffixLength : 0;
+    }
+    lastByte = segmentSize - 1;
+  } else {
+    startOffset = fRangeFirstByte;
+    lastByte = fRangeLastByte < segmentSize ? fRangeLastByte : segmentSize - 1;
+  }
+  if (startOffset >= segmentSize) {
+    snprintf(headers, sizeof headers, "Content-Range: bytes */%u\r\n", segmentSize);
+    setHTTPErrorResponse("416 Range Not Satisfiable", headers);
+    return False;
+  }
+  numBytes = lastByte - startOffset + 1;
+
+  snprintf(headers, sizeof headers, "Accept-Ranges: bytes\r\nContent-Range: bytes %u-%u/%u\r\n%s",
+	   startOffset, lastByte, segmentSize, extraHeaders);
+  sendResponseHeader("206 Partial Content", contentType, numBytes, headers);
+  return True;
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::streamFrom(FramedSource* source, unsigned numBodyBytes) {
+  // Note: "afterStreaming()" might get called before "startPlaying()" returns, so we set "fIsSendingResponse" first:
+  fIsSendingResponse = True;
+  fNumBodyBytes = numBodyBytes;
+  fIsSendingFromFile = False;
+  if (fTCPSink == NULL) fTCPSink = TCPStreamSink::createNew(envir(), fClientOutputSocket);
+  fTCPSink->startPlaying(*source, afterStreaming, this);
+}
 
-  // Then, send the playlist.  Because it's large, we don't do so using "send()", because that might not send it all at once.
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::streamPlaylist(char* playlist, unsigned playlistLen) {
+  // Send the playlist.  Because it's large, we don't do so using "send()", because that might not send it all at once.
   // Instead, we stream the playlist over the TCP socket:
   if (fPlaylistSource != NULL) { // sanity check
     if (fTCPSink != NULL) fTCPSink->stopPlaying();
     Medium::close(fPlaylistSource);
   }
   fPlaylistSource = ByteStreamMemoryBufferSource::createNew(envir(), (u_int8_t*)playlist, playlistLen);
-  if (fTCPSink == NULL) fTCPSink = TCPStreamSink::createNew(envir(), fClientOutputSocket);
-  fTCPSink->startPlaying(*fPlaylistSource, afterStreaming, this);
+  streamFrom(fPlaylistSource, playlistLen);
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::handleLiveHLSRequest(HLSLiveSegmenter& segmenter, char const* streamName, char const* query) {
+  segmenter.noteActivity();
+
+  // If "query" is "seq=<media-sequence-number>" or "seq=<media-sequence-number>.<part-number>", then send the specified
+  // segment (or partial segment):
+  unsigned mediaSequenceNumber, partNumber;
+  int numValues = query == NULL ? 0 : sscanf(query, "seq=%u.%u", &mediaSequenceNumber, &partNumber);
+  if (numValues >= 1) {
+    HLSCachedSegment* segment = segmenter.lookupSegment(mediaSequenceNumber, numValues == 2 ? (int)partNumber : -1);
+    if (segment == NULL) {
+      handleHTTPCmd_notFound();
+      return;
+    }
+
+    unsigned startOffset, numBytesToSend;
+    if (!sendSegmentResponseHeader("video/MP2T", segment->size(), "", startOffset, numBytesToSend)) {
+      segment->unref();
+      return;
+    }
+    if (fStreamSource != NULL) { // sanity check
+      if (fTCPSink != NULL) fTCPSink->stopPlaying();
+      Medium::close(fStreamSource);
+    }
+    releaseCachedSegment();
+    fStreamSource = ByteStreamMemoryBufferSource::createNew(envir(), &segment->data()[startOffset], numBytesToSend, False);
+    fCachedSegment = segment; // we'll "unref()" it when we've finished with it
+    streamFrom(fStreamSource, numBytesToSend);
+    return;
+  }
+
+  // Otherwise, send the playlist - but if the query is "_HLS_msn=<M>[&_HLS_part=<P>]" (a 'blocking playlist reload'
+  // request), not until it contains the specified segment (or partial segment).  (If no segment is available yet, we
+  // also wait - until the first one is.)
+  fLiveWaitMediaSequenceNumber = 0;
+  fLiveWaitPartNumber = -1;
+  char const* msnStr = query == NULL ? NULL : strstr(query, "_HLS_msn=");
+  if (msnStr != NULL && sscanf(msnStr, "_HLS_msn=%u", &fLiveWaitMediaSequenceNumber) == 1) {
+    char const* partStr = strstr(query, "_HLS_part=");
+    if (partStr != NULL && sscanf(partStr, "_HLS_part=%u", &partNumber) == 1) fLiveWaitPartNumber = (int)partNumber;
+
+    if (segmenter.isTooFarAhead(fLiveWaitMediaSequenceNumber)) {
+      setHTTPErrorResponse("400 Bad Request");
+      return;
+    }
+  }
+
+  delete[] fLivePlaylistStreamName;
+  fLivePlaylistStreamName = strDup(streamName);
+  if (segmenter.isInPlaylist(fLiveWaitMediaSequenceNumber, fLiveWaitPartNumber)) {
+    sendLivePlaylist(segmenter);
+    return;
+  }
+
+  // Wait (but not for too long):
+  stopWaitingForLivePlaylist(); // sanity check
+  fLiveSegmenter = &segmenter;
+  segmenter.addWaiter(livePlaylistMayHaveChanged, this);
+  unsigned maxWaitSeconds = 3*segmenter.targetDuration();
+  if (msnStr == NULL) maxWaitSeconds += 10; // allow extra time for a new stream to start
+  fLiveWaitTimeoutTask
+    = envir().taskScheduler().scheduleDelayedTask(maxWaitSeconds*1000000, livePlaylistWaitTimedOut, this);
+  fIsSendingResponse = True; // so that any following requests wait until after our response
+  fResponseBuffer[0] = '\0'; // we'll respond later
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::sendLivePlaylist(HLSLiveSegmenter& segmenter) {
+  char* playlist = segmenter.generatePlaylist(fLivePlaylistStreamName);
+  if (playlist == NULL) { // sanity check; shouldn't happen
+    sendDeferredErrorResponse("503 Service Unavailable");
+    return;
+  }
+  unsigned playlistLen = strlen(playlist);
+
+  sendOKResponseHeader("application/vnd.apple.mpegurl", playlistLen, "Cache-Control: no-cache\r\n");
+  streamPlaylist(playlist, playlistLen);
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::sendDeferredErrorResponse(char const* status) {
+  // Send the response now (because we're no longer handling the request):
+  setHTTPErrorResponse(status);
+  send(fClientOutputSocket, (char const*)fResponseBuffer, strlen((char*)fResponseBuffer), 0);
+  fResponseBuffer[0] = '\0';
+
+  afterStreaming(this); // Note: This might delete us
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::stopWaitingForLivePlaylist() {
+  envir().taskScheduler().unscheduleDelayedTask(fLiveWaitTimeoutTask);
+  if (fLiveSegmenter != NULL) {
+    fLiveSegmenter->removeWaiter(this);
+    fLiveSegmenter = NULL;
+  }
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::livePlaylistMayHaveChanged(void* clientData) {
+  RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming* clientConnection
+    = (RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming*)clientData;
+  clientConnection->livePlaylistMayHaveChanged();
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::livePlaylistMayHaveChanged() {
+  HLSLiveSegmenter* segmenter = fLiveSegmenter;
+  if (segmenter == NULL) return; // sanity check
+
+  if (segmenter->isClosing()) {
+    stopWaitingForLivePlaylist();
+    sendDeferredErrorResponse("503 Service Unavailable");
+  } else if (segmenter->isInPlaylist(fLiveWaitMediaSequenceNumber, fLiveWaitPartNumber)) {
+    stopWaitingForLivePlaylist();
+    sendLivePlaylist(*segmenter);
+  } else {
+    segmenter->addWaiter(livePlaylistMayHaveChanged, this); // keep waiting
+  }
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming
+::livePlaylistWaitTimedOut(void* clientData) {
+  RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming* clientConnection
+    = (RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming*)clientData;
+  clientConnection->livePlaylistWaitTimedOut();
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::livePlaylistWaitTimedOut() {
+  fLiveWaitTimeoutTask = NULL;
+  stopWaitingForLivePlaylist();
+  sendDeferredErrorResponse("503 Service Unavailable");
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::idleTimeoutHandler(void* clientData) {
+  RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming* clientConnection
+    = (RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming*)clientData;
+  clientConnection->fIdleTimeoutTask = NULL;
+
+  // No new request has arrived on this persistent connection for a while, so close it:
+  if (!clientConnection->fIsSendingResponse/*sanity check*/) delete clientConnection;
 }
 
 void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::afterStreaming(void* clientData) {
-   RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming* clientConnection
+  RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming* clientConnection
     = (RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming*)clientData;
-   // Arrange to delete the 'client connection' object:
-   if (clientConnection->fRecursionCount > 0) {
-     // We're still in the midst of handling a request
-     clientConnection->fIsActive = False; // will cause the object to get deleted at the end of handling the request
-   } else {
-     // We're no longer handling a request; delete the object now:
-     delete clientConnection;
-   }
+  clientConnection->afterStreaming();
+}
+
+void RTSPServerSupportingHTTPStreaming::RTSPClientConnectionSupportingHTTPStreaming::afterStreaming() {
+  if (fIsSendingResponse && fNumBodyBytes > 0) {
+    // We've finished sending a response body.  If it wasn't the size that we said it was (e.g., because the file ended
+    // early, or the source closed early), then the client can no longer tell where our next response would begin, so we
+    // must close the connection:
+    u_int64_t numBytesSent = fIsSendingFromFile
+      ? (fFileSender == NULL ? 0 : fFileSender->numBytesSent())
+      : (fTCPSink == NULL ? 0 : fTCPSink->numBytesWritten());
+    if (numBytesSent != fNumBodyBytes) fKeepAlive = False;
+  }
+  fIsSendingResponse = False;
+  fNumBodyBytes = 0;
+
+  if (!fKeepAlive) {
+    // Arrange to delete the 'client connection' object:
+    if (fRecursionCount > 0) {
+      // We're still in the midst of handling a request
+      fIsActive = False; // will cause the object to get deleted at the end of handling the request
+    } else {
+      // We're no longer handling a request; delete the object now:
+      delete this;
+    }
+    return;
+  }
+
+  // Keep the connection open, for the client's next request.  (Because our TCP sink (or file sender) might have replaced
+  // our socket's handler while it waited for the socket to become writable, we also need to set the handler again.)
+  envir().taskScheduler().setBackgroundHandling(fClientInputSocket, SOCKET_READABLE|SOCKET_EXCEPTION,
+						incomingRequestHandler, this);
+  envir().taskScheduler().rescheduleDelayedTask(fIdleTimeoutTask, HTTP_KEEP_ALIVE_TIMEOUT_SECONDS*1000000,
+						idleTimeoutHandler, this);
+  if (fRecursionCount > 0) return; // we're still in the midst of handling a request; any following request gets handled next
+
+  // Handle any (pipelined) requests that we queued while we were sending the response:
+  unsigned numQueuedBytes = fRequestBytesAlreadySeen;
+  if (numQueuedBytes > 0) {
+    resetRequestBuffer();
+    handleRequestBytes(numQueuedBytes); // Note: This might delete us
+  }
 }
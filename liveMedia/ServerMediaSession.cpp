@@ -65,7 +65,10 @@ ServerMediaSession::ServerMediaSession(UsageEnvironment& env,
 				       Boolean isSSM, char const* miscSDPLines)
   : Medium(env), fIsSSM(isSSM), fSubsessionsHead(NULL),
     fSubsessionsTail(NULL), fSubsessionCounter(0),
-    fReferenceCount(0), fDeleteWhenUnreferenced(False) {
+    fHavePresetDuration(False), fPresetDuration(0.0),
+    fReferenceCount(0), fDeleteWhenUnreferenced(False),
+    fSDPDescription(NULL), fSDPDescriptionAddress(0), fIncompleteSDPDescription(NULL),
+    fSDPVersion(1), fSDPDescriptionChangeCount(0) {
   fStreamName = strDup(streamName == NULL ? "" : streamName);
 
   char* libNamePlusVersionStr = NULL; // by default
@@ -88,6 +91,8 @@ ServerMediaSession::~ServerMediaSession() {
   delete[] fInfoSDPString;
   delete[] fDescriptionSDPString;
   delete[] fMiscSDPLines;
+  delete[] fSDPDescription;
+  delete[] fIncompleteSDPDescription;
 }
 
 Boolean
@@ -103,10 +108,28 @@ ServerMediaSession::addSubsession(ServerMediaSubsession* subsession) {
 
   subsession->fParentSession = this;
   subsession->fTrackNumber = ++fSubsessionCounter;
+  noteSDPDescriptionChange();
   return True;
 }
 
+static void testSubsessionScaleFactor(ServerMediaSubsession* subsession, float& scale,
+				     Boolean forClientSession, unsigned clientSessionId) {
+  if (forClientSession) {
+    subsession->testScaleFactorForClientSession(clientSessionId, scale);
+  } else {
+    subsession->testScaleFactor(scale);
+  }
+}
+
 void ServerMediaSession::testScaleFactor(float& scale) {
+  testScaleFactor1(scale, False, 0);
+}
+
+void ServerMediaSession::testScaleFactorForClientSession(unsigned clientSessionId, float& scale) {
+  testScaleFactor1(scale, True, clientSessionId);
+}
+
+void ServerMediaSession::testScaleFactor1(float& scale, Boolean forClientSession, unsigned clientSessionId) {
   // First, try setting all subsessions to the desired scale.
   // If the subsessions' actual scales differ from each other, choose the
   // value that's closest to 1, and then try re-setting all subsessions to that
@@ -119,7 +142,7 @@ void ServerMediaSession::testScaleFactor(float& scale) {
   for (subsession = fSubsessionsHead; subsession != NULL;
        subsession = subsession->fNext) {
     float ssscale = scale;
-    subsession->testScaleFactor(ssscale);
+    testSubsessionScaleFactor(subsession, ssscale, forClientSession, clientSessionId);
     if (subsession == fSubsessionsHead) { // this is the first subsession
       minSSScale = maxSSScale = bestSSScale = ssscale;
       bestDistanceTo1 = (float)fabs(ssscale - 1.0f);
@@ -148,7 +171,7 @@ void ServerMediaSession::testScaleFactor(float& scale) {
   for (subsession = fSubsessionsHead; subsession != NULL;
        subsession = subsession->fNext) {
     float ssscale = bestSSScale;
-    subsession->testScaleFactor(ssscale);
+    testSubsessionScaleFactor(subsession, ssscale, forClientSession, clientSessionId);
     if (ssscale != bestSSScale) break; // no luck
   }
   if (subsession == NULL) {
@@ -161,12 +184,14 @@ void ServerMediaSession::testScaleFactor(float& scale) {
   for (subsession = fSubsessionsHead; subsession != NULL;
        subsession = subsession->fNext) {
     float ssscale = 1;
-    subsession->testScaleFactor(ssscale);
+    testSubsessionScaleFactor(subsession, ssscale, forClientSession, clientSessionId);
   }
   scale = 1;
 }
 
 float ServerMediaSession::duration() const {
+  if (fHavePresetDuration) return fPresetDuration;
+
   float minSubsessionDuration = 0.0;
   float maxSubsessionDuration = 0.0;
   for (ServerMediaSubsession* subsession = fSubsessionsHead; subsession != NULL;
@@ -194,6 +219,14 @@ float ServerMediaSession::duration() const {
   }
 }
 
+void ServerMediaSession::presetDuration(float duration) {
+  if (fHavePresetDuration && duration == fPresetDuration) return; // no change
+
+  fPresetDuration = duration;
+  fHavePresetDuration = True;
+  noteSDPDescriptionChange();
+}
+
 void ServerMediaSession::noteLiveness() {
   // default implementation: do nothing
 }
@@ -202,6 +235,8 @@ void ServerMediaSession::deleteAllSubsessions() {
   Medium::close(fSubsessionsHead);
   fSubsessionsHead = fSubsessionsTail = NULL;
   fSubsessionCounter = 0;
+  fHavePresetDuration = False;
+  noteSDPDescriptionChange();
 }
 
 Boolean ServerMediaSession::isServerMediaSession() const {
@@ -209,8 +244,54 @@ Boolean ServerMediaSession::isServerMediaSession() const {
 }
 
 char* ServerMediaSession::generateSDPDescription() {
-  AddressString ipAddressStr(ourIPAddress(envir()));
-  unsigned ipAddressStrSize = strlen(ipAddressStr.val());
+  return strDup(sdpDescription());
+}
+
+char const* ServerMediaSession::sdpDescription() {
+  // Our cached description can be reused unless our server address has changed:
+  netAddressBits const ipAddress = ourIPAddress(envir());
+  if (fSDPDescription != NULL) {
+    if (ipAddress == fSDPDescriptionAddress) return fSDPDescription;
+    noteSDPDescriptionChange(); // because the "o=" and "c=" lines will change
+  }
+
+  // Note that building the description may call us again, re-entrantly: A subsession's "sdpLines()" may have to run
+  // the event loop (to read its 'aux SDP line' from the media), and another client may ask for this description then.
+  unsigned const changeCount = fSDPDescriptionChangeCount;
+  AddressString ipAddressStr(ipAddress);
+  Boolean isComplete;
+  char* sdpDescription = buildSDPDescription(ipAddressStr.val(), isComplete);
+
+  if (fSDPDescription != NULL && ipAddress == fSDPDescriptionAddress) {
+    // A re-entrant call has already built - and cached - a complete description, so use that one instead of ours:
+    delete[] sdpDescription;
+    return fSDPDescription;
+  }
+
+  if (!isComplete || fSDPDescriptionChangeCount != changeCount) {
+    // Some subsession's SDP lines weren't available (or the session changed while we were building the description).
+    // Don't cache this description - and don't treat it as a new version - so that we'll try again next time.
+    // (We keep it only until then, because our caller must not free it.)
+    delete[] fIncompleteSDPDescription; fIncompleteSDPDescription = sdpDescription;
+    return sdpDescription;
+  }
+
+  fSDPDescription = sdpDescription;
+  fSDPDescriptionAddress = ipAddress;
+  return fSDPDescription;
+}
+
+void ServerMediaSession::noteSDPDescriptionChange() {
+  ++fSDPDescriptionChangeCount;
+  if (fSDPDescription == NULL) return; // we don't have a cached description
+
+  delete[] fSDPDescription; fSDPDescription = NULL;
+  ++fSDPVersion; // because our next description will differ from the one that clients may already have seen
+}
+
+char* ServerMediaSession::buildSDPDescription(char const* ipAddressStr, Boolean& isComplete) {
+  isComplete = True; // unless we find otherwise
+  unsigned ipAddressStrSize = strlen(ipAddressStr);
 
   // For a SSM sessions, we need a "a=source-filter: incl ..." line also:
   char* sourceFilterLine;
@@ -221,7 +302,7 @@ char* ServerMediaSession::generateSDPDescription() {
     unsigned const sourceFilterFmtSize = strlen(sourceFilterFmt) + ipAddressStrSize + 1;
 
     sourceFilterLine = new char[sourceFilterFmtSize];
-    sprintf(sourceFilterLine, sourceFilterFmt, ipAddressStr.val());
+    sprintf(sourceFilterLine, sourceFilterFmt, ipAddressStr);
   } else {
     sourceFilterLine = strDup("");
   }
@@ -238,7 +319,10 @@ char* ServerMediaSession::generateSDPDescription() {
     for (subsession = fSubsessionsHead; subsession != NULL;
 	 subsession = subsession->fNext) {
       char const* sdpLines = subsession->sdpLines();
-      if (sdpLines == NULL) continue; // the media's not available
+      if (sdpLines == NULL) { // the media's not available
+	isComplete = False;
+	continue;
+      }
       sdpLength += strlen(sdpLines);
     }
     if (sdpLength == 0) break; // the session has no usable subsessions
@@ -257,7 +341,7 @@ char* ServerMediaSession::generateSDPDescription() {
 
     char const* const sdpPrefixFmt =
       "v=0\r\n"
-      "o=- %ld%06ld %d IN IP4 %s\r\n"
+      "o=- %ld%06ld %u IN IP4 %s\r\n"
       "s=%s\r\n"
       "i=%s\r\n"
       "t=0 0\r\n"
@@ -286,8 +370,8 @@ char* ServerMediaSession::generateSDPDescription() {
     // Generate the SDP prefix (session-level lines):
     snprintf(sdp, sdpLength, sdpPrefixFmt,
 	     fCreationTime.tv_sec, fCreationTime.tv_usec, // o= <session id>
-	     1, // o= <version> // (needs to change if params are modified)
-	     ipAddressStr.val(), // o= <address>
+	     fSDPVersion, // o= <version> // (changes if params are modified)
+	     ipAddressStr, // o= <address>
 	     fDescriptionSDPString, // s= <description>
 	     fInfoSDPString, // i= <info>
 	     libNameStr, libVersionStr, // a=tool:
@@ -396,6 +480,11 @@ FramedSource* ServerMediaSubsession::getStreamSource(void* /*streamToken*/) {
   // default implementation: return NULL
   return NULL;
 }
+Boolean ServerMediaSubsession::getReceiverSSRC(unsigned /*clientSessionId*/, void* /*streamToken*/,
+					       u_int32_t& /*ssrc*/) {
+  // default implementation: the client's SSRC is not known
+  return False;
+}
 void ServerMediaSubsession::deleteStream(unsigned /*clientSessionId*/,
 					 void*& /*streamToken*/) {
   // default implementation: do nothing
@@ -406,6 +495,11 @@ void ServerMediaSubsession::testScaleFactor(float& scale) {
   scale = 1;
 }
 
+void ServerMediaSubsession::testScaleFactorForClientSession(unsigned /*clientSessionId*/, float& scale) {
+  // default implementation: The client session doesn't matter
+  testScaleFactor(scale);
+}
+
 float ServerMediaSubsession::duration() const {
   // default implementation: assume an unbounded session:
   return 0.0;
@@ -416,10 +510,22 @@ void ServerMediaSubsession::getAbsoluteTimeRange(char*& absStartTime, char*& abs
   absStartTime = absEndTime = NULL;
 }
 
+char const* ServerMediaSubsession::getFileByteRange(double /*seekNPT*/, double /*streamDuration*/,
+						    u_int64_t& startByte, u_int64_t& numBytes) {
+  // default implementation: Our data is not (known to be) a range of bytes from a file:
+  startByte = numBytes = 0;
+  return NULL;
+}
+
 void ServerMediaSubsession::setServerAddressAndPortForSDP(netAddressBits addressBits,
 							  portNumBits portBits) {
   fServerAddressForSDP = addressBits;
   fPortNumForSDP = portBits;
+  noteSDPLinesChange();
+}
+
+void ServerMediaSubsession::noteSDPLinesChange() {
+  if (fParentSession != NULL) fParentSession->noteSDPDescriptionChange();
 }
 
 char const*
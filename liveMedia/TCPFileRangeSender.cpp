@@ -0,0 +1,128 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An object that sends a range of bytes from a file over a TCP output stream
+// Implementation
+
+#include "TCPFileRangeSender.hh"
+#include "InputFile.hh"
+#include <GroupsockHelper.hh> // for "ignoreSigPipeOnSocket()"
+#ifdef USE_SENDFILE
+#include <sys/sendfile.h>
+#endif
+
+TCPFileRangeSender* TCPFileRangeSender::createNew(UsageEnvironment& env, int socketNum) {
+  return new TCPFileRangeSender(env, socketNum);
+}
+
+TCPFileRangeSender::TCPFileRangeSender(UsageEnvironment& env, int socketNum)
+  : Medium(env),
+    fOutputSocketNum(socketNum), fFid(NULL), fNextByte(0), fNumBytesRemaining(0), fNumBytesSent(0),
+    fAfterFunc(NULL), fAfterClientData(NULL) {
+#ifndef USE_SENDFILE
+  fUnwrittenBytesStart = fUnwrittenBytesEnd = 0;
+#endif
+  ignoreSigPipeOnSocket(socketNum);
+}
+
+TCPFileRangeSender::~TCPFileRangeSender() {
+  stopSending();
+}
+
+Boolean TCPFileRangeSender::startSending(char const* fileName, u_int64_t startByte, u_int64_t numBytes,
+					 TaskFunc* afterFunc, void* afterClientData) {
+  stopSending();
+
+  fFid = OpenInputFile(envir(), fileName);
+  if (fFid == NULL) return False;
+
+  fNextByte = startByte;
+  fNumBytesRemaining = numBytes;
+  fNumBytesSent = 0;
+  fAfterFunc = afterFunc;
+  fAfterClientData = afterClientData;
+#ifndef USE_SENDFILE
+  fUnwrittenBytesStart = fUnwrittenBytesEnd = 0;
+  SeekFile64(fFid, (int64_t)startByte, SEEK_SET);
+#endif
+
+  sendMore();
+  return True;
+}
+
+void TCPFileRangeSender::stopSending() {
+  if (fFid == NULL) return; // we're not sending
+
+  if (fNumBytesRemaining > 0) {
+    // We might be waiting for the output socket to become writable.  Turn off this background handling:
+    envir().taskScheduler().disableBackgroundHandling(fOutputSocketNum);
+    fNumBytesRemaining = 0;
+  }
+  CloseInputFile(fFid);
+  fFid = NULL;
+}
+
+void TCPFileRangeSender::sendMore() {
+  while (fNumBytesRemaining > 0) {
+#ifdef USE_SENDFILE
+    // Have the kernel send the data directly from the file to the socket:
+    off_t offset = (off_t)fNextByte;
+    size_t count = fNumBytesRemaining < 0x7FFFF000 ? (size_t)fNumBytesRemaining : 0x7FFFF000;
+    int numBytesSent = (int)sendfile(fOutputSocketNum, fileno(fFid), &offset, count);
+#else
+    if (fUnwrittenBytesStart == fUnwrittenBytesEnd) {
+      // Our buffer is empty; refill it from the file:
+      unsigned numBytesToRead = fNumBytesRemaining < TCP_FILE_RANGE_SENDER_BUFFER_SIZE
+	? (unsigned)fNumBytesRemaining : TCP_FILE_RANGE_SENDER_BUFFER_SIZE;
+      fUnwrittenBytesStart = 0;
+      fUnwrittenBytesEnd = fread(fBuffer, 1, numBytesToRead, fFid);
+      if (fUnwrittenBytesEnd == 0) break; // the file ended early
+    }
+    int numBytesSent = send(fOutputSocketNum, (char const*)&fBuffer[fUnwrittenBytesStart],
+			    fUnwrittenBytesEnd - fUnwrittenBytesStart, 0);
+    if (numBytesSent > 0) fUnwrittenBytesStart += numBytesSent;
+#endif
+    if (numBytesSent > 0) {
+      fNextByte += numBytesSent;
+      fNumBytesRemaining -= numBytesSent;
+      fNumBytesSent += numBytesSent;
+    } else if (numBytesSent < 0 && envir().getErrno() == EAGAIN) {
+      // The output socket is no longer writable.  Set a handler to be called when it becomes writable again:
+      envir().taskScheduler().setBackgroundHandling(fOutputSocketNum, SOCKET_WRITABLE, socketWritableHandler, this);
+      return;
+    } else {
+      break; // the file ended early, or the socket is no longer usable
+    }
+  }
+
+  onSendingDone();
+}
+
+void TCPFileRangeSender::onSendingDone() {
+  fNumBytesRemaining = 0; // (we're not waiting for the output socket)
+  stopSending();
+
+  // Note: We may get deleted by the following call, so don't do anything after it:
+  if (fAfterFunc != NULL) (*fAfterFunc)(fAfterClientData);
+}
+
+void TCPFileRangeSender::socketWritableHandler(void* clientData, int /*mask*/) {
+  TCPFileRangeSender* sender = (TCPFileRangeSender*)clientData;
+  sender->envir().taskScheduler().disableBackgroundHandling(sender->fOutputSocketNum);
+      // disable this handler until the next time it's needed
+  sender->sendMore();
+}
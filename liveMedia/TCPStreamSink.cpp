@@ -29,7 +29,7 @@ TCPStreamSink::TCPStreamSink(UsageEnvironment& env, int socketNum)
   : MediaSink(env),
     fUnwrittenBytesStart(0), fUnwrittenBytesEnd(0),
     fInputSourceIsOpen(False), fOutputSocketIsWritable(True),
-    fOutputSocketNum(socketNum) {
+    fOutputSocketNum(socketNum), fNumBytesWritten(0) {
   ignoreSigPipeOnSocket(socketNum);
 }
 
@@ -39,7 +39,9 @@ TCPStreamSink::~TCPStreamSink() {
 }
 
 Boolean TCPStreamSink::continuePlaying() {
+  // (This is called only by "startPlaying()".)
   fInputSourceIsOpen = fSource != NULL;
+  fNumBytesWritten = 0;
   processBuffer();
 
   return True;
@@ -62,6 +64,7 @@ void TCPStreamSink::processBuffer() {
     if (numBytesWritten > 0) {
       // We wrote at least some of our data.  Update our buffer pointers:
       fUnwrittenBytesStart += numBytesWritten;
+      fNumBytesWritten += numBytesWritten;
       if (fUnwrittenBytesStart > fUnwrittenBytesEnd) fUnwrittenBytesStart = fUnwrittenBytesEnd; // sanity check
       if (fUnwrittenBytesStart == fUnwrittenBytesEnd && (!fInputSourceIsOpen || !fSource->isCurrentlyAwaitingData())) {
 	fUnwrittenBytesStart = fUnwrittenBytesEnd = 0; // reset the buffer to empty
@@ -0,0 +1,386 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Generic Forward Error Correction (XOR parity) packets for RTP streams (RFC 5109 "ulpfec" format).
+// Implementation
+
+#include "ULPFEC.hh"
+#include "GroupsockHelper.hh"
+#include <string.h>
+
+// Each FEC packet consists of a 12-byte RTP header, followed by a 10-byte FEC header, followed by a (4- or 8-byte)
+// 'level 0' header (a 'protection length' and a mask of the protected packets' sequence numbers, relative to the
+// 'SN base'), followed by the XOR of the protected packets' payloads:
+#define RTP_HEADER_SIZE 12
+#define FEC_HEADER_SIZE 10
+#define MAX_MASK_SIZE 6 // bytes; i.e., 48 sequence numbers
+#define MAX_FEC_PACKET_OVERHEAD (RTP_HEADER_SIZE + FEC_HEADER_SIZE + 2 + MAX_MASK_SIZE)
+
+static u_int16_t get2Bytes(unsigned char const* p) { return (p[0]<<8)|p[1]; }
+static void put2Bytes(unsigned char* p, u_int16_t val) { p[0] = val>>8; p[1] = (unsigned char)val; }
+static void put4Bytes(unsigned char* p, u_int32_t val) {
+  p[0] = val>>24; p[1] = val>>16; p[2] = val>>8; p[3] = (unsigned char)val;
+}
+
+
+////////// ULPFECGroup //////////
+
+// The XOR of a group of media packets, used to build a FEC packet:
+
+class ULPFECGroup {
+public:
+  ULPFECGroup(unsigned maxPayloadSize)
+    : fMaxPayloadSize(maxPayloadSize), fPayloadXOR(new unsigned char[maxPayloadSize]) {
+    reset(0);
+  }
+  virtual ~ULPFECGroup() { delete[] fPayloadXOR; }
+
+  void reset(u_int16_t baseSeqNo) {
+    fBaseSeqNo = baseSeqNo;
+    memset(fMask, 0, sizeof fMask);
+    fRecoveryBits[0] = fRecoveryBits[1] = 0;
+    memset(fTimestampRecovery, 0, sizeof fTimestampRecovery);
+    fLengthRecovery = 0;
+    fProtectionLength = 0;
+  }
+
+  void addPacket(unsigned char const* packet, unsigned packetSize) {
+    unsigned const offset = (u_int16_t)(get2Bytes(&packet[2]) - fBaseSeqNo);
+    if (offset >= 8*MAX_MASK_SIZE) return; // shouldn't happen
+    fMask[offset/8] |= 0x80>>(offset%8);
+
+    fRecoveryBits[0] ^= packet[0]&0x3F; // P, X, CC
+    fRecoveryBits[1] ^= packet[1]; // M, PT
+    for (unsigned i = 0; i < 4; ++i) fTimestampRecovery[i] ^= packet[4+i];
+
+    unsigned payloadSize = packetSize - RTP_HEADER_SIZE;
+    if (payloadSize > fMaxPayloadSize) payloadSize = fMaxPayloadSize; // shouldn't happen
+    fLengthRecovery ^= payloadSize;
+    if (payloadSize > fProtectionLength) {
+      memset(&fPayloadXOR[fProtectionLength], 0, payloadSize - fProtectionLength);
+      fProtectionLength = payloadSize;
+    }
+    unsigned char const* payload = &packet[RTP_HEADER_SIZE];
+    for (unsigned i = 0; i < payloadSize; ++i) fPayloadXOR[i] ^= payload[i];
+  }
+
+  unsigned buildFECPacket(unsigned char* to, unsigned char fecPayloadType, u_int16_t fecSeqNo, u_int32_t fecSSRC,
+			  unsigned char const* timestamp) {
+    // Use a short (16-bit) mask if we can:
+    Boolean const longMask = fMask[2] != 0 || fMask[3] != 0 || fMask[4] != 0 || fMask[5] != 0;
+    unsigned const maskSize = longMask ? 6 : 2;
+    unsigned char* p = to;
+
+    // RTP header:
+    *p++ = 0x80; *p++ = fecPayloadType;
+    put2Bytes(p, fecSeqNo); p += 2;
+    memmove(p, timestamp, 4); p += 4;
+    put4Bytes(p, fecSSRC); p += 4;
+
+    // FEC header:
+    *p++ = (longMask ? 0x40 : 0x00)|fRecoveryBits[0]; // E=0, L, then P, X, CC recovery
+    *p++ = fRecoveryBits[1]; // M, PT recovery
+    put2Bytes(p, fBaseSeqNo); p += 2;
+    memmove(p, fTimestampRecovery, 4); p += 4;
+    put2Bytes(p, fLengthRecovery); p += 2;
+
+    // Level 0 header, and payload:
+    put2Bytes(p, fProtectionLength); p += 2;
+    memmove(p, fMask, maskSize); p += maskSize;
+    memmove(p, fPayloadXOR, fProtectionLength); p += fProtectionLength;
+
+    return p - to;
+  }
+
+private:
+  unsigned fMaxPayloadSize;
+  unsigned char* fPayloadXOR;
+  u_int16_t fBaseSeqNo;
+  unsigned char fMask[MAX_MASK_SIZE];
+  unsigned char fRecoveryBits[2];
+  unsigned char fTimestampRecovery[4];
+  u_int16_t fLengthRecovery;
+  unsigned fProtectionLength;
+};
+
+
+////////// ULPFECEncoder //////////
+
+Boolean ULPFECEncoder::parametersAreValid(unsigned rowSize, unsigned numRows) {
+  if (rowSize == 0 || rowSize > 8*MAX_MASK_SIZE) return False;
+  if (numRows > 1 && (numRows-1)*rowSize >= 8*MAX_MASK_SIZE) return False;
+
+  return True;
+}
+
+ULPFECEncoder::ULPFECEncoder(unsigned rowSize, unsigned numRows, unsigned char fecPayloadType,
+			     unsigned maxMediaPacketSize)
+  : fRowSize(rowSize), fNumRows(numRows > 1 ? numRows : 1), fFECPayloadType(fecPayloadType),
+    fFECSeqNo((u_int16_t)our_random()), fFECSSRC(our_random32()), fPacketIndex(0),
+    fColumnGroups(NULL), fNumFECPacketsReady(0), fNextFECPacketIndex(0), fNumFECPacketsGenerated(0) {
+  unsigned const maxPayloadSize = maxMediaPacketSize - RTP_HEADER_SIZE;
+  fRowGroup = new ULPFECGroup(maxPayloadSize);
+
+  unsigned maxNumFECPacketsReady = 1;
+  if (fNumRows > 1) {
+    fColumnGroups = new ULPFECGroup*[fRowSize];
+    for (unsigned i = 0; i < fRowSize; ++i) fColumnGroups[i] = new ULPFECGroup(maxPayloadSize);
+    maxNumFECPacketsReady += fRowSize;
+  }
+
+  fFECPackets = new unsigned char*[maxNumFECPacketsReady];
+  fFECPacketSizes = new unsigned[maxNumFECPacketsReady];
+  for (unsigned i = 0; i < maxNumFECPacketsReady; ++i) {
+    fFECPackets[i] = new unsigned char[MAX_FEC_PACKET_OVERHEAD + maxPayloadSize];
+  }
+}
+
+ULPFECEncoder::~ULPFECEncoder() {
+  unsigned maxNumFECPacketsReady = 1;
+  if (fColumnGroups != NULL) {
+    for (unsigned i = 0; i < fRowSize; ++i) delete fColumnGroups[i];
+    delete[] fColumnGroups;
+    maxNumFECPacketsReady += fRowSize;
+  }
+  delete fRowGroup;
+
+  for (unsigned i = 0; i < maxNumFECPacketsReady; ++i) delete[] fFECPackets[i];
+  delete[] fFECPackets; delete[] fFECPacketSizes;
+}
+
+void ULPFECEncoder::addMediaPacket(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < RTP_HEADER_SIZE) return;
+
+  if (fNextFECPacketIndex == fNumFECPacketsReady) {
+    // All previously-generated FEC packets have been consumed:
+    fNumFECPacketsReady = fNextFECPacketIndex = 0;
+  }
+
+  u_int16_t const seqNo = get2Bytes(&packet[2]);
+  unsigned const row = fPacketIndex/fRowSize;
+  unsigned const column = fPacketIndex%fRowSize;
+
+  if (column == 0) fRowGroup->reset(seqNo);
+  fRowGroup->addPacket(packet, packetSize);
+  if (column == fRowSize-1) generateFECPacket(*fRowGroup, &packet[4]);
+
+  if (fColumnGroups != NULL) {
+    if (row == 0) fColumnGroups[column]->reset(seqNo);
+    fColumnGroups[column]->addPacket(packet, packetSize);
+    if (row == fNumRows-1) generateFECPacket(*fColumnGroups[column], &packet[4]);
+  }
+
+  if (++fPacketIndex == fRowSize*fNumRows) fPacketIndex = 0;
+}
+
+unsigned char const* ULPFECEncoder::nextFECPacket(unsigned& packetSize) {
+  if (fNextFECPacketIndex == fNumFECPacketsReady) return NULL;
+
+  packetSize = fFECPacketSizes[fNextFECPacketIndex];
+  return fFECPackets[fNextFECPacketIndex++];
+}
+
+void ULPFECEncoder::generateFECPacket(ULPFECGroup& group, unsigned char const* timestamp) {
+  fFECPacketSizes[fNumFECPacketsReady]
+    = group.buildFECPacket(fFECPackets[fNumFECPacketsReady], fFECPayloadType, fFECSeqNo++, fFECSSRC, timestamp);
+  ++fNumFECPacketsReady;
+  ++fNumFECPacketsGenerated;
+}
+
+
+////////// ReceivedPacket //////////
+
+// A copy of a received (media or FEC) packet:
+
+class ReceivedPacket {
+public:
+  ReceivedPacket() : fData(NULL), fSize(0), fBufferSize(0) {}
+  virtual ~ReceivedPacket() { delete[] fData; }
+
+  void save(unsigned char const* packet, unsigned packetSize) {
+    if (packetSize > fBufferSize) {
+      delete[] fData;
+      fData = new unsigned char[packetSize];
+      fBufferSize = packetSize;
+    }
+    memmove(fData, packet, packetSize);
+    fSize = packetSize;
+  }
+  void clear() { fSize = 0; }
+  void swap(ReceivedPacket& other) {
+    unsigned char* data = fData; fData = other.fData; other.fData = data;
+    unsigned size = fSize; fSize = other.fSize; other.fSize = size;
+    unsigned bufferSize = fBufferSize; fBufferSize = other.fBufferSize; other.fBufferSize = bufferSize;
+  }
+
+  unsigned char const* data() const { return fData; }
+  unsigned size() const { return fSize; }
+  u_int16_t seqNo() const { return get2Bytes(&fData[2]); }
+
+private:
+  unsigned char* fData;
+  unsigned fSize, fBufferSize;
+};
+
+
+////////// ULPFECDecoder //////////
+
+#define MEDIA_PACKET_CACHE_SIZE 128 // must be > 8*MAX_MASK_SIZE
+#define MAX_NUM_PENDING_FEC_PACKETS 64
+#define MAX_MEDIA_PACKET_SIZE 65536
+
+ULPFECDecoder::ULPFECDecoder()
+  : fMediaPackets(new ReceivedPacket[MEDIA_PACKET_CACHE_SIZE]),
+    fFECPackets(new ReceivedPacket[MAX_NUM_PENDING_FEC_PACKETS]),
+    fRecoveredPacket(new unsigned char[MAX_MEDIA_PACKET_SIZE]),
+    fNumFECPacketsReceived(0), fNumPacketsRecovered(0) {
+  reset();
+}
+
+ULPFECDecoder::~ULPFECDecoder() {
+  delete[] fRecoveredPacket;
+  delete[] fFECPackets;
+  delete[] fMediaPackets;
+}
+
+void ULPFECDecoder::reset() {
+  for (unsigned i = 0; i < MEDIA_PACKET_CACHE_SIZE; ++i) fMediaPackets[i].clear();
+  fHaveSeenMediaPacket = False;
+  fHighestSeqNo = 0;
+  fMediaSSRC = 0;
+  fNumFECPackets = 0;
+}
+
+void ULPFECDecoder::addMediaPacket(unsigned char const* packet, unsigned packetSize) {
+  if (packetSize < RTP_HEADER_SIZE) return;
+
+  u_int16_t const seqNo = get2Bytes(&packet[2]);
+  fMediaPackets[seqNo%MEDIA_PACKET_CACHE_SIZE].save(packet, packetSize);
+  if (!fHaveSeenMediaPacket || (u_int16_t)(seqNo - fHighestSeqNo) < 0x8000) {
+    fHighestSeqNo = seqNo;
+    fHaveSeenMediaPacket = True;
+  }
+  fMediaSSRC = (packet[8]<<24)|(packet[9]<<16)|(packet[10]<<8)|packet[11];
+}
+
+void ULPFECDecoder::addFECPacket(unsigned char const* packet, unsigned packetSize) {
+  // Check that the packet has a (short mask) FEC header, and no CSRCs:
+  if (packetSize < RTP_HEADER_SIZE + FEC_HEADER_SIZE + 4 || (packet[0]&0x0F) != 0) return;
+  ++fNumFECPacketsReceived;
+
+  if (fNumFECPackets == MAX_NUM_PENDING_FEC_PACKETS) removeFECPacket(0); // the oldest
+  fFECPackets[fNumFECPackets++].save(packet, packetSize);
+}
+
+unsigned char const* ULPFECDecoder::nextRecoveredPacket(unsigned& packetSize) {
+  if (!fHaveSeenMediaPacket) return NULL;
+
+  for (unsigned i = 0; i < fNumFECPackets; ) {
+    unsigned char const* fec = fFECPackets[i].data();
+    unsigned const fecSize = fFECPackets[i].size();
+    unsigned char const* fecHdr = &fec[RTP_HEADER_SIZE];
+    u_int16_t const baseSeqNo = get2Bytes(&fecHdr[2]);
+
+    unsigned const maskSize = (fecHdr[0]&0x40) != 0 ? 6 : 2;
+    unsigned char const* level0Hdr = &fecHdr[FEC_HEADER_SIZE];
+    unsigned const protectionLength = get2Bytes(level0Hdr);
+    unsigned char const* mask = &level0Hdr[2];
+    unsigned char const* payloadXOR = &mask[maskSize];
+    if (RTP_HEADER_SIZE + FEC_HEADER_SIZE + 2 + maskSize + protectionLength > fecSize) {
+      removeFECPacket(i); // bad FEC packet
+      continue;
+    }
+
+    // Count how many of the protected packets are missing:
+    unsigned numMissing = 0, numNotYetDue = 0;
+    u_int16_t missingSeqNo = 0;
+    for (unsigned offset = 0; offset < 8*maskSize; ++offset) {
+      if ((mask[offset/8]&(0x80>>(offset%8))) == 0) continue;
+
+      u_int16_t const seqNo = baseSeqNo + offset;
+      if (receivedPacket(seqNo) != NULL) continue;
+      u_int16_t const seqNoDiff = seqNo - fHighestSeqNo;
+      if (seqNoDiff != 0 && seqNoDiff < 0x8000) {
+	++numNotYetDue; // this packet is later than any that we've seen, so it might still arrive
+      } else {
+	++numMissing;
+	missingSeqNo = seqNo;
+      }
+    }
+
+    u_int16_t const age = fHighestSeqNo - baseSeqNo;
+    if (numMissing + numNotYetDue == 0
+	|| (age < 0x8000 && age > MEDIA_PACKET_CACHE_SIZE - 8*MAX_MASK_SIZE)) {
+      // This FEC packet is no longer useful (either we have all of its packets, or they're too old):
+      removeFECPacket(i);
+      continue;
+    }
+    if (numMissing != 1 || numNotYetDue > 0) {
+      // We can't (yet) use this FEC packet:
+      ++i;
+      continue;
+    }
+
+    // Recover the missing packet, by XORing the FEC packet with each of the other protected packets:
+    unsigned char recoveryBits[2] = { (unsigned char)(fecHdr[0]&0x3F), fecHdr[1] };
+    unsigned char timestamp[4];
+    memmove(timestamp, &fecHdr[4], 4);
+    unsigned payloadSize = get2Bytes(&fecHdr[8]);
+    unsigned char* payload = &fRecoveredPacket[RTP_HEADER_SIZE];
+    memmove(payload, payloadXOR, protectionLength);
+
+    for (unsigned offset = 0; offset < 8*maskSize; ++offset) {
+      if ((mask[offset/8]&(0x80>>(offset%8))) == 0) continue;
+
+      ReceivedPacket* packet = receivedPacket(baseSeqNo + offset);
+      if (packet == NULL) continue; // the missing packet
+      unsigned char const* data = packet->data();
+      recoveryBits[0] ^= data[0]&0x3F;
+      recoveryBits[1] ^= data[1];
+      for (unsigned j = 0; j < 4; ++j) timestamp[j] ^= data[4+j];
+      unsigned const size = packet->size() - RTP_HEADER_SIZE;
+      payloadSize ^= size;
+      for (unsigned j = 0; j < size && j < protectionLength; ++j) payload[j] ^= data[RTP_HEADER_SIZE+j];
+    }
+    removeFECPacket(i);
+    if (payloadSize > protectionLength) continue; // the FEC packet was inconsistent with the packets we have
+
+    fRecoveredPacket[0] = 0x80|recoveryBits[0];
+    fRecoveredPacket[1] = recoveryBits[1];
+    put2Bytes(&fRecoveredPacket[2], missingSeqNo);
+    memmove(&fRecoveredPacket[4], timestamp, 4);
+    put4Bytes(&fRecoveredPacket[8], fMediaSSRC);
+    packetSize = RTP_HEADER_SIZE + payloadSize;
+
+    addMediaPacket(fRecoveredPacket, packetSize);
+    ++fNumPacketsRecovered;
+    return fRecoveredPacket;
+  }
+
+  return NULL;
+}
+
+ReceivedPacket* ULPFECDecoder::receivedPacket(u_int16_t seqNo) const {
+  ReceivedPacket* packet = &fMediaPackets[seqNo%MEDIA_PACKET_CACHE_SIZE];
+  return packet->size() >= RTP_HEADER_SIZE && packet->seqNo() == seqNo ? packet : NULL;
+}
+
+void ULPFECDecoder::removeFECPacket(unsigned index) {
+  // Keep the remaining packets in order of arrival.  (We swap, rather than copy, so that each buffer gets reused.)
+  --fNumFECPackets;
+  for (unsigned i = index; i < fNumFECPackets; ++i) fFECPackets[i].swap(fFECPackets[i+1]);
+}
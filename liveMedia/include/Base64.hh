@@ -40,4 +40,34 @@ char* base64Encode(char const* orig, unsigned origLength);
     // returns a 0-terminated string that
     // the caller is responsible for delete[]ing.
 
+// Versions of the above that use a caller-supplied buffer, rather than allocating memory:
+
+unsigned base64DecodeInto(char const* in, unsigned inSize, unsigned char* out,
+			  Boolean trimTrailingZeros = True);
+    // Decodes "inSize" bytes of input into "out" (which must have room for 3*(inSize/4) bytes), and returns the number of
+    // bytes written.  "out" may be the same as "in" (to decode in place).
+
+inline unsigned base64EncodedLength(unsigned origLength) { return 4*((origLength+2)/3); }
+unsigned base64EncodeInto(char const* orig, unsigned origLength, char* out);
+    // Encodes "origLength" bytes into "out" (which must have room for "base64EncodedLength(origLength)" bytes, plus a
+    // trailing '\0'), and returns the number of characters written (excluding the trailing '\0').
+
+// A decoder for a Base-64 encoded stream that arrives in arbitrary pieces (e.g., RTSP-over-HTTP tunneled requests):
+class Base64StreamDecoder {
+public:
+  Base64StreamDecoder() { reset(); }
+  void reset() { fBits = 0; fNumBits = 0; }
+
+  unsigned decode(char const* in, unsigned inSize, unsigned char* out);
+      // Decodes the next "inSize" bytes of the stream into "out" (which must have room for "inSize" bytes), and returns
+      // the number of bytes written.  Whitespace (and any other non-Base-64 characters) is ignored; '=' padding may
+      // appear anywhere (e.g., at the end of each separately-encoded message).  Any leftover bits from an incomplete final
+      // 4-character group are kept for the next call.  "out" may be the same as "in" (to decode in place), because we
+      // never write more bytes than we've read.
+
+private:
+  unsigned fBits; // leftover bits (fewer than 8) from the previous call
+  unsigned fNumBits;
+};
+
 #endif
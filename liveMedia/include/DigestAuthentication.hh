@@ -25,10 +25,14 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include <Boolean.hh>
 #endif
 
+#define DIGEST_RESPONSE_MAX_SIZE 65
+    // large enough for a digest (MD5 or SHA-256) as a hex string, plus a trailing '\0'
+
 // A class used for digest authentication.
 // The "realm", and "nonce" fields are supplied by the server
 // (in a "401 Unauthorized" response).
 // The "username" and "password" fields are supplied by the client.
+// By default, digests are computed using MD5; the "SHA-256" algorithm (RFC 7616) can also be used.
 class Authenticator {
 public:
   Authenticator();
@@ -48,15 +52,32 @@ public:
   void setUsernameAndPassword(char const* username, char const* password, Boolean passwordIsMD5 = False);
       // If "passwordIsMD5" is True, then "password" is actually the value computed
       // by md5(<username>:<realm>:<actual-password>)
+      // (or, if we use SHA-256, by sha256(<username>:<realm>:<actual-password>))
+  void setUsesSHA256(Boolean usesSHA256);
+      // Selects the "SHA-256" (rather than the default "MD5") digest algorithm
 
   char const* realm() const { return fRealm; }
   char const* nonce() const { return fNonce; }
   char const* username() const { return fUsername; }
   char const* password() const { return fPassword; }
+  Boolean usesSHA256() const { return fUsesSHA256; }
+  Boolean passwordIsMD5() const { return fPasswordIsMD5; }
 
   char const* computeDigestResponse(char const* cmd, char const* url) const;
       // The returned string from this function must later be freed by calling:
   void reclaimDigestResponse(char const* responseStr) const;
+  void computeDigestResponse(char const* cmd, char const* url, unsigned urlSize,
+			     char const* nonce, unsigned nonceSize, char* resultBuf) const;
+      // A version of the above that doesn't allocate memory (and so is cheaper to call often): It computes the response for
+      // the given "nonce" (rather than our own), and writes it (as a '\0'-terminated hex string) into "resultBuf", which must
+      // be at least DIGEST_RESPONSE_MAX_SIZE bytes in size.  ("url" and "nonce" need not be '\0'-terminated.)
+
+  static void computeHA1(char const* username, char const* realm, char const* password, Boolean usesSHA256,
+			 char* resultBuf);
+      // Computes md5(<username>:<realm>:<password>) (or sha256(...)) - as a hex string - into "resultBuf", which must be at
+      // least DIGEST_RESPONSE_MAX_SIZE bytes in size.  (This can be used to precompute values for "passwordIsMD5".)
+  static void createRandomNonce(char* resultBuf);
+      // Creates a 'random' nonce (a 32-character hex string) in "resultBuf", which must be at least 33 bytes in size.
 
 private:
   void resetRealmAndNonce();
@@ -65,11 +86,15 @@ private:
   void assignUsernameAndPassword(char const* username, char const* password, Boolean passwordIsMD5);
   void assign(char const* realm, char const* nonce,
 	      char const* username, char const* password, Boolean passwordIsMD5);
+  void updateHA1(); // recomputes "fHA1", after our realm, username, password or algorithm changes
 
 private:
   char* fRealm; char* fNonce;
   char* fUsername; char* fPassword;
   Boolean fPasswordIsMD5;
+  Boolean fUsesSHA256;
+  char fHA1[DIGEST_RESPONSE_MAX_SIZE];
+      // md5(<username>:<realm>:<password>) (or sha256(...)), cached because it's used for every response
 };
 
 #endif
@@ -52,9 +52,10 @@ public:
   void removeServerMediaSession(char const* streamName);
      // ditto
 
-  void closeAllClientSessionsForServerMediaSession(ServerMediaSession* serverMediaSession);
+  virtual void closeAllClientSessionsForServerMediaSession(ServerMediaSession* serverMediaSession);
       // Closes (from the server) all client sessions that are currently using this "ServerMediaSession" object.
       // Note, however, that the "ServerMediaSession" object remains accessible by new clients.
+      // (Subclasses that have other kinds of client of a "ServerMediaSession" may redefine this to close those as well.)
   void closeAllClientSessionsForServerMediaSession(char const* streamName);
      // ditto
 
@@ -65,6 +66,28 @@ public:
       // Equivalent to:
       //     "closeAllClientSessionsForServerMediaSession(streamName); removeServerMediaSession(streamName);
 
+  // Optional protection against clients (hostile or buggy) that open too many connections, or that send requests too
+  // slowly (or too quickly).  (By default, none of these limits apply.)
+  void setConnectionLimits(unsigned maxConnections, unsigned maxConnectionsPerClientAddress = 0);
+      // New connections beyond these limits (0 means 'no limit') are closed as soon as they've been accepted.
+  void setRequestTimeouts(unsigned requestCompletionSeconds, unsigned idleConnectionSeconds = 0);
+      // A connection is closed if a request - once the client has begun sending it - is not complete within
+      // "requestCompletionSeconds" (this defends against 'slowloris' attacks), or - if the connection is not (yet) used by
+      // any client session - if no new request begins within "idleConnectionSeconds".  (0 means 'no timeout'.)
+  void setRequestRateLimit(unsigned maxRequestsPerSecond, unsigned maxRequestBurstSize = 10);
+      // A connection is closed if its client sends requests faster than this (after an initial burst of up to
+      // "maxRequestBurstSize" requests).  (0 means 'no limit'.)
+
+  // Counters of connection-level events (e.g., for monitoring):
+  struct ConnectionStatistics {
+    unsigned numCurrentConnections;
+    unsigned numAccepted; // including those that were then rejected (below)
+    unsigned numRejectedForOverload, numRejectedForClientAddressLimit; // see "setConnectionLimits()"
+    unsigned numClosedForSlowRequest, numClosedForIdleness; // see "setRequestTimeouts()"
+    unsigned numClosedForRequestRate; // see "setRequestRateLimit()"
+  };
+  void getConnectionStatistics(ConnectionStatistics& stats) const;
+
 protected:
   GenericMediaServer(UsageEnvironment& env, int ourSocket, Port ourPort,
 		     unsigned reclamationSeconds);
@@ -95,6 +118,14 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleRequestBytes(int newBytesRead) = 0;
     void resetRequestBuffer();
 
+    // Support for the optional limits set by "GenericMediaServer::setRequestTimeouts()" and "setRequestRateLimit()":
+    Boolean requestIsWithinRateLimit();
+        // called (by a subclass) for each complete request, before handling it.  If it returns False, the connection
+        // should be closed.
+    void noteUsedByClientSession(); // the 'idle connection' timeout no longer applies to this connection
+    void stopRequestTimer(); // e.g., while we're sending a response, rather than waiting for the client
+    static void requestTimeoutHandler(void* clientData);
+
   protected:
     friend class GenericMediaServer;
     friend class ClientSession;
@@ -105,6 +136,11 @@ public: // should be protected, but some old compilers complain otherwise
     unsigned char fRequestBuffer[REQUEST_BUFFER_SIZE];
     unsigned char fResponseBuffer[RESPONSE_BUFFER_SIZE];
     unsigned fRequestBytesAlreadySeen, fRequestBufferBytesLeft;
+    TaskToken fRequestTimerTask;
+    Boolean fRequestTimerIsForIncompleteRequest; // otherwise it's for an idle connection
+    Boolean fIsUsedByClientSession;
+    double fRequestTokens; // for our request rate limit (a 'token bucket')
+    struct timeval fRequestTokensTime; // when "fRequestTokens" was last updated
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a server:
@@ -149,18 +185,46 @@ protected:
     HashTable::Iterator* fOurIterator;
   };
 
+  // An iterator over our "ClientSession" objects:
+  class ClientSessionIterator {
+  public:
+    ClientSessionIterator(GenericMediaServer& server);
+    virtual ~ClientSessionIterator();
+    ClientSession* next();
+  private:
+    HashTable::Iterator* fOurIterator;
+  };
+
 protected:
   friend class ClientConnection;
   friend class ClientSession;	
   friend class ServerMediaSessionIterator;
+  friend class ClientSessionIterator;
   int fServerSocket;
   Port fServerPort;
   unsigned fReclamationSeconds;
 
+protected:
+  Boolean acceptingConnectionFrom(struct sockaddr_in const& clientAddr);
+      // checks the limits set by "setConnectionLimits()"
+  void changeNumConnectionsFrom(struct sockaddr_in const& clientAddr, int delta);
+      // Each "ClientConnection" calls this when it's created and deleted.  A subclass that hands accepted connections to
+      // some other object (e.g., in another thread) can also call it, so that those connections count against our limits
+      // until they're closed.
+
+private:
+  void changeNumConnectionsPerClientAddress(struct sockaddr_in const& clientAddr, int delta);
+
 private:
   HashTable* fServerMediaSessions; // maps 'stream name' strings to "ServerMediaSession" objects
   HashTable* fClientConnections; // the "ClientConnection" objects that we're using
   HashTable* fClientSessions; // maps 'session id' strings to "ClientSession" objects
+  unsigned fNumConnections;
+  unsigned fMaxConnections, fMaxConnectionsPerClientAddress;
+  HashTable* fNumConnectionsPerClientAddress; // maps client IP addresses to their number of connections (if we're limiting this)
+  unsigned fRequestCompletionSeconds, fIdleConnectionSeconds;
+  unsigned fMaxRequestsPerSecond, fMaxRequestBurstSize;
+  ConnectionStatistics fConnectionStatistics;
 };
 
 // A data structure used for optional user/password authentication:
@@ -168,10 +232,12 @@ private:
 class UserAuthenticationDatabase {
 public:
   UserAuthenticationDatabase(char const* realm = NULL,
-			     Boolean passwordsAreMD5 = False);
+			     Boolean passwordsAreMD5 = False, Boolean supportsSHA256 = False);
     // If "passwordsAreMD5" is True, then each password stored into, or removed from,
     // the database is actually the value computed
     // by md5(<username>:<realm>:<actual-password>)
+    // If "supportsSHA256" is True (and "passwordsAreMD5" is False), then clients may also authenticate using the
+    // RFC 7616 "SHA-256" digest algorithm (which servers will then offer, in addition to MD5).
   virtual ~UserAuthenticationDatabase();
 
   virtual void addUserRecord(char const* username, char const* password);
@@ -179,14 +245,22 @@ public:
 
   virtual char const* lookupPassword(char const* username);
       // returns NULL if the user name was not present
+  virtual char const* lookupHA1(char const* username, Boolean forSHA256 = False);
+      // returns md5(<username>:<realm>:<password>) (or sha256(...)) - precomputed when the user record was added -
+      // or NULL if this is not known (in which case the caller should use "lookupPassword()" instead)
 
   char const* realm() { return fRealm; }
   Boolean passwordsAreMD5() { return fPasswordsAreMD5; }
+  Boolean supportsSHA256() { return fSupportsSHA256; }
 
 protected:
   HashTable* fTable;
   char* fRealm;
   Boolean fPasswordsAreMD5;
+
+private:
+  Boolean fSupportsSHA256;
+  HashTable* fHA1Table; // maps user names to their precomputed digests (if "fPasswordsAreMD5" is False)
 };
 
 #endif
@@ -29,6 +29,16 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class H264or5VideoRTPSink: public VideoRTPSink {
+public: // redefined virtual functions:
+  virtual Boolean setFrameDropLevel(unsigned level);
+      // Level 1 drops 'disposable' (i.e., non-reference) pictures' NAL units; level 2 drops all but 'key' (IDR or IRAP)
+      // pictures' NAL units.  (After any reference NAL unit has been dropped, we don't resume sending non-key NAL units
+      // until the next key picture, or a picture with a 'recovery point' SEI - or, at a level below 2, until 2 seconds
+      // (of presentation time) have passed.)  Parameter sets, SEI, etc. are never dropped.
+
+public:
+  unsigned numNALUnitsDropped() const;
+
 protected:
   H264or5VideoRTPSink(int hNumber, // 264 or 265
 		      UsageEnvironment& env, Groupsock* RTPgs, unsigned char rtpPayloadFormat,
@@ -51,6 +61,7 @@ private: // redefined virtual functions:
 protected:
   int fHNumber;
   FramedFilter* fOurFragmenter;
+  unsigned fFrameDropLevel;
   char* fFmtpSDPLine;
   u_int8_t* fVPS; unsigned fVPSSize;
   u_int8_t* fSPS; unsigned fSPSSize;
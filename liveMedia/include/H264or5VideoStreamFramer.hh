@@ -84,4 +84,16 @@ unsigned removeH264or5EmulationBytes(u_int8_t* to, unsigned toMaxSize,
 				     u_int8_t const* from, unsigned fromSize);
     // returns the size of the copy; it will be <= min(toMaxSize,fromSize)
 
+// A routine for reading - directly, and synchronously - the VPS (H.265 only), SPS and PPS NAL units from near
+// the start of a H.264 or H.265 Video Elementary Stream file.  This is much cheaper than playing the file
+// through a "H264or5VideoStreamFramer" (and a dummy "RTPSink") just to learn these NAL units - e.g., for a SDP description.
+Boolean readH264or5ParameterSetsFromFile(UsageEnvironment& env, int hNumber, // 264 or 265
+					 char const* fileName,
+					 u_int8_t*& vps, unsigned& vpsSize,
+					 u_int8_t*& sps, unsigned& spsSize,
+					 u_int8_t*& pps, unsigned& ppsSize,
+					 unsigned maxBytesToRead = 1000000);
+    // Returns True iff all of the required NAL units were found within the first "maxBytesToRead" bytes of the file,
+    // in which case the caller is responsible for delete[]ing them.  (If False is returned, each is set to NULL.)
+
 #endif
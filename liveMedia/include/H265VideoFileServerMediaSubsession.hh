@@ -54,8 +54,12 @@ protected: // redefined virtual functions
 
 private:
   char* fAuxSDPLine;
-  char fDoneFlag; // used when setting up "fAuxSDPLine"
+  char fDoneFlag; // used when setting up "fAuxSDPLine" (if "fVPS", "fSPS" and "fPPS" can't be read directly from the file)
   RTPSink* fDummyRTPSink; // ditto
+  Boolean fHaveReadParameterSets;
+  u_int8_t* fVPS; unsigned fVPSSize;
+  u_int8_t* fSPS; unsigned fSPSSize;
+  u_int8_t* fPPS; unsigned fPPSSize;
 };
 
 #endif
@@ -0,0 +1,165 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A sink that packages a live "ServerMediaSession" (with H.264 or H.265 video, and/or AAC audio) as a sliding window of
+// HLS (Transport Stream) segments - and, optionally, 'Low-Latency HLS' partial segments - held in memory, and generates
+// the corresponding (rolling) playlist.  The data is received (over RTP, on the loopback interface) from the session's
+// server just like any other RTSP client, so one (possibly proxied) live source can be served to any number of HTTP clients.
+// C++ header
+
+#ifndef _HLS_LIVE_SEGMENTER_HH
+#define _HLS_LIVE_SEGMENTER_HH
+
+#ifndef _MEDIA_SINK_HH
+#include "MediaSink.hh"
+#endif
+#ifndef _SERVER_MEDIA_SESSION_HH
+#include "ServerMediaSession.hh"
+#endif
+#ifndef _HLS_SEGMENT_CACHE_HH
+#include "HLSSegmentCache.hh" // for "HLSCachedSegment"
+#endif
+
+class MediaSession; // forward
+class MPEG2TransportStreamFromESSource; // forward
+class FramedFilter; // forward
+class HLSLiveSegment; // forward
+class HLSLivePart; // forward
+class HLSLiveWaiter; // forward
+
+class HLSLiveSegmenter: public MediaSink {
+public:
+  static HLSLiveSegmenter* createNew(UsageEnvironment& env, ServerMediaSession& session,
+				     unsigned targetDuration = 6, unsigned partTargetDurationInMs = 0,
+				     unsigned numSegmentsInPlaylist = 6);
+      // "targetDuration" is the (minimum) duration of each segment, in seconds.  (Segments begin with a key frame, so are
+      // longer than this if key frames are further apart.)  If "partTargetDurationInMs" is non-zero, then 'partial segments'
+      // of (up to) this duration are also generated (for 'Low-Latency HLS').
+      // Returns NULL if "session" has no subsessions that we can segment (H.264 or H.265 video, or AAC audio).
+
+  ServerMediaSession& session() const { return fSession; }
+  unsigned targetDuration() const { return fTargetDuration; }
+
+  char* generatePlaylist(char const* streamName);
+      // Returns (in a "new[]"d string) a playlist for the segments (and partial segments) that are currently available, with
+      // URIs "<streamName>?seq=<media-sequence-number>" (and "<streamName>?seq=<media-sequence-number>.<part-number>").
+      // Returns NULL if no segment is available yet.
+
+  HLSCachedSegment* lookupSegment(unsigned mediaSequenceNumber, int partNumber = -1);
+      // Returns the requested segment (or, if "partNumber" >= 0, partial segment) - which the caller must "unref()" when
+      // done - or NULL if it's not (or no longer) available.
+
+  Boolean isInPlaylist(unsigned mediaSequenceNumber, int partNumber = -1) const;
+      // Returns True iff the playlist would now include the specified segment (or partial segment).  (A segment is
+      // included once it's complete; a partial segment of the current segment is included once it's complete.)
+  Boolean isTooFarAhead(unsigned mediaSequenceNumber) const;
+      // Returns True iff a request that blocks until the specified segment is in the playlist should be rejected
+      // (because the segment is more than two segments after the most recent one).
+
+  typedef void (afterPlaylistChangeFunc)(void* clientData);
+  void addWaiter(afterPlaylistChangeFunc* func, void* clientData);
+      // Arranges for "func(clientData)" to be called (once) when the playlist next changes - or when we're being closed
+      // (in which case "isClosing()" returns True).  (This is used to implement 'blocking playlist reload' requests.)
+  void removeWaiter(void* clientData);
+  Boolean isClosing() const { return fIsClosing; }
+
+  void noteActivity(); // called each time one of our segments (or our playlist) is requested
+  Boolean isIdle(unsigned maxIdleSeconds) const;
+      // Returns True iff we've not been used for at least "maxIdleSeconds", and no-one is waiting for our playlist to change
+
+protected:
+  HLSLiveSegmenter(UsageEnvironment& env, ServerMediaSession& session,
+		   unsigned targetDuration, unsigned partTargetDurationInMs, unsigned numSegmentsInPlaylist);
+      // called only by "createNew()"
+  virtual ~HLSLiveSegmenter();
+
+private:
+  Boolean setUpInputs(); // returns False if we can't segment any of our session's subsessions
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize,
+				unsigned numTruncatedBytes,
+				struct timeval presentationTime,
+				unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize);
+  static void onSourceClosure(void* clientData);
+
+  void handleTSPacket(u_int8_t const* pkt);
+  void parsePAT(u_int8_t const* pkt, unsigned payloadOffset);
+  void parsePMT(u_int8_t const* pkt, unsigned payloadOffset);
+  void handleAccessUnitStart(u_int64_t pts);
+  void handleKeyFrame(); // called when we find that the current access unit is a key frame
+  void cutSegment(unsigned offset, u_int64_t pts, Boolean nextSegmentBeginsWithKeyFrame);
+  void completeCurrentPart(u_int64_t pts);
+  void addCurrentPart(HLSCachedSegment* data, double duration);
+  HLSCachedSegment* takeFromPartBuffer(unsigned numBytes);
+  void insertSegmentStartTables();
+  void appendToPart(u_int8_t const* data, unsigned size);
+  void notifyWaiters();
+
+  static void releaseData(HLSCachedSegment* data);
+  static void deleteParts(HLSLivePart*& parts);
+  static void deleteSegment(HLSLiveSegment* segment);
+
+private: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+
+private:
+  ServerMediaSession& fSession;
+  unsigned fTargetDuration, fNumSegmentsInPlaylist;
+  double fPartTargetDuration; // in seconds; 0.0 if we're not generating partial segments
+  unsigned fMaxSeenDuration; // the largest (rounded) duration of any segment so far
+  Boolean fIsClosing;
+  unsigned fClientSessionId; // our 'client session' id, when receiving from our session's server
+  MediaSession* fMediaSession; // the RTP receivers for the subsessions that we segment
+  MPEG2TransportStreamFromESSource* fMultiplexor;
+  unsigned fNumInputs;
+  ServerMediaSubsession** fServerSubsessions;
+  void** fStreamTokens;
+  FramedFilter** fInputFilters; // that feed our Transport Stream multiplexor
+  struct timeval fLastActivityTime;
+
+  // Transport Stream parsing state:
+  u_int8_t fTSPacket[188]; // into which we read each Transport Stream packet
+  u_int8_t fPATPacket[188]; u_int8_t fPMTPacket[188]; // copies of the most recent PAT and PMT, inserted at the start of each segment
+  u_int8_t fPATContinuityCounter, fPMTContinuityCounter; // for the PAT and PMT packets (including our copies) that we output
+  Boolean fHavePAT, fHavePMT;
+  u_int16_t fPMT_PID, fVideoPID, fAudioPID; // 0 if not (yet) known
+  Boolean fVideoIsH265;
+  Boolean fHaveLastVideoPTS;
+  u_int64_t fLastVideoPTS;
+  u_int64_t fAUPTS; // of the current access unit
+  unsigned fAUStartOffset; // the position (in "fPartBuffer") of the start of the current access unit
+  Boolean fAUIsKey;
+  int64_t fLastAccessUnitInterval; // in PTS units
+
+  // Segmenting state:
+  Boolean fHaveStarted; // True once we've seen our first key frame
+  u_int64_t fSegmentStartPTS, fPartStartPTS;
+  unsigned fCurrentMediaSequenceNumber; // of the current (incomplete) segment
+  HLSLiveSegment* fSegments; // the complete segments that we still hold, oldest first
+  HLSLiveSegment* fLastSegment;
+  unsigned fNumSegments;
+  HLSLivePart* fCurrentParts; // the complete partial segments of the current segment
+  HLSLivePart* fLastCurrentPart;
+  unsigned fNumCurrentParts;
+  Boolean fCurrentPartIsIndependent;
+  u_int8_t* fPartBuffer; // the data of the current (incomplete) partial segment (or segment, if we don't generate parts)
+  unsigned fPartBufferSize, fPartBufferMaxSize;
+  HLSLiveWaiter* fWaiters;
+};
+
+#endif
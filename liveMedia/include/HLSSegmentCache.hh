@@ -0,0 +1,142 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// A cache of HTTP Live Streaming (HLS) segments - i.e., the Transport Stream data for a
+// "<stream-name>?segment=<offset>,<duration>" request - shared by all clients of a "RTSPServerSupportingHTTPStreaming".
+// The most recently used segments are kept in memory, and (optionally) less recently used ones in files in a directory.
+// (Segments that are just a range of bytes from a file are sent directly from that file, so are not cached.)
+// C++ header
+
+#ifndef _HLS_SEGMENT_CACHE_HH
+#define _HLS_SEGMENT_CACHE_HH
+
+#ifndef _FRAMED_FILTER_HH
+#include "FramedFilter.hh"
+#endif
+#include <time.h>
+
+class HLSCacheEntry; // forward
+
+// The data of one segment, while it's in memory.  Each user of a segment that it got from "HLSSegmentCache::lookup()"
+// (or from "HLSLiveSegmenter::lookupSegment()") must call "unref()" when it has finished with it.  (The segment may get
+// dropped by its holder - but not deleted - while it's still being used.)
+class HLSCachedSegment {
+public:
+  u_int8_t* data() const { return fData; }
+  unsigned size() const { return fSize; }
+
+  void ref() { ++fRefCount; }
+  void unref(); // deletes us if we're no longer referenced, and no longer held by our cache (or segmenter)
+
+private:
+  friend class HLSSegmentCache;
+  friend class HLSLiveSegmenter;
+  HLSCachedSegment(u_int8_t* data, unsigned size); // takes ownership of "data"
+  virtual ~HLSCachedSegment();
+
+private:
+  u_int8_t* fData;
+  unsigned fSize;
+  unsigned fRefCount;
+  Boolean fIsHeld;
+};
+
+class HLSSegmentCache {
+public:
+  HLSSegmentCache(UsageEnvironment& env, unsigned maxMemorySize,
+		  char const* diskCacheDirectoryName = NULL, u_int64_t maxDiskSize = 0);
+      // The cache holds up to "maxMemorySize" bytes of segment data in memory.  If "diskCacheDirectoryName" is non-NULL,
+      // then segments that are removed from memory are saved in files in this (existing) directory - holding up to
+      // "maxDiskSize" bytes - from where they can be sent more cheaply than by reading (and seeking) the original
+      // stream again.  (Any files that we create there are removed when they leave the cache, or when we're deleted.)
+  virtual ~HLSSegmentCache();
+
+  static Boolean getModificationTime(char const* streamName, time_t& modificationTime);
+      // Sets "modificationTime" to that of the file named "streamName".  Returns False iff there's no such file.
+
+  HLSCachedSegment* lookup(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+			   time_t modificationTime, char const*& diskFileName, unsigned& diskFileSize);
+      // Returns the requested segment - which the caller must "unref()" when done - if it's in memory.  Otherwise, if
+      // it's in a file, sets "diskFileName" (which remains valid only until our next call) and "diskFileSize", and returns
+      // NULL.  (Otherwise, "diskFileName" is set to NULL, and NULL is returned.)
+  void add(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds, time_t modificationTime,
+	   u_int8_t* data, unsigned size);
+      // Adds a segment to the cache (or, if it's too large, deletes it).  We take ownership of "data" (allocated by "new[]").
+
+  unsigned numHits() const { return fNumHits; }
+  unsigned numMisses() const { return fNumMisses; }
+  unsigned memorySize() const { return fMemorySize; }
+  u_int64_t diskSize() const { return fDiskSize; }
+
+private:
+  HLSCacheEntry* lookupEntry(char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+			     time_t modificationTime, Boolean createIfNotPresent);
+  void addToMemory(HLSCacheEntry* entry, HLSCachedSegment* segment);
+  void removeFromMemory(HLSCacheEntry* entry);
+  Boolean saveToDisk(HLSCacheEntry* entry);
+  void removeFromDisk(HLSCacheEntry* entry);
+  void deleteEntryIfUnused(HLSCacheEntry* entry);
+
+private:
+  UsageEnvironment& fEnv;
+  unsigned fMaxMemorySize, fMemorySize;
+  char* fDiskCacheDirectoryName; // NULL if we have no disk cache
+  u_int64_t fMaxDiskSize, fDiskSize;
+  u_int32_t fDiskFileNamePrefix; // random, so that our files' names don't clash with those of other caches
+  unsigned fDiskFileCounter; // used to name our files
+  HashTable* fEntries; // indexed by key (stream name, offset, duration, modification time)
+  HLSCacheEntry* fMemoryLRUHead; // a circular list (head->next is the most recently used)
+  HLSCacheEntry* fDiskLRUHead; // ditto
+  unsigned fNumHits, fNumMisses;
+};
+
+// A filter that passes its input through unchanged, while also copying it, so that - if the input turns out to be
+// the complete (expected) segment - it can be added to a "HLSSegmentCache".  (This is used for each cache miss.)
+class HLSSegmentCacheFiller: public FramedFilter {
+public:
+  static HLSSegmentCacheFiller* createNew(UsageEnvironment& env, FramedSource* inputSource, HLSSegmentCache& cache,
+					  char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+					  time_t modificationTime, unsigned segmentSize);
+
+protected:
+  HLSSegmentCacheFiller(UsageEnvironment& env, FramedSource* inputSource, HLSSegmentCache& cache,
+			char const* streamName, unsigned offsetInSeconds, unsigned durationInSeconds,
+			time_t modificationTime, unsigned segmentSize);
+      // called only by createNew()
+  virtual ~HLSSegmentCacheFiller();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime, unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
+			 struct timeval presentationTime, unsigned durationInMicroseconds);
+  static void onInputClosure(void* clientData);
+  void onInputClosure();
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  HLSSegmentCache& fCache;
+  char* fStreamName;
+  unsigned fOffsetInSeconds, fDurationInSeconds;
+  time_t fModificationTime;
+  u_int8_t* fSegmentData; // NULL if we've given up on caching this segment
+  unsigned fSegmentSize, fNumBytesCopied;
+};
+
+#endif
@@ -40,6 +40,33 @@ public:
   static MPEG2IFrameIndexFromTransportStream*
   createNew(UsageEnvironment& env, FramedSource* inputSource);
 
+  void setResumptionPoint(unsigned long firstTransportPacketNumber, u_int8_t startOffsetInFirstPacket,
+			  float pcrAtResumptionPoint,
+			  unsigned char const* streamStart, unsigned streamStartSize,
+			  unsigned char const* packetsBeforeResumptionPoint = NULL,
+			  unsigned packetsBeforeResumptionPointSize = 0);
+      // Used to append to an existing index (e.g., for a Transport Stream file that's still being recorded, or
+      // after indexing was interrupted).  Call this before reading from us.  It specifies that "inputSource"
+      // begins with transport packet number "firstTransportPacketNumber", and that indexing should resume from
+      // byte "startOffsetInFirstPacket" within this packet.  (This should be where a frame begins - i.e., the
+      // position of an existing index record with PCR "pcrAtResumptionPoint".)  "streamStart" should
+      // contain the first "streamStartSize" bytes of the Transport Stream; from this, we get the
+      // PAT, PMT and first PCR, as if we'd indexed the stream from the beginning.
+      // "packetsBeforeResumptionPoint" (if non-NULL) should contain the Transport Stream packets that end with packet
+      // number "firstTransportPacketNumber" (inclusive).  From these, we get the PCR that was current at the resumption
+      // point, so that the offset that compensates for any earlier decrease in the PCR is carried over into the index
+      // records that we add.  (Otherwise, we assume that the PCR has never decreased.)
+
+  typedef void (pcrHandlerFunc)(void* clientData, unsigned long transportPacketNumber, float pcr);
+  void setPCRHandler(pcrHandlerFunc* handler, void* clientData);
+      // Arranges for "handler" to be called with each PCR that we see (from the Transport Stream packet with number
+      // "transportPacketNumber").  This lets a caller that indexes a stream in several parts (e.g., concurrently)
+      // recompute the PCRs of the resulting index records.  (If a handler is set, we don't also report decreases in
+      // the PCR ourself, because the handler knows better where these occur.)
+
+  unsigned long numTransportPacketsIndexed() const { return fInputTransportPacketCounter + 1; }
+      // (including any before a resumption point)
+
 protected:
   MPEG2IFrameIndexFromTransportStream(UsageEnvironment& env,
 				      FramedSource* inputSource);
@@ -63,10 +90,12 @@ private:
   static void handleInputClosure(void* clientData);
   void handleInputClosure1();
 
+  Boolean analyzeTransportPacket(unsigned char* pkt, Boolean tablesAndPCROnly = False);
+      // returns False iff the packet was bad (in which case we've handled it as if the input source ended)
   void analyzePAT(unsigned char* pkt, unsigned size);
   void analyzePMT(unsigned char* pkt, unsigned size);
 
-  Boolean deliverIndexRecord();
+  Boolean deliverIndexRecords();
   Boolean parseFrame();
   Boolean parseToNextCode(unsigned char& nextCode);
   void compactParseBuffer();
@@ -78,11 +107,16 @@ private:
   unsigned long fInputTransportPacketCounter;
   unsigned fClosureNumber;
   u_int8_t fLastContinuityCounter;
+  u_int8_t fFirstPacketStartOffset; // used (once) if we're resuming indexing
   float fFirstPCR, fLastPCR;
   Boolean fHaveSeenFirstPCR;
+  pcrHandlerFunc* fPCRHandler;
+  void* fPCRHandlerClientData;
   u_int16_t fPMT_PID, fVideo_PID;
       // Note: We assume: 1 program per Transport Stream; 1 video stream per program
-  unsigned char fInputBuffer[TRANSPORT_PACKET_SIZE];
+  unsigned char* fInputBuffer; // holds several Transport Stream packets, to reduce the number of reads from our source
+  unsigned fInputBufferPacketStart;
+  unsigned fInputBufferDataEnd;
   unsigned char* fParseBuffer;
   unsigned fParseBufferSize;
   unsigned fParseBufferFrameStart;
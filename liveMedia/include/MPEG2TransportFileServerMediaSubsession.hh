@@ -83,6 +83,7 @@ private: // redefined virtual functions
 
   virtual void testScaleFactor(float& scale);
   virtual float duration() const;
+  virtual char const* getFileByteRange(double seekNPT, double streamDuration, u_int64_t& startByte, u_int64_t& numBytes);
 
 private:
   ClientTrickPlayState* lookupClient(unsigned clientSessionId);
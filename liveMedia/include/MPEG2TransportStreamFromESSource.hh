@@ -37,6 +37,11 @@ public:
       // is used as the stream's PID.  Otherwise (if "PID" is -1) the 'stream_id' is used as
       // the PID.
 
+  void setOneFramePerPESPacket(Boolean oneFramePerPESPacket = True);
+      // If set, each input frame is delivered in its own PES packet (rather than being combined with following frames,
+      // until the PES packet reaches a minimum size).  This reduces latency, and means that the output Transport Stream
+      // can be split (e.g., into HLS segments) at any frame boundary.
+
   static unsigned maxInputESFrameSize;
 
 protected:
@@ -58,6 +63,7 @@ private:
   class InputESSourceRecord* fInputSources;
   unsigned fVideoSourceCounter, fAudioSourceCounter;
   Boolean fAwaitingBackgroundDelivery;
+  unsigned fLowWaterMark; // the minimum size of each PES packet that we deliver
 };
 
 #endif
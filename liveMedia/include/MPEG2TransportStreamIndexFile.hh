@@ -30,6 +30,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #define INDEX_RECORD_SIZE 11
 
+#ifndef MAX_CACHED_INDEX_FILE_SIZE
+#define MAX_CACHED_INDEX_FILE_SIZE (128*1024*1024)
+#endif
+    // Index files no larger than this are read (once) into memory, and their contents shared by all
+    // "MPEG2TransportStreamIndexFile" objects (within the same "UsageEnvironment") that use the same file.
+    // Larger index files are read from the file system, as needed.
+
+class IndexFileData; // forward
+
 class MPEG2TransportStreamIndexFile: public Medium {
 public:
   static MPEG2TransportStreamIndexFile* createNew(UsageEnvironment& env,
@@ -84,7 +93,8 @@ private:
 
 private:
   char* fFileName;
-  FILE* fFid; // used internally when reading from the file
+  IndexFileData* fData; // if non-NULL, a shared, in-memory copy of the file
+  FILE* fFid; // used internally when reading from the file (if "fData" is NULL)
   int fMPEGVersion;
   unsigned long fCurrentIndexRecordNum; // within "fFid"
   float fCachedPCR;
@@ -54,8 +54,11 @@ protected: // redefined virtual functions
 
 private:
   char* fAuxSDPLine;
-  char fDoneFlag; // used when setting up "fAuxSDPLine"
+  char fDoneFlag; // used when setting up "fAuxSDPLine" (if "fConfigStr" can't be read directly from the file)
   RTPSink* fDummyRTPSink; // ditto
+  Boolean fHaveReadConfig;
+  u_int8_t fProfileAndLevelIndication;
+  char* fConfigStr;
 };
 
 #endif
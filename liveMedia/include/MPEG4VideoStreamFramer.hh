@@ -72,4 +72,16 @@ private:
   friend class MPEG4VideoStreamParser; // hack
 };
 
+// A routine for reading - directly, and synchronously - the 'configuration' information (the Visual Object Sequence,
+// Visual Object and Video Object Layer headers) from the start of a MPEG-4 Video Elementary Stream file.  This is much
+// cheaper than playing the file through a "MPEG4VideoStreamFramer" (and a dummy "RTPSink") just to learn this information
+// - e.g., for a SDP description:
+Boolean readMPEG4VideoConfigFromFile(UsageEnvironment& env, char const* fileName,
+				     u_int8_t& profileAndLevelIndication,
+				     unsigned char*& configBytes, unsigned& numConfigBytes,
+				     unsigned maxBytesToRead = 1000000);
+    // Returns True iff the 'configuration' headers (and the start code of the first GOV or VOP that follows them) were found
+    // within the first "maxBytesToRead" bytes of the file, in which case the caller is responsible for delete[]ing
+    // "configBytes".  (If False is returned, "configBytes" is set to NULL.)
+
 #endif
@@ -49,6 +49,9 @@ public:
   unsigned timecodeScale() { return fTimecodeScale; } // in nanoseconds
   float segmentDuration() { return fSegmentDuration; } // in units of "timecodeScale()"
   float fileDuration(); // in seconds
+  Boolean supportsTrickPlay();
+    // Returns True iff the file has 'Cues', and its chosen video track is H.264 or H.265.  (In this case, 'trick play'
+    // (fast-forward or reverse play) can be implemented by streaming just the video 'key frames' that the 'Cues' point to.)
   
   char const* fileName() const { return fFileName; }
 
@@ -79,6 +82,9 @@ private:
   void addTrack(MatroskaTrack* newTrack, unsigned trackNumber);
   void addCuePoint(double cueTime, u_int64_t clusterOffsetInFile, unsigned blockNumWithinCluster);
   Boolean lookupCuePoint(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
+  Boolean lookupNextCuePoint(double& cueTime, u_int64_t& resultClusterOffsetInFile, unsigned& resultBlockNumWithinCluster);
+    // Like "lookupCuePoint()", except that it looks up the first cue point whose time is strictly greater than "cueTime".
+    // Returns False if there's no such cue point.
   void printCuePoints(FILE* fid);
 
   void removeDemux(MatroskaDemux* demux);
@@ -165,6 +171,7 @@ private:
   void removeTrack(unsigned trackNumber);
   void continueReading(); // called by a demuxed track to tell us that it has a pending read ("doGetNextFrame()")
   void seekToTime(double& seekNPT);
+  void setScale(float scale);
 
   static void handleEndOfFile(void* clientData);
   void handleEndOfFile();
@@ -29,6 +29,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #include "MatroskaFile.hh"
 #endif
 
+class MatroskaFileServerMediaSubsession; // forward
+
 class MatroskaFileServerDemux: public Medium {
 public:
   typedef void (onCreationFunc)(MatroskaFileServerDemux* newDemux, void* clientData);
@@ -58,6 +60,10 @@ public:
   FramedSource* newDemuxedTrack(unsigned clientSessionId, unsigned trackNumber);
     // Used by the "ServerMediaSubsession" objects to implement their "createNewStreamSource()" virtual function.
 
+  MatroskaFileServerMediaSubsession*& videoSubsession() { return fVideoSubsession; }
+    // The "ServerMediaSubsession" object (if any) for our file's chosen video track.  (The other "ServerMediaSubsession"
+    // objects use this to find out whether a client session is also streaming this track - e.g., during trick play.)
+
 private:
   MatroskaFileServerDemux(UsageEnvironment& env, char const* fileName,
 			  onCreationFunc* onCreation, void* onCreationClientData,
@@ -79,6 +85,8 @@ private:
   // Used to set up demuxing, to implement "newDemuxedTrack()":
   unsigned fLastClientSessionId;
   MatroskaDemux* fLastCreatedDemux;
+
+  MatroskaFileServerMediaSubsession* fVideoSubsession;
 };
 
 #endif
@@ -125,6 +125,11 @@ public:
 
   MediaLookupTable* mediaTable;
   void* socketTable;
+  void* tsIndexFileTable;
+  void* rtpPacer;
+  void* responseBufferPool;
+  void* proxyKeepWarmTimers;
+  void* sharedRTSPConnections;
 
 protected:
   _Tables(UsageEnvironment& env);
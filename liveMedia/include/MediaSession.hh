@@ -102,7 +102,9 @@ protected:
   virtual MediaSubsession* createNewMediaSubsession();
 
   Boolean initializeWithSDP(char const* sdpDescription);
-  Boolean parseSDPLine(char const* input, char const*& nextLine);
+  Boolean initializeWithSDPLines(char const* sdpDescription, char* sdpLines);
+  Boolean parseSDPLine(char* input, char*& nextLine);
+      // '\0'-terminates (in place) the line that begins at "input", and sets "nextLine" to the start of the next line (if any)
   Boolean parseSDPLine_s(char const* sdpLine);
   Boolean parseSDPLine_i(char const* sdpLine);
   Boolean parseSDPLine_c(char const* sdpLine);
@@ -166,6 +168,8 @@ public:
   char const* mediumName() const { return fMediumName; }
   char const* codecName() const { return fCodecName; }
   char const* protocolName() const { return fProtocolName; }
+  Boolean usesAVPF() const { return fUsesAVPF; }
+      // True iff the "m=" line's <proto> was "RTP/AVPF" (RTP with RTCP feedback), rather than "RTP/AVP"
   char const* controlPath() const { return fControlPath; }
   Boolean isSSM() const { return fSourceFilterAddr.s_addr != 0; }
 
@@ -173,6 +177,12 @@ public:
   unsigned short videoHeight() const { return fVideoHeight; }
   unsigned videoFPS() const { return fVideoFPS; }
   unsigned numChannels() const { return fNumChannels; }
+  Boolean nacksOffered() const { return fNACKsOffered; }
+      // True iff the SDP description included "a=rtcp-fb:<fmt> nack" (i.e., the server will retransmit lost packets)
+  unsigned char rtxPayloadFormat() const { return fRTXPayloadFormat; }
+      // the payload format used for RFC 4588 ("RTX") retransmissions, or 0 if none
+  unsigned char fecPayloadFormat() const { return fFECPayloadFormat; }
+      // the payload format used for RFC 5109 ("ulpfec") FEC packets, or 0 if none
   float& scale() { return fScale; }
   float& speed() { return fSpeed; }
 
@@ -283,6 +293,7 @@ protected:
   Boolean parseSDPLine_b(char const* sdpLine);
   Boolean parseSDPAttribute_rtpmap(char const* sdpLine);
   Boolean parseSDPAttribute_rtcpmux(char const* sdpLine);
+  Boolean parseSDPAttribute_rtcpfb(char const* sdpLine);
   Boolean parseSDPAttribute_control(char const* sdpLine);
   Boolean parseSDPAttribute_range(char const* sdpLine);
   Boolean parseSDPAttribute_fmtp(char const* sdpLine);
@@ -307,8 +318,12 @@ protected:
   char* fMediumName;
   char* fCodecName;
   char* fProtocolName;
+  Boolean fUsesAVPF;
   unsigned fRTPTimestampFrequency;
   Boolean fMultiplexRTCPWithRTP;
+  Boolean fNACKsOffered;
+  unsigned char fRTXPayloadFormat;
+  unsigned char fFECPayloadFormat;
   char* fControlPath; // holds optional a=control: string
   struct in_addr fSourceFilterAddr; // used for SSM
   unsigned fBandwidth; // in kilobits-per-second, from b= line
@@ -25,11 +25,22 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _RTP_SINK_HH
 #include "RTPSink.hh"
 #endif
+#ifndef _RTP_PACER_HH
+#include "RTPPacer.hh"
+#endif
+
+class SentRTPPacket; // forward
+class ULPFECEncoder; // forward
 
 class MultiFramedRTPSink: public RTPSink {
 public:
   void setPacketSizes(unsigned preferredPacketSize, unsigned maxPacketSize);
 
+  // redefined virtual functions:
+  virtual Boolean enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType = 0);
+  virtual Boolean enableFEC(unsigned rowSize, unsigned numRows, unsigned char fecPayloadType);
+  virtual Boolean enablePacing(unsigned maxBitrate = 0, unsigned maxBurstSize = 0, Boolean useKernelPacing = False);
+
   typedef void (onSendErrorFunc)(void* clientData);
   void setOnSendErrorFunc(onSendErrorFunc* onSendErrorFunc, void* onSendErrorFuncData) {
     // Can be used to set a callback function to be called if there's an error sending RTP packets on our socket.
@@ -96,6 +107,7 @@ public: // redefined virtual functions:
 
 protected: // redefined virtual functions:
   virtual Boolean continuePlaying();
+  virtual void retransmitPacket(u_int16_t seqNum);
 
 private:
   void buildAndSendPacket(Boolean isFirstPacket);
@@ -112,6 +124,9 @@ private:
 			  struct timeval presentationTime,
 			  unsigned durationInMicroseconds);
   Boolean isTooBigForAPacket(unsigned numBytes) const;
+  void noteInputFrame(unsigned frameSize, struct timeval const& presentationTime);
+  unsigned pacingDelay(unsigned numBytesSent, struct timeval const& timeNow);
+  void updatePacingRate();
 
   static void ourHandleClosure(void* clientData);
 
@@ -135,6 +150,26 @@ private:
 
   onSendErrorFunc* fOnSendErrorFunc;
   void* fOnSendErrorData;
+
+  // Used to implement retransmissions:
+  SentRTPPacket* fSentPacketHistory; // indexed by RTP sequence number (modulo "fSentPacketHistorySize")
+  unsigned fSentPacketHistorySize;
+  u_int16_t fRTXSeqNo;
+  u_int32_t fRTXSSRC;
+
+  // Used to implement FEC:
+  ULPFECEncoder* fFECEncoder;
+  unsigned fFECRowSize, fFECNumRows;
+
+  // Used to implement pacing:
+  unsigned fPacingMaxBitrate; // 0 means 'automatic' (i.e., based on "fInputBitrate")
+  unsigned fPacingMaxBurstSize;
+  Boolean fUseKernelPacing;
+  PacingTokenBucket fPacingBucket;
+  // Our input's bitrate, measured over each 'window' of (at least) one second of presentation time:
+  struct timeval fInputWindowStart;
+  unsigned fInputWindowNumBytes;
+  unsigned fInputBitrate; // smoothed over recent windows; 0 if not yet known
 };
 
 #endif
@@ -28,6 +28,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 class BufferedPacket; // forward
 class BufferedPacketFactory; // forward
+class NACKGenerator; // forward
+class ULPFECDecoder; // forward
 
 class MultiFramedRTPSource: public RTPSource {
 protected:
@@ -55,6 +57,11 @@ protected:
   // redefined virtual functions:
   virtual void doStopGettingFrames();
 
+public:
+  // redefined virtual functions:
+  virtual Boolean enableNACKs(unsigned char rtxPayloadType = 0);
+  virtual Boolean enableFEC(unsigned char fecPayloadType);
+
 private:
   // redefined virtual functions:
   virtual void doGetNextFrame();
@@ -64,8 +71,13 @@ private:
   void reset();
   void doGetNextFrame1();
 
+  void sendNACKs();
+  static void sendNACKs(void* source);
+
   static void networkReadHandler(MultiFramedRTPSource* source, int /*mask*/);
   void networkReadHandler1();
+  Boolean processIncomingPacket(BufferedPacket* bPacket, struct sockaddr_in const& fromAddress, Boolean wasRecovered);
+      // returns True iff the packet was stored (in "fReorderingBuffer")
 
   Boolean fAreDoingNetworkReads;
   BufferedPacket* fPacketReadInProgress;
@@ -76,6 +88,13 @@ private:
 
   // A buffer to (optionally) hold incoming pkts that have been reorderered
   class ReorderingPacketBuffer* fReorderingBuffer;
+
+  // State used to request retransmission of missing packets (if "enableNACKs()" was called):
+  NACKGenerator* fNACKGenerator;
+  TaskToken fNACKRetryTask;
+
+  // State used to recover missing packets using FEC packets (if "enableFEC()" was called):
+  ULPFECDecoder* fFECDecoder;
 };
 
 
@@ -92,6 +111,8 @@ public:
   unsigned useCount() const { return fUseCount; }
 
   Boolean fillInData(RTPInterface& rtpInterface, struct sockaddr_in& fromAddress, Boolean& packetReadWasIncomplete);
+  Boolean fillInData(unsigned char const* data, unsigned dataSize);
+      // used for packets that were recovered (e.g., using FEC), rather than read from the network
   void assignMiscParams(unsigned short rtpSeqNo, unsigned rtpTimestamp,
 			struct timeval presentationTime,
 			Boolean hasBeenSyncedUsingRTCP,
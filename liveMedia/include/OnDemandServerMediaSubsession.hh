@@ -34,6 +34,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _RTCP_HH
 #include "RTCP.hh"
 #endif
+#ifndef _RTP_CONGESTION_ESTIMATOR_HH
+#include "RTPCongestionEstimator.hh"
+#endif
+
+typedef void CongestionFeedbackHandlerFunc(void* clientData, unsigned clientSessionId,
+					   RTPCongestionEstimator const& estimate);
 
 class OnDemandServerMediaSubsession: public ServerMediaSubsession {
 protected: // we're a virtual base class
@@ -74,6 +80,7 @@ protected: // redefined virtual functions
   virtual FramedSource* getStreamSource(void* streamToken);
   virtual void getRTPSinkandRTCP(void* streamToken,
 				 RTPSink const*& rtpSink, RTCPInstance const*& rtcp);
+  virtual Boolean getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc);
   virtual void deleteStream(unsigned clientSessionId, void*& streamToken);
 
 protected: // new virtual functions, possibly redefined by subclasses
@@ -115,6 +122,37 @@ public:
     // handled by whatever handler existed when the client sent its first RTSP "PLAY" command.)
     // (Call with (NULL, NULL) to remove an existing handler - for future clients only)
 
+  void enableRetransmissions(unsigned historySize = 512, Boolean useRTX = True);
+    // Has each future "RTPSink" keep its "historySize" most recently-sent packets, so that it can retransmit them
+    // in response to RTCP "NACK"s from clients.  This is advertised in our SDP description ("a=rtcp-fb:<fmt> nack").
+    // If "useRTX" is True, retransmissions are sent in RFC 4588 format, using an extra (advertised) payload type.
+    // Note: This should be called before the first call to "sdpLines()" for this subsession.
+
+  void enableFEC(unsigned rowSize = 10, unsigned numRows = 4);
+    // Has each future "RTPSink" also send RFC 5109 ("ulpfec") FEC packets, using an extra (advertised) payload type.
+    // (See "RTPSink::enableFEC()" for the meaning of the parameters.)
+    // Note: This should be called before the first call to "sdpLines()" for this subsession.
+
+  void enablePacing(unsigned maxBitrate = 0, unsigned maxBurstSize = 0, Boolean useKernelPacing = False);
+    // Has each future "RTPSink" pace its outgoing packets, rather than sending each frame's packets back-to-back.
+    // (See "RTPSink::enablePacing()" for the meaning of the parameters.)
+
+  void setCongestionFeedbackHandler(CongestionFeedbackHandlerFunc* handler, void* clientData);
+    // Sets a handler to be called - with an updated estimate of the network congestion to that client - each time that
+    // a RTCP "RR" arrives from any future client.  The handler could use this to (for example) have the client's stream
+    // source switch to a lower- or higher-bitrate rendition.  (The handler must not close the client's stream.)
+    // (Call with (NULL, NULL) to remove an existing handler.)
+
+  void enableFrameDroppingUnderCongestion(Boolean enable = True);
+    // Has each future stream's "RTPSink" drop frames (see "RTPSink::setFrameDropLevel()") when its clients' networks
+    // are congested.  The drop level used is the "congestionLevel()" of the most congested client.
+    // (Currently, only H.264 and H.265 video "RTPSink"s can drop frames.)
+
+  void setSDPLines(char const* sdpLines);
+    // Sets our media-level SDP lines directly (e.g., from a cache of previously-generated SDP descriptions),
+    // so that "sdpLines()" won't need to create dummy source and "RTPSink" objects (and read media data) to generate them.
+    // Note: This should be called before the first call to "sdpLines()" for this subsession.
+
   void sendRTCPAppPacket(u_int8_t subtype, char const* name,
 			 u_int8_t* appDependentData, unsigned appDependentDataSize);
     // Sends a custom RTCP "APP" packet to the most recent client (if "reuseFirstSource" was False),
@@ -129,6 +167,7 @@ private:
   void setSDPLinesFromRTPSink(RTPSink* rtpSink, FramedSource* inputSource,
 			      unsigned estBitrate);
       // used to implement "sdpLines()"
+  void enableLossRecoveryFor(RTPSink* rtpSink);
 
 protected:
   char* fSDPLines;
@@ -138,10 +177,19 @@ private:
   Boolean fReuseFirstSource;
   portNumBits fInitialPortNum;
   Boolean fMultiplexRTCPWithRTP;
+  unsigned fRetransmissionHistorySize; // 0 if retransmissions are not enabled
+  Boolean fUseRTX;
+  unsigned fFECRowSize, fFECNumRows; // "fFECRowSize" is 0 if FEC is not enabled
+  Boolean fPacingEnabled;
+  unsigned fPacingMaxBitrate, fPacingMaxBurstSize;
+  Boolean fUseKernelPacing;
   void* fLastStreamToken;
   char fCNAME[100]; // for RTCP
   RTCPAppHandlerFunc* fAppHandlerTask;
   void* fAppHandlerClientData;
+  CongestionFeedbackHandlerFunc* fCongestionFeedbackHandler;
+  void* fCongestionFeedbackHandlerClientData;
+  Boolean fDropFramesUnderCongestion;
   friend class StreamState;
 };
 
@@ -203,6 +251,11 @@ public:
   FramedSource* mediaSource() const { return fMediaSource; }
   float& startNPT() { return fStartNPT; }
 
+private:
+  friend class ClientCongestionState;
+  void noteIncomingRR(class ClientCongestionState& clientState);
+  void updateFrameDropLevel();
+
 private:
   OnDemandServerMediaSubsession& fMaster;
   Boolean fAreCurrentlyPlaying;
@@ -222,6 +275,8 @@ private:
 
   Groupsock* fRTPgs;
   Groupsock* fRTCPgs;
+
+  HashTable* fClientCongestionStates; // indexed by client session id; NULL unless we're estimating congestion
 };
 
 #endif
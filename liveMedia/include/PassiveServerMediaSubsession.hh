@@ -70,6 +70,7 @@ protected: // redefined virtual functions
   virtual float getCurrentNPT(void* streamToken);
   virtual void getRTPSinkandRTCP(void* streamToken,
 				 RTPSink const*& rtpSink, RTCPInstance const*& rtcp);
+  virtual Boolean getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc);
   virtual void deleteStream(unsigned clientSessionId, void*& streamToken);
 
 protected:
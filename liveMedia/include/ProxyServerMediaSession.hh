@@ -104,11 +104,20 @@ public:
 					        // for streaming the *proxied* (i.e., back-end) stream
 					    int verbosityLevel = 0,
 					    int socketNumToServer = -1,
-					    MediaTranscodingTable* transcodingTable = NULL);
+					    MediaTranscodingTable* transcodingTable = NULL,
+					    Boolean cacheGOPs = False);
       // Hack: "tunnelOverHTTPPortNum" == 0xFFFF (i.e., all-ones) means: Stream RTP/RTCP-over-TCP, but *not* using HTTP
       // "verbosityLevel" == 1 means display basic proxy setup info; "verbosityLevel" == 2 means display RTSP client protocol also.
       // If "socketNumToServer" is >= 0, then it is the socket number of an already-existing TCP connection to the server.
       //      (In this case, "inputStreamURL" must point to the socket's endpoint, so that it can be accessed via the socket.)
+      // If "cacheGOPs" is True, then - for H.264 and H.265 video tracks - we cache the most recent 'GOP' (i.e., key frame,
+      //      preceded by parameter sets, and all subsequent frames).  Each newly-arriving client is sent this cached data first,
+      //      so that it can begin decoding immediately, rather than having to wait for the next key frame to arrive.
+      //      (The cached frames are sent faster than real time, with presentation times that are rebased to end at that
+      //      of the most recent frame.  This lets the client catch up with the live stream quickly.)
+      //      Note that - because each client's stream then begins at a different point - each client of such a track gets
+      //      its own 'framer' and "RTPSink", rather than sharing them (i.e., the track does not 'reuse the first source').
+      //      This costs some extra memory and CPU time per client.  (Other tracks are not affected.)
 
   virtual ~ProxyServerMediaSession();
 
@@ -120,6 +129,22 @@ public:
   Boolean describeCompletedSuccessfully() const { return fClientMediaSession != NULL; }
     // This can be used - along with "describeCompletdFlag" - to check whether the back-end "DESCRIBE" completed *successfully*.
 
+  static Boolean shareBackEndConnections;
+    // If True (default: False) when a "ProxyServerMediaSession" is created, then its back-end "RTSPClient" uses the same
+    // TCP connection as those of the other such sessions (in the same environment) whose back-end streams come from the
+    // same server (address and port) - rather than opening a connection of its own.  (Each back-end stream still has its own
+    // RTSP session.)  This is useful when proxying several streams from a camera that allows only a few connections.
+
+  void setKeepWarmPolicy(int idleTimeoutSeconds);
+    // By default, we "SETUP" and "PLAY" the back-end stream only when the first front-end client arrives, and "PAUSE" it
+    // as soon as the last front-end client leaves - so each 'first' client must wait for the back-end stream to (re)start.
+    // This function changes this policy, by keeping the back-end stream 'warm' (i.e., playing):
+    //   If "idleTimeoutSeconds" > 0, we "PAUSE" the back-end stream only after it has had no clients for this many seconds.
+    //   If "idleTimeoutSeconds" < 0, we start playing the back-end stream as soon as its "DESCRIBE" completes, and never
+    //     "PAUSE" it.
+    //   If "idleTimeoutSeconds" == 0, we use the default policy (described above).
+    // (Subclasses can also redefine "keepBackEndWarm()" (below) - e.g., to keep the back-end stream warm only at certain times.)
+
 protected:
   ProxyServerMediaSession(UsageEnvironment& env, GenericMediaServer* ourMediaServer,
 			  char const* inputStreamURL, char const* streamName,
@@ -130,7 +155,8 @@ protected:
 			  createNewProxyRTSPClientFunc* ourCreateNewProxyRTSPClientFunc
 			  = defaultCreateNewProxyRTSPClientFunc,
 			  portNumBits initialPortNum = 6970,
-			  Boolean multiplexRTCPWithRTP = False);
+			  Boolean multiplexRTCPWithRTP = False,
+			  Boolean cacheGOPs = False);
 
   // If you subclass "ProxyRTSPClient", then you will also need to define your own function
   // - with signature "createNewProxyRTSPClientFunc" (see above) - that creates a new object
@@ -150,6 +176,12 @@ protected:
   // if it wishes to restrict which subsessions of a stream get proxied - e.g., if it wishes
   // to proxy only video tracks, but not audio (or other) tracks.
 
+  virtual Boolean keepBackEndWarm(unsigned secondsWithoutClients);
+  // If a 'keep warm' policy has been set (using "setKeepWarmPolicy()"), then this function is called (about once per
+  // second) whenever we have no front-end clients, to decide whether the back-end stream should be playing.
+  // ("secondsWithoutClients" is ~0 if we have never had any clients.)  By default, this function implements the policy
+  // that was given to "setKeepWarmPolicy()", but a subclass may redefine it - e.g., to implement a schedule.
+
 protected:
   GenericMediaServer* fOurMediaServer;
   ProxyRTSPClient* fProxyRTSPClient;
@@ -158,9 +190,14 @@ protected:
 private:
   friend class ProxyRTSPClient;
   friend class ProxyServerMediaSubsession;
+  friend class ProxyKeepWarmTimer;
   void continueAfterDESCRIBE(char const* sdpDescription);
   void resetDESCRIBEState(); // undoes what was done by "contineAfterDESCRIBE()"
 
+  void checkKeepWarm(); // called (about once per second) by our server's "ProxyKeepWarmTimer"
+  void warmUpBackEnd();
+  void pauseBackEnd();
+
 private:
   int fVerbosityLevel;
   class PresentationTimeSessionNormalizer* fPresentationTimeSessionNormalizer;
@@ -168,6 +205,10 @@ private:
   MediaTranscodingTable* fTranscodingTable;
   portNumBits fInitialPortNum;
   Boolean fMultiplexRTCPWithRTP;
+  Boolean fCacheGOPs;
+  int fKeepWarmIdleTimeout; // in seconds; see "setKeepWarmPolicy()"
+  Boolean fHaveHadClients;
+  struct timeval fTimeLastHadClients;
 };
 
 
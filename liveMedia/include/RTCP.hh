@@ -85,6 +85,13 @@ public:
       // a specific source address and port.  (Note that if both a specific
       // and a general "RR" handler function is set, then both will be called.)
   void unsetSpecificRRHandler(netAddressBits fromAddress, Port fromPort); // equivalent to setSpecificRRHandler(..., NULL, NULL);
+  Boolean lookupReceiverSSRC(netAddressBits fromAddress, Port fromPort, u_int32_t& ssrc) const;
+      // If a specific "RR" handler is set for "fromAddress" and "fromPort", and a "RR" has arrived from there, sets "ssrc"
+      // to the SSRC of that "RR"'s sender (which identifies its statistics in our "RTPSink"'s "transmissionStatsDB()"),
+      // and returns True.  Otherwise, returns False.
+  u_int32_t lastRRSenderSSRC() const { return fLastRRSenderSSRC; }
+      // The SSRC of the sender of the most recent "RR".  (A "RR" handler can use this - e.g., with our "RTPSink"'s
+      // "transmissionStatsDB()" - to find the statistics that were reported in that "RR".)
   void setAppHandler(RTCPAppHandlerFunc* handlerTask, void* clientData);
       // Assigns a handler routine to be called whenever an "APP" packet arrives.  (To turn off
       // handling, call the function again with "handlerTask" (and "clientData") as NULL.)
@@ -96,6 +103,17 @@ public:
       // of "name" are used.  (If "name" has fewer than 4 bytes, or is NULL,
       // then the remaining bytes are '\0'.)
 
+  void sendNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums);
+      // Sends a RTCP generic "NACK" (RFC 4585), asking the sender of the RTP stream "mediaSSRC" to retransmit the
+      // packets with the given sequence numbers (which should be in increasing order).
+
+  void enableXRReports(Boolean includeVoIPMetrics = False);
+      // Has each of our (receiver) reports also include a RTCP-XR (RFC 3611) packet, containing a "Receiver Reference
+      // Time" block (so that the sender can tell us the round-trip delay), and a "Statistics Summary" block for each
+      // sender - plus (if "includeVoIPMetrics" is True) a "VoIP Metrics" block for each sender.
+      // (Senders don't need to call this; they automatically reply to "Receiver Reference Time" blocks with a
+      //  "DLRR" block.)
+
   Groupsock* RTCPgs() const { return fRTCPInterface.gs(); }
 
   void setStreamSocket(int sockNum, unsigned char streamChannelId);
@@ -141,6 +159,10 @@ private:
         void enqueueReportBlock(RTPReceptionStats* receptionStats);
   void addSDES();
   void addBYE();
+  void addNACK(u_int32_t mediaSSRC, u_int16_t const* seqNums, unsigned numSeqNums);
+  void addXR();
+    void enqueueXRStatisticsSummary(RTPReceptionStats* stats);
+    void enqueueXRVoIPMetrics(RTPReceptionStats* stats);
 
   void sendBuiltPacket();
 
@@ -161,6 +183,7 @@ private:
   RTPSink* fSink;
   RTPSource* fSource;
   Boolean fIsSSMSource;
+  Boolean fSendXRReports, fIncludeXRVoIPMetrics;
 
   SDESItem fCNAME;
   RTCPMemberDatabase* fKnownMembers;
@@ -175,6 +198,7 @@ private:
   int fLastSentSize;
   int fLastReceivedSize;
   u_int32_t fLastReceivedSSRC;
+  u_int32_t fLastRRSenderSSRC;
   int fTypeOfEvent;
   int fTypeOfPacket;
   Boolean fHaveJustSentPacket;
@@ -230,4 +254,16 @@ const unsigned char RTCP_SDES_TOOL = 6;
 const unsigned char RTCP_SDES_NOTE = 7;
 const unsigned char RTCP_SDES_PRIV = 8;
 
+// Generic RTP Feedback ("RTPFB") message types [RFC4585]:
+const unsigned char RTCP_RTPFB_FMT_NACK = 1; // Generic NACK
+
+// Payload-specific Feedback ("PSFB") message types [RFC4585]:
+const unsigned char RTCP_PSFB_FMT_AFB = 15; // Application layer feedback (used for "REMB")
+
+// Extended Report ("XR") block types [RFC3611]:
+const unsigned char RTCP_XR_BT_RRTR = 4; // Receiver Reference Time
+const unsigned char RTCP_XR_BT_DLRR = 5; // Delay since Last Receiver Reference Time
+const unsigned char RTCP_XR_BT_STATS = 6; // Statistics Summary
+const unsigned char RTCP_XR_BT_VOIP = 7; // VoIP Metrics
+
 #endif
@@ -0,0 +1,74 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An estimate of the network congestion between a "RTPSink" and one of its receivers, computed from the
+// receiver's RTCP "RR" (and "REMB") reports.
+// C++ header
+
+#ifndef _RTP_CONGESTION_ESTIMATOR_HH
+#define _RTP_CONGESTION_ESTIMATOR_HH
+
+#ifndef _RTP_SINK_HH
+#include "RTPSink.hh"
+#endif
+
+// Congestion levels:
+#define CONGESTION_NONE 0
+#define CONGESTION_MILD 1 // the sender should reduce its bitrate a little (e.g., by dropping 'disposable' frames)
+#define CONGESTION_SEVERE 2 // the sender should reduce its bitrate a lot (e.g., by sending only 'key' frames)
+
+class RTPCongestionEstimator {
+public:
+  RTPCongestionEstimator(RTPSink& rtpSink);
+  virtual ~RTPCongestionEstimator();
+
+  void noteIncomingRR(u_int32_t receiverSSRC);
+      // Called after a RTCP "RR" from "receiverSSRC" has been noted in our "RTPSink"'s "transmissionStatsDB()".
+      // (Note: A "RTCPInstance"'s "RR" handler can get "receiverSSRC" by calling "lastRRSenderSSRC()".)
+
+  unsigned numReportsReceived() const { return fNumReportsReceived; }
+  unsigned congestionLevel() const { return fCongestionLevel; } // CONGESTION_NONE, CONGESTION_MILD, or CONGESTION_SEVERE
+
+  // The statistics that "congestionLevel()" was computed from:
+  double fractionLost() const { return fFractionLost; } // 0.0-1.0, as reported in the most recent "RR"
+  double smoothedFractionLost() const { return fSmoothedFractionLost; } // 0.0-1.0, averaged over recent "RR"s
+  double roundTripTime() const { return fRoundTripTime; } // in seconds; 0.0 if not (yet) known
+  double minRoundTripTime() const { return fMinRoundTripTime; } // in seconds; 0.0 if not (yet) known
+  double jitter() const { return fJitter; } // in seconds
+  unsigned sendRate() const { return fSendRate; } // bits-per-second sent (to all receivers) since the previous "RR"
+  unsigned receiveRate() const { return fReceiveRate; } // bits-per-second that the receiver got since the previous "RR"
+  unsigned rembBitrate() const { return fREMBBitrate; } // the receiver's most recent "REMB" (in bps), or 0 if none
+  unsigned availableBitrate() const;
+      // Our best guess (in bps) of the bitrate that the receiver can currently handle, or 0 if not (yet) known
+
+private:
+  unsigned levelFromCurrentStats() const;
+
+private:
+  RTPSink& fOurRTPSink;
+  unsigned fNumReportsReceived;
+  unsigned fCongestionLevel;
+  unsigned fNumReportsAtLowerLevel; // used to delay lowering "fCongestionLevel"
+  double fFractionLost, fSmoothedFractionLost;
+  double fRoundTripTime, fMinRoundTripTime;
+  double fJitter;
+  unsigned fSendRate, fReceiveRate, fREMBBitrate;
+  u_int32_t fLastTotalOctetCount, fLastTotalPacketCount;
+  struct timeval fLastRRTime;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Token buckets used to pace outgoing RTP packets - both for an individual "RTPSink", and (optionally) for all
+// (paced) "RTPSink"s that share the same event loop.
+// C++ header
+
+#ifndef _RTP_PACER_HH
+#define _RTP_PACER_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+
+class PacingTokenBucket {
+public:
+  PacingTokenBucket();
+
+  void setRate(unsigned bitrate, unsigned bucketSize);
+      // "bitrate" is in bits-per-second (0 means 'unlimited'); "bucketSize" (the largest burst) is in bytes
+  unsigned bitrate() const { return fBitrate; }
+
+  unsigned consume(unsigned numBytes, struct timeval const& timeNow);
+      // Removes "numBytes" tokens from the bucket (after first adding those that have accumulated since the last call),
+      // and returns the time (in microseconds) until the bucket will no longer be in deficit (i.e., until the next packet
+      // can be sent), or 0 if it's not in deficit now.
+
+private:
+  unsigned fBitrate;
+  double fBucketSize, fNumTokens; // in bytes; "fNumTokens" may be negative
+  struct timeval fLastUpdateTime;
+};
+
+class RTPPacer {
+  // A pacer that limits the total bitrate of all paced "RTPSink"s (see "MultiFramedRTPSink::enablePacing()") in the
+  // same "UsageEnvironment" - e.g., to keep a server's combined output below its network link's rate.
+public:
+  static void setAggregateBitrate(UsageEnvironment& env, unsigned bitrate, unsigned maxBurstSize = 0);
+      // "bitrate" is in bits-per-second; 0 (the default) means 'unlimited'.  If "maxBurstSize" (in bytes) is 0,
+      // we use a default value (enough for a few milliseconds at "bitrate").
+  static RTPPacer* ourPacer(UsageEnvironment& env); // NULL if there's no aggregate limit
+
+  unsigned consume(unsigned numBytes, struct timeval const& timeNow) { return fBucket.consume(numBytes, timeNow); }
+      // called by each paced "RTPSink" (see "PacingTokenBucket::consume()")
+
+protected:
+  RTPPacer();
+  virtual ~RTPPacer();
+
+private:
+  PacingTokenBucket fBucket;
+};
+
+#endif
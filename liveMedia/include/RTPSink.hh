@@ -29,6 +29,31 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #endif
 
 class RTPTransmissionStatsDB; // forward
+class RTPTransmissionStats; // forward
+
+#define QOS_BITRATE_HISTORY_SECONDS 60
+
+// A snapshot of the 'quality of service' of a "RTPSink"'s stream to one receiver, as seen by the sender (i.e., from the
+// packets that it sent, and from that receiver's RTCP reports).  This is cheap to compute (it doesn't iterate over any
+// receivers).
+class RTPQoSSnapshot {
+public:
+  u_int32_t clientSessionId; char const* trackId; // set only by "RTSPServer::getQoSSnapshots()"
+  struct timeval timeTaken;
+
+  // Our own transmissions (which - if the "RTPSink" is shared - went to each of its receivers):
+  u_int64_t numPacketsSent, numBytesSent;
+      // since the "RTPSink" was created (including RTP headers, retransmissions, and FEC packets)
+  unsigned bitrate1s, bitrate10s, bitrate60s; // bits-per-second, over the last 1, 10, and 60 complete seconds
+
+  // From the receiver's "RR"s (all zero if it hasn't sent any - or if the receiver isn't known):
+  u_int32_t receiverSSRC;
+  unsigned numReportsReceived;
+  unsigned totNumPacketsLost; // the receiver's most recently-reported cumulative loss
+  double lossFraction, jitter, roundTripTime; // from its most recent "RR"; times are in seconds
+  double avgLossFraction, avgJitter, avgRoundTripTime; // moving averages over its recent "RR"s
+      // ("roundTripTime" and "avgRoundTripTime" are 0.0 if not known)
+};
 
 class RTPSink: public MediaSink {
 public:
@@ -52,6 +77,12 @@ public:
   virtual char* rtpmapLine() const; // returns a string to be delete[]d
   virtual char const* auxSDPLine();
       // optional SDP line (e.g. a=fmtp:...)
+  char const* sdpTransportProtocol() const; // for use in SDP m= lines
+      // "RTP/AVPF" if we accept RTCP feedback (i.e., NACKs for retransmissions), otherwise "RTP/AVP"
+  char* lossRecoveryPayloadFormats() const; // returns a string to be delete[]d
+      // the extra payload format(s) - for the SDP "m=" line - used for our retransmissions and/or FEC (if any)
+  char* lossRecoverySDPLines() const; // returns a string to be delete[]d
+      // "a=rtcp-fb:", "a=rtpmap:" and "a=fmtp:" lines describing our retransmissions and/or FEC (if any)
 
   u_int16_t currentSeqNo() const { return fSeqNo; }
   u_int32_t presetNextTimestamp();
@@ -89,6 +120,49 @@ public:
   u_int32_t SSRC() const {return fSSRC;}
      // later need a means of changing the SSRC if there's a collision #####
 
+  virtual Boolean enableRetransmissions(unsigned historySize, unsigned char rtxPayloadType = 0);
+      // Keeps the "historySize" most recently-sent packets, so that they can be retransmitted if a receiver asks for
+      // them in a RTCP generic "NACK" (RFC 4585).  If "rtxPayloadType" is non-zero, retransmitted packets are sent
+      // in RFC 4588 ("RTX") format, with this payload type (and their own SSRC and sequence numbers); otherwise they
+      // are sent again unchanged.
+      // Returns False if this kind of "RTPSink" does not support retransmissions (the default).
+  Boolean retransmissionsEnabled() const { return fRetransmissionsEnabled; }
+  unsigned char rtxPayloadType() const { return fRTXPayloadType; } // 0 if RTX is not being used
+  unsigned numPacketsRetransmitted() const { return fNumPacketsRetransmitted; }
+  unsigned numUnsatisfiedRetransmissionRequests() const { return fNumUnsatisfiedRetransmissionRequests; }
+      // the number of "NACK"ed packets that we could not retransmit, because they were no longer in our history
+
+  virtual Boolean enableFEC(unsigned rowSize, unsigned numRows, unsigned char fecPayloadType);
+      // Sends - in addition to our media packets - RFC 5109 ("ulpfec") FEC packets, with payload type "fecPayloadType"
+      // (and their own SSRC and sequence numbers).  A FEC packet is sent for each row of "rowSize" consecutive packets,
+      // and - if "numRows" > 1 - for each column of each block of "numRows" rows.  (This lets receivers recover from
+      // packet loss without retransmissions - e.g., for multicast streams.)
+      // Returns False if this kind of "RTPSink" does not support FEC (the default), or if the parameters are invalid.
+  unsigned char fecPayloadType() const { return fFECPayloadType; } // 0 if FEC is not being used
+  unsigned numFECPacketsSent() const { return fNumFECPacketsSent; }
+
+  virtual Boolean enablePacing(unsigned maxBitrate = 0, unsigned maxBurstSize = 0, Boolean useKernelPacing = False);
+      // Spreads our outgoing packets over time - so that (e.g.) the many packets of a large video key frame don't all
+      // get sent back-to-back - by sending at no more than "maxBitrate" bits-per-second, in bursts of no more than
+      // "maxBurstSize" bytes.  If "maxBitrate" is 0, we use (and keep updating) a multiple of our input's average bitrate.
+      // If "maxBurstSize" is 0, we use a default (a few packets).  (Our packets are also subject to any limit set
+      // by "RTPPacer::setAggregateBitrate()".)  If "useKernelPacing" is True, we also ask the OS to pace our packets
+      // (on Linux, this needs the "fq" queueing discipline).
+      // Returns False if this kind of "RTPSink" does not support pacing (the default), or if "useKernelPacing" was
+      // True but the OS does not support it.  (Pacing is still done in the latter case.)
+  Boolean pacingEnabled() const { return fPacingEnabled; }
+
+  void getQoSSnapshot(RTPQoSSnapshot& snapshot, RTPTransmissionStats const* receiverStats) const;
+      // "receiverStats" (from our "transmissionStatsDB()") identifies the receiver; if NULL, only our own
+      // transmissions are reported.
+
+  virtual Boolean setFrameDropLevel(unsigned level);
+      // Asks us to reduce our bitrate (e.g., in response to network congestion) by not sending some frames:
+      //   0: send all frames (the default)
+      //   1: don't send 'disposable' frames (i.e., frames that no other frame depends upon)
+      //   2: send only 'key' frames
+      // Returns False if this kind of "RTPSink" cannot drop frames (the default).
+
 protected:
   RTPSink(UsageEnvironment& env,
 	  Groupsock* rtpGS, unsigned char rtpPayloadType,
@@ -105,6 +179,12 @@ protected:
   u_int32_t convertToRTPTimestamp(struct timeval tv);
   unsigned packetCount() const {return fPacketCount;}
   unsigned octetCount() const {return fOctetCount;}
+  virtual void retransmitPacket(u_int16_t seqNum);
+      // called when a "NACK" asks for this packet.  (The default implementation does nothing.)
+
+  // used by subclasses:
+  void noteOutgoingPacket(unsigned packetSize, time_t timeNowSecs);
+      // updates the counts used by "getQoSSnapshot()"
 
 protected:
   RTPInterface fRTPInterface;
@@ -113,6 +193,18 @@ protected:
   struct timeval fTotalOctetCountStartTime, fInitialPresentationTime, fMostRecentPresentationTime;
   u_int32_t fCurrentTimestamp;
   u_int16_t fSeqNo;
+  Boolean fRetransmissionsEnabled;
+  unsigned char fRTXPayloadType;
+  unsigned fNumPacketsRetransmitted, fNumUnsatisfiedRetransmissionRequests;
+  unsigned char fFECPayloadType;
+  unsigned fNumFECPacketsSent;
+  Boolean fPacingEnabled;
+
+private:
+  // Used to implement "getQoSSnapshot()":
+  u_int64_t fTotNumPacketsSent, fTotNumBytesSent;
+  unsigned fBytesSentPerSecond[QOS_BITRATE_HISTORY_SECONDS]; // indexed by (time in seconds)%QOS_BITRATE_HISTORY_SECONDS
+  time_t fMostRecentSendSecond;
 
 private:
   // redefined virtual functions:
@@ -132,6 +224,26 @@ private:
 };
 
 
+// The contents of the RTCP-XR (RFC 3611) "Statistics Summary" and "VoIP Metrics" report blocks that a receiver sends
+// about our stream:
+class RTCPXRStatisticsSummary {
+public:
+  u_int8_t flags; // the 'L', 'D', 'J', and 'ToH' bits, which tell which of the following fields are valid
+  u_int16_t beginSeq, endSeq; // the range of sequence numbers (end exclusive) that's being reported upon
+  unsigned lostPackets, dupPackets;
+  unsigned minJitter, maxJitter, meanJitter, devJitter; // in RTP timestamp units
+  u_int8_t minTTLOrHL, maxTTLOrHL, meanTTLOrHL, devTTLOrHL;
+};
+
+class RTCPXRVoIPMetrics {
+public:
+  u_int8_t lossRate, discardRate, burstDensity, gapDensity; // fractions (x256)
+  u_int16_t burstDuration, gapDuration, roundTripDelay, endSystemDelay; // in milliseconds
+  u_int8_t signalLevel, noiseLevel, RERL, Gmin, RFactor, extRFactor, MOS_LQ, MOS_CQ, RXConfig;
+      // (the levels, "RERL", R factors, and MOS scores are 127 if unavailable)
+  u_int16_t JBNominal, JBMaximum, JBAbsMax; // in milliseconds
+};
+
 class RTPTransmissionStats; // forward
 
 class RTPTransmissionStatsDB {
@@ -155,6 +267,14 @@ public:
                       unsigned lossStats, unsigned lastPacketNumReceived,
                       unsigned jitter, unsigned lastSRTime, unsigned diffSR_RRTime);
 
+  // The following is called whenever a RTCP "Receiver Estimated Maximum Bitrate" (REMB) packet is received:
+  void noteIncomingREMB(u_int32_t SSRC, unsigned bitrate);
+
+  // The following are called whenever a RTCP-XR (RFC 3611) block is received from a receiver:
+  void noteIncomingRRTR(u_int32_t SSRC, u_int32_t ntpTimestampMiddle);
+  void noteIncomingXRStatisticsSummary(u_int32_t SSRC, RTCPXRStatisticsSummary const& summary);
+  void noteIncomingXRVoIPMetrics(u_int32_t SSRC, RTCPXRVoIPMetrics const& metrics);
+
   // The following is called when a RTCP BYE packet is received:
   void removeRecord(u_int32_t SSRC);
 
@@ -199,6 +319,24 @@ public:
      // as an 8-bit fixed-point number
   int packetsLostBetweenRR() const;
 
+  // Moving averages over this receiver's recent "RR"s (each new "RR" having a weight of 1/8):
+  unsigned numRRsReceived() const { return fNumRRsReceived; }
+  double avgLossFraction() const { return fAvgLossFraction; }
+  double avgJitter() const { return fAvgJitter; } // in seconds
+  double avgRoundTripTime() const { return fAvgRoundTripTime; } // in seconds (0.0 if not known)
+
+  unsigned rembBitrate() const { return fREMBBitrate; }
+      // The bitrate (in bits-per-second) from the most recently-received "REMB" packet, or 0 if none
+
+  // Information from RTCP-XR (RFC 3611) blocks (if the receiver sends them):
+  Boolean haveXRStatisticsSummary() const { return fHaveXRStatisticsSummary; }
+  RTCPXRStatisticsSummary const& xrStatisticsSummary() const { return fXRStatisticsSummary; }
+  Boolean haveXRVoIPMetrics() const { return fHaveXRVoIPMetrics; }
+  RTCPXRVoIPMetrics const& xrVoIPMetrics() const { return fXRVoIPMetrics; }
+  Boolean getDLRR(u_int32_t& lastRRTR, u_int32_t& delaySinceLastRRTR) const;
+      // If the receiver has sent us a "Receiver Reference Time" block, returns the values for a "DLRR" sub-block
+      // (to be sent in our next RTCP-XR), and returns True.  Otherwise, returns False.
+
 private:
   // called only by RTPTransmissionStatsDB:
   friend class RTPTransmissionStatsDB;
@@ -209,6 +347,8 @@ private:
 		      unsigned lossStats, unsigned lastPacketNumReceived,
                       unsigned jitter,
 		      unsigned lastSRTime, unsigned diffSR_RRTime);
+  void noteIncomingREMB(unsigned bitrate) { fREMBBitrate = bitrate; }
+  void noteIncomingRRTR(u_int32_t ntpTimestampMiddle);
 
 private:
   RTPSink& fOurRTPSink;
@@ -228,6 +368,14 @@ private:
   unsigned fFirstPacketNumReported;
   u_int32_t fLastOctetCount, fTotalOctetCount_hi, fTotalOctetCount_lo;
   u_int32_t fLastPacketCount, fTotalPacketCount_hi, fTotalPacketCount_lo;
+  unsigned fNumRRsReceived;
+  double fAvgLossFraction, fAvgJitter, fAvgRoundTripTime;
+  unsigned fREMBBitrate;
+  Boolean fHaveXRStatisticsSummary, fHaveXRVoIPMetrics, fHaveRRTR;
+  RTCPXRStatisticsSummary fXRStatisticsSummary;
+  RTCPXRVoIPMetrics fXRVoIPMetrics;
+  u_int32_t fLastRRTR; // the middle 32 bits of the NTP timestamp in the most recent "Receiver Reference Time" block
+  struct timeval fTimeRRTRReceived;
 };
 
 #endif
@@ -53,6 +53,32 @@ public:
     fRTCPInstanceForMultiplexedRTCPPackets = rtcpInstance;
   }
   void deregisterForMultiplexedRTCPPackets() { registerForMultiplexedRTCPPackets(NULL); }
+  void registerRTCPInstance(class RTCPInstance* rtcpInstance) { fRTCPInstance = rtcpInstance; }
+      // the "RTCPInstance" (if any) that we use to send feedback (e.g., "NACK"s) about incoming packets
+
+  virtual Boolean enableNACKs(unsigned char rtxPayloadType = 0);
+      // Asks the sender to retransmit missing packets, using RTCP generic "NACK"s (RFC 4585).  If "rtxPayloadType" is
+      // non-zero, then retransmitted packets are expected in RFC 4588 ("RTX") format, with this payload type.
+      // (This requires a "RTCPInstance" for this source.)
+      // Returns False if this kind of "RTPSource" does not support this (the default).
+  Boolean nacksEnabled() const { return fNACKsEnabled; }
+
+  virtual Boolean enableFEC(unsigned char fecPayloadType);
+      // Uses incoming RFC 5109 ("ulpfec") FEC packets - with payload type "fecPayloadType" - to recover lost packets.
+      // Returns False if this kind of "RTPSource" does not support this (the default).
+  unsigned numFECPacketsReceived() const { return fNumFECPacketsReceived; }
+  unsigned numPacketsRecoveredUsingFEC() const { return fNumPacketsRecoveredUsingFEC; }
+      // (Packets that were recovered using FEC are not counted as received in our "receptionStatsDB()".)
+
+  // Loss recovery statistics (if "enableNACKs()" was called):
+  unsigned numPacketsNACKed() const { return fNumPacketsNACKed; }
+  unsigned numPacketsRecovered() const { return fNumPacketsRecovered; }
+  unsigned numPacketsNotRecovered() const { return fNumPacketsNotRecovered; }
+  unsigned minRecoveryTime() const { return fMinRecoveryTime; } // in microseconds
+  unsigned maxRecoveryTime() const { return fMaxRecoveryTime; } // in microseconds
+  unsigned avgRecoveryTime() const { // in microseconds
+    return fNumPacketsRecovered == 0 ? 0 : (unsigned)(fTotRecoveryTime/fNumPacketsRecovered);
+  }
 
   unsigned timestampFrequency() const {return fTimestampFrequency;}
 
@@ -98,6 +124,14 @@ protected:
   Boolean fCurPacketHasBeenSynchronizedUsingRTCP;
   u_int32_t fLastReceivedSSRC;
   class RTCPInstance* fRTCPInstanceForMultiplexedRTCPPackets;
+  class RTCPInstance* fRTCPInstance;
+  Boolean fNACKsEnabled;
+  unsigned char fRTXPayloadFormat;
+  unsigned fNumPacketsNACKed, fNumPacketsRecovered, fNumPacketsNotRecovered;
+  unsigned fMinRecoveryTime, fMaxRecoveryTime;
+  double fTotRecoveryTime;
+  unsigned char fFECPayloadFormat;
+  unsigned fNumFECPacketsReceived, fNumPacketsRecoveredUsingFEC;
 
 private:
   // redefined virtual functions:
@@ -146,13 +180,20 @@ public:
 			  Boolean useForJitterCalculation,
 			  struct timeval& resultPresentationTime,
 			  Boolean& resultHasBeenSyncedUsingRTCP,
-			  unsigned packetSize /* payload only */);
+			  unsigned packetSize /* payload only */,
+			  Boolean wasRecovered = False);
+      // "wasRecovered" is True if the packet wasn't actually received, but was instead recovered (e.g., using FEC) from
+      // other packets.  Such packets are counted separately; they don't count as received (so they don't reduce the
+      // packet loss that we report in RTCP), and they don't affect our inter-packet gap or jitter measurements.
 
   // The following is called whenever a RTCP SR packet is received:
   void noteIncomingSR(u_int32_t SSRC,
 		      u_int32_t ntpTimestampMSW, u_int32_t ntpTimestampLSW,
 		      u_int32_t rtpTimestamp);
 
+  // The following is called whenever a RTCP-XR (RFC 3611) "DLRR" block (reporting on one of our own "RRTR"s) is received:
+  void noteIncomingDLRR(u_int32_t SSRC, unsigned roundTripDelay);
+
   // The following is called when a RTCP BYE packet is received:
   void removeRecord(u_int32_t SSRC);
 
@@ -182,6 +223,8 @@ public:
     return fNumPacketsReceivedSinceLastReset;
   }
   unsigned totNumPacketsReceived() const { return fTotNumPacketsReceived; }
+  unsigned totNumPacketsRecovered() const { return fTotNumPacketsRecovered; }
+      // packets that were recovered (e.g., using FEC), rather than received.  (These are not included in the above.)
   double totNumKBytesReceived() const;
 
   unsigned totNumPacketsExpected() const {
@@ -210,6 +253,18 @@ public:
     return fTotalInterPacketGaps;
   }
 
+  unsigned xrRoundTripDelay() const { return fXRRoundTripDelay; }
+      // The round-trip delay (in units of 1/65536 seconds) computed from the sender's most recent RTCP-XR "DLRR" block,
+      // or 0 if none.  (This lets a receiver measure the round-trip delay; RFC 3611, section 4.5.)
+
+  // Statistics for the interval since the last RTCP-XR "Statistics Summary" block (RFC 3611, section 4.6):
+  unsigned xrIntervalBeginExtSeqNum() const { return fXRIntervalBeginExtSeqNum; }
+  unsigned xrIntervalNumPacketsReceived() const { return fXRIntervalNumPacketsReceived; }
+  void getXRIntervalJitter(unsigned& minJitter, unsigned& maxJitter,
+			   unsigned& meanJitter, unsigned& devJitter) const; // in RTP timestamp units
+  void resetXRInterval();
+      // called each time the above are used to generate a "Statistics Summary" block
+
 protected:
   // called only by RTPReceptionStatsDB:
   friend class RTPReceptionStatsDB;
@@ -223,7 +278,10 @@ private:
 			  Boolean useForJitterCalculation,
 			  struct timeval& resultPresentationTime,
 			  Boolean& resultHasBeenSyncedUsingRTCP,
-			  unsigned packetSize /* payload only */);
+			  unsigned packetSize /* payload only */,
+			  Boolean wasRecovered);
+  void computePresentationTime(u_int32_t rtpTimestamp, unsigned timestampFrequency, struct timeval const& timeNow,
+			       struct timeval& resultPresentationTime, Boolean& resultHasBeenSyncedUsingRTCP);
   void noteIncomingSR(u_int32_t ntpTimestampMSW, u_int32_t ntpTimestampLSW,
 		      u_int32_t rtpTimestamp);
   void init(u_int32_t SSRC);
@@ -236,6 +294,7 @@ protected:
   u_int32_t fSSRC;
   unsigned fNumPacketsReceivedSinceLastReset;
   unsigned fTotNumPacketsReceived;
+  unsigned fTotNumPacketsRecovered;
   u_int32_t fTotBytesReceived_hi, fTotBytesReceived_lo;
   Boolean fHaveSeenInitialSequenceNumber;
   unsigned fBaseExtSeqNumReceived;
@@ -251,6 +310,10 @@ protected:
   struct timeval fLastPacketReceptionTime;
   unsigned fMinInterPacketGapUS, fMaxInterPacketGapUS;
   struct timeval fTotalInterPacketGaps;
+  unsigned fXRRoundTripDelay;
+  unsigned fXRIntervalBeginExtSeqNum, fXRIntervalNumPacketsReceived;
+  unsigned fXRIntervalNumJitterSamples, fXRIntervalMinJitter, fXRIntervalMaxJitter;
+  double fXRIntervalJitterSum, fXRIntervalJitterSumOfSquares;
 
 private:
   // Used to convert from RTP timestamp to 'wall clock' time:
@@ -105,6 +105,21 @@ public:
       // (Note: start=-1 means 'resume'; end=-1 means 'play to end')
       // (The "responseHandler" and "authenticator" parameters are as described for "sendDescribeCommand".)
 
+  unsigned sendSetupAndPlayCommands(MediaSession& session,
+				    responseHandler* setupResponseHandler, responseHandler* playResponseHandler,
+				    Boolean streamUsingTCP = False, Boolean forceMulticastOnUnspecified = False,
+				    double start = 0.0f, double end = -1.0f, float scale = 1.0f,
+				    Authenticator* authenticator = NULL);
+      // Sets up, then plays, each of "session"s subsessions that has been (successfully) "initiate()"d, by pipelining
+      // the RTSP commands: A "SETUP" is sent for the first such subsession, and then - as soon as its response gives us
+      // the server's session id - the "SETUP"s for the remaining subsessions, and an aggregate "PLAY", are all sent
+      // together, without waiting for each other's responses.  (If we already have a session id, then all of the commands
+      // are sent immediately.)  This takes 2 round-trips, rather than one per subsession, plus one for the "PLAY".
+      // "setupResponseHandler" is called once for each of these subsessions - in the same order in which a
+      // "MediaSubsessionIterator" returns them - and then "playResponseHandler" is called for the "PLAY".
+      // Returns the "CSeq" sequence number that was used in the first "SETUP" command.
+      // (The other parameters are as described for "sendSetupCommand()" and "sendPlayCommand()".)
+
   // Alternative forms of "sendPlayCommand()", used to send "PLAY" commands that include an 'absolute' time range:
   // (The "absStartTime" string (and "absEndTime" string, if present) *must* be of the form
   //  "YYYYMMDDTHHMMSSZ" or "YYYYMMDDTHHMMSS.<frac>Z")
@@ -187,7 +202,17 @@ public:
 
   char const* url() const { return fBaseURL; }
 
+  void allowConnectionSharing() { fAllowConnectionSharing = True; }
+      // If this is called (before any command is sent), then - rather than opening a TCP connection of our own - we use any
+      // existing connection to the same server (address and port) that was opened by another "RTSPClient" (in the same
+      // "UsageEnvironment") that has also called this.  Each client still has its own RTSP session on the shared connection.
+      // (This is not done if we're tunneling RTSP-over-HTTP.)
+
   static unsigned responseBufferSize;
+  static Boolean useSharedResponseBuffers;
+      // If True (default: False) when a "RTSPClient" is created, then rather than having its own response buffer (of size
+      // "responseBufferSize"), the client borrows one - from a pool shared by all such clients in the same environment -
+      // only while it is receiving a response.  This reduces memory use in applications that run very many "RTSPClient"s.
 
 public: // Some compilers complain if this is "private:"
   // The state of a request-in-progress:
@@ -268,8 +293,29 @@ private:
     RequestRecord* fTail;
   };
 
+  class LivenessToken {
+    // Lets a caller of a handler (that might delete the "RTSPClient") tell - afterwards - whether this happened.
+    // The token is shared by all such (nested) callers, and is deleted when the last of them releases it.
+  public:
+    LivenessToken(RTSPClient* client): fClient(client), fRefCount(1) {}
+
+    RTSPClient* fClient; // set to NULL when the "RTSPClient" is deleted
+    unsigned fRefCount;
+  };
+  LivenessToken* watchForDeletion(); // returns a new reference to our "LivenessToken" (which the caller must release)
+  static Boolean stopWatchingForDeletion(LivenessToken* token);
+      // releases a reference returned by "watchForDeletion()"; returns True iff the "RTSPClient" was deleted meanwhile
+
+  class SharedConnection; // a TCP connection that's shared by several "RTSPClient"s; see "allowConnectionSharing()"
+  void leaveSharedConnection(); // used to implement "resetTCPSockets()"
+  void handleSharedConnectionFailure();
+  void arrangeToReadResponses(); // sets the background read handler for our input socket
+  void handleForwardedResponse(char const* response, unsigned responseSize);
+      // handles a response to one of our requests that was read by another client that shares our connection
+
   void resetTCPSockets();
   void resetResponseBuffer();
+  void getResponseBufferIfNeeded();
   int openConnection(); // -1: failure; 0: pending; 1: success
   int connectToServer(int socketNum, portNumBits remotePortNum); // used to implement "openConnection()"; result values are the same
   char* createAuthenticatorString(char const* cmd, char const* url);
@@ -293,6 +339,9 @@ private:
   Boolean handleGET_PARAMETERResponse(char const* parameterName, char*& resultValueString, char* resultValueStringEnd);
   Boolean handleAuthenticationFailure(char const* wwwAuthenticateParamsStr);
   Boolean resendCommand(RequestRecord* request);
+  unsigned sendRequestsAwaitingSessionId(); // used to implement "sendSetupAndPlayCommands()"
+  void failRequestsAwaitingSessionId(MediaSession& session, int resultCode);
+      // Tells each waiting request for "session" about an error, after a pipelined "SETUP" for "session" failed
   char const* sessionURL(MediaSession const& session) const;
   static void handleAlternativeRequestByte(void*, u_int8_t requestByte);
   void handleAlternativeRequestByte1(u_int8_t requestByte);
@@ -337,9 +386,16 @@ private:
   unsigned char fTCPStreamIdCount; // used for (optional) RTP/TCP
   char* fLastSessionId;
   unsigned fSessionTimeoutParameter; // optionally set in response "Session:" headers
-  char* fResponseBuffer;
+  Boolean fUsesSharedResponseBuffer;
+  char* fResponseBuffer; // if "fUsesSharedResponseBuffer", this is NULL except while we're receiving a response
+  unsigned fResponseBufferSize; // of "fResponseBuffer" (not counting its trailing '\0'); fixed when the buffer is allocated
   unsigned fResponseBytesAlreadySeen, fResponseBufferBytesLeft;
   RequestQueue fRequestsAwaitingConnection, fRequestsAwaitingHTTPTunneling, fRequestsAwaitingResponse;
+  RequestQueue fRequestsAwaitingSessionId; // pipelined requests that can't be sent until we know our session id
+  LivenessToken* fLivenessToken; // non-NULL while a caller is watching (using "watchForDeletion()") for us being deleted
+  Boolean fAllowConnectionSharing;
+  SharedConnection* fSharedConnection; // non-NULL iff we're using a connection that other clients can share
+  RTSPClient* fNextClientOnSharedConnection;
 
   // Support for tunneling RTSP-over-HTTP:
   char fSessionCookie[33];
@@ -27,6 +27,9 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _DIGEST_AUTHENTICATION_HH
 #include "DigestAuthentication.hh"
 #endif
+#ifndef _BASE64_HH
+#include "Base64.hh"
+#endif
 
 class RTSPServer: public GenericMediaServer {
 public:
@@ -89,6 +92,13 @@ public:
     fAllowStreamingRTPOverTCP = False;
   }
 
+  void setAuthenticationNonceLifetime(unsigned seconds) { fAuthenticationNonceLifetime = seconds; }
+      // By default (0), each connection gets its own random nonce (for digest authentication), which only that connection
+      // can use.  If "seconds" > 0, then nonces instead encode the time at which they were created, and the client's
+      // address, and any new connection from the same client address can use them (for "seconds" seconds) without first
+      // getting a "401 Unauthorized" response.  Note, however, that this also lets anyone who sees a valid "Authorization:"
+      // header - and who can use the same client address - replay it on a new connection during this time.
+
   Boolean setUpTunnelingOverHTTP(Port httpPort);
       // (Attempts to) enable RTSP-over-HTTP tunneling on the specified port.
       // Returns True iff the specified port can be used in this way (i.e., it's not already being used for a separate HTTP server).
@@ -97,6 +107,14 @@ public:
       //  and http://images.apple.com/br/quicktime/pdf/QTSS_Modules.pdf
   portNumBits httpServerPortNum() const; // in host byte order.  (Returns 0 if not present.)
 
+  unsigned getQoSSnapshots(char const* streamName, RTPQoSSnapshot* snapshots, unsigned maxNumSnapshots);
+      // Fills in (up to "maxNumSnapshots" elements of) "snapshots" with the current 'quality of service' statistics of
+      // each RTP stream (track) that's being sent to each client of the stream named "streamName" (or, if "streamName"
+      // is NULL, to each client of any stream).  Returns the number of snapshots filled in.
+      // (Each snapshot's reception statistics come from that client's own RTCP "RR"s.  Note, however, that clients that
+      //  share a stream - e.g., with "reuseFirstSource" - share the same "RTPSink", and so get the same transmission
+      //  statistics.)
+
 protected:
   RTSPServer(UsageEnvironment& env,
 	     int ourSocket, Port ourPort,
@@ -187,6 +205,10 @@ public: // should be protected, but some old compilers complain otherwise
     virtual void handleHTTPCmd_TunnelingGET(char const* sessionCookie);
     virtual Boolean handleHTTPCmd_TunnelingPOST(char const* sessionCookie, unsigned char const* extraData, unsigned extraDataSize);
     virtual void handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr);
+    virtual Boolean isReadyForNextRequest();
+        // Returns False if a following (pipelined) request should not be handled yet - e.g., because we're still sending the
+        // response to the current one.  In this case, the request is left (unhandled) in our buffer; a subclass that
+        // redefines this function must later handle it itself.
   protected:
     void resetRequestBuffer();
     void closeSocketsRTSP();
@@ -213,7 +235,7 @@ public: // should be protected, but some old compilers complain otherwise
     char const* fCurrentCSeq;
     Authenticator fCurrentAuthenticator; // used if access control is needed
     char* fOurSessionCookie; // used for optional RTSP-over-HTTP tunneling
-    unsigned fBase64RemainderCount; // used for optional RTSP-over-HTTP tunneling (possible values: 0,1,2,3)
+    Base64StreamDecoder fBase64Decoder; // used for optional RTSP-over-HTTP tunneling
   };
 
   // The state of an individual client session (using one or more sequential TCP connections) handled by a RTSP server:
@@ -283,6 +305,11 @@ private:
   void unnoteTCPStreamingOnSocket(int socketNum, RTSPClientSession* clientSession, unsigned trackNum);
   void stopTCPStreamingOnSocket(int socketNum);
 
+  void createAuthenticationNonce(struct sockaddr_in const& clientAddr, char* resultBuf);
+  Boolean isOurAuthenticationNonce(char const* nonce, unsigned nonceSize, struct sockaddr_in const& clientAddr,
+				   Boolean& isStale);
+      // (Used only if "fAuthenticationNonceLifetime" > 0.)
+
 private:
   friend class RTSPClientConnection;
   friend class RTSPClientSession;
@@ -298,6 +325,8 @@ private:
   unsigned fRegisterOrDeregisterRequestCounter;
   UserAuthenticationDatabase* fAuthDB;
   Boolean fAllowStreamingRTPOverTCP; // by default, True
+  unsigned fAuthenticationNonceLifetime; // by default, 0 (i.e., nonces aren't shared between connections)
+  char fNonceSecret[33]; // used to create (and check) our shared authentication nonces
 };
 
 
@@ -30,6 +30,15 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _TCP_STREAM_SINK_HH
 #include "TCPStreamSink.hh"
 #endif
+#ifndef _TCP_FILE_RANGE_SENDER_HH
+#include "TCPFileRangeSender.hh"
+#endif
+#ifndef _HLS_SEGMENT_CACHE_HH
+#include "HLSSegmentCache.hh"
+#endif
+#ifndef _HLS_LIVE_SEGMENTER_HH
+#include "HLSLiveSegmenter.hh"
+#endif
 
 class RTSPServerSupportingHTTPStreaming: public RTSPServer {
 public:
@@ -39,6 +48,32 @@ public:
 
   Boolean setHTTPPort(Port httpPort) { return setUpTunnelingOverHTTP(httpPort); }
 
+  void enableHLSSegmentCache(unsigned maxMemorySize,
+			     char const* diskCacheDirectoryName = NULL, u_int64_t maxDiskSize = 0);
+      // Causes each HLS segment that we have to generate from a source (i.e., one that isn't just a range of bytes from a file)
+      // to be cached, so that other requests for the same segment (of an unchanged file) are served from the cache, rather
+      // than by creating - and seeking - a new source for it.  (See "HLSSegmentCache.hh".)
+  HLSSegmentCache* hlsSegmentCache() const { return fHLSSegmentCache; } // NULL unless "enableHLSSegmentCache()" was called
+
+  void enableLiveHLS(unsigned targetDuration = 6, unsigned partTargetDurationInMs = 0, unsigned numSegmentsInPlaylist = 6);
+      // Allows live sessions (i.e., those with no known duration - e.g., proxied streams) to be streamed using HLS.  The first
+      // HTTP request for such a session creates a "HLSLiveSegmenter" for it (see "HLSLiveSegmenter.hh" for the parameters),
+      // which is then shared by all HTTP clients of the session, until it's been unused for a while.
+  HLSLiveSegmenter* getLiveSegmenter(ServerMediaSession& session);
+      // Returns the (possibly new) segmenter for "session", or NULL if live HLS is not enabled, or "session" can't be segmented
+
+  virtual char* listStreams(char const* prefix) const;
+      // Returns (in a "new[]"d string) the names - one per line - of the streams (and subdirectories) whose names begin with
+      // "prefix" (a directory name, ending with '/', or "" for the top level).  This is used to answer HTTP "GET"s of a
+      // directory.  Returns NULL if there's no such directory.  (This default implementation always returns NULL.)
+
+  // Redefined virtual functions:
+  virtual void closeAllClientSessionsForServerMediaSession(ServerMediaSession* serverMediaSession);
+      // also closes the session's live segmenter (if any)
+  void closeAllClientSessionsForServerMediaSession(char const* streamName) {
+    GenericMediaServer::closeAllClientSessionsForServerMediaSession(streamName);
+  }
+
 protected:
   RTSPServerSupportingHTTPStreaming(UsageEnvironment& env,
 				    int ourSocket, Port ourPort,
@@ -50,6 +85,18 @@ protected:
 protected: // redefined virtual functions
   virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr);
 
+private:
+  void closeLiveSegmenter(HLSLiveSegmenter* segmenter);
+  static void checkForIdleLiveSegmenters(void* clientData);
+  void checkForIdleLiveSegmenters();
+
+private:
+  HLSSegmentCache* fHLSSegmentCache;
+  Boolean fLiveHLSIsEnabled;
+  unsigned fLiveHLSTargetDuration, fLiveHLSPartTargetDurationInMs, fLiveHLSNumSegmentsInPlaylist;
+  HashTable* fLiveSegmenters; // maps stream names to "HLSLiveSegmenter"s
+  TaskToken fIdleLiveSegmenterCheckTask;
+
 public: // should be protected, but some old compilers complain otherwise
   class RTSPClientConnectionSupportingHTTPStreaming: public RTSPServer::RTSPClientConnection {
   public:
@@ -57,16 +104,64 @@ public: // should be protected, but some old compilers complain otherwise
     virtual ~RTSPClientConnectionSupportingHTTPStreaming();
 
   protected: // redefined virtual functions
+    virtual void handleRequestBytes(int newBytesRead);
+    virtual void handleHTTPCmd_notSupported();
+    virtual void handleHTTPCmd_notFound();
     virtual void handleHTTPCmd_StreamingGET(char const* urlSuffix, char const* fullRequestStr);
+    virtual Boolean isReadyForNextRequest();
 
   protected:
     static void afterStreaming(void* clientData);
+    void afterStreaming();
+
+  private:
+    void releaseCachedSegment();
+    void setHTTPErrorResponse(char const* status, char const* extraHeaders = "");
+        // Sets up a response (with no body) to the current request
+    void sendResponseHeader(char const* status, char const* contentType, unsigned contentLength, char const* extraHeaders);
+    void sendOKResponseHeader(char const* contentType, unsigned contentLength, char const* extraHeaders) {
+      sendResponseHeader("200 OK", contentType, contentLength, extraHeaders);
+    }
+    Boolean sendSegmentResponseHeader(char const* contentType, unsigned segmentSize, char const* extraHeaders,
+				      unsigned& startOffset, unsigned& numBytes);
+        // Sends a "200" response header - or a "206" response header, if the request asked for a (satisfiable) byte range -
+        // and sets "startOffset" and "numBytes" to the part of the segment that we should send.  If the requested range
+        // can't be satisfied, sets a "416" response instead, and returns False.
+    void streamFrom(FramedSource* source, unsigned numBodyBytes);
+        // Sends the response body - which (according to our response header) is "numBodyBytes" bytes long - from "source"
+    void streamPlaylist(char* playlist, unsigned playlistLen);
+    void handleLiveHLSRequest(HLSLiveSegmenter& segmenter, char const* streamName, char const* query);
+    void sendLivePlaylist(HLSLiveSegmenter& segmenter);
+    void sendDeferredErrorResponse(char const* statusLine);
+    void stopWaitingForLivePlaylist();
+    static void livePlaylistMayHaveChanged(void* clientData);
+    void livePlaylistMayHaveChanged();
+    static void livePlaylistWaitTimedOut(void* clientData);
+    void livePlaylistWaitTimedOut();
+    static void idleTimeoutHandler(void* clientData);
 
   private:
     u_int32_t fClientSessionId;
     FramedSource* fStreamSource;
+    HLSCachedSegment* fCachedSegment; // the segment that "fStreamSource" is reading from, if it came from a cache (or segmenter)
     ByteStreamMemoryBufferSource* fPlaylistSource;
     TCPStreamSink* fTCPSink;
+    TCPFileRangeSender* fFileSender; // used instead of "fTCPSink" for segments that are a byte range of a file
+    // HTTP/1.1 connection state:
+    Boolean fIsSendingResponse; // True while we're sending (or waiting to send) a response body; requests are queued meanwhile
+    Boolean fKeepAlive; // True iff the connection stays open after the current response (otherwise we close it)
+    u_int64_t fNumBodyBytes; // the size of the response body that we're sending (as given in its "Content-Length:" header), or 0
+    Boolean fIsSendingFromFile; // True iff we're sending the response body using "fFileSender" (rather than "fTCPSink")
+    Boolean fHaveRange; // True iff the current request has a (single) "Range: bytes=" header
+    unsigned fRangeFirstByte, fRangeLastByte; // "fRangeLastByte" is ~0 for a "<first>-" range
+    unsigned fRangeSuffixLength; // for a "-<suffix-length>" range (in which case "fRangeFirstByte" is ~0)
+    TaskToken fIdleTimeoutTask; // closes a persistent connection that's been idle for too long
+    // State used while we wait to send a live playlist (for a 'blocking playlist reload' request, or before the first segment):
+    HLSLiveSegmenter* fLiveSegmenter; // non-NULL iff we're waiting
+    char* fLivePlaylistStreamName;
+    unsigned fLiveWaitMediaSequenceNumber;
+    int fLiveWaitPartNumber; // -1 if none
+    TaskToken fLiveWaitTimeoutTask;
   };
 };
 
@@ -45,6 +45,16 @@ public:
 
   char* generateSDPDescription(); // based on the entire session
       // Note: The caller is responsible for freeing the returned string
+  char const* sdpDescription();
+      // Like "generateSDPDescription()", except that it returns our cached copy of the SDP description, which the caller
+      // must not free.  (This copy remains valid only until the session - or one of its subsessions - next changes.)
+      // The description is built only when first needed, and then reused until "noteSDPDescriptionChange()" is called.
+      // (However, if some subsession's SDP lines aren't available yet, the description is incomplete, and is not cached:
+      //  It remains valid only until "sdpDescription()" is next called, and a complete one gets built next time.)
+  void noteSDPDescriptionChange();
+      // Discards our cached SDP description, so that a new one - with a new "o=" version - gets built when next needed.
+      // This is called automatically when subsessions are added or deleted, or have their SDP lines replaced, and when
+      // the session's duration is preset; call it yourself if anything else that affects the description changes.
 
   char const* streamName() const { return fStreamName; }
 
@@ -52,10 +62,15 @@ public:
   unsigned numSubsessions() const { return fSubsessionCounter; }
 
   void testScaleFactor(float& scale); // sets "scale" to the actual supported scale
+  void testScaleFactorForClientSession(unsigned clientSessionId, float& scale);
+      // as above, but for a particular client session (whose streams have already been set up)
   float duration() const;
     // a result == 0 means an unbounded session (the default)
     // a result < 0 means: subsession durations differ; the result is -(the largest).
     // a result > 0 means: this is the duration of a bounded session
+  void presetDuration(float duration);
+    // Sets the value that "duration()" will return, without consulting our subsessions (e.g., because
+    // the value was previously computed, and cached).  This is cleared by "deleteAllSubsessions()".
 
   virtual void noteLiveness();
     // called whenever a client - accessing this media - notes liveness.
@@ -84,6 +99,10 @@ protected:
 private: // redefined virtual functions
   virtual Boolean isServerMediaSession() const;
 
+private:
+  char* buildSDPDescription(char const* ipAddressStr, Boolean& isComplete);
+  void testScaleFactor1(float& scale, Boolean forClientSession, unsigned clientSessionId);
+
 private:
   Boolean fIsSSM;
 
@@ -98,8 +117,17 @@ private:
   char* fDescriptionSDPString;
   char* fMiscSDPLines;
   struct timeval fCreationTime;
+  Boolean fHavePresetDuration;
+  float fPresetDuration;
   unsigned fReferenceCount;
   Boolean fDeleteWhenUnreferenced;
+
+  // Our cached SDP description:
+  char* fSDPDescription; // our cached (complete) description; NULL if not (yet) built
+  netAddressBits fSDPDescriptionAddress; // the server address that was used to build it
+  char* fIncompleteSDPDescription; // the last incomplete description that we returned (not cached)
+  unsigned fSDPVersion; // used for the "o=" line; incremented each time a cached description is discarded
+  unsigned fSDPDescriptionChangeCount; // incremented by each "noteSDPDescriptionChange()"
 };
 
 
@@ -166,14 +194,25 @@ public:
      // (This can be useful if you want to get the associated 'Groupsock' objects, for example.)
      // You must not delete these objects, or start/stop playing them; instead, that is done
      // using the "startStream()" and "deleteStream()" functions.
+  virtual Boolean getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc);
+     // If the client has sent us a RTCP "RR" for this stream, sets "ssrc" to the client's SSRC (which identifies its
+     // statistics in our "RTPSink"'s "transmissionStatsDB()"), and returns True.  (The default implementation returns False.)
   virtual void deleteStream(unsigned clientSessionId, void*& streamToken);
 
   virtual void testScaleFactor(float& scale); // sets "scale" to the actual supported scale
+  virtual void testScaleFactorForClientSession(unsigned clientSessionId, float& scale);
+    // As above, but for a particular client session (whose stream has already been set up).  Subclasses can reimplement this
+    // if the scales that they support depend upon which of our session's other subsessions the client is also streaming.
+    // (The default implementation just calls "testScaleFactor()".)
   virtual float duration() const;
     // returns 0 for an unbounded session (the default)
     // returns > 0 for a bounded session
   virtual void getAbsoluteTimeRange(char*& absStartTime, char*& absEndTime) const;
     // Subclasses can reimplement this iff they support seeking by 'absolute' time.
+  virtual char const* getFileByteRange(double seekNPT, double streamDuration, u_int64_t& startByte, u_int64_t& numBytes);
+    // If the data that would be streamed (at normal speed) after seeking to "seekNPT", for "streamDuration" seconds,
+    // is an unmodified, contiguous range of bytes from a file, then returns the name of this file, and sets "startByte"
+    // and "numBytes".  Otherwise, returns NULL (the default).  (This lets the data be sent without creating a source.)
 
   // The following may be called by (e.g.) SIP servers, for which the
   // address and port number fields in SDP descriptions need to be non-zero:
@@ -184,6 +223,10 @@ protected: // we're a virtual base class
   ServerMediaSubsession(UsageEnvironment& env);
   virtual ~ServerMediaSubsession();
 
+  void noteSDPLinesChange();
+      // Subclasses call this if their "sdpLines()" result changes after having been generated once.
+      // (This discards our parent session's cached SDP description.)
+
   char const* rangeSDPLine() const;
       // returns a string to be delete[]d
 
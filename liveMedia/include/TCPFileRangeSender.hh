@@ -0,0 +1,74 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// An object that sends a range of bytes from a file over a TCP output stream - without copying the data through
+// user space (using "sendfile()"), on systems that support this.
+// C++ header
+
+#ifndef _TCP_FILE_RANGE_SENDER_HH
+#define _TCP_FILE_RANGE_SENDER_HH
+
+#ifndef _MEDIA_HH
+#include "Media.hh"
+#endif
+
+#if defined(__linux__) && !defined(NO_SENDFILE)
+#define USE_SENDFILE 1
+#else
+#define TCP_FILE_RANGE_SENDER_BUFFER_SIZE 65536
+#endif
+
+class TCPFileRangeSender: public Medium {
+public:
+  static TCPFileRangeSender* createNew(UsageEnvironment& env, int socketNum);
+  // "socketNum" is the socket number of an existing, writable TCP socket (which should be non-blocking).
+  // The caller is responsible for closing this socket later (when this object no longer exists).
+
+  Boolean startSending(char const* fileName, u_int64_t startByte, u_int64_t numBytes,
+		       TaskFunc* afterFunc, void* afterClientData);
+      // Sends "numBytes" bytes, starting at "startByte", from the file named "fileName", then calls "afterFunc"
+      // (which is also called if the file ends early, or the socket fails).  Returns False (without calling
+      // "afterFunc") iff the file could not be opened.
+  void stopSending();
+
+  u_int64_t numBytesSent() const { return fNumBytesSent; }
+      // the number of bytes sent since "startSending()" was last called.  (When "afterFunc" is called, this is less than
+      // "numBytes" if the file ended early, or the socket failed.)
+
+protected:
+  TCPFileRangeSender(UsageEnvironment& env, int socketNum); // called only by "createNew()"
+  virtual ~TCPFileRangeSender();
+
+private:
+  void sendMore();
+  void onSendingDone();
+
+  static void socketWritableHandler(void* clientData, int mask);
+
+private:
+  int fOutputSocketNum;
+  FILE* fFid; // NULL if we're not currently sending
+  u_int64_t fNextByte, fNumBytesRemaining, fNumBytesSent;
+  TaskFunc* fAfterFunc;
+  void* fAfterClientData;
+#ifndef USE_SENDFILE
+  unsigned char fBuffer[TCP_FILE_RANGE_SENDER_BUFFER_SIZE];
+  unsigned fUnwrittenBytesStart, fUnwrittenBytesEnd;
+#endif
+};
+
+#endif
@@ -33,6 +33,9 @@ public:
   // "socketNum" is the socket number of an existing, writable TCP socket (which should be non-blocking).
   // The caller is responsible for closing this socket later (when this object no longer exists).
 
+  u_int64_t numBytesWritten() const { return fNumBytesWritten; }
+      // the number of bytes written to the socket since "startPlaying()" was last called
+
 protected:
   TCPStreamSink(UsageEnvironment& env, int socketNum); // called only by "createNew()"
   virtual ~TCPStreamSink();
@@ -62,6 +65,7 @@ private:
   unsigned fUnwrittenBytesStart, fUnwrittenBytesEnd;
   Boolean fInputSourceIsOpen, fOutputSocketIsWritable;
   int fOutputSocketNum;
+  u_int64_t fNumBytesWritten;
 };
 
 #endif
@@ -0,0 +1,105 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Generic Forward Error Correction (XOR parity) packets for RTP streams (RFC 5109 "ulpfec" format).
+// These are used by "MultiFramedRTPSink" (to generate FEC packets) and "MultiFramedRTPSource" (to recover lost packets).
+// C++ header
+
+#ifndef _ULPFEC_HH
+#define _ULPFEC_HH
+
+#ifndef _BOOLEAN_HH
+#include "Boolean.hh"
+#endif
+#ifndef _NET_COMMON_H
+#include "NetCommon.h"
+#endif
+
+class ULPFECGroup; // forward
+
+class ULPFECEncoder {
+  // Generates a FEC packet for each 'row' of "rowSize" consecutive media packets.  If "numRows" is > 1, then it also
+  // generates a FEC packet for each 'column' of a block of "numRows" rows (i.e., for each set of "numRows" packets that
+  // are "rowSize" apart).  Row FEC packets recover isolated losses; column FEC packets recover bursts of up to
+  // "rowSize" consecutive losses.
+public:
+  static Boolean parametersAreValid(unsigned rowSize, unsigned numRows);
+      // Each FEC packet can protect only packets within a range of 48 sequence numbers.
+
+  ULPFECEncoder(unsigned rowSize, unsigned numRows, unsigned char fecPayloadType, unsigned maxMediaPacketSize);
+  virtual ~ULPFECEncoder();
+
+  void addMediaPacket(unsigned char const* packet, unsigned packetSize);
+      // Called for each outgoing media packet (including its RTP header), in sequence number order.
+  unsigned char const* nextFECPacket(unsigned& packetSize);
+      // Returns each FEC packet that has been completed by the previous calls to "addMediaPacket()", or NULL if none.
+
+  unsigned numFECPacketsGenerated() const { return fNumFECPacketsGenerated; }
+
+private:
+  void generateFECPacket(ULPFECGroup& group, unsigned char const* timestamp);
+
+private:
+  unsigned fRowSize, fNumRows;
+  unsigned char fFECPayloadType;
+  u_int16_t fFECSeqNo;
+  u_int32_t fFECSSRC;
+  unsigned fPacketIndex; // within the current block of "fRowSize*fNumRows" packets
+  ULPFECGroup* fRowGroup;
+  ULPFECGroup** fColumnGroups; // an array of "fRowSize" (if "fNumRows" > 1)
+
+  // FEC packets that have been generated, but not yet returned by "nextFECPacket()":
+  unsigned char** fFECPackets;
+  unsigned* fFECPacketSizes;
+  unsigned fNumFECPacketsReady, fNextFECPacketIndex;
+  unsigned fNumFECPacketsGenerated;
+};
+
+class ULPFECDecoder {
+  // Keeps copies of recently-received media packets, and uses incoming FEC packets to recover missing ones.
+public:
+  ULPFECDecoder();
+  virtual ~ULPFECDecoder();
+  void reset();
+
+  void addMediaPacket(unsigned char const* packet, unsigned packetSize);
+  void addFECPacket(unsigned char const* packet, unsigned packetSize);
+      // Called for each incoming media or FEC packet (including its RTP header).
+  unsigned char const* nextRecoveredPacket(unsigned& packetSize);
+      // Returns each media packet that can now be recovered (using the FEC packets that we've received), or NULL if none.
+      // (Recovered packets are added to our set of received media packets, so calling this repeatedly can
+      //  recover additional packets.)
+
+  unsigned numFECPacketsReceived() const { return fNumFECPacketsReceived; }
+  unsigned numPacketsRecovered() const { return fNumPacketsRecovered; }
+
+private:
+  class ReceivedPacket* receivedPacket(u_int16_t seqNo) const; // NULL if we don't have it
+  void removeFECPacket(unsigned index);
+
+private:
+  class ReceivedPacket* fMediaPackets; // indexed by sequence number (modulo a fixed size)
+  Boolean fHaveSeenMediaPacket;
+  u_int16_t fHighestSeqNo;
+  u_int32_t fMediaSSRC;
+  class ReceivedPacket* fFECPackets; // in order of arrival
+  unsigned fNumFECPackets;
+  unsigned char* fRecoveredPacket;
+  unsigned fNumFECPacketsReceived, fNumPacketsRecovered;
+};
+
+#endif
@@ -22,6 +22,8 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _OUR_MD5_HH
 #define _OUR_MD5_HH
 
+#include <NetCommon.h> // for u_int32_t, u_int64_t
+
 extern char* our_MD5Data(unsigned char const* data, unsigned dataSize, char* outputDigest);
     // "outputDigest" must be either NULL (in which case this function returns a heap-allocated
     // buffer, which should be later delete[]d by the caller), or else it must point to
@@ -35,4 +37,28 @@ extern unsigned char* our_MD5DataRaw(unsigned char const* data, unsigned dataSiz
     // buffer, which should be later delete[]d by the caller), or else it must point to
     // a (>=)16-byte buffer (which this function will also return).
 
+// The state of a MD5 computation in progress.
+// (This can be used - instead of the functions above - to compute the digest of data that's not contiguous in memory.)
+class MD5Context {
+public:
+  MD5Context();
+  ~MD5Context();
+
+  void addData(unsigned char const* inputData, unsigned inputDataSize);
+  void end(char* outputDigest /*must point to an array of size (>=)33*/);
+  void finalize(unsigned char* outputDigestInBytes /*must point to an array of size (>=)16*/);
+      // Like "end()", except that the argument is a byte array.
+      // This function is used to implement "end()".
+      // (After calling either "end()" or "finalize()", the object must not be used again.)
+
+private:
+  void zeroize(); // to remove potentially sensitive information
+  void transform64Bytes(unsigned char const block[64]); // does the actual MD5 transform
+
+private:
+  u_int32_t fState[4]; // ABCD
+  u_int64_t fBitCount; // number of bits, modulo 2^64
+  unsigned char fWorkingBuffer[64];
+};
+
 #endif
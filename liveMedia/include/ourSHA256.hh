@@ -0,0 +1,62 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Because SHA-256 may not be implemented (at least, with the same interface) on all systems,
+// we have our own implementation.  (This is used - e.g. - for RFC 7616 'Digest' authentication.)
+// C++ header
+
+#ifndef _OUR_SHA256_HH
+#define _OUR_SHA256_HH
+
+#include <NetCommon.h> // for u_int32_t, u_int64_t
+
+extern char* our_SHA256Data(unsigned char const* data, unsigned dataSize, char* outputDigest);
+    // "outputDigest" must be either NULL (in which case this function returns a heap-allocated
+    // buffer, which should be later delete[]d by the caller), or else it must point to
+    // a (>=)65-byte buffer (which this function will also return).
+
+extern unsigned char* our_SHA256DataRaw(unsigned char const* data, unsigned dataSize,
+					unsigned char* outputDigest);
+    // Like "our_SHA256Data()", except that it returns the digest in 'raw' binary form, rather than
+    // as an ASCII hex string.
+    // "outputDigest" must be either NULL (in which case this function returns a heap-allocated
+    // buffer, which should be later delete[]d by the caller), or else it must point to
+    // a (>=)32-byte buffer (which this function will also return).
+
+// The state of a SHA-256 computation in progress.  (This has the same interface as "MD5Context".)
+class SHA256Context {
+public:
+  SHA256Context();
+  ~SHA256Context();
+
+  void addData(unsigned char const* inputData, unsigned inputDataSize);
+  void end(char* outputDigest /*must point to an array of size (>=)65*/);
+  void finalize(unsigned char* outputDigestInBytes /*must point to an array of size (>=)32*/);
+      // Like "end()", except that the argument is a byte array.
+      // (After calling either "end()" or "finalize()", the object must not be used again.)
+
+private:
+  void zeroize(); // to remove potentially sensitive information
+  void transform64Bytes(unsigned char const block[64]); // does the actual SHA-256 transform
+
+private:
+  u_int32_t fState[8]; // ABCDEFGH
+  u_int64_t fBitCount; // number of bits, modulo 2^64
+  unsigned char fWorkingBuffer[64];
+};
+
+#endif
@@ -20,36 +20,12 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "ourMD5.hh"
-#include <NetCommon.h> // for u_int32_t, u_int64_t
 #include <string.h>
 
 #define DIGEST_SIZE_IN_BYTES 16
 #define DIGEST_SIZE_IN_HEX_DIGITS (2*DIGEST_SIZE_IN_BYTES)
 #define DIGEST_SIZE_AS_STRING (DIGEST_SIZE_IN_HEX_DIGITS+1)
 
-// The state of a MD5 computation in progress:
-
-class MD5Context {
-public:
-  MD5Context();
-  ~MD5Context();
-
-  void addData(unsigned char const* inputData, unsigned inputDataSize);
-  void end(char* outputDigest /*must point to an array of size DIGEST_SIZE_AS_STRING*/);
-  void finalize(unsigned char* outputDigestInBytes);
-      // Like "end()", except that the argument is a byte array, of size DIGEST_SIZE_IN_BYTES.
-      // This function is used to implement "end()".
-
-private:
-  void zeroize(); // to remove potentially sensitive information
-  void transform64Bytes(unsigned char const block[64]); // does the actual MD5 transform
-
-private:
-  u_int32_t fState[4]; // ABCD
-  u_int64_t fBitCount; // number of bits, modulo 2^64
-  unsigned char fWorkingBuffer[64];
-};
-
 char* our_MD5Data(unsigned char const* data, unsigned dataSize, char* outputDigest) {
   MD5Context ctx;
 
@@ -96,7 +72,7 @@ void MD5Context::addData(unsigned char const* inputData, unsigned inputDataSize)
   unsigned bufferBytesRemaining = 64 - bufferBytesInUse;
 
   // Then update our bit count:
-  fBitCount += inputDataSize<<3;
+  fBitCount += ((u_int64_t)inputDataSize)<<3;
 
   unsigned i = 0;
   if (inputDataSize >= bufferBytesRemaining) {
@@ -205,8 +181,9 @@ void MD5Context::zeroize() {
 #define S44 21
 
 // Basic MD5 functions:
-#define F(x, y, z) (((x) & (y)) | ((~x) & (z)))
-#define G(x, y, z) (((x) & (z)) | ((y) & (~z)))
+// (For "F()" and "G()", we use equivalent forms - selecting bits using "xor" - that need one fewer operation.)
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
 #define H(x, y, z) ((x) ^ (y) ^ (z))
 #define I(x, y, z) ((y) ^ ((x) | (~z)))
 
@@ -240,9 +217,14 @@ void MD5Context::transform64Bytes(unsigned char const block[64]) {
 
   // Begin by packing "block" into an array ("x") of 16 32-bit values (in little-endian order):
   u_int32_t x[16];
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  // Our native byte order is already little-endian, so we can just copy the block (which need not be aligned):
+  memcpy(x, block, 64);
+#else
   for (unsigned i = 0, j = 0; i < 16; ++i, j += 4) {
     x[i] = ((u_int32_t)block[j]) | (((u_int32_t)block[j+1]) << 8) | (((u_int32_t)block[j+2]) << 16) | (((u_int32_t)block[j+3]) << 24);
   }
+#endif
 
   // Now, perform the transform on the array "x":
 
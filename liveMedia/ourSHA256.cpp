@@ -0,0 +1,229 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// "liveMedia"
+// Copyright (c) 1996-2017 Live Networks, Inc.  All rights reserved.
+// Because SHA-256 may not be implemented (at least, with the same interface) on all systems,
+// we have our own implementation.
+// Implementation
+
+#include "ourSHA256.hh"
+#include <string.h>
+
+#define DIGEST_SIZE_IN_BYTES 32
+#define DIGEST_SIZE_IN_HEX_DIGITS (2*DIGEST_SIZE_IN_BYTES)
+#define DIGEST_SIZE_AS_STRING (DIGEST_SIZE_IN_HEX_DIGITS+1)
+
+char* our_SHA256Data(unsigned char const* data, unsigned dataSize, char* outputDigest) {
+  SHA256Context ctx;
+
+  ctx.addData(data, dataSize);
+
+  if (outputDigest == NULL) outputDigest = new char[DIGEST_SIZE_AS_STRING];
+  ctx.end(outputDigest);
+
+  return outputDigest;
+}
+
+unsigned char* our_SHA256DataRaw(unsigned char const* data, unsigned dataSize,
+				 unsigned char* outputDigest) {
+  SHA256Context ctx;
+
+  ctx.addData(data, dataSize);
+
+  if (outputDigest == NULL) outputDigest = new unsigned char[DIGEST_SIZE_IN_BYTES];
+  ctx.finalize(outputDigest);
+
+  return outputDigest;
+}
+
+
+////////// SHA256Context implementation //////////
+
+SHA256Context::SHA256Context()
+  : fBitCount(0) {
+  // Initialize with magic constants (FIPS 180-4, section 5.3.3):
+  fState[0] = 0x6a09e667;
+  fState[1] = 0xbb67ae85;
+  fState[2] = 0x3c6ef372;
+  fState[3] = 0xa54ff53a;
+  fState[4] = 0x510e527f;
+  fState[5] = 0x9b05688c;
+  fState[6] = 0x1f83d9ab;
+  fState[7] = 0x5be0cd19;
+}
+
+SHA256Context::~SHA256Context() {
+  zeroize();
+}
+
+void SHA256Context::addData(unsigned char const* inputData, unsigned inputDataSize) {
+  // Begin by noting how much of our 64-byte working buffer remains unfilled:
+  u_int64_t const byteCount = fBitCount>>3;
+  unsigned bufferBytesInUse = (unsigned)(byteCount&0x3F);
+  unsigned bufferBytesRemaining = 64 - bufferBytesInUse;
+
+  // Then update our bit count:
+  fBitCount += ((u_int64_t)inputDataSize)<<3;
+
+  unsigned i = 0;
+  if (inputDataSize >= bufferBytesRemaining) {
+    // We have enough input data to do (64-byte) transforms.
+    // Do this now, starting with a transform on our working buffer, then with
+    // (as many as possible) transforms on rest of the input data.
+
+    memcpy(&fWorkingBuffer[bufferBytesInUse], inputData, bufferBytesRemaining);
+    transform64Bytes(fWorkingBuffer);
+    bufferBytesInUse = 0;
+
+    for (i = bufferBytesRemaining; i + 63 < inputDataSize; i += 64) {
+      transform64Bytes(&inputData[i]);
+    }
+  }
+
+  // Copy any remaining (and currently un-transformed) input data into our working buffer:
+  if (i < inputDataSize) {
+    memcpy(&fWorkingBuffer[bufferBytesInUse], &inputData[i], inputDataSize - i);
+  }
+}
+
+void SHA256Context::end(char* outputDigest) {
+  unsigned char digestInBytes[DIGEST_SIZE_IN_BYTES];
+  finalize(digestInBytes);
+
+  // Convert the digest from bytes (binary) to hex digits:
+  static char const hex[]="0123456789abcdef";
+  unsigned i;
+  for (i = 0; i < DIGEST_SIZE_IN_BYTES; ++i) {
+    outputDigest[2*i] = hex[digestInBytes[i] >> 4];
+    outputDigest[2*i+1] = hex[digestInBytes[i] & 0x0F];
+  }
+  outputDigest[2*i] = '\0';
+}
+
+// Routines that unpack 32 and 64-bit values into arrays of bytes (in big-endian order).
+// (These are used to implement "finalize()".)
+
+static void unpack32(unsigned char out[4], u_int32_t in) {
+  for (unsigned i = 0; i < 4; ++i) {
+    out[i] = (unsigned char)((in>>(8*(3-i)))&0xFF);
+  }
+}
+
+static void unpack64(unsigned char out[8], u_int64_t in) {
+  for (unsigned i = 0; i < 8; ++i) {
+    out[i] = (unsigned char)((in>>(8*(7-i)))&0xFF);
+  }
+}
+
+static unsigned char const PADDING[64] = {
+          0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+void SHA256Context::finalize(unsigned char* outputDigestInBytes) {
+  // Unpack our bit count:
+  unsigned char bitCountInBytes[8];
+  unpack64(bitCountInBytes, fBitCount);
+
+  // Before 'finalizing', make sure that we transform any remaining bytes in our working buffer:
+  u_int64_t const byteCount = fBitCount>>3;
+  unsigned bufferBytesInUse = (unsigned)(byteCount&0x3F);
+  unsigned numPaddingBytes
+    = (bufferBytesInUse < 56) ? (56 - bufferBytesInUse) : (64 + 56 - bufferBytesInUse);
+  addData(PADDING, numPaddingBytes);
+
+  addData(bitCountInBytes, 8);
+
+  // Unpack our 'state' into the output digest:
+  for (unsigned i = 0; i < 8; ++i) unpack32(&outputDigestInBytes[4*i], fState[i]);
+
+  zeroize();
+}
+
+void SHA256Context::zeroize() {
+  for (unsigned i = 0; i < 8; ++i) fState[i] = 0;
+  fBitCount = 0;
+  for (unsigned j = 0; j < 64; ++j) fWorkingBuffer[j] = 0;
+}
+
+
+////////// Implementation of the SHA-256 transform ("SHA256Context::transform64Bytes()") //////////
+
+// Constants for the transform (FIPS 180-4, section 4.2.2):
+static u_int32_t const K[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+// Rotate "x" right "n" bits:
+#define ROTATE_RIGHT(x, n) (((x) >> (n)) | ((x) << (32-(n))))
+
+// Basic SHA-256 functions:
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+#define SIGMA0(x) (ROTATE_RIGHT((x), 2) ^ ROTATE_RIGHT((x), 13) ^ ROTATE_RIGHT((x), 22))
+#define SIGMA1(x) (ROTATE_RIGHT((x), 6) ^ ROTATE_RIGHT((x), 11) ^ ROTATE_RIGHT((x), 25))
+#define sigma0(x) (ROTATE_RIGHT((x), 7) ^ ROTATE_RIGHT((x), 18) ^ ((x) >> 3))
+#define sigma1(x) (ROTATE_RIGHT((x), 17) ^ ROTATE_RIGHT((x), 19) ^ ((x) >> 10))
+
+// One round of the transform.  (Rather than moving the working variables at the end of each round,
+// the caller rotates the argument order.)
+#define ROUND(a, b, c, d, e, f, g, h, i) { \
+ u_int32_t const t1 = (h) + SIGMA1(e) + CH((e), (f), (g)) + K[i] + w[i]; \
+ (d) += t1; \
+ (h) = t1 + SIGMA0(a) + MAJ((a), (b), (c)); \
+}
+
+void SHA256Context::transform64Bytes(unsigned char const block[64]) {
+  // Begin by packing "block" into the first 16 entries of the 'message schedule' ("w"), in big-endian order;
+  // then compute the remaining entries:
+  u_int32_t w[64];
+  unsigned i;
+  for (i = 0; i < 16; ++i) {
+    unsigned char const* p = &block[4*i];
+    w[i] = (((u_int32_t)p[0]) << 24) | (((u_int32_t)p[1]) << 16) | (((u_int32_t)p[2]) << 8) | ((u_int32_t)p[3]);
+  }
+  for (; i < 64; ++i) {
+    w[i] = sigma1(w[i-2]) + w[i-7] + sigma0(w[i-15]) + w[i-16];
+  }
+
+  // Now, perform the transform on the array "w":
+  u_int32_t a = fState[0], b = fState[1], c = fState[2], d = fState[3];
+  u_int32_t e = fState[4], f = fState[5], g = fState[6], h = fState[7];
+  for (i = 0; i < 64; i += 8) {
+    ROUND(a, b, c, d, e, f, g, h, i);
+    ROUND(h, a, b, c, d, e, f, g, i+1);
+    ROUND(g, h, a, b, c, d, e, f, i+2);
+    ROUND(f, g, h, a, b, c, d, e, i+3);
+    ROUND(e, f, g, h, a, b, c, d, i+4);
+    ROUND(d, e, f, g, h, a, b, c, i+5);
+    ROUND(c, d, e, f, g, h, a, b, i+6);
+    ROUND(b, c, d, e, f, g, h, a, i+7);
+  }
+
+  fState[0] += a; fState[1] += b; fState[2] += c; fState[3] += d;
+  fState[4] += e; fState[5] += f; fState[6] += g; fState[7] += h;
+
+  // Zeroize sensitive information.
+  for (i = 0; i < 64; ++i) w[i] = 0;
+}
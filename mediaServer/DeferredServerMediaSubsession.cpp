@@ -0,0 +1,218 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A "ServerMediaSubsession" for a media file whose SDP lines are already known (e.g., from a "MediaMetadataCache").
+// It describes the file without reading it; the file's real "ServerMediaSubsession"s (e.g., a demultiplexor for
+// a Matroska file, or the index of a Transport Stream file) are created only when the file is first streamed.
+// Implementation
+
+#include "DeferredServerMediaSubsession.hh"
+#include <liveMedia.hh>
+
+////////// DeferredMediaFile //////////
+
+DeferredMediaFile* DeferredMediaFile
+::createNew(UsageEnvironment& env, char const* fileName, createSessionFunc* createSession,
+	    unsigned numSubsessions, char const* const* sdpLines) {
+  return new DeferredMediaFile(env, fileName, createSession, numSubsessions, sdpLines);
+}
+
+DeferredMediaFile
+::DeferredMediaFile(UsageEnvironment& env, char const* fileName, createSessionFunc* createSession,
+		    unsigned numSubsessions, char const* const* sdpLines)
+  : fEnv(env), fFileName(strDup(fileName)), fCreateSession(createSession), fNumSubsessions(numSubsessions),
+    fRealSession(NULL), fCreationFailed(False), fReferenceCount(0) {
+  fSDPLines = new char*[fNumSubsessions];
+  for (unsigned i = 0; i < fNumSubsessions; ++i) fSDPLines[i] = strDup(sdpLines[i]);
+}
+
+DeferredMediaFile::~DeferredMediaFile() {
+  Medium::close(fRealSession);
+  for (unsigned i = 0; i < fNumSubsessions; ++i) delete[] fSDPLines[i];
+  delete[] fSDPLines;
+  delete[] fFileName;
+}
+
+ServerMediaSubsession* DeferredMediaFile::realSubsession(unsigned index) {
+  if (fRealSession == NULL && !fCreationFailed) {
+    fRealSession = (*fCreateSession)(fEnv, fFileName);
+    if (fRealSession == NULL || fRealSession->numSubsessions() != fNumSubsessions) {
+      // The file must have changed since it was described:
+      fEnv << "Failed to create the subsessions of \"" << fFileName << "\" that were described earlier\n";
+      Medium::close(fRealSession); fRealSession = NULL;
+      fCreationFailed = True;
+    } else {
+      // Our real subsessions already have SDP lines, so don't have them generate these again.  (Note that all of the
+      // subsessions that "DynamicRTSPServer" creates are "OnDemandServerMediaSubsession"s.):
+      ServerMediaSubsessionIterator iter(*fRealSession);
+      for (unsigned i = 0; i < fNumSubsessions; ++i) {
+	((OnDemandServerMediaSubsession*)(iter.next()))->setSDPLines(fSDPLines[i]);
+      }
+    }
+  }
+  if (fRealSession == NULL) return NULL;
+
+  ServerMediaSubsessionIterator iter(*fRealSession);
+  ServerMediaSubsession* subsession;
+  do subsession = iter.next(); while (index-- > 0 && subsession != NULL);
+  return subsession;
+}
+
+////////// DeferredServerMediaSubsession //////////
+
+DeferredServerMediaSubsession* DeferredServerMediaSubsession
+::createNew(UsageEnvironment& env, DeferredMediaFile& file, unsigned index) {
+  return new DeferredServerMediaSubsession(env, file, index);
+}
+
+DeferredServerMediaSubsession
+::DeferredServerMediaSubsession(UsageEnvironment& env, DeferredMediaFile& file, unsigned index)
+  : ServerMediaSubsession(env), fFile(file), fIndex(index), fRealSubsession(NULL) {
+  fFile.addReference();
+}
+
+DeferredServerMediaSubsession::~DeferredServerMediaSubsession() {
+  fFile.removeReference();
+}
+
+ServerMediaSubsession* DeferredServerMediaSubsession::getReal() {
+  if (fRealSubsession == NULL) fRealSubsession = fFile.realSubsession(fIndex);
+  return fRealSubsession;
+}
+
+char const* DeferredServerMediaSubsession::sdpLines() {
+  return fFile.sdpLines(fIndex);
+}
+
+void DeferredServerMediaSubsession
+::getStreamParameters(unsigned clientSessionId, netAddressBits clientAddress,
+		      Port const& clientRTPPort, Port const& clientRTCPPort,
+		      int tcpSocketNum, unsigned char rtpChannelId, unsigned char rtcpChannelId,
+		      netAddressBits& destinationAddress, u_int8_t& destinationTTL,
+		      Boolean& isMulticast, Port& serverRTPPort, Port& serverRTCPPort,
+		      void*& streamToken) {
+  // This is when we first need to read the file:
+  if (getReal() == NULL) {
+    isMulticast = False;
+    streamToken = NULL;
+    return;
+  }
+
+  real()->getStreamParameters(clientSessionId, clientAddress, clientRTPPort, clientRTCPPort,
+			      tcpSocketNum, rtpChannelId, rtcpChannelId, destinationAddress, destinationTTL,
+			      isMulticast, serverRTPPort, serverRTCPPort, streamToken);
+}
+
+// The remaining functions (except for "duration()" and "getAbsoluteTimeRange()") are given a "streamToken" that
+// was returned by our "getStreamParameters()", so our real subsession exists by the time they're called:
+
+void DeferredServerMediaSubsession
+::startStream(unsigned clientSessionId, void* streamToken,
+	      TaskFunc* rtcpRRHandler, void* rtcpRRHandlerClientData,
+	      unsigned short& rtpSeqNum, unsigned& rtpTimestamp,
+	      ServerRequestAlternativeByteHandler* serverRequestAlternativeByteHandler,
+	      void* serverRequestAlternativeByteHandlerClientData) {
+  if (real() == NULL) return;
+  real()->startStream(clientSessionId, streamToken, rtcpRRHandler, rtcpRRHandlerClientData, rtpSeqNum, rtpTimestamp,
+		      serverRequestAlternativeByteHandler, serverRequestAlternativeByteHandlerClientData);
+}
+
+void DeferredServerMediaSubsession::pauseStream(unsigned clientSessionId, void* streamToken) {
+  if (real() != NULL) real()->pauseStream(clientSessionId, streamToken);
+}
+
+void DeferredServerMediaSubsession
+::seekStream(unsigned clientSessionId, void* streamToken, double& seekNPT, double streamDuration, u_int64_t& numBytes) {
+  numBytes = 0;
+  if (real() != NULL) real()->seekStream(clientSessionId, streamToken, seekNPT, streamDuration, numBytes);
+}
+
+void DeferredServerMediaSubsession
+::seekStream(unsigned clientSessionId, void* streamToken, char*& absStart, char*& absEnd) {
+  if (real() != NULL) real()->seekStream(clientSessionId, streamToken, absStart, absEnd);
+}
+
+void DeferredServerMediaSubsession
+::nullSeekStream(unsigned clientSessionId, void* streamToken, double streamEndTime, u_int64_t& numBytes) {
+  numBytes = 0;
+  if (real() != NULL) real()->nullSeekStream(clientSessionId, streamToken, streamEndTime, numBytes);
+}
+
+void DeferredServerMediaSubsession::setStreamScale(unsigned clientSessionId, void* streamToken, float scale) {
+  if (real() != NULL) real()->setStreamScale(clientSessionId, streamToken, scale);
+}
+
+float DeferredServerMediaSubsession::getCurrentNPT(void* streamToken) {
+  return real() == NULL ? 0.0 : real()->getCurrentNPT(streamToken);
+}
+
+FramedSource* DeferredServerMediaSubsession::getStreamSource(void* streamToken) {
+  return real() == NULL ? NULL : real()->getStreamSource(streamToken);
+}
+
+void DeferredServerMediaSubsession
+::getRTPSinkandRTCP(void* streamToken, RTPSink const*& rtpSink, RTCPInstance const*& rtcp) {
+  rtpSink = NULL; rtcp = NULL;
+  if (real() != NULL) real()->getRTPSinkandRTCP(streamToken, rtpSink, rtcp);
+}
+
+Boolean DeferredServerMediaSubsession::getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc) {
+  return real() != NULL && real()->getReceiverSSRC(clientSessionId, streamToken, ssrc);
+}
+
+void DeferredServerMediaSubsession::deleteStream(unsigned clientSessionId, void*& streamToken) {
+  if (real() != NULL) real()->deleteStream(clientSessionId, streamToken);
+}
+
+void DeferredServerMediaSubsession::testScaleFactor(float& scale) {
+  if (getReal() == NULL) {
+    scale = 1;
+  } else {
+    real()->testScaleFactor(scale);
+  }
+}
+
+void DeferredServerMediaSubsession::testScaleFactorForClientSession(unsigned clientSessionId, float& scale) {
+  // This is called (by "RTSPServer") when handling a "PLAY", so the file's real subsessions will already have been created:
+  if (getReal() == NULL) {
+    scale = 1;
+  } else {
+    real()->testScaleFactorForClientSession(clientSessionId, scale);
+  }
+}
+
+float DeferredServerMediaSubsession::duration() const {
+  if (real() != NULL) return real()->duration();
+
+  // Use our session's (already known) duration.  (If its subsessions' durations differ, then this is the largest of them.):
+  float sessionDuration = fParentSession == NULL ? 0.0 : fParentSession->duration();
+  return sessionDuration < 0.0 ? -sessionDuration : sessionDuration;
+}
+
+void DeferredServerMediaSubsession::getAbsoluteTimeRange(char*& absStartTime, char*& absEndTime) const {
+  if (real() != NULL) {
+    real()->getAbsoluteTimeRange(absStartTime, absEndTime);
+  } else {
+    absStartTime = absEndTime = NULL; // our files are not seekable by 'absolute' time
+  }
+}
+
+char const* DeferredServerMediaSubsession
+::getFileByteRange(double seekNPT, double streamDuration, u_int64_t& startByte, u_int64_t& numBytes) {
+  // This is called (by "RTSPServerSupportingHTTPStreaming") before creating a stream, so it needs our real subsession:
+  if (getReal() == NULL) return NULL;
+  return real()->getFileByteRange(seekNPT, streamDuration, startByte, numBytes);
+}
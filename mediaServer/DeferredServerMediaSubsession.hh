@@ -0,0 +1,117 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A "ServerMediaSubsession" for a media file whose SDP lines are already known (e.g., from a "MediaMetadataCache").
+// It describes the file without reading it; the file's real "ServerMediaSubsession"s (e.g., a demultiplexor for
+// a Matroska file, or the index of a Transport Stream file) are created only when the file is first streamed.
+// Header file
+
+#ifndef _DEFERRED_SERVER_MEDIA_SUBSESSION_HH
+#define _DEFERRED_SERVER_MEDIA_SUBSESSION_HH
+
+#ifndef _SERVER_MEDIA_SESSION_HH
+#include "ServerMediaSession.hh"
+#endif
+
+class DeferredMediaFile {
+  // The real "ServerMediaSubsession"s for a file, shared by its "DeferredServerMediaSubsession"s.
+public:
+  typedef ServerMediaSession* (createSessionFunc)(UsageEnvironment& env, char const* fileName);
+      // Creates a "ServerMediaSession" (with its subsessions) for "fileName"; this reads the file
+
+  static DeferredMediaFile* createNew(UsageEnvironment& env, char const* fileName, createSessionFunc* createSession,
+				      unsigned numSubsessions, char const* const* sdpLines);
+      // "sdpLines" are the (already known) SDP lines for each of the file's "numSubsessions" subsessions.
+      // We're deleted when the last of our "DeferredServerMediaSubsession"s is.
+
+  unsigned numSubsessions() const { return fNumSubsessions; }
+  char const* sdpLines(unsigned index) const { return fSDPLines[index]; }
+
+  ServerMediaSubsession* realSubsession(unsigned index);
+      // Returns the file's real subsession number "index" - creating all of them (by reading the file) if this hasn't
+      // already been done - or NULL if this failed (e.g., because the file is no longer the one that we described).
+
+private:
+  friend class DeferredServerMediaSubsession;
+  DeferredMediaFile(UsageEnvironment& env, char const* fileName, createSessionFunc* createSession,
+		    unsigned numSubsessions, char const* const* sdpLines);
+  virtual ~DeferredMediaFile();
+
+  void addReference() { ++fReferenceCount; }
+  void removeReference() { if (--fReferenceCount == 0) delete this; }
+
+private:
+  UsageEnvironment& fEnv;
+  char* fFileName;
+  createSessionFunc* fCreateSession;
+  unsigned fNumSubsessions;
+  char** fSDPLines;
+  ServerMediaSession* fRealSession; // NULL until it's first needed
+  Boolean fCreationFailed;
+  unsigned fReferenceCount;
+};
+
+class DeferredServerMediaSubsession: public ServerMediaSubsession {
+public:
+  static DeferredServerMediaSubsession* createNew(UsageEnvironment& env, DeferredMediaFile& file, unsigned index);
+
+protected:
+  DeferredServerMediaSubsession(UsageEnvironment& env, DeferredMediaFile& file, unsigned index);
+      // called only by createNew()
+  virtual ~DeferredServerMediaSubsession();
+
+private:
+  ServerMediaSubsession* real() const { return fRealSubsession; } // NULL if we haven't needed it yet
+  ServerMediaSubsession* getReal(); // creates our real subsession, if necessary
+
+private: // redefined virtual functions
+  virtual char const* sdpLines();
+  virtual void getStreamParameters(unsigned clientSessionId, netAddressBits clientAddress,
+				   Port const& clientRTPPort, Port const& clientRTCPPort,
+				   int tcpSocketNum, unsigned char rtpChannelId, unsigned char rtcpChannelId,
+				   netAddressBits& destinationAddress, u_int8_t& destinationTTL,
+				   Boolean& isMulticast, Port& serverRTPPort, Port& serverRTCPPort,
+				   void*& streamToken);
+  virtual void startStream(unsigned clientSessionId, void* streamToken,
+			   TaskFunc* rtcpRRHandler, void* rtcpRRHandlerClientData,
+			   unsigned short& rtpSeqNum, unsigned& rtpTimestamp,
+			   ServerRequestAlternativeByteHandler* serverRequestAlternativeByteHandler,
+			   void* serverRequestAlternativeByteHandlerClientData);
+  virtual void pauseStream(unsigned clientSessionId, void* streamToken);
+  virtual void seekStream(unsigned clientSessionId, void* streamToken, double& seekNPT,
+			  double streamDuration, u_int64_t& numBytes);
+  virtual void seekStream(unsigned clientSessionId, void* streamToken, char*& absStart, char*& absEnd);
+  virtual void nullSeekStream(unsigned clientSessionId, void* streamToken,
+			      double streamEndTime, u_int64_t& numBytes);
+  virtual void setStreamScale(unsigned clientSessionId, void* streamToken, float scale);
+  virtual float getCurrentNPT(void* streamToken);
+  virtual FramedSource* getStreamSource(void* streamToken);
+  virtual void getRTPSinkandRTCP(void* streamToken, RTPSink const*& rtpSink, RTCPInstance const*& rtcp);
+  virtual Boolean getReceiverSSRC(unsigned clientSessionId, void* streamToken, u_int32_t& ssrc);
+  virtual void deleteStream(unsigned clientSessionId, void*& streamToken);
+  virtual void testScaleFactor(float& scale);
+  virtual void testScaleFactorForClientSession(unsigned clientSessionId, float& scale);
+  virtual float duration() const;
+  virtual void getAbsoluteTimeRange(char*& absStartTime, char*& absEndTime) const;
+  virtual char const* getFileByteRange(double seekNPT, double streamDuration, u_int64_t& startByte, u_int64_t& numBytes);
+
+private:
+  DeferredMediaFile& fFile;
+  unsigned fIndex;
+  ServerMediaSubsession* fRealSubsession;
+};
+
+#endif
@@ -19,37 +19,95 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 // Implementation
 
 #include "DynamicRTSPServer.hh"
+#include "DeferredServerMediaSubsession.hh"
 #include <liveMedia.hh>
 #include <string.h>
 
 DynamicRTSPServer*
 DynamicRTSPServer::createNew(UsageEnvironment& env, Port ourPort,
 			     UserAuthenticationDatabase* authDatabase,
-			     unsigned reclamationTestSeconds) {
+			     unsigned reclamationTestSeconds,
+			     char const* metadataCacheFileName, Boolean watchForFileChanges) {
   int ourSocket = setUpOurSocket(env, ourPort);
   if (ourSocket == -1) return NULL;
 
-  return new DynamicRTSPServer(env, ourSocket, ourPort, authDatabase, reclamationTestSeconds);
+  return new DynamicRTSPServer(env, ourSocket, ourPort, authDatabase, reclamationTestSeconds,
+			       metadataCacheFileName, watchForFileChanges);
 }
 
 DynamicRTSPServer::DynamicRTSPServer(UsageEnvironment& env, int ourSocket,
 				     Port ourPort,
-				     UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds)
-  : RTSPServerSupportingHTTPStreaming(env, ourSocket, ourPort, authDatabase, reclamationTestSeconds) {
+				     UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds,
+				     char const* metadataCacheFileName, Boolean watchForFileChanges)
+  : RTSPServerSupportingHTTPStreaming(env, ourSocket, ourPort, authDatabase, reclamationTestSeconds),
+    fMetadataCache(NULL), fCatalog(NULL) {
+  if (metadataCacheFileName != NULL) {
+    fMetadataCache = new MediaMetadataCache(env, metadataCacheFileName);
+  }
+  if (watchForFileChanges) {
+    fCatalog = MediaCatalog::createNew(env); // if this fails, we'll just access the filesystem for each lookup
+    if (fCatalog != NULL && metadataCacheFileName != NULL) {
+      // Our cache file is not a stream, and our writes to it are not changes that our catalog needs to know about:
+      fCatalog->exclude(metadataCacheFileName);
+    }
+  }
 }
 
 DynamicRTSPServer::~DynamicRTSPServer() {
+  delete fCatalog;
+  delete fMetadataCache;
+}
+
+char* DynamicRTSPServer::listStreams(char const* prefix) const {
+  return fCatalog == NULL ? NULL : fCatalog->listEntries(prefix);
 }
 
 static ServerMediaSession* createNewSMS(UsageEnvironment& env,
-					char const* fileName, FILE* fid); // forward
+					char const* fileName, FILE* fid, Boolean addSubsessions = True); // forward
+static ServerMediaSession* createNewSMSWithSubsessions(UsageEnvironment& env, char const* fileName); // forward
 
 ServerMediaSession* DynamicRTSPServer
 ::lookupServerMediaSession(char const* streamName, Boolean isFirstLookupInSession) {
+  if (fCatalog != NULL && fCatalog->covers(streamName)) {
+    // Our catalog tells us - without accessing the filesystem - whether the file exists, and whether it has changed since
+    // we created its "ServerMediaSession" (if any):
+    ServerMediaSession* sms = RTSPServer::lookupServerMediaSession(streamName);
+    if (!fCatalog->isFile(streamName)) {
+      if (sms != NULL) removeServerMediaSession(sms);
+      if (fMetadataCache != NULL) fMetadataCache->remove(streamName);
+      return NULL;
+    }
+
+    if (sms != NULL && isFirstLookupInSession && fCatalog->hasChanged(streamName)) {
+      removeServerMediaSession(sms);
+      sms = NULL;
+    }
+    if (sms == NULL) {
+      // Our "ServerMediaSession" will be for the file's current contents (which we identify by its metadata key):
+      fCatalog->noteCurrent(streamName);
+      MediaFileKey key;
+      if (fMetadataCache != NULL && !MediaMetadataCache::getFileKey(streamName, key)) {
+	return NULL; // the file has only just been removed (and our catalog will soon hear about this)
+      }
+      sms = createAndAddSMS(streamName, NULL, key);
+    }
+    return sms;
+  }
+
   // First, check whether the specified "streamName" exists as a local file:
   FILE* fid = fopen(streamName, "rb");
   Boolean fileExists = fid != NULL;
 
+  // If we're caching metadata, also get the file's key (which identifies its current contents).  (We don't stream the
+  // cache file itself.):
+  MediaFileKey key;
+  if (fileExists && fMetadataCache != NULL
+      && (!MediaMetadataCache::getFileKey(streamName, key) || fMetadataCache->isCacheFile(streamName))) {
+    // "streamName" is not a regular file (or is our cache file):
+    fclose(fid);
+    fileExists = False;
+  }
+
   // Next, check whether we already have a "ServerMediaSession" for this file:
   ServerMediaSession* sms = RTSPServer::lookupServerMediaSession(streamName);
   Boolean smsExists = sms != NULL;
@@ -62,18 +120,21 @@ ServerMediaSession* DynamicRTSPServer
       sms = NULL;
     }
 
+    if (fMetadataCache != NULL) fMetadataCache->remove(streamName);
     return NULL;
   } else {
     if (smsExists && isFirstLookupInSession) { 
       // Remove the existing "ServerMediaSession" and create a new one, in case the underlying
-      // file has changed in some way:
-      removeServerMediaSession(sms); 
-      sms = NULL;
+      // file has changed in some way.  (If we're caching metadata, then we know whether the file has changed,
+      // so we can keep the existing "ServerMediaSession" if it hasn't.)
+      if (fMetadataCache == NULL || !fMetadataCache->isCurrent(streamName, key)) {
+	removeServerMediaSession(sms); 
+	sms = NULL;
+      }
     } 
 
     if (sms == NULL) {
-      sms = createNewSMS(envir(), streamName, fid); 
-      addServerMediaSession(sms);
+      sms = createAndAddSMS(streamName, fid, key);
     }
 
     fclose(fid);
@@ -81,6 +142,36 @@ ServerMediaSession* DynamicRTSPServer
   }
 }
 
+ServerMediaSession* DynamicRTSPServer
+::createAndAddSMS(char const* streamName, FILE* fid, MediaFileKey const& key) {
+  ServerMediaSession* sms;
+  float duration;
+  unsigned numSubsessions;
+  char const* const* sdpLines;
+  if (fMetadataCache != NULL && fMetadataCache->lookup(streamName, key, duration, numSubsessions, sdpLines)) {
+    // This file's metadata is already cached, so we can describe it without reading it.  We create its real subsessions
+    // (which reads - and, for some file types, parses or indexes - the file) only when it's first streamed:
+    sms = createNewSMS(envir(), streamName, fid, False);
+    if (sms != NULL) {
+      DeferredMediaFile* file
+	= DeferredMediaFile::createNew(envir(), streamName, createNewSMSWithSubsessions, numSubsessions, sdpLines);
+      for (unsigned i = 0; i < numSubsessions; ++i) {
+	sms->addSubsession(DeferredServerMediaSubsession::createNew(envir(), *file, i));
+      }
+      sms->presetDuration(duration);
+    }
+  } else {
+    sms = createNewSMS(envir(), streamName, fid);
+    if (fMetadataCache != NULL) {
+      // This file's metadata wasn't already cached; generate and record it now:
+      fMetadataCache->recordFrom(sms, key);
+    }
+  }
+  addServerMediaSession(sms);
+
+  return sms;
+}
+
 // Special code for handling Matroska files:
 struct MatroskaDemuxCreationState {
   MatroskaFileServerDemux* demux;
@@ -109,10 +200,12 @@ static void onOggDemuxCreation(OggFileServerDemux* newDemux, void* clientData) {
 char const* descStr = description\
     ", streamed by the LIVE555 Media Server";\
 sms = ServerMediaSession::createNew(env, fileName, fileName, descStr);\
+if (!addSubsessions) return sms;\
 } while(0)
 
 static ServerMediaSession* createNewSMS(UsageEnvironment& env,
-					char const* fileName, FILE* /*fid*/) {
+					char const* fileName, FILE* /*fid*/, Boolean addSubsessions) {
+  // If "addSubsessions" is False, then we create just the (empty) "ServerMediaSession", without reading the file.
   // Use the file name extension to determine the type of "ServerMediaSession":
   char const* extension = strrchr(fileName, '.');
   if (extension == NULL) return NULL;
@@ -182,11 +275,9 @@ static ServerMediaSession* createNewSMS(UsageEnvironment& env,
     sms->addSubsession(demux->newAC3AudioServerMediaSubsession());
   } else if (strcmp(extension, ".ts") == 0) {
     // Assumed to be a MPEG Transport Stream file:
-    // Use an index file name that's the same as the TS file name, except with ".tsx":
-    unsigned indexFileNameLen = strlen(fileName) + 2; // allow for trailing "x\0"
-    char* indexFileName = new char[indexFileNameLen];
-    sprintf(indexFileName, "%sx", fileName);
     NEW_SMS("MPEG Transport Stream");
+    // Use an index file name that's the same as the TS file name, except with ".tsx":
+    char* indexFileName = MediaMetadataCache::indexFileNameFor(fileName);
     sms->addSubsession(MPEG2TransportFileServerMediaSubsession::createNew(env, fileName, indexFileName, reuseSource));
     delete[] indexFileName;
   } else if (strcmp(extension, ".wav") == 0) {
@@ -238,3 +329,7 @@ static ServerMediaSession* createNewSMS(UsageEnvironment& env,
 
   return sms;
 }
+
+static ServerMediaSession* createNewSMSWithSubsessions(UsageEnvironment& env, char const* fileName) {
+  return createNewSMS(env, fileName, NULL);
+}
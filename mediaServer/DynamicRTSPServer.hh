@@ -24,22 +24,50 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 #ifndef _RTSP_SERVER_SUPPORTING_HTTP_STREAMING_HH
 #include "RTSPServerSupportingHTTPStreaming.hh"
 #endif
+#ifndef _MEDIA_METADATA_CACHE_HH
+#include "MediaMetadataCache.hh"
+#endif
+#ifndef _MEDIA_CATALOG_HH
+#include "MediaCatalog.hh"
+#endif
 
 class DynamicRTSPServer: public RTSPServerSupportingHTTPStreaming {
 public:
   static DynamicRTSPServer* createNew(UsageEnvironment& env, Port ourPort,
 				      UserAuthenticationDatabase* authDatabase,
-				      unsigned reclamationTestSeconds = 65);
+				      unsigned reclamationTestSeconds = 65,
+				      char const* metadataCacheFileName = NULL,
+				      Boolean watchForFileChanges = True);
+      // If "metadataCacheFileName" is non-NULL, then the SDP description (and duration) of each file that we
+      // stream is saved in this file, and reused - without reading the file's media data again - for as long
+      // as the modification time and size of the file (and of its index file, if any) remain the same.
+      // (The cache file itself is never streamed.)
+      // If "watchForFileChanges" is True (and this is supported), then we keep a catalog of the current directory tree
+      // (see "MediaCatalog.hh"), so that looking up a stream name doesn't access the filesystem, and the
+      // "ServerMediaSession" for a file is kept until the file changes.
+
+  virtual char* listStreams(char const* prefix) const;
+      // Returns (in a "new[]"d string) the names of the files and subdirectories that begin with "prefix" (see
+      // "MediaCatalog::listEntries()").  Returns NULL if there's no such directory, or if we're not keeping a catalog.
+      // (This is a redefinition of "RTSPServerSupportingHTTPStreaming::listStreams()", so HTTP clients can browse our streams.)
 
 protected:
   DynamicRTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
-		    UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds);
+		    UserAuthenticationDatabase* authDatabase, unsigned reclamationTestSeconds,
+		    char const* metadataCacheFileName, Boolean watchForFileChanges);
   // called only by createNew();
   virtual ~DynamicRTSPServer();
 
 protected: // redefined virtual functions
   virtual ServerMediaSession*
   lookupServerMediaSession(char const* streamName, Boolean isFirstLookupInSession);
+
+private:
+  ServerMediaSession* createAndAddSMS(char const* streamName, FILE* fid, MediaFileKey const& key);
+
+private:
+  MediaMetadataCache* fMetadataCache; // may be NULL
+  MediaCatalog* fCatalog; // may be NULL
 };
 
 #endif
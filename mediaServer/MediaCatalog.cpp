@@ -0,0 +1,392 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// An in-memory catalog of the files (and subdirectories) in the current directory tree, kept up-to-date by
+// watching the tree for changes (using "inotify").  This lets a server find out whether a stream name refers to
+// an existing (and unchanged) file without accessing the filesystem.
+// Implementation
+
+#include "MediaCatalog.hh"
+#include <strDup.hh>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#ifdef USE_INOTIFY
+#include <sys/inotify.h>
+#endif
+
+// Each entry is a (regular) file, a directory, or something else - a symbolic link, or a special file - that we don't
+// catalog.  (We don't follow symbolic links, because changes to their targets wouldn't be reported to us; names that
+// go through one are instead handled by accessing the filesystem directly.)
+enum MediaCatalogEntryType { FILE_ENTRY, DIRECTORY_ENTRY, OTHER_ENTRY };
+
+class MediaCatalogEntry {
+public:
+  MediaCatalogEntry(MediaCatalogEntry* parent, char const* name)
+    : fType(DIRECTORY_ENTRY), fHasChanged(True), fWatchDescriptor(-1),
+      fParent(parent), fFirstChild(NULL), fPrevSibling(NULL), fNextSibling(NULL) {
+    if (parent == NULL || parent->fPath[0] == '\0') {
+      fPath = strDup(name);
+    } else {
+      fPath = new char[strlen(parent->fPath) + 1 + strlen(name) + 1];
+      sprintf(fPath, "%s/%s", parent->fPath, name);
+    }
+    char const* lastSlash = strrchr(fPath, '/');
+    fName = lastSlash == NULL ? fPath : lastSlash+1;
+
+    if (parent != NULL) {
+      // Add ourself to the front of our parent directory's list of entries:
+      fNextSibling = parent->fFirstChild;
+      if (fNextSibling != NULL) fNextSibling->fPrevSibling = this;
+      parent->fFirstChild = this;
+    }
+  }
+  virtual ~MediaCatalogEntry() {
+    if (fParent != NULL) {
+      if (fPrevSibling != NULL) fPrevSibling->fNextSibling = fNextSibling; else fParent->fFirstChild = fNextSibling;
+      if (fNextSibling != NULL) fNextSibling->fPrevSibling = fPrevSibling;
+    }
+    delete[] fPath;
+  }
+
+public:
+  char* fPath; // relative to the current directory ("" for the current directory itself)
+  char const* fName; // the last component of "fPath"
+  MediaCatalogEntryType fType;
+  Boolean fHasChanged; // for files
+  int fWatchDescriptor; // for directories; -1 if not (yet) watched
+  MediaCatalogEntry* fParent;
+  MediaCatalogEntry* fFirstChild; // for directories
+  MediaCatalogEntry* fPrevSibling;
+  MediaCatalogEntry* fNextSibling;
+};
+
+static MediaCatalogEntryType entryTypeOf(char const* path) {
+  struct stat sb;
+  if (lstat(path, &sb) != 0) return OTHER_ENTRY;
+
+  switch (sb.st_mode&S_IFMT) {
+    case S_IFREG: return FILE_ENTRY;
+    case S_IFDIR: return DIRECTORY_ENTRY;
+    default: return OTHER_ENTRY;
+  }
+}
+
+MediaCatalog* MediaCatalog::createNew(UsageEnvironment& env) {
+#ifdef USE_INOTIFY
+  int inotifyFd = inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+  if (inotifyFd < 0) {
+    env << "Can't watch the current directory tree for changes: inotify_init1() failed: " << env.getErrno() << "\n";
+    return NULL;
+  }
+
+  MediaCatalog* catalog = new MediaCatalog(env, inotifyFd);
+  if (!catalog->fIsUsable) {
+    delete catalog;
+    return NULL;
+  }
+
+  return catalog;
+#else
+  return NULL;
+#endif
+}
+
+MediaCatalog::MediaCatalog(UsageEnvironment& env, int inotifyFd)
+  : fEnv(env), fInotifyFd(inotifyFd), fIsUsable(True),
+    fEntries(HashTable::create(STRING_HASH_KEYS)), fDirectoriesByWatch(HashTable::create(ONE_WORD_HASH_KEYS)),
+    fExcludedNames(HashTable::create(STRING_HASH_KEYS)) {
+  fRoot = new MediaCatalogEntry(NULL, "");
+  fEntries->Add(fRoot->fPath, fRoot);
+
+  unsigned numEntries = 0;
+  if (scanDirectory(fRoot)) {
+    fEnv.taskScheduler().setBackgroundHandling(fInotifyFd, SOCKET_READABLE, incomingEventsHandler, this);
+    numEntries = fEntries->numEntries() - 1; // don't count the root
+    fEnv << "Watching " << numEntries << " files and directories in the current directory tree for changes\n";
+  } else {
+    fIsUsable = False;
+  }
+}
+
+MediaCatalog::~MediaCatalog() {
+  fEnv.taskScheduler().disableBackgroundHandling(fInotifyFd);
+  while (fRoot->fFirstChild != NULL) removeEntry(fRoot->fFirstChild);
+  delete fRoot;
+  delete fEntries;
+  delete fDirectoriesByWatch;
+  delete fExcludedNames;
+  ::close(fInotifyFd); // this also removes all of our watches
+}
+
+Boolean MediaCatalog::covers(char const* name) const {
+  if (!fIsUsable || name == NULL || name[0] == '\0' || name[0] == '/') return False;
+
+  // Check that each component of "name" is a normal (non-empty) name:
+  char const* component = name;
+  while (1) {
+    char const* end = strchr(component, '/');
+    unsigned len = end == NULL ? strlen(component) : end - component;
+    if (len == 0 || (component[0] == '.' && (len == 1 || (len == 2 && component[1] == '.')))) return False;
+    if (end == NULL) break;
+    component = end+1;
+  }
+
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(name));
+  if (entry != NULL) return entry->fType != OTHER_ENTRY;
+
+  // "name" doesn't exist - unless it's beneath a symbolic link (or special file) that we don't follow.  To check for this,
+  // find its closest ancestor that does exist:
+  char* ancestorName = strDup(name);
+  char* lastSlash;
+  while ((lastSlash = strrchr(ancestorName, '/')) != NULL) {
+    *lastSlash = '\0';
+    entry = (MediaCatalogEntry*)(fEntries->Lookup(ancestorName));
+    if (entry != NULL) break;
+  }
+  delete[] ancestorName;
+
+  return entry == NULL/*the ancestor is the root*/ || entry->fType != OTHER_ENTRY;
+}
+
+Boolean MediaCatalog::isFile(char const* name) const {
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(name));
+  return entry != NULL && entry->fType == FILE_ENTRY;
+}
+
+Boolean MediaCatalog::hasChanged(char const* name) const {
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(name));
+  return entry == NULL || entry->fHasChanged;
+}
+
+void MediaCatalog::noteCurrent(char const* name) {
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(name));
+  if (entry != NULL) entry->fHasChanged = False;
+}
+
+char* MediaCatalog::listEntries(char const* prefix) const {
+  if (!fIsUsable || prefix == NULL) return NULL;
+
+  // Split "prefix" into a directory name, and a prefix of the names of the entries (within this directory) to list:
+  char* directoryName = strDup(prefix);
+  char* lastSlash = strrchr(directoryName, '/');
+  char const* namePrefix;
+  if (lastSlash == NULL) {
+    directoryName[0] = '\0'; // the root
+    namePrefix = prefix;
+  } else {
+    *lastSlash = '\0';
+    namePrefix = &prefix[lastSlash - directoryName + 1];
+  }
+  MediaCatalogEntry* directory = (MediaCatalogEntry*)(fEntries->Lookup(directoryName));
+  delete[] directoryName;
+  if (directory == NULL || directory->fType != DIRECTORY_ENTRY) return NULL;
+
+  unsigned const namePrefixLen = strlen(namePrefix);
+  unsigned resultSize = 1; // for the trailing '\0'
+  MediaCatalogEntry* entry;
+  for (entry = directory->fFirstChild; entry != NULL; entry = entry->fNextSibling) {
+    if (strncmp(entry->fName, namePrefix, namePrefixLen) != 0) continue;
+    resultSize += strlen(entry->fName) + 2; // for the possible '/', and the '\n'
+  }
+
+  char* result = new char[resultSize];
+  char* ptr = result;
+  for (entry = directory->fFirstChild; entry != NULL; entry = entry->fNextSibling) {
+    if (strncmp(entry->fName, namePrefix, namePrefixLen) != 0) continue;
+    ptr += sprintf(ptr, "%s%s\n", entry->fName, entry->fType == DIRECTORY_ENTRY ? "/" : "");
+  }
+  *ptr = '\0';
+
+  return result;
+}
+
+void MediaCatalog::exclude(char const* name) {
+  if (name == NULL) return;
+  if (name[0] == '.' && name[1] == '/') name += 2; // our path names don't begin with "./"
+
+  fExcludedNames->Add(name, (void*)1);
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(name));
+  if (entry != NULL && entry != fRoot) removeEntry(entry);
+}
+
+Boolean MediaCatalog::scanDirectory(MediaCatalogEntry* directory) {
+#ifdef USE_INOTIFY
+  char const* directoryName = directory->fPath[0] == '\0' ? "." : directory->fPath;
+
+  // Begin watching the directory before reading it, so that we don't miss any entries that get created meanwhile:
+  int watchDescriptor
+    = inotify_add_watch(fInotifyFd, directoryName,
+			IN_CREATE|IN_DELETE|IN_MOVED_FROM|IN_MOVED_TO|IN_MODIFY|IN_CLOSE_WRITE|IN_ATTRIB
+			|IN_ONLYDIR|IN_DONT_FOLLOW);
+  if (watchDescriptor < 0) {
+    fEnv << "Can't watch directory \"" << directoryName << "\" for changes: inotify_add_watch() failed: "
+	 << fEnv.getErrno() << "\n";
+    return False;
+  }
+  MediaCatalogEntry* watchedDirectory
+    = (MediaCatalogEntry*)(fDirectoriesByWatch->Lookup((char const*)(long)watchDescriptor));
+  if (watchedDirectory != NULL && watchedDirectory != directory) {
+    // This directory is already in our tree, under another name (e.g., because of a 'bind' mount).  Don't catalog it again
+    // (which might never end):
+    directory->fType = OTHER_ENTRY;
+    return True;
+  }
+  directory->fWatchDescriptor = watchDescriptor;
+  fDirectoriesByWatch->Add((char const*)(long)watchDescriptor, directory);
+
+  DIR* dir = opendir(directoryName);
+  if (dir == NULL) return True; // it has just been removed (and our watch will tell us this)
+
+  Boolean result = True;
+  struct dirent* dirEntry;
+  while ((dirEntry = readdir(dir)) != NULL) {
+    if (strcmp(dirEntry->d_name, ".") == 0 || strcmp(dirEntry->d_name, "..") == 0) continue;
+
+    MediaCatalogEntry* entry = addEntry(directory, dirEntry->d_name);
+    if (entry != NULL && entry->fType == DIRECTORY_ENTRY && !scanDirectory(entry)) {
+      result = False;
+      break;
+    }
+  }
+  closedir(dir);
+
+  return result;
+#else
+  return False;
+#endif
+}
+
+MediaCatalogEntry* MediaCatalog::addEntry(MediaCatalogEntry* directory, char const* entryName) {
+  MediaCatalogEntry* entry = new MediaCatalogEntry(directory, entryName);
+  if (fExcludedNames->Lookup(entry->fPath) != NULL) {
+    delete entry;
+    return NULL;
+  }
+  entry->fType = entryTypeOf(entry->fPath);
+
+  MediaCatalogEntry* oldEntry = (MediaCatalogEntry*)(fEntries->Lookup(entry->fPath));
+  if (oldEntry != NULL) removeEntry(oldEntry);
+  fEntries->Add(entry->fPath, entry);
+
+  return entry;
+}
+
+void MediaCatalog::removeEntry(MediaCatalogEntry* entry) {
+  while (entry->fFirstChild != NULL) removeEntry(entry->fFirstChild);
+
+#ifdef USE_INOTIFY
+  if (entry->fWatchDescriptor >= 0) {
+    inotify_rm_watch(fInotifyFd, entry->fWatchDescriptor); // fails (harmlessly) if the directory has already been removed
+    fDirectoriesByWatch->Remove((char const*)(long)entry->fWatchDescriptor);
+  }
+#endif
+  if (fEntries->Lookup(entry->fPath) == entry) fEntries->Remove(entry->fPath);
+  delete entry;
+}
+
+void MediaCatalog::rescan() {
+  // Start again from scratch.  (Because each new file entry is marked as 'changed', any existing
+  // "ServerMediaSession"s for files will get recreated.)
+  fEnv << "Rescanning the current directory tree, after missing some changes\n";
+  while (fRoot->fFirstChild != NULL) removeEntry(fRoot->fFirstChild);
+  if (!scanDirectory(fRoot)) fIsUsable = False;
+}
+
+void MediaCatalog::incomingEventsHandler(void* clientData, int /*mask*/) {
+  MediaCatalog* catalog = (MediaCatalog*)clientData;
+  catalog->incomingEventsHandler1();
+}
+
+void MediaCatalog::incomingEventsHandler1() {
+#ifdef USE_INOTIFY
+  // Read (and handle) all of the events that are available now:
+  union {
+    struct inotify_event event; // for alignment
+    char buf[4096];
+  } events;
+  while (1) {
+    int numBytesRead = read(fInotifyFd, events.buf, sizeof events.buf);
+    if (numBytesRead <= 0) break;
+
+    char const* ptr = events.buf;
+    char const* const end = &events.buf[numBytesRead];
+    while (ptr + sizeof (struct inotify_event) <= end) {
+      struct inotify_event const* event = (struct inotify_event const*)ptr;
+      handleEvent(event->wd, event->mask, event->len > 0 ? event->name : NULL);
+      ptr += sizeof (struct inotify_event) + event->len;
+    }
+  }
+
+  if (!fIsUsable) {
+    fEnv << "No longer watching the current directory tree for changes\n";
+    fEnv.taskScheduler().disableBackgroundHandling(fInotifyFd);
+  }
+#endif
+}
+
+MediaCatalogEntry* MediaCatalog::lookupEntry(MediaCatalogEntry* directory, char const* entryName) const {
+  if (directory->fPath[0] == '\0') return (MediaCatalogEntry*)(fEntries->Lookup(entryName));
+
+  char* path = new char[strlen(directory->fPath) + 1 + strlen(entryName) + 1];
+  sprintf(path, "%s/%s", directory->fPath, entryName);
+  MediaCatalogEntry* entry = (MediaCatalogEntry*)(fEntries->Lookup(path));
+  delete[] path;
+  return entry;
+}
+
+void MediaCatalog::handleEvent(int watchDescriptor, u_int32_t mask, char const* entryName) {
+#ifdef USE_INOTIFY
+  if (!fIsUsable) return;
+  if (mask&IN_Q_OVERFLOW) {
+    rescan();
+    return;
+  }
+
+  MediaCatalogEntry* directory = (MediaCatalogEntry*)(fDirectoriesByWatch->Lookup((char const*)(long)watchDescriptor));
+  if (directory == NULL || entryName == NULL) return; // an event for a directory that we've stopped watching, or about a directory itself
+
+  // If a Transport Stream index file has been created, modified, or removed, then note that the indexed file has changed:
+  unsigned entryNameLen = strlen(entryName);
+  if (entryNameLen > 4 && strcmp(&entryName[entryNameLen-4], ".tsx") == 0) {
+    char* indexedFileName = strDup(entryName);
+    indexedFileName[entryNameLen-1] = '\0'; // "<name>.tsx" -> "<name>.ts"
+    MediaCatalogEntry* indexedFile = lookupEntry(directory, indexedFileName);
+    if (indexedFile != NULL) indexedFile->fHasChanged = True;
+    delete[] indexedFileName;
+  }
+
+  if (mask&(IN_CREATE|IN_MOVED_TO)) {
+    // A new entry (which might replace an existing entry with the same name):
+    MediaCatalogEntry* entry = addEntry(directory, entryName);
+    if (entry != NULL && entry->fType == DIRECTORY_ENTRY && !scanDirectory(entry)) fIsUsable = False;
+    return;
+  }
+
+  MediaCatalogEntry* entry = lookupEntry(directory, entryName);
+  if (entry == NULL) return;
+
+  if (mask&(IN_DELETE|IN_MOVED_FROM)) {
+    removeEntry(entry);
+  } else {
+    // The entry has been modified (or its attributes - e.g., its modification time - have changed):
+    entry->fHasChanged = True;
+  }
+#endif
+}
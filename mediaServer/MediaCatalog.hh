@@ -0,0 +1,94 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// An in-memory catalog of the files (and subdirectories) in the current directory tree, kept up-to-date by
+// watching the tree for changes (using "inotify").  This lets a server find out whether a stream name refers to
+// an existing (and unchanged) file without accessing the filesystem.
+// Header file
+
+#ifndef _MEDIA_CATALOG_HH
+#define _MEDIA_CATALOG_HH
+
+#ifndef _USAGE_ENVIRONMENT_HH
+#include "UsageEnvironment.hh"
+#endif
+#ifndef _HASH_TABLE_HH
+#include "HashTable.hh"
+#endif
+
+#if defined(__linux__) && !defined(NO_INOTIFY)
+#define USE_INOTIFY 1
+#endif
+
+class MediaCatalogEntry; // forward
+
+class MediaCatalog {
+public:
+  static MediaCatalog* createNew(UsageEnvironment& env);
+      // Returns NULL if the current directory tree can't be watched (e.g., on platforms without "inotify", or if there
+      // are too many subdirectories).  In this case, the caller should just access the filesystem directly.
+
+  virtual ~MediaCatalog();
+
+  Boolean covers(char const* name) const;
+      // Returns True iff "name" is a relative path name that we can answer for.  (We can't answer for absolute path names,
+      // or for names that contain "." or ".." components, or empty components.)
+
+  Boolean isFile(char const* name) const;
+      // Returns True iff "name" is (currently) a file in our directory tree (other than a directory)
+
+  Boolean hasChanged(char const* name) const;
+      // Returns True iff the file "name" has been created or modified since "noteCurrent()" was last called for it.
+      // (A Transport Stream file "<name>.ts" is also considered to have changed if its index file "<name>.tsx" has.)
+  void noteCurrent(char const* name);
+
+  char* listEntries(char const* prefix) const;
+      // Returns (in a "new[]"d string) the names of the entries - one per line, with directories having a trailing '/' -
+      // whose full names begin with "prefix", and that are in the same directory as "prefix" would be.  (E.g., "movies/"
+      // lists the contents of the "movies" directory, and "movies/a" lists those of its entries that begin with "a".)
+      // Returns NULL if the directory doesn't exist.
+
+  void exclude(char const* name);
+      // Stops cataloging the file "name" (a relative path name): it's then treated as if it didn't exist, and changes to it
+      // are ignored.  (E.g., for a file that the server writes to itself.)
+
+protected:
+  MediaCatalog(UsageEnvironment& env, int inotifyFd); // called only by "createNew()"
+
+private:
+  Boolean scanDirectory(MediaCatalogEntry* directory);
+      // Adds "directory"'s contents (recursively), and starts watching it.  Returns False if it can't be watched.
+  MediaCatalogEntry* addEntry(MediaCatalogEntry* directory, char const* entryName);
+      // (replacing any existing entry with the same name).  Returns NULL if the name is excluded.
+  void removeEntry(MediaCatalogEntry* entry);
+  MediaCatalogEntry* lookupEntry(MediaCatalogEntry* directory, char const* entryName) const;
+  void rescan(); // after we've missed some changes
+
+  static void incomingEventsHandler(void* clientData, int mask);
+  void incomingEventsHandler1();
+  void handleEvent(int watchDescriptor, u_int32_t mask, char const* entryName);
+
+private:
+  UsageEnvironment& fEnv;
+  int fInotifyFd;
+  Boolean fIsUsable; // becomes False if part of our directory tree can no longer be watched
+  MediaCatalogEntry* fRoot;
+  HashTable* fEntries; // maps (relative) path names to "MediaCatalogEntry"s
+  HashTable* fDirectoriesByWatch; // maps "inotify" watch descriptors to (directory) "MediaCatalogEntry"s
+  HashTable* fExcludedNames; // the (relative) path names that we don't catalog
+};
+
+#endif
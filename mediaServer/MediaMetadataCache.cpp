@@ -0,0 +1,288 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A persistent cache of metadata (SDP lines and duration) for media files,
+// keyed by file name, and by the modification time and size of the file (and of its index file, if any).  This lets a "ServerMediaSession" for an
+// unchanged file be described without first reading (and parsing) the file's media data.
+// Implementation
+
+#include "MediaMetadataCache.hh"
+#include <liveMedia.hh>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// The cache file consists of a sequence of records, each of the form:
+//   <fileNameLength> <modificationTime> <fileSize> <indexModificationTime> <indexFileSize> <duration> <numSubsessions>\n<fileName>\n
+// followed - for each subsession - by:
+//   <sdpLinesLength>\n<sdpLines>\n
+// (SDP lines contain "\r\n"s, so we prefix strings with their length, rather than escaping them.)
+// While we're running, records are only appended; if a file name appears more than once, the last record wins.
+// When we start up, we rewrite the file to remove records that have been superseded, or that are no longer current.
+
+class MediaMetadataRecord {
+public:
+  MediaMetadataRecord(MediaFileKey const& key, float duration, unsigned numSubsessions)
+    : fKey(key), fDuration(duration), fNumSubsessions(numSubsessions) {
+    fSDPLines = new char*[fNumSubsessions];
+    for (unsigned i = 0; i < fNumSubsessions; ++i) fSDPLines[i] = NULL;
+  }
+  virtual ~MediaMetadataRecord() {
+    for (unsigned i = 0; i < fNumSubsessions; ++i) delete[] fSDPLines[i];
+    delete[] fSDPLines;
+  }
+
+public:
+  MediaFileKey fKey;
+  float fDuration;
+  unsigned fNumSubsessions;
+  char** fSDPLines;
+};
+
+MediaMetadataCache::MediaMetadataCache(UsageEnvironment& env, char const* cacheFileName)
+  : fEnv(env), fCacheFileName(strDup(cacheFileName)), fTempFileName(NULL) {
+  if (fCacheFileName != NULL) {
+    fTempFileName = new char[strlen(fCacheFileName) + 4 + 1];
+    sprintf(fTempFileName, "%s.tmp", fCacheFileName);
+  }
+  fRecords = HashTable::create(STRING_HASH_KEYS);
+  loadCacheFile();
+}
+
+MediaMetadataCache::~MediaMetadataCache() {
+  MediaMetadataRecord* record;
+  while ((record = (MediaMetadataRecord*)fRecords->RemoveNext()) != NULL) {
+    delete record;
+  }
+  delete fRecords;
+  delete[] fTempFileName;
+  delete[] fCacheFileName;
+}
+
+Boolean MediaMetadataCache::getFileKey(char const* fileName, MediaFileKey& key) {
+  struct stat sb;
+  if (stat(fileName, &sb) != 0 || (sb.st_mode&S_IFMT) != S_IFREG) return False;
+
+  key.modificationTime = sb.st_mtime;
+  key.fileSize = (u_int64_t)sb.st_size;
+
+  // Also use the index file (if there is one), because whether it exists - and its contents - affect our SDP description:
+  key.indexModificationTime = 0;
+  key.indexFileSize = 0;
+  char* indexFileName = indexFileNameFor(fileName);
+  if (indexFileName != NULL) {
+    if (stat(indexFileName, &sb) == 0 && (sb.st_mode&S_IFMT) == S_IFREG) {
+      key.indexModificationTime = sb.st_mtime;
+      key.indexFileSize = (u_int64_t)sb.st_size;
+    }
+    delete[] indexFileName;
+  }
+
+  return True;
+}
+
+char* MediaMetadataCache::indexFileNameFor(char const* fileName) {
+  char const* extension = strrchr(fileName, '.');
+  if (extension == NULL || strcmp(extension, ".ts") != 0) return NULL;
+
+  // The index file name is the same as the TS file name, except with ".tsx":
+  char* indexFileName = new char[strlen(fileName) + 2]; // allow for trailing "x\0"
+  sprintf(indexFileName, "%sx", fileName);
+  return indexFileName;
+}
+
+Boolean MediaMetadataCache::isCurrent(char const* fileName, MediaFileKey const& key) const {
+  MediaMetadataRecord* record = (MediaMetadataRecord*)(fRecords->Lookup(fileName));
+  return record != NULL && record->fKey == key;
+}
+
+static Boolean isSameFile(struct stat const& sb, char const* fileName) {
+  struct stat sb2;
+  return stat(fileName, &sb2) == 0 && sb2.st_dev == sb.st_dev && sb2.st_ino == sb.st_ino;
+}
+
+Boolean MediaMetadataCache::isCacheFile(char const* fileName) const {
+  if (fCacheFileName == NULL || fileName == NULL) return False;
+
+  struct stat sb;
+  if (stat(fileName, &sb) != 0) return False;
+
+  return isSameFile(sb, fCacheFileName) || isSameFile(sb, fTempFileName);
+}
+
+Boolean MediaMetadataCache::lookup(char const* fileName, MediaFileKey const& key,
+				  float& duration, unsigned& numSubsessions, char const* const*& sdpLines) const {
+  MediaMetadataRecord* record = (MediaMetadataRecord*)(fRecords->Lookup(fileName));
+  if (record == NULL || !(record->fKey == key) || record->fNumSubsessions == 0) return False;
+
+  duration = record->fDuration;
+  numSubsessions = record->fNumSubsessions;
+  sdpLines = record->fSDPLines;
+  return True;
+}
+
+void MediaMetadataCache::recordFrom(ServerMediaSession* sms, MediaFileKey const& key) {
+  if (sms == NULL || sms->numSubsessions() == 0) return;
+
+  // First, make sure that each subsession's SDP lines can be generated.  (Doing so also sets each subsession's duration.)
+  ServerMediaSubsessionIterator iter(*sms);
+  ServerMediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    if (subsession->sdpLines() == NULL) return; // the media's not available; don't record anything
+  }
+
+  MediaMetadataRecord* record
+    = new MediaMetadataRecord(key, sms->duration(), sms->numSubsessions());
+  iter.reset();
+  for (unsigned i = 0; i < record->fNumSubsessions; ++i) {
+    record->fSDPLines[i] = strDup(iter.next()->sdpLines());
+  }
+
+  remove(sms->streamName());
+  fRecords->Add(sms->streamName(), record);
+  appendToCacheFile(sms->streamName(), record);
+}
+
+void MediaMetadataCache::remove(char const* fileName) {
+  MediaMetadataRecord* record = (MediaMetadataRecord*)(fRecords->Lookup(fileName));
+  if (record != NULL) {
+    fRecords->Remove(fileName);
+    delete record;
+  }
+}
+
+static char* readCountedString(FILE* fid, unsigned length) {
+  // Reads "length" bytes, followed by "\n":
+  char* result = new char[length+1];
+  if (fread(result, 1, length, fid) != length || fgetc(fid) != '\n') {
+    delete[] result;
+    return NULL;
+  }
+  result[length] = '\0';
+
+  return result;
+}
+
+void MediaMetadataCache::loadCacheFile() {
+  if (fCacheFileName == NULL) return;
+
+  FILE* fid = fopen(fCacheFileName, "rb");
+  if (fid == NULL) return; // no records have been saved yet
+
+  unsigned numRecordsRead = 0;
+  Boolean isMalformed = True; // until we reach the end of the file cleanly
+  while (1) {
+    unsigned fileNameLength, numSubsessions;
+    long modificationTime, indexModificationTime;
+    unsigned long long fileSize, indexFileSize;
+    float duration;
+    int numFields = fscanf(fid, "%u %ld %llu %ld %llu %f %u", &fileNameLength, &modificationTime, &fileSize,
+			   &indexModificationTime, &indexFileSize, &duration, &numSubsessions);
+    if (numFields == EOF) {
+      isMalformed = False;
+      break;
+    }
+    if (numFields != 7 || fgetc(fid) != '\n') break;
+
+    char* fileName = readCountedString(fid, fileNameLength);
+    if (fileName == NULL) break;
+
+    MediaFileKey key;
+    key.modificationTime = (time_t)modificationTime;
+    key.fileSize = (u_int64_t)fileSize;
+    key.indexModificationTime = (time_t)indexModificationTime;
+    key.indexFileSize = (u_int64_t)indexFileSize;
+    MediaMetadataRecord* record = new MediaMetadataRecord(key, duration, numSubsessions);
+    unsigned i;
+    for (i = 0; i < numSubsessions; ++i) {
+      unsigned sdpLinesLength;
+      if (fscanf(fid, "%u", &sdpLinesLength) != 1 || fgetc(fid) != '\n') break;
+
+      record->fSDPLines[i] = readCountedString(fid, sdpLinesLength);
+      if (record->fSDPLines[i] == NULL) break;
+    }
+    if (i < numSubsessions) {
+      // The file has been truncated (or is otherwise malformed); ignore this, and any subsequent, records:
+      delete record; delete[] fileName;
+      break;
+    }
+
+    ++numRecordsRead;
+
+    // Keep this record only if it's still current (i.e., its file still exists, and hasn't changed since):
+    MediaFileKey currentKey;
+    if (getFileKey(fileName, currentKey) && currentKey == key) {
+      remove(fileName);
+      fRecords->Add(fileName, record);
+    } else {
+      remove(fileName); // in case an earlier record for the same file name was current
+      delete record;
+    }
+    delete[] fileName;
+  }
+
+  fclose(fid);
+  fEnv << "Loaded " << fRecords->numEntries() << " current media metadata records (of " << numRecordsRead
+       << " saved) from \"" << fCacheFileName << "\"\n";
+
+  // Rewrite the cache file (if necessary), so that it doesn't keep growing, and so that any records that we append to it
+  // won't follow a malformed record (e.g., one written by an older version of this code, or truncated by a crash):
+  if (numRecordsRead > fRecords->numEntries() || isMalformed) rewriteCacheFile();
+}
+
+static void writeRecord(FILE* fid, char const* fileName, MediaMetadataRecord const* record) {
+  MediaFileKey const& key = record->fKey;
+  fprintf(fid, "%u %ld %llu %ld %llu %f %u\n%s\n", (unsigned)strlen(fileName),
+	  (long)key.modificationTime, (unsigned long long)key.fileSize,
+	  (long)key.indexModificationTime, (unsigned long long)key.indexFileSize,
+	  record->fDuration, record->fNumSubsessions, fileName);
+  for (unsigned i = 0; i < record->fNumSubsessions; ++i) {
+    fprintf(fid, "%u\n%s\n", (unsigned)strlen(record->fSDPLines[i]), record->fSDPLines[i]);
+  }
+}
+
+void MediaMetadataCache::rewriteCacheFile() {
+  // Write our (current) records to a temporary file, and then replace the cache file with it.  (If we fail part way,
+  // the old cache file remains - and is still valid.)
+  FILE* fid = fopen(fTempFileName, "wb");
+  if (fid == NULL) return;
+
+  HashTable::Iterator* iter = HashTable::Iterator::create(*fRecords);
+  MediaMetadataRecord* record;
+  char const* fileName;
+  while ((record = (MediaMetadataRecord*)(iter->next(fileName))) != NULL) {
+    writeRecord(fid, fileName, record);
+  }
+  delete iter;
+
+  Boolean ok = fflush(fid) == 0 && !ferror(fid);
+  if (fclose(fid) != 0) ok = False;
+  if (!ok || rename(fTempFileName, fCacheFileName) != 0) {
+    fEnv << "Failed to rewrite \"" << fCacheFileName << "\": " << fEnv.getErrno() << "\n";
+    unlink(fTempFileName);
+  }
+}
+
+void MediaMetadataCache::appendToCacheFile(char const* fileName, MediaMetadataRecord const* record) {
+  if (fCacheFileName == NULL) return;
+
+  FILE* fid = fopen(fCacheFileName, "ab");
+  if (fid == NULL) return;
+
+  writeRecord(fid, fileName, record);
+  fclose(fid);
+}
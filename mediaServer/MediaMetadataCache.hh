@@ -0,0 +1,99 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A persistent cache of metadata (SDP lines and duration) for media files,
+// keyed by file name, and by the modification time and size of the file (and of its index file, if any).  This lets a "ServerMediaSession" for an
+// unchanged file be described without first reading (and parsing) the file's media data.
+// Header file
+
+#ifndef _MEDIA_METADATA_CACHE_HH
+#define _MEDIA_METADATA_CACHE_HH
+
+#ifndef _SERVER_MEDIA_SESSION_HH
+#include "ServerMediaSession.hh"
+#endif
+#include <sys/types.h>
+#include <time.h>
+
+class MediaMetadataRecord; // forward
+
+class MediaFileKey {
+  // Identifies the current contents of a media file - and of its index file (e.g., a Transport Stream file's ".tsx" file),
+  // because the index affects the file's SDP description (e.g., its duration) too.
+public:
+  MediaFileKey()
+    : modificationTime(0), fileSize(0), indexModificationTime(0), indexFileSize(0) {
+  }
+
+  Boolean operator==(MediaFileKey const& other) const {
+    return modificationTime == other.modificationTime && fileSize == other.fileSize
+      && indexModificationTime == other.indexModificationTime && indexFileSize == other.indexFileSize;
+  }
+
+public:
+  time_t modificationTime;
+  u_int64_t fileSize;
+  time_t indexModificationTime; // 0 if there's no index file
+  u_int64_t indexFileSize; // 0 if there's no index file
+};
+
+class MediaMetadataCache {
+public:
+  MediaMetadataCache(UsageEnvironment& env, char const* cacheFileName);
+      // Loads any records previously saved in "cacheFileName" (if it exists), and then rewrites this file to contain only
+      // those records that are still current.  New records are appended to this file.
+      // Note: If "cacheFileName" is inside the directory tree that's being served, then the server should not
+      // treat it as a stream (see "isCacheFile()").
+  virtual ~MediaMetadataCache();
+
+  static Boolean getFileKey(char const* fileName, MediaFileKey& key);
+      // Returns False iff "fileName" does not exist (as a regular file)
+
+  static char* indexFileNameFor(char const* fileName);
+      // Returns (in a "new[]"d string) the name of the index file that's used when streaming "fileName" - i.e., for a
+      // Transport Stream ("*.ts") file, its ".tsx" file - or NULL if "fileName" is not a type of file that has one.
+
+  Boolean isCurrent(char const* fileName, MediaFileKey const& key) const;
+      // Returns True iff we have a record for "fileName" that has the given key
+
+  Boolean isCacheFile(char const* fileName) const;
+      // Returns True iff "fileName" names our cache file (or the temporary file that we use to rewrite it)
+
+  Boolean lookup(char const* fileName, MediaFileKey const& key,
+		 float& duration, unsigned& numSubsessions, char const* const*& sdpLines) const;
+      // If we have a current record for "fileName", then set the duration of its "ServerMediaSession", and the number
+      // (and SDP lines) of its subsessions, from this record, and return True.  Otherwise return False.
+      // ("sdpLines" remains valid only until the record is next changed or removed.)
+
+  void recordFrom(ServerMediaSession* sms, MediaFileKey const& key);
+      // Generates (if necessary) the SDP lines of each of "sms"'s subsessions, and records them (along with "sms"'s
+      // duration) - both in memory, and in our cache file.
+
+  void remove(char const* fileName);
+
+private:
+  void loadCacheFile();
+  void rewriteCacheFile();
+  void appendToCacheFile(char const* fileName, MediaMetadataRecord const* record);
+
+private:
+  UsageEnvironment& fEnv;
+  char* fCacheFileName;
+  char* fTempFileName; // used when rewriting the cache file
+  HashTable* fRecords; // indexed by file name
+};
+
+#endif
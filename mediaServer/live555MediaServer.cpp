@@ -35,14 +35,18 @@ int main(int argc, char** argv) {
   // access to the server.
 #endif
 
+  // Save each file's SDP description (and duration) in the following file, so that - for as long as the file
+  // remains unchanged - it can be described again (even after we're restarted) without reading its media data:
+  char const* metadataCacheFileName = ".live555MediaServer.metadata";
+
   // Create the RTSP server.  Try first with the default port number (554),
   // and then with the alternative port number (8554):
   RTSPServer* rtspServer;
   portNumBits rtspServerPortNum = 554;
-  rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB);
+  rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB, 65, metadataCacheFileName);
   if (rtspServer == NULL) {
     rtspServerPortNum = 8554;
-    rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB);
+    rtspServer = DynamicRTSPServer::createNew(*env, rtspServerPortNum, authDB, 65, metadataCacheFileName);
   }
   if (rtspServer == NULL) {
     *env << "Failed to create RTSP server: " << env->getResultMsg() << "\n";
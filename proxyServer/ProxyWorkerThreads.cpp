@@ -0,0 +1,432 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// Support for running the proxy server's back-end streams in several 'worker' threads - each with its own
+// "UsageEnvironment" (and thus its own event loop).  A single "DispatchingRTSPServer" (in the main thread) accepts
+// all incoming connections, and hands each one to the worker thread that owns the stream that it's requesting.
+// Implementation
+
+#include "ProxyWorkerThreads.hh"
+#include "BasicUsageEnvironment.hh"
+#include <GroupsockHelper.hh>
+#include <RTSPCommon.hh>
+#include <unistd.h>
+
+////////// ProxyWorkerRTSPServer implementation //////////
+
+ProxyWorkerRTSPServer* ProxyWorkerRTSPServer
+::createNew(UsageEnvironment& env, Port ourPort,
+	    UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+  return new ProxyWorkerRTSPServer(env, ourPort, authDatabase, reclamationSeconds);
+}
+
+ProxyWorkerRTSPServer
+::ProxyWorkerRTSPServer(UsageEnvironment& env, Port ourPort,
+			UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds)
+  : RTSPServer(env, -1/* we have no listening socket of our own */, ourPort, authDatabase, reclamationSeconds),
+    fClosureNotificationFd(-1) {
+}
+
+ProxyWorkerRTSPServer::~ProxyWorkerRTSPServer() {
+}
+
+void ProxyWorkerRTSPServer::adoptClientConnection(int clientSocket, struct sockaddr_in const& clientAddr) {
+  // The connection has already been accepted (and set up) by the "DispatchingRTSPServer", so we just create a new
+  // object for handling it:
+  (void)createNewClientConnection(clientSocket, clientAddr);
+}
+
+// A connection that was handed to us by a "DispatchingRTSPServer".  When it's closed, we tell the
+// "DispatchingRTSPServer", so that it stops counting the connection against its limits:
+class AdoptedClientConnection: public RTSPServer::RTSPClientConnection {
+public:
+  AdoptedClientConnection(ProxyWorkerRTSPServer& ourServer, int clientSocket, struct sockaddr_in clientAddr)
+    : RTSPClientConnection(ourServer, clientSocket, clientAddr),
+      fClosureNotificationFd(ourServer.fClosureNotificationFd) {
+  }
+  virtual ~AdoptedClientConnection() {
+    // Note: Because this is smaller than PIPE_BUF, it gets written (and later read) atomically:
+    if (fClosureNotificationFd >= 0) (void)write(fClosureNotificationFd, &fClientAddr, sizeof fClientAddr);
+  }
+
+private:
+  int fClosureNotificationFd;
+};
+
+GenericMediaServer::ClientConnection* ProxyWorkerRTSPServer
+::createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr) {
+  return new AdoptedClientConnection(*this, clientSocket, clientAddr);
+}
+
+
+////////// ProxyWorker implementation //////////
+
+// A connection that's being handed from the main thread to a worker thread:
+struct HandedOffConnection {
+  int clientSocket;
+  struct sockaddr_in clientAddr;
+};
+
+ProxyWorker::ProxyWorker(Port rtspServerPort, UserAuthenticationDatabase* authDatabase)
+  : fAuthDB(authDatabase) {
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  fEnv = BasicUsageEnvironment::createNew(*scheduler);
+  fRTSPServer = ProxyWorkerRTSPServer::createNew(*fEnv, rtspServerPort, authDatabase);
+
+  if (pipe(fHandOffPipe) != 0) {
+    fEnv->setResultErrMsg("pipe() failed: ");
+    fHandOffPipe[0] = fHandOffPipe[1] = -1;
+  } else {
+    fEnv->taskScheduler().turnOnBackgroundReadHandling(fHandOffPipe[0], incomingHandOffHandler, this);
+  }
+}
+
+ProxyWorker::~ProxyWorker() {
+  // Note: This should be called only if our thread is not running.
+  if (fHandOffPipe[0] >= 0) {
+    fEnv->taskScheduler().turnOffBackgroundReadHandling(fHandOffPipe[0]);
+    close(fHandOffPipe[0]); close(fHandOffPipe[1]);
+  }
+  Medium::close(fRTSPServer);
+  delete fAuthDB;
+
+  TaskScheduler* scheduler = &fEnv->taskScheduler();
+  fEnv->reclaim();
+  delete scheduler;
+}
+
+Boolean ProxyWorker::start() {
+  if (fHandOffPipe[0] < 0) return False;
+
+  if (pthread_create(&fThread, NULL, threadMain, this) != 0) {
+    fEnv->setResultMsg("pthread_create() failed");
+    return False;
+  }
+
+  return True;
+}
+
+Boolean ProxyWorker::handOffConnection(int clientSocket, struct sockaddr_in const& clientAddr) {
+  HandedOffConnection connection;
+  connection.clientSocket = clientSocket;
+  connection.clientAddr = clientAddr;
+
+  // Note: Because this is smaller than PIPE_BUF, it gets written (and later read) atomically:
+  if (write(fHandOffPipe[1], &connection, sizeof connection) != (int)(sizeof connection)) {
+    ::closeSocket(clientSocket);
+    return False;
+  }
+
+  return True;
+}
+
+void* ProxyWorker::threadMain(void* worker) {
+  ((ProxyWorker*)worker)->fEnv->taskScheduler().doEventLoop(); // does not return
+  return NULL;
+}
+
+void ProxyWorker::incomingHandOffHandler(void* instance, int /*mask*/) {
+  ((ProxyWorker*)instance)->incomingHandOffHandler();
+}
+
+void ProxyWorker::incomingHandOffHandler() {
+  HandedOffConnection connection;
+  if (read(fHandOffPipe[0], &connection, sizeof connection) != (int)(sizeof connection)) return;
+
+  fRTSPServer->adoptClientConnection(connection.clientSocket, connection.clientAddr);
+}
+
+
+////////// PendingConnection definition and implementation //////////
+
+// A newly-accepted connection, whose first request that names a stream we're waiting for (so that we know which
+// worker to hand it to):
+
+#ifndef PENDING_CONNECTION_TIMEOUT_SECONDS
+#define PENDING_CONNECTION_TIMEOUT_SECONDS 10
+#endif
+#define PENDING_CONNECTION_RETRY_INTERVAL 10000 /* microseconds */
+#define MAX_REQUEST_LINE_SIZE 2000
+#define MAX_PEEKED_REQUEST_SIZE 10000
+
+class PendingConnection {
+public:
+  PendingConnection(DispatchingRTSPServer& ourServer, int clientSocket, struct sockaddr_in const& clientAddr);
+  virtual ~PendingConnection();
+
+private:
+  static void incomingRequestHandler(void* instance, int /*mask*/);
+  void incomingRequestHandler();
+  void waitForMoreData();
+  Boolean answerOPTIONS(char const* request, unsigned requestSize);
+      // Returns True iff "request" was an "OPTIONS" (that we consumed and answered).  (If so, we may have been deleted.)
+  void close();
+  static void retryReading(void* instance);
+  static void timeoutHandler(void* instance);
+
+  UsageEnvironment& envir() const { return fOurServer.envir(); }
+
+private:
+  DispatchingRTSPServer& fOurServer;
+  int fClientSocket;
+  struct sockaddr_in fClientAddr;
+  TaskToken fRetryTask, fTimeoutTask;
+};
+
+PendingConnection
+::PendingConnection(DispatchingRTSPServer& ourServer, int clientSocket, struct sockaddr_in const& clientAddr)
+  : fOurServer(ourServer), fClientSocket(clientSocket), fClientAddr(clientAddr), fRetryTask(NULL) {
+  // Until it's closed, the connection counts against our server's connection limits:
+  fOurServer.changeNumConnectionsFrom(fClientAddr, 1);
+
+  envir().taskScheduler().turnOnBackgroundReadHandling(fClientSocket, incomingRequestHandler, this);
+  fTimeoutTask = envir().taskScheduler().scheduleDelayedTask(PENDING_CONNECTION_TIMEOUT_SECONDS*1000000,
+							     timeoutHandler, this);
+}
+
+PendingConnection::~PendingConnection() {
+  envir().taskScheduler().turnOffBackgroundReadHandling(fClientSocket);
+  envir().taskScheduler().unscheduleDelayedTask(fRetryTask);
+  envir().taskScheduler().unscheduleDelayedTask(fTimeoutTask);
+}
+
+void PendingConnection::incomingRequestHandler(void* instance, int /*mask*/) {
+  ((PendingConnection*)instance)->incomingRequestHandler();
+}
+
+void PendingConnection::incomingRequestHandler() {
+  // Look at - but don't consume - the data that has arrived so far.  (The worker's "RTSPClientConnection" will read it.)
+  char request[MAX_PEEKED_REQUEST_SIZE+1];
+  int bytesRead = recv(fClientSocket, request, MAX_PEEKED_REQUEST_SIZE, MSG_PEEK);
+  if (bytesRead <= 0) {
+    if (bytesRead < 0 && envir().getErrno() == EWOULDBLOCK) return;
+
+    // The client closed the connection (or there was an error):
+    close();
+    return;
+  }
+  request[bytesRead] = '\0';
+
+  char* eol = strchr(request, '\n');
+  if (eol == NULL && bytesRead < MAX_REQUEST_LINE_SIZE) {
+    waitForMoreData(); // we don't yet have the complete request line
+    return;
+  }
+
+  ProxyWorker* worker;
+  if (eol != NULL) {
+    *eol = '\0';
+    worker = fOurServer.workerForRequest(request);
+    *eol = '\n';
+  } else {
+    worker = fOurServer.workerForRequest(request);
+  }
+
+  if (worker == NULL) {
+    // The request doesn't name a stream.  If it's an "OPTIONS" (e.g., "OPTIONS *"), we answer it ourself, and wait for a
+    // later request that does name a stream.  (Otherwise, we hand the connection to our first worker.)
+    char const* requestEnd = strstr(request, "\r\n\r\n");
+    if (requestEnd == NULL && bytesRead < MAX_PEEKED_REQUEST_SIZE) {
+      waitForMoreData(); // we don't yet have the complete request
+      return;
+    }
+    if (requestEnd != NULL && answerOPTIONS(request, requestEnd + 4 - request)) return;
+
+    worker = fOurServer.worker(0);
+  }
+
+  envir().taskScheduler().turnOffBackgroundReadHandling(fClientSocket);
+  if (!worker->handOffConnection(fClientSocket, fClientAddr)) {
+    // The connection was closed instead:
+    fOurServer.changeNumConnectionsFrom(fClientAddr, -1);
+  }
+  delete this;
+}
+
+void PendingConnection::waitForMoreData() {
+  // Because the data that we've seen remains readable, we stop watching the socket for a short while (so that we don't
+  // 'spin'), and then look again:
+  envir().taskScheduler().turnOffBackgroundReadHandling(fClientSocket);
+  fRetryTask = envir().taskScheduler().scheduleDelayedTask(PENDING_CONNECTION_RETRY_INTERVAL, retryReading, this);
+}
+
+Boolean PendingConnection::answerOPTIONS(char const* request, unsigned requestSize) {
+  char cmdName[RTSP_PARAM_STRING_MAX];
+  char urlPreSuffix[RTSP_PARAM_STRING_MAX];
+  char urlSuffix[RTSP_PARAM_STRING_MAX];
+  char cseq[RTSP_PARAM_STRING_MAX];
+  char sessionId[RTSP_PARAM_STRING_MAX];
+  unsigned contentLength = 0;
+  if (!parseRTSPRequestString(request, requestSize,
+			      cmdName, sizeof cmdName,
+			      urlPreSuffix, sizeof urlPreSuffix,
+			      urlSuffix, sizeof urlSuffix,
+			      cseq, sizeof cseq,
+			      sessionId, sizeof sessionId,
+			      contentLength)
+      || strcmp(cmdName, "OPTIONS") != 0 || contentLength > 0) {
+    return False;
+  }
+
+  // Consume the request (which, until now, we've only 'peeked' at):
+  char discardBuf[MAX_PEEKED_REQUEST_SIZE];
+  if (recv(fClientSocket, discardBuf, requestSize, 0) != (int)requestSize) {
+    close(); // we can no longer hand the connection off intact
+    return True;
+  }
+
+  char response[1000];
+  snprintf(response, sizeof response, "RTSP/1.0 200 OK\r\nCSeq: %s\r\n%sPublic: %s\r\n\r\n",
+	   cseq, dateHeader(), fOurServer.allowedCommandNames());
+  send(fClientSocket, response, strlen(response), 0);
+
+  // Restart our timeout, while we wait for the next request:
+  envir().taskScheduler().rescheduleDelayedTask(fTimeoutTask, PENDING_CONNECTION_TIMEOUT_SECONDS*1000000,
+						timeoutHandler, this);
+  return True;
+}
+
+void PendingConnection::close() {
+  ::closeSocket(fClientSocket);
+  fOurServer.changeNumConnectionsFrom(fClientAddr, -1);
+  delete this;
+}
+
+void PendingConnection::retryReading(void* instance) {
+  PendingConnection* connection = (PendingConnection*)instance;
+  connection->fRetryTask = NULL;
+  connection->envir().taskScheduler().turnOnBackgroundReadHandling(connection->fClientSocket,
+								  incomingRequestHandler, connection);
+}
+
+void PendingConnection::timeoutHandler(void* instance) {
+  PendingConnection* connection = (PendingConnection*)instance;
+  connection->fTimeoutTask = NULL;
+
+  connection->close();
+}
+
+
+////////// DispatchingRTSPServer implementation //////////
+
+DispatchingRTSPServer* DispatchingRTSPServer
+::createNew(UsageEnvironment& env, Port ourPort,
+	    UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds) {
+  int ourSocket = setUpOurSocket(env, ourPort);
+  if (ourSocket == -1) return NULL;
+
+  return new DispatchingRTSPServer(env, ourSocket, ourPort, authDatabase, reclamationSeconds);
+}
+
+DispatchingRTSPServer
+::DispatchingRTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
+			UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds)
+  : RTSPServer(env, ourSocket, ourPort, authDatabase, reclamationSeconds),
+    fWorkers(NULL), fNumWorkers(0), fStreamOwners(HashTable::create(STRING_HASH_KEYS)) {
+  if (pipe(fClosureNotificationPipe) != 0) {
+    env.setResultErrMsg("pipe() failed: ");
+    fClosureNotificationPipe[0] = fClosureNotificationPipe[1] = -1;
+  } else {
+    env.taskScheduler().turnOnBackgroundReadHandling(fClosureNotificationPipe[0],
+						     incomingClosureNotificationHandler, this);
+  }
+}
+
+DispatchingRTSPServer::~DispatchingRTSPServer() {
+  if (fClosureNotificationPipe[0] >= 0) {
+    envir().taskScheduler().turnOffBackgroundReadHandling(fClosureNotificationPipe[0]);
+    ::close(fClosureNotificationPipe[0]); ::close(fClosureNotificationPipe[1]);
+  }
+  delete fStreamOwners;
+  delete[] fWorkers;
+}
+
+void DispatchingRTSPServer::addWorker(ProxyWorker* worker) {
+  ProxyWorker** newWorkers = new ProxyWorker*[fNumWorkers+1];
+  for (unsigned i = 0; i < fNumWorkers; ++i) newWorkers[i] = fWorkers[i];
+  newWorkers[fNumWorkers++] = worker;
+
+  delete[] fWorkers; fWorkers = newWorkers;
+
+  worker->rtspServer()->setClosureNotificationFd(fClosureNotificationPipe[1]);
+}
+
+void DispatchingRTSPServer::assignStream(char const* streamName, ProxyWorker* worker) {
+  fStreamOwners->Add(streamName, worker);
+}
+
+GenericMediaServer::ClientConnection* DispatchingRTSPServer
+::createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr) {
+  if (fNumWorkers == 0) { // sanity check; shouldn't happen
+    ::closeSocket(clientSocket);
+  } else {
+    (void)new PendingConnection(*this, clientSocket, clientAddr);
+  }
+
+  return NULL; // we don't handle any requests ourself
+}
+
+ProxyWorker* DispatchingRTSPServer::workerForRequest(char const* requestLine) {
+  // The request line (RTSP or HTTP) has the form "<method> <url> <protocol>".  Find the start of the URL's path:
+  char const* url = strchr(requestLine, ' ');
+  if (url != NULL) {
+    while (*url == ' ') ++url;
+    char const* scheme = strstr(url, "://");
+    char const* urlEnd = strchr(url, ' ');
+    if (scheme != NULL && (urlEnd == NULL || scheme < urlEnd)) {
+      url = strchr(scheme + 3, '/'); // skip over the host (and port)
+    }
+  }
+  if (url == NULL) return NULL;
+  while (*url == '/') ++url;
+
+  // The stream name is the path (up to any query string), or - if that's not known - the path without its final
+  // component (which could be a track id):
+  char streamName[MAX_REQUEST_LINE_SIZE+1];
+  unsigned len = 0;
+  while (url[len] != '\0' && url[len] != ' ' && url[len] != '?' && url[len] != '\r') {
+    streamName[len] = url[len];
+    ++len;
+  }
+  while (len > 0 && streamName[len-1] == '/') --len;
+  streamName[len] = '\0';
+  if (len == 0 || strcmp(streamName, "*") == 0) return NULL;
+
+  ProxyWorker* worker = (ProxyWorker*)(fStreamOwners->Lookup(streamName));
+  if (worker == NULL) {
+    char* lastSlash = strrchr(streamName, '/');
+    if (lastSlash != NULL) {
+      *lastSlash = '\0';
+      worker = (ProxyWorker*)(fStreamOwners->Lookup(streamName));
+    }
+  }
+
+  return worker != NULL ? worker : fWorkers[0];
+}
+
+void DispatchingRTSPServer::incomingClosureNotificationHandler(void* instance, int /*mask*/) {
+  ((DispatchingRTSPServer*)instance)->incomingClosureNotificationHandler();
+}
+
+void DispatchingRTSPServer::incomingClosureNotificationHandler() {
+  struct sockaddr_in clientAddrs[64];
+  int bytesRead = read(fClosureNotificationPipe[0], clientAddrs, sizeof clientAddrs);
+  if (bytesRead <= 0) return;
+
+  // Each closed connection stops counting against our limits:
+  unsigned numClosures = bytesRead/sizeof clientAddrs[0];
+  for (unsigned i = 0; i < numClosures; ++i) changeNumConnectionsFrom(clientAddrs[i], -1);
+}
@@ -0,0 +1,135 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// Support for running the proxy server's back-end streams in several 'worker' threads - each with its own
+// "UsageEnvironment" (and thus its own event loop).  A single "DispatchingRTSPServer" (in the main thread) accepts
+// all incoming connections, and hands each one to the worker thread that owns the stream that it's requesting.
+// Header file
+
+#ifndef _PROXY_WORKER_THREADS_HH
+#define _PROXY_WORKER_THREADS_HH
+
+#ifndef _LIVEMEDIA_HH
+#include "liveMedia.hh"
+#endif
+#include <pthread.h>
+
+class ProxyWorkerRTSPServer: public RTSPServer {
+  // A "RTSPServer" that has no listening socket of its own.  Instead, it is handed connections that have already
+  // been accepted (by a "DispatchingRTSPServer" in another thread).
+public:
+  static ProxyWorkerRTSPServer* createNew(UsageEnvironment& env, Port ourPort,
+					  UserAuthenticationDatabase* authDatabase = NULL,
+					  unsigned reclamationSeconds = 65);
+      // "ourPort" is the port number of the "DispatchingRTSPServer"; we use it only when generating "rtsp://" URLs
+
+  void adoptClientConnection(int clientSocket, struct sockaddr_in const& clientAddr);
+
+  void setClosureNotificationFd(int fd) { fClosureNotificationFd = fd; }
+      // When an adopted connection is closed, its client address (a "struct sockaddr_in") gets written to "fd".
+      // (The "DispatchingRTSPServer" uses this to count each connection against its limits until it's closed.)
+
+protected:
+  ProxyWorkerRTSPServer(UsageEnvironment& env, Port ourPort,
+			UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds);
+  // called only by createNew();
+  virtual ~ProxyWorkerRTSPServer();
+
+protected: // redefined virtual functions
+  virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr);
+
+private:
+  friend class AdoptedClientConnection;
+  int fClosureNotificationFd;
+};
+
+class ProxyWorker {
+public:
+  ProxyWorker(Port rtspServerPort, UserAuthenticationDatabase* authDatabase);
+      // Creates our "UsageEnvironment" and "ProxyWorkerRTSPServer".  Before "start()" is called, these may be used
+      // (from the main thread) to set up this worker's "ProxyServerMediaSession"s.
+      // We take ownership of "authDatabase" (if non-NULL).  Because a "UserAuthenticationDatabase" is not thread-safe,
+      // it must not be shared with any other worker (or with the main thread).
+  virtual ~ProxyWorker();
+
+  UsageEnvironment& envir() const { return *fEnv; }
+  ProxyWorkerRTSPServer* rtspServer() const { return fRTSPServer; }
+
+  Boolean start();
+      // Starts a new thread that runs our event loop.  After this, our "UsageEnvironment" must not be used from
+      // any other thread.
+
+  Boolean handOffConnection(int clientSocket, struct sockaddr_in const& clientAddr);
+      // Called (from the main thread) to have our thread handle a newly-accepted connection.
+      // Returns False (after closing "clientSocket") if the connection couldn't be handed off.
+
+private:
+  static void* threadMain(void* worker);
+  static void incomingHandOffHandler(void* instance, int /*mask*/);
+  void incomingHandOffHandler();
+
+private:
+  UsageEnvironment* fEnv;
+  UserAuthenticationDatabase* fAuthDB;
+  ProxyWorkerRTSPServer* fRTSPServer;
+  int fHandOffPipe[2]; // connections are handed to our thread by writing them to this pipe
+  pthread_t fThread;
+};
+
+class DispatchingRTSPServer: public RTSPServer {
+  // A "RTSPServer" that does not handle any requests itself.  Instead, it reads (but does not consume) the first
+  // request from each new connection that names a stream, and hands the connection to the "ProxyWorker" that owns
+  // that stream.  (We answer any earlier "OPTIONS" requests - e.g., "OPTIONS *" - that don't name a stream ourself.)
+  // Each connection counts against our connection limits (see "setConnectionLimits()") until it's closed - even after
+  // it's been handed to a worker.
+public:
+  static DispatchingRTSPServer* createNew(UsageEnvironment& env, Port ourPort,
+					  UserAuthenticationDatabase* authDatabase = NULL,
+					  unsigned reclamationSeconds = 65);
+
+  void addWorker(ProxyWorker* worker); // must be called before "worker->start()"
+  unsigned numWorkers() const { return fNumWorkers; }
+  ProxyWorker* worker(unsigned index) const { return fWorkers[index]; }
+
+  void assignStream(char const* streamName, ProxyWorker* worker);
+      // Requests for "streamName" will be handed to "worker".  (Requests for any other stream name - or requests
+      // (other than "OPTIONS") that don't name a stream - are handed to our first worker.)
+
+protected:
+  DispatchingRTSPServer(UsageEnvironment& env, int ourSocket, Port ourPort,
+			UserAuthenticationDatabase* authDatabase, unsigned reclamationSeconds);
+  // called only by createNew();
+  virtual ~DispatchingRTSPServer();
+
+protected: // redefined virtual functions
+  virtual ClientConnection* createNewClientConnection(int clientSocket, struct sockaddr_in clientAddr);
+
+private:
+  friend class PendingConnection;
+  ProxyWorker* workerForRequest(char const* requestLine);
+      // Returns NULL if the request line doesn't name a stream (e.g., "OPTIONS *")
+
+  static void incomingClosureNotificationHandler(void* instance, int /*mask*/);
+  void incomingClosureNotificationHandler();
+
+private:
+  ProxyWorker** fWorkers;
+  unsigned fNumWorkers;
+  HashTable* fStreamOwners; // maps stream names to "ProxyWorker"s
+  int fClosureNotificationPipe[2]; // our workers tell us about closed connections by writing to this pipe
+};
+
+#endif
@@ -19,6 +19,7 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include "liveMedia.hh"
 #include "BasicUsageEnvironment.hh"
+#include "ProxyWorkerThreads.hh"
 
 char const* progName;
 UsageEnvironment* env;
@@ -33,12 +34,35 @@ portNumBits rtspServerPortNum = 554;
 char* username = NULL;
 char* password = NULL;
 Boolean proxyREGISTERRequests = False;
+Boolean cacheGOPs = False;
+int keepWarmIdleTimeout = 0; // seconds; 0 means: "PAUSE" each back-end stream as soon as it has no clients
+unsigned numWorkerThreads = 0; // 0 means: handle all streams (and clients) in the main thread
+Boolean streamUsingHLS = False;
+unsigned hlsPartDurationInMs = 0; // 0 means: don't generate 'Low-Latency HLS' partial segments
 char* usernameForREGISTER = NULL;
 char* passwordForREGISTER = NULL;
 
+static UserAuthenticationDatabase* createAuthDB() {
+#ifdef ACCESS_CONTROL
+  // To implement client access control to the RTSP server, do the following:
+  UserAuthenticationDatabase* result = new UserAuthenticationDatabase;
+  result->addUserRecord("username1", "password1"); // replace these with real strings
+      // Repeat this line with each <username>, <password> that you wish to allow access to the server.
+  return result;
+#else
+  return NULL;
+#endif
+}
+
 static RTSPServer* createRTSPServer(Port port) {
-  if (proxyREGISTERRequests) {
+  if (numWorkerThreads > 0) {
+    return DispatchingRTSPServer::createNew(*env, port, authDB);
+  } else if (proxyREGISTERRequests) {
     return RTSPServerWithREGISTERProxying::createNew(*env, port, authDB, authDBForREGISTER, 65, streamRTPOverTCP, verbosityLevel);
+  } else if (streamUsingHLS) {
+    RTSPServerSupportingHTTPStreaming* server = RTSPServerSupportingHTTPStreaming::createNew(*env, port, authDB);
+    if (server != NULL) server->enableLiveHLS(6, hlsPartDurationInMs);
+    return server;
   } else {
     return RTSPServer::createNew(*env, port, authDB);
   }
@@ -49,8 +73,11 @@ void usage() {
        << " [-v|-V]"
        << " [-t|-T <http-port>]"
        << " [-p <rtspServer-port>]"
+       << " [-g]"
+       << " [-w <idle-seconds>|-W]"
+       << " [-s]"
        << " [-u <username> <password>]"
-       << " [-R] [-U <username-for-REGISTER> <password-for-REGISTER>]"
+       << " [-n <num-worker-threads> | -H | -L <part-duration-ms> | -R [-U <username-for-REGISTER> <password-for-REGISTER>]]"
        << " <rtsp-url-1> ... <rtsp-url-n>\n";
   exit(1);
 }
@@ -127,6 +154,69 @@ int main(int argc, char** argv) {
       break;
     }
     
+    case 'g': { // cache each H.264/H.265 stream's most recent GOP, so that new clients can begin decoding immediately
+      cacheGOPs = True;
+      break;
+    }
+
+    case 'w': {
+      // keep each back-end stream playing until it has had no clients for this many seconds
+      if (argc > 2 && argv[2][0] != '-') {
+	if (sscanf(argv[2], "%d", &keepWarmIdleTimeout) == 1 && keepWarmIdleTimeout > 0) {
+	  ++argv; --argc;
+	  break;
+	}
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'W': { // keep each back-end stream playing all the time, even when it has no clients
+      keepWarmIdleTimeout = -1;
+      break;
+    }
+
+    case 's': { // use one connection to each back-end server, shared by all of the streams that we proxy from it
+      ProxyServerMediaSession::shareBackEndConnections = True;
+      break;
+    }
+
+    case 'n': {
+      // proxy the back-end streams in this many worker threads (each with its own event loop), to use several CPU cores
+      if (argc > 2 && argv[2][0] != '-') {
+	if (sscanf(argv[2], "%u", &numWorkerThreads) == 1 && numWorkerThreads > 0) {
+	  ++argv; --argc;
+	  break;
+	}
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
+    case 'H': { // also stream each proxied stream over HTTP, using HLS
+      streamUsingHLS = True;
+      break;
+    }
+
+    case 'L': {
+      // also stream each proxied stream over HTTP, using 'Low-Latency HLS' (with partial segments of this duration)
+      if (argc > 2 && argv[2][0] != '-') {
+	if (sscanf(argv[2], "%u", &hlsPartDurationInMs) == 1 && hlsPartDurationInMs > 0) {
+	  streamUsingHLS = True;
+	  ++argv; --argc;
+	  break;
+	}
+      }
+
+      // If we get here, the option was specified incorrectly:
+      usage();
+      break;
+    }
+
     case 'u': { // specify a username and password (to be used if the 'back end' (i.e., proxied) stream requires authentication)
       if (argc < 4) usage(); // there's no argv[3] (for the "password")
       username = argv[2];
@@ -170,6 +260,14 @@ int main(int argc, char** argv) {
     *env << "The '-U <username> <password>' option can be used only with -R\n";
     usage();
   }
+  if (numWorkerThreads > 0 && proxyREGISTERRequests) {
+    *env << "The -n and -R options cannot both be used!\n";
+    usage();
+  }
+  if (streamUsingHLS && (numWorkerThreads > 0 || proxyREGISTERRequests)) {
+    *env << "The -H (or -L) option cannot be used with -n or -R\n";
+    usage();
+  }
   if (streamRTPOverTCP) {
     if (tunnelOverHTTPPortNum > 0) {
       *env << "The -t and -T options cannot both be used!\n";
@@ -179,12 +277,7 @@ int main(int argc, char** argv) {
     }
   }
 
-#ifdef ACCESS_CONTROL
-  // To implement client access control to the RTSP server, do the following:
-  authDB = new UserAuthenticationDatabase;
-  authDB->addUserRecord("username1", "password1"); // replace these with real strings
-      // Repeat this line with each <username>, <password> that you wish to allow access to the server.
-#endif
+  authDB = createAuthDB();
 
   // Create the RTSP server. Try first with the configured port number,
   // and then with the default port number (554) if different,
@@ -209,6 +302,15 @@ int main(int argc, char** argv) {
     exit(1);
   }
 
+  // If we're using worker threads, then create them now.  Each has its own "UsageEnvironment" and "RTSPServer" (without a
+  // listening socket of its own); our main "RTSPServer" hands it each connection for the streams that it owns.
+  // (Each worker also gets its own "UserAuthenticationDatabase", because these are not thread-safe.)
+  DispatchingRTSPServer* dispatchingServer = numWorkerThreads > 0 ? (DispatchingRTSPServer*)rtspServer : NULL;
+  unsigned w;
+  for (w = 0; w < numWorkerThreads; ++w) {
+    dispatchingServer->addWorker(new ProxyWorker(rtspServerPortNum, createAuthDB()));
+  }
+
   // Create a proxy for each "rtsp://" URL specified on the command line:
   for (i = 1; i < argc; ++i) {
     char const* proxiedStreamURL = argv[i];
@@ -218,13 +320,24 @@ int main(int argc, char** argv) {
     } else {
       sprintf(streamName, "proxyStream-%d", i); // there's more than one stream; distinguish them by name
     }
-    ServerMediaSession* sms
-      = ProxyServerMediaSession::createNew(*env, rtspServer,
+    UsageEnvironment* streamEnv = env;
+    RTSPServer* streamServer = rtspServer;
+    if (dispatchingServer != NULL) {
+      // Assign the streams to the worker threads in turn:
+      ProxyWorker* worker = dispatchingServer->worker((i-1)%numWorkerThreads);
+      streamEnv = &worker->envir();
+      streamServer = worker->rtspServer();
+      dispatchingServer->assignStream(streamName, worker);
+    }
+    ProxyServerMediaSession* sms
+      = ProxyServerMediaSession::createNew(*streamEnv, streamServer,
 					   proxiedStreamURL, streamName,
-					   username, password, tunnelOverHTTPPortNum, verbosityLevel);
-    rtspServer->addServerMediaSession(sms);
+					   username, password, tunnelOverHTTPPortNum, verbosityLevel,
+					   -1, NULL, cacheGOPs);
+    if (keepWarmIdleTimeout != 0) sms->setKeepWarmPolicy(keepWarmIdleTimeout);
+    streamServer->addServerMediaSession(sms);
 
-    char* proxyStreamURL = rtspServer->rtspURL(sms);
+    char* proxyStreamURL = streamServer->rtspURL(sms);
     *env << "RTSP stream, proxying the stream \"" << proxiedStreamURL << "\"\n";
     *env << "\tPlay this stream using the URL: " << proxyStreamURL << "\n";
     delete[] proxyStreamURL;
@@ -239,9 +352,25 @@ int main(int argc, char** argv) {
   // port numbers (8000 and 8080).
 
   if (rtspServer->setUpTunnelingOverHTTP(80) || rtspServer->setUpTunnelingOverHTTP(8000) || rtspServer->setUpTunnelingOverHTTP(8080)) {
-    *env << "\n(We use port " << rtspServer->httpServerPortNum() << " for optional RTSP-over-HTTP tunneling.)\n";
+    if (streamUsingHLS) {
+      *env << "\n(We use port " << rtspServer->httpServerPortNum() << " for optional RTSP-over-HTTP tunneling, or for HTTP live streaming - of each stream, using the URL \"http://<server-address>:" << rtspServer->httpServerPortNum() << "/<stream-name>\".)\n";
+    } else {
+      *env << "\n(We use port " << rtspServer->httpServerPortNum() << " for optional RTSP-over-HTTP tunneling.)\n";
+    }
   } else {
     *env << "\n(RTSP-over-HTTP tunneling is not available.)\n";
+    if (streamUsingHLS) *env << "(HTTP live streaming - the -H or -L option - is not available either.)\n";
+  }
+
+  // Start the worker threads (if any):
+  for (w = 0; w < numWorkerThreads; ++w) {
+    if (!dispatchingServer->worker(w)->start()) {
+      *env << "Failed to start worker thread: " << dispatchingServer->worker(w)->envir().getResultMsg() << "\n";
+      exit(1);
+    }
+  }
+  if (numWorkerThreads > 0) {
+    *env << "(Proxying the streams in " << numWorkerThreads << " worker threads.)\n";
   }
 
   // Now, enter the event loop:
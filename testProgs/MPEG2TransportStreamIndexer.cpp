@@ -22,18 +22,119 @@ along with this library; if not, write to the Free Software Foundation, Inc.,
 
 #include <liveMedia.hh>
 #include <BasicUsageEnvironment.hh>
+#include <GroupsockHelper.hh> // for "gettimeofday()"
+#include <InputFile.hh> // for "GetFileSize()"
+#if defined(__WIN32__) || defined(_WIN32)
+#include <io.h>
+#define NO_INDEXING_THREADS 1
+#else
+#include <unistd.h>
+#endif
+#ifndef NO_INDEXING_THREADS
+#include <pthread.h>
+#endif
 
 void afterPlaying(void* clientData); // forward
+void reportThroughput(); // forward
 
 UsageEnvironment* env;
 char const* programName;
+struct timeval startTime;
+u_int64_t numBytesToIndex;
 
 void usage() {
-  *env << "usage: " << programName << " <transport-stream-file-name>\n";
+#ifndef NO_INDEXING_THREADS
+  *env << "usage: " << programName << " [-a | -j <num-threads>] <transport-stream-file-name>\n";
+#else
+  *env << "usage: " << programName << " [-a] <transport-stream-file-name>\n";
+#endif
   *env << "\twhere <transport-stream-file-name> ends with \".ts\"\n";
+  *env << "\t-a: append to an existing index file (indexing only the part of the Transport Stream that's not already indexed).\n";
+  *env << "\t    (Use this to resume indexing that was interrupted, or to update the index of a file that's still being recorded.)\n";
+#ifndef NO_INDEXING_THREADS
+  *env << "\t-j <num-threads>: index (a large file) in several parts at once, each in its own thread.\n";
+  *env << "\t    (The resulting index file is the same.)\n";
+#endif
   exit(1);
 }
 
+// A "FileSink" that appends to an (already open) file:
+class AppendingFileSink: public FileSink {
+public:
+  AppendingFileSink(UsageEnvironment& env, FILE* fid)
+    : FileSink(env, fid, 20000, NULL) {
+  }
+};
+
+#define INDEX_RECORD_SIZE 11
+
+// Each index record (see "MPEG2IFrameIndexFromTransportStream") identifies the Transport Stream packet that it came from:
+#define RECORD_BEGINS_FRAME(record) (((record)[0]&0x80) != 0)
+#define RECORD_START_OFFSET(record) ((record)[1])
+#define RECORD_PACKET_NUMBER(record) \
+  (((u_int32_t)(record)[10]<<24)|((record)[9]<<16)|((record)[8]<<8)|(record)[7])
+
+Boolean findResumptionPoint(FILE* indexFid, u_int64_t& indexFileSizeToKeep,
+			    unsigned long& transportPacketNumber, u_int8_t& startOffset, float& pcr) {
+  // Look backwards through the index file for the last record that begins a frame.  We'll discard this record
+  // (and those after it), because this frame might not have been complete when the index was written:
+  if (fseek(indexFid, 0, SEEK_END) != 0) return False;
+  long numRecords = ftell(indexFid)/INDEX_RECORD_SIZE; // ignoring any partial record at the end
+
+  while (--numRecords >= 0) {
+    u_int8_t record[INDEX_RECORD_SIZE];
+    if (fseek(indexFid, numRecords*INDEX_RECORD_SIZE, SEEK_SET) != 0
+	|| fread(record, 1, INDEX_RECORD_SIZE, indexFid) != INDEX_RECORD_SIZE) return False;
+
+    if (RECORD_BEGINS_FRAME(record)) {
+      indexFileSizeToKeep = numRecords*INDEX_RECORD_SIZE;
+      startOffset = RECORD_START_OFFSET(record);
+      pcr = (record[5]<<16)|(record[4]<<8)|record[3];
+      pcr += record[6]/256.0f;
+      transportPacketNumber = RECORD_PACKET_NUMBER(record);
+      return True;
+    }
+  }
+
+  return False;
+}
+
+Boolean truncateFile(FILE* fid, u_int64_t newSize) {
+  fflush(fid);
+#if defined(__WIN32__) || defined(_WIN32)
+  return _chsize(_fileno(fid), (long)newSize) == 0;
+#else
+  return ftruncate(fileno(fid), (off_t)newSize) == 0;
+#endif
+}
+
+unsigned readTransportPackets(char const* inputFileName, u_int64_t firstPacketNumber, unsigned numPackets,
+			      unsigned char* to) {
+  // Reads up to "numPackets" Transport Stream packets, beginning with packet "firstPacketNumber".
+  // Returns the number of bytes read.
+  FILE* inputFid = OpenInputFile(*env, inputFileName);
+  if (inputFid == NULL) return 0;
+
+  unsigned numBytesRead = 0;
+  if (SeekFile64(inputFid, (int64_t)(firstPacketNumber*TRANSPORT_PACKET_SIZE), SEEK_SET) == 0) {
+    numBytesRead = fread(to, 1, numPackets*TRANSPORT_PACKET_SIZE, inputFid);
+  }
+  CloseInputFile(inputFid);
+
+  return numBytesRead;
+}
+
+// We get the PAT, PMT and first PCR from this many packets at the start of the Transport Stream:
+#define STREAM_START_NUM_PACKETS 1000
+
+// When resuming indexing, we get the PCR that's current at the resumption point from (up to) this many packets before it.
+// (The PCR is meant to be sent at least every 0.1 seconds; this covers that at up to ~100 Mbps.)
+#define NUM_PACKETS_BEFORE_RESUMPTION_POINT 7000
+
+#ifndef NO_INDEXING_THREADS
+Boolean indexInParallel(char const* inputFileName, char const* outputFileName, unsigned numThreads); // forward
+#endif
+
 int main(int argc, char const** argv) {
   // Begin by setting up our usage environment:
   TaskScheduler* scheduler = BasicTaskScheduler::createNew();
@@ -41,7 +142,27 @@ int main(int argc, char const** argv) {
 
   // Parse the command line:
   programName = argv[0];
+  Boolean appendToExistingIndex = False;
+  unsigned numThreads = 1;
+  while (argc > 2) {
+    char const* const opt = argv[1];
+    if (strcmp(opt, "-a") == 0) {
+      appendToExistingIndex = True;
+#ifndef NO_INDEXING_THREADS
+    } else if (strcmp(opt, "-j") == 0 && argc > 3) {
+      if (sscanf(argv[2], "%u", &numThreads) != 1 || numThreads == 0) usage();
+      ++argv; --argc;
+#endif
+    } else {
+      usage();
+    }
+    ++argv; --argc;
+  }
   if (argc != 2) usage();
+  if (appendToExistingIndex && numThreads > 1) {
+    *env << "The -a and -j options cannot be used together\n";
+    usage();
+  }
 
   char const* inputFileName = argv[1];
   // Check whether the input file name ends with ".ts":
@@ -52,31 +173,83 @@ int main(int argc, char const** argv) {
     usage();
   }
 
-  // Open the input file (as a 'byte stream file source'):
-  FramedSource* input
-    = ByteStreamFileSource::createNew(*env, inputFileName, TRANSPORT_PACKET_SIZE);
+  // The output file name is the same as the input file name, except with suffix ".tsx":
+  char* outputFileName = new char[len+2]; // allow for trailing x\0
+  sprintf(outputFileName, "%sx", inputFileName);
+
+#ifndef NO_INDEXING_THREADS
+  if (numThreads > 1) {
+    *env << "Writing index file \"" << outputFileName << "\" (using up to " << numThreads << " threads)...";
+    gettimeofday(&startTime, NULL);
+    if (!indexInParallel(inputFileName, outputFileName, numThreads)) exit(1);
+
+    reportThroughput();
+    exit(0);
+  }
+#endif
+
+  // Open the input file (as a 'byte stream file source').  (We don't specify a preferred frame size, so that the
+  // indexer can read many Transport Stream packets at a time.)
+  ByteStreamFileSource* input
+    = ByteStreamFileSource::createNew(*env, inputFileName);
   if (input == NULL) {
     *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
     exit(1);
   }
 
   // Create a filter that indexes the input Transport Stream data:
-  FramedSource* indexer
+  MPEG2IFrameIndexFromTransportStream* indexer
     = MPEG2IFrameIndexFromTransportStream::createNew(*env, input);
 
-  // The output file name is the same as the input file name, except with suffix ".tsx":
-  char* outputFileName = new char[len+2]; // allow for trailing x\0
-  sprintf(outputFileName, "%sx", inputFileName);
-
   // Open the output file (for writing), as a 'file sink':
-  MediaSink* output = FileSink::createNew(*env, outputFileName);
+  MediaSink* output = NULL;
+  u_int64_t resumptionOffset = 0;
+  FILE* indexFid;
+  if (appendToExistingIndex && (indexFid = fopen(outputFileName, "r+b")) != NULL) {
+    u_int64_t indexFileSizeToKeep = 0;
+    unsigned long transportPacketNumber = 0;
+    u_int8_t startOffset = 0;
+    float pcr = 0.0;
+    if (findResumptionPoint(indexFid, indexFileSizeToKeep, transportPacketNumber, startOffset, pcr)
+	&& truncateFile(indexFid, indexFileSizeToKeep)) {
+      // Get the PAT, PMT and first PCR from the start of the Transport Stream, and the PCR that's current at the
+      // resumption point from the packets up to (and including) it:
+      unsigned char* streamStart = new unsigned char[STREAM_START_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+      unsigned streamStartSize = readTransportPackets(inputFileName, 0, STREAM_START_NUM_PACKETS, streamStart);
+      unsigned long numPacketsBefore = transportPacketNumber + 1 < NUM_PACKETS_BEFORE_RESUMPTION_POINT
+	? transportPacketNumber + 1 : NUM_PACKETS_BEFORE_RESUMPTION_POINT;
+      unsigned char* packetsBefore = new unsigned char[numPacketsBefore*TRANSPORT_PACKET_SIZE];
+      unsigned packetsBeforeSize
+	= readTransportPackets(inputFileName, transportPacketNumber + 1 - numPacketsBefore, numPacketsBefore,
+			       packetsBefore);
+
+      indexer->setResumptionPoint(transportPacketNumber, startOffset, pcr, streamStart, streamStartSize,
+				  packetsBefore, packetsBeforeSize);
+      delete[] packetsBefore;
+      delete[] streamStart;
+
+      resumptionOffset = (u_int64_t)transportPacketNumber*TRANSPORT_PACKET_SIZE;
+      input->seekToByteAbsolute(resumptionOffset);
+
+      fseek(indexFid, 0, SEEK_END);
+      output = new AppendingFileSink(*env, indexFid);
+      *env << "Resuming indexing at transport packet #" << (unsigned)transportPacketNumber
+	   << " (" << pcr << " seconds)\n";
+    } else {
+      // The existing index file is unusable; re-create it from scratch:
+      fclose(indexFid);
+    }
+  }
+  if (output == NULL) output = FileSink::createNew(*env, outputFileName);
   if (output == NULL) {
     *env << "Failed to open output file \"" << outputFileName << "\"\n";
     exit(1);
   }
+  numBytesToIndex = input->fileSize() > resumptionOffset ? input->fileSize() - resumptionOffset : 0;
 
   // Start playing, to generate the output index file:
   *env << "Writing index file \"" << outputFileName << "\"...";
+  gettimeofday(&startTime, NULL);
   output->startPlaying(*indexer, afterPlaying, NULL);
 
   env->taskScheduler().doEventLoop(); // does not return
@@ -85,6 +258,438 @@ int main(int argc, char const** argv) {
 }
 
 void afterPlaying(void* /*clientData*/) {
-  *env << "...done\n";
+  reportThroughput();
   exit(0);
 }
+
+void reportThroughput() {
+  // Report how quickly we indexed the Transport Stream data:
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  double secondsElapsed = (timeNow.tv_sec - startTime.tv_sec) + (timeNow.tv_usec - startTime.tv_usec)/1000000.0;
+  double megabytesIndexed = numBytesToIndex/1000000.0;
+
+  char buf[100];
+  sprintf(buf, "%.1f MB in %.2f seconds (%.1f MB/s)", megabytesIndexed, secondsElapsed,
+	  secondsElapsed > 0.0 ? megabytesIndexed/secondsElapsed : 0.0);
+  *env << "...done: " << buf << "\n";
+}
+
+#ifndef NO_INDEXING_THREADS
+////////// Indexing in several threads (the "-j" option) //////////
+
+// We split the Transport Stream into equal-sized 'chunks', and index each one (into a temporary file) in its own thread.
+// An indexer that starts part way through the stream starts part way through a frame, so it can't index the start of
+// its chunk correctly.  Instead, each chunk's indexer (except the last) continues past the end of its chunk - by up to
+// CHUNK_OVERLAP_SIZE bytes - and we switch from its index records to those of the next chunk at the first frame that
+// both indexers found.  (From then on, both produce the same index records - except for their PCRs.)
+// Each index record's PCR is relative to the stream's first PCR, and compensates for any earlier decreases in the PCR,
+// so we recompute these (in order) from the PCRs that each chunk's indexer saw.
+// If the two indexers don't find a common frame (e.g., because of bad data), then we index the rest of the stream
+// (from the last frame that's known to be correct) in a single part - as if resuming indexing with "-a".
+
+#define CHUNK_OVERLAP_SIZE (4*1024*1024)
+#define MIN_CHUNK_SIZE (4*CHUNK_OVERLAP_SIZE) // we don't bother splitting smaller files
+
+class IndexingPart {
+  // Indexes Transport Stream packets "firstPacketNumber" (from byte "startOffset" within this packet) up to (but not
+  // including) "limitPacketNumber", into a (temporary) index file, and notes each PCR that it sees.
+public:
+  IndexingPart(char const* inputFileName, char const* indexFileName,
+	       u_int64_t firstPacketNumber, u_int8_t startOffset, u_int64_t limitPacketNumber,
+	       unsigned char const* streamStart, unsigned streamStartSize);
+  virtual ~IndexingPart();
+
+  void run(); // does the indexing (in the current thread)
+  Boolean startThread(); // does the indexing in a new thread
+  void joinThread(); // waits for this thread (if any) to finish
+
+  u_int64_t firstPacketNumber() const { return fFirstPacketNumber; }
+  u_int64_t limitPacketNumber() const { return fLimitPacketNumber; }
+  char const* indexFileName() const { return fIndexFileName; }
+  Boolean succeeded() const { return fSucceeded; }
+  Boolean endedEarly() const { return fEndedEarly; }
+      // True iff the indexer stopped before "limitPacketNumber" (because of bad data) - as indexing the whole stream would
+
+  unsigned numPCRs() const { return fNumPCRs; }
+  u_int64_t pcrPacketNumber(unsigned i) const { return fPCRPacketNumbers[i]; }
+  float pcr(unsigned i) const { return fPCRs[i]; }
+
+private:
+  static void pcrHandler(void* clientData, unsigned long transportPacketNumber, float pcr);
+  static void afterIndexing(void* clientData);
+  static void* threadMain(void* part);
+
+private:
+  char const* fInputFileName;
+  char* fIndexFileName;
+  u_int64_t fFirstPacketNumber;
+  u_int8_t fStartOffset;
+  u_int64_t fLimitPacketNumber;
+  unsigned char const* fStreamStart;
+  unsigned fStreamStartSize;
+  Boolean fSucceeded, fEndedEarly;
+  u_int64_t* fPCRPacketNumbers;
+  float* fPCRs;
+  unsigned fNumPCRs, fMaxNumPCRs;
+  char fIsDone; // our event loop's 'watch variable'
+  Boolean fHaveThread;
+  pthread_t fThread;
+};
+
+IndexingPart::IndexingPart(char const* inputFileName, char const* indexFileName,
+			   u_int64_t firstPacketNumber, u_int8_t startOffset, u_int64_t limitPacketNumber,
+			   unsigned char const* streamStart, unsigned streamStartSize)
+  : fInputFileName(inputFileName), fIndexFileName(strDup(indexFileName)),
+    fFirstPacketNumber(firstPacketNumber), fStartOffset(startOffset), fLimitPacketNumber(limitPacketNumber),
+    fStreamStart(streamStart), fStreamStartSize(streamStartSize),
+    fSucceeded(False), fEndedEarly(False),
+    fPCRPacketNumbers(NULL), fPCRs(NULL), fNumPCRs(0), fMaxNumPCRs(0), fIsDone(0), fHaveThread(False) {
+}
+
+IndexingPart::~IndexingPart() {
+  remove(fIndexFileName);
+  delete[] fIndexFileName;
+  delete[] fPCRPacketNumbers;
+  delete[] fPCRs;
+}
+
+void IndexingPart::run() {
+  // Use our own "UsageEnvironment" (and event loop), because we may be running in our own thread:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  UsageEnvironment* partEnv = BasicUsageEnvironment::createNew(*scheduler);
+
+  ByteStreamFileSource* input = ByteStreamFileSource::createNew(*partEnv, fInputFileName);
+  MediaSink* output = FileSink::createNew(*partEnv, fIndexFileName);
+  if (input != NULL && output != NULL) {
+    input->seekToByteAbsolute(fFirstPacketNumber*TRANSPORT_PACKET_SIZE,
+			      (fLimitPacketNumber - fFirstPacketNumber)*TRANSPORT_PACKET_SIZE);
+
+    MPEG2IFrameIndexFromTransportStream* indexer = MPEG2IFrameIndexFromTransportStream::createNew(*partEnv, input);
+    if (fFirstPacketNumber > 0 || fStartOffset > 0) {
+      // (The PCR that we give here doesn't matter, because the PCRs get recomputed later.)
+      indexer->setResumptionPoint(fFirstPacketNumber, fStartOffset, 0.0f, fStreamStart, fStreamStartSize);
+    }
+    indexer->setPCRHandler(pcrHandler, this);
+
+    output->startPlaying(*indexer, afterIndexing, this);
+    partEnv->taskScheduler().doEventLoop(&fIsDone);
+
+    fSucceeded = True;
+    fEndedEarly = indexer->numTransportPacketsIndexed() < fLimitPacketNumber;
+    Medium::close(output);
+    Medium::close(indexer); // this also closes "input"
+  } else {
+    *partEnv << "Failed to open \"" << (input == NULL ? fInputFileName : fIndexFileName) << "\"\n";
+    Medium::close(output);
+    Medium::close(input);
+  }
+
+  partEnv->reclaim();
+  delete scheduler;
+}
+
+Boolean IndexingPart::startThread() {
+  fHaveThread = pthread_create(&fThread, NULL, threadMain, this) == 0;
+  return fHaveThread;
+}
+
+void IndexingPart::joinThread() {
+  if (fHaveThread) pthread_join(fThread, NULL);
+  fHaveThread = False;
+}
+
+void IndexingPart::pcrHandler(void* clientData, unsigned long transportPacketNumber, float pcr) {
+  IndexingPart* part = (IndexingPart*)clientData;
+
+  if (part->fNumPCRs == part->fMaxNumPCRs) {
+    // Grow our arrays:
+    unsigned newMaxNumPCRs = part->fMaxNumPCRs == 0 ? 1000 : 2*part->fMaxNumPCRs;
+    u_int64_t* newPCRPacketNumbers = new u_int64_t[newMaxNumPCRs];
+    float* newPCRs = new float[newMaxNumPCRs];
+    for (unsigned i = 0; i < part->fNumPCRs; ++i) {
+      newPCRPacketNumbers[i] = part->fPCRPacketNumbers[i];
+      newPCRs[i] = part->fPCRs[i];
+    }
+    delete[] part->fPCRPacketNumbers; part->fPCRPacketNumbers = newPCRPacketNumbers;
+    delete[] part->fPCRs; part->fPCRs = newPCRs;
+    part->fMaxNumPCRs = newMaxNumPCRs;
+  }
+
+  part->fPCRPacketNumbers[part->fNumPCRs] = transportPacketNumber;
+  part->fPCRs[part->fNumPCRs] = pcr;
+  ++part->fNumPCRs;
+}
+
+void IndexingPart::afterIndexing(void* clientData) {
+  IndexingPart* part = (IndexingPart*)clientData;
+  part->fIsDone = 1;
+}
+
+void* IndexingPart::threadMain(void* part) {
+  ((IndexingPart*)part)->run();
+  return NULL;
+}
+
+class PCRRecomputer {
+  // Recomputes the PCRs in index records - in order - from the PCRs in the Transport Stream.  (This duplicates the
+  // computation in "MPEG2IFrameIndexFromTransportStream", so that we get the same result as a single indexer would.)
+public:
+  PCRRecomputer()
+    : fFirstPCR(0.0), fLastPCR(0.0), fHaveSeenFirstPCR(False), fHaveSeenAnyPacket(False), fLastPacketNumber(0) {
+  }
+
+  void notePCR(u_int64_t packetNumber, float pcr) {
+    // We may be told about the PCRs in some packets more than once (by indexers of adjacent chunks); use just the first:
+    if (fHaveSeenAnyPacket && packetNumber <= fLastPacketNumber) return;
+    fHaveSeenAnyPacket = True;
+    fLastPacketNumber = packetNumber;
+
+    if (!fHaveSeenFirstPCR) {
+      fFirstPCR = pcr;
+      fHaveSeenFirstPCR = True;
+    } else if (pcr < fLastPCR) {
+      *env << "\nWarning: At about " << fLastPCR-fFirstPCR
+	   << " seconds into the file, the PCR timestamp decreased - from "
+	   << fLastPCR << " to " << pcr << "\n";
+      fFirstPCR -= (fLastPCR - pcr);
+    }
+    fLastPCR = pcr;
+  }
+
+  void updateRecord(u_int8_t* record) const {
+    // Set the record's PCR, as 24 bits (integer part; little endian) + 8 bits (fractional part):
+    float pcr = fLastPCR - fFirstPCR;
+    unsigned pcr_int = (unsigned)pcr;
+    u_int8_t pcr_frac = (u_int8_t)(256*(pcr-pcr_int));
+    record[3] = (unsigned char)(pcr_int);
+    record[4] = (unsigned char)(pcr_int>>8);
+    record[5] = (unsigned char)(pcr_int>>16);
+    record[6] = (unsigned char)(pcr_frac);
+  }
+
+private:
+  float fFirstPCR, fLastPCR;
+  Boolean fHaveSeenFirstPCR;
+  Boolean fHaveSeenAnyPacket;
+  u_int64_t fLastPacketNumber;
+};
+
+static Boolean readRecord(FILE* fid, u_int8_t* record) {
+  return fread(record, 1, INDEX_RECORD_SIZE, fid) == INDEX_RECORD_SIZE;
+}
+
+static Boolean isSameFrame(u_int8_t const* record, u_int32_t packetNumber, u_int8_t startOffset) {
+  return RECORD_BEGINS_FRAME(record)
+    && RECORD_PACKET_NUMBER(record) == packetNumber && RECORD_START_OFFSET(record) == startOffset;
+}
+
+class FrameList {
+  // The positions (in order) of the frames that an indexer found within some range of Transport Stream packets
+public:
+  FrameList(): fPacketNumbers(NULL), fStartOffsets(NULL), fNumFrames(0), fMaxNumFrames(0), fNextIndex(0) {}
+  virtual ~FrameList() { delete[] fPacketNumbers; delete[] fStartOffsets; }
+
+  void readFrom(char const* indexFileName, u_int64_t limitPacketNumber) {
+    FILE* fid = fopen(indexFileName, "rb");
+    if (fid == NULL) return;
+
+    u_int8_t record[INDEX_RECORD_SIZE];
+    while (readRecord(fid, record) && RECORD_PACKET_NUMBER(record) < limitPacketNumber) {
+      if (!RECORD_BEGINS_FRAME(record)) continue;
+
+      if (fNumFrames == fMaxNumFrames) {
+	// Grow our arrays:
+	unsigned newMaxNumFrames = fMaxNumFrames == 0 ? 1000 : 2*fMaxNumFrames;
+	u_int32_t* newPacketNumbers = new u_int32_t[newMaxNumFrames];
+	u_int8_t* newStartOffsets = new u_int8_t[newMaxNumFrames];
+	for (unsigned i = 0; i < fNumFrames; ++i) {
+	  newPacketNumbers[i] = fPacketNumbers[i];
+	  newStartOffsets[i] = fStartOffsets[i];
+	}
+	delete[] fPacketNumbers; fPacketNumbers = newPacketNumbers;
+	delete[] fStartOffsets; fStartOffsets = newStartOffsets;
+	fMaxNumFrames = newMaxNumFrames;
+      }
+      fPacketNumbers[fNumFrames] = RECORD_PACKET_NUMBER(record);
+      fStartOffsets[fNumFrames] = RECORD_START_OFFSET(record);
+      ++fNumFrames;
+    }
+    fclose(fid);
+  }
+
+  Boolean contains(u_int8_t const* record) {
+    // Because we're called with records in order, we can just move forward through our list:
+    u_int32_t packetNumber = RECORD_PACKET_NUMBER(record);
+    u_int8_t startOffset = RECORD_START_OFFSET(record);
+    while (fNextIndex < fNumFrames
+	   && (fPacketNumbers[fNextIndex] < packetNumber
+	       || (fPacketNumbers[fNextIndex] == packetNumber && fStartOffsets[fNextIndex] < startOffset))) {
+      ++fNextIndex;
+    }
+    return fNextIndex < fNumFrames && isSameFrame(record, fPacketNumbers[fNextIndex], fStartOffsets[fNextIndex]);
+  }
+
+private:
+  u_int32_t* fPacketNumbers;
+  u_int8_t* fStartOffsets;
+  unsigned fNumFrames, fMaxNumFrames;
+  unsigned fNextIndex;
+};
+
+Boolean indexInParallel(char const* inputFileName, char const* outputFileName, unsigned numThreads) {
+  FILE* inputFid = OpenInputFile(*env, inputFileName);
+  if (inputFid == NULL) {
+    *env << "Failed to open input file \"" << inputFileName << "\" (does it exist?)\n";
+    return False;
+  }
+  numBytesToIndex = GetFileSize(inputFileName, inputFid);
+  CloseInputFile(inputFid);
+  u_int64_t const numPackets = numBytesToIndex/TRANSPORT_PACKET_SIZE;
+
+  // Each chunk's indexer gets the PAT, PMT and first PCR from the start of the Transport Stream:
+  unsigned char* streamStart = new unsigned char[STREAM_START_NUM_PACKETS*TRANSPORT_PACKET_SIZE];
+  unsigned streamStartSize = readTransportPackets(inputFileName, 0, STREAM_START_NUM_PACKETS, streamStart);
+
+  // Split the stream into chunks, and start indexing each one in its own thread:
+  unsigned numChunks = numThreads;
+  if (numChunks > numBytesToIndex/MIN_CHUNK_SIZE) numChunks = (unsigned)(numBytesToIndex/MIN_CHUNK_SIZE);
+  if (numChunks == 0) numChunks = 1;
+  u_int64_t const numOverlapPackets = CHUNK_OVERLAP_SIZE/TRANSPORT_PACKET_SIZE;
+  IndexingPart** chunks = new IndexingPart*[numChunks];
+  char* partIndexFileName = new char[strlen(outputFileName) + 30];
+  unsigned i;
+  for (i = 0; i < numChunks; ++i) {
+    u_int64_t firstPacketNumber = (numPackets*i)/numChunks;
+    u_int64_t limitPacketNumber = i+1 == numChunks ? numPackets : (numPackets*(i+1))/numChunks + numOverlapPackets;
+    if (limitPacketNumber > numPackets) limitPacketNumber = numPackets;
+
+    sprintf(partIndexFileName, "%s.part%u", outputFileName, i);
+    chunks[i] = new IndexingPart(inputFileName, partIndexFileName, firstPacketNumber, 0, limitPacketNumber,
+				 streamStart, streamStartSize);
+  }
+  for (i = 0; i < numChunks; ++i) {
+    // (We index the last chunk in this thread.  If a thread can't be created, we index its chunk here too.)
+    if (i+1 == numChunks || !chunks[i]->startThread()) chunks[i]->run();
+  }
+  Boolean result = True;
+  for (i = 0; i < numChunks; ++i) {
+    chunks[i]->joinThread();
+    if (!chunks[i]->succeeded()) result = False;
+  }
+
+  // Then write the output index file from the chunks' index records:
+  FILE* outputFid = result ? fopen(outputFileName, "wb") : NULL;
+  if (result && outputFid == NULL) {
+    *env << "Failed to open output file \"" << outputFileName << "\"\n";
+    result = False;
+  }
+  PCRRecomputer pcrRecomputer;
+  IndexingPart* finalPart = NULL; // used if we can't join two chunks' index records
+  Boolean haveFirstFrame = False; // if True, we use the current part's records from (the first record of) this frame:
+  u_int32_t firstFramePacketNumber = 0;
+  u_int8_t firstFrameStartOffset = 0;
+  IndexingPart* part = result ? chunks[0] : NULL;
+  for (i = 0; part != NULL; ++i) {
+    IndexingPart* nextPart = finalPart == NULL && i+1 < numChunks ? chunks[i+1] : NULL;
+
+    FILE* partFid = fopen(part->indexFileName(), "rb");
+    if (partFid == NULL) {
+      result = False;
+      break;
+    }
+
+    // Find the frames that the next chunk's indexer found in the packets that we also indexed (beyond our chunk):
+    FrameList nextPartFrames;
+    if (nextPart != NULL) nextPartFrames.readFrom(nextPart->indexFileName(), part->limitPacketNumber());
+
+    // Find our last frame.  If we get to it without having found a frame that the next chunk's indexer also found,
+    // then we'll index the rest of the stream from it:
+    u_int64_t ignored1; float ignored2;
+    unsigned long lastFramePacketNumber = 0; u_int8_t lastFrameStartOffset = 0;
+    Boolean haveLastFrame
+      = findResumptionPoint(partFid, ignored1, lastFramePacketNumber, lastFrameStartOffset, ignored2);
+    fseek(partFid, 0, SEEK_SET);
+
+    u_int8_t record[INDEX_RECORD_SIZE];
+    Boolean haveRecord = readRecord(partFid, record);
+    if (haveFirstFrame) {
+      // Skip over the records before this frame (which we used from the previous part):
+      while (haveRecord && !isSameFrame(record, firstFramePacketNumber, firstFrameStartOffset)) {
+	haveRecord = readRecord(partFid, record);
+      }
+    }
+
+    // If we found no frame at all (which can happen only for the first chunk), then index the whole stream in one part:
+    Boolean resumeFromHere = nextPart != NULL && !haveLastFrame && !part->endedEarly();
+    haveFirstFrame = False;
+    unsigned pcrIndex = 0;
+    for (; haveRecord && !resumeFromHere; haveRecord = readRecord(partFid, record)) {
+      if (nextPart != NULL && RECORD_BEGINS_FRAME(record)) {
+	if (RECORD_PACKET_NUMBER(record) >= nextPart->firstPacketNumber() && nextPartFrames.contains(record)) {
+	  // The next chunk's indexer also found this frame.  We use its records from here:
+	  haveFirstFrame = True;
+	} else if (!part->endedEarly() && isSameFrame(record, (u_int32_t)lastFramePacketNumber, lastFrameStartOffset)) {
+	  // We didn't find a common frame, so we can't use the next chunk's index records:
+	  resumeFromHere = True;
+	}
+	if (haveFirstFrame || resumeFromHere) {
+	  firstFramePacketNumber = RECORD_PACKET_NUMBER(record);
+	  firstFrameStartOffset = RECORD_START_OFFSET(record);
+	  break;
+	}
+      }
+
+      // Recompute the record's PCR, from the PCRs in the packets up to (and including) its packet:
+      u_int64_t packetNumber = RECORD_PACKET_NUMBER(record);
+      while (pcrIndex < part->numPCRs() && part->pcrPacketNumber(pcrIndex) <= packetNumber) {
+	pcrRecomputer.notePCR(part->pcrPacketNumber(pcrIndex), part->pcr(pcrIndex));
+	++pcrIndex;
+      }
+      pcrRecomputer.updateRecord(record);
+      if (fwrite(record, 1, INDEX_RECORD_SIZE, outputFid) != INDEX_RECORD_SIZE) result = False;
+    }
+    fclose(partFid);
+    if (!haveFirstFrame && !resumeFromHere) break; // this part's index records were the last ones
+
+    if (!haveLastFrame) {
+      firstFramePacketNumber = (u_int32_t)part->firstPacketNumber();
+      firstFrameStartOffset = 0;
+    }
+    // Use the PCRs that only this part saw (before the frame where the next part's records begin):
+    while (pcrIndex < part->numPCRs() && part->pcrPacketNumber(pcrIndex) < firstFramePacketNumber) {
+      pcrRecomputer.notePCR(part->pcrPacketNumber(pcrIndex), part->pcr(pcrIndex));
+      ++pcrIndex;
+    }
+
+    if (haveFirstFrame) {
+      part = nextPart;
+    } else { // resumeFromHere
+      // Index the rest of the stream (from this frame) in a single, final part:
+      if (haveLastFrame) {
+	*env << "\nCouldn't join the index records of chunks " << i << " and " << i+1
+	     << "; indexing the rest of the stream from transport packet #" << firstFramePacketNumber << "\n";
+      }
+      sprintf(partIndexFileName, "%s.part%u", outputFileName, numChunks);
+      part = finalPart
+	= new IndexingPart(inputFileName, partIndexFileName, firstFramePacketNumber, firstFrameStartOffset, numPackets,
+			   streamStart, streamStartSize);
+      finalPart->run();
+      if (!finalPart->succeeded()) {
+	result = False;
+	break;
+      }
+    }
+  }
+  if (outputFid != NULL && fclose(outputFid) != 0) result = False;
+  if (!result) *env << "Failed to write index file \"" << outputFileName << "\"\n";
+
+  for (i = 0; i < numChunks; ++i) delete chunks[i]; // this also removes each chunk's index file
+  delete[] chunks;
+  delete finalPart;
+  delete[] partIndexFileName;
+  delete[] streamStart;
+
+  return result;
+}
+#endif
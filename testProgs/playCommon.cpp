@@ -1317,6 +1317,10 @@ void printQOSData(int exitCode) {
       }
       *env << "num_packets_received\t" << numPacketsReceived << "\n";
       *env << "num_packets_lost\t" << int(numPacketsExpected - numPacketsReceived) << "\n";
+      if (src->numFECPacketsReceived() > 0) {
+	// (Packets that were recovered using FEC are included in the 'lost' count above.)
+	*env << "num_packets_recovered_using_fec\t" << src->numPacketsRecoveredUsingFEC() << "\n";
+      }
       
       if (curQOSRecord != NULL) {
 	unsigned secsDiff = curQOSRecord->measurementEndTime.tv_sec
@@ -0,0 +1,305 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A benchmark for our Base-64 encoding and decoding: Measures the throughput of the library's encoders and decoders
+// (including the "Base64StreamDecoder" that's used for RTSP-over-HTTP tunneling, and the generation of H.264
+// "sprop-parameter-sets" by "H264VideoRTPSink"), and compares it with that of our original (byte-at-a-time)
+// implementation.  Before measuring, it checks that each produces the same results as the original.
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "Base64.hh"
+
+// Command-line options (with their default values):
+unsigned dataSize = 1000000; // -s <num-bytes-to-encode>
+double minMeasurementTime = 0.5; // -t <seconds-per-measurement>
+
+UsageEnvironment* env;
+char const* progName;
+
+void usage() {
+  *env << "usage: " << progName << " [-s <num-bytes-to-encode>] [-t <seconds-per-measurement>]\n";
+  exit(1);
+}
+
+////////// Our original implementation, for comparison //////////
+
+static char originalDecodeTable[256];
+
+static void initOriginalDecodeTable() {
+  int i;
+  for (i = 0; i < 256; ++i) originalDecodeTable[i] = (char)0x80;
+      // default value: invalid
+
+  for (i = 'A'; i <= 'Z'; ++i) originalDecodeTable[i] = 0 + (i - 'A');
+  for (i = 'a'; i <= 'z'; ++i) originalDecodeTable[i] = 26 + (i - 'a');
+  for (i = '0'; i <= '9'; ++i) originalDecodeTable[i] = 52 + (i - '0');
+  originalDecodeTable[(unsigned char)'+'] = 62;
+  originalDecodeTable[(unsigned char)'/'] = 63;
+  originalDecodeTable[(unsigned char)'='] = 0;
+}
+
+static unsigned char* originalBase64Decode(char const* in, unsigned inSize, unsigned& resultSize) {
+  unsigned char* out = (unsigned char*)strDupSize(in); // ensures we have enough space
+  int k = 0;
+  int paddingCount = 0;
+  int const jMax = inSize - 3;
+  for (int j = 0; j < jMax; j += 4) {
+    char inTmp[4], outTmp[4];
+    for (int i = 0; i < 4; ++i) {
+      inTmp[i] = in[i+j];
+      if (inTmp[i] == '=') ++paddingCount;
+      outTmp[i] = originalDecodeTable[(unsigned char)inTmp[i]];
+      if ((outTmp[i]&0x80) != 0) outTmp[i] = 0;
+    }
+
+    out[k++] = (outTmp[0]<<2) | (outTmp[1]>>4);
+    out[k++] = (outTmp[1]<<4) | (outTmp[2]>>2);
+    out[k++] = (outTmp[2]<<6) | outTmp[3];
+  }
+
+  while (paddingCount > 0 && k > 0 && out[k-1] == '\0') { --k; --paddingCount; }
+  resultSize = k;
+  unsigned char* result = new unsigned char[resultSize];
+  memmove(result, out, resultSize);
+  delete[] out;
+
+  return result;
+}
+
+static const char originalBase64Char[] =
+"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static char* originalBase64Encode(char const* origSigned, unsigned origLength) {
+  unsigned char const* orig = (unsigned char const*)origSigned;
+  unsigned const numOrig24BitValues = origLength/3;
+  Boolean havePadding = origLength > numOrig24BitValues*3;
+  Boolean havePadding2 = origLength == numOrig24BitValues*3 + 2;
+  unsigned const numResultBytes = 4*(numOrig24BitValues + havePadding);
+  char* result = new char[numResultBytes+1];
+
+  unsigned i;
+  for (i = 0; i < numOrig24BitValues; ++i) {
+    result[4*i+0] = originalBase64Char[(orig[3*i]>>2)&0x3F];
+    result[4*i+1] = originalBase64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
+    result[4*i+2] = originalBase64Char[((orig[3*i+1]<<2) | (orig[3*i+2]>>6))&0x3F];
+    result[4*i+3] = originalBase64Char[orig[3*i+2]&0x3F];
+  }
+
+  if (havePadding) {
+    result[4*i+0] = originalBase64Char[(orig[3*i]>>2)&0x3F];
+    if (havePadding2) {
+      result[4*i+1] = originalBase64Char[(((orig[3*i]&0x3)<<4) | (orig[3*i+1]>>4))&0x3F];
+      result[4*i+2] = originalBase64Char[(orig[3*i+1]<<2)&0x3F];
+    } else {
+      result[4*i+1] = originalBase64Char[((orig[3*i]&0x3)<<4)&0x3F];
+      result[4*i+2] = '=';
+    }
+    result[4*i+3] = '=';
+  }
+
+  result[numResultBytes] = '\0';
+  return result;
+}
+
+////////// The operations that we measure //////////
+
+unsigned char* origData; // "dataSize" bytes of (pseudo-random) data
+char* encodedData; // its Base-64 encoding
+unsigned encodedDataSize;
+char* tunneledData; // the same encoding, split into lines (as a RTSP-over-HTTP client might send it)
+unsigned tunneledDataSize;
+#define TUNNELED_LINE_LENGTH 76
+unsigned char* outBuffer; // large enough for any result
+RTPSink* h264Sink;
+
+// The sizes of the successive pieces in which a RTSP server might read tunneled data:
+unsigned const pieceSizes[] = { 1448, 1448, 537, 4096, 1, 2, 3, 1448, 65, 8192, 1448, 100 };
+#define NUM_PIECE_SIZES (sizeof pieceSizes/sizeof pieceSizes[0])
+
+void runOriginalEncode() { delete[] originalBase64Encode((char const*)origData, dataSize); }
+void runEncode() { delete[] base64Encode((char const*)origData, dataSize); }
+void runEncodeInto() { base64EncodeInto((char const*)origData, dataSize, (char*)outBuffer); }
+
+void runOriginalDecode() { unsigned resultSize; delete[] originalBase64Decode(encodedData, encodedDataSize, resultSize); }
+void runDecode() { unsigned resultSize; delete[] base64Decode(encodedData, encodedDataSize, resultSize); }
+void runDecodeInto() { base64DecodeInto(encodedData, encodedDataSize, outBuffer); }
+
+unsigned runStreamDecode() {
+  Base64StreamDecoder decoder;
+  unsigned char* out = outBuffer;
+  for (unsigned i = 0, offset = 0; offset < tunneledDataSize; ++i) {
+    unsigned pieceSize = pieceSizes[i%NUM_PIECE_SIZES];
+    if (pieceSize > tunneledDataSize - offset) pieceSize = tunneledDataSize - offset;
+    out += decoder.decode(&tunneledData[offset], pieceSize, out);
+    offset += pieceSize;
+  }
+  return out - outBuffer;
+}
+void runStreamDecodeVoid() { runStreamDecode(); }
+
+void runH264SpropGeneration() { h264Sink->auxSDPLine(); }
+
+typedef void (BenchmarkFunc)();
+
+static double secondsSince(struct timeval const& startTime) {
+  struct timeval timeNow;
+  gettimeofday(&timeNow, NULL);
+  return (timeNow.tv_sec - startTime.tv_sec) + (timeNow.tv_usec - startTime.tv_usec)/1000000.0;
+}
+
+// Calls "func" repeatedly (for at least "minMeasurementTime" seconds), and returns the number of calls per second:
+static double measure(BenchmarkFunc* func) {
+  func(); // once, to warm up
+
+  struct timeval startTime;
+  gettimeofday(&startTime, NULL);
+  unsigned numCalls = 0;
+  double elapsedTime;
+  do {
+    for (unsigned i = 0; i < 10; ++i) func();
+    numCalls += 10;
+  } while ((elapsedTime = secondsSince(startTime)) < minMeasurementTime);
+
+  return numCalls/elapsedTime;
+}
+
+static double reportThroughput(char const* name, BenchmarkFunc* func, unsigned numBytesPerCall,
+			       double comparisonThroughput = 0.0) {
+  double throughput = measure(func)*numBytesPerCall/1000000.0; // in MB/s
+  char line[200];
+  sprintf(line, "%-48s %9.1f MB/s", name, throughput);
+  *env << line;
+  if (comparisonThroughput > 0.0) {
+    sprintf(line, "  (%.2fx the original)", throughput/comparisonThroughput);
+    *env << line;
+  }
+  *env << "\n";
+
+  return throughput;
+}
+
+static void checkResult(Boolean isOK, char const* name) {
+  if (!isOK) {
+    *env << "Error: " << name << " gave a different result from our original implementation\n";
+    exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1) {
+    char* const opt = argv[1];
+    if (opt[0] != '-' || argc < 3) usage();
+
+    switch (opt[1]) {
+    case 's': {
+      if (sscanf(argv[2], "%u", &dataSize) != 1 || dataSize == 0) usage();
+      break;
+    }
+    case 't': {
+      if (sscanf(argv[2], "%lf", &minMeasurementTime) != 1 || minMeasurementTime <= 0.0) usage();
+      break;
+    }
+    default: {
+      usage();
+      break;
+    }
+    }
+
+    argc -= 2; argv += 2;
+  }
+  initOriginalDecodeTable();
+
+  // Generate our data, and its encodings:
+  origData = new unsigned char[dataSize];
+  u_int32_t x = 1;
+  for (unsigned i = 0; i < dataSize; ++i) {
+    x ^= x<<13; x ^= x>>17; x ^= x<<5;
+    origData[i] = (unsigned char)x;
+  }
+  encodedData = originalBase64Encode((char const*)origData, dataSize);
+  encodedDataSize = strlen(encodedData);
+  tunneledData = new char[encodedDataSize + 2*(encodedDataSize/TUNNELED_LINE_LENGTH + 1)];
+  tunneledDataSize = 0;
+  for (unsigned i = 0; i < encodedDataSize; i += TUNNELED_LINE_LENGTH) {
+    unsigned lineLength = encodedDataSize - i < TUNNELED_LINE_LENGTH ? encodedDataSize - i : TUNNELED_LINE_LENGTH;
+    memcpy(&tunneledData[tunneledDataSize], &encodedData[i], lineLength);
+    tunneledDataSize += lineLength;
+    tunneledData[tunneledDataSize++] = '\r'; tunneledData[tunneledDataSize++] = '\n';
+  }
+  outBuffer = new unsigned char[encodedDataSize + 1];
+
+  // A typical (1080p, High profile) SPS and PPS:
+  u_int8_t const sps[] = { 0x67, 0x64, 0x00, 0x28, 0xAC, 0xD9, 0x40, 0x78, 0x02, 0x27, 0xE5, 0x84, 0x00, 0x00, 0x03,
+			   0x00, 0x04, 0x00, 0x00, 0x03, 0x00, 0xF0, 0x3C, 0x60, 0xC6, 0x58 };
+  u_int8_t const pps[] = { 0x68, 0xEB, 0xE3, 0xCB, 0x22, 0xC0 };
+  struct in_addr dummyAddress; dummyAddress.s_addr = 0;
+  Groupsock dummyGroupsock(*env, dummyAddress, 0, 255);
+  h264Sink = H264VideoRTPSink::createNew(*env, &dummyGroupsock, 96, sps, sizeof sps, pps, sizeof pps);
+
+  // Check that each operation gives the same result as our original implementation:
+  char* encoded = base64Encode((char const*)origData, dataSize);
+  checkResult(strcmp(encoded, encodedData) == 0, "base64Encode()");
+  delete[] encoded;
+  unsigned encodedSize = base64EncodeInto((char const*)origData, dataSize, (char*)outBuffer);
+  checkResult(encodedSize == encodedDataSize && memcmp(outBuffer, encodedData, encodedSize) == 0, "base64EncodeInto()");
+
+  unsigned decodedSize;
+  unsigned char* decoded = base64Decode(encodedData, encodedDataSize, decodedSize);
+  checkResult(decodedSize == dataSize && memcmp(decoded, origData, dataSize) == 0, "base64Decode()");
+  delete[] decoded;
+  decodedSize = base64DecodeInto(encodedData, encodedDataSize, outBuffer);
+  checkResult(decodedSize == dataSize && memcmp(outBuffer, origData, dataSize) == 0, "base64DecodeInto()");
+  decodedSize = runStreamDecode();
+  checkResult(decodedSize == dataSize && memcmp(outBuffer, origData, dataSize) == 0, "Base64StreamDecoder");
+
+  char* spsBase64 = originalBase64Encode((char const*)sps, sizeof sps);
+  char* ppsBase64 = originalBase64Encode((char const*)pps, sizeof pps);
+  char const* fmtpLine = h264Sink->auxSDPLine();
+  char const* sprop = fmtpLine == NULL ? NULL : strstr(fmtpLine, "sprop-parameter-sets=");
+  checkResult(sprop != NULL && strncmp(sprop += 21, spsBase64, strlen(spsBase64)) == 0
+	      && sprop[strlen(spsBase64)] == ','
+	      && strncmp(&sprop[strlen(spsBase64)+1], ppsBase64, strlen(ppsBase64)) == 0,
+	      "H264VideoRTPSink::auxSDPLine()");
+  delete[] spsBase64; delete[] ppsBase64;
+
+  // Then measure each operation:
+  *env << "Encoding " << dataSize << " bytes:\n";
+  double originalThroughput = reportThroughput("  original base64Encode()", runOriginalEncode, dataSize);
+  reportThroughput("  base64Encode()", runEncode, dataSize, originalThroughput);
+  reportThroughput("  base64EncodeInto()", runEncodeInto, dataSize, originalThroughput);
+
+  *env << "Decoding " << encodedDataSize << " bytes (throughput is of decoded bytes):\n";
+  originalThroughput = reportThroughput("  original base64Decode()", runOriginalDecode, dataSize);
+  reportThroughput("  base64Decode()", runDecode, dataSize, originalThroughput);
+  reportThroughput("  base64DecodeInto()", runDecodeInto, dataSize, originalThroughput);
+  reportThroughput("  Base64StreamDecoder (tunneled, in pieces)", runStreamDecodeVoid, dataSize, originalThroughput);
+
+  char line[200];
+  sprintf(line, "Generating a H.264 \"a=fmtp:\" line (with \"sprop-parameter-sets\"): %.0f lines/s\n",
+	  measure(runH264SpropGeneration));
+  *env << line;
+
+  Medium::close(h264Sink);
+  delete[] outBuffer; delete[] tunneledData; delete[] encodedData; delete[] origData;
+  return 0;
+}
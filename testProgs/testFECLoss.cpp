@@ -0,0 +1,343 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A test program for RTP forward error correction (FEC).  It streams a synthetic RTP stream - plus FEC packets - over
+// the loopback interface, through a 'lossy link' that drops some of the packets (at random, optionally in bursts).
+// The receiver uses the FEC packets to recover dropped media packets.  At the end, we report how many of the dropped
+// packets were recovered, and how many were lost, and check that every frame that was delivered is intact.
+// (The exit code is 0 iff the results were consistent, and no frame was corrupted.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include "GroupsockHelper.hh"
+
+// Command-line options (with their default values):
+unsigned numFrames = 5000; // -n <num-frames> (each frame is sent in its own RTP packet)
+unsigned frameRate = 1000; // -r <frames-per-second>
+double lossPercentage = 5.0; // -l <loss-percentage>
+unsigned burstLength = 1; // -b <burst-length> (the number of consecutive packets dropped each time)
+unsigned fecRowSize = 5, fecNumRows = 1; // -f <row-size>x<num-rows> ("-f 0" means: don't use FEC)
+u_int32_t lossSeed = 1; // -s <random-seed>
+
+#define FRAME_SIZE 1000
+#define NUM_TRAILING_FRAMES 200
+    // After our "numFrames" frames, we send these extra frames (which the link never drops), so that the receiver doesn't
+    // wait - at the end of the stream - for packets that it will never get.  We don't count these frames.
+#define MEDIA_PAYLOAD_TYPE 96
+#define FEC_PAYLOAD_TYPE 97
+#define TIMESTAMP_FREQUENCY 90000
+
+// The (loopback) ports that we use:
+Port const senderPort(18800);
+Port const linkPort(18802); // the sender sends to this port; the 'lossy link' forwards (most) packets to:
+Port const receiverPort(18804);
+
+UsageEnvironment* env;
+char const* progName;
+struct in_addr loopbackAddress;
+RTPSink* videoSink;
+RTPSource* videoSource;
+
+void usage() {
+  *env << "usage: " << progName << " [-n <num-frames>] [-r <frames-per-second>] [-l <loss-percentage>] [-b <burst-length>]"
+       << " [-f <row-size>x<num-rows> | -f 0] [-s <random-seed>]\n";
+  exit(1);
+}
+
+// Each frame begins with its (4-byte) index, followed by bytes that depend on this index:
+static void fillInFrame(unsigned char* frame, unsigned index) {
+  frame[0] = index>>24; frame[1] = index>>16; frame[2] = index>>8; frame[3] = index;
+  for (unsigned i = 4; i < FRAME_SIZE; ++i) frame[i] = (unsigned char)(index*31 + i);
+}
+
+// A source that generates "numFrames" frames, each "FRAME_SIZE" bytes long:
+class TestFrameSource: public FramedSource {
+public:
+  static TestFrameSource* createNew(UsageEnvironment& env) { return new TestFrameSource(env); }
+
+protected:
+  TestFrameSource(UsageEnvironment& env): FramedSource(env), fFrameIndex(0) {}
+
+private: // redefined virtual functions:
+  virtual void doGetNextFrame();
+
+private:
+  unsigned fFrameIndex;
+};
+
+void TestFrameSource::doGetNextFrame() {
+  if (fFrameIndex == numFrames + NUM_TRAILING_FRAMES || fMaxSize < FRAME_SIZE) {
+    handleClosure();
+    return;
+  }
+
+  fillInFrame(fTo, fFrameIndex++);
+  fFrameSize = FRAME_SIZE;
+  gettimeofday(&fPresentationTime, NULL);
+  fDurationInMicroseconds = 1000000/frameRate;
+  FramedSource::afterGetting(this);
+}
+
+// A sink that checks - and records the index of - each frame that it receives:
+class CheckingSink: public MediaSink {
+public:
+  static CheckingSink* createNew(UsageEnvironment& env) { return new CheckingSink(env); }
+
+  unsigned numFramesReceived; // (not counting duplicates)
+  unsigned numFramesCorrupted;
+  unsigned numDuplicateFrames;
+
+protected:
+  CheckingSink(UsageEnvironment& env);
+  virtual ~CheckingSink();
+
+private:
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime, unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes);
+
+private: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+
+private:
+  unsigned char fBuffer[FRAME_SIZE+1]; // allow for detecting oversize frames
+  unsigned char fExpectedFrame[FRAME_SIZE];
+  Boolean* fFrameWasReceived; // indexed by frame index
+};
+
+CheckingSink::CheckingSink(UsageEnvironment& env)
+  : MediaSink(env), numFramesReceived(0), numFramesCorrupted(0), numDuplicateFrames(0) {
+  fFrameWasReceived = new Boolean[numFrames];
+  for (unsigned i = 0; i < numFrames; ++i) fFrameWasReceived[i] = False;
+}
+
+CheckingSink::~CheckingSink() {
+  delete[] fFrameWasReceived;
+}
+
+void CheckingSink::afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				     struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  CheckingSink* sink = (CheckingSink*)clientData;
+  sink->afterGettingFrame(frameSize, numTruncatedBytes);
+}
+
+void CheckingSink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes) {
+  unsigned index = (fBuffer[0]<<24)|(fBuffer[1]<<16)|(fBuffer[2]<<8)|fBuffer[3];
+  Boolean isIntact = frameSize == FRAME_SIZE && numTruncatedBytes == 0 && index < numFrames + NUM_TRAILING_FRAMES;
+  if (isIntact) {
+    fillInFrame(fExpectedFrame, index);
+    isIntact = memcmp(fBuffer, fExpectedFrame, FRAME_SIZE) == 0;
+  }
+
+  if (!isIntact) {
+    ++numFramesCorrupted;
+  } else if (index >= numFrames) {
+    // one of our trailing frames; ignore it
+  } else if (fFrameWasReceived[index]) {
+    ++numDuplicateFrames;
+  } else {
+    fFrameWasReceived[index] = True;
+    ++numFramesReceived;
+  }
+
+  continuePlaying();
+}
+
+Boolean CheckingSink::continuePlaying() {
+  if (fSource == NULL) return False;
+
+  fSource->getNextFrame(fBuffer, sizeof fBuffer, afterGettingFrame, this, onSourceClosure, this);
+  return True;
+}
+
+CheckingSink* checkingSink;
+
+// The 'lossy link': Packets sent to "linkPort" are forwarded to "receiverPort" - except for those that we drop:
+int linkSocket;
+unsigned numMediaPacketsForwarded = 0, numMediaPacketsDropped = 0;
+unsigned numFECPacketsForwarded = 0, numFECPacketsDropped = 0;
+unsigned numTrailingPackets = 0; // (media or FEC) packets sent after our "numFrames" media packets; not counted above
+
+static Boolean shouldDropPacket() {
+  // Use our own (xorshift) random number generator, so that the loss pattern depends only on "lossSeed":
+  static unsigned numPacketsLeftInBurst = 0;
+  lossSeed ^= lossSeed<<13; lossSeed ^= lossSeed>>17; lossSeed ^= lossSeed<<5;
+
+  if (numPacketsLeftInBurst > 0) {
+    --numPacketsLeftInBurst;
+    return True;
+  }
+  if ((lossSeed%1000000) < lossPercentage*10000/burstLength) {
+    numPacketsLeftInBurst = burstLength - 1;
+    return True;
+  }
+  return False;
+}
+
+void linkPacketHandler(void* /*clientData*/, int /*mask*/) {
+  unsigned char packet[2000];
+  struct sockaddr_in fromAddress;
+  int packetSize = readSocket(*env, linkSocket, packet, sizeof packet, fromAddress);
+  if (packetSize < 12) return;
+
+  Boolean isFECPacket = (packet[1]&0x7F) == FEC_PAYLOAD_TYPE;
+  if (numMediaPacketsForwarded + numMediaPacketsDropped == numFrames) {
+    ++numTrailingPackets;
+  } else if (shouldDropPacket()) {
+    if (isFECPacket) ++numFECPacketsDropped; else ++numMediaPacketsDropped;
+    return;
+  } else {
+    if (isFECPacket) ++numFECPacketsForwarded; else ++numMediaPacketsForwarded;
+  }
+  writeSocket(*env, linkSocket, loopbackAddress, receiverPort.num(), packet, packetSize);
+}
+
+void afterPlaying(void* clientData); // forward
+void reportResults(void* clientData); // forward
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1) {
+    char* const opt = argv[1];
+    if (opt[0] != '-' || argc < 3) usage();
+
+    switch (opt[1]) {
+    case 'n': {
+      if (sscanf(argv[2], "%u", &numFrames) != 1 || numFrames == 0) usage();
+      break;
+    }
+    case 'r': {
+      if (sscanf(argv[2], "%u", &frameRate) != 1 || frameRate == 0) usage();
+      break;
+    }
+    case 'l': {
+      if (sscanf(argv[2], "%lf", &lossPercentage) != 1 || lossPercentage < 0.0 || lossPercentage > 100.0) usage();
+      break;
+    }
+    case 'b': {
+      if (sscanf(argv[2], "%u", &burstLength) != 1 || burstLength == 0) usage();
+      break;
+    }
+    case 'f': {
+      if (strcmp(argv[2], "0") == 0) {
+	fecRowSize = fecNumRows = 0;
+      } else if (sscanf(argv[2], "%ux%u", &fecRowSize, &fecNumRows) != 2 || fecRowSize == 0) {
+	usage();
+      }
+      break;
+    }
+    case 's': {
+      if (sscanf(argv[2], "%u", &lossSeed) != 1 || lossSeed == 0) usage();
+      break;
+    }
+    default: {
+      usage();
+      break;
+    }
+    }
+
+    argc -= 2; argv += 2;
+  }
+  loopbackAddress.s_addr = our_inet_addr("127.0.0.1");
+
+  // Set up the 'lossy link':
+  linkSocket = setupDatagramSocket(*env, linkPort);
+  if (linkSocket < 0) {
+    *env << "Failed to create the link socket: " << env->getResultMsg() << "\n";
+    exit(1);
+  }
+  increaseReceiveBufferTo(*env, linkSocket, 2000000);
+  env->taskScheduler().turnOnBackgroundReadHandling(linkSocket, linkPacketHandler, NULL);
+
+  // Set up the receiver:
+  Groupsock receiverGroupsock(*env, loopbackAddress, receiverPort, 255);
+  increaseReceiveBufferTo(*env, receiverGroupsock.socketNum(), 2000000);
+  videoSource = SimpleRTPSource::createNew(*env, &receiverGroupsock, MEDIA_PAYLOAD_TYPE, TIMESTAMP_FREQUENCY,
+					   "video/X-TEST");
+  if (fecRowSize > 0) videoSource->enableFEC(FEC_PAYLOAD_TYPE);
+  checkingSink = CheckingSink::createNew(*env);
+  checkingSink->startPlaying(*videoSource, NULL, NULL);
+
+  // Set up the sender:
+  Groupsock senderGroupsock(*env, loopbackAddress, senderPort, 255);
+  senderGroupsock.changeDestinationParameters(loopbackAddress, linkPort, 255);
+  videoSink = SimpleRTPSink::createNew(*env, &senderGroupsock, MEDIA_PAYLOAD_TYPE, TIMESTAMP_FREQUENCY,
+				       "video", "X-TEST", 1, False/*one frame per packet*/);
+  if (fecRowSize > 0 && !videoSink->enableFEC(fecRowSize, fecNumRows, FEC_PAYLOAD_TYPE)) {
+    *env << "Invalid FEC parameters: " << fecRowSize << "x" << fecNumRows << "\n";
+    exit(1);
+  }
+
+  *env << "Sending " << numFrames << " packets, at " << frameRate << " packets-per-second, with ";
+  if (fecRowSize > 0) *env << fecRowSize << "x" << fecNumRows << " FEC"; else *env << "no FEC";
+  *env << ", through a link with " << lossPercentage << "% loss";
+  if (burstLength > 1) *env << " (in bursts of " << burstLength << " packets)";
+  *env << "...\n";
+  videoSink->startPlaying(*TestFrameSource::createNew(*env), afterPlaying, NULL);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void afterPlaying(void* /*clientData*/) {
+  // Give the receiver time to receive (and recover) the last packets, before reporting the results:
+  env->taskScheduler().scheduleDelayedTask(1000000, reportResults, NULL);
+}
+
+void reportResults(void* /*clientData*/) {
+  unsigned numPacketsRecovered = videoSource->numPacketsRecoveredUsingFEC();
+  unsigned numPacketsLost = numFrames - checkingSink->numFramesReceived;
+  RTPReceptionStatsDB::Iterator statsIter(videoSource->receptionStatsDB());
+  RTPReceptionStats* stats = statsIter.next(True);
+  unsigned numPacketsReceived = stats == NULL ? 0 : stats->totNumPacketsReceived() - NUM_TRAILING_FRAMES;
+
+  *env << "Sent " << numMediaPacketsForwarded + numMediaPacketsDropped << " media packets, and "
+       << numFECPacketsForwarded + numFECPacketsDropped << " FEC packets\n";
+  *env << "The link dropped " << numMediaPacketsDropped << " media packets, and "
+       << numFECPacketsDropped << " FEC packets\n";
+  *env << "Of the " << numMediaPacketsDropped << " dropped media packets, " << numPacketsRecovered
+       << " were recovered using FEC, and " << numPacketsLost << " were lost\n";
+  *env << "Delivered " << checkingSink->numFramesReceived << " of " << numFrames << " frames ("
+       << checkingSink->numFramesCorrupted << " corrupted, " << checkingSink->numDuplicateFrames << " duplicates)\n";
+
+  // Check that these results are consistent:
+  Boolean resultsAreConsistent = True;
+  if (numMediaPacketsForwarded + numMediaPacketsDropped != numFrames
+      || numTrailingPackets != NUM_TRAILING_FRAMES + videoSink->numFECPacketsSent() - numFECPacketsForwarded - numFECPacketsDropped) {
+    *env << "Error: Not every frame was sent (in its own packet)\n";
+    resultsAreConsistent = False;
+  }
+  if (numPacketsReceived != numMediaPacketsForwarded) {
+    *env << "Error: The receiver's reception statistics don't match the number of packets that it was sent\n";
+    resultsAreConsistent = False;
+  }
+  if (numPacketsRecovered + numPacketsLost != numMediaPacketsDropped) {
+    *env << "Error: The number of recovered and lost packets doesn't match the number of dropped packets\n";
+    resultsAreConsistent = False;
+  }
+  if (checkingSink->numFramesCorrupted > 0 || checkingSink->numDuplicateFrames > 0) {
+    *env << "Error: Some frames were corrupted or duplicated\n";
+    resultsAreConsistent = False;
+  }
+
+  exit(resultsAreConsistent ? 0 : 1);
+}
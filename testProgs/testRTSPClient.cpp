@@ -42,6 +42,9 @@ void openURL(UsageEnvironment& env, char const* progName, char const* rtspURL);
 // Used to iterate through each stream's 'subsessions', setting up each one:
 void setupNextSubsession(RTSPClient* rtspClient);
 
+// Used (instead of "setupNextSubsession()") if we're pipelining the "SETUP" and "PLAY" commands:
+void setupAllSubsessionsAndPlay(RTSPClient* rtspClient);
+
 // Used to shut down and close a stream (including its "RTSPClient" object):
 void shutdownStream(RTSPClient* rtspClient, int exitCode = 1);
 
@@ -106,6 +109,8 @@ public:
   MediaSubsession* subsession;
   TaskToken streamTimerTask;
   double duration;
+  struct timeval startTime; // when we sent the "DESCRIBE"; used to measure the stream's startup latency
+  Boolean haveReceivedFirstFrame;
 };
 
 // If you're streaming just a single stream (i.e., just from a single URL, once), then you can define and use just a single
@@ -177,6 +182,7 @@ void openURL(UsageEnvironment& env, char const* progName, char const* rtspURL) {
   }
 
   ++rtspClientCount;
+  gettimeofday(&((ourRTSPClient*)rtspClient)->scs.startTime, NULL);
 
   // Next, send a RTSP "DESCRIBE" command, to get a SDP description for the stream.
   // Note that this command - like all RTSP commands - is sent asynchronously; we do not block, waiting for a response.
@@ -185,6 +191,13 @@ void openURL(UsageEnvironment& env, char const* progName, char const* rtspURL) {
 }
 
 
+// By default, we send each "SETUP" command (and then the "PLAY" command) only after we've received the response to the
+// previous command.  If, instead, you want to send the commands together - as soon as we've received the response to the
+// first "SETUP" - change the following to True.  (This reduces the stream's startup latency - when there are several
+// subsessions, or the server is far away - because it saves one network round-trip per subsession.)
+#define PIPELINE_SETUP_AND_PLAY False
+
+
 // Implementation of the RTSP 'response handlers':
 
 void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString) {
@@ -216,7 +229,11 @@ void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultS
     // calling "MediaSubsession::initiate()", and then sending a RTSP "SETUP" command, on each one.
     // (Each 'subsession' will have its own data source.)
     scs.iter = new MediaSubsessionIterator(*scs.session);
-    setupNextSubsession(rtspClient);
+    if (PIPELINE_SETUP_AND_PLAY && scs.session->absStartTime() == NULL) {
+      setupAllSubsessionsAndPlay(rtspClient);
+    } else {
+      setupNextSubsession(rtspClient);
+    }
     return;
   } while (0);
 
@@ -262,6 +279,33 @@ void setupNextSubsession(RTSPClient* rtspClient) {
   }
 }
 
+MediaSubsession* nextInitiatedSubsession(StreamClientState& scs) {
+  MediaSubsession* subsession;
+  while ((subsession = scs.iter->next()) != NULL && subsession->readSource() == NULL) {}
+  return subsession;
+}
+
+void setupAllSubsessionsAndPlay(RTSPClient* rtspClient) {
+  UsageEnvironment& env = rtspClient->envir(); // alias
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+
+  // First, call "MediaSubsession::initiate()" on each subsession:
+  while ((scs.subsession = scs.iter->next()) != NULL) {
+    if (!scs.subsession->initiate()) {
+      env << *rtspClient << "Failed to initiate the \"" << *scs.subsession << "\" subsession: " << env.getResultMsg() << "\n";
+    } else {
+      env << *rtspClient << "Initiated the \"" << *scs.subsession << "\" subsession\n";
+    }
+  }
+
+  // Then send all of the "SETUP" commands, and the "PLAY" command.  "continueAfterSETUP()" will get called for each
+  // initiated subsession, in turn, so we keep track of which subsession that is:
+  scs.iter->reset();
+  scs.subsession = nextInitiatedSubsession(scs);
+  scs.duration = scs.session->playEndTime() - scs.session->playStartTime();
+  rtspClient->sendSetupAndPlayCommands(*scs.session, continueAfterSETUP, continueAfterPLAY, REQUEST_STREAMING_OVER_TCP);
+}
+
 void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
   do {
     UsageEnvironment& env = rtspClient->envir(); // alias
@@ -304,7 +348,13 @@ void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultStri
   delete[] resultString;
 
   // Set up the next subsession, if any:
-  setupNextSubsession(rtspClient);
+  StreamClientState& scs = ((ourRTSPClient*)rtspClient)->scs; // alias
+  if (PIPELINE_SETUP_AND_PLAY && scs.session->absStartTime() == NULL) {
+    // The next subsession's "SETUP" has already been sent; just note which subsession it's for:
+    scs.subsession = nextInitiatedSubsession(scs);
+  } else {
+    setupNextSubsession(rtspClient);
+  }
 }
 
 void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
@@ -451,7 +501,8 @@ ourRTSPClient::~ourRTSPClient() {
 // Implementation of "StreamClientState":
 
 StreamClientState::StreamClientState()
-  : iter(NULL), session(NULL), subsession(NULL), streamTimerTask(NULL), duration(0.0) {
+  : iter(NULL), session(NULL), subsession(NULL), streamTimerTask(NULL), duration(0.0), haveReceivedFirstFrame(False) {
+  startTime.tv_sec = startTime.tv_usec = 0;
 }
 
 StreamClientState::~StreamClientState() {
@@ -499,6 +550,17 @@ void DummySink::afterGettingFrame(void* clientData, unsigned frameSize, unsigned
 
 void DummySink::afterGettingFrame(unsigned frameSize, unsigned numTruncatedBytes,
 				  struct timeval presentationTime, unsigned /*durationInMicroseconds*/) {
+  // If this is the stream's first frame, then print out how long it took to arrive (after we sent the "DESCRIBE"):
+  ourRTSPClient* rtspClient = (ourRTSPClient*)(fSubsession.miscPtr);
+  StreamClientState& scs = rtspClient->scs; // alias
+  if (!scs.haveReceivedFirstFrame) {
+    scs.haveReceivedFirstFrame = True;
+    struct timeval timeNow;
+    gettimeofday(&timeNow, NULL);
+    unsigned startupLatency = (timeNow.tv_sec - scs.startTime.tv_sec)*1000 + (timeNow.tv_usec - scs.startTime.tv_usec)/1000;
+    envir() << *rtspClient << "Received the first frame " << startupLatency << " ms after sending \"DESCRIBE\"\n";
+  }
+
   // We've just received a frame of data.  (Optionally) print out information about it:
 #ifdef DEBUG_PRINT_EACH_RECEIVED_FRAME
   if (fStreamId != NULL) envir() << "Stream \"" << fStreamId << "\"; ";
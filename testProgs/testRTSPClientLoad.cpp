@@ -0,0 +1,459 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A RTSP client load generator: Opens many concurrent streams (from one or more "rtsp://" URLs) in a single process,
+// and reports each stream's startup latency (from sending "DESCRIBE" until receiving the first frame) and throughput.
+//
+// To scale to thousands of streams, this application:
+// - uses an "EpollTaskScheduler" (on Linux), rather than a "BasicTaskScheduler", which is limited by "select()"
+//   to FD_SETSIZE sockets.
+// - has its "RTSPClient"s share a small pool of response buffers ("RTSPClient::useSharedResponseBuffers").
+// - by default, sets up only one subsession (the first video subsession) of each stream, so no sockets are created
+//   for the others.  (Use "-a" to set up all subsessions.)
+// - pipelines each stream's "SETUP" and "PLAY" commands (using "RTSPClient::sendSetupAndPlayCommands()").
+// - delivers each stream's frames to a sink that only counts them, into a single receive buffer shared by all sinks.
+// (Use "-t" to receive each stream using RTP-over-TCP, which needs only one socket per stream.)
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#if !defined(__WIN32__) && !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+// Command-line options (with their default values):
+unsigned numStreamsPerURL = 1; // -n <streams-per-URL>
+double rampUpRate = 10.0; // -r <new-streams-per-second>
+unsigned duration = 60; // -d <seconds>
+Boolean streamUsingTCP = False; // -t
+Boolean setupAllSubsessions = False; // -a
+Boolean useSelect = False; // -s
+
+#define REPORTING_INTERVAL 5 /* seconds */
+#define RECEIVE_BUFFER_SIZE 500000
+
+// The statistics that we record for each stream:
+class StreamStats {
+public:
+  StreamStats();
+
+  double startupLatency() const; // in seconds; -1.0 if we haven't received any data
+  double throughput() const; // in bits-per-second
+
+public:
+  char const* url;
+  struct timeval startTime, firstFrameTime, lastFrameTime;
+  unsigned numFramesReceived;
+  u_int64_t numBytesReceived;
+  Boolean hasFailed;
+};
+
+// A "RTSPClient" subclass that records the state of one stream:
+class LoadTestClient: public RTSPClient {
+public:
+  static LoadTestClient* createNew(UsageEnvironment& env, StreamStats& stats);
+
+protected:
+  LoadTestClient(UsageEnvironment& env, StreamStats& stats);
+  virtual ~LoadTestClient();
+
+public:
+  StreamStats& stats;
+  MediaSession* session;
+  MediaSubsessionIterator* iter; // used to match each "SETUP" response with its subsession
+};
+
+// A sink that receives (and counts) each frame of a subsession, but does nothing else with it:
+class CountingSink: public MediaSink {
+public:
+  static CountingSink* createNew(UsageEnvironment& env, StreamStats& stats);
+
+private:
+  CountingSink(UsageEnvironment& env, StreamStats& stats);
+  virtual ~CountingSink();
+
+  static void afterGettingFrame(void* clientData, unsigned frameSize, unsigned numTruncatedBytes,
+				struct timeval presentationTime, unsigned durationInMicroseconds);
+  void afterGettingFrame(unsigned frameSize);
+
+private: // redefined virtual functions:
+  virtual Boolean continuePlaying();
+
+private:
+  StreamStats& fStats;
+  static u_int8_t* fReceiveBuffer; // shared by all "CountingSink"s, because we don't look at the data
+};
+
+// RTSP 'response handlers':
+void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString);
+void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString);
+void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString);
+
+// Other functions:
+void startNextStream(void* clientData);
+void reportTotals(void* clientData);
+void endTest(void* clientData);
+void shutdownStream(RTSPClient* rtspClient);
+void raiseFileDescriptorLimit(UsageEnvironment& env);
+
+UsageEnvironment* env;
+char const* progName;
+char** urls;
+unsigned numURLs;
+StreamStats* streams;
+unsigned numStreams, numStreamsStarted = 0;
+struct timeval testStartTime;
+
+void usage() {
+  *env << "Usage: " << progName
+       << " [-n <streams-per-URL>] [-r <new-streams-per-second>] [-d <duration-in-seconds>] [-t] [-a] [-s]"
+       << " <rtsp-url-1> ... <rtsp-url-N>\n"
+       << "\t-t: stream RTP and RTCP over the RTSP TCP connection\n"
+       << "\t-a: set up all subsessions of each stream (rather than just the first video subsession)\n"
+       << "\t-s: use a \"select()\"-based task scheduler (rather than \"epoll()\", where available)\n";
+  exit(1);
+}
+
+static double secondsSince(struct timeval const& startTime, struct timeval const& endTime) {
+  return (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = NULL;
+  Boolean usingEpoll = False;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-s") == 0) useSelect = True;
+  }
+#ifdef __linux__
+  if (!useSelect) scheduler = EpollTaskScheduler::createNew();
+  usingEpoll = scheduler != NULL;
+#endif
+  if (scheduler == NULL) scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1 && argv[1][0] == '-') {
+    char* const opt = argv[1];
+    if (strcmp(opt, "-t") == 0) {
+      streamUsingTCP = True;
+    } else if (strcmp(opt, "-a") == 0) {
+      setupAllSubsessions = True;
+    } else if (strcmp(opt, "-s") == 0) {
+      // already handled above
+    } else if (argc > 2 && strcmp(opt, "-n") == 0) {
+      if (sscanf(argv[2], "%u", &numStreamsPerURL) != 1 || numStreamsPerURL == 0) usage();
+      ++argv; --argc;
+    } else if (argc > 2 && strcmp(opt, "-r") == 0) {
+      if (sscanf(argv[2], "%lf", &rampUpRate) != 1 || rampUpRate <= 0.0) usage();
+      ++argv; --argc;
+    } else if (argc > 2 && strcmp(opt, "-d") == 0) {
+      if (sscanf(argv[2], "%u", &duration) != 1) usage();
+      ++argv; --argc;
+    } else {
+      usage();
+    }
+    ++argv; --argc;
+  }
+  if (argc < 2) usage();
+  urls = &argv[1];
+  numURLs = argc - 1;
+
+  raiseFileDescriptorLimit(*env);
+  RTSPClient::useSharedResponseBuffers = True;
+
+  numStreams = numURLs*numStreamsPerURL;
+  streams = new StreamStats[numStreams];
+  for (unsigned i = 0; i < numStreams; ++i) streams[i].url = urls[i%numURLs];
+
+  *env << "Opening " << numStreams << " streams, at " << rampUpRate << " new streams per second, for "
+       << duration << " seconds, using " << (usingEpoll ? "epoll()" : "select()")
+       << (streamUsingTCP ? ", with RTP-over-TCP" : "") << "\n";
+  gettimeofday(&testStartTime, NULL);
+  startNextStream(NULL);
+  env->taskScheduler().scheduleDelayedTask(REPORTING_INTERVAL*1000000, reportTotals, NULL);
+  env->taskScheduler().scheduleDelayedTask((int64_t)duration*1000000, endTest, NULL);
+
+  env->taskScheduler().doEventLoop(); // does not return
+
+  return 0; // only to prevent compiler warning
+}
+
+void raiseFileDescriptorLimit(UsageEnvironment& env) {
+#if !defined(__WIN32__) && !defined(_WIN32)
+  // Each stream uses up to 3 sockets per subsession (or just 1, if "-t" is used), so allow as many as we can:
+  struct rlimit rl;
+  if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+    rl.rlim_cur = rl.rlim_max;
+    if (setrlimit(RLIMIT_NOFILE, &rl) != 0) {
+      env << "Failed to raise the open file limit: " << env.getResultMsg() << "\n";
+    }
+  }
+#endif
+}
+
+void startNextStream(void* /*clientData*/) {
+  if (numStreamsStarted >= numStreams) return;
+  StreamStats& stats = streams[numStreamsStarted++];
+
+  LoadTestClient* rtspClient = LoadTestClient::createNew(*env, stats);
+  if (rtspClient == NULL) {
+    *env << "Failed to create a RTSP client for URL \"" << stats.url << "\": " << env->getResultMsg() << "\n";
+    stats.hasFailed = True;
+  } else {
+    gettimeofday(&stats.startTime, NULL);
+    rtspClient->sendDescribeCommand(continueAfterDESCRIBE);
+  }
+
+  env->taskScheduler().scheduleDelayedTask((int64_t)(1000000/rampUpRate), startNextStream, NULL);
+}
+
+
+// Implementation of the RTSP 'response handlers':
+
+static MediaSubsession* nextInitiatedSubsession(MediaSubsessionIterator& iter) {
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL && subsession->readSource() == NULL) {}
+  return subsession;
+}
+
+void continueAfterDESCRIBE(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  do {
+    if (resultCode != 0) {
+      *env << "[" << client->url() << "]: Failed to get a SDP description: " << resultString << "\n";
+      break;
+    }
+
+    client->session = MediaSession::createNew(*env, resultString);
+    if (client->session == NULL || !client->session->hasSubsessions()) break;
+
+    // Choose the subsession(s) to set up.  Unless "-a" was given, this is the first video subsession (if any),
+    // or else the first subsession.  Only these subsessions get "initiate()"d (and so have sockets):
+    MediaSubsessionIterator iter(*client->session);
+    MediaSubsession* chosen = NULL;
+    MediaSubsession* subsession;
+    if (!setupAllSubsessions) {
+      while ((subsession = iter.next()) != NULL) {
+	if (strcmp(subsession->mediumName(), "video") == 0) { chosen = subsession; break; }
+      }
+      if (chosen == NULL) { iter.reset(); chosen = iter.next(); }
+    }
+
+    unsigned numInitiated = 0;
+    iter.reset();
+    while ((subsession = iter.next()) != NULL) {
+      if (!setupAllSubsessions && subsession != chosen) continue;
+      if (!subsession->initiate()) {
+	*env << "[" << client->url() << "]: Failed to initiate the \"" << subsession->mediumName()
+	     << "\" subsession: " << env->getResultMsg() << "\n";
+	continue;
+      }
+      ++numInitiated;
+    }
+    if (numInitiated == 0) break;
+
+    client->iter = new MediaSubsessionIterator(*client->session);
+    rtspClient->sendSetupAndPlayCommands(*client->session, continueAfterSETUP, continueAfterPLAY, streamUsingTCP);
+    delete[] resultString;
+    return;
+  } while (0);
+
+  // An unrecoverable error occurred with this stream.
+  delete[] resultString;
+  shutdownStream(rtspClient);
+}
+
+void continueAfterSETUP(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  MediaSubsession* subsession = nextInitiatedSubsession(*client->iter); // the subsession that this response is for
+  delete[] resultString;
+  if (subsession == NULL || resultCode != 0) return; // the "PLAY" response handler will note any failure
+
+  // Start receiving the subsession's data now (rather than after the "PLAY" response), so that we don't miss any:
+  subsession->sink = CountingSink::createNew(*env, client->stats);
+  if (subsession->sink == NULL) return;
+  subsession->sink->startPlaying(*subsession->readSource(), NULL, NULL);
+}
+
+void continueAfterPLAY(RTSPClient* rtspClient, int resultCode, char* resultString) {
+  delete[] resultString;
+  if (resultCode != 0) {
+    *env << "[" << rtspClient->url() << "]: Failed to start playing session: " << env->getResultMsg() << "\n";
+    shutdownStream(rtspClient);
+  }
+}
+
+void shutdownStream(RTSPClient* rtspClient) {
+  LoadTestClient* client = (LoadTestClient*)rtspClient;
+  client->stats.hasFailed = True;
+
+  if (client->session != NULL) {
+    MediaSubsessionIterator iter(*client->session);
+    MediaSubsession* subsession;
+    while ((subsession = iter.next()) != NULL) {
+      Medium::close(subsession->sink);
+      subsession->sink = NULL;
+    }
+  }
+  Medium::close(rtspClient);
+}
+
+
+// Reporting:
+
+void reportTotals(void* /*clientData*/) {
+  static u_int64_t prevNumBytesReceived = 0;
+  static struct timeval prevReportTime = testStartTime;
+
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  unsigned numStreamsReceiving = 0, numStreamsFailed = 0;
+  u_int64_t numBytesReceived = 0;
+  for (unsigned i = 0; i < numStreamsStarted; ++i) {
+    if (streams[i].hasFailed) ++numStreamsFailed;
+    else if (streams[i].numFramesReceived > 0) ++numStreamsReceiving;
+    numBytesReceived += streams[i].numBytesReceived;
+  }
+
+  double interval = secondsSince(prevReportTime, now);
+  double mbps = interval > 0.0 ? (8.0*(numBytesReceived - prevNumBytesReceived))/interval/1000000.0 : 0.0;
+  char buf[200];
+  sprintf(buf, "%6.1f s: %u streams started, %u receiving, %u failed; total %.2f Mbps\n",
+	  secondsSince(testStartTime, now), numStreamsStarted, numStreamsReceiving, numStreamsFailed, mbps);
+  *env << buf;
+
+  prevNumBytesReceived = numBytesReceived;
+  prevReportTime = now;
+  env->taskScheduler().scheduleDelayedTask(REPORTING_INTERVAL*1000000, reportTotals, NULL);
+}
+
+void endTest(void* /*clientData*/) {
+  char buf[300];
+  *env << "\nStream\tStartup(ms)\tFrames\tKbps\tURL\n";
+  unsigned numWithData = 0;
+  double minLatency = 0.0, maxLatency = 0.0, totalLatency = 0.0;
+  double minThroughput = 0.0, maxThroughput = 0.0, totalThroughput = 0.0;
+  for (unsigned i = 0; i < numStreamsStarted; ++i) {
+    StreamStats const& stats = streams[i];
+    double latency = stats.startupLatency();
+    double throughput = stats.throughput();
+    if (latency < 0.0) {
+      sprintf(buf, "%u\t-\t\t0\t0\t%s%s\n", i, stats.url, stats.hasFailed ? " (failed)" : "");
+    } else {
+      sprintf(buf, "%u\t%.1f\t\t%u\t%.1f\t%s\n", i, latency*1000, stats.numFramesReceived, throughput/1000, stats.url);
+
+      if (numWithData == 0 || latency < minLatency) minLatency = latency;
+      if (latency > maxLatency) maxLatency = latency;
+      totalLatency += latency;
+      if (numWithData == 0 || throughput < minThroughput) minThroughput = throughput;
+      if (throughput > maxThroughput) maxThroughput = throughput;
+      totalThroughput += throughput;
+      ++numWithData;
+    }
+    *env << buf;
+  }
+
+  sprintf(buf, "\n%u of %u streams received data\n", numWithData, numStreamsStarted);
+  *env << buf;
+  if (numWithData > 0) {
+    sprintf(buf, "Startup latency (ms): min %.1f, avg %.1f, max %.1f\nThroughput (Kbps): min %.1f, avg %.1f, max %.1f; total %.2f Mbps\n",
+	    minLatency*1000, totalLatency*1000/numWithData, maxLatency*1000,
+	    minThroughput/1000, totalThroughput/1000/numWithData, maxThroughput/1000, totalThroughput/1000000);
+    *env << buf;
+  }
+
+  // We don't bother tearing down each stream; we just exit, and let the server(s) time out the sessions.
+  exit(0);
+}
+
+
+// Implementation of "StreamStats":
+
+StreamStats::StreamStats()
+  : url(NULL), numFramesReceived(0), numBytesReceived(0), hasFailed(False) {
+  startTime.tv_sec = startTime.tv_usec = 0;
+  firstFrameTime = lastFrameTime = startTime;
+}
+
+double StreamStats::startupLatency() const {
+  if (numFramesReceived == 0) return -1.0;
+
+  return secondsSince(startTime, firstFrameTime);
+}
+
+double StreamStats::throughput() const {
+  if (numFramesReceived == 0) return 0.0;
+
+  double interval = secondsSince(firstFrameTime, lastFrameTime);
+  return interval > 0.0 ? (8.0*numBytesReceived)/interval : 0.0;
+}
+
+
+// Implementation of "LoadTestClient":
+
+LoadTestClient* LoadTestClient::createNew(UsageEnvironment& env, StreamStats& stats) {
+  return new LoadTestClient(env, stats);
+}
+
+LoadTestClient::LoadTestClient(UsageEnvironment& env, StreamStats& stats)
+  : RTSPClient(env, stats.url, 0/*verbosityLevel*/, progName, 0, -1),
+    stats(stats), session(NULL), iter(NULL) {
+}
+
+LoadTestClient::~LoadTestClient() {
+  delete iter;
+  Medium::close(session);
+}
+
+
+// Implementation of "CountingSink":
+
+u_int8_t* CountingSink::fReceiveBuffer = NULL;
+
+CountingSink* CountingSink::createNew(UsageEnvironment& env, StreamStats& stats) {
+  return new CountingSink(env, stats);
+}
+
+CountingSink::CountingSink(UsageEnvironment& env, StreamStats& stats)
+  : MediaSink(env), fStats(stats) {
+  if (fReceiveBuffer == NULL) fReceiveBuffer = new u_int8_t[RECEIVE_BUFFER_SIZE];
+}
+
+CountingSink::~CountingSink() {
+}
+
+void CountingSink::afterGettingFrame(void* clientData, unsigned frameSize, unsigned /*numTruncatedBytes*/,
+				     struct timeval /*presentationTime*/, unsigned /*durationInMicroseconds*/) {
+  CountingSink* sink = (CountingSink*)clientData;
+  sink->afterGettingFrame(frameSize);
+}
+
+void CountingSink::afterGettingFrame(unsigned frameSize) {
+  gettimeofday(&fStats.lastFrameTime, NULL);
+  if (fStats.numFramesReceived++ == 0) fStats.firstFrameTime = fStats.lastFrameTime;
+  fStats.numBytesReceived += frameSize;
+
+  // Then continue, to request the next frame of data:
+  continuePlaying();
+}
+
+Boolean CountingSink::continuePlaying() {
+  if (fSource == NULL) return False; // sanity check (should not happen)
+
+  fSource->getNextFrame(fReceiveBuffer, RECEIVE_BUFFER_SIZE, afterGettingFrame, this, onSourceClosure, this);
+  return True;
+}
@@ -0,0 +1,433 @@
+/**********
+This library is free software; you can redistribute it and/or modify it under
+the terms of the GNU Lesser General Public License as published by the
+Free Software Foundation; either version 3 of the License, or (at your
+option) any later version. (See <http://www.gnu.org/copyleft/lesser.html>.)
+
+This library is distributed in the hope that it will be useful, but WITHOUT
+ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for
+more details.
+
+You should have received a copy of the GNU Lesser General Public License
+along with this library; if not, write to the Free Software Foundation, Inc.,
+51 Franklin Street, Fifth Floor, Boston, MA 02110-1301  USA
+**********/
+// Copyright (c) 1996-2017, Live Networks, Inc.  All rights reserved
+// A test program for "MediaSession"s SDP parsing: Parses a small corpus of SDP descriptions (in the style of those
+// sent by common IP cameras and servers, plus some unusual or malformed ones), and checks that the results are
+// the same as those that our original (line-by-line, "sscanf()"-based) parser produced.  Then measures how long
+// it takes to create (and close) a "MediaSession" from each of the camera/server descriptions.
+// (Use "-p" to instead print the results for each description - e.g., to record the expected results for a new one.)
+// main program
+
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+#include <stdarg.h>
+
+// Command-line options (with their default values):
+unsigned numIterations = 20000; // -n <iterations> (for the timing measurement)
+Boolean printResults = False; // -p
+
+UsageEnvironment* env;
+char const* progName;
+
+void usage() {
+  *env << "usage: " << progName << " [-n <iterations>] [-p]\n";
+  exit(1);
+}
+
+class SDPTestCase {
+public:
+  char const* name;
+  char const* sdpDescription;
+  char const* expectedResult; // as produced by our original parser (except where noted)
+};
+
+SDPTestCase const corpus[] = {
+  { "Axis-style camera",
+    "v=0\r\no=- 12498114187694311339 1 IN IP4 192.168.0.90\r\ns=Session streamed with GStreamer\r\ni=rtsp-server\r\n"
+    "t=0 0\r\na=tool:GStreamer\r\na=type:broadcast\r\na=range:npt=now-\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp?videocodec=h264\r\n"
+    "m=video 0 RTP/AVP 96\r\nc=IN IP4 0.0.0.0\r\nb=AS:50000\r\na=rtpmap:96 H264/90000\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=4d0029;sprop-parameter-sets=Z00AKeKQDwBE/LgLcBAQGkHiRFQ=,aO48gA==\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=0?videocodec=h264\r\na=framerate:30.000000\r\n"
+    "a=transform:1.000000,0.000000,0.000000;0.000000,1.000000,0.000000;0.000000,0.000000,1.000000\r\n"
+    "m=audio 0 RTP/AVP 97\r\nc=IN IP4 0.0.0.0\r\nb=AS:32\r\na=rtpmap:97 MPEG4-GENERIC/16000/1\r\n"
+    "a=fmtp:97 streamtype=5;profile-level-id=2;mode=AAC-hbr;config=1408;sizelength=13;indexlength=3;indexdeltalength=3;"
+    "bitrate=32000\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=1?videocodec=h264\r\n"
+    "m=application 0 RTP/AVP 98\r\nc=IN IP4 0.0.0.0\r\na=rtpmap:98 vnd.onvif.metadata/90000\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=2?videocodec=h264\r\n",
+    // (Our original parser also took the lines following "a=type:" - up to the next space - as part of its value.)
+    "s=Session streamed with GStreamer i=rtsp-server type=broadcast control=rtsp://192.168.0.90/axis-media/media.amp?videocodec=h264 c=(null) ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H264 frequency=90000 channels=1 control=rtsp://192.168.0.90/axis-media/media.amp/stream=0?videocodec=h264 c=0.0.0.0 ssm=0 b=50000 mux=0 nack=0 rtx=0 fec=0 video=0x0@30 range=0-0 abs=(null)-(null)\n"
+    "  packetization-mode=1 (lower: 1, int: 1)\n"
+    "  profile-level-id=4d0029 (lower: 4d0029, int: 5046313)\n"
+    "  sprop-parameter-sets=Z00AKeKQDwBE/LgLcBAQGkHiRFQ=,aO48gA== (lower: z00akekqdwbe/lglcbaqgkhirfq=,ao48ga==, int: 0)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "b=AS:50000\r\n"
+    "a=rtpmap:96 H264/90000\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=4d0029;sprop-parameter-sets=Z00AKeKQDwBE/LgLcBAQGkHiRFQ=,aO48gA==\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=0?videocodec=h264\r\n"
+    "a=framerate:30.000000\r\n"
+    "a=transform:1.000000,0.000000,0.000000;0.000000,1.000000,0.000000;0.000000,0.000000,1.000000\r\n"
+    "\n"
+    "m=audio port=0 protocol=RTP payload=97 codec=MPEG4-GENERIC frequency=16000 channels=1 control=rtsp://192.168.0.90/axis-media/media.amp/stream=1?videocodec=h264 c=0.0.0.0 ssm=0 b=32 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=2 (lower: 2, int: 2)\n"
+    "  streamtype=5 (lower: 5, int: 5)\n"
+    "  mode=AAC-hbr (lower: aac-hbr, int: 0)\n"
+    "  config=1408 (lower: 1408, int: 1408)\n"
+    "  sizelength=13 (lower: 13, int: 13)\n"
+    "  indexlength=3 (lower: 3, int: 3)\n"
+    "  saved: m=audio 0 RTP/AVP 97\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "b=AS:32\r\n"
+    "a=rtpmap:97 MPEG4-GENERIC/16000/1\r\n"
+    "a=fmtp:97 streamtype=5;profile-level-id=2;mode=AAC-hbr;config=1408;sizelength=13;indexlength=3;indexdeltalength=3;bitrate=32000\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=1?videocodec=h264\r\n"
+    "\n"
+    "m=application port=0 protocol=RTP payload=98 codec=VND.ONVIF.METADATA frequency=90000 channels=1 control=rtsp://192.168.0.90/axis-media/media.amp/stream=2?videocodec=h264 c=0.0.0.0 ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=application 0 RTP/AVP 98\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "a=rtpmap:98 vnd.onvif.metadata/90000\r\n"
+    "a=control:rtsp://192.168.0.90/axis-media/media.amp/stream=2?videocodec=h264\r\n"
+    "\n" },
+  { "Hikvision-style camera",
+    "v=0\r\no=- 1109162014219182 1109162014219192 IN IP4 x.y.z.w\r\ns=Media Presentation\r\ne=NONE\r\nb=AS:5050\r\n"
+    "t=0 0\r\na=control:rtsp://10.0.0.64:554/Streaming/Channels/101/?transportmode=unicast\r\n"
+    "m=video 0 RTP/AVP 96\r\nc=IN IP4 0.0.0.0\r\nb=AS:5000\r\na=recvonly\r\na=x-dimensions:2688,1520\r\n"
+    "a=control:rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=1?transportmode=unicast\r\na=rtpmap:96 H265/90000\r\n"
+    "a=fmtp:96 sprop-sps=QgEBAWAAAAMAsAAAAwAAAwB7oAKggC8c1tJJT5Onyb5EAA==; sprop-pps=RAHA8vA8kA==; "
+    "sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwB7rAk=\r\n"
+    "a=Media_header:MEDIAINFO=494D4B48010300000400050000000000000000000000000000000000000000000000000000000000;\r\n"
+    "a=appversion:1.0\r\n"
+    "m=audio 0 RTP/AVP 8\r\nc=IN IP4 0.0.0.0\r\nb=AS:50\r\na=recvonly\r\n"
+    "a=control:rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=2?transportmode=unicast\r\na=rtpmap:8 PCMA/8000\r\n"
+    "a=Media_header:MEDIAINFO=494D4B48010300000400050000000000000000000000000000000000000000000000000000000000;\r\n"
+    "a=appversion:1.0\r\n",
+    "s=Media Presentation i=(null) type=(null) control=rtsp://10.0.0.64:554/Streaming/Channels/101/?transportmode=unicast c=(null) ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H265 frequency=90000 channels=1 control=rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=1?transportmode=unicast c=0.0.0.0 ssm=0 b=5000 mux=0 nack=0 rtx=0 fec=0 video=2688x1520@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwB7rAk= (lower: qaemaf//awaaaamasaaaawaaawb7rak=, int: 0)\n"
+    "  sprop-sps=QgEBAWAAAAMAsAAAAwAAAwB7oAKggC8c1tJJT5Onyb5EAA== (lower: qgebawaaaamasaaaawaaawb7oakggc8c1tjjt5onyb5eaa==, int: 0)\n"
+    "  sprop-pps=RAHA8vA8kA== (lower: raha8va8ka==, int: 0)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "b=AS:5000\r\n"
+    "a=recvonly\r\n"
+    "a=x-dimensions:2688,1520\r\n"
+    "a=control:rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=1?transportmode=unicast\r\n"
+    "a=rtpmap:96 H265/90000\r\n"
+    "a=fmtp:96 sprop-sps=QgEBAWAAAAMAsAAAAwAAAwB7oAKggC8c1tJJT5Onyb5EAA==; sprop-pps=RAHA8vA8kA==; sprop-vps=QAEMAf//AWAAAAMAsAAAAwAAAwB7rAk=\r\n"
+    "a=Media_header:MEDIAINFO=494D4B48010300000400050000000000000000000000000000000000000000000000000000000000;\r\n"
+    "a=appversion:1.0\r\n"
+    "\n"
+    "m=audio port=0 protocol=RTP payload=8 codec=PCMA frequency=8000 channels=1 control=rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=2?transportmode=unicast c=0.0.0.0 ssm=0 b=50 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 0 RTP/AVP 8\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "b=AS:50\r\n"
+    "a=recvonly\r\n"
+    "a=control:rtsp://10.0.0.64:554/Streaming/Channels/101/trackID=2?transportmode=unicast\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=Media_header:MEDIAINFO=494D4B48010300000400050000000000000000000000000000000000000000000000000000000000;\r\n"
+    "a=appversion:1.0\r\n"
+    "\n" },
+  { "Dahua-style camera",
+    "v=0\r\no=- 2251938202 2251938202 IN IP4 0.0.0.0\r\ns=Media Server\r\nc=IN IP4 0.0.0.0\r\nt=0 0\r\na=control:*\r\n"
+    "a=packetization-supported:DH\r\na=rtppayload-supported:DH\r\na=range:npt=now-\r\n"
+    "m=video 0 RTP/AVP 96\r\na=control:trackID=0\r\na=framerate:25.000000\r\na=rtpmap:96 H264/90000\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=640028;"
+    "sprop-parameter-sets=Z2QAKKwbGoB4AiflwFuAgICgAAB9AAAOph0MAHz4AAjJdd5caGAD58AARkuu8uFAAA==,aO44MAA=\r\n"
+    "a=recvonly\r\n"
+    "m=audio 0 RTP/AVP 8\r\na=control:trackID=1\r\na=rtpmap:8 PCMA/8000\r\na=recvonly\r\n"
+    "m=application 0 RTP/AVP 107\r\na=control:trackID=4\r\na=rtpmap:107 vnd.onvif.metadata/90000\r\na=recvonly\r\n",
+    "s=Media Server i=(null) type=(null) control=* c=0.0.0.0 ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H264 frequency=90000 channels=1 control=trackID=0 c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@25 range=0-0 abs=(null)-(null)\n"
+    "  packetization-mode=1 (lower: 1, int: 1)\n"
+    "  profile-level-id=640028 (lower: 640028, int: 6553640)\n"
+    "  sprop-parameter-sets=Z2QAKKwbGoB4AiflwFuAgICgAAB9AAAOph0MAHz4AAjJdd5caGAD58AARkuu8uFAAA==,aO44MAA= (lower: z2qakkwbgob4aiflwfuagicgaab9aaaoph0mahz4aajjdd5cagad58aarkuu8ufaaa==,ao44maa=, int: 0)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "a=control:trackID=0\r\n"
+    "a=framerate:25.000000\r\n"
+    "a=rtpmap:96 H264/90000\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=640028;sprop-parameter-sets=Z2QAKKwbGoB4AiflwFuAgICgAAB9AAAOph0MAHz4AAjJdd5caGAD58AARkuu8uFAAA==,aO44MAA=\r\n"
+    "a=recvonly\r\n"
+    "\n"
+    "m=audio port=0 protocol=RTP payload=8 codec=PCMA frequency=8000 channels=1 control=trackID=1 c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 0 RTP/AVP 8\r\n"
+    "a=control:trackID=1\r\n"
+    "a=rtpmap:8 PCMA/8000\r\n"
+    "a=recvonly\r\n"
+    "\n"
+    "m=application port=0 protocol=RTP payload=107 codec=VND.ONVIF.METADATA frequency=90000 channels=1 control=trackID=4 c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=application 0 RTP/AVP 107\r\n"
+    "a=control:trackID=4\r\n"
+    "a=rtpmap:107 vnd.onvif.metadata/90000\r\n"
+    "a=recvonly\r\n"
+    "\n" },
+  { "LIVE555-style server (SSM, with NACKs and RTCP multiplexing)",
+    "v=0\r\no=- 1536000000123456 1 IN IP4 192.168.1.10\r\ns=H.264 Video, streamed by the LIVE555 Media Server\r\n"
+    "i=test.264\r\nt=0 0\r\na=tool:LIVE555 Streaming Media v2017.10.28\r\na=type:broadcast\r\na=control:*\r\n"
+    "a=source-filter: incl IN IP4 * 192.168.1.10\r\na=rtcp-unicast: reflection\r\na=range:npt=0-12.345\r\n"
+    "a=x-qt-text-nam:H.264 Video, streamed by the LIVE555 Media Server\r\na=x-qt-text-inf:test.264\r\n"
+    "m=video 0 RTP/AVP 96\r\nc=IN IP4 0.0.0.0\r\nb=AS:500\r\na=rtpmap:96 H264/90000\r\na=rtcp-fb:96 nack\r\n"
+    "a=rtcp-mux\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=42C01E;sprop-parameter-sets=Z0LAHtkBQHsBEAAAAwAQAAADAyDxYuSA,aMuMsg==\r\n"
+    "a=control:track1\r\n",
+    // (Our original parser also took the lines following "a=type:" - up to the next space - as part of its value.)
+    "s=H.264 Video, streamed by the LIVE555 Media Server i=test.264 type=broadcast control=* c=(null) ssm=1 range=0-12.345 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H264 frequency=90000 channels=1 control=track1 c=0.0.0.0 ssm=1 b=500 mux=1 nack=1 rtx=0 fec=0 video=0x0@0 range=0-12.345 abs=(null)-(null)\n"
+    "  packetization-mode=1 (lower: 1, int: 1)\n"
+    "  profile-level-id=42C01E (lower: 42c01e, int: 4374558)\n"
+    "  sprop-parameter-sets=Z0LAHtkBQHsBEAAAAwAQAAADAyDxYuSA,aMuMsg== (lower: z0lahtkbqhsbeaaaawaqaaadaydxyusa,amumsg==, int: 0)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "c=IN IP4 0.0.0.0\r\n"
+    "b=AS:500\r\n"
+    "a=rtpmap:96 H264/90000\r\n"
+    "a=rtcp-fb:96 nack\r\n"
+    "a=rtcp-mux\r\n"
+    "a=fmtp:96 packetization-mode=1;profile-level-id=42C01E;sprop-parameter-sets=Z0LAHtkBQHsBEAAAAwAQAAADAyDxYuSA,aMuMsg==\r\n"
+    "a=control:track1\r\n"
+    "\n" },
+  { "Retransmissions and FEC, multicast",
+    "v=0\r\nm=audio 0 RTP/AVP 97\r\na=rtpmap: 97 l16/44100/2\r\na=rtpmap:98 rtx/90000\r\na=fmtp:98 apt=97\r\n"
+    "a=rtpmap:99 ulpfec/90000\r\nc=IN IP4 224.1.2.3/127\r\n",
+    "s=(null) i=(null) type=(null) control=(null) c=(null) ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=audio port=0 protocol=RTP payload=97 codec=L16 frequency=44100 channels=2 control=(null) c=224.1.2.3 ssm=0 b=0 mux=0 nack=0 rtx=98 fec=99 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 0 RTP/AVP 97\r\n"
+    "a=rtpmap: 97 l16/44100/2\r\n"
+    "a=rtpmap:98 rtx/90000\r\n"
+    "a=fmtp:98 apt=97\r\n"
+    "a=rtpmap:99 ulpfec/90000\r\n"
+    "c=IN IP4 224.1.2.3/127\r\n"
+    "\n" },
+  { "Unusual \"m=\" lines",
+    "v=0\r\nm=video 0/2 RTP/AVP 96\r\na=rtpmap:96 H264/90000/x\r\nm=video 5000 RTP/AVPF 96\r\na=rtpmap:96 VP8/90000\r\n"
+    "m=audio 1234 udp 33\r\nm=x 0 RAW/RAW/UDP 33\r\nm=y 0 UDP 200\r\n",
+    // (Our original parser rejected "RTP/AVPF" "m=" lines.)
+    "s=(null) i=(null) type=(null) control=(null) c=(null) ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H264 frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=video 0/2 RTP/AVP 96\r\n"
+    "a=rtpmap:96 H264/90000/x\r\n"
+    "\n"
+    "m=video port=5000 protocol=RTP payload=96 codec=VP8 frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=video 5000 RTP/AVPF 96\r\n"
+    "a=rtpmap:96 VP8/90000\r\n"
+    "\n"
+    "m=audio port=1234 protocol=UDP payload=33 codec=MP2T frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 1234 udp 33\r\n"
+    "\n"
+    "m=x port=0 protocol=UDP payload=33 codec=MP2T frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=x 0 RAW/RAW/UDP 33\r\n"
+    "\n" },
+  { "LF-only line endings",
+    "v=0\ns=lf only\ni=info here\nm=audio 0 RTP/AVP 0\na=control:  track1  extra\na=control\na=range:npt=1.5-20\n"
+    "a=x-dimensions:640,480\na=x-framerate: 15\nb=AS:64\na=rtcp-mux\n",
+    "s=lf only i=info here type=(null) control=(null) c=(null) ssm=0 range=1.5-20 abs=(null)-(null)\n"
+    "m=audio port=0 protocol=RTP payload=0 codec=PCMU frequency=8000 channels=1 control=track1 c=(null) ssm=0 b=64 mux=1 nack=0 rtx=0 fec=0 video=640x480@15 range=1.5-20 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 0 RTP/AVP 0\n"
+    "a=control:  track1  extra\n"
+    "a=control\n"
+    "a=range:npt=1.5-20\n"
+    "a=x-dimensions:640,480\n"
+    "a=x-framerate: 15\n"
+    "b=AS:64\n"
+    "a=rtcp-mux\n"
+    "\n" },
+  { "Absolute-time ranges, and extra white space",
+    "\r\nv=0\r\ns=\r\ni=\r\na=control:*\r\na=range:clock=20200101T000000Z-20200101T010000Z\r\nm=audio 0 RTP/AVP 0\r\n"
+    "c=IN   IP4   10.0.0.1\r\na=range:clock=20200101T000000Z-\r\n",
+    "s=(null) i=(null) type=(null) control=* c=(null) ssm=0 range=0-0 abs=20200101T000000Z-20200101T010000Z\n"
+    "m=audio port=0 protocol=RTP payload=0 codec=PCMU frequency=8000 channels=1 control=(null) c=10.0.0.1 ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=20200101T000000Z-20200101T010000Z\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  saved: m=audio 0 RTP/AVP 0\r\n"
+    "c=IN   IP4   10.0.0.1\r\n"
+    "a=range:clock=20200101T000000Z-\r\n"
+    "\n" },
+  { "Unusual \"a=fmtp:\" parameters",
+    "v=0\r\ns=x\r\nm=video 0 RTP/AVP 96\r\na=rtpmap:96 H264\r\na=fmtp:96 A = B ; c;;d=;e=f g;X=0x1F\r\n"
+    "m=video 0 RTP/AVP 96\r\na=rtpmap:96 MP4V-ES/90000\r\na=fmtp:96 profile-level-id=1;config=000001B001;octet-align\r\n",
+    "s=x i=(null) type=(null) control=(null) c=(null) ssm=0 range=0-0 abs=(null)-(null)\n"
+    "m=video port=0 protocol=RTP payload=96 codec=H264 frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=0 (lower: 0, int: 0)\n"
+    "  a=B (lower: b, int: 0)\n"
+    "  c=(null) (lower: (null), int: 1)\n"
+    "  d=(null) (lower: (null), int: 1)\n"
+    "  e=f (lower: f, int: 0)\n"
+    "  x=0x1F (lower: 0x1f, int: 0)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "a=rtpmap:96 H264\r\n"
+    "a=fmtp:96 A = B ; c;;d=;e=f g;X=0x1F\r\n"
+    "\n"
+    "m=video port=0 protocol=RTP payload=96 codec=MP4V-ES frequency=90000 channels=1 control=(null) c=(null) ssm=0 b=0 mux=0 nack=0 rtx=0 fec=0 video=0x0@0 range=0-0 abs=(null)-(null)\n"
+    "  profile-level-id=1 (lower: 1, int: 1)\n"
+    "  config=000001B001 (lower: 000001b001, int: 1)\n"
+    "  octet-align=(null) (lower: (null), int: 1)\n"
+    "  saved: m=video 0 RTP/AVP 96\r\n"
+    "a=rtpmap:96 MP4V-ES/90000\r\n"
+    "a=fmtp:96 profile-level-id=1;config=000001B001;octet-align\r\n"
+    "\n" },
+  { "Malformed lines",
+    "v=0\r\nxx\r\nm=audio 0 RTP/AVP 0\r\nm=video 0 RTP/AVP 96\r\na=rtpmap:96 /90000\r\nm=audio 0 RTP/AVP 0\r\nZ=bad\r\n",
+    "(failed)\n" },
+};
+#define NUM_TEST_CASES ((unsigned)(sizeof corpus/sizeof corpus[0]))
+#define NUM_TIMED_TEST_CASES 4 // the camera/server descriptions at the start of "corpus" (the others are unusual, or malformed)
+
+// The results of parsing a SDP description, in a form that can be compared:
+#define MAX_RESULT_SIZE 10000
+char result[MAX_RESULT_SIZE];
+unsigned resultSize;
+
+static void addToResult(char const* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int size = vsnprintf(&result[resultSize], MAX_RESULT_SIZE - resultSize, fmt, args);
+  va_end(args);
+  if (size > 0) {
+    resultSize += size;
+    if (resultSize >= MAX_RESULT_SIZE) resultSize = MAX_RESULT_SIZE - 1;
+  }
+}
+
+static char const* str(char const* s) { return s == NULL ? "(null)" : s; }
+
+// The "a=fmtp:" parameters that we report:
+char const* const fmtpParameterNames[] = {
+  "packetization-mode", "profile-level-id", "sprop-parameter-sets", "sprop-vps", "sprop-sps", "sprop-pps",
+  "streamtype", "mode", "config", "sizelength", "indexlength", "apt", "octet-align", "a", "c", "d", "e", "x"
+};
+#define NUM_FMTP_PARAMETER_NAMES (sizeof fmtpParameterNames/sizeof fmtpParameterNames[0])
+
+static void parse(char const* sdpDescription) {
+  resultSize = 0; result[0] = '\0';
+
+  MediaSession* session = MediaSession::createNew(*env, sdpDescription);
+  if (session == NULL) {
+    addToResult("(failed)\n");
+    return;
+  }
+
+  char* absStartTime = session->absStartTime();
+  char* absEndTime = session->absEndTime();
+  addToResult("s=%s i=%s type=%s control=%s c=%s ssm=%d range=%g-%g abs=%s-%s\n",
+	      str(session->sessionName()), str(session->sessionDescription()), str(session->mediaSessionType()),
+	      str(session->controlPath()), str(session->connectionEndpointName()), session->sourceFilterAddr().s_addr != 0,
+	      session->playStartTime(), session->playEndTime(), str(absStartTime), str(absEndTime));
+
+  MediaSubsessionIterator iter(*session);
+  MediaSubsession* subsession;
+  while ((subsession = iter.next()) != NULL) {
+    absStartTime = subsession->absStartTime();
+    absEndTime = subsession->absEndTime();
+    addToResult("m=%s port=%u protocol=%s payload=%u codec=%s frequency=%u channels=%u control=%s c=%s ssm=%d b=%u"
+		" mux=%d nack=%d rtx=%u fec=%u video=%ux%u@%u range=%g-%g abs=%s-%s\n",
+		str(subsession->mediumName()), subsession->clientPortNum(), str(subsession->protocolName()),
+		subsession->rtpPayloadFormat(), str(subsession->codecName()), subsession->rtpTimestampFrequency(),
+		subsession->numChannels(), str(subsession->controlPath()), str(subsession->connectionEndpointName()),
+		subsession->isSSM(), subsession->bandwidth(), subsession->rtcpIsMuxed(), subsession->nacksOffered(),
+		subsession->rtxPayloadFormat(), subsession->fecPayloadFormat(),
+		subsession->videoWidth(), subsession->videoHeight(), subsession->videoFPS(),
+		subsession->playStartTime(), subsession->playEndTime(), str(absStartTime), str(absEndTime));
+    for (unsigned i = 0; i < NUM_FMTP_PARAMETER_NAMES; ++i) {
+      char const* name = fmtpParameterNames[i];
+      char const* value = subsession->attrVal_str(name);
+      if (value != NULL && value[0] == '\0') continue; // not present (a parameter without a value has a NULL value)
+      addToResult("  %s=%s (lower: %s, int: %d)\n", name, str(value), str(subsession->attrVal_strToLower(name)),
+		  subsession->attrVal_int(name));
+    }
+    addToResult("  saved: %s\n", str(subsession->savedSDPLines()));
+  }
+
+  Medium::close(session);
+}
+
+// Prints "s" as a C string literal (split at newlines):
+static void printAsStringLiteral(char const* s) {
+  *env << "    \"";
+  for (; *s != '\0'; ++s) {
+    if (*s == '\r') *env << "\\r";
+    else if (*s == '\n') { *env << "\\n"; if (s[1] != '\0') *env << "\"\n    \""; }
+    else if (*s == '"' || *s == '\\') { char escaped[3] = { '\\', *s, '\0' }; *env << escaped; }
+    else { char c[2] = { *s, '\0' }; *env << c; }
+  }
+  *env << "\",\n";
+}
+
+int main(int argc, char** argv) {
+  // Begin by setting up our usage environment:
+  TaskScheduler* scheduler = BasicTaskScheduler::createNew();
+  env = BasicUsageEnvironment::createNew(*scheduler);
+
+  progName = argv[0];
+  while (argc > 1) {
+    char* const opt = argv[1];
+    if (opt[0] != '-') usage();
+
+    switch (opt[1]) {
+    case 'n': {
+      if (argc < 3 || sscanf(argv[2], "%u", &numIterations) != 1) usage();
+      ++argv; --argc;
+      break;
+    }
+    case 'p': {
+      printResults = True;
+      break;
+    }
+    default: {
+      usage();
+      break;
+    }
+    }
+
+    ++argv; --argc;
+  }
+
+  // Check that we parse each description as expected:
+  unsigned numFailures = 0;
+  for (unsigned i = 0; i < NUM_TEST_CASES; ++i) {
+    parse(corpus[i].sdpDescription);
+    if (printResults) {
+      *env << "// " << corpus[i].name << ":\n";
+      printAsStringLiteral(result);
+    } else if (corpus[i].expectedResult == NULL || strcmp(result, corpus[i].expectedResult) != 0) {
+      *env << "Test case \"" << corpus[i].name << "\" failed.  Expected:\n" << str(corpus[i].expectedResult)
+	   << "but got:\n" << result;
+      ++numFailures;
+    }
+  }
+  if (printResults) return 0;
+  *env << NUM_TEST_CASES - numFailures << " of " << NUM_TEST_CASES << " SDP descriptions were parsed as expected\n";
+
+  // Then measure how long it takes to create (and close) a "MediaSession" from each camera/server description:
+  if (numIterations > 0) {
+    struct timeval startTime, endTime;
+    gettimeofday(&startTime, NULL);
+    for (unsigned n = 0; n < numIterations; ++n) {
+      for (unsigned i = 0; i < NUM_TIMED_TEST_CASES; ++i) {
+	Medium::close(MediaSession::createNew(*env, corpus[i].sdpDescription));
+      }
+    }
+    gettimeofday(&endTime, NULL);
+    double elapsedTime = (endTime.tv_sec - startTime.tv_sec) + (endTime.tv_usec - startTime.tv_usec)/1000000.0;
+
+    char line[200];
+    sprintf(line, "%.2f microseconds per SDP description (%u descriptions, parsed %u times each)\n",
+	    elapsedTime*1000000.0/(numIterations*NUM_TIMED_TEST_CASES), NUM_TIMED_TEST_CASES, numIterations);
+    *env << line;
+  }
+
+  return numFailures == 0 ? 0 : 1;
+}